@@ -0,0 +1,190 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/benchmark/common.hpp"
+#include "coolerpp/bin_table.hpp"
+#include "coolerpp/coolerpp.hpp"
+#include "coolerpp/genomic_interval.hpp"
+#include "coolerpp/pixel.hpp"
+
+namespace coolerpp::benchmark {
+
+// Parameters of the synthetic datasets used by the macro benchmarks.
+// Values can be overridden from the command line (see macro_bench.cpp)
+struct MacroBenchConfig {
+  std::uint64_t nnz{2'000'000};
+  std::uint32_t resolution{10'000};
+  std::size_t num_merge_inputs{4};
+  std::size_t num_queries{250};
+  std::uint32_t query_span{1'000'000};
+  std::uint32_t band_width{2'000'000};
+  std::uint64_t seed{10'000'019};
+};
+
+inline MacroBenchConfig config{};  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+// Amount of work performed by a single run of a benchmark. Used by the ThroughputListener to
+// report throughput in pixels/s and MB/s, where MB refers to pixels in columnar form (i.e.
+// two 64-bit bin ids and the count)
+struct Workload {
+  std::uint64_t num_pixels{};
+  std::uint64_t num_bytes{};
+};
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+inline std::map<std::string, Workload> workloads{};
+
+template <typename N>
+inline void register_workload(const std::string& benchmark_name, std::uint64_t num_pixels) {
+  workloads.insert_or_assign(
+      benchmark_name, Workload{num_pixels, num_pixels * (2 * sizeof(std::uint64_t) + sizeof(N))});
+}
+
+// Pixels in columnar form
+template <typename N>
+struct PixelColumns {
+  std::vector<std::uint64_t> bin1_ids{};
+  std::vector<std::uint64_t> bin2_ids{};
+  std::vector<N> counts{};
+
+  [[nodiscard]] std::size_t size() const noexcept { return this->counts.size(); }
+};
+
+// Generate roughly nnz pixels mimicking a Hi-C matrix: cis_fraction of the interactions are
+// between bins located on the same chromosome, and their frequency decays with the distance
+// between bins (i.e. distances are drawn from a log-uniform distribution).
+// Interactions hitting the same pixel are summed, so the number of pixels returned is <= nnz
+[[nodiscard]] inline PixelColumns<std::int32_t> generate_synthetic_pixels(
+    const BinTable& bins, std::uint64_t nnz, std::uint64_t seed, double cis_fraction = 0.9) {
+  std::mt19937_64 rand_eng{seed};
+
+  // Bin ids of the first and last bins of the chromosome each bin belongs to
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> chrom_bounds(bins.size());
+  for (const auto& chrom : bins.chromosomes()) {
+    const auto bounds = bins.map_to_bin_ids(GenomicInterval{chrom});
+    std::fill(chrom_bounds.begin() + static_cast<std::ptrdiff_t>(bounds.first),
+              chrom_bounds.begin() + static_cast<std::ptrdiff_t>(bounds.second + 1), bounds);
+  }
+
+  std::uniform_int_distribution<std::uint64_t> bin_dist{0, bins.size() - 1};
+  std::uniform_real_distribution<double> unif{0.0, 1.0};
+
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> coords(nnz);
+  std::generate(coords.begin(), coords.end(), [&]() {
+    const auto bin1_id = bin_dist(rand_eng);
+    const auto chrom_last_bin = chrom_bounds[bin1_id].second;
+    const auto is_last_chrom = chrom_last_bin + 1 == bins.size();
+    if (unif(rand_eng) < cis_fraction || is_last_chrom) {
+      const auto max_dist = static_cast<double>(chrom_last_bin - bin1_id + 1);
+      const auto dist = static_cast<std::uint64_t>(std::exp(unif(rand_eng) * std::log(max_dist)));
+      return std::make_pair(bin1_id, (std::min)(chrom_last_bin, bin1_id + dist - 1));
+    }
+    const auto bin2_id = std::uniform_int_distribution<std::uint64_t>{
+        chrom_last_bin + 1, bins.size() - 1}(rand_eng);
+    return std::make_pair(bin1_id, bin2_id);
+  });
+  std::sort(coords.begin(), coords.end());
+
+  PixelColumns<std::int32_t> pixels{};
+  for (const auto& [bin1_id, bin2_id] : coords) {
+    if (!pixels.counts.empty() && pixels.bin1_ids.back() == bin1_id &&
+        pixels.bin2_ids.back() == bin2_id) {
+      ++pixels.counts.back();
+      continue;
+    }
+    pixels.bin1_ids.push_back(bin1_id);
+    pixels.bin2_ids.push_back(bin2_id);
+    pixels.counts.push_back(1);
+  }
+  return pixels;
+}
+
+template <typename N>
+[[nodiscard]] inline std::vector<Pixel<N>> materialize_pixels(const BinTable& bins,
+                                                              const PixelColumns<N>& columns) {
+  std::vector<Pixel<N>> pixels(columns.size());
+  for (std::size_t i = 0; i < pixels.size(); ++i) {
+    pixels[i] = Pixel<N>{bins, columns.bin1_ids[i], columns.bin2_ids[i], columns.counts[i]};
+  }
+  return pixels;
+}
+
+// Write a synthetic cooler with balancing weights named "weight", of which ~2% are NaN
+inline void write_synthetic_cooler(const std::filesystem::path& path, const BinTable& bins,
+                                   const PixelColumns<std::int32_t>& pixels, std::uint64_t seed) {
+  using N = std::int32_t;
+  {
+    auto clr = File::create_new_cooler<N>(path.string(), bins.chromosomes(), bins.bin_size(), true);
+    clr.append_pixels_columns(pixels.bin1_ids.data(), pixels.bin2_ids.data(), pixels.counts.data(),
+                              pixels.size());
+  }
+
+  std::mt19937_64 rand_eng{seed};
+  std::uniform_real_distribution<double> unif{0.0, 1.0};
+  std::vector<double> weights(bins.size());
+  std::generate(weights.begin(), weights.end(), [&]() {
+    const auto w = unif(rand_eng);
+    return w < 0.02 ? std::numeric_limits<double>::quiet_NaN() : 0.5 + w;
+  });
+  File::write_weights(path.string(), "weight", weights.begin(), weights.end());
+}
+
+// Synthetic coolers shared by all macro benchmarks. Files are generated on first use and deleted
+// when the process exits
+class SyntheticDataset {
+  SelfDeletingFolder _tmpdir{};
+  BinTable _bins{};
+  PixelColumns<std::int32_t> _pixels{};
+  std::filesystem::path _path{};
+  std::vector<std::filesystem::path> _merge_inputs{};
+
+  SyntheticDataset()
+      : _bins(constants::hg38_chroms, config.resolution),
+        _pixels(generate_synthetic_pixels(_bins, config.nnz, config.seed)),
+        _path(_tmpdir() / fmt::format(FMT_STRING("synthetic.{}.cool"), config.resolution)) {
+    write_synthetic_cooler(this->_path, this->_bins, this->_pixels, config.seed);
+
+    const auto num_inputs = (std::max)(std::size_t(1), config.num_merge_inputs);
+    for (std::size_t i = 0; i < num_inputs; ++i) {
+      const auto seed = config.seed + i + 1;
+      this->_merge_inputs.emplace_back(
+          this->_tmpdir() / fmt::format(FMT_STRING("merge_input.{}.cool"), i));
+      write_synthetic_cooler(this->_merge_inputs.back(), this->_bins,
+                             generate_synthetic_pixels(this->_bins, config.nnz / num_inputs, seed),
+                             seed);
+    }
+  }
+
+ public:
+  [[nodiscard]] static const SyntheticDataset& instance() {
+    static const SyntheticDataset dataset{};
+    return dataset;
+  }
+
+  [[nodiscard]] const BinTable& bins() const noexcept { return this->_bins; }
+  [[nodiscard]] const PixelColumns<std::int32_t>& pixels() const noexcept { return this->_pixels; }
+  [[nodiscard]] const std::filesystem::path& path() const noexcept { return this->_path; }
+  [[nodiscard]] const std::vector<std::filesystem::path>& merge_inputs() const noexcept {
+    return this->_merge_inputs;
+  }
+  [[nodiscard]] std::filesystem::path tmpdir() const { return this->_tmpdir(); }
+};
+
+}  // namespace coolerpp::benchmark
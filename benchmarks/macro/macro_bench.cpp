@@ -0,0 +1,228 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <catch2/benchmark/catch_benchmark_all.hpp>
+#include <catch2/catch_session.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/reporters/catch_reporter_event_listener.hpp>
+#include <catch2/reporters/catch_reporter_registrars.hpp>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/balancing.hpp"
+#include "coolerpp/benchmark/synthetic_cooler.hpp"
+#include "coolerpp/coolerpp.hpp"
+#include "coolerpp/utils.hpp"
+
+namespace coolerpp::benchmark {
+
+// Report the throughput of benchmarks whose workload has been registered with
+// register_workload()
+class ThroughputListener : public Catch::EventListenerBase {
+ public:
+  using Catch::EventListenerBase::EventListenerBase;
+
+  void benchmarkEnded(const Catch::BenchmarkStats<>& stats) override {
+    const auto it = workloads.find(stats.info.name);
+    if (it == workloads.end()) {
+      return;
+    }
+    const auto seconds = stats.mean.point.count() / 1.0e9;
+    const auto& workload = it->second;
+    fmt::print(FMT_STRING("{}: {:.4g} pixels/s; {:.4g} MB/s ({} pixels per run)\n"), it->first,
+               static_cast<double>(workload.num_pixels) / seconds,
+               static_cast<double>(workload.num_bytes) / 1.0e6 / seconds, workload.num_pixels);
+  }
+};
+
+// Returns the number of pixels visited and the sum of their counts
+template <typename PixelIt>
+[[nodiscard]] static std::pair<std::uint64_t, double> visit_pixels(PixelIt first, PixelIt last) {
+  std::uint64_t n = 0;
+  double sum = 0;
+  std::for_each(first, last, [&](const auto& p) {
+    ++n;
+    if (std::isfinite(p.count)) {
+      sum += static_cast<double>(p.count);
+    }
+  });
+  return {n, sum};
+}
+
+[[nodiscard]] static std::string generate_query(const Chromosome& chrom, std::uint32_t query_span,
+                                                std::mt19937_64& rand_eng) {
+  const auto span = (std::min)(query_span, chrom.size());
+  const auto start = std::uniform_int_distribution<std::uint32_t>{0, chrom.size() - span}(rand_eng);
+  return fmt::format(FMT_STRING("{}:{}-{}"), chrom.name(), start, start + span);
+}
+
+// Generate random queries spanning query_span bp. When trans is true, the second range of each
+// query pair is located downstream of the first one, on a different chromosome
+[[nodiscard]] static std::vector<std::pair<std::string, std::string>> generate_queries(
+    const ChromosomeSet& chroms, std::size_t num_queries, std::uint32_t query_span, bool trans,
+    std::uint64_t seed) {
+  std::mt19937_64 rand_eng{seed};
+  const auto num_chroms = static_cast<std::uint32_t>(chroms.size());
+  std::vector<std::pair<std::string, std::string>> queries(num_queries);
+  std::generate(queries.begin(), queries.end(), [&]() {
+    const auto chrom1_id = std::uniform_int_distribution<std::uint32_t>{
+        0, num_chroms - (trans ? 2 : 1)}(rand_eng);
+    const auto chrom2_id = trans ? std::uniform_int_distribution<std::uint32_t>{
+                                       chrom1_id + 1, num_chroms - 1}(rand_eng)
+                                 : chrom1_id;
+    const auto& chrom1 = chroms.at(chrom1_id);
+    const auto& chrom2 = chroms.at(chrom2_id);
+
+    auto query1 = generate_query(chrom1, query_span, rand_eng);
+    auto query2 = trans ? generate_query(chrom2, query_span, rand_eng) : query1;
+    return std::make_pair(std::move(query1), std::move(query2));
+  });
+  return queries;
+}
+
+TEST_CASE("Macro: open", "[macro][bench]") {
+  const auto& dataset = SyntheticDataset::instance();
+
+  for (const auto validate : {true, false}) {
+    BENCHMARK(fmt::format(FMT_STRING("File::open_read_only (validate={})"), validate)) {
+      return File::open_read_only(dataset.path().string(), DEFAULT_HDF5_CACHE_SIZE, validate)
+          .bin_size();
+    };
+  }
+
+  BENCHMARK("File::open_read_only_trusted") {
+    return File::open_read_only_trusted(dataset.path().string()).bin_size();
+  };
+}
+
+TEST_CASE("Macro: queries", "[macro][bench]") {
+  using N = std::int32_t;
+  const auto& dataset = SyntheticDataset::instance();
+  const auto clr = File::open_read_only(dataset.path().string());
+  const auto& chroms = clr.chromosomes();
+
+  const auto cis_queries =
+      generate_queries(chroms, config.num_queries, config.query_span, false, config.seed);
+  const auto trans_queries =
+      generate_queries(chroms, config.num_queries, config.query_span, true, config.seed);
+
+  auto run_queries = [&](const auto& queries) {
+    std::pair<std::uint64_t, double> res{};
+    for (const auto& [q1, q2] : queries) {
+      const auto sel = clr.fetch<N>(q1, q2);
+      const auto [n, sum] = visit_pixels(sel.begin(), sel.end());
+      res.first += n;
+      res.second += sum;
+    }
+    return res;
+  };
+
+  const std::uint64_t band_width = config.band_width / config.resolution;
+  auto run_band_queries = [&]() {
+    std::pair<std::uint64_t, double> res{};
+    for (const auto& chrom : chroms) {
+      const auto sel = clr.fetch<N>(chrom.name(), band_width);
+      const auto [n, sum] = visit_pixels(sel.begin(), sel.end());
+      res.first += n;
+      res.second += sum;
+    }
+    return res;
+  };
+
+  const auto cis_name = fmt::format(FMT_STRING("{} random {}bp cis queries"), cis_queries.size(),
+                                    config.query_span);
+  register_workload<N>(cis_name, run_queries(cis_queries).first);
+  BENCHMARK(std::string{cis_name}) { return run_queries(cis_queries); };
+
+  const auto trans_name = fmt::format(FMT_STRING("{} random {}bp trans queries"),
+                                      trans_queries.size(), config.query_span);
+  register_workload<N>(trans_name, run_queries(trans_queries).first);
+  BENCHMARK(std::string{trans_name}) { return run_queries(trans_queries); };
+
+  const auto band_name = fmt::format(FMT_STRING("{}bp band queries"), config.band_width);
+  register_workload<N>(band_name, run_band_queries().first);
+  BENCHMARK(std::string{band_name}) { return run_band_queries(); };
+}
+
+TEST_CASE("Macro: scan", "[macro][bench]") {
+  using N = std::int32_t;
+  const auto& dataset = SyntheticDataset::instance();
+  const auto clr = File::open_read_only_read_once(dataset.path().string());
+  const auto num_pixels = static_cast<std::uint64_t>(*clr.attributes().nnz);
+
+  register_workload<N>("whole-file scan", num_pixels);
+  BENCHMARK("whole-file scan") { return visit_pixels(clr.begin<N>(), clr.end<N>()); };
+
+  const auto weights = clr.read_weights("weight");
+  register_workload<N>("balanced whole-file scan", num_pixels);
+  BENCHMARK("balanced whole-file scan") {
+    const Balancer<N> sel(clr.fetch<N>(), weights);
+    return visit_pixels(sel.begin(), sel.end());
+  };
+}
+
+TEST_CASE("Macro: write", "[macro][bench]") {
+  using N = std::int32_t;
+  const auto& dataset = SyntheticDataset::instance();
+  const auto& bins = dataset.bins();
+  const auto pixels = materialize_pixels(bins, dataset.pixels());
+  const auto dest = dataset.tmpdir() / "append_pixels.cool";
+
+  register_workload<N>("File::append_pixels", pixels.size());
+  BENCHMARK("File::append_pixels") {
+    auto clr = File::create_new_cooler<N>(dest.string(), bins.chromosomes(), bins.bin_size(), true);
+    clr.append_pixels(pixels.begin(), pixels.end());
+    return clr.bin_size();
+  };
+
+  const auto merge_dest = dataset.tmpdir() / "merge.cool";
+  std::vector<std::string> inputs(dataset.merge_inputs().size());
+  std::transform(dataset.merge_inputs().begin(), dataset.merge_inputs().end(), inputs.begin(),
+                 [](const auto& p) { return p.string(); });
+  const auto num_pixels = std::accumulate(
+      inputs.begin(), inputs.end(), std::uint64_t(0), [](auto accumulator, const auto& uri) {
+        return accumulator +
+               static_cast<std::uint64_t>(*File::open_read_only(uri).attributes().nnz);
+      });
+
+  const auto merge_name = fmt::format(FMT_STRING("utils::merge ({} inputs)"), inputs.size());
+  register_workload<N>(merge_name, num_pixels);
+  BENCHMARK(std::string{merge_name}) {
+    utils::merge(inputs.begin(), inputs.end(), merge_dest.string(), true);
+    return merge_dest.string().size();
+  };
+}
+
+}  // namespace coolerpp::benchmark
+
+CATCH_REGISTER_LISTENER(coolerpp::benchmark::ThroughputListener)
+
+int main(int argc, char** argv) {
+  using namespace Catch::Clara;
+  using coolerpp::benchmark::config;
+
+  Catch::Session session{};
+  auto cli = session.cli() |
+             Opt(config.nnz, "nnz")["--nnz"]("Number of interactions of the synthetic coolers") |
+             Opt(config.resolution, "bp")["--resolution"]("Resolution of the synthetic coolers") |
+             Opt(config.num_merge_inputs, "n")["--merge-inputs"]("Number of coolers to merge") |
+             Opt(config.num_queries, "n")["--queries"]("Number of random queries") |
+             Opt(config.query_span, "bp")["--query-span"]("Size of random queries") |
+             Opt(config.band_width, "bp")["--band-width"]("Width of band queries") |
+             Opt(config.seed, "seed")["--synthetic-seed"]("Seed used to generate datasets");
+  session.cli(cli);
+
+  if (const auto ec = session.applyCommandLine(argc, argv); ec != 0) {
+    return ec;
+  }
+  return session.run();
+}
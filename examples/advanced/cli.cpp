@@ -230,6 +230,12 @@ void Cli::make_dump_subcommand() {
       "Output pixels in BG2 format.")
       ->capture_default_str();
 
+  sc.add_flag(
+      "--binary",
+      c.binary,
+      "Output pixels as fixed-size binary records (bin1_id, bin2_id and count).")
+      ->capture_default_str();
+
   sc.add_option(
       "--weight-type",
       c.weight_type,
@@ -280,7 +286,7 @@ void Cli::make_load_subcommand() {
       "-f,--format",
       c.format,
       "Input format.")
-      ->check(CLI::IsMember({"bg2", "coo"}))
+      ->check(CLI::IsMember({"bg2", "coo", "validpairs"}))
       ->capture_default_str();
 
   sc.add_option(
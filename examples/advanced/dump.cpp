@@ -8,32 +8,20 @@
 #include <algorithm>
 #include <cassert>
 #include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #include "coolerpp/coolerpp.hpp"
+#include "coolerpp/pixel_output.hpp"
 #include "coolerpp_tools/config.hpp"
 #include "coolerpp_tools/tools.hpp"
 
 namespace coolerpp::tools {
 
-template <bool join>
-static void print(const Pixel<std::int64_t>& pixel) {
-  if constexpr (join) {
-    fmt::print(FMT_COMPILE("{:bg2}\n"), pixel);
-  } else {
-    fmt::print(FMT_COMPILE("{:raw}\n"), pixel);
-  }
-}
-
-template <bool join>
-static void print(const Pixel<double>& pixel) {
-  if constexpr (join) {
-    fmt::print(FMT_COMPILE("{:bg2}\t{:g}\n"), pixel.coords, pixel.count);
-  } else {
-    fmt::print(FMT_COMPILE("{:raw}\t{:g}\n"), pixel.coords, pixel.count);
-  }
-}
-
 static void dump_chroms(const File& clr, std::string_view range) {
   if (range == "all") {
     for (const Chromosome& chrom : clr.chromosomes()) {
@@ -42,7 +30,7 @@ static void dump_chroms(const File& clr, std::string_view range) {
     return;
   }
 
-  const auto coords = GenomicInterval::parse_ucsc(clr.chromosomes(), std::string{range});
+  const auto coords = GenomicInterval::parse_ucsc(clr.chromosomes(), range);
   auto it = clr.chromosomes().find(coords.chrom());
   if (it != clr.chromosomes().end()) {
     fmt::print(FMT_COMPILE("{:s}\t{:d}\n"), it->name(), it->size());
@@ -57,52 +45,48 @@ static void dump_bins(const File& clr, std::string_view range) {
     return;
   }
 
-  const auto coords = GenomicInterval::parse_ucsc(clr.chromosomes(), std::string{range});
+  const auto coords = GenomicInterval::parse_ucsc(clr.chromosomes(), range);
   auto [first_bin, last_bin] = clr.bins().find_overlap(coords);
   std::for_each(first_bin, last_bin, [](const Bin& bin) {
     fmt::print(FMT_COMPILE("{:s}\t{:d}\t{:d}\n"), bin.chrom().name(), bin.start(), bin.end());
   });
 }
 
-template <typename N, bool join>
+template <typename N>
 static void print_pixels(typename PixelSelector<N>::iterator first_pixel,
                          typename PixelSelector<N>::iterator last_pixel,
-                         const std::shared_ptr<const Weights>& weights) {
+                         const std::shared_ptr<const Weights>& weights,
+                         io::PixelFileWriter& writer) {
   if (weights != nullptr) {
     const auto sel = Balancer<N>(first_pixel, last_pixel, weights);
-    std::for_each(sel.begin(), sel.end(), [&](const auto& pixel) { print<join>(pixel); });
+    writer.write(sel.begin(), sel.end());
     return;
   }
-  std::for_each(first_pixel, last_pixel, [&](const auto& pixel) { print<join>(pixel); });
+  writer.write(first_pixel, last_pixel);
 }
 
-template <bool join>
 static void dump_pixels(const File& clr, std::string_view range1, std::string_view range2,
-                        std::string_view balanced) {
-  const auto has_int_pixels = clr.has_integral_pixels();
+                        std::string_view balanced, io::OutputFormat format) {
   const auto weights = // TODO: pass ptr to dump_pixels
       balanced.empty() ? std::shared_ptr<const Weights>(nullptr) : clr.read_weights(balanced);
+  io::PixelFileWriter writer("-", clr.bins(), format);
+
+  // Pixels are read using the same type used to store counts on disk
+  auto print = [&](const auto& sel) {
+    using N = decltype(sel.begin()->count);
+    print_pixels<N>(sel.begin(), sel.end(), weights, writer);
+  };
 
   if (range1 == "all") {
     assert(range2 == "all");
-    return has_int_pixels
-               ? print_pixels<std::int64_t, join>(clr.begin<std::int64_t>(),
-                                                  clr.end<std::int64_t>(), weights)
-               : print_pixels<double, join>(clr.begin<double>(), clr.end<double>(), weights);
-  }
-
-  if (has_int_pixels) {
-    auto sel = clr.fetch<std::int64_t>(range1, range2);
-    return print_pixels<std::int64_t, join>(sel.begin(), sel.end(), weights);
+    return clr.visit_pixels(print);
   }
-
-  auto sel = clr.fetch<double>(range1, range2);
-  return print_pixels<double, join>(sel.begin(), sel.end(), weights);
+  return clr.visit_pixels(print, range1, range2);
 }
 
-template <bool join>
-void process_query(const File& clr, std::string_view table, std::string_view range1,
-                   std::string_view range2, std::string_view balanced) {
+static void process_query(const File& clr, std::string_view table, std::string_view range1,
+                          std::string_view range2, std::string_view balanced,
+                          io::OutputFormat format) {
   if (table == "chroms") {
     return dump_chroms(clr, range1);
   }
@@ -111,7 +95,7 @@ void process_query(const File& clr, std::string_view table, std::string_view ran
   }
 
   assert(table == "pixels");
-  return dump_pixels<join>(clr, range1, range2, balanced);
+  return dump_pixels(clr, range1, range2, balanced, format);
 }
 
 [[nodiscard]] static std::pair<std::string, std::string> parse_bedpe(std::string_view line) {
@@ -131,17 +115,61 @@ void process_query(const File& clr, std::string_view table, std::string_view ran
   return std::make_pair(next_token(), next_token());
 }
 
+using QueryVector = std::vector<std::pair<GenomicInterval, GenomicInterval>>;
+
+template <typename N>
+static void dump_pixels_many(const File& clr, const QueryVector& queries,
+                             const std::shared_ptr<const Weights>& weights,
+                             io::PixelFileWriter& writer) {
+  // Pixels are buffered so that they can be printed in the same order as queries
+  std::vector<std::vector<Pixel<N>>> pixels(queries.size());
+  clr.fetch_many<N>(queries, [&](std::size_t query_id, const Pixel<N>& p) {
+    pixels[query_id].push_back(p);
+  });
+
+  for (auto& buff : pixels) {
+    if (weights == nullptr) {
+      writer.write(buff.begin(), buff.end());
+    } else {
+      for (const auto& p : buff) {
+        const auto bin1_id = p.coords.bin1.id();
+        const auto bin2_id = p.coords.bin2.id();
+        double count{};
+        weights->balance(&bin1_id, &bin2_id, &p.count, 1, &count);
+        writer.write(Pixel<double>{p.coords, count});
+      }
+    }
+    buff = std::vector<Pixel<N>>{};
+  }
+}
+
+static void dump_pixels_many(const File& clr, const QueryVector& queries,
+                             std::string_view balanced, io::OutputFormat format) {
+  const auto weights =
+      balanced.empty() ? std::shared_ptr<const Weights>(nullptr) : clr.read_weights(balanced);
+  io::PixelFileWriter writer("-", clr.bins(), format);
+
+  if (clr.has_integral_pixels()) {
+    return dump_pixels_many<std::int64_t>(clr, queries, weights, writer);
+  }
+  return dump_pixels_many<double>(clr, queries, weights, writer);
+}
+
 void dump_subcmd(const DumpConfig& c) {
   const auto clr = File::open_read_only(c.uri);
 
+  const auto format = c.binary ? io::OutputFormat::BINARY
+                     : c.join   ? io::OutputFormat::BG2
+                                : io::OutputFormat::RAW;
+
   if (c.query_file.empty()) {
-    c.join ? process_query<true>(clr, c.table, c.range1, c.range2, c.balanced)
-           : process_query<false>(clr, c.table, c.range1, c.range2, c.balanced);
+    return process_query(clr, c.table, c.range1, c.range2, c.balanced, format);
   }
 
   const auto read_from_stdin = c.query_file == "-";
   std::ifstream ifs{};
-  ifs.exceptions(ifs.exceptions() | std::ios_base::badbit | std::ios_base::failbit);
+  // failbit is not added to the exception mask, as std::getline() sets it when reaching EOF
+  ifs.exceptions(ifs.exceptions() | std::ios_base::badbit);
 
   if (!read_from_stdin) {
     assert(std::filesystem::exists(c.query_file));
@@ -149,11 +177,20 @@ void dump_subcmd(const DumpConfig& c) {
   }
 
   std::string line;
-  while (std::getline(read_from_stdin ? std::cin : ifs, line)) {
-    const auto [range1, range2] = parse_bedpe(line);
-    c.join ? process_query<true>(clr, c.table, range1, range2, c.balanced)
-           : process_query<false>(clr, c.table, range1, range2, c.balanced);
+  if (c.table != "pixels") {
+    while (std::getline(read_from_stdin ? std::cin : ifs, line)) {
+      const auto [range1, range2] = parse_bedpe(line);
+      process_query(clr, c.table, range1, range2, c.balanced, format);
+    }
+    return;
   }
+
+  // Pixel queries are answered in batches, so that queries overlapping the same rows share the
+  // chunks read from the pixel table
+  const std::string queries{std::istreambuf_iterator<char>(read_from_stdin ? std::cin : ifs),
+                            std::istreambuf_iterator<char>()};
+  dump_pixels_many(clr, GenomicInterval::parse_bedpe(clr.chromosomes(), queries), c.balanced,
+                   format);
 }
 
 }  // namespace coolerpp::tools
@@ -22,6 +22,7 @@ struct DumpConfig {
 
   std::string table{"pixels"};
   bool join{true};
+  bool binary{false};
 
   std::string balanced{};
   Weights::Type weight_type{Weights::Type::INFER};
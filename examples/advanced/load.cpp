@@ -6,39 +6,17 @@
 #include <fmt/format.h>
 #include <fmt/std.h>
 
-#include <algorithm>
-#include <cassert>
+#include <cstdint>
 #include <fstream>
-#include <string_view>
 
 #include "coolerpp/coolerpp.hpp"
+#include "coolerpp/pixel_parser.hpp"
+#include "coolerpp/utils.hpp"
 #include "coolerpp_tools/config.hpp"
 #include "coolerpp_tools/tools.hpp"
 
 namespace coolerpp::tools {
 
-template <typename N>
-[[nodiscard]] static Pixel<N> parse_pixel(const BinTable& bins, std::string_view line) {
-  auto next_token = [&]() {
-    assert(!line.empty());
-    const auto pos = line.find('\t');
-    auto tok = line.substr(0, pos);
-    line.remove_prefix(pos + 1);
-    return tok;
-  };
-
-  const auto chrom1 = next_token();
-  const auto start1 = internal::parse_numeric_or_throw<std::uint32_t>(next_token());
-  std::ignore = next_token();
-
-  const auto chrom2 = next_token();
-  const auto start2 = internal::parse_numeric_or_throw<std::uint32_t>(next_token());
-  std::ignore = next_token();
-
-  const auto count = internal::parse_numeric_or_throw<N>(next_token());
-  return Pixel<N>{{bins.at(chrom1, start1), bins.at(chrom2, start2)}, count};
-}
-
 [[nodiscard]] static ChromosomeSet import_chromosomes(const std::filesystem::path& chrom_sizes) {
   try {
     std::string line;
@@ -62,90 +40,95 @@ template <typename N>
   }
 }
 
-template <typename N>
-[[nodiscard]] static bool process_batch(const BinTable& bins, std::size_t batch_size,
-                                        std::vector<Pixel<N>>& buffer) {
-  buffer.clear();
-  std::string line;
-  try {
-    while (std::getline(std::cin, line)) {
-      if (buffer.size() == batch_size) {
-        return true;
-      }
-      buffer.emplace_back(parse_pixel<N>(bins, line));
-    }
-    return false;
-  } catch (const std::exception& e) {
-    throw std::runtime_error(
-        fmt::format(FMT_STRING("encountered error while processing the following line:\n"
-                               "\"{}\"\n"
-                               "Cause: {}"),
-                    line, e.what()));
+static void print_progress(std::size_t& pixels_processed, std::size_t batch_size) {
+  const auto new_pixels_processed = pixels_processed + batch_size;
+  if (new_pixels_processed / 1'000'000 != pixels_processed / 1'000'000) {
+    fmt::print(stderr, FMT_STRING("Read {}M pixels...\n"), new_pixels_processed / 1'000'000);
   }
+  pixels_processed = new_pixels_processed;
 }
 
-template <typename N, std::size_t chunk_size = std::numeric_limits<std::size_t>::max()>
-static std::string ingest_pixels(coolerpp::File&& clr, std::size_t batch_size = 1'000'000) {
-  batch_size = std::min(batch_size, chunk_size);
-  const auto& bins = clr.bins();
-
-  std::vector<Pixel<N>> write_buffer(batch_size);
-
-  std::size_t lines_processed = 0;
-  while (process_batch(bins, batch_size, write_buffer)) {
-    clr.append_pixels(write_buffer.begin(), write_buffer.end());
-    lines_processed += write_buffer.size();
-
-    if (lines_processed % std::max(batch_size, std::size_t(1'000'000)) == 0) {
-      fmt::print(stderr, FMT_STRING("Read {}M pixels...\n"), lines_processed / 1'000'000);
-    }
-    if (lines_processed >= chunk_size) {
-      break;
-    }
-  }
+// Pixels are parsed on a separate thread while the current batch is being written.
+// Consecutive lines mapping to the same pixel (e.g. validPairs, which list one interaction per
+// line) are aggregated before being appended. The last pixel of each batch is held back, as the
+// next batch may start with the same pixel
+template <typename N>
+static void ingest_pixels_sorted(coolerpp::File&& clr, io::PixelFormat format,
+                                 std::size_t batch_size = 1'000'000) {
+  io::PixelParser<N> parser("-", clr.bins(), format);
+  io::PixelBatch<N> buffer{};
+  buffer.reserve(batch_size + 1);
+
+  std::size_t pixels_processed = 0;
+  parser.for_each_batch(
+      [&](const io::PixelBatch<N>& batch) {
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+          if (!buffer.empty() && buffer.bin1_ids.back() == batch.bin1_ids[i] &&
+              buffer.bin2_ids.back() == batch.bin2_ids[i]) {
+            buffer.counts.back() += batch.counts[i];
+            continue;
+          }
+          buffer.bin1_ids.push_back(batch.bin1_ids[i]);
+          buffer.bin2_ids.push_back(batch.bin2_ids[i]);
+          buffer.counts.push_back(batch.counts[i]);
+        }
+
+        if (buffer.size() > 1) {
+          clr.append_pixels_columns(buffer.bin1_ids.data(), buffer.bin2_ids.data(),
+                                    buffer.counts.data(), buffer.size() - 1);
+          const auto bin1_id = buffer.bin1_ids.back();
+          const auto bin2_id = buffer.bin2_ids.back();
+          const auto count = buffer.counts.back();
+          buffer.clear();
+          buffer.bin1_ids.push_back(bin1_id);
+          buffer.bin2_ids.push_back(bin2_id);
+          buffer.counts.push_back(count);
+        }
+        print_progress(pixels_processed, batch.size());
+      },
+      batch_size);
+
+  clr.append_pixels_columns(buffer.bin1_ids.data(), buffer.bin2_ids.data(), buffer.counts.data(),
+                            buffer.size());
+}
 
-  if (!write_buffer.empty()) {
-    clr.append_pixels(write_buffer.begin(), write_buffer.end());
-    lines_processed += write_buffer.size();
-  }
-  if (lines_processed == 0) {
-    return "";
-  }
-  return clr.uri();
+template <typename N>
+static void ingest_pixels_unsorted(coolerpp::File&& clr, io::PixelFormat format,
+                                   std::size_t batch_size = 1'000'000) {
+  io::PixelParser<N> parser("-", clr.bins(), format);
+  utils::PixelSorter<N> sorter(clr);
+
+  std::size_t pixels_processed = 0;
+  parser.for_each_batch(
+      [&](const io::PixelBatch<N>& batch) {
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+          sorter.add(batch.bin1_ids[i], batch.bin2_ids[i], batch.counts[i]);
+        }
+        print_progress(pixels_processed, batch.size());
+      },
+      batch_size);
+
+  fmt::print(stderr, FMT_STRING("Merging {} sorted run(s)...\n"), sorter.num_runs());
+  sorter.finalize();
 }
 
 void load_subcmd(const LoadConfig& c) {
   auto chroms = import_chromosomes(c.path_to_chrom_sizes);
+  const auto format = io::parse_pixel_format(c.format);
   if (c.assume_sorted) {
     c.count_as_float
-        ? ingest_pixels<double>(File::create_new_cooler<double>(c.uri, chroms, c.bin_size, c.force))
-        : ingest_pixels<std::int32_t>(
-              File::create_new_cooler<std::int32_t>(c.uri, chroms, c.bin_size, c.force));
+        ? ingest_pixels_sorted<double>(
+              File::create_new_cooler<double>(c.uri, chroms, c.bin_size, c.force), format)
+        : ingest_pixels_sorted<std::int32_t>(
+              File::create_new_cooler<std::int32_t>(c.uri, chroms, c.bin_size, c.force), format);
     return;
   }
 
-  std::vector<std::string> uris{};
-  constexpr std::size_t chunk_size = 5'000'000;
-
-  for (std::size_t i = 0; true; ++i) {
-    const auto tmp_uri = fmt::format(FMT_STRING("/tmp/foo_{}.cool"), i);
-    uris.emplace_back(
-        c.count_as_float
-            ? ingest_pixels<double, chunk_size>(
-                  File::create_new_cooler<double>(tmp_uri, chroms, c.bin_size, c.force))
-            : ingest_pixels<std::int32_t, chunk_size>(
-                  File::create_new_cooler<std::int32_t>(tmp_uri, chroms, c.bin_size, c.force)));
-    if (uris.back().empty()) {
-      uris.pop_back();
-      break;
-    }
-    fmt::print(stderr, FMT_STRING("Done writing to tmp file {}...\n"), tmp_uri);
-  }
-
-  merge_subcmd(MergeConfig{uris, c.uri, c.count_as_float, c.force});
-  for (const auto& f : uris) {
-    std::filesystem::remove(f);
-  }
+  c.count_as_float
+      ? ingest_pixels_unsorted<double>(
+            File::create_new_cooler<double>(c.uri, chroms, c.bin_size, c.force), format)
+      : ingest_pixels_unsorted<std::int32_t>(
+            File::create_new_cooler<std::int32_t>(c.uri, chroms, c.bin_size, c.force), format);
 }
 
 }  // namespace coolerpp::tools
@@ -0,0 +1,414 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/balancing.hpp"
+#include "coolerpp/bin_table.hpp"
+#include "coolerpp/chromosome.hpp"
+#include "coolerpp/pixel_selector.hpp"
+
+namespace coolerpp::internal {
+
+template <typename N>
+constexpr const char *arrow_format() noexcept {
+  static_assert(std::is_arithmetic_v<N>);
+  if constexpr (std::is_floating_point_v<N>) {
+    static_assert(sizeof(N) == 4 || sizeof(N) == 8, "unsupported floating point type");
+    return sizeof(N) == 4 ? "f" : "g";
+  } else {
+    static_assert(sizeof(N) <= 8, "unsupported integral type");
+    constexpr auto is_signed = std::is_signed_v<N>;
+    switch (sizeof(N)) {
+      case 1:
+        return is_signed ? "c" : "C";
+      case 2:
+        return is_signed ? "s" : "S";
+      case 4:
+        return is_signed ? "i" : "I";
+      default:
+        return is_signed ? "l" : "L";
+    }
+  }
+}
+
+inline void release_arrow_schema(ArrowSchema *schema) noexcept {
+  assert(schema);
+  auto *data = static_cast<ArrowSchemaData *>(schema->private_data);
+  // Consumers are allowed to move children out of the parent: children that have been moved have
+  // their release callback set to nullptr
+  for (auto *child : data->child_ptrs) {
+    if (child->release) {
+      child->release(child);
+    }
+  }
+  if (data->dictionary && data->dictionary->release) {
+    data->dictionary->release(data->dictionary.get());
+  }
+  delete data;  // NOLINT(cppcoreguidelines-owning-memory)
+  schema->release = nullptr;
+}
+
+inline void release_arrow_array(ArrowArray *array) noexcept {
+  assert(array);
+  auto *data = static_cast<ArrowArrayData *>(array->private_data);
+  for (auto *child : data->child_ptrs) {
+    if (child->release) {
+      child->release(child);
+    }
+  }
+  if (data->dictionary && data->dictionary->release) {
+    data->dictionary->release(data->dictionary.get());
+  }
+  delete data;  // NOLINT(cppcoreguidelines-owning-memory)
+  array->release = nullptr;
+}
+
+inline ArrowSchemaData &init_arrow_schema(ArrowSchema *schema, std::string format,
+                                          std::string name, std::size_t num_children) {
+  assert(schema);
+  auto data = std::make_unique<ArrowSchemaData>();
+  data->format = std::move(format);
+  data->name = std::move(name);
+  data->children.resize(num_children);
+  for (auto &child : data->children) {
+    data->child_ptrs.push_back(&child);
+  }
+
+  *schema = ArrowSchema{};
+  schema->format = data->format.c_str();
+  schema->name = data->name.c_str();
+  schema->n_children = static_cast<std::int64_t>(num_children);
+  schema->children = data->child_ptrs.empty() ? nullptr : data->child_ptrs.data();
+  schema->release = &release_arrow_schema;
+  schema->private_data = data.release();
+
+  return *static_cast<ArrowSchemaData *>(schema->private_data);
+}
+
+inline ArrowArrayData &init_arrow_array(ArrowArray *array, std::int64_t length,
+                                        std::vector<const void *> buffers,
+                                        std::shared_ptr<const void> owner,
+                                        std::size_t num_children) {
+  assert(array);
+  auto data = std::make_unique<ArrowArrayData>();
+  data->buffers = std::move(buffers);
+  data->owner = std::move(owner);
+  data->children.resize(num_children);
+  for (auto &child : data->children) {
+    data->child_ptrs.push_back(&child);
+  }
+
+  *array = ArrowArray{};
+  array->length = length;
+  array->n_buffers = static_cast<std::int64_t>(data->buffers.size());
+  array->buffers = data->buffers.data();
+  array->n_children = static_cast<std::int64_t>(num_children);
+  array->children = data->child_ptrs.empty() ? nullptr : data->child_ptrs.data();
+  array->release = &release_arrow_array;
+  array->private_data = data.release();
+
+  return *static_cast<ArrowArrayData *>(array->private_data);
+}
+
+// Chromosome names stored as an Arrow utf8 array
+struct ArrowStringColumn {
+  std::vector<std::int32_t> offsets{0};
+  std::string data{};
+
+  explicit ArrowStringColumn(const ChromosomeSet &chroms) {
+    for (const auto &chrom : chroms) {
+      data.append(chrom.name());
+      if (data.size() > static_cast<std::size_t>((std::numeric_limits<std::int32_t>::max)())) {
+        throw std::runtime_error("chromosome names are too long to be exported as Arrow utf8");
+      }
+      offsets.push_back(static_cast<std::int32_t>(data.size()));
+    }
+  }
+
+  [[nodiscard]] std::int64_t size() const noexcept {
+    return static_cast<std::int64_t>(offsets.size() - 1);
+  }
+};
+
+inline void init_chrom_schema(ArrowSchema *schema, std::string name) {
+  auto &data = init_arrow_schema(schema, "i", std::move(name));
+  data.dictionary = std::make_unique<ArrowSchema>();
+  init_arrow_schema(data.dictionary.get(), "u", "");
+  schema->dictionary = data.dictionary.get();
+}
+
+inline void init_chrom_array(ArrowArray *array, const std::int32_t *chrom_ids, std::int64_t length,
+                             std::shared_ptr<const void> owner,
+                             const std::shared_ptr<const ArrowStringColumn> &chrom_names) {
+  auto &data = init_arrow_array(array, length, {nullptr, chrom_ids}, std::move(owner));
+  data.dictionary = std::make_unique<ArrowArray>();
+  init_arrow_array(data.dictionary.get(), chrom_names->size(),
+                   {nullptr, chrom_names->offsets.data(), chrom_names->data.data()},
+                   chrom_names);
+  array->dictionary = data.dictionary.get();
+}
+
+// Columns computed when joining pixels with the bin table
+struct JoinedPixelColumns {
+  std::vector<std::int32_t> chrom1{};
+  std::vector<std::uint32_t> start1{};
+  std::vector<std::uint32_t> end1{};
+  std::vector<std::int32_t> chrom2{};
+  std::vector<std::uint32_t> start2{};
+  std::vector<std::uint32_t> end2{};
+
+  JoinedPixelColumns(const BinTable &bins, const std::uint64_t *bin1_ids,
+                     const std::uint64_t *bin2_ids, std::size_t size) {
+    for (auto *v : {&chrom1, &chrom2}) {
+      v->reserve(size);
+    }
+    for (auto *v : {&start1, &end1, &start2, &end2}) {
+      v->reserve(size);
+    }
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (std::size_t i = 0; i < size; ++i) {
+      const auto bin1 = bins.at(bin1_ids[i]);
+      const auto bin2 = bins.at(bin2_ids[i]);
+      chrom1.push_back(static_cast<std::int32_t>(bin1.chrom().id()));
+      start1.push_back(bin1.start());
+      end1.push_back(bin1.end());
+      chrom2.push_back(static_cast<std::int32_t>(bin2.chrom().id()));
+      start2.push_back(bin2.start());
+      end2.push_back(bin2.end());
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  }
+};
+
+template <typename N>
+inline void export_pixel_array(PixelBlock<N> blk, const BinTable &bins, ArrowArray *out_array,
+                               const io::ArrowExportOptions &opts) {
+  assert(out_array);
+  const auto size = blk.size();
+  const auto length = static_cast<std::int64_t>(size);
+  const auto num_columns = 3 + (opts.join ? 6 : 0) + (opts.weights ? 1 : 0);
+
+  auto block = std::make_shared<const PixelBlock<N>>(std::move(blk));
+  const auto *bin1_ids = block->bin1_ids().data();
+  const auto *bin2_ids = block->bin2_ids().data();
+  const auto *counts = block->counts().data();
+
+  auto &data = init_arrow_array(out_array, length, {nullptr}, nullptr, num_columns);
+  try {
+    auto child = data.children.begin();
+    auto add_column = [&](const void *buff, std::shared_ptr<const void> owner) {
+      init_arrow_array(&*child++, length, {nullptr, buff}, std::move(owner));
+    };
+
+    add_column(bin1_ids, block);
+    add_column(bin2_ids, block);
+    add_column(counts, block);
+
+    if (opts.join) {
+      auto chrom_names = std::make_shared<const ArrowStringColumn>(bins.chromosomes());
+      auto cols = std::make_shared<const JoinedPixelColumns>(bins, bin1_ids, bin2_ids, size);
+      init_chrom_array(&*child++, cols->chrom1.data(), length, cols, chrom_names);
+      add_column(cols->start1.data(), cols);
+      add_column(cols->end1.data(), cols);
+      init_chrom_array(&*child++, cols->chrom2.data(), length, cols, chrom_names);
+      add_column(cols->start2.data(), cols);
+      add_column(cols->end2.data(), cols);
+    }
+
+    if (opts.weights) {
+      auto balanced = std::make_shared<std::vector<double>>(size);
+      opts.weights->balance(bin1_ids, bin2_ids, counts, size, balanced->data());
+      add_column(balanced->data(), balanced);
+    }
+    assert(child == data.children.end());
+  } catch (...) {
+    out_array->release(out_array);
+    throw;
+  }
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+struct ArrowPixelStreamData {
+  using SelectorT = PixelSelector<N, CHUNK_SIZE>;
+
+  SelectorT sel;
+  typename SelectorT::iterator first;
+  typename SelectorT::iterator last;
+  std::shared_ptr<const BinTable> bins;
+  io::ArrowExportOptions opts;
+  std::string last_error{};
+
+  ArrowPixelStreamData(SelectorT sel_, std::shared_ptr<const BinTable> bins_,
+                       io::ArrowExportOptions opts_)
+      : sel(std::move(sel_)),
+        first(sel.begin()),
+        last(sel.end()),
+        bins(std::move(bins_)),
+        opts(std::move(opts_)) {}
+
+  // Translate exceptions into the error codes expected by consumers of ArrowArrayStream
+  template <typename Fx>
+  [[nodiscard]] int try_call(Fx fx) noexcept {
+    try {
+      fx();
+      return 0;
+    } catch (const std::bad_alloc &e) {
+      this->last_error = e.what();
+      return ENOMEM;
+    } catch (const std::exception &e) {
+      this->last_error = e.what();
+    } catch (...) {
+      this->last_error = "unknown error";
+    }
+    return EIO;
+  }
+
+  static int get_schema(ArrowArrayStream *stream, ArrowSchema *out) noexcept {
+    auto &data = *static_cast<ArrowPixelStreamData *>(stream->private_data);
+    return data.try_call([&]() { io::export_pixel_schema<N>(data.opts, out); });
+  }
+
+  static int get_next(ArrowArrayStream *stream, ArrowArray *out) noexcept {
+    auto &data = *static_cast<ArrowPixelStreamData *>(stream->private_data);
+    return data.try_call([&]() {
+      if (data.first == data.last) {
+        // Mark the end of the stream
+        *out = ArrowArray{};
+        return;
+      }
+      export_pixel_array(data.first.read_block(CHUNK_SIZE), *data.bins, out, data.opts);
+    });
+  }
+
+  static const char *get_last_error(ArrowArrayStream *stream) noexcept {
+    const auto &data = *static_cast<ArrowPixelStreamData *>(stream->private_data);
+    return data.last_error.empty() ? nullptr : data.last_error.c_str();
+  }
+
+  static void release(ArrowArrayStream *stream) noexcept {
+    delete static_cast<ArrowPixelStreamData *>(stream->private_data);  // NOLINT
+    stream->release = nullptr;
+  }
+};
+
+}  // namespace coolerpp::internal
+
+namespace coolerpp::io {
+template <typename N>
+inline void export_pixel_schema(const ArrowExportOptions &opts, ArrowSchema *out_schema) {
+  assert(out_schema);
+  const auto num_columns = 3 + (opts.join ? 6 : 0) + (opts.weights ? 1 : 0);
+  auto &data = internal::init_arrow_schema(out_schema, "+s", "", num_columns);
+  try {
+    auto child = data.children.begin();
+    auto add_column = [&](const char *format, const char *name) {
+      internal::init_arrow_schema(&*child++, format, name);
+    };
+
+    add_column("L", "bin1_id");
+    add_column("L", "bin2_id");
+    add_column(internal::arrow_format<N>(), "count");
+    if (opts.join) {
+      internal::init_chrom_schema(&*child++, "chrom1");
+      add_column("I", "start1");
+      add_column("I", "end1");
+      internal::init_chrom_schema(&*child++, "chrom2");
+      add_column("I", "start2");
+      add_column("I", "end2");
+    }
+    if (opts.weights) {
+      add_column("g", "balanced");
+    }
+    assert(child == data.children.end());
+  } catch (...) {
+    out_schema->release(out_schema);
+    throw;
+  }
+}
+
+template <typename N>
+inline void export_pixels(PixelBlock<N> blk, const BinTable &bins, ArrowArray *out_array,
+                          ArrowSchema *out_schema, const ArrowExportOptions &opts) {
+  export_pixel_schema<N>(opts, out_schema);
+  try {
+    internal::export_pixel_array(std::move(blk), bins, out_array, opts);
+  } catch (...) {
+    out_schema->release(out_schema);
+    throw;
+  }
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline void export_pixel_stream(PixelSelector<N, CHUNK_SIZE> sel,
+                                std::shared_ptr<const BinTable> bins,
+                                ArrowArrayStream *out_stream, ArrowExportOptions opts) {
+  assert(out_stream);
+  assert(bins);
+  using StreamData = internal::ArrowPixelStreamData<N, CHUNK_SIZE>;
+
+  *out_stream = ArrowArrayStream{};
+  out_stream->get_schema = &StreamData::get_schema;
+  out_stream->get_next = &StreamData::get_next;
+  out_stream->get_last_error = &StreamData::get_last_error;
+  out_stream->release = &StreamData::release;
+  out_stream->private_data = new StreamData(std::move(sel), std::move(bins), std::move(opts));
+}
+
+inline void export_bins(const BinTable &bins, ArrowArray *out_array, ArrowSchema *out_schema) {
+  assert(out_array);
+  assert(out_schema);
+  *out_array = ArrowArray{};
+  auto &schema = internal::init_arrow_schema(out_schema, "+s", "", 3);
+  internal::init_chrom_schema(&schema.children[0], "chrom");
+  internal::init_arrow_schema(&schema.children[1], "I", "start");
+  internal::init_arrow_schema(&schema.children[2], "I", "end");
+
+  try {
+    struct BinColumns {
+      std::vector<std::int32_t> chrom{};
+      std::vector<std::uint32_t> start{};
+      std::vector<std::uint32_t> end{};
+    };
+
+    auto cols = std::make_shared<BinColumns>();
+    cols->chrom.reserve(bins.size());
+    cols->start.reserve(bins.size());
+    cols->end.reserve(bins.size());
+    for (const auto &bin : bins) {
+      cols->chrom.push_back(static_cast<std::int32_t>(bin.chrom().id()));
+      cols->start.push_back(bin.start());
+      cols->end.push_back(bin.end());
+    }
+
+    const auto length = static_cast<std::int64_t>(bins.size());
+    auto chrom_names = std::make_shared<const internal::ArrowStringColumn>(bins.chromosomes());
+    auto &data = internal::init_arrow_array(out_array, length, {nullptr}, nullptr, 3);
+    internal::init_chrom_array(&data.children[0], cols->chrom.data(), length, cols, chrom_names);
+    internal::init_arrow_array(&data.children[1], length, {nullptr, cols->start.data()}, cols);
+    internal::init_arrow_array(&data.children[2], length, {nullptr, cols->end.data()}, cols);
+  } catch (...) {
+    if (out_array->release) {
+      out_array->release(out_array);
+    }
+    out_schema->release(out_schema);
+    throw;
+  }
+}
+
+}  // namespace coolerpp::io
@@ -7,10 +7,18 @@
 #include <fmt/format.h>
 #include <tsl/hopscotch_map.h>
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace coolerpp {
 
@@ -19,6 +27,14 @@ inline Weights::Weights(std::vector<double> weights, Type type) noexcept
   assert(_type != Type::INFER && _type != Type::UNKNOWN);
 }
 
+inline Weights::Weights(std::vector<double> weights, Type type, Precision precision)
+    : Weights(std::move(weights), type) {
+  if (precision == Precision::FLOAT32) {
+    this->_factors = Weights::combine(this->_weights, this->_type);
+    this->_weights = std::vector<double>{};
+  }
+}
+
 inline Weights::Weights(std::vector<double> weights, std::string_view name)
     : Weights(std::move(weights), Weights::infer_type(name)) {
   assert(_type != Type::INFER);
@@ -37,7 +53,8 @@ inline Weights::Weights(const BinTable& bins, const Dataset& dset, bool rescale)
   }
 }
 
-inline Weights::Weights(const BinTable& bins, const Dataset& dset, Type type, bool rescale)
+inline Weights::Weights(const BinTable& bins, const Dataset& dset, Type type, bool rescale,
+                        Precision precision)
     : _weights(dset.read_all<std::vector<double>>()), _type(type) {
   if (_type == Type::INFER || type == Type::UNKNOWN) {
     if (dset.has_attribute("divisive_weights")) {
@@ -51,10 +68,17 @@ inline Weights::Weights(const BinTable& bins, const Dataset& dset, Type type, bo
     }
   }
 
-  if (!rescale || !dset.has_attribute("scale")) {
-    return;
+  if (rescale && dset.has_attribute("scale")) {
+    this->rescale(bins, dset);
+  }
+
+  if (precision == Precision::FLOAT32) {
+    this->_factors = Weights::combine(this->_weights, this->_type);
+    this->_weights = std::vector<double>{};
   }
+}
 
+inline void Weights::rescale(const BinTable& bins, const Dataset& dset) {
   const auto cis_only =
       dset.has_attribute("cis_only") ? dset.read_attribute<bool>("cis_only") : false;
 
@@ -84,19 +108,102 @@ inline Weights::Weights(const BinTable& bins, const Dataset& dset, Type type, bo
   }
 }
 
-inline Weights::operator bool() const noexcept { return !this->_weights.empty(); }
+inline std::vector<float> Weights::combine(const std::vector<double>& weights, Type type) {
+  assert(type == Type::MULTIPLICATIVE || type == Type::DIVISIVE);
+  std::vector<float> factors(weights.size());
+  if (type == Type::MULTIPLICATIVE) {
+    std::transform(weights.begin(), weights.end(), factors.begin(),
+                   [](const double w) { return static_cast<float>(w); });
+  } else {
+    std::transform(weights.begin(), weights.end(), factors.begin(),
+                   [](const double w) { return static_cast<float>(1.0 / w); });
+  }
+  return factors;
+}
+
+inline Weights::operator bool() const noexcept { return this->size() != 0; }
 
 inline double Weights::operator[](std::size_t i) const noexcept {
+  if (!this->_factors.empty()) {
+    assert(i < this->_factors.size());
+    const auto f = static_cast<double>(this->_factors[i]);
+    return this->_type == Type::DIVISIVE ? 1.0 / f : f;
+  }
   assert(i < this->_weights.size());
   return this->_weights[i];
 }
 
-inline double Weights::at(std::size_t i) const { return this->_weights.at(i); }
+inline double Weights::at(std::size_t i) const {
+  if (i >= this->size()) {
+    throw std::out_of_range(fmt::format(
+        FMT_STRING("weight index {} is out of range (num. of weights: {})"), i, this->size()));
+  }
+  return (*this)[i];
+}
 
-inline const std::vector<double>& Weights::operator()() const noexcept { return this->_weights; }
+template <typename N>
+inline void Weights::balance(const std::uint64_t* bin1_ids, const std::uint64_t* bin2_ids,
+                             const N* counts, std::size_t n,
+                             double* balanced_counts) const noexcept {
+  static_assert(std::is_arithmetic_v<N>);
+  assert(this->_type == Type::MULTIPLICATIVE || this->_type == Type::DIVISIVE);
+  const auto* weights = this->_weights.data();
+  const auto* factors = this->_factors.data();
+
+  // Loops are kept branch-free so that the compiler can vectorize them: NaN weights do not need to
+  // be special-cased, as NaNs propagate through multiplications and divisions
+  // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  if (!this->_factors.empty()) {
+    for (std::size_t i = 0; i < n; ++i) {
+      assert(bin1_ids[i] < this->_factors.size());
+      assert(bin2_ids[i] < this->_factors.size());
+      balanced_counts[i] = conditional_static_cast<double>(counts[i]) *
+                           static_cast<double>(factors[bin1_ids[i]]) *
+                           static_cast<double>(factors[bin2_ids[i]]);
+    }
+  } else if (this->_type == Type::MULTIPLICATIVE) {
+    for (std::size_t i = 0; i < n; ++i) {
+      assert(bin1_ids[i] < this->_weights.size());
+      assert(bin2_ids[i] < this->_weights.size());
+      balanced_counts[i] =
+          conditional_static_cast<double>(counts[i]) * weights[bin1_ids[i]] * weights[bin2_ids[i]];
+    }
+  } else {
+    for (std::size_t i = 0; i < n; ++i) {
+      assert(bin1_ids[i] < this->_weights.size());
+      assert(bin2_ids[i] < this->_weights.size());
+      balanced_counts[i] = conditional_static_cast<double>(counts[i]) *
+                           (1.0 / weights[bin1_ids[i]]) * (1.0 / weights[bin2_ids[i]]);
+    }
+  }
+  // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+inline const std::vector<double>& Weights::operator()() const {
+  if (this->precision() == Precision::FLOAT32) {
+    throw std::logic_error(
+        "raw weights are not available for weights loaded with FLOAT32 precision: use "
+        "Weights::factors() instead");
+  }
+  return this->_weights;
+}
+
+inline const std::vector<float>& Weights::factors() const noexcept { return this->_factors; }
 
 constexpr auto Weights::type() const noexcept -> Type { return this->_type; }
 
+inline auto Weights::precision() const noexcept -> Precision {
+  return this->_factors.empty() ? Precision::FLOAT64 : Precision::FLOAT32;
+}
+
+inline std::size_t Weights::size() const noexcept {
+  return this->_factors.empty() ? this->_weights.size() : this->_factors.size();
+}
+
+inline std::size_t Weights::memory_usage() const noexcept {
+  return (this->_weights.capacity() * sizeof(double)) + (this->_factors.capacity() * sizeof(float));
+}
+
 inline auto Weights::infer_type(const Dataset& dset) -> Type {
   auto path = dset.uri();
   auto pos = path.rfind('/');
@@ -170,6 +277,64 @@ inline auto Balancer<N, CHUNK_SIZE>::cend() const -> iterator {
   return iterator{this->_last, this->_weights};
 }
 
+template <typename N, std::size_t CHUNK_SIZE>
+template <typename BlockOp>
+inline void Balancer<N, CHUNK_SIZE>::for_each_block(BlockOp op,
+                                                    std::size_t max_block_size) const {
+  assert(this->_weights);
+  auto first = this->_first;
+  while (first < this->_last) {
+    op(Block{first.read_block(this->_last, max_block_size), *this->_weights});
+  }
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto Balancer<N, CHUNK_SIZE>::read_batch(std::size_t max_block_size) const
+    -> std::vector<Block> {
+  std::vector<Block> blocks{};
+  this->for_each_block([&](Block blk) { blocks.emplace_back(std::move(blk)); }, max_block_size);
+  return blocks;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline Balancer<N, CHUNK_SIZE>::Block::Block(PixelBlock<N> pixels, const Weights& weights)
+    : _pixels(std::move(pixels)), _counts(_pixels.size()) {
+  weights.balance(this->_pixels.bin1_ids().data(), this->_pixels.bin2_ids().data(),
+                  this->_pixels.counts().data(), this->_pixels.size(), this->_counts.data());
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline std::size_t Balancer<N, CHUNK_SIZE>::Block::size() const noexcept {
+  return this->_counts.size();
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline bool Balancer<N, CHUNK_SIZE>::Block::empty() const noexcept {
+  return this->size() == 0;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto Balancer<N, CHUNK_SIZE>::Block::bin1_ids() const noexcept
+    -> internal::Span<std::uint64_t> {
+  return this->_pixels.bin1_ids();
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto Balancer<N, CHUNK_SIZE>::Block::bin2_ids() const noexcept
+    -> internal::Span<std::uint64_t> {
+  return this->_pixels.bin2_ids();
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto Balancer<N, CHUNK_SIZE>::Block::counts() const noexcept -> internal::Span<double> {
+  return {this->_counts.data(), this->_counts.size()};
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto Balancer<N, CHUNK_SIZE>::Block::raw_pixels() const noexcept -> const PixelBlock<N>& {
+  return this->_pixels;
+}
+
 template <typename N, std::size_t CHUNK_SIZE>
 inline Balancer<N, CHUNK_SIZE>::iterator::iterator(
     typename PixelSelector<N, CHUNK_SIZE>::iterator it, std::shared_ptr<const Weights> weights)
@@ -218,16 +383,11 @@ constexpr bool Balancer<N, CHUNK_SIZE>::iterator::operator>=(
 template <typename N, std::size_t CHUNK_SIZE>
 inline auto Balancer<N, CHUNK_SIZE>::iterator::operator*() const -> const_reference {
   const auto& raw_pixel = *this->_it;
-  const auto w1 = (*this->_weights)[raw_pixel.coords.bin1.id()];
-  const auto w2 = (*this->_weights)[raw_pixel.coords.bin2.id()];
-  if (this->_weights->type() == Weights::Type::MULTIPLICATIVE) {
-    this->_value = value_type{std::move(raw_pixel.coords),
-                              conditional_static_cast<double>(raw_pixel.count) * w1 * w2};
-  } else {
-    this->_value =
-        value_type{std::move(raw_pixel.coords),
-                   conditional_static_cast<double>(raw_pixel.count) * (1.0 / w1) * (1.0 / w2)};
-  }
+  const auto bin1_id = raw_pixel.coords.bin1.id();
+  const auto bin2_id = raw_pixel.coords.bin2.id();
+  double count{};
+  this->_weights->balance(&bin1_id, &bin2_id, &raw_pixel.count, 1, &count);
+  this->_value = value_type{std::move(raw_pixel.coords), count};
   return this->_value;
 }
 
@@ -252,4 +412,204 @@ inline auto Balancer<N, CHUNK_SIZE>::iterator::operator++(int) -> iterator {
   return it;
 }
 
+inline ObservedOverExpectedOp::ObservedOverExpectedOp(std::shared_ptr<const Weights> weights,
+                                                      std::vector<double> expected,
+                                                      bool log_transform)
+    : _weights(std::move(weights)),
+      _expected(std::make_shared<const std::vector<double>>(std::move(expected))),
+      _log_transform(log_transform) {}
+
+inline const Weights* ObservedOverExpectedOp::weights() const noexcept {
+  return this->_weights.get();
+}
+
+inline const std::vector<double>& ObservedOverExpectedOp::expected() const noexcept {
+  return *this->_expected;
+}
+
+inline bool ObservedOverExpectedOp::log_transform() const noexcept { return this->_log_transform; }
+
+template <typename N>
+inline double ObservedOverExpectedOp::operator()(std::uint64_t bin1_id, std::uint64_t bin2_id,
+                                                 N count) const noexcept {
+  double value{};
+  (*this)(&bin1_id, &bin2_id, &count, 1, &value);
+  return value;
+}
+
+template <typename N>
+inline void ObservedOverExpectedOp::operator()(const std::uint64_t* bin1_ids,
+                                               const std::uint64_t* bin2_ids, const N* counts,
+                                               std::size_t n, double* out) const noexcept {
+  static_assert(std::is_arithmetic_v<N>);
+  // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  if (this->_weights) {
+    this->_weights->balance(bin1_ids, bin2_ids, counts, n, out);
+  } else {
+    std::transform(counts, counts + n, out,
+                   [](const N count) { return conditional_static_cast<double>(count); });
+  }
+
+  const auto& expected = this->expected();
+  constexpr auto nan = std::numeric_limits<double>::quiet_NaN();
+  for (std::size_t i = 0; i < n; ++i) {
+    const auto diag = bin2_ids[i] >= bin1_ids[i] ? bin2_ids[i] - bin1_ids[i]
+                                                 : bin1_ids[i] - bin2_ids[i];
+    const auto exp_value = diag < expected.size() ? expected[diag] : nan;
+    // Pixels with unknown or null expected values cannot be normalized
+    out[i] = std::isfinite(exp_value) && exp_value != 0 ? out[i] / exp_value : nan;
+  }
+
+  if (this->_log_transform) {
+    std::transform(out, out + n, out, [](const double x) { return std::log2(x); });
+  }
+  // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline ObservedOverExpected<N, CHUNK_SIZE>::ObservedOverExpected(
+    const PixelSelector<N, CHUNK_SIZE>& selector, std::shared_ptr<const Weights> weights,
+    std::vector<double> expected, bool log_transform)
+    : ObservedOverExpected(
+          selector.begin(), selector.end(),
+          ObservedOverExpectedOp{std::move(weights), std::move(expected), log_transform}) {}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline ObservedOverExpected<N, CHUNK_SIZE>::ObservedOverExpected(
+    typename PixelSelector<N, CHUNK_SIZE>::iterator first,
+    typename PixelSelector<N, CHUNK_SIZE>::iterator last, ObservedOverExpectedOp op)
+    : _first(std::move(first)),
+      _last(std::move(last)),
+      _op(std::make_shared<const ObservedOverExpectedOp>(std::move(op))) {}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline const ObservedOverExpectedOp& ObservedOverExpected<N, CHUNK_SIZE>::op() const noexcept {
+  return *this->_op;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto ObservedOverExpected<N, CHUNK_SIZE>::begin() const -> iterator {
+  return this->cbegin();
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto ObservedOverExpected<N, CHUNK_SIZE>::end() const -> iterator {
+  return this->cend();
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto ObservedOverExpected<N, CHUNK_SIZE>::cbegin() const -> iterator {
+  return iterator{this->_first, this->_op};
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto ObservedOverExpected<N, CHUNK_SIZE>::cend() const -> iterator {
+  return iterator{this->_last, this->_op};
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+template <typename BlockOp>
+inline void ObservedOverExpected<N, CHUNK_SIZE>::for_each_block(BlockOp op,
+                                                                std::size_t max_block_size) const {
+  auto first = this->_first;
+  while (first < this->_last) {
+    op(Block{first.read_block(this->_last, max_block_size), *this->_op});
+  }
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto ObservedOverExpected<N, CHUNK_SIZE>::read_batch(std::size_t max_block_size) const
+    -> std::vector<Block> {
+  std::vector<Block> blocks{};
+  this->for_each_block([&](Block blk) { blocks.emplace_back(std::move(blk)); }, max_block_size);
+  return blocks;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline ObservedOverExpected<N, CHUNK_SIZE>::Block::Block(PixelBlock<N> pixels,
+                                                         const ObservedOverExpectedOp& op)
+    : _pixels(std::move(pixels)), _counts(_pixels.size()) {
+  op(this->_pixels.bin1_ids().data(), this->_pixels.bin2_ids().data(),
+     this->_pixels.counts().data(), this->_pixels.size(), this->_counts.data());
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline std::size_t ObservedOverExpected<N, CHUNK_SIZE>::Block::size() const noexcept {
+  return this->_counts.size();
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline bool ObservedOverExpected<N, CHUNK_SIZE>::Block::empty() const noexcept {
+  return this->size() == 0;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto ObservedOverExpected<N, CHUNK_SIZE>::Block::bin1_ids() const noexcept
+    -> internal::Span<std::uint64_t> {
+  return this->_pixels.bin1_ids();
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto ObservedOverExpected<N, CHUNK_SIZE>::Block::bin2_ids() const noexcept
+    -> internal::Span<std::uint64_t> {
+  return this->_pixels.bin2_ids();
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto ObservedOverExpected<N, CHUNK_SIZE>::Block::counts() const noexcept
+    -> internal::Span<double> {
+  return {this->_counts.data(), this->_counts.size()};
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto ObservedOverExpected<N, CHUNK_SIZE>::Block::raw_pixels() const noexcept
+    -> const PixelBlock<N>& {
+  return this->_pixels;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline ObservedOverExpected<N, CHUNK_SIZE>::iterator::iterator(
+    typename PixelSelector<N, CHUNK_SIZE>::iterator it,
+    std::shared_ptr<const ObservedOverExpectedOp> op)
+    : _it(std::move(it)), _op(std::move(op)) {}
+
+template <typename N, std::size_t CHUNK_SIZE>
+constexpr bool ObservedOverExpected<N, CHUNK_SIZE>::iterator::operator==(
+    const ObservedOverExpected::iterator& other) const noexcept {
+  return this->_it == other._it && this->_op == other._op;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+constexpr bool ObservedOverExpected<N, CHUNK_SIZE>::iterator::operator!=(
+    const ObservedOverExpected::iterator& other) const noexcept {
+  return !(*this == other);
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto ObservedOverExpected<N, CHUNK_SIZE>::iterator::operator*() const -> const_reference {
+  const auto& raw_pixel = *this->_it;
+  const auto value =
+      (*this->_op)(raw_pixel.coords.bin1.id(), raw_pixel.coords.bin2.id(), raw_pixel.count);
+  this->_value = value_type{std::move(raw_pixel.coords), value};
+  return this->_value;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto ObservedOverExpected<N, CHUNK_SIZE>::iterator::operator->() const -> const_pointer {
+  return &(*(*this));
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto ObservedOverExpected<N, CHUNK_SIZE>::iterator::operator++() -> iterator& {
+  ++this->_it;
+  return *this;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto ObservedOverExpected<N, CHUNK_SIZE>::iterator::operator++(int) -> iterator {
+  auto it = *this;
+  std::ignore = ++(*this);
+  return it;
+}
+
 }  // namespace coolerpp
@@ -8,7 +8,9 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <limits>
 #include <stdexcept>
 #include <string>
@@ -82,10 +84,27 @@ constexpr bool Bin::has_null_id() const noexcept { return this->id() == Bin::nul
 inline BinTable::BinTable(ChromosomeSet chroms, std::uint32_t bin_size)
     : _chroms(std::move(chroms)),
       _num_bins_prefix_sum(compute_num_bins_prefix_sum(_chroms, bin_size)),
+      _chrom_lut_shift(compute_chrom_lut_shift(_num_bins_prefix_sum)),
       _bin_size(bin_size) {
+  _chrom_lut = compute_chrom_lut(_num_bins_prefix_sum, _chrom_lut_shift);
   assert(bin_size != 0);
 }
 
+inline BinTable::BinTable(ChromosomeSet chroms, std::vector<std::uint32_t> start_pos,
+                          std::vector<std::uint32_t> end_pos)
+    : _chroms(std::move(chroms)),
+      _num_bins_prefix_sum(compute_num_bins_prefix_sum(_chroms, start_pos, end_pos)),
+      _chrom_lut_shift(compute_chrom_lut_shift(_num_bins_prefix_sum)),
+      _bin_size(0),
+      _type(Type::VARIABLE),
+      _bin_starts(std::move(start_pos)),
+      _bin_ends(std::move(end_pos)),
+      _bin_end_samples(compute_bin_end_samples(_num_bins_prefix_sum, _bin_ends)),
+      _bin_end_samples_prefix_sum(compute_bin_end_samples_prefix_sum(_num_bins_prefix_sum)) {
+  _chrom_lut = compute_chrom_lut(_num_bins_prefix_sum, _chrom_lut_shift);
+  assert(_bin_end_samples.size() == _bin_end_samples_prefix_sum.back());
+}
+
 template <typename ChromIt>
 inline BinTable::BinTable(ChromIt first_chrom, ChromIt last_chrom, std::uint32_t bin_size)
     : BinTable(ChromosomeSet(first_chrom, last_chrom), bin_size) {}
@@ -108,12 +127,23 @@ inline std::size_t BinTable::num_chromosomes() const { return this->_chroms.size
 
 constexpr std::uint32_t BinTable::bin_size() const noexcept { return this->_bin_size; }
 
+constexpr auto BinTable::type() const noexcept -> Type { return this->_type; }
+
 constexpr const ChromosomeSet &BinTable::chromosomes() const noexcept { return this->_chroms; }
 
 constexpr const std::vector<std::uint64_t> &BinTable::num_bin_prefix_sum() const noexcept {
   return this->_num_bins_prefix_sum;
 }
 
+inline std::size_t BinTable::memory_usage() const noexcept {
+  return (this->_num_bins_prefix_sum.capacity() * sizeof(std::uint64_t)) +
+         (this->_chrom_lut.capacity() * sizeof(std::uint32_t)) +
+         (this->_bin_starts.capacity() * sizeof(std::uint32_t)) +
+         (this->_bin_ends.capacity() * sizeof(std::uint32_t)) +
+         (this->_bin_end_samples.capacity() * sizeof(std::uint32_t)) +
+         (this->_bin_end_samples_prefix_sum.capacity() * sizeof(std::size_t));
+}
+
 constexpr auto BinTable::begin() const -> iterator { return iterator(*this); }
 constexpr auto BinTable::end() const -> iterator { return iterator::make_end_iterator(*this); }
 constexpr auto BinTable::cbegin() const -> iterator { return this->begin(); }
@@ -140,8 +170,56 @@ inline BinTableConcrete BinTable::concretize() const {
   return BinTableConcrete{chroms, starts, ends};
 }
 
+inline void BinTable::fill_columns(std::uint64_t first_bin_id, std::size_t n,
+                                   std::uint32_t *chrom_ids, std::uint32_t *starts,
+                                   std::uint32_t *ends) const {
+  if (n == 0) {
+    return;
+  }
+  if (first_bin_id + n > this->size()) {
+    throw std::out_of_range(
+        fmt::format(FMT_STRING("bin ids [{}, {}) are out of range: table has {} bins"),
+                    first_bin_id, first_bin_id + n, this->size()));
+  }
+
+  // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  if (this->_type == Type::VARIABLE) {
+    const auto offset = static_cast<std::ptrdiff_t>(first_bin_id);
+    std::copy_n(this->_bin_starts.begin() + offset, n, starts);
+    std::copy_n(this->_bin_ends.begin() + offset, n, ends);
+  }
+
+  std::size_t i = 0;
+  for (auto chrom_idx = this->map_to_chrom_idx(first_bin_id); i < n; ++chrom_idx) {
+    const auto &chrom = this->_chroms[chrom_idx];
+    const auto chrom_offset = this->_num_bins_prefix_sum[chrom_idx];
+    const auto first_rel_bin_id = first_bin_id + i - chrom_offset;
+    const auto count = static_cast<std::size_t>(
+        (std::min)(this->_num_bins_prefix_sum[chrom_idx + 1] - chrom_offset - first_rel_bin_id,
+                   static_cast<std::uint64_t>(n - i)));
+
+    std::fill_n(chrom_ids + i, count, chrom.id());
+    if (this->_type == Type::FIXED) {
+      auto start = static_cast<std::uint32_t>(first_rel_bin_id * this->_bin_size);
+      for (std::size_t j = i; j < i + count; ++j) {
+        starts[j] = start;
+        start += this->_bin_size;
+        ends[j] = (std::min)(start, chrom.size());
+      }
+    }
+    i += count;
+  }
+  // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
 inline bool BinTable::operator==(const BinTable &other) const {
-  return this->_bin_size == other._bin_size && this->_chroms == other._chroms;
+  // clang-format off
+  return this->_type == other._type &&
+         this->_bin_size == other._bin_size &&
+         this->_chroms == other._chroms &&
+         this->_bin_starts == other._bin_starts &&
+         this->_bin_ends == other._bin_ends;
+  // clang-format on
 }
 inline bool BinTable::operator!=(const BinTable &other) const { return !(*this == other); }
 
@@ -153,6 +231,15 @@ inline BinTable BinTable::subset(const Chromosome &chrom) const {
     throw std::out_of_range(fmt::format(FMT_STRING("chromosome \"{}\" not found"), chrom.name()));
   }
 #endif
+  if (this->_type == Type::VARIABLE) {
+    const auto first_bin = static_cast<std::ptrdiff_t>(this->_num_bins_prefix_sum[chrom.id()]);
+    const auto last_bin = static_cast<std::ptrdiff_t>(this->_num_bins_prefix_sum[chrom.id() + 1]);
+    return {ChromosomeSet{chrom},
+            std::vector<std::uint32_t>(this->_bin_starts.begin() + first_bin,
+                                       this->_bin_starts.begin() + last_bin),
+            std::vector<std::uint32_t>(this->_bin_ends.begin() + first_bin,
+                                       this->_bin_ends.begin() + last_bin)};
+  }
   return {ChromosomeSet{chrom}, this->_bin_size};
 }
 inline BinTable BinTable::subset(std::string_view chrom_name) const {
@@ -189,25 +276,20 @@ inline auto BinTable::find_overlap(std::uint32_t chrom_id, std::uint32_t start,
 }
 
 inline Bin BinTable::at(std::uint64_t bin_id) const {
-  // I tried benchmarking linear search as well as std::set (including third-party implementations).
-  // Binary search and find on flat vectors are always faster for a reasonable number of chromosomes
-  // (e.g. 5-100). and have fairly similar performance, thus I decided to use binary search over
-  // linear search to avoid severe perf. degradation for genomes with many chromosomes (e.g. draft
-  // assemblies)
-  auto match = std::upper_bound(this->_num_bins_prefix_sum.begin(),
-                                this->_num_bins_prefix_sum.end(), bin_id);
-
-  if (match == this->_num_bins_prefix_sum.end()) {
+  if (bin_id >= this->size()) {
     throw std::out_of_range(fmt::format(FMT_STRING("bin id {} not found: out of range"), bin_id));
   }
-  assert(match != this->_num_bins_prefix_sum.begin());
 
-  const auto chrom_id =
-      static_cast<std::uint32_t>(std::distance(this->_num_bins_prefix_sum.begin(), --match));
-  return this->at_hint(bin_id, this->_chroms[chrom_id]);
+  return this->at_hint(bin_id, this->_chroms[this->map_to_chrom_idx(bin_id)]);
 }
 
 inline Bin BinTable::at_hint(std::uint64_t bin_id, const Chromosome &chrom) const {
+  if (this->_type == Type::VARIABLE) {
+    const auto i = static_cast<std::size_t>(bin_id);
+    assert(i < this->_bin_starts.size());
+    return {bin_id, chrom, this->_bin_starts[i], this->_bin_ends[i]};
+  }
+
   const auto offset = this->_num_bins_prefix_sum[chrom.id()];
   const auto relative_bin_id = bin_id - offset;
   const auto start = static_cast<uint32_t>(relative_bin_id * this->bin_size());
@@ -251,6 +333,10 @@ inline std::uint64_t BinTable::map_to_bin_id(const Chromosome &chrom, std::uint3
         FMT_STRING("position is greater than chromosome size: {} > {}"), pos, chrom.size()));
   }
 
+  if (this->_type == Type::VARIABLE) {
+    return this->map_to_bin_id_variable(chrom.id(), pos);
+  }
+
   const auto bin_offset =
       this->_num_bins_prefix_sum[chrom.id()] - this->_num_bins_prefix_sum.front();
 
@@ -281,6 +367,155 @@ inline std::vector<std::uint64_t> BinTable::compute_num_bins_prefix_sum(const Ch
   return prefix_sum;
 }
 
+inline std::vector<std::uint64_t> BinTable::compute_num_bins_prefix_sum(
+    const ChromosomeSet &chroms, const std::vector<std::uint32_t> &start_pos,
+    const std::vector<std::uint32_t> &end_pos) {
+  if (start_pos.size() != end_pos.size()) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("start and end position vectors have different sizes: {} != {}"),
+                    start_pos.size(), end_pos.size()));
+  }
+
+  std::vector<std::uint64_t> prefix_sum{};
+  prefix_sum.reserve(chroms.size() + 1);
+  prefix_sum.push_back(0);
+
+  // Bins are assigned to chromosomes by walking the bins until the end of each chromosome is
+  // reached. Bins are required to cover chromosomes without gaps or overlaps
+  std::size_t i = 0;
+  for (const auto &chrom : chroms) {
+    std::uint32_t prev_end = 0;
+    for (; i < start_pos.size() && prev_end != chrom.size(); ++i) {
+      if (start_pos[i] != prev_end || end_pos[i] <= start_pos[i] || end_pos[i] > chrom.size()) {
+        throw std::runtime_error(fmt::format(
+            FMT_STRING("invalid bin #{}: expected a bin starting at {}:{}, found {}:{}-{}"), i,
+            chrom.name(), prev_end, chrom.name(), start_pos[i], end_pos[i]));
+      }
+      prev_end = end_pos[i];
+    }
+    if (prev_end != chrom.size()) {
+      throw std::runtime_error(fmt::format(
+          FMT_STRING("bins do not cover chromosome {}: last bin ends at {}, expected {}"),
+          chrom.name(), prev_end, chrom.size()));
+    }
+    prefix_sum.push_back(static_cast<std::uint64_t>(i));
+  }
+
+  if (i != start_pos.size()) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("found {} bin(s) past the end of the last chromosome"),
+                    start_pos.size() - i));
+  }
+
+  return prefix_sum;
+}
+
+inline std::uint32_t BinTable::compute_chrom_lut_shift(
+    const std::vector<std::uint64_t> &prefix_sum) {
+  if (prefix_sum.size() < 2) {
+    return 0;
+  }
+
+  // Pick the smallest bucket size such that the LUT has at most ~4 entries per chromosome:
+  // this keeps the LUT small enough to fit in cache while making sure that buckets spanning
+  // multiple chromosomes are rare
+  const auto num_bins = prefix_sum.back();
+  const auto max_buckets = std::uint64_t(4) * (prefix_sum.size() - 1);
+  std::uint32_t shift = 0;
+  while ((num_bins >> shift) > max_buckets) {
+    ++shift;
+  }
+  return shift;
+}
+
+inline std::vector<std::uint32_t> BinTable::compute_chrom_lut(
+    const std::vector<std::uint64_t> &prefix_sum, std::uint32_t shift) {
+  if (prefix_sum.size() < 2) {
+    return {};
+  }
+
+  const auto num_bins = prefix_sum.back();
+  const auto num_buckets = static_cast<std::size_t>((num_bins >> shift) + 1);
+  std::vector<std::uint32_t> lut(num_buckets);
+
+  std::uint32_t chrom_idx = 0;
+  for (std::size_t i = 0; i < lut.size(); ++i) {
+    const auto first_bin_id = static_cast<std::uint64_t>(i) << shift;
+    while (chrom_idx + 2 < prefix_sum.size() && first_bin_id >= prefix_sum[chrom_idx + 1]) {
+      ++chrom_idx;
+    }
+    lut[i] = chrom_idx;
+  }
+  return lut;
+}
+
+inline std::vector<std::size_t> BinTable::compute_bin_end_samples_prefix_sum(
+    const std::vector<std::uint64_t> &prefix_sum) {
+  std::vector<std::size_t> samples_prefix_sum(prefix_sum.size(), 0);
+  for (std::size_t i = 1; i < prefix_sum.size(); ++i) {
+    const auto num_bins = static_cast<std::size_t>(prefix_sum[i] - prefix_sum[i - 1]);
+    const auto num_blocks = (num_bins + bin_index_block_size - 1) / bin_index_block_size;
+    samples_prefix_sum[i] = samples_prefix_sum[i - 1] + num_blocks;
+  }
+  return samples_prefix_sum;
+}
+
+inline std::vector<std::uint32_t> BinTable::compute_bin_end_samples(
+    const std::vector<std::uint64_t> &prefix_sum, const std::vector<std::uint32_t> &end_pos) {
+  std::vector<std::uint32_t> samples{};
+  for (std::size_t i = 1; i < prefix_sum.size(); ++i) {
+    const auto first_bin = static_cast<std::size_t>(prefix_sum[i - 1]);
+    const auto last_bin = static_cast<std::size_t>(prefix_sum[i]);
+    // Blocks never span multiple chromosomes
+    for (auto j = first_bin; j < last_bin; j += bin_index_block_size) {
+      const auto last_block_bin = (std::min)(j + bin_index_block_size, last_bin) - 1;
+      samples.push_back(end_pos[last_block_bin]);
+    }
+  }
+  return samples;
+}
+
+inline std::uint64_t BinTable::map_to_bin_id_variable(std::uint32_t chrom_id,
+                                                      std::uint32_t pos) const noexcept {
+  assert(this->_type == Type::VARIABLE);
+  const auto first_bin = static_cast<std::size_t>(this->_num_bins_prefix_sum[chrom_id]);
+  const auto last_bin = static_cast<std::size_t>(this->_num_bins_prefix_sum[chrom_id + 1]);
+  assert(first_bin != last_bin);
+
+  // Find the first block of bins ending after pos
+  const auto first_sample =
+      this->_bin_end_samples.begin() +
+      static_cast<std::ptrdiff_t>(this->_bin_end_samples_prefix_sum[chrom_id]);
+  const auto last_sample =
+      this->_bin_end_samples.begin() +
+      static_cast<std::ptrdiff_t>(this->_bin_end_samples_prefix_sum[chrom_id + 1]);
+  const auto block_it = std::upper_bound(first_sample, last_sample, pos);
+  if (block_it == last_sample) {
+    // pos is equal to the chromosome size
+    return static_cast<std::uint64_t>(last_bin - 1);
+  }
+
+  // Find the first bin in the block ending after pos
+  const auto block_idx = static_cast<std::size_t>(std::distance(first_sample, block_it));
+  const auto first_block_bin = first_bin + (block_idx * bin_index_block_size);
+  const auto last_block_bin = (std::min)(first_block_bin + bin_index_block_size, last_bin);
+  const auto bin_it =
+      std::upper_bound(this->_bin_ends.begin() + static_cast<std::ptrdiff_t>(first_block_bin),
+                       this->_bin_ends.begin() + static_cast<std::ptrdiff_t>(last_block_bin), pos);
+  assert(bin_it != this->_bin_ends.end());
+
+  return static_cast<std::uint64_t>(std::distance(this->_bin_ends.begin(), bin_it));
+}
+
+inline std::uint32_t BinTable::map_to_chrom_idx(std::uint64_t bin_id) const noexcept {
+  assert(bin_id < this->size());
+  auto chrom_idx = this->_chrom_lut[static_cast<std::size_t>(bin_id >> this->_chrom_lut_shift)];
+  while (bin_id >= this->_num_bins_prefix_sum[chrom_idx + 1]) {
+    ++chrom_idx;
+  }
+  return chrom_idx;
+}
+
 constexpr BinTable::iterator::iterator(const BinTable &bin_table) noexcept
     : _bin_table{&bin_table} {}
 
@@ -336,6 +571,12 @@ inline auto BinTable::iterator::operator*() const -> value_type {
   assert(this->_bin_table);
 
   const auto &chrom = this->chromosome();
+  if (this->_bin_table->_type == Type::VARIABLE) {
+    const auto i = static_cast<std::size_t>(
+        this->_bin_table->_num_bins_prefix_sum[this->_chrom_id] + this->_idx);
+    return value_type{chrom, this->_bin_table->_bin_starts[i], this->_bin_table->_bin_ends[i]};
+  }
+
   const auto bin_size = this->bin_size();
 
   const auto start = (std::min)(static_cast<std::uint32_t>(this->_idx) * bin_size, chrom.size());
@@ -385,6 +626,9 @@ inline auto BinTable::iterator::operator+=(std::size_t i) -> iterator & {
   this->_chrom_id++;
   i -= (num_bins - this->_idx);
   this->_idx = 0;
+  if (this->_chrom_id == this->num_chromosomes()) {
+    *this = make_end_iterator(*this->_bin_table);
+  }
   return *this += i;
 }
 
@@ -481,6 +725,10 @@ inline const Chromosome &BinTable::iterator::chromosome(std::uint32_t chrom_id)
 
 inline std::uint64_t BinTable::iterator::compute_num_bins() const noexcept {
   assert(this->_bin_table);
+  if (this->_bin_table->_type == Type::VARIABLE) {
+    const auto &prefix_sum = this->_bin_table->_num_bins_prefix_sum;
+    return prefix_sum[this->_chrom_id + 1] - prefix_sum[this->_chrom_id];
+  }
 
   const auto chrom_size = this->chromosome().size();
   const auto bin_size = this->bin_size();
@@ -0,0 +1,144 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "coolerpp/memory_budget.hpp"
+
+namespace coolerpp::internal {
+
+template <typename T>
+inline BufferPool<T> &BufferPool<T>::local() {
+  thread_local BufferPool<T> pool{};
+  return pool;
+}
+
+template <typename T>
+inline BufferPool<T>::~BufferPool() noexcept {
+  this->clear();
+}
+
+template <typename T>
+inline auto BufferPool<T>::acquire(std::size_t capacity, std::shared_ptr<std::vector<T>> buff)
+    -> std::shared_ptr<std::vector<T>> {
+  this->release_idle_buffers_if_trimmed();
+
+  Entry *entry = nullptr;
+  if (buff) {
+    auto it = std::find_if(this->_buffers.begin(), this->_buffers.end(),
+                           [&](const auto &e) { return e.buff == buff; });
+    const auto pooled = it != this->_buffers.end();
+    if (!is_exclusive(buff, pooled)) {
+      // Dropping our reference may make buff available again, so it is important to do this
+      // before looking for a free buffer
+      buff.reset();
+    } else if (pooled) {
+      entry = &*it;
+    }
+  }
+
+  if (!buff) {
+    auto it = std::find_if(this->_buffers.begin(), this->_buffers.end(),
+                           [](const auto &e) { return is_exclusive(e.buff, true); });
+    if (it != this->_buffers.end()) {
+      buff = it->buff;
+      entry = &*it;
+    } else {
+      buff = std::make_shared<std::vector<T>>();
+      if (this->_buffers.size() < this->_max_size) {
+        this->_buffers.push_back(Entry{buff, 0});
+        entry = &this->_buffers.back();
+      }
+    }
+  }
+
+  buff->reserve(capacity);
+  if (entry) {
+    update_size(*entry);
+  }
+  return buff;
+}
+
+template <typename T>
+inline std::size_t BufferPool<T>::size() const noexcept {
+  return this->_buffers.size();
+}
+
+template <typename T>
+inline std::size_t BufferPool<T>::max_size() const noexcept {
+  return this->_max_size;
+}
+
+template <typename T>
+inline void BufferPool<T>::set_max_size(std::size_t max_size) {
+  this->_max_size = max_size;
+  while (this->_buffers.size() > max_size) {
+    MemoryBudget::instance().remove_pooled_bytes(this->_buffers.back().size_bytes);
+    this->_buffers.pop_back();
+  }
+}
+
+template <typename T>
+inline void BufferPool<T>::clear() noexcept {
+  MemoryBudget::instance().remove_pooled_bytes(this->size_bytes());
+  this->_buffers.clear();
+}
+
+template <typename T>
+inline std::size_t BufferPool<T>::size_bytes() const noexcept {
+  std::size_t size = 0;
+  for (const auto &entry : this->_buffers) {
+    size += entry.size_bytes;
+  }
+  return size;
+}
+
+template <typename T>
+inline bool BufferPool<T>::is_exclusive(const std::shared_ptr<std::vector<T>> &buff,
+                                        bool pooled) noexcept {
+  assert(buff);
+  // use_count() is only approximate when buffers are shared across threads. However, a buffer
+  // owned exclusively by the pool (and possibly by the caller) cannot be copied by other threads
+  return buff.use_count() == (pooled ? 1 : 0) + 1;
+}
+
+template <typename T>
+inline void BufferPool<T>::update_size(Entry &entry) noexcept {
+  // Only called on buffers that are not shared, so reading their capacity is safe
+  const auto new_size = entry.buff->capacity() * sizeof(T);
+  auto &budget = MemoryBudget::instance();
+  if (new_size > entry.size_bytes) {
+    budget.add_pooled_bytes(new_size - entry.size_bytes);
+  } else {
+    budget.remove_pooled_bytes(entry.size_bytes - new_size);
+  }
+  entry.size_bytes = new_size;
+}
+
+template <typename T>
+inline void BufferPool<T>::release_idle_buffers_if_trimmed() noexcept {
+  const auto epoch = MemoryBudget::instance().trim_epoch();
+  if (epoch == this->_trim_epoch) {
+    return;
+  }
+  this->_trim_epoch = epoch;
+
+  auto &budget = MemoryBudget::instance();
+  auto it = std::remove_if(this->_buffers.begin(), this->_buffers.end(), [&](const auto &e) {
+    if (e.buff.use_count() == 1) {
+      budget.remove_pooled_bytes(e.size_bytes);
+      return true;
+    }
+    return false;
+  });
+  this->_buffers.erase(it, this->_buffers.end());
+}
+
+}  // namespace coolerpp::internal
@@ -10,18 +10,30 @@
 #include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 #include "coolerpp/common.hpp"
 #include "coolerpp/internal/hash.hpp"
 
 namespace coolerpp {
 
-inline Chromosome::Chromosome(std::uint32_t id, std::string name_, std::uint32_t size_) noexcept
-    : _name(std::move(name_)), _id(id), _size(size_) {
+inline Chromosome::Chromosome(std::uint32_t id, std::string name_, std::uint32_t size_)
+    : _name_buff(std::make_shared<const std::string>(std::move(name_))),
+      _name(*_name_buff),
+      _id(id),
+      _size(size_) {
+  assert(_id != (std::numeric_limits<std::uint32_t>::max)());
+  assert(_size != 0);
+}
+
+inline Chromosome::Chromosome(std::uint32_t id, std::shared_ptr<const std::string> name_buff,
+                              std::string_view name_, std::uint32_t size_) noexcept
+    : _name_buff(std::move(name_buff)), _name(name_), _id(id), _size(size_) {
   assert(_id != (std::numeric_limits<std::uint32_t>::max)());
   assert(_size != 0);
 }
@@ -96,10 +108,7 @@ constexpr bool operator!=(std::uint32_t a_id, const Chromosome& b) noexcept { re
 
 template <typename ChromosomeIt>
 inline ChromosomeSet::ChromosomeSet(ChromosomeIt first_chrom, ChromosomeIt last_chrom)
-    : _buff(first_chrom, last_chrom),
-      _map(construct_chrom_map(_buff)),
-      _longest_chrom(find_longest_chromosome(_buff)),
-      _chrom_with_longest_name(find_chromosome_with_longest_name(_buff)) {
+    : _data(construct_data(construct_chrom_buffer(first_chrom, last_chrom))) {
   this->validate();
 }
 
@@ -107,10 +116,8 @@ template <typename ChromosomeNameIt, typename ChromosomeSizeIt>
 inline ChromosomeSet::ChromosomeSet(ChromosomeNameIt first_chrom_name,
                                     ChromosomeNameIt last_chrom_name,
                                     ChromosomeSizeIt first_chrom_size)
-    : _buff(construct_chrom_buffer(first_chrom_name, last_chrom_name, first_chrom_size)),
-      _map(construct_chrom_map(_buff)),
-      _longest_chrom(find_longest_chromosome(_buff)),
-      _chrom_with_longest_name(find_chromosome_with_longest_name(_buff)) {
+    : _data(construct_data(
+          construct_chrom_buffer(first_chrom_name, last_chrom_name, first_chrom_size))) {
   this->validate();
 }
 
@@ -119,33 +126,37 @@ inline ChromosomeSet::ChromosomeSet(std::initializer_list<Chromosome> chromosome
 
 inline auto ChromosomeSet::begin() const -> const_iterator { return this->cbegin(); }
 inline auto ChromosomeSet::end() const -> const_iterator { return this->cend(); }
-inline auto ChromosomeSet::cbegin() const -> const_iterator { return this->_buff.cbegin(); }
-inline auto ChromosomeSet::cend() const -> const_iterator { return this->_buff.cend(); }
+inline auto ChromosomeSet::cbegin() const -> const_iterator { return this->buff().cbegin(); }
+inline auto ChromosomeSet::cend() const -> const_iterator { return this->buff().cend(); }
 
 inline auto ChromosomeSet::rbegin() const -> const_reverse_iterator { return this->rcbegin(); }
 inline auto ChromosomeSet::rend() const -> const_reverse_iterator { return this->rcend(); }
 inline auto ChromosomeSet::rcbegin() const -> const_reverse_iterator {
-  return this->_buff.rbegin();
+  return this->buff().rbegin();
 }
-inline auto ChromosomeSet::rcend() const -> const_reverse_iterator { return this->_buff.rend(); }
+inline auto ChromosomeSet::rcend() const -> const_reverse_iterator { return this->buff().rend(); }
 
 inline bool ChromosomeSet::empty() const noexcept { return this->size() == 0; }
-inline std::size_t ChromosomeSet::size() const noexcept { return this->_buff.size(); }
+inline std::size_t ChromosomeSet::size() const noexcept { return this->buff().size(); }
 
 inline auto ChromosomeSet::find(std::uint32_t id) const -> const_iterator {
   if (static_cast<std::size_t>(id) > this->size()) {
     return this->end();
   }
-  return this->_buff.begin() + static_cast<std::ptrdiff_t>(id);
+  return this->begin() + static_cast<std::ptrdiff_t>(id);
 }
 
 inline auto ChromosomeSet::find(std::string_view chrom_name) const -> const_iterator {
-  auto it = this->_map.find(chrom_name);
-  if (it == this->_map.end()) {
+  if (!this->_data) {
     return this->end();
   }
 
-  return this->_buff.begin() + static_cast<std::ptrdiff_t>(it->second);
+  auto it = this->_data->map.find(chrom_name);
+  if (it == this->_data->map.end()) {
+    return this->end();
+  }
+
+  return this->begin() + static_cast<std::ptrdiff_t>(it->second);
 }
 
 inline auto ChromosomeSet::find(const Chromosome& chrom) const -> const_iterator {
@@ -197,10 +208,13 @@ inline std::uint32_t ChromosomeSet::get_id(std::string_view chrom_name) const {
 }
 
 inline bool ChromosomeSet::operator==(const ChromosomeSet& other) const {
+  if (this->_data == other._data) {
+    return true;
+  }
   if (this->size() != other.size()) {
     return false;
   }
-  return std::equal(this->_buff.begin(), this->_buff.end(), other.begin(),
+  return std::equal(this->begin(), this->end(), other.begin(),
                     [](const Chromosome& chrom1, const Chromosome& chrom2) {
                       return chrom1.id() == chrom2.id() && chrom1.name() == chrom2.name() &&
                              chrom1.size() == chrom2.size();
@@ -215,15 +229,15 @@ inline const Chromosome& ChromosomeSet::longest_chromosome() const {
   if (this->empty()) {
     throw std::runtime_error("longest_chromosome() was called on an empty ChromosomeSet");
   }
-  assert(this->_longest_chrom < this->_buff.size());
-  return this->_buff[this->_longest_chrom];
+  assert(this->_data->longest_chrom < this->size());
+  return this->buff()[this->_data->longest_chrom];
 }
 inline const Chromosome& ChromosomeSet::chromosome_with_longest_name() const {
   if (this->empty()) {
     throw std::runtime_error("chromosome_with_longest_name() was called on an empty ChromosomeSet");
   }
-  assert(this->_chrom_with_longest_name < this->_buff.size());
-  return this->_buff[this->_chrom_with_longest_name];
+  assert(this->_data->chrom_with_longest_name < this->size());
+  return this->buff()[this->_data->chrom_with_longest_name];
 }
 
 inline void ChromosomeSet::validate_chrom_id(std::uint32_t chrom_id) const {
@@ -232,24 +246,99 @@ inline void ChromosomeSet::validate_chrom_id(std::uint32_t chrom_id) const {
   }
 }
 
+inline auto ChromosomeSet::buff() const noexcept -> const ChromBuff& {
+  static const ChromBuff empty_buff{};
+  return this->_data ? this->_data->buff : empty_buff;
+}
+
 template <typename ChromosomeNameIt, typename ChromosomeSizeIt>
 inline auto ChromosomeSet::construct_chrom_buffer(ChromosomeNameIt first_chrom_name,
                                                   ChromosomeNameIt last_chrom_name,
                                                   ChromosomeSizeIt first_chrom_size) -> ChromBuff {
-  ChromBuff buff{};
+  std::string names{};
+  std::vector<std::size_t> name_offsets{0};
+  std::vector<std::uint32_t> ids{};
+  std::vector<std::uint32_t> sizes{};
   while (first_chrom_name != last_chrom_name) {
-    if (std::string_view{*first_chrom_name}.empty()) {
+    const std::string_view name{*first_chrom_name};
+    if (name.empty()) {
       throw std::runtime_error("found chromosome with empty name");
     }
-    buff.emplace_back(static_cast<std::uint32_t>(buff.size()), std::string{*first_chrom_name},
-                      conditional_static_cast<std::uint32_t>(*first_chrom_size));
+    names.append(name);
+    name_offsets.push_back(names.size());
+    ids.push_back(static_cast<std::uint32_t>(ids.size()));
+    sizes.push_back(conditional_static_cast<std::uint32_t>(*first_chrom_size));
 
     ++first_chrom_name;
     ++first_chrom_size;
   }
+  return construct_chrom_buffer(std::move(names), name_offsets, ids, sizes);
+}
+
+template <typename ChromosomeIt>
+inline auto ChromosomeSet::construct_chrom_buffer(ChromosomeIt first_chrom,
+                                                  ChromosomeIt last_chrom) -> ChromBuff {
+  ChromBuff buff(first_chrom, last_chrom);
+  if (buff.empty()) {
+    return buff;
+  }
+
+  // Chromosomes coming from the same ChromosomeSet (e.g. when calling BinTable::subset()) can keep
+  // pointing to the names of the original set
+  const auto& name_buff = buff.front()._name_buff;
+  if (std::all_of(buff.begin(), buff.end(),
+                  [&](const Chromosome& chrom) { return chrom._name_buff == name_buff; })) {
+    return buff;
+  }
+
+  std::string names{};
+  std::vector<std::size_t> name_offsets{0};
+  std::vector<std::uint32_t> ids{};
+  std::vector<std::uint32_t> sizes{};
+  for (const auto& chrom : buff) {
+    names.append(chrom.name());
+    name_offsets.push_back(names.size());
+    ids.push_back(chrom.id());
+    sizes.push_back(chrom.size());
+  }
+  return construct_chrom_buffer(std::move(names), name_offsets, ids, sizes);
+}
+
+inline auto ChromosomeSet::construct_chrom_buffer(std::string names,
+                                                  const std::vector<std::size_t>& name_offsets,
+                                                  const std::vector<std::uint32_t>& ids,
+                                                  const std::vector<std::uint32_t>& sizes)
+    -> ChromBuff {
+  assert(name_offsets.size() == ids.size() + 1);
+  assert(ids.size() == sizes.size());
+
+  ChromBuff buff{};
+  if (ids.empty()) {
+    return buff;
+  }
+
+  buff.reserve(ids.size());
+  const auto names_ptr = std::make_shared<const std::string>(std::move(names));
+  const std::string_view names_view{*names_ptr};
+  for (std::size_t i = 0; i < ids.size(); ++i) {
+    const auto name = names_view.substr(name_offsets[i], name_offsets[i + 1] - name_offsets[i]);
+    buff.emplace_back(Chromosome{ids[i], names_ptr, name, sizes[i]});
+  }
   return buff;
 }
 
+inline auto ChromosomeSet::construct_data(ChromBuff chroms) -> std::shared_ptr<const Data> {
+  if (chroms.empty()) {
+    return nullptr;
+  }
+
+  auto map = construct_chrom_map(chroms);
+  const auto longest_chrom = find_longest_chromosome(chroms);
+  const auto chrom_with_longest_name = find_chromosome_with_longest_name(chroms);
+  return std::make_shared<const Data>(
+      Data{std::move(chroms), std::move(map), longest_chrom, chrom_with_longest_name});
+}
+
 inline auto ChromosomeSet::construct_chrom_map(const ChromBuff& chroms) -> ChromMap {
   ChromMap buff(chroms.size());
   std::transform(chroms.begin(), chroms.end(), std::inserter(buff, buff.begin()),
@@ -294,14 +383,14 @@ inline void ChromosomeSet::validate() const {
     return;
   }
 
-  assert(this->_longest_chrom < this->_buff.size());
-  assert(this->_chrom_with_longest_name < this->_buff.size());
+  assert(this->_data->longest_chrom < this->size());
+  assert(this->_data->chrom_with_longest_name < this->size());
 
-  if (!std::is_sorted(this->_buff.begin(), this->_buff.end())) {
+  if (!std::is_sorted(this->begin(), this->end())) {
     throw std::runtime_error("chromosomes are not sorted by ID");
   }
 
-  for (const auto& chrom : this->_buff) {
+  for (const auto& chrom : *this) {
     if (chrom.size() == 0) {
       throw std::runtime_error(
           fmt::format(FMT_STRING("chromosome {} has a size of 0"), chrom.name()));
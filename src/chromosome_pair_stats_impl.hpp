@@ -0,0 +1,174 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/chromosome.hpp"
+#include "coolerpp/common.hpp"
+
+namespace coolerpp {
+
+inline ContactStats &ContactStats::operator+=(const ContactStats &other) noexcept {
+  this->sum += other.sum;
+  this->nnz += other.nnz;
+  return *this;
+}
+
+inline bool ContactStats::operator==(const ContactStats &other) const noexcept {
+  return this->sum == other.sum && this->nnz == other.nnz;
+}
+
+inline bool ContactStats::operator!=(const ContactStats &other) const noexcept {
+  return !(*this == other);
+}
+
+inline ChromosomePairStats::ChromosomePairStats(std::uint32_t num_chroms)
+    : _num_chroms(num_chroms), _chroms(num_chroms) {}
+
+inline void ChromosomePairStats::add(std::uint32_t chrom1_id, std::uint32_t chrom2_id,
+                                     const ContactStats &stats) {
+  this->validate_chrom_id(chrom1_id);
+  this->validate_chrom_id(chrom2_id);
+  if (stats.nnz == 0) {
+    return;
+  }
+
+  this->_pairs[this->compute_key(chrom1_id, chrom2_id)] += stats;
+  this->_chroms[chrom1_id] += stats;
+  if (chrom1_id == chrom2_id) {
+    this->_cis += stats;
+  } else {
+    this->_chroms[chrom2_id] += stats;
+    this->_trans += stats;
+  }
+}
+
+inline ContactStats ChromosomePairStats::at(std::uint32_t chrom1_id,
+                                            std::uint32_t chrom2_id) const {
+  this->validate_chrom_id(chrom1_id);
+  this->validate_chrom_id(chrom2_id);
+  const auto it = this->_pairs.find(this->compute_key(chrom1_id, chrom2_id));
+  if (it == this->_pairs.end()) {
+    return {};
+  }
+  return it->second;
+}
+
+inline ContactStats ChromosomePairStats::at(const Chromosome &chrom1,
+                                            const Chromosome &chrom2) const {
+  return this->at(chrom1.id(), chrom2.id());
+}
+
+inline ContactStats ChromosomePairStats::at(std::uint32_t chrom_id) const {
+  this->validate_chrom_id(chrom_id);
+  return this->_chroms[chrom_id];
+}
+
+inline ContactStats ChromosomePairStats::at(const Chromosome &chrom) const {
+  return this->at(chrom.id());
+}
+
+constexpr const ContactStats &ChromosomePairStats::cis() const noexcept { return this->_cis; }
+
+constexpr const ContactStats &ChromosomePairStats::trans() const noexcept { return this->_trans; }
+
+inline ContactStats ChromosomePairStats::total() const noexcept {
+  auto stats = this->_cis;
+  stats += this->_trans;
+  return stats;
+}
+
+constexpr std::uint32_t ChromosomePairStats::num_chroms() const noexcept {
+  return this->_num_chroms;
+}
+
+inline std::size_t ChromosomePairStats::size() const noexcept { return this->_pairs.size(); }
+
+inline bool ChromosomePairStats::empty() const noexcept { return this->size() == 0; }
+
+inline auto ChromosomePairStats::to_vector() const -> std::vector<Record> {
+  std::vector<Record> records{};
+  records.reserve(this->_pairs.size());
+  for (const auto &[key, stats] : this->_pairs) {
+    records.push_back(Record{static_cast<std::uint32_t>(key / this->_num_chroms),
+                             static_cast<std::uint32_t>(key % this->_num_chroms), stats});
+  }
+
+  std::sort(records.begin(), records.end(), [](const Record &r1, const Record &r2) {
+    return std::make_pair(r1.chrom1_id, r1.chrom2_id) < std::make_pair(r2.chrom1_id, r2.chrom2_id);
+  });
+  return records;
+}
+
+inline bool ChromosomePairStats::operator==(const ChromosomePairStats &other) const {
+  if (this->_num_chroms != other._num_chroms || this->_pairs.size() != other._pairs.size()) {
+    return false;
+  }
+  return std::all_of(this->_pairs.begin(), this->_pairs.end(), [&](const auto &kv) {
+    const auto it = other._pairs.find(kv.first);
+    return it != other._pairs.end() && it->second == kv.second;
+  });
+}
+
+inline bool ChromosomePairStats::operator!=(const ChromosomePairStats &other) const {
+  return !(*this == other);
+}
+
+inline std::uint64_t ChromosomePairStats::compute_key(std::uint32_t chrom1_id,
+                                                      std::uint32_t chrom2_id) const noexcept {
+  if (chrom1_id > chrom2_id) {
+    std::swap(chrom1_id, chrom2_id);
+  }
+  return (std::uint64_t(chrom1_id) * this->_num_chroms) + chrom2_id;
+}
+
+inline void ChromosomePairStats::validate_chrom_id(std::uint32_t chrom_id) const {
+  if (chrom_id >= this->_num_chroms) {
+    throw std::out_of_range(fmt::format(
+        FMT_STRING("invalid chromosome id {}: stats are available for {} chromosomes"), chrom_id,
+        this->_num_chroms));
+  }
+}
+
+namespace internal {
+
+inline ChromosomePairStatsAccumulator::ChromosomePairStatsAccumulator(
+    ChromosomePairStats &stats) noexcept
+    : _stats(&stats) {}
+
+template <typename N>
+inline void ChromosomePairStatsAccumulator::add(std::uint32_t chrom1_id, std::uint32_t chrom2_id,
+                                                N count) {
+  static_assert(std::is_arithmetic_v<N>);
+  if (chrom1_id != this->_chrom1_id || chrom2_id != this->_chrom2_id) {
+    this->flush();
+    this->_chrom1_id = chrom1_id;
+    this->_chrom2_id = chrom2_id;
+  }
+  this->_buff.sum += conditional_static_cast<double>(count);
+  ++this->_buff.nnz;
+}
+
+inline void ChromosomePairStatsAccumulator::flush() {
+  assert(this->_stats);
+  if (this->_buff.nnz != 0) {
+    this->_stats->add(this->_chrom1_id, this->_chrom2_id, this->_buff);
+  }
+  this->_buff = ContactStats{};
+}
+
+}  // namespace internal
+
+}  // namespace coolerpp
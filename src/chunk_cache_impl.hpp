@@ -0,0 +1,150 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/format.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/internal/type_pretty_printer.hpp"
+
+namespace coolerpp {
+
+inline ChunkCache& ChunkCache::instance() {
+  static ChunkCache cache{};
+  return cache;
+}
+
+inline void ChunkCache::set_capacity(std::size_t capacity_bytes) {
+  const std::scoped_lock lck(this->_mtx);
+  this->_capacity_bytes = capacity_bytes;
+  this->evict(capacity_bytes);
+}
+
+inline std::size_t ChunkCache::capacity() const {
+  const std::scoped_lock lck(this->_mtx);
+  return this->_capacity_bytes;
+}
+
+inline bool ChunkCache::enabled() const { return this->capacity() != 0; }
+
+template <typename T>
+inline std::shared_ptr<const std::vector<T>> ChunkCache::find(std::string_view dset_key,
+                                                              std::size_t offset,
+                                                              std::size_t size) {
+  const auto key = make_key<T>(dset_key, offset, size);
+  const std::scoped_lock lck(this->_mtx);
+  auto it = this->_entries.find(key);
+  if (it == this->_entries.end()) {
+    ++this->_misses;
+    return nullptr;
+  }
+
+  ++this->_hits;
+  this->_lru.splice(this->_lru.begin(), this->_lru, it->second);
+  return std::static_pointer_cast<const std::vector<T>>(it->second->data);
+}
+
+template <typename T>
+inline void ChunkCache::insert(std::string_view dset_key, std::size_t offset,
+                               std::shared_ptr<const std::vector<T>> block) {
+  assert(block);
+  const auto size_bytes = block->size() * sizeof(T);
+  auto key = make_key<T>(dset_key, offset, block->size());
+
+  const std::scoped_lock lck(this->_mtx);
+  if (size_bytes > this->_capacity_bytes) {
+    return;
+  }
+
+  if (auto it = this->_entries.find(key); it != this->_entries.end()) {
+    // Another thread inserted the same block in the meantime
+    this->_lru.splice(this->_lru.begin(), this->_lru, it->second);
+    return;
+  }
+
+  this->evict(this->_capacity_bytes - size_bytes);
+  this->_lru.emplace_front(Entry{key, std::move(block), size_bytes});
+  this->_entries.emplace(std::move(key), this->_lru.begin());
+  this->_size_bytes += size_bytes;
+}
+
+inline void ChunkCache::trim(std::size_t size_bytes) {
+  const std::scoped_lock lck(this->_mtx);
+  this->evict(size_bytes);
+}
+
+inline void ChunkCache::clear() {
+  const std::scoped_lock lck(this->_mtx);
+  this->evict(0);
+}
+
+inline void ChunkCache::reset_stats() {
+  const std::scoped_lock lck(this->_mtx);
+  this->_hits = 0;
+  this->_misses = 0;
+}
+
+inline auto ChunkCache::stats() const -> Stats {
+  const std::scoped_lock lck(this->_mtx);
+  return {this->_hits, this->_misses, this->_size_bytes, this->_capacity_bytes,
+          this->_entries.size()};
+}
+
+inline std::string ChunkCache::make_dataset_key(std::string_view file_path,
+                                                std::string_view dset_path) {
+  std::error_code ec{};
+  const auto path = std::filesystem::canonical(std::filesystem::path{file_path}, ec);
+  if (ec) {
+    return "";
+  }
+  const auto file_size = std::filesystem::file_size(path, ec);
+  if (ec) {
+    return "";
+  }
+  const auto mtime = std::filesystem::last_write_time(path, ec);
+  if (ec) {
+    return "";
+  }
+
+  // NUL cannot appear in file or dataset paths, so keys are never ambiguous
+  return fmt::format(FMT_STRING("{}{}{}{}{}{}{}"), path.string(), '\0', file_size, '\0',
+                     mtime.time_since_epoch().count(), '\0', dset_path);
+}
+
+inline std::string ChunkCache::make_remote_dataset_key(std::string_view url,
+                                                       std::uint64_t file_size,
+                                                       std::string_view dset_path) {
+  return fmt::format(FMT_STRING("{}{}{}{}{}"), url, '\0', file_size, '\0', dset_path);
+}
+
+template <typename T>
+inline std::string ChunkCache::make_key(std::string_view dset_key, std::size_t offset,
+                                        std::size_t size) {
+  return fmt::format(FMT_STRING("{}{}{}{}{}{}{}"), dset_key, '\0', offset, '\0', size, '\0',
+                     internal::type_name<T>());
+}
+
+inline void ChunkCache::evict(std::size_t capacity_bytes) {
+  while (this->_size_bytes > capacity_bytes) {
+    assert(!this->_lru.empty());
+    const auto& entry = this->_lru.back();
+    this->_size_bytes -= entry.size_bytes;
+    this->_entries.erase(entry.key);
+    this->_lru.pop_back();
+  }
+}
+
+}  // namespace coolerpp
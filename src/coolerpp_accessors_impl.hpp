@@ -7,8 +7,10 @@
 #include <fmt/format.h>
 
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <string_view>
@@ -169,4 +171,64 @@ inline auto File::index() const noexcept -> const Index & {
   return *this->_index;
 }
 
+inline FileStats File::stats() const {
+  FileStats stats{};
+  for (const auto &[name, dset] : this->_datasets) {
+    const auto *counters = dset.io_counters();
+    if (!counters) {
+      continue;
+    }
+    const auto dset_stats = counters->dataset_stats();
+    stats.datasets.emplace(name, dset_stats);
+    stats.total += dset_stats;
+    stats.row_seeks += counters->row_seeks();
+    stats.col_seeks += counters->col_seeks();
+    stats.pixels_materialized += counters->pixels_materialized();
+  }
+  return stats;
+}
+
+inline void File::reset_stats() const noexcept {
+  for (const auto &[_, dset] : this->_datasets) {
+    if (auto *counters = dset.io_counters(); counters) {
+      counters->reset();
+    }
+  }
+}
+
+inline FileMemoryUsage File::memory_usage() const {
+  FileMemoryUsage usage{};
+  for (const auto &[_, dset] : this->_datasets) {
+    usage.hdf5_chunk_caches += dset.chunk_cache_size();
+  }
+  if (this->_index) {
+    usage.index = this->_index->memory_usage();
+  }
+  if (this->_bins) {
+    usage.bin_table = this->_bins->memory_usage();
+  }
+
+  if (this->_weights_mtx) {
+    const std::scoped_lock lck(*this->_weights_mtx);
+    for (const auto &[_, weights] : this->_weights) {
+      if (weights) {
+        usage.weights += weights->memory_usage();
+      }
+    }
+    if (this->_marginal_sum) {
+      usage.weights += this->_marginal_sum->capacity() * sizeof(double);
+    }
+    if (this->_marginal_nnz) {
+      usage.weights += this->_marginal_nnz->capacity() * sizeof(std::uint64_t);
+    }
+  }
+
+  if (this->_writer) {
+    usage.write_buffers += this->_writer->memory_usage();
+  }
+  usage.write_buffers += (this->_marginal_sum_buff.capacity() * sizeof(double)) +
+                         (this->_marginal_nnz_buff.capacity() * sizeof(std::uint64_t));
+  return usage;
+}
+
 }  // namespace coolerpp
@@ -13,6 +13,8 @@
 #include <highfive/H5File.hpp>
 #include <highfive/H5Group.hpp>
 #include <highfive/H5Utility.hpp>
+#include <initializer_list>
+#include <limits>
 #include <memory>
 #include <string>
 #include <string_view>
@@ -26,6 +28,8 @@
 #include "coolerpp/internal/numeric_utils.hpp"
 #include "coolerpp/internal/type_pretty_printer.hpp"
 #include "coolerpp/internal/variant_buff.hpp"
+#include "coolerpp/remote.hpp"
+#include "coolerpp/trace.hpp"
 #include "coolerpp/uri.hpp"
 #include "coolerpp/validation.hpp"
 
@@ -72,40 +76,62 @@ inline void init_mcool(std::string_view file_path, bool force_overwrite) {
 //
 // }
 
-inline File::File(std::string_view uri, unsigned mode, std::size_t cache_size_bytes, double w0,
+inline File::File(std::string_view uri, unsigned mode, const CacheOptions &cache_options,
                   bool validate)
+    : File(open_file(uri, mode, validate), uri, mode, cache_options, validate) {}
+
+inline File::File(HighFive::File fp, std::string_view uri, unsigned mode,
+                  const CacheOptions &cache_options, bool validate,
+                  std::shared_ptr<const BinTable> bins, bool swmr_read)
     : _mode(mode),
-      _fp(std::make_unique<HighFive::File>(open_file(uri, _mode, validate))),
+      _fp(std::make_unique<HighFive::File>(std::move(fp))),
       _root_group(open_root_group(*_fp, uri)),
       _groups(open_groups(_root_group)),
-      _datasets(open_datasets(_root_group, cache_size_bytes, w0)),
+      _datasets(open_datasets(_root_group, cache_options)),
       _attrs(read_standard_attributes(_root_group)),
       _pixel_variant(detect_pixel_type(_root_group)),
-      _bins(std::make_shared<BinTable>(
-          import_chroms(_datasets.at("chroms/name"), _datasets.at("chroms/length"), false),
-          this->bin_size())),
+      _bins(bins ? std::move(bins) : import_bins(_datasets, _attrs)),
       _index(std::make_shared<Index>(
-          import_indexes(_datasets.at("indexes/chrom_offset"), _datasets.at("indexes/bin1_offset"),
-                         // NOLINTNEXTLINE
-                         chromosomes(), _bins, static_cast<std::uint64_t>(*_attrs.nnz), false))) {
+          swmr_read
+              ? import_partial_indexes(_datasets.at("indexes/bin1_offset"), _bins)
+              : import_indexes(_datasets.at("indexes/chrom_offset"),
+                               _datasets.at("indexes/bin1_offset"),
+                               // NOLINTNEXTLINE
+                               chromosomes(), _bins, static_cast<std::uint64_t>(*_attrs.nnz),
+                               false, mode == HighFive::File::ReadOnly))) {
   assert(mode == HighFive::File::ReadOnly || mode == HighFive::File::ReadWrite);
+  assert(!swmr_read || mode == HighFive::File::ReadOnly);
+  if (swmr_read) {
+    // Pixels past the rows published by the writer may belong to rows that are still incomplete
+    this->_attrs.nnz = static_cast<std::int64_t>(this->_index->nnz());
+    for (const auto *name : {"pixels/bin1_id", "pixels/bin2_id", "pixels/count"}) {
+      this->_datasets.at(name).set_size_limit(this->_index->nnz());
+    }
+  }
   if (validate) {
     this->validate_bins();
   }
+  if (cache_options.direct_pixel_reads && mode == HighFive::File::ReadOnly) {
+    for (const auto *name : {"pixels/bin1_id", "pixels/bin2_id", "pixels/count"}) {
+      this->_datasets.at(name).enable_direct_reads();
+    }
+  }
 }
 
 template <typename PixelT>
-inline File::File(std::string_view uri, ChromosomeSet chroms, [[maybe_unused]] PixelT pixel,
-                  StandardAttributes attributes, std::size_t cache_size_bytes, double w0)
+inline File::File(HighFive::File fp, std::string_view uri, ChromosomeSet chroms,
+                  [[maybe_unused]] PixelT pixel, StandardAttributes attributes,
+                  std::size_t cache_size_bytes, double w0, const CompressionPolicy &compression)
     : _mode(HighFive::File::ReadWrite),
-      _fp(std::make_unique<HighFive::File>(open_file(uri, _mode, false))),
+      _fp(std::make_unique<HighFive::File>(std::move(fp))),
       _root_group(open_or_create_root_group(*_fp, uri)),
       _groups(create_groups(_root_group)),
-      _datasets(create_datasets<PixelT>(_root_group, chroms, cache_size_bytes, w0)),
+      _datasets(create_datasets<PixelT>(_root_group, chroms, cache_size_bytes, w0, compression)),
       _attrs(std::move(attributes)),
       _pixel_variant(PixelT(0)),
       _bins(std::make_shared<const BinTable>(std::move(chroms), this->bin_size())),
       _index(std::make_shared<Index>(_bins)),
+      _chrom_pair_stats(static_cast<std::uint32_t>(_bins->chromosomes().size())),
       _finalize(true) {
   assert(this->bin_size() != 0);
   assert(!_bins->empty());
@@ -116,6 +142,32 @@ inline File::File(std::string_view uri, ChromosomeSet chroms, [[maybe_unused]] P
   this->write_sentinel_attr();
 }
 
+template <typename PixelT>
+inline File::File(HighFive::File fp, RootGroup root_grp, std::shared_ptr<const BinTable> bins,
+                  [[maybe_unused]] PixelT pixel, StandardAttributes attributes,
+                  std::size_t cache_size_bytes, double w0, const CompressionPolicy &compression)
+    : _mode(HighFive::File::ReadWrite),
+      _fp(std::make_unique<HighFive::File>(std::move(fp))),
+      _root_group(std::move(root_grp)),
+      _groups(create_groups(_root_group, false)),
+      _datasets(create_datasets<PixelT>(_root_group, bins->chromosomes(), cache_size_bytes, w0,
+                                        compression, false)),
+      _attrs(std::move(attributes)),
+      _pixel_variant(PixelT(0)),
+      _bins(std::move(bins)),
+      _index(std::make_shared<Index>(_bins)),
+      _chrom_pair_stats(static_cast<std::uint32_t>(_bins->chromosomes().size())),
+      _finalize(true),
+      _shared_bin_table(true) {
+  assert(this->bin_size() == _bins->bin_size());
+  assert(!_index->empty());
+  assert(this->dataset("bins/chrom").size() == _bins->size());
+
+  this->_attrs.nbins = static_cast<std::int64_t>(this->bins().size());
+  this->_attrs.nchroms = static_cast<std::int32_t>(this->chromosomes().size());
+  this->write_sentinel_attr();
+}
+
 inline File File::open_read_only(std::string_view uri, std::size_t cache_size_bytes,
                                  bool validate) {
   return File::open_read_only_random_access(uri, cache_size_bytes, validate);
@@ -123,18 +175,57 @@ inline File File::open_read_only(std::string_view uri, std::size_t cache_size_by
 
 inline File File::open_read_only_random_access(std::string_view uri, std::size_t cache_size_bytes,
                                                bool validate) {
-  return File(uri, HighFive::File::ReadOnly, cache_size_bytes, DEFAULT_HDF5_CACHE_W0, validate);
+  return File::open_read_only(uri, CacheOptions{AccessProfile::RANDOM, cache_size_bytes},
+                              validate);
 }
 
 inline File File::open_read_only_read_once(std::string_view uri, std::size_t cache_size_bytes,
                                            bool validate) {
-  return File(uri, HighFive::File::ReadOnly, cache_size_bytes, 1.0, validate);
+  return File::open_read_only(uri, CacheOptions{AccessProfile::SEQUENTIAL, cache_size_bytes},
+                              validate);
+}
+
+inline File File::open_read_only(std::string_view uri, const CacheOptions &cache_options,
+                                 bool validate) {
+  return File(uri, HighFive::File::ReadOnly, cache_options, validate);
+}
+
+inline File File::open_read_only_from_buffer(const void *buff, std::size_t size,
+                                             std::string_view group_path,
+                                             const CacheOptions &cache_options, bool validate) {
+  [[maybe_unused]] const HighFive::SilenceHDF5 silencer{};  // NOLINT
+  auto fp = internal::open_file_image(buff, size);
+  const auto uri = fmt::format(FMT_STRING("{}::{}"), fp.getName(), group_path);
+  if (validate) {
+    validate_cooler(fp, uri);
+  }
+  return File(std::move(fp), uri, HighFive::File::ReadOnly, cache_options, validate);
+}
+
+inline File File::open_read_only_swmr(std::string_view uri, const CacheOptions &cache_options) {
+  try {
+    const auto [file_path, root_path] = parse_cooler_uri(uri);
+    // Files being written fail validation, as the sentinel attribute is still set
+    auto fp = internal::open_file_swmr_read(file_path);
+    return File(std::move(fp), uri, HighFive::File::ReadOnly, cache_options, false, nullptr, true);
+  } catch (const std::exception &e) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("Cannot open cooler at URI \"{}\" in SWMR read mode. Reason: {}"), uri,
+        e.what()));
+  }
+}
+
+inline File File::open_read_only_trusted(std::string_view uri, const CacheOptions &cache_options) {
+  File f(uri, HighFive::File::ReadOnly, cache_options, false);
+  f.validate_bins(false);
+  return f;
 }
 
 template <typename PixelT>
 inline File File::create_new_cooler(std::string_view uri, const ChromosomeSet &chroms,
                                     std::uint32_t bin_size, bool overwrite_if_exists,
-                                    StandardAttributes attributes, std::size_t cache_size_bytes) {
+                                    StandardAttributes attributes, std::size_t cache_size_bytes,
+                                    WriterOptions writer_options) {
   static_assert(std::is_arithmetic_v<PixelT>);
   if (bin_size == 0) {
     throw std::logic_error("bin_size cannot be zero.");
@@ -144,6 +235,26 @@ inline File File::create_new_cooler(std::string_view uri, const ChromosomeSet &c
     const auto [file_path, root_path] = parse_cooler_uri(uri);
     const auto uri_is_file_path = root_path.empty() || root_path == "/";
 
+    const auto in_memory = writer_options.in_memory.has_value();
+    if (in_memory && !uri_is_file_path) {
+      throw std::runtime_error(
+          "creating coolers nested inside files kept in memory is not supported");
+    }
+    const auto swmr = writer_options.swmr.has_value();
+    if (swmr && (in_memory || !uri_is_file_path)) {
+      throw std::runtime_error(
+          "SWMR mode is only supported by coolers stored at the root of files on disk");
+    }
+    if (swmr && writer_options.threads > 1) {
+      throw std::logic_error("SWMR mode does not support compressing pixels in the background");
+    }
+    if (swmr && writer_options.checkpoint) {
+      throw std::logic_error("SWMR mode does not support checkpoints");
+    }
+
+    // Files kept in memory without a backing store never touch the disk
+    const auto writes_to_disk = !in_memory || writer_options.in_memory->backing_store;
+
     // URI is like myfile.mcool::/resolutions/100, but myfile.mcool does not exist
     if (!uri_is_file_path && !std::filesystem::exists(file_path)) {
       throw std::runtime_error(fmt::format(
@@ -153,7 +264,8 @@ inline File File::create_new_cooler(std::string_view uri, const ChromosomeSet &c
     }
 
     // URI points to an existing file, but overwrite_if_exists=false
-    if (!overwrite_if_exists && uri_is_file_path && std::filesystem::exists(file_path)) {
+    if (!overwrite_if_exists && uri_is_file_path && writes_to_disk &&
+        std::filesystem::exists(file_path)) {
       throw std::runtime_error("URI points to an existing file");
     }
 
@@ -164,8 +276,10 @@ inline File File::create_new_cooler(std::string_view uri, const ChromosomeSet &c
       mode = HighFive::File::ReadWrite;
     }
 
+    auto fp = in_memory ? internal::create_file_in_memory(file_path, *writer_options.in_memory)
+              : swmr    ? internal::create_file_swmr(file_path, mode)
+                        : open_file(uri, mode, false);
     {
-      auto fp = open_file(uri, mode, false);
       auto root_group = open_or_create_root_group(fp, uri);
       if (!uri_is_file_path && utils::is_cooler(root_group())) {
         if (overwrite_if_exists) {
@@ -178,9 +292,13 @@ inline File File::create_new_cooler(std::string_view uri, const ChromosomeSet &c
       }
       assert(!utils::is_cooler(root_group()));
     }
-    // At this point the parent file is guaranteed to exist, so we can always open it in ReadWrite
-    // mode
-    return File(uri, chroms, PixelT(0), attributes, cache_size_bytes);
+    File f(std::move(fp), uri, chroms, PixelT(0), attributes, cache_size_bytes,
+           DEFAULT_HDF5_CACHE_W0, writer_options.compression);
+    f.apply_writer_options(writer_options);
+    if (swmr) {
+      f.start_swmr_write(*writer_options.swmr);
+    }
+    return f;
 
   } catch (const std::exception &e) {
     throw std::runtime_error(
@@ -189,8 +307,129 @@ inline File File::create_new_cooler(std::string_view uri, const ChromosomeSet &c
   }
 }
 
+inline File File::resume(std::string_view uri, std::size_t cache_size_bytes,
+                         WriterOptions writer_options) {
+  if (writer_options.swmr || writer_options.in_memory) {
+    throw std::logic_error("resuming files in SWMR mode or kept in memory is not supported");
+  }
+  try {
+    [[maybe_unused]] const HighFive::SilenceHDF5 silencer{};  // NOLINT
+    auto fp = open_file(uri, HighFive::File::ReadWrite, false);
+    File f{};
+    f._mode = HighFive::File::ReadWrite;
+    f._root_group = open_root_group(fp, uri);
+    if (!check_sentinel_attr(f._root_group())) {
+      throw std::runtime_error("file was closed properly: there is nothing to resume");
+    }
+    const std::string checkpoint_name{internal::CHECKPOINT_GROUP_NAME};
+    if (!f._root_group().exist(checkpoint_name)) {
+      throw std::runtime_error("file does not contain a checkpoint");
+    }
+
+    f._groups = open_groups(f._root_group);
+    f._datasets =
+        open_datasets(f._root_group, CacheOptions{AccessProfile::SEQUENTIAL, cache_size_bytes});
+    f._attrs = read_standard_attributes(RootGroup{f._root_group().getGroup(checkpoint_name)});
+    f._pixel_variant = detect_pixel_type(f._root_group);
+    f._bins = import_bins(f._datasets, f._attrs);
+    f._index = std::make_shared<Index>(f._bins);
+    f._fp = std::make_unique<HighFive::File>(std::move(fp));
+    f._chrom_pair_stats = ChromosomePairStats(static_cast<std::uint32_t>(f.chromosomes().size()));
+
+    // Discard pixels written after the checkpoint
+    const auto nnz = static_cast<std::size_t>(*f._attrs.nnz);
+    for (const auto *name : {"pixels/bin1_id", "pixels/bin2_id", "pixels/count"}) {
+      auto &dset = f.dataset(name);
+      if (dset.size() < nnz) {
+        throw std::runtime_error(
+            fmt::format(FMT_STRING("checkpoint refers to {} pixels, but {} contains {} values"),
+                        nnz, dset.hdf5_path(), dset.size()));
+      }
+      dset.resize(nnz);
+    }
+    f.apply_writer_options(writer_options);
+    if (!f.restore_checkpoint()) {
+      f.import_pixel_stats();
+    }
+    f.remove_tile_index();
+    f._checkpointed_nnz = nnz;
+    f._finalize = true;
+    return f;
+
+  } catch (const std::exception &e) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("Cannot resume writing cooler at the following URI: \"{}\". Reason: {}"), uri,
+        e.what()));
+  }
+}
+
+inline File File::open_append(std::string_view uri, std::size_t cache_size_bytes,
+                              WriterOptions writer_options) {
+  if (writer_options.swmr || writer_options.in_memory) {
+    throw std::logic_error("appending to files in SWMR mode or kept in memory is not supported");
+  }
+  try {
+    File f(uri, HighFive::File::ReadWrite,
+           CacheOptions{AccessProfile::SEQUENTIAL, cache_size_bytes});
+    const auto nnz = static_cast<std::uint64_t>(*f._attrs.nnz);
+    const auto last_row = nnz == 0 ? std::uint64_t(0) : f.get_last_bin_written().id();
+
+    // Offsets of the rows following the last row written are filled again when the file is
+    // finalized
+    constexpr auto offset_not_set = (std::numeric_limits<std::uint64_t>::max)();
+    for (auto bin_id = nnz == 0 ? last_row : last_row + 1; bin_id < f.bins().size(); ++bin_id) {
+      f.index().set_offset_by_bin_id(bin_id, offset_not_set);
+    }
+
+    // Marginals and stats stored in the file would become stale if they were not updated with the
+    // pixels being appended
+    const auto has_marginals = f.has_bin_marginals();
+    const auto has_stats = f.has_chromosome_pair_stats();
+    if (has_marginals) {
+      writer_options.compute_bin_marginals = true;
+    }
+    if (has_stats) {
+      writer_options.compute_chromosome_pair_stats = true;
+    }
+    f.apply_writer_options(writer_options);
+    const auto compute_marginals = !f._marginal_sum_buff.empty();
+    const auto compute_stats = f._compute_chrom_pair_stats;
+    f._chrom_pair_stats = ChromosomePairStats(static_cast<std::uint32_t>(f.chromosomes().size()));
+    if ((compute_marginals && !has_marginals) || (compute_stats && !has_stats)) {
+      // Files written without marginals or stats: these have to be computed from the pixels
+      // already stored in the file
+      f.import_pixel_stats();
+    } else {
+      if (compute_stats) {
+        f._chrom_pair_stats = f.read_chromosome_pair_stats();
+      }
+      if (compute_marginals) {
+        const auto sum = f.read_bin_marginal_sum();
+        const auto nnz_ = f.read_bin_marginal_nnz();
+        f._marginal_sum_buff.assign(sum->begin(), sum->end());
+        f._marginal_nnz_buff.assign(nnz_->begin(), nnz_->end());
+      }
+    }
+
+    f.remove_tile_index();
+    // Attributes are written again when the file is finalized
+    f.remove_attributes();
+    f.write_sentinel_attr();
+    f._checkpointed_nnz = nnz;
+    f._finalize = true;
+    return f;
+
+  } catch (const std::exception &e) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("Cannot open cooler at the following URI for appending: \"{}\". Reason: {}"),
+        uri, e.what()));
+  }
+}
+
 inline File::~File() noexcept {
   try {
+    // Answer pending queries while datasets are still open
+    this->_query_pool.reset();
     this->finalize();
   } catch (const std::exception &e) {
     fmt::print(stderr, FMT_STRING("{}\n"), e.what());
@@ -220,6 +459,18 @@ inline void File::close() {
   *this = File{};
 }
 
+inline std::vector<std::byte> File::close_to_buffer() {
+  if (!this->_fp) {
+    throw std::runtime_error("unable to read the image of a file that is not open");
+  }
+  this->finalize();
+  this->_finalize = false;
+  this->_fp->flush();
+  auto buff = internal::read_file_image(*this->_fp);
+  *this = File{};
+  return buff;
+}
+
 inline void File::finalize() {
   if (!_fp || !_finalize) {
     assert(!_bins == !_fp);
@@ -229,13 +480,27 @@ inline void File::finalize() {
 
   assert(this->_bins);
   assert(this->_index);
+  const internal::TraceScope trace_scope{"coolerpp::File::finalize"};
   try {
-    this->write_chromosomes();
-    this->write_bin_table();
+    if (this->_swmr) {
+      this->end_swmr_write();
+    }
+    if (this->_writer) {
+      this->_writer->flush();
+    }
+    if (!this->_shared_bin_table) {
+      this->write_chromosomes();
+      this->write_bin_table();
+    }
 
     assert(_attrs.nnz.has_value());
     _index->nnz() = static_cast<std::uint64_t>(*_attrs.nnz);
     this->write_indexes();
+    if (this->_compute_chrom_pair_stats) {
+      this->write_chromosome_pair_stats();
+    }
+    this->write_bin_marginals();
+    this->remove_checkpoint();
     this->write_attributes();
 
   } catch (const std::exception &e) {
@@ -250,21 +515,32 @@ inline HighFive::File File::open_file(std::string_view uri, unsigned int mode, b
   [[maybe_unused]] const HighFive::SilenceHDF5 silencer{};  // NOLINT
   const auto [file_path, root_grp] = parse_cooler_uri(uri);
 
-  const auto new_file = !std::filesystem::exists(file_path);
-  HighFive::File f(file_path, mode);
+  const auto remote_file = is_remote_path(file_path);
+  if (remote_file && mode != HighFive::File::ReadOnly) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("unable to open \"{}\": remote files can only be opened in read-only mode"),
+        uri));
+  }
+
+  const auto new_file = !remote_file && !std::filesystem::exists(file_path);
+  auto f = remote_file ? internal::open_file_read_only(file_path)
+                       : HighFive::File(file_path, mode);
   if (!validate || new_file) {
     return f;
   }
 
-  const auto status = utils::is_cooler(f, root_grp);
+  validate_cooler(f, uri);
+  return f;
+}
+
+inline void File::validate_cooler(const HighFive::File &f, std::string_view uri) {
+  const auto status = utils::is_cooler(f, parse_cooler_uri(uri).group_path);
   if (!status) {
     throw std::runtime_error(
         fmt::format(FMT_STRING("\"{}\" does not look like a valid Cooler file:\n"
                                "Validation report:\n{}"),
                     uri, status));
   }
-
-  return f;
 }
 
 inline auto File::open_or_create_root_group(HighFive::File &f, std::string_view uri) -> RootGroup {
@@ -317,4 +593,20 @@ inline void File::update_pixel_sum(N partial_sum) {
   }
 }
 
+template <typename N>
+inline void File::update_bin_marginals(std::uint64_t bin1_id, std::uint64_t bin2_id,
+                                       N count) noexcept {
+  static_assert(std::is_arithmetic_v<N>);
+  assert(bin1_id < this->_marginal_sum_buff.size());
+  assert(bin2_id < this->_marginal_sum_buff.size());
+
+  const auto count_ = conditional_static_cast<double>(count);
+  this->_marginal_sum_buff[bin1_id] += count_;
+  ++this->_marginal_nnz_buff[bin1_id];
+  if (bin1_id != bin2_id) {
+    this->_marginal_sum_buff[bin2_id] += count_;
+    ++this->_marginal_nnz_buff[bin2_id];
+  }
+}
+
 }  // namespace coolerpp
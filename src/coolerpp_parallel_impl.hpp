@@ -0,0 +1,217 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <exception>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/dataset.hpp"
+#include "coolerpp/index.hpp"
+#include "coolerpp/internal/pixel_column_reader.hpp"
+#include "coolerpp/pixel.hpp"
+
+namespace coolerpp {
+
+namespace internal {
+// Using more partitions than threads helps balancing the workload when the density of interactions
+// varies a lot across rows
+inline constexpr std::size_t PARTITIONS_PER_THREAD = 4;
+
+// Split the rows of the pixel tables indexed by indexes (which should all refer to the same bin
+// table) into up to num_partitions ranges of rows with roughly the same number of pixels, summed
+// over all tables. For each range, return the corresponding [first_offset, last_offset) range of
+// pixels in every table. Offsets are looked up in the indexes: pixel tables are never read
+[[nodiscard]] inline std::vector<std::vector<std::pair<std::uint64_t, std::uint64_t>>>
+partition_pixel_tables(const std::vector<const Index *> &indexes, std::size_t num_partitions) {
+  assert(!indexes.empty());
+  assert(num_partitions != 0);
+  const auto num_bins = conditional_static_cast<std::uint64_t>(indexes.front()->size());
+
+  auto get_offset = [&](const Index &idx, std::uint64_t bin_id) {
+    return bin_id == num_bins ? idx.nnz() : idx.get_offset_by_bin_id(bin_id);
+  };
+  auto get_total_offset = [&](std::uint64_t bin_id) {
+    std::uint64_t offset = 0;
+    for (const auto *idx : indexes) {
+      offset += get_offset(*idx, bin_id);
+    }
+    return offset;
+  };
+
+  const auto total_nnz = get_total_offset(num_bins);
+  std::vector<std::uint64_t> bounds{0};
+  for (std::size_t i = 1; i < num_partitions; ++i) {
+    const auto target_offset = (total_nnz * i) / num_partitions;
+
+    // Find the first row whose offset is >= target_offset
+    std::uint64_t lo = 0;
+    std::uint64_t hi = num_bins;
+    while (lo < hi) {
+      const auto mid = lo + (hi - lo) / 2;
+      if (get_total_offset(mid) < target_offset) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    if (lo > bounds.back() && lo < num_bins) {
+      bounds.push_back(lo);
+    }
+  }
+  bounds.push_back(num_bins);
+
+  std::vector<std::vector<std::pair<std::uint64_t, std::uint64_t>>> partitions{};
+  for (std::size_t i = 1; i < bounds.size(); ++i) {
+    auto &offsets = partitions.emplace_back();
+    for (const auto *idx : indexes) {
+      offsets.emplace_back(get_offset(*idx, bounds[i - 1]), get_offset(*idx, bounds[i]));
+    }
+  }
+  return partitions;
+}
+
+[[nodiscard]] inline std::vector<std::vector<std::pair<std::uint64_t, std::uint64_t>>>
+partition_pixel_tables(const std::vector<File> &coolers, std::size_t num_partitions) {
+  std::vector<const Index *> indexes(coolers.size());
+  std::transform(coolers.begin(), coolers.end(), indexes.begin(),
+                 [](const File &clr) { return &clr.index(); });
+  return partition_pixel_tables(indexes, num_partitions);
+}
+}  // namespace internal
+
+inline void File::set_decompression_threads(std::size_t num_threads) {
+  if (num_threads == 0) {
+    num_threads = (std::max)(1U, std::thread::hardware_concurrency());
+  }
+  for (const auto *name : {"pixels/bin1_id", "pixels/bin2_id", "pixels/count"}) {
+    this->dataset(name).set_decompression_threads(num_threads);
+  }
+}
+
+inline void File::set_query_threads(std::size_t num_threads) {
+  if (num_threads == 0) {
+    num_threads = (std::max)(1U, std::thread::hardware_concurrency());
+  }
+  [[maybe_unused]] const std::scoped_lock lck(*this->_query_pool_mtx);
+  this->_query_pool.reset();
+  this->_query_threads = num_threads;
+}
+
+inline std::size_t File::query_threads() const noexcept { return this->_query_threads; }
+
+template <typename N, typename UnaryOperation>
+inline void File::parallel_for_each(std::size_t num_threads, UnaryOperation op,
+                                    std::size_t chunk_size) const {
+  static_assert(std::is_arithmetic_v<N>);
+  const auto &bins = this->bins();
+  this->parallel_for_each_block<N>(
+      num_threads,
+      [&](std::size_t, const std::vector<std::uint64_t> &bin1_ids,
+          const std::vector<std::uint64_t> &bin2_ids, const std::vector<N> &counts) {
+        for (std::size_t j = 0; j < counts.size(); ++j) {
+          op(Pixel<N>{bins, bin1_ids[j], bin2_ids[j], counts[j]});
+        }
+      },
+      chunk_size);
+}
+
+template <typename N, typename BlockOperation>
+inline void File::parallel_for_each_block(std::size_t num_threads, BlockOperation op,
+                                          std::size_t chunk_size) const {
+  static_assert(std::is_arithmetic_v<N>);
+  if (num_threads == 0) {
+    num_threads = (std::max)(1U, std::thread::hardware_concurrency());
+  }
+  chunk_size = (std::max)(std::size_t(1), chunk_size);
+
+  if (this->index().nnz() == 0) {
+    return;
+  }
+
+  const auto partitions = internal::partition_pixel_tables(
+      std::vector<const Index *>{&this->index()}, num_threads * internal::PARTITIONS_PER_THREAD);
+  num_threads = (std::min)(num_threads, partitions.size());
+
+  // Each worker reads through its own copy of the pixel datasets, so that workers never share the
+  // mutable state of a Dataset. Copies are made (and released) by this thread, as copying or
+  // releasing Datasets calls into libhdf5
+  struct PixelDatasets {
+    Dataset bin1;
+    Dataset bin2;
+    Dataset count;
+  };
+  const std::vector<PixelDatasets> dsets(
+      num_threads, PixelDatasets{this->dataset("pixels/bin1_id"),
+                                 this->dataset("pixels/bin2_id"), this->dataset("pixels/count")});
+
+  // HDF5 is not guaranteed to be thread-safe (and even when it is, calls into the library are
+  // serialized using a global lock): calls into libhdf5 are serialized using io_mtx, while
+  // decompressing chunks, decoding pixels and running op happen concurrently (see
+  // internal::PixelColumnReader). Pixels are read without locking at all when direct reads are
+  // enabled
+  std::mutex io_mtx;
+  std::atomic<std::size_t> next_partition{0};
+  std::atomic<bool> early_return{false};
+  std::exception_ptr except{};
+  std::mutex except_mtx;
+
+  auto worker = [&](std::size_t thread_id) {
+    std::vector<std::uint64_t> bin1_buff{};
+    std::vector<std::uint64_t> bin2_buff{};
+    std::vector<N> count_buff{};
+    const auto &dset = dsets[thread_id];
+    internal::PixelColumnReader<N> reader(dset.bin1, dset.bin2, dset.count, &io_mtx);
+
+    try {
+      while (!early_return) {
+        const auto i = next_partition++;
+        if (i >= partitions.size()) {
+          break;
+        }
+        const auto [first_offset, last_offset] = partitions[i].front();
+        for (auto offset = first_offset; offset < last_offset && !early_return;) {
+          const auto num = (std::min)(conditional_static_cast<std::uint64_t>(chunk_size),
+                                      last_offset - offset);
+          reader.read(bin1_buff, bin2_buff, count_buff, num, offset);
+          op(thread_id, std::as_const(bin1_buff), std::as_const(bin2_buff),
+             std::as_const(count_buff));
+          offset += num;
+        }
+      }
+    } catch (...) {
+      [[maybe_unused]] const std::scoped_lock lck(except_mtx);
+      early_return = true;
+      if (!except) {
+        except = std::current_exception();
+      }
+    }
+  };
+
+  std::vector<std::thread> threads{};
+  threads.reserve(num_threads - 1);
+  for (std::size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(worker, i);
+  }
+  worker(0);
+
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  if (except) {
+    std::rethrow_exception(except);
+  }
+}
+
+}  // namespace coolerpp
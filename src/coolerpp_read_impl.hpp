@@ -8,14 +8,23 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <exception>
+#include <future>
 #include <highfive/H5Exception.hpp>
 #include <highfive/H5File.hpp>
 #include <highfive/H5Group.hpp>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <numeric>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 #include <variant>
@@ -24,9 +33,14 @@
 #include "coolerpp/attribute.hpp"
 #include "coolerpp/bin_table.hpp"
 #include "coolerpp/chromosome.hpp"
+#include "coolerpp/chromosome_pair_stats.hpp"
 #include "coolerpp/dataset.hpp"
+#include "coolerpp/genomic_interval.hpp"
 #include "coolerpp/group.hpp"
 #include "coolerpp/internal/type_pretty_printer.hpp"
+#include "coolerpp/internal/weight_cache.hpp"
+#include "coolerpp/memory_budget.hpp"
+#include "coolerpp/trace.hpp"
 #include "coolerpp/uri.hpp"
 
 namespace coolerpp {
@@ -71,12 +85,20 @@ namespace internal {
 }
 }  // namespace internal
 
+template <typename N, std::size_t CHUNK_SIZE>
+inline PixelSelector<N, CHUNK_SIZE> File::fetch() const {
+  return PixelSelector<N, CHUNK_SIZE>(this->_index, this->dataset("pixels/bin1_id"),
+                                      this->dataset("pixels/bin2_id"),
+                                      this->dataset("pixels/count"));
+}
+
 template <typename N, std::size_t CHUNK_SIZE>
 inline PixelSelector<N, CHUNK_SIZE> File::fetch(std::string_view query,
                                                 QUERY_TYPE query_type) const {
+  const internal::TraceScope trace_scope{"coolerpp::File::fetch"};
   const auto gi = query_type == QUERY_TYPE::BED
                       ? GenomicInterval::parse_bed(this->chromosomes(), query)
-                      : GenomicInterval::parse_ucsc(this->chromosomes(), std::string{query});
+                      : GenomicInterval::parse_ucsc(this->chromosomes(), query);
 
   return this->fetch<N, CHUNK_SIZE>(PixelCoordinates{this->bins().at(gi)});
 }
@@ -90,6 +112,30 @@ inline PixelSelector<N, CHUNK_SIZE> File::fetch(std::string_view chrom_name, std
       this->bins().at(chrom_name, start), this->bins().at(chrom_name, end - (std::min)(end, 1U))});
 }
 
+template <typename N, std::size_t CHUNK_SIZE>
+inline PixelSelector<N, CHUNK_SIZE> File::fetch(std::string_view query,
+                                                std::uint64_t max_diagonal_distance,
+                                                QUERY_TYPE query_type) const {
+  auto sel = this->fetch<N, CHUNK_SIZE>(query, query_type);
+  sel.set_max_diagonal_distance(max_diagonal_distance);
+  return sel;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline PixelSelector<N, CHUNK_SIZE> File::fetch(const PixelFilter &filter) const {
+  auto sel = this->fetch<N, CHUNK_SIZE>();
+  sel.set_filter(filter);
+  return sel;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline PixelSelector<N, CHUNK_SIZE> File::fetch(std::string_view query, const PixelFilter &filter,
+                                                QUERY_TYPE query_type) const {
+  auto sel = this->fetch<N, CHUNK_SIZE>(query, query_type);
+  sel.set_filter(filter);
+  return sel;
+}
+
 template <typename N, std::size_t CHUNK_SIZE>
 inline PixelSelector<N, CHUNK_SIZE> File::fetch(PixelCoordinates coord) const {
   // clang-format off
@@ -109,13 +155,15 @@ inline PixelSelector<N, CHUNK_SIZE> File::fetch(std::string_view range1, std::st
     return this->fetch<N, CHUNK_SIZE>(range1);
   }
 
+  const internal::TraceScope trace_scope{"coolerpp::File::fetch"};
+
   const auto gi1 = query_type == QUERY_TYPE::BED
                        ? GenomicInterval::parse_bed(this->chromosomes(), range1)
-                       : GenomicInterval::parse_ucsc(this->chromosomes(), std::string{range1});
+                       : GenomicInterval::parse_ucsc(this->chromosomes(), range1);
 
   const auto gi2 = query_type == QUERY_TYPE::BED
                        ? GenomicInterval::parse_bed(this->chromosomes(), range2)
-                       : GenomicInterval::parse_ucsc(this->chromosomes(), std::string{range2});
+                       : GenomicInterval::parse_ucsc(this->chromosomes(), range2);
 
   return this->fetch<N, CHUNK_SIZE>(PixelCoordinates{this->bins().at(gi1)},
                                     PixelCoordinates{this->bins().at(gi2)});
@@ -140,6 +188,96 @@ inline PixelSelector<N, CHUNK_SIZE> File::fetch(std::string_view chrom1, std::ui
   // clang-format on
 }
 
+template <typename N, std::size_t CHUNK_SIZE>
+inline SymmetricPixelSelector<N, CHUNK_SIZE> File::fetch(std::string_view query,
+                                                         SymmetryMode mode,
+                                                         QUERY_TYPE query_type) const {
+  return this->fetch<N, CHUNK_SIZE>(query, query, mode, query_type);
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline SymmetricPixelSelector<N, CHUNK_SIZE> File::fetch(std::string_view range1,
+                                                         std::string_view range2,
+                                                         SymmetryMode mode,
+                                                         QUERY_TYPE query_type) const {
+  auto parse_range = [&](std::string_view range) {
+    return query_type == QUERY_TYPE::BED
+               ? GenomicInterval::parse_bed(this->chromosomes(), range)
+               : GenomicInterval::parse_ucsc(this->chromosomes(), range);
+  };
+
+  PixelCoordinates coord1{this->bins().at(parse_range(range1))};
+  PixelCoordinates coord2{this->bins().at(parse_range(range2))};
+
+  const auto mirror =
+      mode == SymmetryMode::FULL &&
+      this->attributes().storage_mode.value_or("symmetric-upper") == "symmetric-upper";
+
+  // Select the smallest block of the upper triangle containing all pixels overlapping the query
+  // or its transpose
+  auto sel = [&]() {
+    if (!mirror) {
+      return this->fetch<N, CHUNK_SIZE>(coord1, coord2);
+    }
+    if (coord1 == coord2) {
+      return this->fetch<N, CHUNK_SIZE>(coord1);
+    }
+
+    const auto first_row = coord1.bin1.id();
+    const auto last_row = coord1.bin2.id();
+    const auto first_col = coord2.bin1.id();
+    const auto last_col = coord2.bin2.id();
+    if (first_row <= last_col && first_col <= last_row) {
+      // Overlapping ranges always belong to the same chromosome
+      return this->fetch<N, CHUNK_SIZE>(
+          PixelCoordinates{this->bins().at((std::min)(first_row, first_col)),
+                           this->bins().at((std::max)(last_row, last_col))});
+    }
+    // Pixels overlapping disjoint ranges are all found on the same side of the diagonal
+    return first_row < first_col ? this->fetch<N, CHUNK_SIZE>(coord1, coord2)
+                                 : this->fetch<N, CHUNK_SIZE>(coord2, coord1);
+  }();
+
+  return {std::move(sel), std::move(coord1), std::move(coord2), this->bins_ptr(), mirror};
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline std::future<std::vector<PixelBlock<N>>> File::fetch_async(std::string_view query,
+                                                                 QUERY_TYPE query_type) const {
+  return this->fetch_async(this->fetch<N, CHUNK_SIZE>(query, query_type));
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline std::future<std::vector<PixelBlock<N>>> File::fetch_async(std::string_view range1,
+                                                                 std::string_view range2,
+                                                                 QUERY_TYPE query_type) const {
+  return this->fetch_async(this->fetch<N, CHUNK_SIZE>(range1, range2, query_type));
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline std::future<std::vector<PixelBlock<N>>> File::fetch_async(
+    PixelSelector<N, CHUNK_SIZE> sel) const {
+  if (!internal::hdf5_library_is_threadsafe()) {
+    std::promise<std::vector<PixelBlock<N>>> blocks{};
+    try {
+      blocks.set_value(sel.read_batch());
+    } catch (...) {
+      blocks.set_exception(std::current_exception());
+    }
+    return blocks.get_future();
+  }
+
+  return this->query_pool().submit([sel = std::move(sel)]() { return sel.read_batch(); });
+}
+
+inline internal::QueryPool &File::query_pool() const {
+  [[maybe_unused]] const std::scoped_lock lck(*this->_query_pool_mtx);
+  if (!this->_query_pool) {
+    this->_query_pool = std::make_unique<internal::QueryPool>(this->_query_threads);
+  }
+  return *this->_query_pool;
+}
+
 template <typename N, std::size_t CHUNK_SIZE>
 inline PixelSelector<N, CHUNK_SIZE> File::fetch(PixelCoordinates coord1,
                                                 PixelCoordinates coord2) const {
@@ -154,13 +292,413 @@ inline PixelSelector<N, CHUNK_SIZE> File::fetch(PixelCoordinates coord1,
   // clang-format on
 }
 
+template <typename Visitor>
+inline decltype(auto) File::visit_pixels(Visitor &&visitor) const {
+  return std::visit(
+      [&](auto count) -> decltype(auto) {
+        using N = remove_cvref_t<decltype(count)>;
+        return visitor(this->fetch<N>());
+      },
+      this->_pixel_variant);
+}
+
+template <typename Visitor>
+inline decltype(auto) File::visit_pixels(Visitor &&visitor, std::string_view query,
+                                         QUERY_TYPE query_type) const {
+  return std::visit(
+      [&](auto count) -> decltype(auto) {
+        using N = remove_cvref_t<decltype(count)>;
+        return visitor(this->fetch<N>(query, query_type));
+      },
+      this->_pixel_variant);
+}
+
+template <typename Visitor>
+inline decltype(auto) File::visit_pixels(Visitor &&visitor, std::string_view range1,
+                                         std::string_view range2, QUERY_TYPE query_type) const {
+  return std::visit(
+      [&](auto count) -> decltype(auto) {
+        using N = remove_cvref_t<decltype(count)>;
+        return visitor(this->fetch<N>(range1, range2, query_type));
+      },
+      this->_pixel_variant);
+}
+
+template <typename N, std::size_t CHUNK_SIZE, typename PixelOp>
+inline void File::fetch_many(
+    const std::vector<std::pair<GenomicInterval, GenomicInterval>> &queries, PixelOp op) const {
+  struct Query {
+    std::size_t id;
+    std::uint64_t row_start;
+    std::uint64_t row_end;
+    std::uint64_t col_start;
+    std::uint64_t col_end;
+  };
+
+  std::vector<Query> sorted_queries(queries.size());
+  for (std::size_t i = 0; i < queries.size(); ++i) {
+    const auto [bin1, bin2] = this->bins().at(queries[i].first);
+    const auto [bin3, bin4] = this->bins().at(queries[i].second);
+    sorted_queries[i] = Query{i, bin1.id(), bin2.id(), bin3.id(), bin4.id()};
+  }
+  std::sort(sorted_queries.begin(), sorted_queries.end(), [](const Query &q1, const Query &q2) {
+    return std::make_tuple(q1.row_start, q1.row_end, q1.id) <
+           std::make_tuple(q2.row_start, q2.row_end, q2.id);
+  });
+
+  // Answer queries [first, last), sorted by row, with a single scan of the pixels overlapping the
+  // union of their rows and columns. Pixels are routed to all queries that are active for the
+  // current row and that overlap the pixel column
+  std::vector<const Query *> active_queries{};
+  auto scan = [&](auto first, auto last) {
+    auto row_end = first->row_end;
+    auto col_start = first->col_start;
+    auto col_end = first->col_end;
+    for (auto it = first; it != last; ++it) {
+      row_end = (std::max)(row_end, it->row_end);
+      col_start = (std::min)(col_start, it->col_start);
+      col_end = (std::max)(col_end, it->col_end);
+    }
+
+    const auto sel = this->fetch<N, CHUNK_SIZE>(
+        PixelCoordinates{this->bins().at(first->row_start), this->bins().at(row_end)},
+        PixelCoordinates{this->bins().at(col_start), this->bins().at(col_end)});
+
+    active_queries.clear();
+    auto next_query = first;
+    auto current_row = (std::numeric_limits<std::uint64_t>::max)();
+    std::for_each(sel.begin(), sel.end(), [&](const Pixel<N> &pixel) {
+      const auto row = pixel.coords.bin1.id();
+      const auto col = pixel.coords.bin2.id();
+      if (row != current_row) {
+        current_row = row;
+        active_queries.erase(
+            std::remove_if(active_queries.begin(), active_queries.end(),
+                           [&](const Query *q) { return q->row_end < row; }),
+            active_queries.end());
+        for (; next_query != last && next_query->row_start <= row; ++next_query) {
+          if (next_query->row_end >= row) {
+            active_queries.push_back(&*next_query);
+          }
+        }
+      }
+
+      for (const auto *q : active_queries) {
+        if (col >= q->col_start && col <= q->col_end) {
+          op(q->id, pixel);
+        }
+      }
+    });
+  };
+
+  // Queries whose rows overlap or are adjacent are answered with a single scan. When the union of
+  // their columns is much wider than the columns they actually overlap (e.g. queries for distant
+  // regions of the same rows), the scan would mostly read pixels that are discarded: queries are
+  // then split into clusters of overlapping columns, each answered by its own scan, so that
+  // pixels in between are skipped by seeking to the first column of each cluster within each row
+  constexpr std::uint64_t max_column_union_ratio = 4;
+  std::vector<Query> cluster{};
+  auto first_query = sorted_queries.begin();
+  while (first_query != sorted_queries.end()) {
+    auto last_query = first_query;
+    auto row_end = first_query->row_end;
+    auto col_start = first_query->col_start;
+    auto col_end = first_query->col_end;
+    auto col_width_sum = first_query->col_end - first_query->col_start + 1;
+    while (++last_query != sorted_queries.end() && last_query->row_start <= row_end + 1) {
+      row_end = (std::max)(row_end, last_query->row_end);
+      col_start = (std::min)(col_start, last_query->col_start);
+      col_end = (std::max)(col_end, last_query->col_end);
+      col_width_sum += last_query->col_end - last_query->col_start + 1;
+    }
+
+    if (col_end - col_start + 1 <= max_column_union_ratio * col_width_sum) {
+      scan(first_query, last_query);
+      first_query = last_query;
+      continue;
+    }
+
+    std::sort(first_query, last_query, [](const Query &q1, const Query &q2) {
+      return std::make_tuple(q1.col_start, q1.row_start, q1.row_end, q1.id) <
+             std::make_tuple(q2.col_start, q2.row_start, q2.row_end, q2.id);
+    });
+    for (auto it = first_query; it != last_query;) {
+      auto cluster_col_end = it->col_end;
+      auto cluster_end = it;
+      while (++cluster_end != last_query && cluster_end->col_start <= cluster_col_end + 1) {
+        cluster_col_end = (std::max)(cluster_col_end, cluster_end->col_end);
+      }
+      cluster.assign(it, cluster_end);
+      std::sort(cluster.begin(), cluster.end(), [](const Query &q1, const Query &q2) {
+        return std::make_tuple(q1.row_start, q1.row_end, q1.id) <
+               std::make_tuple(q2.row_start, q2.row_end, q2.id);
+      });
+      scan(cluster.begin(), cluster.end());
+      it = cluster_end;
+    }
+
+    first_query = last_query;
+  }
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline std::vector<N> File::lookup(
+    const std::vector<std::pair<std::uint64_t, std::uint64_t>> &bin_pairs) const {
+  static_assert(std::is_arithmetic_v<N>);
+  static_assert(CHUNK_SIZE != 0);
+
+  const auto num_bins = conditional_static_cast<std::uint64_t>(this->bins().size());
+  const auto symmetric_upper =
+      this->attributes().storage_mode.value_or("symmetric-upper") == "symmetric-upper";
+
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> keys(bin_pairs.size());
+  for (std::size_t i = 0; i < bin_pairs.size(); ++i) {
+    auto [bin1_id, bin2_id] = bin_pairs[i];
+    if (bin1_id >= num_bins || bin2_id >= num_bins) {
+      throw std::out_of_range(fmt::format(
+          FMT_STRING("lookup: pixel ({}, {}) is out of range: bin ids should be less than {}"),
+          bin1_id, bin2_id, num_bins));
+    }
+    if (symmetric_upper && bin1_id > bin2_id) {
+      std::swap(bin1_id, bin2_id);
+    }
+    keys[i] = std::make_pair(bin1_id, bin2_id);
+  }
+
+  std::vector<std::size_t> order(keys.size());
+  std::iota(order.begin(), order.end(), std::size_t(0));
+  std::sort(order.begin(), order.end(),
+            [&](std::size_t i1, std::size_t i2) { return keys[i1] < keys[i2]; });
+
+  std::vector<N> counts(keys.size(), N(0));
+  if (keys.empty()) {
+    return counts;
+  }
+
+  const auto &idx = this->index();
+  const auto &bin2_dset = this->dataset("pixels/bin2_id");
+  const auto &count_dset = this->dataset("pixels/count");
+
+  // Pixels in [buff_offset, buff_offset + bin2_buff.size()) are currently loaded. Counts are only
+  // read for blocks where at least one pixel was found
+  std::vector<std::uint64_t> bin2_buff{};
+  std::vector<N> count_buff{};
+  std::uint64_t buff_offset = 0;
+  bool counts_loaded = false;
+
+  auto first = order.begin();
+  while (first != order.end()) {
+    const auto row = keys[*first].first;
+    const auto last = std::find_if(first, order.end(),
+                                   [&](std::size_t i) { return keys[i].first != row; });
+
+    auto row_start = idx.get_offset_by_bin_id(row);
+    const auto row_end = row + 1 == num_bins ? idx.nnz() : idx.get_offset_by_bin_id(row + 1);
+
+    // Pixels in a row are sorted by bin2_id, so the search for the next pair can resume from the
+    // position of the previous one
+    for (auto it = first; it != last; ++it) {
+      const auto bin2_id = keys[*it].second;
+      while (row_start < row_end) {
+        if (row_start < buff_offset || row_start >= buff_offset + bin2_buff.size()) {
+          // Only read the pixels of the current row: rows are usually much shorter than
+          // CHUNK_SIZE, and the pixels of other rows are unlikely to be needed
+          buff_offset = row_start;
+          const auto size = conditional_static_cast<std::size_t>(
+              (std::min)(row_end - buff_offset, std::uint64_t(CHUNK_SIZE)));
+          bin2_dset.read(bin2_buff, size, buff_offset);
+          counts_loaded = false;
+        }
+
+        const auto buff_end = (std::min)(row_end, buff_offset + std::uint64_t(bin2_buff.size()));
+        const auto first_pixel = bin2_buff.begin() + std::ptrdiff_t(row_start - buff_offset);
+        const auto last_pixel = bin2_buff.begin() + std::ptrdiff_t(buff_end - buff_offset);
+        const auto match = std::lower_bound(first_pixel, last_pixel, bin2_id);
+        row_start = buff_offset + std::uint64_t(std::distance(bin2_buff.begin(), match));
+        if (match == last_pixel) {
+          // The rest of the row has not been loaded yet
+          continue;
+        }
+
+        if (*match == bin2_id) {
+          if (!counts_loaded) {
+            count_dset.read(count_buff, bin2_buff.size(), buff_offset);
+            counts_loaded = true;
+          }
+          counts[*it] = count_buff[row_start - buff_offset];
+        }
+        break;
+      }
+    }
+
+    first = last;
+  }
+
+  return counts;
+}
+
+template <typename N>
+inline void File::fetch_dense(std::string_view range1, std::string_view range2, N *out,
+                              std::size_t ld, QUERY_TYPE query_type) const {
+  this->fetch_dense<N, N>(
+      range1, range2,
+      [](std::uint64_t, std::uint64_t, N count) { return count; }, out, ld, query_type);
+}
+
+template <typename N>
+inline void File::fetch_dense(std::string_view range1, std::string_view range2,
+                              const Weights &weights, N *out, std::size_t ld,
+                              QUERY_TYPE query_type) const {
+  this->validate_dense_weights(weights);
+  this->fetch_dense<N, double>(
+      range1, range2,
+      [&](std::uint64_t bin1_id, std::uint64_t bin2_id, double count) {
+        double balanced_count{};
+        weights.balance(&bin1_id, &bin2_id, &count, 1, &balanced_count);
+        return balanced_count;
+      },
+      out, ld, query_type);
+}
+
+template <typename N>
+inline void File::fetch_dense(std::string_view range1, std::string_view range2,
+                              const ObservedOverExpectedOp &op, N *out, std::size_t ld,
+                              QUERY_TYPE query_type) const {
+  static_assert(std::is_floating_point_v<N>,
+                "fetch_dense: observed/expected ratios require a floating-point output buffer");
+  if (op.weights()) {
+    this->validate_dense_weights(*op.weights());
+  }
+  this->fetch_dense<N, double>(
+      range1, range2,
+      [&](std::uint64_t bin1_id, std::uint64_t bin2_id, double count) {
+        return op(bin1_id, bin2_id, count);
+      },
+      out, ld, query_type, op.log_transform());
+}
+
+inline void File::validate_dense_weights(const Weights &weights) const {
+  if (weights.size() != this->bins().size()) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("fetch_dense: expected {} weights, found {}"), this->bins().size(),
+                    weights.size()));
+  }
+}
+
+template <typename N, typename CountT, typename ValueOp>
+inline void File::fetch_dense(std::string_view range1, std::string_view range2, ValueOp get_value,
+                              N *out, std::size_t ld, QUERY_TYPE query_type,
+                              bool fill_absent_with_op) const {
+  static_assert(std::is_arithmetic_v<N>);
+  assert(out);
+
+  auto parse_range = [&](std::string_view range) {
+    return query_type == QUERY_TYPE::BED
+               ? GenomicInterval::parse_bed(this->chromosomes(), range)
+               : GenomicInterval::parse_ucsc(this->chromosomes(), range);
+  };
+
+  const PixelCoordinates coord1{this->bins().at(parse_range(range1))};
+  const PixelCoordinates coord2{this->bins().at(parse_range(range2))};
+
+  const auto row_offset = coord1.bin1.id();
+  const auto col_offset = coord2.bin1.id();
+  const auto num_rows = coord1.bin2.id() - row_offset + 1;
+  const auto num_cols = coord2.bin2.id() - col_offset + 1;
+
+  if (ld < num_cols) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("fetch_dense: ld should be >= {} (the number of columns), found {}"),
+                    num_cols, ld));
+  }
+
+  // Converting NaN or out-of-range floating-point values (e.g. balanced counts) to an integral
+  // type is undefined behavior: NaNs are stored as 0, while values out of range throw
+  auto to_value = [](auto value) {
+    using T = decltype(value);
+    if constexpr (std::is_integral_v<N> && std::is_floating_point_v<T>) {
+      if (std::isnan(value)) {
+        return N(0);
+      }
+      const auto lb = std::is_signed_v<N> ? -std::ldexp(T(1), std::numeric_limits<N>::digits)
+                                          : T(0);
+      const auto ub = std::ldexp(T(1), std::numeric_limits<N>::digits);
+      if (std::trunc(value) < lb || std::trunc(value) >= ub) {
+        throw std::runtime_error(
+            fmt::format(FMT_STRING("fetch_dense: value {} cannot be represented as {}"), value,
+                        internal::type_name<N>()));
+      }
+    }
+    return conditional_static_cast<N>(value);
+  };
+
+  // NOLINTBEGIN(*-pointer-arithmetic)
+  for (std::uint64_t i = 0; i < num_rows; ++i) {
+    if (!fill_absent_with_op) {
+      std::fill_n(out + (i * ld), num_cols, N(0));
+      continue;
+    }
+    for (std::uint64_t j = 0; j < num_cols; ++j) {
+      out[(i * ld) + j] = to_value(get_value(row_offset + i, col_offset + j, CountT(0)));
+    }
+  }
+  // NOLINTEND(*-pointer-arithmetic)
+
+  const auto symmetric_upper =
+      this->attributes().storage_mode.value_or("symmetric-upper") == "symmetric-upper";
+
+  // When transpose is true, pixels are written to (bin2, bin1) instead of (bin1, bin2).
+  // When mirror is true, pixels are written to both locations
+  auto scatter = [&](const PixelCoordinates &c1, const PixelCoordinates &c2, bool transpose,
+                     bool mirror) {
+    this->fetch<CountT, DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>(c1, c2).for_each_block(
+        [&](const PixelBlock<CountT> &blk) {
+          const auto bin1_ids = blk.bin1_ids();
+          const auto bin2_ids = blk.bin2_ids();
+          const auto counts = blk.counts();
+          // NOLINTBEGIN(*-pointer-arithmetic)
+          for (std::size_t i = 0; i < blk.size(); ++i) {
+            const auto bin1_id = bin1_ids[i];
+            const auto bin2_id = bin2_ids[i];
+            if (transpose && bin1_id == bin2_id) {
+              // Pixels on the diagonal are written by the upper-triangle pass
+              continue;
+            }
+            const auto value = to_value(get_value(bin1_id, bin2_id, counts[i]));
+            if (!transpose || mirror) {
+              out[((bin1_id - row_offset) * ld) + (bin2_id - col_offset)] = value;
+            }
+            if ((transpose || mirror) && bin1_id != bin2_id) {
+              out[((bin2_id - row_offset) * ld) + (bin1_id - col_offset)] = value;
+            }
+          }
+          // NOLINTEND(*-pointer-arithmetic)
+        });
+  };
+
+  if (coord1 == coord2) {
+    scatter(coord1, coord2, false, symmetric_upper);
+    return;
+  }
+
+  // Pixels with bin1_id <= bin2_id
+  if (row_offset <= coord2.bin2.id()) {
+    scatter(coord1, coord2, false, false);
+  }
+  // Pixels below the diagonal are read from the upper triangle
+  if (symmetric_upper && col_offset < coord1.bin2.id()) {
+    scatter(coord2, coord1, true, false);
+  }
+}
+
 inline bool File::has_weights(std::string_view name) const {
   const auto dset_path =
       fmt::format(FMT_STRING("{}/{}"), this->_groups.at("bins").group.getPath(), name);
+  // Weights are read from the file while holding the same lock
+  const std::scoped_lock lck(*this->_weights_mtx);
   if (this->_weights.contains(dset_path)) {
     return true;
   }
-
   return this->_root_group().exist(dset_path);
 }
 
@@ -173,15 +711,19 @@ inline std::shared_ptr<const Weights> File::read_weights(std::string_view name)
 }
 
 inline std::shared_ptr<const Weights> File::read_weights(std::string_view name,
-                                                         Weights::Type type) const {
+                                                         Weights::Type type,
+                                                         Weights::Precision precision) const {
   if (name.empty()) {
     throw std::runtime_error("weight dataset name is empty");
   }
 
   const auto dset_path =
       fmt::format(FMT_STRING("{}/{}"), this->_groups.at("bins").group.getPath(), name);
+  const std::scoped_lock lck(*this->_weights_mtx);
   if (const auto it = this->_weights.find(dset_path); it != this->_weights.end()) {
-    return it->second;
+    if (it->second->type() == type && it->second->precision() == precision) {
+      return it->second;
+    }
   }
 
   if (!this->_root_group().exist(dset_path)) {
@@ -190,17 +732,21 @@ inline std::shared_ptr<const Weights> File::read_weights(std::string_view name,
                     name, dset_path));
   }
 
-  const auto node = this->_weights.emplace(
-      name, std::make_shared<const Weights>(
-                *this->_bins,
-                Dataset{this->_root_group, dset_path,
-                        Dataset::init_access_props(DEFAULT_HDF5_CHUNK_SIZE,
-                                                   DEFAULT_HDF5_DATASET_CACHE_SIZE, 1.0)},
-                type));
-  return node.first->second;
+  auto weights = internal::WeightCache::instance().get_or_load(
+      this->path(), dset_path, type, precision, [&]() {
+        return std::make_shared<const Weights>(
+            *this->_bins,
+            Dataset{this->_root_group, dset_path,
+                    Dataset::init_access_props(DEFAULT_HDF5_CHUNK_SIZE,
+                                               DEFAULT_HDF5_DATASET_CACHE_SIZE, 1.0)},
+            type, false, precision);
+      });
+  this->_weights.insert_or_assign(dset_path, weights);
+  return weights;
 }
 
 inline bool File::purge_weights(std::string_view name) {
+  const std::scoped_lock lck(*this->_weights_mtx);
   if (this->_weights.empty()) {
     return false;
   }
@@ -208,7 +754,115 @@ inline bool File::purge_weights(std::string_view name) {
     this->_weights.clear();
     return true;
   }
-  return this->_weights.erase(std::string{name});
+  const auto dset_path =
+      fmt::format(FMT_STRING("{}/{}"), this->_groups.at("bins").group.getPath(), name);
+  return this->_weights.erase(dset_path);
+}
+
+inline bool File::has_chromosome_pair_stats() const {
+  if (this->_finalize) {
+    return this->_compute_chrom_pair_stats;
+  }
+  [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
+  return this->_root_group().exist("stats");
+}
+
+inline ChromosomePairStats File::read_chromosome_pair_stats() const {
+  if (this->_finalize && this->_compute_chrom_pair_stats) {
+    return this->_chrom_pair_stats;
+  }
+
+  if (!this->has_chromosome_pair_stats()) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("unable to read chromosome pair stats: Cooler at \"{}\" has no stats group"),
+        this->uri()));
+  }
+
+  return this->import_chromosome_pair_stats("stats");
+}
+
+inline ChromosomePairStats File::import_chromosome_pair_stats(std::string_view grp_path) const {
+  [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
+  auto read_dset = [&](std::string_view name, auto &buff) {
+    Dataset{this->_root_group, fmt::format(FMT_STRING("{}/{}"), grp_path, name)}.read_all(buff);
+  };
+  std::vector<std::uint32_t> chrom1_ids{};
+  std::vector<std::uint32_t> chrom2_ids{};
+  std::vector<std::uint64_t> nnz{};
+  std::vector<double> sum{};
+  read_dset("chrom1_id", chrom1_ids);
+  read_dset("chrom2_id", chrom2_ids);
+  read_dset("nnz", nnz);
+  read_dset("sum", sum);
+
+  if (chrom1_ids.size() != chrom2_ids.size() || chrom1_ids.size() != nnz.size() ||
+      chrom1_ids.size() != sum.size()) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("unable to read chromosome pair stats from \"{}\": datasets under the {} "
+                   "group have different shapes"),
+        this->uri(), grp_path));
+  }
+
+  ChromosomePairStats stats(static_cast<std::uint32_t>(this->chromosomes().size()));
+  for (std::size_t i = 0; i < chrom1_ids.size(); ++i) {
+    stats.add(chrom1_ids[i], chrom2_ids[i], ContactStats{sum[i], nnz[i]});
+  }
+  return stats;
+}
+
+inline bool File::has_bin_marginals() const {
+  if (this->_finalize) {
+    return !this->_marginal_sum_buff.empty();
+  }
+  [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
+  const auto &grp = this->_groups.at("bins").group;
+  return grp.exist("marginal_sum") && grp.exist("marginal_nnz");
+}
+
+inline std::shared_ptr<const std::vector<double>> File::read_bin_marginal_sum() const {
+  return this->read_bin_marginals("marginal_sum", this->_marginal_sum, this->_marginal_sum_buff);
+}
+
+inline std::shared_ptr<const std::vector<std::uint64_t>> File::read_bin_marginal_nnz() const {
+  return this->read_bin_marginals("marginal_nnz", this->_marginal_nnz, this->_marginal_nnz_buff);
+}
+
+template <typename T>
+inline std::shared_ptr<const std::vector<T>> File::read_bin_marginals(
+    std::string_view name, std::shared_ptr<const std::vector<T>> &cache,
+    const std::vector<T> &buff) const {
+  if (this->_finalize) {
+    if (buff.empty()) {
+      throw std::runtime_error(fmt::format(
+          FMT_STRING("unable to read bin marginals: Cooler at \"{}\" was not created with "
+                     "WriterOptions::compute_bin_marginals=true"),
+          this->uri()));
+    }
+    return std::make_shared<const std::vector<T>>(buff);
+  }
+
+  const std::scoped_lock lck(*this->_weights_mtx);
+  if (cache) {
+    return cache;
+  }
+
+  if (!this->has_bin_marginals()) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("unable to read bin marginals: Cooler at \"{}\" has no marginal datasets"),
+        this->uri()));
+  }
+
+  [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
+  const auto path = fmt::format(FMT_STRING("bins/{}"), name);
+  auto marginals = Dataset{this->_root_group, path}.read_all<std::vector<T>>();
+  if (marginals.size() != this->bins().size()) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("unable to read bin marginals from \"{}\": expected {} values, found {}"),
+        Dataset{this->_root_group, path}.uri(), this->bins().size(), marginals.size()));
+  }
+
+  cache = std::make_shared<const std::vector<T>>(std::move(marginals));
+  return cache;
 }
 
 inline auto File::open_root_group(const HighFive::File &f, std::string_view uri) -> RootGroup {
@@ -231,32 +885,103 @@ inline auto File::open_groups(const RootGroup &root_grp) -> GroupMap {
   return groups;
 }
 
-inline auto File::open_datasets(const RootGroup &root_grp, std::size_t cache_size_bytes, double w0)
+inline auto File::open_datasets(const RootGroup &root_grp, const CacheOptions &cache_options)
     -> DatasetMap {
+  const internal::TraceScope trace_scope{"coolerpp::File::open_datasets"};
+  if (cache_options.w0.has_value() && (*cache_options.w0 < 0.0 || *cache_options.w0 > 1.0)) {
+    throw std::logic_error(fmt::format(
+        FMT_STRING("w0 should be a value between 0 and 1, found {}"), *cache_options.w0));
+  }
+  if (cache_options.num_slots.has_value() && *cache_options.num_slots == 0) {
+    throw std::logic_error("num_slots cannot be 0");
+  }
+
+  [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
+
+  // Chunk cache properties can only be set when opening a dataset.
+  // Datasets other than pixels are read once (or not at all) when opening the file: open them
+  // right away with a cache holding up to DEFAULT_HDF5_CHUNK_SIZE bytes (larger chunks bypass the
+  // cache, which is fine when reading them once).
+  // The cache of pixel datasets is sized on their actual chunks: probe how they are chunked
+  // without setting up a Dataset, then open them using the final properties
+  struct DatasetInfo {
+    std::string_view name{};
+    std::size_t chunk_size_bytes{};
+    // Size of the dataset once decompressed, rounded up to a whole number of chunks
+    std::size_t max_size_bytes{};
+    std::size_t type_size{};
+  };
+
   DatasetMap datasets(MANDATORY_DATASET_NAMES.size());
+  std::vector<DatasetInfo> infos{};
+  const auto other_aprops =
+      Dataset::init_access_props(DEFAULT_HDF5_CHUNK_SIZE, DEFAULT_HDF5_CHUNK_SIZE, 1.0);
+  std::size_t other_datasets_cache_size = 0;
+  std::size_t pixels_type_size = 0;
+  for (const auto dataset_uri : MANDATORY_DATASET_NAMES) {
+    if (!starts_with(dataset_uri, "pixels")) {
+      const auto [it, _] = datasets.emplace(std::string{dataset_uri},
+                                            Dataset{root_grp, dataset_uri, other_aprops});
+      if (it->second.chunk_size() != 0) {
+        other_datasets_cache_size += DEFAULT_HDF5_CHUNK_SIZE;
+      }
+      continue;
+    }
 
-  const std::size_t num_pixel_datasets = 3;
-  const std::size_t num_read_once_dataset = MANDATORY_DATASET_NAMES.size() - num_pixel_datasets;
+    const auto dset = root_grp().getDataSet(std::string{dataset_uri});
+    const auto chunk_size = Dataset::chunk_size(dset);
+    const auto type_size = dset.getDataType().getSize();
+    const auto num_chunks =
+        chunk_size == 0 ? 0 : (dset.getElementCount() + chunk_size - 1) / chunk_size;
+    infos.emplace_back(DatasetInfo{
+        dataset_uri, chunk_size * type_size,
+        (std::max)(std::size_t(1), num_chunks) * chunk_size * type_size, type_size});
+    pixels_type_size += type_size;
+  }
 
-  const std::size_t read_once_cache_size = DEFAULT_HDF5_DATASET_CACHE_SIZE;
-  const std::size_t pixel_dataset_cache_size =
-      (cache_size_bytes - (read_once_cache_size * num_read_once_dataset)) / num_pixel_datasets;
+  // Chunk caches are shrunk when the process-wide memory budget is under pressure
+  const auto cache_size_bytes = MemoryBudget::instance().grant(cache_options.cache_size_bytes);
+  const auto pixels_cache_size = cache_size_bytes > other_datasets_cache_size
+                                     ? cache_size_bytes - other_datasets_cache_size
+                                     : std::size_t(0);
+
+  auto init_access_props = [&](const DatasetInfo &info) {
+    const auto chunk_size = info.chunk_size_bytes;
+    if (chunk_size == 0) {
+      // Contiguous and compact datasets do not go through the chunk cache
+      return HighFive::DataSetAccessProps{};
+    }
 
-  const auto default_aprop =
-      Dataset::init_access_props(DEFAULT_HDF5_CHUNK_SIZE, read_once_cache_size, 1.0);
-  const auto pixels_aprop = Dataset::init_access_props(
-      DEFAULT_HDF5_CHUNK_SIZE, (std::max(read_once_cache_size, pixel_dataset_cache_size)), w0);
+    // Split the budget so that all pixel datasets cache the same number of pixels
+    std::size_t cache_size = pixels_cache_size / pixels_type_size * info.type_size;
+    double w0 = 1.0;
+    switch (cache_options.profile) {
+      case AccessProfile::SEQUENTIAL:
+        // Cache the chunk being read and the next one, which may already be partially consumed
+        cache_size = (std::min)(cache_size, 2 * chunk_size);
+        break;
+      case AccessProfile::RANDOM:
+        w0 = DEFAULT_HDF5_CACHE_W0;
+        break;
+      case AccessProfile::BAND:
+        break;
+    }
 
-  [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
-  auto open_dataset = [&](const auto dataset_uri) {
-    return std::make_pair(
-        std::string{dataset_uri},
-        Dataset{root_grp, dataset_uri,
-                starts_with(dataset_uri, "pixels") ? pixels_aprop : default_aprop});
+    // Caches smaller than a chunk are bypassed by libhdf5, while there's no point in reserving
+    // space for more chunks than are stored in the dataset
+    cache_size = (std::min)(cache_size, info.max_size_bytes);
+    cache_size = (std::max)(chunk_size, cache_size - (cache_size % chunk_size));
+    w0 = cache_options.w0.value_or(w0);
+    if (cache_options.num_slots.has_value()) {
+      return Dataset::init_access_props(cache_size, w0, *cache_options.num_slots);
+    }
+    return Dataset::init_access_props(chunk_size, cache_size, w0);
   };
 
-  std::transform(MANDATORY_DATASET_NAMES.begin(), MANDATORY_DATASET_NAMES.end(),
-                 std::inserter(datasets, datasets.begin()), open_dataset);
+  for (const auto &info : infos) {
+    datasets.emplace(std::string{info.name},
+                     Dataset{root_grp, info.name, init_access_props(info)});
+  }
 
   return datasets;
 }
@@ -328,14 +1053,20 @@ inline auto File::read_standard_attributes(const RootGroup &root_grp, bool initi
   // Read mandatory attributes
   // We read format-version first because some attributes are mandatory only for cooler v3
   read_or_throw("format-version", attrs.format_version);
-  read_or_throw("bin-size", attrs.bin_size);
-  read_or_throw("format", attrs.format);
 
   // Read mandatory attributes for Cooler v3
   auto missing_ok = attrs.format_version < 3;
   read_optional("bin-type", attrs.bin_type, missing_ok);
   read_optional("storage-mode", attrs.storage_mode, missing_ok);
 
+  // Coolers with bins of variable size store "null" as bin-size
+  if (attrs.bin_type == "variable") {
+    attrs.bin_size = 0;
+  } else {
+    read_or_throw("bin-size", attrs.bin_size);
+  }
+  read_or_throw("format", attrs.format);
+
   // Try to read reserved attributes
   missing_ok = true;
   read_optional("creation-date", attrs.creation_date, missing_ok);
@@ -359,13 +1090,38 @@ inline auto File::read_standard_attributes(const RootGroup &root_grp, bool initi
   return attrs;
 }
 
+inline auto File::import_bins(const DatasetMap &datasets, const StandardAttributes &attrs)
+    -> std::shared_ptr<const BinTable> {
+  auto chroms = import_chroms(datasets.at("chroms/name"), datasets.at("chroms/length"), false);
+  if (attrs.bin_type != "variable") {
+    return std::make_shared<const BinTable>(std::move(chroms), attrs.bin_size);
+  }
+
+  try {
+    [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
+    std::vector<std::uint32_t> starts;
+    std::vector<std::uint32_t> ends;
+    datasets.at("bins/start").read_all(starts);
+    datasets.at("bins/end").read_all(ends);
+    return std::make_shared<const BinTable>(std::move(chroms), std::move(starts), std::move(ends));
+  } catch (const std::exception &e) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("Cooler file \"{}\" appears to be corrupted: failed to import bin table: {}"),
+        datasets.at("bins/start").file_name(), e.what()));
+  }
+}
+
 inline auto File::import_chroms(const Dataset &chrom_names, const Dataset &chrom_sizes,
                                 bool missing_ok) -> ChromosomeSet {
+  const internal::TraceScope trace_scope{"coolerpp::File::import_chroms"};
   try {
     [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
-    std::vector<std::string> names;
+    // Names are read into a single buffer to avoid allocating one string per chromosome before
+    // constructing the ChromosomeSet
+    std::string names_buff;
+    std::vector<std::string_view> names;
     std::vector<std::uint32_t> sizes;
-    chrom_names.read_all(names);
+    chrom_names.read(names, names_buff, chrom_names.size());
     chrom_sizes.read_all(sizes);
 
     if (names.size() != sizes.size()) {
@@ -389,7 +1145,8 @@ inline auto File::import_chroms(const Dataset &chrom_names, const Dataset &chrom
 inline Index File::import_indexes(const Dataset &chrom_offset_dset, const Dataset &bin_offset_dset,
                                   const ChromosomeSet &chroms,
                                   std::shared_ptr<const BinTable> bin_table,
-                                  std::uint64_t expected_nnz, bool missing_ok) {
+                                  std::uint64_t expected_nnz, bool missing_ok, bool lazy) {
+  const internal::TraceScope trace_scope{"coolerpp::File::import_indexes"};
   assert(bin_table);
   try {
     if (bin_offset_dset.empty()) {
@@ -408,18 +1165,61 @@ inline Index File::import_indexes(const Dataset &chrom_offset_dset, const Datase
 
     const auto chrom_offsets = internal::import_chrom_offsets(chrom_offset_dset, chroms.size() + 1);
 
+    if (lazy) {
+      // Offsets are read one chromosome at a time the first time they are accessed
+      auto loader = [dset = bin_offset_dset](std::uint64_t first_bin_id,
+                                             std::vector<std::uint64_t> &offsets) {
+        dset.read(offsets, offsets.size(), conditional_static_cast<std::size_t>(first_bin_id));
+      };
+      return Index{bin_table, std::move(loader), expected_nnz};
+    }
+
     Index idx{bin_table, expected_nnz};
 
-    std::size_t bin_id = 0;
-    std::for_each(bin_offset_dset.begin<std::uint64_t>(), bin_offset_dset.end<std::uint64_t>(),
-                  [&](std::uint64_t offset) {
-                    if (bin_id < bin_table->size()) {
-                      idx.set_offset_by_bin_id(bin_id++, offset);
-                    } else {
-                      // Last bin
-                      assert(bin_id == bin_table->size());
-                    }
-                  });
+    const auto offsets = bin_offset_dset.read_all<std::vector<std::uint64_t>>();
+    const auto &prefix_sum = bin_table->num_bin_prefix_sum();
+    for (std::uint32_t chrom_id = 0; chrom_id < chroms.size(); ++chrom_id) {
+      auto &dest = idx.at(chrom_id);
+      const auto first = offsets.begin() + std::ptrdiff_t(prefix_sum[chrom_id]);
+      std::copy(first, first + std::ptrdiff_t(dest.size()), dest.begin());
+    }
+
+    try {
+      idx.validate();
+    } catch (const std::exception &e) {
+      throw std::runtime_error(fmt::format(FMT_STRING("index validation failed: {}"), e.what()));
+    }
+
+    return idx;
+
+  } catch (const std::exception &e) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("Unable to import indexes for cooler at URI: \"{}\": {}"),
+                    bin_offset_dset.get_parent().uri(), e.what()));
+  }
+}
+
+inline Index File::import_partial_indexes(const Dataset &bin_offset_dset,
+                                          std::shared_ptr<const BinTable> bin_table) {
+  assert(bin_table);
+  try {
+    const auto offsets = bin_offset_dset.read_all<std::vector<std::uint64_t>>();
+    if (offsets.size() > bin_table->size() + 1) {
+      throw std::runtime_error(fmt::format(
+          FMT_STRING("failed to import offsets from {}: expected at most {} offsets, found {}"),
+          bin_offset_dset.hdf5_path(), bin_table->size() + 1, offsets.size()));
+    }
+
+    // The last offset points past the last pixel of the last row published by the writer
+    const auto nnz = offsets.empty() ? std::uint64_t(0) : offsets.back();
+    const auto num_rows = offsets.empty() ? std::size_t(0) : offsets.size() - 1;
+
+    Index idx{bin_table};
+    for (std::size_t bin_id = 0; bin_id < num_rows; ++bin_id) {
+      idx.set_offset_by_bin_id(bin_id, offsets[bin_id]);
+    }
+    // Rows that have not been published yet are empty
+    idx.finalize(nnz);
 
     try {
       idx.validate();
@@ -439,6 +1239,11 @@ inline Index File::import_indexes(const Dataset &chrom_offset_dset, const Datase
 inline bool File::check_sentinel_attr() { return File::check_sentinel_attr(this->_root_group()); }
 
 inline Bin File::get_last_bin_written() const {
+  if (this->_writer) {
+    // Datasets lag behind while pixels are being buffered
+    return this->_writer->empty() ? this->bins().at(0)
+                                  : this->bins().at(this->_writer->last_bin1_id());
+  }
   const auto &dset = this->dataset("pixels/bin1_id");
   if (dset.empty()) {
     return this->bins().at(0);
@@ -0,0 +1,288 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <highfive/H5DataSpace.hpp>
+#include <highfive/H5File.hpp>
+#include <highfive/H5Utility.hpp>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "coolerpp/common.hpp"
+#include "coolerpp/dataset.hpp"
+#include "coolerpp/pixel.hpp"
+
+namespace coolerpp {
+
+namespace internal {
+inline constexpr std::string_view TILE_GROUP_NAME{"tiles"};
+
+[[nodiscard]] constexpr std::uint64_t num_tiles_per_side(std::uint64_t num_bins,
+                                                        std::uint32_t tile_size) noexcept {
+  return (num_bins + tile_size - 1) / tile_size;
+}
+
+// Tiles are numbered in row-major order. When only the upper triangle is stored, rows of the grid
+// start at the diagonal tile
+[[nodiscard]] constexpr std::uint64_t tile_id(std::uint64_t x, std::uint64_t y, std::uint64_t n,
+                                              bool upper_triangle) noexcept {
+  if (!upper_triangle) {
+    return (x * n) + y;
+  }
+  assert(x <= y);
+  // Rows before x contain n, n - 1, ..., n - x + 1 tiles
+  return (x * n) - ((x * (x - 1)) / 2) + (y - x);
+}
+
+[[nodiscard]] constexpr std::uint64_t num_tiles(std::uint64_t n, bool upper_triangle) noexcept {
+  return upper_triangle ? (n * (n + 1)) / 2 : n * n;
+}
+}  // namespace internal
+
+inline bool File::has_tile_index() const {
+  return this->_root_group().exist(
+      fmt::format(FMT_STRING("{}/offset"), internal::TILE_GROUP_NAME));
+}
+
+inline std::uint32_t File::tile_size() const {
+  if (!this->has_tile_index()) {
+    return 0;
+  }
+  const Dataset dset(this->_root_group,
+                     fmt::format(FMT_STRING("{}/offset"), internal::TILE_GROUP_NAME));
+  return dset.read_attribute<std::uint32_t>("tile-size");
+}
+
+template <typename N>
+inline std::vector<ThinPixel<N>> File::fetch_tile(std::uint64_t x, std::uint64_t y) const {
+  static_assert(std::is_arithmetic_v<N>);
+  if (!this->has_tile_index()) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("{} does not have a tile index"), this->uri()));
+  }
+
+  const auto tile_size = this->tile_size();
+  const auto n = internal::num_tiles_per_side(this->bins().size(), tile_size);
+  if (x >= n || y >= n) {
+    throw std::out_of_range(fmt::format(
+        FMT_STRING("tile ({}, {}) is out of range: tiles should be between (0, 0) and ({}, {})"), x,
+        y, n - 1, n - 1));
+  }
+
+  const auto upper_triangle =
+      this->attributes().storage_mode.value_or("symmetric-upper") == "symmetric-upper";
+  const auto transpose = upper_triangle && x > y;
+  const auto mirror = upper_triangle && x == y;
+  if (transpose) {
+    std::swap(x, y);
+  }
+
+  const auto prefix = internal::TILE_GROUP_NAME;
+  const Dataset offset_dset(this->_root_group, fmt::format(FMT_STRING("{}/offset"), prefix));
+  // Tiles become stale when pixels are added to the file after building the index
+  const auto index_nnz = offset_dset.has_attribute("nnz")
+                             ? offset_dset.read_attribute<std::uint64_t>("nnz")
+                             : (std::numeric_limits<std::uint64_t>::max)();
+  if (index_nnz != this->index().nnz()) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("tile index of {} is out of date: rebuild it with File::build_tile_index()"),
+        this->uri()));
+  }
+
+  std::vector<std::uint64_t> offsets{};
+  offset_dset.read(offsets, 2, internal::tile_id(x, y, n, upper_triangle));
+  assert(offsets.size() == 2);
+  const auto offset = offsets.front();
+  const auto size = conditional_static_cast<std::size_t>(offsets.back() - offset);
+
+  std::vector<ThinPixel<N>> pixels(size);
+  if (size == 0) {
+    return pixels;
+  }
+
+  std::vector<std::uint64_t> bin1_ids{};
+  std::vector<std::uint64_t> bin2_ids{};
+  std::vector<N> counts{};
+  Dataset(this->_root_group, fmt::format(FMT_STRING("{}/bin1_id"), prefix))
+      .read(bin1_ids, size, offset);
+  Dataset(this->_root_group, fmt::format(FMT_STRING("{}/bin2_id"), prefix))
+      .read(bin2_ids, size, offset);
+  Dataset(this->_root_group, fmt::format(FMT_STRING("{}/count"), prefix))
+      .read(counts, size, offset);
+
+  for (std::size_t i = 0; i < size; ++i) {
+    pixels[i] = transpose ? ThinPixel<N>{bin2_ids[i], bin1_ids[i], counts[i]}
+                          : ThinPixel<N>{bin1_ids[i], bin2_ids[i], counts[i]};
+  }
+  // Diagonal tiles only store their upper triangle: fill the lower triangle so that diagonal tiles
+  // cover the same square of the matrix as transposed tiles
+  if (mirror) {
+    for (std::size_t i = 0; i < size; ++i) {
+      if (bin1_ids[i] != bin2_ids[i]) {
+        pixels.emplace_back(ThinPixel<N>{bin2_ids[i], bin1_ids[i], counts[i]});
+      }
+    }
+  }
+  if (transpose || mirror) {
+    std::sort(pixels.begin(), pixels.end());
+  }
+  return pixels;
+}
+
+inline void File::build_tile_index(std::string_view uri, std::uint32_t tile_size,
+                                   bool overwrite_if_exists) {
+  File(uri, HighFive::File::ReadWrite).build_tile_index(tile_size, overwrite_if_exists);
+}
+
+inline void File::build_tile_index(std::uint32_t tile_size, bool overwrite_if_exists) {
+  if (this->_mode == HighFive::File::ReadOnly) {
+    throw std::runtime_error(
+        "File::build_tile_index() was called on a file open in read-only mode");
+  }
+  if (tile_size == 0) {
+    throw std::logic_error("tile_size should be greater than 0");
+  }
+
+  const std::string grp_name{internal::TILE_GROUP_NAME};
+  if (this->_root_group().exist(grp_name)) {
+    if (!overwrite_if_exists) {
+      throw std::runtime_error(fmt::format(
+          FMT_STRING("unable to build tile index for {}: group {} already exists"), this->uri(),
+          grp_name));
+    }
+    this->_root_group().unlink(grp_name);
+  }
+  this->_root_group().createGroup(grp_name);
+
+  std::visit(
+      [&](auto count) {
+        using N = remove_cvref_t<decltype(count)>;
+        this->write_tile_index<N>(tile_size);
+      },
+      this->_pixel_variant);
+  this->_root_group().getFile().flush();
+}
+
+template <typename N>
+inline void File::write_tile_index(std::uint32_t tile_size) {
+  const auto prefix = internal::TILE_GROUP_NAME;
+  Dataset bin1_dset(this->_root_group, fmt::format(FMT_STRING("{}/bin1_id"), prefix),
+                    std::uint64_t{});
+  Dataset bin2_dset(this->_root_group, fmt::format(FMT_STRING("{}/bin2_id"), prefix),
+                    std::uint64_t{});
+  Dataset count_dset(this->_root_group, fmt::format(FMT_STRING("{}/count"), prefix), N{});
+  Dataset offset_dset(this->_root_group, fmt::format(FMT_STRING("{}/offset"), prefix),
+                      std::uint64_t{});
+
+  const auto upper_triangle =
+      this->attributes().storage_mode.value_or("symmetric-upper") == "symmetric-upper";
+  const auto num_bins = conditional_static_cast<std::uint64_t>(this->bins().size());
+  const auto n = internal::num_tiles_per_side(num_bins, tile_size);
+  const auto &idx = this->index();
+  const auto nnz = idx.nnz();
+
+  const auto &pixel_bin1_dset = this->dataset("pixels/bin1_id");
+  const auto &pixel_bin2_dset = this->dataset("pixels/bin2_id");
+  const auto &pixel_count_dset = this->dataset("pixels/count");
+
+  std::vector<std::uint64_t> bin1_buff{};
+  std::vector<std::uint64_t> bin2_buff{};
+  std::vector<N> count_buff{};
+  std::vector<std::uint64_t> tile_bin1_buff{};
+  std::vector<std::uint64_t> tile_bin2_buff{};
+  std::vector<N> tile_count_buff{};
+  std::vector<std::uint64_t> tile_sizes{};
+
+  std::vector<std::uint64_t> offsets{0};
+  offsets.reserve(internal::num_tiles(n, upper_triangle) + 1);
+
+  // Rows of tiles are processed one at a time: the pixels of a row of tiles are contiguous in the
+  // pixel table, and are distributed across tiles using a stable counting sort on the tile column,
+  // so that pixels within each tile remain sorted by bin1_id and bin2_id
+  for (std::uint64_t x = 0; x < n; ++x) {
+    const auto first_row = x * tile_size;
+    const auto last_row = (std::min)(num_bins, first_row + tile_size);
+    const auto first_offset = idx.get_offset_by_bin_id(first_row);
+    const auto last_offset = last_row == num_bins ? nnz : idx.get_offset_by_bin_id(last_row);
+    const auto size = conditional_static_cast<std::size_t>(last_offset - first_offset);
+
+    if (size == 0) {
+      bin1_buff.clear();
+      bin2_buff.clear();
+      count_buff.clear();
+    } else {
+      pixel_bin1_dset.read(bin1_buff, size, first_offset);
+      pixel_bin2_dset.read(bin2_buff, size, first_offset);
+      pixel_count_dset.read(count_buff, size, first_offset);
+    }
+
+    const auto first_col = upper_triangle ? x : 0;
+    tile_sizes.assign(n - first_col, 0);
+    for (const auto bin2_id : bin2_buff) {
+      const auto y = bin2_id / tile_size;
+      if (y < first_col) {
+        throw std::runtime_error(fmt::format(
+            FMT_STRING("unable to build tile index for {}: found pixel below the diagonal while "
+                       "storage mode is symmetric-upper"),
+            this->uri()));
+      }
+      ++tile_sizes[y - first_col];
+    }
+
+    std::vector<std::size_t> tile_offsets(tile_sizes.size(), 0);
+    for (std::size_t i = 1; i < tile_sizes.size(); ++i) {
+      tile_offsets[i] =
+          tile_offsets[i - 1] + conditional_static_cast<std::size_t>(tile_sizes[i - 1]);
+    }
+
+    tile_bin1_buff.resize(size);
+    tile_bin2_buff.resize(size);
+    tile_count_buff.resize(size);
+    for (std::size_t i = 0; i < size; ++i) {
+      const auto j = tile_offsets[(bin2_buff[i] / tile_size) - first_col]++;
+      tile_bin1_buff[j] = bin1_buff[i];
+      tile_bin2_buff[j] = bin2_buff[i];
+      tile_count_buff[j] = count_buff[i];
+    }
+
+    for (const auto tile_nnz : tile_sizes) {
+      offsets.push_back(offsets.back() + tile_nnz);
+    }
+
+    if (size != 0) {
+      bin1_dset.append(tile_bin1_buff);
+      bin2_dset.append(tile_bin2_buff);
+      count_dset.append(tile_count_buff);
+    }
+  }
+
+  assert(offsets.size() == internal::num_tiles(n, upper_triangle) + 1);
+  assert(offsets.back() == nnz);
+  offset_dset.append(offsets);
+  offset_dset.write_attribute("tile-size", tile_size);
+  offset_dset.write_attribute("nnz", nnz);
+}
+
+inline void File::remove_tile_index() {
+  [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
+  const std::string grp_name{internal::TILE_GROUP_NAME};
+  if (this->_root_group().exist(grp_name)) {
+    this->_root_group().unlink(grp_name);
+  }
+}
+
+}  // namespace coolerpp
@@ -8,23 +8,59 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <filesystem>
 #include <highfive/H5Exception.hpp>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <type_traits>
 #include <utility>
 #include <variant>
+#include <vector>
 
+#include "coolerpp/trace.hpp"
 #include "coolerpp/validation.hpp"
 
 namespace coolerpp {
 
-inline void File::validate_bins() const {
+namespace internal {
+
+// Return true when the given bins match the bins of a chromosome partitioned into bins of fixed
+// size. The loop does not exit early, so that it can be vectorized
+[[nodiscard]] inline bool chrom_bins_match(const std::uint32_t *chrom_ids,
+                                           const std::uint32_t *starts, const std::uint32_t *ends,
+                                           std::size_t num_bins, std::uint32_t chrom_id,
+                                           std::uint32_t chrom_size,
+                                           std::uint32_t bin_size) noexcept {
+  std::uint32_t mismatches = 0;
+  for (std::size_t i = 0; i < num_bins; ++i) {
+    const auto start = static_cast<std::uint64_t>(i) * bin_size;
+    const auto end = (std::min)(start + bin_size, static_cast<std::uint64_t>(chrom_size));
+    mismatches |= (chrom_ids[i] ^ chrom_id) | (starts[i] ^ static_cast<std::uint32_t>(start)) |
+                  (ends[i] ^ static_cast<std::uint32_t>(end));
+  }
+  return mismatches == 0;
+}
+
+}  // namespace internal
+
+inline void File::validate() const {
+  const auto status = utils::is_cooler(this->_root_group());
+  if (!status) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("\"{}\" does not look like a valid Cooler file:\n"
+                               "Validation report:\n{}"),
+                    this->uri(), status));
+  }
+  this->validate_bins();
+}
+
+inline void File::validate_bins(bool full) const {
+  const internal::TraceScope trace_scope{"coolerpp::File::validate_bins"};
   try {
-    assert(this->_attrs.bin_type == "fixed");
     auto nchroms = this->dataset("bins/chrom").size();
     auto nstarts = this->dataset("bins/start").size();
     auto nends = this->dataset("bins/end").size();
@@ -43,32 +79,78 @@ inline void File::validate_bins() const {
           fmt::format(FMT_STRING("Expected {} bins, found {}"), this->bins().size(), nchroms));
     }
 
-    auto chrom_it = this->dataset("bins/chrom").begin<std::uint32_t>();
-    auto start_it = this->dataset("bins/start").begin<std::uint32_t>();
-    auto end_it = this->dataset("bins/end").begin<std::uint32_t>();
-
-    auto last_chrom = this->dataset("bins/chrom").end<std::uint32_t>();
-    auto last_start = this->dataset("bins/start").end<std::uint32_t>();
-    auto last_end = this->dataset("bins/end").end<std::uint32_t>();
+    if (!full) {
+      return;
+    }
 
-    std::size_t i = 0;
-    for (const Bin &bin : this->bins()) {
-      if (chrom_it == last_chrom || start_it == last_start || end_it == last_end) {
-        throw std::runtime_error(
-            fmt::format(FMT_STRING("Expected {} bins, found {}"), this->bins().size(), i));
+    // Bins are read in bulk and compared with the bins expected for each chromosome, which are
+    // computed on the fly. Chromosomes are validated in parallel.
+    // Tables with bins of variable size are built from bins/start and bins/end, which are
+    // validated by the BinTable ctor: for these tables we only need to check bins/chrom
+    const auto chrom_ids = this->dataset("bins/chrom").read_all<std::vector<std::uint32_t>>();
+    const auto starts = this->dataset("bins/start").read_all<std::vector<std::uint32_t>>();
+    const auto ends = this->dataset("bins/end").read_all<std::vector<std::uint32_t>>();
+    assert(chrom_ids.size() == nbins);
+    assert(starts.size() == nbins);
+    assert(ends.size() == nbins);
+
+    const auto &chroms = this->chromosomes();
+    const auto &prefix_sum = this->bins().num_bin_prefix_sum();
+    assert(prefix_sum.size() == chroms.size() + 1);
+    const auto variable_bins = this->bins().type() == BinTable::Type::VARIABLE;
+    std::vector<std::uint8_t> valid(chroms.size(), true);
+    auto validate_chroms = [&](std::size_t first_chrom, std::size_t stride) {
+      for (std::size_t i = first_chrom; i < chroms.size(); i += stride) {
+        const auto offset = static_cast<std::size_t>(prefix_sum[i] - prefix_sum.front());
+        const auto num_bins = static_cast<std::size_t>(prefix_sum[i + 1] - prefix_sum[i]);
+        const auto &chrom = *(chroms.begin() + std::ptrdiff_t(i));
+        if (variable_bins) {
+          const auto first_chrom_id = chrom_ids.begin() + std::ptrdiff_t(offset);
+          valid[i] = std::all_of(first_chrom_id, first_chrom_id + std::ptrdiff_t(num_bins),
+                                 [&](std::uint32_t chrom_id) { return chrom_id == chrom.id(); });
+          continue;
+        }
+        valid[i] = internal::chrom_bins_match(chrom_ids.data() + offset, starts.data() + offset,
+                                              ends.data() + offset, num_bins, chrom.id(),
+                                              chrom.size(), this->bin_size());
       }
+    };
+
+    constexpr std::size_t min_bins_per_thread = 1'000'000;
+    const auto num_threads = (std::min)(
+        {static_cast<std::size_t>((std::max)(1U, std::thread::hardware_concurrency())),
+         (nbins / min_bins_per_thread) + 1, chroms.size()});
+    std::vector<std::thread> threads{};
+    threads.reserve(num_threads - 1);
+    for (std::size_t i = 1; i < num_threads; ++i) {
+      threads.emplace_back(validate_chroms, i, num_threads);
+    }
+    validate_chroms(0, num_threads);
+    for (auto &t : threads) {
+      t.join();
+    }
+
+    const auto it = std::find(valid.begin(), valid.end(), false);
+    if (it == valid.end()) {
+      return;
+    }
 
-      if (this->chromosomes().at(*chrom_it).name() != bin.chrom().name() ||
-          *start_it != bin.start() || *end_it != bin.end()) {
+    // Find the first bin that does not match the bin table
+    const auto first_invalid_chrom = static_cast<std::size_t>(std::distance(valid.begin(), it));
+    const auto offset =
+        static_cast<std::size_t>(prefix_sum[first_invalid_chrom] - prefix_sum.front());
+    for (std::size_t i = offset; i < nbins; ++i) {
+      const auto bin = this->bins().at(i);
+      if (chrom_ids[i] != bin.chrom().id() || starts[i] != bin.start() || ends[i] != bin.end()) {
+        const auto chrom_name = chroms.contains(chrom_ids[i])
+                                    ? std::string{chroms.at(chrom_ids[i]).name()}
+                                    : fmt::to_string(chrom_ids[i]);
         throw std::runtime_error(
             fmt::format(FMT_STRING("GenomicInterval #{}: expected {}:{}-{}, found {:ucsc}"), i,
-                        this->chromosomes().at(*chrom_it).name(), *start_it, *end_it, bin));
+                        chrom_name, starts[i], ends[i], bin));
       }
-      ++chrom_it;
-      ++start_it;
-      ++end_it;
-      ++i;
     }
+    unreachable_code();
 
   } catch (const HighFive::Exception &e) {
     throw std::runtime_error(
@@ -77,62 +159,42 @@ inline void File::validate_bins() const {
   }
 }
 
-template <typename PixelIt>
-inline void File::validate_pixels_before_append(PixelIt first_pixel, PixelIt last_pixel) const {
-  using PixelT = typename std::iterator_traits<PixelIt>::value_type;
-  using T = decltype(std::declval<PixelT>().count);
+template <typename N>
+inline void File::validate_pixel_columns_before_append(const std::uint64_t *bin1_ids,
+                                                       const std::uint64_t *bin2_ids,
+                                                       const N *counts, std::size_t n) const {
+  assert(n != 0);
   try {
-    std::for_each(first_pixel, last_pixel, [&](const Pixel<T> &pixel) {
-      if (pixel.count == T{0}) {
+    const auto num_bins = this->bins().size();
+    for (std::size_t i = 0; i < n; ++i) {
+      if (counts[i] == N{0}) {
         throw std::runtime_error("found a pixel of value 0");
       }
-
-      if (!this->chromosomes().contains(pixel.coords.bin1.chrom().id())) {
-        throw std::runtime_error(
-            fmt::format(FMT_STRING("invalid chromosome id {}"), pixel.coords.bin1.chrom().id()));
-      }
-
-      if (pixel.coords.bin1.chrom().id() != pixel.coords.bin2.chrom().id() &&
-          !this->chromosomes().contains(pixel.coords.bin2.chrom().id())) {
-        throw std::runtime_error(
-            fmt::format(FMT_STRING("invalid chromosome id {}"), pixel.coords.bin2.chrom().id()));
-      }
-
-      if (const auto bin_id = pixel.coords.bin1.id(); bin_id > this->bins().size()) {
+      if (bin1_ids[i] >= num_bins || bin2_ids[i] >= num_bins) {
         throw std::runtime_error(fmt::format(
-            FMT_STRING("invalid bin id {}: bin maps outside of the bin table"), bin_id));
+            FMT_STRING("invalid bin id {}: bin maps outside of the bin table"),
+            (std::max)(bin1_ids[i], bin2_ids[i])));
       }
-
-      if (const auto bin_id = pixel.coords.bin2.id(); bin_id > this->bins().size()) {
-        throw std::runtime_error(fmt::format(
-            FMT_STRING("invalid bin id {}: bin maps outside of the bin table"), bin_id));
-      }
-
-      if (pixel.coords.bin1.id() > pixel.coords.bin2.id()) {
+      if (bin1_ids[i] > bin2_ids[i]) {
         throw std::runtime_error(fmt::format(FMT_STRING("bin1_id is greater than bin2_id: {} > {}"),
-                                             pixel.coords.bin1.id(), pixel.coords.bin2.id()));
+                                             bin1_ids[i], bin2_ids[i]));
       }
-    });
+      if (i != 0 && (bin1_ids[i - 1] > bin1_ids[i] ||
+                     (bin1_ids[i - 1] == bin1_ids[i] && bin2_ids[i - 1] >= bin2_ids[i]))) {
+        throw std::runtime_error(
+            fmt::format(FMT_STRING("pixels are not sorted: found ({}, {}) after ({}, {})"),
+                        bin1_ids[i], bin2_ids[i], bin1_ids[i - 1], bin2_ids[i - 1]));
+      }
+    }
 
     if (!this->dataset("pixels/bin1_id").empty()) {
-      const auto last_bin1 = this->dataset("pixels/bin1_id").read_last<std::size_t>();
-      const auto last_bin2 = this->dataset("pixels/bin2_id").read_last<std::size_t>();
-
-      const auto new_bin1 = first_pixel->coords.bin1.id();
-      const auto new_bin2 = first_pixel->coords.bin2.id();
-
-      if (last_bin1 == new_bin1) {
-        if (last_bin2 >= new_bin2) {
-          const auto coord1 = this->bins().at(new_bin2);
-          const auto coord2 = this->bins().at(last_bin2);
-          throw std::runtime_error(fmt::format(
-              FMT_STRING("new pixel {} is located upstream of pixel {}"), coord1, coord2));
-        }
-      } else if (last_bin1 >= new_bin1) {
-        const auto coord1 = this->bins().at(new_bin1);
-        const auto coord2 = this->bins().at(last_bin1);
+      const auto last_bin1 = this->dataset("pixels/bin1_id").read_last<std::uint64_t>();
+      const auto last_bin2 = this->dataset("pixels/bin2_id").read_last<std::uint64_t>();
+      if (last_bin1 > bin1_ids[0] || (last_bin1 == bin1_ids[0] && last_bin2 >= bin2_ids[0])) {
         throw std::runtime_error(fmt::format(
-            FMT_STRING("new pixel {} is located upstream of pixel {}"), coord1, coord2));
+            FMT_STRING("new pixel {} is located upstream of pixel {}"),
+            PixelCoordinates{this->bins().at(bin1_ids[0]), this->bins().at(bin2_ids[0])},
+            PixelCoordinates{this->bins().at(last_bin1), this->bins().at(last_bin2)}));
       }
     }
   } catch (const std::exception &e) {
@@ -14,18 +14,28 @@
 #include <highfive/H5File.hpp>
 #include <highfive/H5Group.hpp>
 #include <highfive/H5Utility.hpp>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <type_traits>
 #include <utility>
 #include <variant>
+#include <vector>
 
 #include "coolerpp/attribute.hpp"
 #include "coolerpp/bin_table.hpp"
 #include "coolerpp/chromosome.hpp"
+#include "coolerpp/chromosome_pair_stats.hpp"
 #include "coolerpp/dataset.hpp"
 #include "coolerpp/group.hpp"
+#include "coolerpp/internal/weight_cache.hpp"
+#include "coolerpp/memory_budget.hpp"
+#include "coolerpp/pixel.hpp"
+#include "coolerpp/trace.hpp"
 #include "coolerpp/uri.hpp"
 
 namespace coolerpp {
@@ -39,41 +49,637 @@ inline void File::append_pixels(PixelIt first_pixel, PixelIt last_pixel, bool va
     this->validate_pixel_type<T>();
   }
 
-  this->update_indexes(first_pixel, last_pixel);
-
-  if (validate) {
-    this->validate_pixels_before_append(first_pixel, last_pixel);
+  if (first_pixel == last_pixel) {
+    return;
   }
 
-  this->dataset("pixels/bin1_id").append(first_pixel, last_pixel, [&](const Pixel<T> &pixel) {
-    return pixel.coords.bin1.id();
-  });
+  const internal::TraceScope trace_scope{"coolerpp::File::append_pixels"};
+  // Pixels are traversed only once: each pixel is validated, used to update the index and the
+  // statistics computed while appending, and copied into column buffers that are written once
+  // they are full
+  const auto num_bins = this->bins().size();
+  std::uint32_t chrom1_id = 0;
+  std::uint32_t chrom2_id = 0;
+
+  auto nnz = static_cast<std::uint64_t>(*this->_attrs.nnz);
+  std::uint64_t prev_bin1_id = 0;
+  std::uint64_t prev_bin2_id = 0;
+  bool first_in_batch = true;
+  const auto check_order = validate && nnz != 0;
+  if (check_order) {
+    if (this->_writer) {
+      // Validation needs to look at the last pixel written to the file
+      this->_writer->flush();
+    }
+    prev_bin1_id = this->dataset("pixels/bin1_id").read_last<std::uint64_t>();
+    prev_bin2_id = this->dataset("pixels/bin2_id").read_last<std::uint64_t>();
+  }
+  auto current_row = this->get_last_bin_written().id();
 
-  this->dataset("pixels/bin2_id").append(first_pixel, last_pixel, [&](const Pixel<T> &pixel) {
-    return pixel.coords.bin2.id();
-  });
+  // Return a description of the problem when the pixel cannot be appended
+  auto validate_pixel = [&](std::uint64_t bin1_id, std::uint64_t bin2_id) -> std::string {
+    if (bin1_id >= num_bins || bin2_id >= num_bins) {
+      return fmt::format(FMT_STRING("invalid bin id {}: bin maps outside of the bin table"),
+                         (std::max)(bin1_id, bin2_id));
+    }
+    if (bin1_id > bin2_id) {
+      return fmt::format(FMT_STRING("bin1_id is greater than bin2_id: {} > {}"), bin1_id,
+                         bin2_id);
+    }
+    if ((check_order || !first_in_batch) &&
+        (prev_bin1_id > bin1_id || (prev_bin1_id == bin1_id && prev_bin2_id >= bin2_id))) {
+      if (first_in_batch) {
+        return fmt::format(FMT_STRING("new pixel {} is located upstream of pixel {}"),
+                           PixelCoordinates{this->bins().at(bin1_id), this->bins().at(bin2_id)},
+                           PixelCoordinates{this->bins().at(prev_bin1_id),
+                                            this->bins().at(prev_bin2_id)});
+      }
+      return fmt::format(FMT_STRING("pixels are not sorted: found ({}, {}) after ({}, {})"),
+                         bin1_id, bin2_id, prev_bin1_id, prev_bin2_id);
+    }
+    return {};
+  };
 
   T sum = 0;
   T cis_sum = 0;
-  this->dataset("pixels/count").append(first_pixel, last_pixel, [&](const Pixel<T> &pixel) {
-    if (pixel.count == 0) {
-      throw std::runtime_error(
-          fmt::format(FMT_STRING("Found pixel with 0 interactions: {}"), pixel.coords));
+  internal::ChromosomePairStatsAccumulator chrom_pair_stats{this->_chrom_pair_stats};
+  const auto compute_stats = this->_compute_chrom_pair_stats;
+  const auto compute_marginals = !this->_marginal_sum_buff.empty();
+
+  constexpr std::size_t buffer_capacity = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE;
+  std::vector<std::uint64_t> bin1_buff{};
+  std::vector<std::uint64_t> bin2_buff{};
+  std::vector<T> count_buff{};
+  bin1_buff.reserve(buffer_capacity);
+  bin2_buff.reserve(buffer_capacity);
+  count_buff.reserve(buffer_capacity);
+
+  // Sums are committed together with the pixels they refer to, so that the file remains
+  // consistent when an invalid pixel is found
+  auto flush_buffers = [&]() {
+    if (bin1_buff.empty()) {
+      return;
+    }
+    if (this->_writer) {
+      for (std::size_t i = 0; i < bin1_buff.size(); ++i) {
+        this->_writer->append(bin1_buff[i], bin2_buff[i], count_buff[i]);
+      }
+      this->_attrs.nnz = static_cast<std::int64_t>(this->_writer->size());
+    } else {
+      this->dataset("pixels/bin1_id").append(bin1_buff.begin(), bin1_buff.end());
+      this->dataset("pixels/bin2_id").append(bin2_buff.begin(), bin2_buff.end());
+      this->dataset("pixels/count").append(count_buff.begin(), count_buff.end());
+      this->_attrs.nnz = static_cast<std::int64_t>(this->dataset("pixels/bin1_id").size());
+    }
+    this->update_pixel_sum(sum);
+    this->update_pixel_sum<T, true>(cis_sum);
+    chrom_pair_stats.flush();
+    sum = 0;
+    cis_sum = 0;
+    bin1_buff.clear();
+    bin2_buff.clear();
+    count_buff.clear();
+  };
+
+  for (; first_pixel != last_pixel; ++first_pixel) {
+    const auto &pixel = *first_pixel;
+    std::uint64_t bin1_id{};
+    std::uint64_t bin2_id{};
+    if constexpr (is_thin_pixel_v<PixelT>) {
+      bin1_id = pixel.bin1_id;
+      bin2_id = pixel.bin2_id;
+    } else {
+      bin1_id = pixel.coords.bin1.id();
+      bin2_id = pixel.coords.bin2.id();
+    }
+
+    std::string err{};
+    if (validate) {
+      err = validate_pixel(bin1_id, bin2_id);
+    }
+    if (err.empty() && pixel.count == T{0}) {
+      if (validate) {
+        err = "found a pixel of value 0";
+      } else if constexpr (is_thin_pixel_v<PixelT>) {
+        err = fmt::format(FMT_STRING("Found pixel with 0 interactions: bin1_id={}; bin2_id={}"),
+                          bin1_id, bin2_id);
+      } else {
+        err = fmt::format(FMT_STRING("Found pixel with 0 interactions: {}"), pixel.coords);
+      }
+    }
+    if (!err.empty()) {
+      // Pixels preceding the invalid pixel are appended
+      flush_buffers();
+      if (validate) {
+        throw std::runtime_error(fmt::format(FMT_STRING("pixel validation failed: {}"), err));
+      }
+      throw std::runtime_error(err);
+    }
+    prev_bin1_id = bin1_id;
+    prev_bin2_id = bin2_id;
+    first_in_batch = false;
+
+    if constexpr (is_thin_pixel_v<PixelT>) {
+      if (bin1_id >= num_bins || bin2_id >= num_bins) {
+        throw std::out_of_range(
+            fmt::format(FMT_STRING("invalid bin id {}: bin maps outside of the bin table"),
+                        (std::max)(bin1_id, bin2_id)));
+      }
+      chrom1_id = this->bins().map_to_chrom_idx(bin1_id);
+      chrom2_id = this->bins().map_to_chrom_idx(bin2_id);
+    } else {
+      chrom1_id = pixel.coords.bin1.chrom().id();
+      chrom2_id = pixel.coords.bin2.chrom().id();
+    }
+
+    if (bin1_id != current_row) {
+      current_row = bin1_id;
+      this->index().set_offset_by_bin_id(current_row, nnz);
     }
+    ++nnz;
     sum += pixel.count;
-    if (pixel.coords.bin1.chrom().id() == pixel.coords.bin2.chrom().id()) {
+    if (chrom1_id == chrom2_id) {
       cis_sum += pixel.count;
     }
-    return pixel.count;
-  });
+    if (compute_stats) {
+      chrom_pair_stats.add(chrom1_id, chrom2_id, pixel.count);
+    }
+    if (compute_marginals) {
+      this->update_bin_marginals(bin1_id, bin2_id, pixel.count);
+    }
+
+    bin1_buff.push_back(bin1_id);
+    bin2_buff.push_back(bin2_id);
+    count_buff.push_back(pixel.count);
+    if (bin1_buff.size() == buffer_capacity) {
+      flush_buffers();
+    }
+  }
+  flush_buffers();
+
+  this->flush_swmr_if_due();
+  this->checkpoint_if_due();
+}
+
+template <typename N>
+inline void File::append_pixels_columns(const std::uint64_t *bin1_ids,
+                                        const std::uint64_t *bin2_ids, const N *counts,
+                                        std::size_t n, bool validate) {
+  static_assert(std::is_arithmetic_v<N>);
+  if constexpr (ndebug_not_defined()) {
+    this->validate_pixel_type<N>();
+  }
+
+  if (n == 0) {
+    return;
+  }
+
+  const internal::TraceScope trace_scope{"coolerpp::File::append_pixels_columns"};
+  if (validate) {
+    if (this->_writer) {
+      this->_writer->flush();
+    }
+    this->validate_pixel_columns_before_append(bin1_ids, bin2_ids, counts, n);
+  }
+
+  this->update_indexes(bin1_ids, n);
+
+  const auto &bins = this->bins();
+  const auto num_bins = bins.size();
+
+  N sum = 0;
+  N cis_sum = 0;
+  internal::ChromosomePairStatsAccumulator chrom_pair_stats{this->_chrom_pair_stats};
+  const auto compute_stats = this->_compute_chrom_pair_stats;
+  for (std::size_t i = 0; i < n; ++i) {
+    if (counts[i] == 0) {
+      throw std::runtime_error(fmt::format(
+          FMT_STRING("Found pixel with 0 interactions: bin1_id={}; bin2_id={}"), bin1_ids[i],
+          bin2_ids[i]));
+    }
+    if (bin1_ids[i] >= num_bins || bin2_ids[i] >= num_bins) {
+      throw std::out_of_range(
+          fmt::format(FMT_STRING("invalid bin id {}: bin maps outside of the bin table"),
+                      (std::max)(bin1_ids[i], bin2_ids[i])));
+    }
+    const auto chrom1_id = bins.map_to_chrom_idx(bin1_ids[i]);
+    const auto chrom2_id = bins.map_to_chrom_idx(bin2_ids[i]);
+    sum += counts[i];
+    if (chrom1_id == chrom2_id) {
+      cis_sum += counts[i];
+    }
+    if (compute_stats) {
+      chrom_pair_stats.add(chrom1_id, chrom2_id, counts[i]);
+    }
+  }
+
+  if (!this->_marginal_sum_buff.empty()) {
+    for (std::size_t i = 0; i < n; ++i) {
+      this->update_bin_marginals(bin1_ids[i], bin2_ids[i], counts[i]);
+    }
+  }
 
-  this->_attrs.nnz = this->dataset("pixels/bin1_id").size();
+  if (this->_writer) {
+    for (std::size_t i = 0; i < n; ++i) {
+      this->_writer->append(bin1_ids[i], bin2_ids[i], counts[i]);
+    }
+    this->_attrs.nnz = static_cast<std::int64_t>(this->_writer->size());
+  } else {
+    this->dataset("pixels/bin1_id").append(bin1_ids, bin1_ids + n);
+    this->dataset("pixels/bin2_id").append(bin2_ids, bin2_ids + n);
+    this->dataset("pixels/count").append(counts, counts + n);
+    this->_attrs.nnz = static_cast<std::int64_t>(this->dataset("pixels/bin1_id").size());
+  }
 
   this->update_pixel_sum(sum);
-  this->update_pixel_sum<T, true>(cis_sum);
+  this->update_pixel_sum<N, true>(cis_sum);
+  chrom_pair_stats.flush();
+  this->flush_swmr_if_due();
+  this->checkpoint_if_due();
+}
+
+template <typename N>
+inline void File::append_pixels_from(const File &src, std::size_t chunk_size) {
+  static_assert(std::is_arithmetic_v<N>);
+  if constexpr (ndebug_not_defined()) {
+    this->validate_pixel_type<N>();
+  }
+
+  chunk_size = (std::max)(std::size_t(1), chunk_size);
+  const auto &src_bin1_dset = src.dataset("pixels/bin1_id");
+  const auto &src_bin2_dset = src.dataset("pixels/bin2_id");
+  const auto &src_count_dset = src.dataset("pixels/count");
+  const auto num_pixels = src_bin1_dset.size();
+  if (num_pixels == 0) {
+    return;
+  }
+
+  if (src.bins() != this->bins()) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("unable to append pixels from {} to {}: files have different bin tables"),
+        src.uri(), this->uri()));
+  }
+
+  const internal::TraceScope trace_scope{"coolerpp::File::append_pixels_from"};
+  const auto nnz = static_cast<std::uint64_t>(*this->_attrs.nnz);
+  const auto first_row = src_bin1_dset.read<std::uint64_t>(0);
+  const auto last_row = src_bin1_dset.read_last<std::uint64_t>();
+  if (nnz != 0 && first_row <= this->get_last_bin_written().id()) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("unable to append pixels from {} to {}: the first row of {} ({}) overlaps or "
+                   "is located upstream of the last row written ({})"),
+        src.uri(), this->uri(), src.uri(), first_row, this->get_last_bin_written().id()));
+  }
+
+  const auto stats_available =
+      src._attrs.sum.has_value() && src._attrs.cis.has_value() &&
+      (!this->_compute_chrom_pair_stats || src.has_chromosome_pair_stats()) &&
+      this->_marginal_sum_buff.empty();
+  if (!stats_available) {
+    std::vector<std::uint64_t> bin1_buff{};
+    std::vector<std::uint64_t> bin2_buff{};
+    std::vector<N> count_buff{};
+    for (std::size_t offset = 0; offset < num_pixels; offset += chunk_size) {
+      const auto num = (std::min)(chunk_size, num_pixels - offset);
+      src_bin1_dset.read(bin1_buff, num, offset);
+      src_bin2_dset.read(bin2_buff, num, offset);
+      src_count_dset.read(count_buff, num, offset);
+      this->append_pixels_columns(bin1_buff.data(), bin2_buff.data(), count_buff.data(), num);
+    }
+    return;
+  }
+
+  // Offsets of src are rebased on the number of pixels already written. Rows that are not
+  // covered by src are filled when the index is finalized
+  for (auto row = first_row; row <= last_row; ++row) {
+    this->index().set_offset_by_bin_id(row, nnz + src.index().get_offset_by_bin_id(row));
+  }
+
+  std::vector<std::uint64_t> bin1_buff{};
+  std::vector<std::uint64_t> bin2_buff{};
+  std::vector<N> count_buff{};
+  for (std::size_t offset = 0; offset < num_pixels; offset += chunk_size) {
+    const auto num = (std::min)(chunk_size, num_pixels - offset);
+    src_bin1_dset.read(bin1_buff, num, offset);
+    src_bin2_dset.read(bin2_buff, num, offset);
+    src_count_dset.read(count_buff, num, offset);
+    if (this->_writer) {
+      for (std::size_t i = 0; i < num; ++i) {
+        this->_writer->append(bin1_buff[i], bin2_buff[i], count_buff[i]);
+      }
+    } else {
+      this->dataset("pixels/bin1_id").append(bin1_buff.begin(), bin1_buff.end());
+      this->dataset("pixels/bin2_id").append(bin2_buff.begin(), bin2_buff.end());
+      this->dataset("pixels/count").append(count_buff.begin(), count_buff.end());
+    }
+  }
+  this->_attrs.nnz = static_cast<std::int64_t>(
+      this->_writer ? this->_writer->size() : this->dataset("pixels/bin1_id").size());
+
+  using SumT = std::conditional_t<std::is_floating_point_v<N>, double, std::int64_t>;
+  auto to_sum = [](const auto &sum) {
+    return std::visit([](const auto value) { return conditional_static_cast<SumT>(value); }, sum);
+  };
+  this->update_pixel_sum(to_sum(*src._attrs.sum));
+  this->update_pixel_sum<SumT, true>(to_sum(*src._attrs.cis));
+  if (this->_compute_chrom_pair_stats) {
+    for (const auto &record : src.read_chromosome_pair_stats().to_vector()) {
+      this->_chrom_pair_stats.add(record.chrom1_id, record.chrom2_id, record.stats);
+    }
+  }
+
+  this->flush_swmr_if_due();
+  this->checkpoint_if_due();
+}
+
+inline void File::flush() {
+  if (this->_writer) {
+    this->_writer->flush();
+  }
+  this->_fp->flush();
+  if (this->_swmr) {
+    // Offsets are published only once the pixels they refer to have reached the file
+    this->write_partial_indexes(this->dataset("indexes/bin1_offset"));
+    this->_fp->flush();
+    this->_swmr_flushed_nnz = static_cast<std::uint64_t>(*this->_attrs.nnz);
+  }
+}
+
+inline void File::start_swmr_write(const SWMROptions &options) {
+  assert(!this->_writer);
+  assert(!this->_shared_bin_table);
+  // Attributes cannot be created while SWMR write access is enabled: write the tables that are
+  // already known together with placeholder attributes, so that readers can open the file
+  this->write_chromosomes();
+  this->write_bin_table();
+  this->dataset("indexes/chrom_offset").write(this->index().compute_chrom_offsets(), 0, true);
+  File::write_standard_attributes(this->_root_group, this->_attrs);
+  this->_fp->flush();
+
+  internal::start_swmr_write(*this->_fp);
+  this->_swmr = true;
+  this->_swmr_flush_interval = options.flush_interval;
+}
+
+inline void File::write_partial_indexes(Dataset &dset) {
+  assert(this->_attrs.nnz.has_value());
+  if (*this->_attrs.nnz == 0) {
+    return;
+  }
+
+  // The row of the last pixel written may still be incomplete: offsets are published up to the
+  // offset of its first pixel
+  const auto current_row = this->get_last_bin_written().id();
+  const auto first_row = static_cast<std::uint64_t>(dset.size());
+  if (current_row < first_row) {
+    return;
+  }
+
+  // Empty rows take the offset of the next row that is not empty
+  constexpr auto offset_not_set = (std::numeric_limits<std::uint64_t>::max)();
+  std::vector<std::uint64_t> offsets(conditional_static_cast<std::size_t>(current_row - first_row) +
+                                     1);
+  auto fill_value = this->index().get_offset_by_bin_id(current_row);
+  for (auto i = offsets.size(); i-- > 0;) {
+    const auto offset = this->index().get_offset_by_bin_id(first_row + i);
+    if (offset != offset_not_set) {
+      fill_value = offset;
+    }
+    offsets[i] = fill_value;
+  }
+  if (first_row == 0) {
+    offsets.front() = 0;
+  }
+  dset.write(offsets, conditional_static_cast<std::size_t>(first_row), true);
+}
+
+inline void File::flush_swmr_if_due() {
+  if (!this->_swmr || this->_swmr_flush_interval == 0) {
+    return;
+  }
+  const auto nnz = static_cast<std::uint64_t>(*this->_attrs.nnz);
+  if (nnz - this->_swmr_flushed_nnz >= this->_swmr_flush_interval) {
+    this->flush();
+  }
+}
+
+inline void File::checkpoint() {
+  if (this->_swmr) {
+    throw std::logic_error("checkpoints are not supported by files written in SWMR mode");
+  }
+  this->flush();
+
+  [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
+  const std::string name{internal::CHECKPOINT_GROUP_NAME};
+  if (!this->_root_group().exist(name)) {
+    // The tables and attributes required to reopen the file are otherwise only written when the
+    // file is finalized
+    if (!this->_shared_bin_table) {
+      this->write_chromosomes();
+      this->write_bin_table();
+    }
+    RootGroup grp{this->_root_group().createGroup(name)};
+    File::write_standard_attributes(grp, this->_attrs, false);
+  } else {
+    auto grp = this->_root_group().getGroup(name);
+    Attribute::write(grp, "nnz", *this->_attrs.nnz, true);  // NOLINT
+    std::visit([&](const auto sum) { Attribute::write(grp, "sum", sum, true); },
+               *this->_attrs.sum);  // NOLINT
+    std::visit([&](const auto cis) { Attribute::write(grp, "cis", cis, true); },
+               *this->_attrs.cis);  // NOLINT
+  }
+
+  // The offsets of the rows written so far and the statistics computed while appending are saved
+  // as well, so that File::resume() does not have to scan the pixels preceding the checkpoint.
+  // Offsets are appended to the ones saved by the previous checkpoint, like in SWMR mode
+  if (*this->_attrs.nnz != 0) {
+    const auto offsets_path = fmt::format(FMT_STRING("{}/bin1_offset"), name);
+    auto offsets_dset = this->_root_group().exist(offsets_path)
+                            ? Dataset{this->_root_group, offsets_path}
+                            : Dataset{this->_root_group, offsets_path, std::int64_t{}};
+    this->write_partial_indexes(offsets_dset);
+
+    auto grp = this->_root_group().getGroup(name);
+    const auto last_row = this->get_last_bin_written().id();
+    Attribute::write(grp, "last_row", last_row, true);
+    Attribute::write(grp, "last_row_offset", this->index().get_offset_by_bin_id(last_row), true);
+  }
+  if (this->_compute_chrom_pair_stats) {
+    this->write_chromosome_pair_stats(fmt::format(FMT_STRING("{}/stats"), name));
+  }
+  this->write_bin_marginals(name);
+  this->_fp->flush();
+  this->_checkpointed_nnz = static_cast<std::uint64_t>(*this->_attrs.nnz);
+}
+
+inline void File::checkpoint_if_due() {
+  if (this->_checkpoint_interval == 0) {
+    return;
+  }
+  const auto nnz = static_cast<std::uint64_t>(*this->_attrs.nnz);
+  if (nnz - this->_checkpointed_nnz >= this->_checkpoint_interval) {
+    this->checkpoint();
+  }
+}
+
+inline bool File::restore_checkpoint() {
+  [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
+  const std::string name{internal::CHECKPOINT_GROUP_NAME};
+  auto grp = this->_root_group().getGroup(name);
+  const auto nnz = static_cast<std::uint64_t>(*this->_attrs.nnz);
+  const auto offsets_path = fmt::format(FMT_STRING("{}/bin1_offset"), name);
+  const auto stats_path = fmt::format(FMT_STRING("{}/stats"), name);
+  const auto marginal_sum_path = fmt::format(FMT_STRING("{}/marginal_sum"), name);
+  const auto marginal_nnz_path = fmt::format(FMT_STRING("{}/marginal_nnz"), name);
+  const auto compute_marginals = !this->_marginal_sum_buff.empty();
+
+  // Checkpoints written with different writer options may not have saved the statistics that are
+  // now requested
+  if (this->_compute_chrom_pair_stats && !this->_root_group().exist(stats_path)) {
+    return false;
+  }
+  if (compute_marginals && (!this->_root_group().exist(marginal_sum_path) ||
+                            !this->_root_group().exist(marginal_nnz_path))) {
+    return false;
+  }
+
+  if (nnz != 0) {
+    if (!Attribute::exists(grp, "last_row") || !Attribute::exists(grp, "last_row_offset") ||
+        !this->_root_group().exist(offsets_path)) {
+      return false;
+    }
+    const auto last_row = Attribute::read<std::uint64_t>(grp, "last_row");
+    const auto last_row_offset = Attribute::read<std::uint64_t>(grp, "last_row_offset");
+    const auto offsets =
+        Dataset{this->_root_group, offsets_path}.read_all<std::vector<std::uint64_t>>();
+    if (last_row >= this->bins().size() || last_row_offset >= nnz ||
+        offsets.size() != last_row + 1 || offsets.back() != last_row_offset) {
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("checkpoint index is corrupted: expected {} offsets ending with "
+                                 "{}, found {}"),
+                      last_row + 1, last_row_offset, offsets.size()));
+    }
+    for (std::size_t bin_id = 0; bin_id < offsets.size(); ++bin_id) {
+      this->index().set_offset_by_bin_id(bin_id, offsets[bin_id]);
+    }
+  }
+
+  if (this->_compute_chrom_pair_stats) {
+    this->_chrom_pair_stats = this->import_chromosome_pair_stats(stats_path);
+  }
+  if (compute_marginals) {
+    Dataset{this->_root_group, marginal_sum_path}.read_all(this->_marginal_sum_buff);
+    Dataset{this->_root_group, marginal_nnz_path}.read_all(this->_marginal_nnz_buff);
+    if (this->_marginal_sum_buff.size() != this->bins().size() ||
+        this->_marginal_nnz_buff.size() != this->bins().size()) {
+      throw std::runtime_error(fmt::format(
+          FMT_STRING("checkpoint marginals are corrupted: expected {} values, found {} and {}"),
+          this->bins().size(), this->_marginal_sum_buff.size(), this->_marginal_nnz_buff.size()));
+    }
+  }
+  return true;
+}
+
+inline void File::import_pixel_stats() {
+  assert(this->_attrs.nnz.has_value());
+  const auto nnz = static_cast<std::size_t>(*this->_attrs.nnz);
+  const auto &bin1_dset = this->dataset("pixels/bin1_id");
+  const auto &bin2_dset = this->dataset("pixels/bin2_id");
+  const auto &count_dset = this->dataset("pixels/count");
+
+  const auto &bins = this->bins();
+  const auto num_bins = bins.size();
+  std::uint64_t current_row = 0;
+
+  std::vector<std::uint64_t> bin1_ids{};
+  std::vector<std::uint64_t> bin2_ids{};
+  std::vector<double> counts{};
+  internal::ChromosomePairStatsAccumulator chrom_pair_stats{this->_chrom_pair_stats};
+  const auto compute_stats = this->_compute_chrom_pair_stats;
+  const auto compute_marginals = !this->_marginal_sum_buff.empty();
+
+  constexpr std::size_t buffer_capacity = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE;
+  for (std::size_t offset = 0; offset < nnz; offset += buffer_capacity) {
+    const auto n = (std::min)(buffer_capacity, nnz - offset);
+    bin1_dset.read(bin1_ids, n, offset);
+    bin2_dset.read(bin2_ids, n, offset);
+    count_dset.read(counts, n, offset);
+
+    for (std::size_t i = 0; i < n; ++i) {
+      if (bin1_ids[i] != current_row) {
+        current_row = bin1_ids[i];
+        this->index().set_offset_by_bin_id(current_row, offset + i);
+      }
+      if (bin1_ids[i] >= num_bins || bin2_ids[i] >= num_bins) {
+        throw std::out_of_range(
+            fmt::format(FMT_STRING("invalid bin id {}: bin maps outside of the bin table"),
+                        (std::max)(bin1_ids[i], bin2_ids[i])));
+      }
+      const auto chrom1_id = bins.map_to_chrom_idx(bin1_ids[i]);
+      const auto chrom2_id = bins.map_to_chrom_idx(bin2_ids[i]);
+      if (compute_stats) {
+        chrom_pair_stats.add(chrom1_id, chrom2_id, counts[i]);
+      }
+      if (compute_marginals) {
+        this->update_bin_marginals(bin1_ids[i], bin2_ids[i], counts[i]);
+      }
+    }
+  }
+  chrom_pair_stats.flush();
+}
+
+inline void File::remove_checkpoint() {
+  [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
+  const std::string name{internal::CHECKPOINT_GROUP_NAME};
+  if (this->_root_group().exist(name)) {
+    this->_root_group().unlink(name);
+  }
+}
+
+inline void File::end_swmr_write() {
+  assert(this->_swmr);
+  // Attributes cannot be created or deleted while SWMR write access is enabled: the file is
+  // reopened in read-write mode, and placeholder attributes are deleted so that they can be
+  // written again when the file is finalized
+  const auto uri = this->uri();
+  this->flush();
+  this->_swmr = false;
+  this->_datasets.clear();
+  this->_groups.clear();
+  this->_root_group = RootGroup{};
+  this->_fp.reset();
+
+  this->_fp = std::make_unique<HighFive::File>(open_file(uri, HighFive::File::ReadWrite, false));
+  this->_root_group = open_root_group(*this->_fp, uri);
+  this->_groups = open_groups(this->_root_group);
+  this->_datasets = open_datasets(this->_root_group, CacheOptions{});
+  this->remove_attributes();
 }
 
-inline void File::flush() { this->_fp->flush(); }
+inline void File::remove_attributes() {
+  [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
+  for (const auto name : internal::STANDARD_ATTR_NAMES) {
+    if (Attribute::exists(this->_root_group(), name)) {
+      this->_root_group().deleteAttribute(std::string{name});
+    }
+  }
+}
+
+inline void File::apply_writer_options(const WriterOptions &options) {
+  if (options.threads > 1 && this->pixel_chunks_can_be_encoded()) {
+    this->_writer = std::make_unique<internal::PixelWriter>(
+        this->dataset("pixels/bin1_id"), this->dataset("pixels/bin2_id"),
+        this->dataset("pixels/count"), options.threads);
+  }
+  if (options.compute_bin_marginals) {
+    this->_marginal_sum_buff.resize(this->bins().size(), 0);
+    this->_marginal_nnz_buff.resize(this->bins().size(), 0);
+  }
+  this->_compute_chrom_pair_stats = options.compute_chromosome_pair_stats;
+  if (options.checkpoint) {
+    this->_checkpoint_interval = options.checkpoint->interval;
+  }
+}
 
 template <typename It>
 inline void File::write_weights(std::string_view uri, std::string_view name, It first_weight,
@@ -114,6 +720,13 @@ inline void File::write_weights(std::string_view name, It first_weight, It last_
   dset.resize(static_cast<std::size_t>(std::distance(first_weight, last_weight)));
   dset.write(first_weight, last_weight);
   dset.write_attribute("divisive_weights", std::uint8_t(divisive), overwrite_if_exists);
+
+  // Make sure weights are re-read from the file after they have been overwritten
+  const auto dset_path =
+      fmt::format(FMT_STRING("{}/{}"), this->_groups.at("bins").group.getPath(), name);
+  internal::WeightCache::instance().erase(this->path(), dset_path);
+  const std::scoped_lock lck(*this->_weights_mtx);
+  this->_weights.erase(dset_path);
 }
 
 inline auto File::create_root_group(HighFive::File &f, std::string_view uri,
@@ -128,15 +741,18 @@ inline auto File::create_root_group(HighFive::File &f, std::string_view uri,
   return {grp};
 }
 
-inline auto File::create_groups(RootGroup &root_grp) -> GroupMap {
+inline auto File::create_groups(RootGroup &root_grp, bool create_bin_table) -> GroupMap {
   [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
   GroupMap groups(MANDATORY_GROUP_NAMES.size() + 1);
   groups.emplace(root_grp.hdf5_path(), Group{root_grp, root_grp()});
 
   std::transform(MANDATORY_GROUP_NAMES.begin(), MANDATORY_GROUP_NAMES.end(),
-                 std::inserter(groups, groups.begin()), [&root_grp](const auto group_name) {
+                 std::inserter(groups, groups.begin()), [&](const auto group_name) {
                    const auto name = std::string{group_name};
-                   auto group_obj = root_grp().createGroup(std::string{group_name});
+                   const auto is_bin_table_grp = name == "chroms" || name == "bins";
+                   auto group_obj = !create_bin_table && is_bin_table_grp
+                                        ? root_grp().getGroup(name)
+                                        : root_grp().createGroup(name);
 
                    return std::make_pair(name, Group{root_grp, group_obj});
                  });
@@ -145,45 +761,63 @@ inline auto File::create_groups(RootGroup &root_grp) -> GroupMap {
 
 template <typename PixelT>
 inline auto File::create_datasets(RootGroup &root_grp, const ChromosomeSet &chroms,
-                                  std::size_t cache_size_bytes, double w0) -> DatasetMap {
+                                  std::size_t cache_size_bytes, double w0,
+                                  const CompressionPolicy &compression,
+                                  bool create_bin_table) -> DatasetMap {
   DatasetMap datasets(MANDATORY_DATASET_NAMES.size() + 1);
 
   const std::size_t num_pixel_datasets = 3;
   const std::size_t num_read_once_dataset = MANDATORY_DATASET_NAMES.size() - num_pixel_datasets;
 
+  // Chunk caches are shrunk when the process-wide memory budget is under pressure
+  cache_size_bytes = MemoryBudget::instance().grant(cache_size_bytes);
   const std::size_t read_once_cache_size = DEFAULT_HDF5_DATASET_CACHE_SIZE;
+  const std::size_t read_once_caches_size = read_once_cache_size * num_read_once_dataset;
   const std::size_t pixel_dataset_cache_size =
-      (cache_size_bytes - (read_once_cache_size * num_read_once_dataset)) / num_pixel_datasets;
+      cache_size_bytes > read_once_caches_size
+          ? (cache_size_bytes - read_once_caches_size) / num_pixel_datasets
+          : std::size_t(0);
 
   const auto default_aprop =
       Dataset::init_access_props(DEFAULT_HDF5_CHUNK_SIZE, read_once_cache_size, 1.0);
   const auto pixels_aprop = Dataset::init_access_props(
       DEFAULT_HDF5_CHUNK_SIZE, (std::max(read_once_cache_size, pixel_dataset_cache_size)), w0);
 
-  auto create_dataset = [&](const auto &path, const auto &type, auto aprop) {
+  const auto default_cprop = Dataset::init_create_props(compression.other);
+
+  auto create_dataset = [&](const auto &path, const auto &type, auto aprop, const auto &cprop) {
     using T = remove_cvref_t<decltype(type)>;
+    const auto is_bin_table_dset = starts_with(path, "chroms/") || starts_with(path, "bins/");
+    if (!create_bin_table && is_bin_table_dset) {
+      datasets.emplace(path, Dataset{root_grp, path, aprop});
+      return;
+    }
     if constexpr (is_string_v<T>) {
       const auto &chrom_with_longest_name = chroms.chromosome_with_longest_name();
       datasets.emplace(path, Dataset{root_grp, path, chrom_with_longest_name.name(),
-                                     HighFive::DataSpace::UNLIMITED, aprop});
+                                     HighFive::DataSpace::UNLIMITED, aprop, cprop});
     } else {
-      datasets.emplace(path, Dataset{root_grp, path, type, HighFive::DataSpace::UNLIMITED, aprop});
+      datasets.emplace(path,
+                       Dataset{root_grp, path, type, HighFive::DataSpace::UNLIMITED, aprop, cprop});
     }
   };
 
-  create_dataset("chroms/name", std::string{}, default_aprop);
-  create_dataset("chroms/length", std::int32_t{}, default_aprop);
+  create_dataset("chroms/name", std::string{}, default_aprop, default_cprop);
+  create_dataset("chroms/length", std::int32_t{}, default_aprop, default_cprop);
 
-  create_dataset("bins/chrom", std::int32_t{}, default_aprop);
-  create_dataset("bins/start", std::int32_t{}, default_aprop);
-  create_dataset("bins/end", std::int32_t{}, default_aprop);
+  create_dataset("bins/chrom", std::int32_t{}, default_aprop, default_cprop);
+  create_dataset("bins/start", std::int32_t{}, default_aprop, default_cprop);
+  create_dataset("bins/end", std::int32_t{}, default_aprop, default_cprop);
 
-  create_dataset("pixels/bin1_id", std::int64_t{}, pixels_aprop);
-  create_dataset("pixels/bin2_id", std::int64_t{}, pixels_aprop);
-  create_dataset("pixels/count", PixelT{}, pixels_aprop);
+  create_dataset("pixels/bin1_id", std::int64_t{}, pixels_aprop,
+                 Dataset::init_create_props(compression.pixels_bin1_id));
+  create_dataset("pixels/bin2_id", std::int64_t{}, pixels_aprop,
+                 Dataset::init_create_props(compression.pixels_bin2_id));
+  create_dataset("pixels/count", PixelT{}, pixels_aprop,
+                 Dataset::init_create_props(compression.pixels_count));
 
-  create_dataset("indexes/bin1_offset", std::int64_t{}, default_aprop);
-  create_dataset("indexes/chrom_offset", std::int64_t{}, default_aprop);
+  create_dataset("indexes/bin1_offset", std::int64_t{}, default_aprop, default_cprop);
+  create_dataset("indexes/chrom_offset", std::int64_t{}, default_aprop, default_cprop);
 
   assert(datasets.size() == MANDATORY_DATASET_NAMES.size());
 
@@ -235,6 +869,72 @@ inline void File::write_attributes(bool skip_sentinel_attr) {
   }
 }
 
+inline void File::write_chromosome_pair_stats(std::string_view grp_path) {
+  [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
+  if (!this->_root_group().exist(std::string{grp_path})) {
+    this->_root_group().createGroup(std::string{grp_path});
+  }
+
+  const auto records = this->_chrom_pair_stats.to_vector();
+  std::vector<std::int32_t> chrom1_ids(records.size());
+  std::vector<std::int32_t> chrom2_ids(records.size());
+  std::vector<std::int64_t> nnz(records.size());
+  std::vector<double> sum(records.size());
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    chrom1_ids[i] = static_cast<std::int32_t>(records[i].chrom1_id);
+    chrom2_ids[i] = static_cast<std::int32_t>(records[i].chrom2_id);
+    nnz[i] = static_cast<std::int64_t>(records[i].stats.nnz);
+    sum[i] = records[i].stats.sum;
+  }
+
+  auto write_dset = [&](std::string_view name, const auto &buff) {
+    using T = typename remove_cvref_t<decltype(buff)>::value_type;
+    const auto path = fmt::format(FMT_STRING("{}/{}"), grp_path, name);
+    // Stats are already there when appending pixels to an existing file or when updating a
+    // checkpoint
+    if (this->_root_group().exist(path)) {
+      this->_root_group().unlink(path);
+    }
+    Dataset dset(this->_root_group, path, T{});
+    if (!buff.empty()) {
+      dset.write(buff, 0, true);
+    }
+  };
+  write_dset("chrom1_id", chrom1_ids);
+  write_dset("chrom2_id", chrom2_ids);
+  write_dset("nnz", nnz);
+  write_dset("sum", sum);
+}
+
+inline void File::write_bin_marginals(std::string_view grp_path) {
+  if (this->_marginal_sum_buff.empty()) {
+    return;
+  }
+  assert(this->_marginal_sum_buff.size() == this->bins().size());
+  assert(this->_marginal_nnz_buff.size() == this->bins().size());
+
+  [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
+  const auto sum_path = fmt::format(FMT_STRING("{}/marginal_sum"), grp_path);
+  const auto nnz_path = fmt::format(FMT_STRING("{}/marginal_nnz"), grp_path);
+  // Marginals are already there when appending pixels to an existing file or when updating a
+  // checkpoint
+  for (const auto &path : {sum_path, nnz_path}) {
+    if (this->_root_group().exist(path)) {
+      this->_root_group().unlink(path);
+    }
+  }
+
+  Dataset sum_dset(this->_root_group, sum_path, double{});
+  sum_dset.write(this->_marginal_sum_buff, 0, true);
+
+  // Counters are stored as signed integers, like the other integer datasets of a Cooler
+  std::vector<std::int64_t> nnz(this->_marginal_nnz_buff.size());
+  std::transform(this->_marginal_nnz_buff.begin(), this->_marginal_nnz_buff.end(), nnz.begin(),
+                 [](const auto n) { return static_cast<std::int64_t>(n); });
+  Dataset nnz_dset(this->_root_group, nnz_path, std::int64_t{});
+  nnz_dset.write(nnz, 0, true);
+}
+
 inline void File::write_chromosomes() {
   assert(this->_datasets.contains("chroms/name"));
   assert(this->_datasets.contains("chroms/length"));
@@ -286,39 +986,45 @@ inline void File::write_bin_table(Dataset &chrom_dset, Dataset &start_dset, Data
                                   const BinTable &bin_table) {
   assert(!bin_table.empty());
 
-  chrom_dset.write(bin_table.begin(), bin_table.end(), 0, true,
-                   [&](const Bin &bin) { return bin.chrom().id(); });
-
-  start_dset.write(bin_table.begin(), bin_table.end(), 0, true,
-                   [&](const Bin &bin) { return bin.start(); });
-
-  end_dset.write(bin_table.begin(), bin_table.end(), 0, true,
-                 [&](const Bin &bin) { return bin.end(); });
+  // Columns are generated one block at a time directly from the chromosome sizes and bin size,
+  // so that the three datasets are written with a single pass over the table
+  constexpr std::size_t block_size = 1ULL << 20U;
+  const auto num_bins = bin_table.size();
+  std::vector<std::uint32_t> chrom_ids((std::min)(block_size, num_bins));
+  std::vector<std::uint32_t> starts(chrom_ids.size());
+  std::vector<std::uint32_t> ends(chrom_ids.size());
+
+  for (std::size_t offset = 0; offset < num_bins; offset += block_size) {
+    const auto n = (std::min)(block_size, num_bins - offset);
+    chrom_ids.resize(n);
+    starts.resize(n);
+    ends.resize(n);
+    bin_table.fill_columns(offset, n, chrom_ids.data(), starts.data(), ends.data());
+
+    chrom_dset.write(chrom_ids, offset, true);
+    start_dset.write(starts, offset, true);
+    end_dset.write(ends, offset, true);
+  }
 
   assert(chrom_dset.size() == bin_table.size());
   assert(start_dset.size() == bin_table.size());
   assert(end_dset.size() == bin_table.size());
 }
 
-template <typename PixelIt>
-inline void File::update_indexes(PixelIt first_pixel, PixelIt last_pixel) {
-  using PixelT = typename std::iterator_traits<PixelIt>::value_type;
-  using T = decltype(std::declval<PixelT>().count);
-
-  if (first_pixel == last_pixel) {
+inline void File::update_indexes(const std::uint64_t *bin1_ids, std::size_t n) {
+  if (n == 0) {
     return;
   }
 
   auto nnz = static_cast<std::uint64_t>(*this->_attrs.nnz);
-  PixelCoordinates first_pixel_in_row(this->get_last_bin_written());
+  auto current_row = this->get_last_bin_written().id();
 
-  std::for_each(first_pixel, last_pixel, [&](const Pixel<T> &p) {
-    if (first_pixel_in_row.bin1.start() != p.coords.bin1.start()) {
-      first_pixel_in_row = p.coords;
-      this->index().set_offset_by_bin_id(first_pixel_in_row.bin1.id(), nnz);
+  for (std::size_t i = 0; i < n; ++i, ++nnz) {
+    if (bin1_ids[i] != current_row) {
+      current_row = bin1_ids[i];
+      this->index().set_offset_by_bin_id(current_row, nnz);
     }
-    nnz++;
-  });
+  }
 }
 
 inline void File::write_indexes() {
@@ -338,6 +1044,21 @@ inline void File::write_indexes(Dataset &chrom_offset_dset, Dataset &bin_offset_
   assert(bin_offset_dset.size() == idx.size() + 1);
 }
 
+inline bool File::pixel_chunks_can_be_encoded() const {
+  return std::all_of(MANDATORY_DATASET_NAMES.begin(), MANDATORY_DATASET_NAMES.end(),
+                     [&](std::string_view name) {
+                       if (name.find("pixels/") != 0) {
+                         return true;
+                       }
+                       // Chunks can only be written by internal::PixelWriter when the
+                       // datasets end on a chunk boundary
+                       const auto &dset = this->dataset(name);
+                       internal::ChunkLayout layout{};
+                       return internal::read_chunk_layout(dset.get().getId(), layout) &&
+                              dset.size() % layout.chunk_size == 0;
+                     });
+}
+
 inline void File::write_sentinel_attr(HighFive::Group grp) {
   assert(!check_sentinel_attr(grp));
 
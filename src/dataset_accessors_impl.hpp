@@ -4,11 +4,16 @@
 
 #pragma once
 
+#include <H5Dpublic.h>
+#include <H5Ppublic.h>
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <highfive/H5DataSet.hpp>
 #include <highfive/H5DataType.hpp>
+#include <stdexcept>
 
 namespace coolerpp {
 
@@ -24,10 +29,61 @@ inline std::string Dataset::uri() const {
   return fmt::format(FMT_STRING("{}::{}"), this->file_name(), this->hdf5_path());
 }
 
-inline std::size_t Dataset::size() const { return this->_dataset.getElementCount(); }
+inline std::size_t Dataset::size() const {
+  const auto size = this->_direct_reader ? this->_direct_reader->size()
+                                         : std::size_t(this->_dataset.getElementCount());
+  return (std::min)(size, this->_size_limit);
+}
+
+inline void Dataset::set_size_limit(std::size_t max_size) noexcept {
+  this->_size_limit = max_size;
+}
 
 inline bool Dataset::empty() const { return this->size() == 0; }
 
+inline std::size_t Dataset::chunk_size() const { return Dataset::chunk_size(this->_dataset); }
+
+inline std::size_t Dataset::chunk_size(const HighFive::DataSet &dset) {
+  const auto dcpl = H5Dget_create_plist(dset.getId());
+  if (dcpl < 0) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("failed to read the creation properties of dataset {}"), dset.getPath()));
+  }
+
+  hsize_t chunk_dim{};
+  const auto chunked =
+      H5Pget_layout(dcpl) == H5D_CHUNKED && H5Pget_chunk(dcpl, 1, &chunk_dim) == 1;
+  H5Pclose(dcpl);
+  return chunked ? conditional_static_cast<std::size_t>(chunk_dim) : 0;
+}
+
+inline std::size_t Dataset::chunk_size_bytes() const {
+  return this->chunk_size() * this->_dataset.getDataType().getSize();
+}
+
+inline std::size_t Dataset::chunk_cache_size() const {
+  if (this->chunk_size() == 0) {
+    return 0;
+  }
+
+  const auto dapl = H5Dget_access_plist(this->_dataset.getId());
+  if (dapl < 0) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("failed to read the access properties of dataset {}"), this->uri()));
+  }
+
+  std::size_t num_slots{};
+  std::size_t cache_size{};
+  double w0{};
+  const auto status = H5Pget_chunk_cache(dapl, &num_slots, &cache_size, &w0);
+  H5Pclose(dapl);
+  if (status < 0) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("failed to read the chunk cache properties of dataset {}"), this->uri()));
+  }
+  return cache_size;
+}
+
 inline HighFive::DataSet Dataset::get() { return this->_dataset; }
 inline const HighFive::DataSet &Dataset::get() const { return this->_dataset; }
 
@@ -76,8 +132,8 @@ inline HighFive::DataType Dataset::get_h5type() const {
 }
 
 template <typename T, std::size_t CHUNK_SIZE>
-inline auto Dataset::begin() const -> iterator<T, CHUNK_SIZE> {
-  return iterator<T, CHUNK_SIZE>(*this);
+inline auto Dataset::begin(bool prefetch) const -> iterator<T, CHUNK_SIZE> {
+  return iterator<T, CHUNK_SIZE>(*this, 0, true, prefetch);
 }
 
 template <typename T, std::size_t CHUNK_SIZE>
@@ -86,8 +142,8 @@ inline auto Dataset::end() const -> iterator<T, CHUNK_SIZE> {
 }
 
 template <typename T, std::size_t CHUNK_SIZE>
-inline auto Dataset::cbegin() const -> iterator<T, CHUNK_SIZE> {
-  return this->begin<T, CHUNK_SIZE>();
+inline auto Dataset::cbegin(bool prefetch) const -> iterator<T, CHUNK_SIZE> {
+  return this->begin<T, CHUNK_SIZE>(prefetch);
 }
 
 template <typename T, std::size_t CHUNK_SIZE>
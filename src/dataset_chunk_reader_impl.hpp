@@ -0,0 +1,583 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <H5Dpublic.h>
+#include <H5Fpublic.h>
+#include <H5Ipublic.h>
+#include <H5Ppublic.h>
+#include <H5Zpublic.h>
+// H5FDsec2.h does not include the headers it depends on
+#include <H5FDsec2.h>
+#include <fmt/format.h>
+#include <zlib.h>
+#if __has_include(<unistd.h>)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <highfive/H5DataSet.hpp>
+#include <highfive/H5DataType.hpp>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "coolerpp/common.hpp"
+#include "coolerpp/internal/numeric_utils.hpp"
+#include "coolerpp/internal/numeric_variant.hpp"
+
+namespace coolerpp {
+
+namespace internal {
+
+// Filters are listed in the order in which they were applied when writing chunks
+struct ChunkLayout {
+  std::size_t chunk_size{};
+  std::vector<H5Z_filter_t> filters{};
+  std::uint32_t deflate_level{};
+};
+
+// Return false when the dataset layout is not supported by the direct chunk read path
+[[nodiscard]] inline bool read_chunk_layout(hid_t dset_id, ChunkLayout &layout) {
+  const auto dcpl = H5Dget_create_plist(dset_id);
+  if (dcpl < 0) {
+    return false;
+  }
+
+  bool supported = H5Pget_layout(dcpl) == H5D_CHUNKED;
+  hsize_t chunk_dim{};
+  supported = supported && H5Pget_chunk(dcpl, 1, &chunk_dim) == 1 && chunk_dim != 0;
+
+  const auto num_filters = supported ? H5Pget_nfilters(dcpl) : -1;
+  supported = num_filters >= 0;
+  for (int i = 0; supported && i < num_filters; ++i) {
+    unsigned flags{};
+    std::array<unsigned, 8> cd_values{};
+    std::size_t cd_nelmts = cd_values.size();
+    const auto filter = H5Pget_filter2(dcpl, static_cast<unsigned>(i), &flags, &cd_nelmts,
+                                       cd_values.data(), 0, nullptr, nullptr);
+    supported = filter == H5Z_FILTER_SHUFFLE || filter == H5Z_FILTER_DEFLATE;
+    if (filter == H5Z_FILTER_DEFLATE && cd_nelmts != 0) {
+      layout.deflate_level = cd_values.front();
+    }
+    layout.filters.push_back(filter);
+  }
+
+  H5Pclose(dcpl);
+  layout.chunk_size = conditional_static_cast<std::size_t>(chunk_dim);
+  return supported;
+}
+
+inline void inflate_chunk(const std::vector<std::uint8_t> &src, std::vector<std::uint8_t> &dest) {
+  auto dest_size = conditional_static_cast<uLongf>(dest.size());
+  const auto status = uncompress(dest.data(), &dest_size, src.data(),
+                                 conditional_static_cast<uLong>(src.size()));
+  if (status != Z_OK) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("failed to inflate chunk: zlib returned {}"), status));
+  }
+  dest.resize(conditional_static_cast<std::size_t>(dest_size));
+}
+
+inline void unshuffle_chunk(const std::vector<std::uint8_t> &src, std::vector<std::uint8_t> &dest,
+                            std::size_t type_size) {
+  dest.resize(src.size());
+  const auto num_elements = src.size() / type_size;
+  for (std::size_t j = 0; j < type_size; ++j) {
+    const auto *plane = src.data() + (j * num_elements);
+    for (std::size_t i = 0; i < num_elements; ++i) {
+      dest[(i * type_size) + j] = plane[i];
+    }
+  }
+  // Trailing bytes are not shuffled by HDF5
+  const auto num_shuffled_bytes = num_elements * type_size;
+  std::copy(src.begin() + std::ptrdiff_t(num_shuffled_bytes), src.end(),
+            dest.begin() + std::ptrdiff_t(num_shuffled_bytes));
+}
+
+inline void shuffle_chunk(const std::vector<std::uint8_t> &src, std::vector<std::uint8_t> &dest,
+                          std::size_t type_size) {
+  dest.resize(src.size());
+  const auto num_elements = src.size() / type_size;
+  for (std::size_t j = 0; j < type_size; ++j) {
+    auto *plane = dest.data() + (j * num_elements);
+    for (std::size_t i = 0; i < num_elements; ++i) {
+      plane[i] = src[(i * type_size) + j];
+    }
+  }
+  const auto num_shuffled_bytes = num_elements * type_size;
+  std::copy(src.begin() + std::ptrdiff_t(num_shuffled_bytes), src.end(),
+            dest.begin() + std::ptrdiff_t(num_shuffled_bytes));
+}
+
+// Undo filters in reverse order. Filters whose bit is set in filter_mask were skipped when the
+// chunk was written
+inline void decode_chunk(const ChunkLayout &layout, std::uint32_t filter_mask,
+                         std::size_t type_size, std::vector<std::uint8_t> &raw,
+                         std::vector<std::uint8_t> &tmp) {
+  for (auto i = layout.filters.size(); i != 0; --i) {
+    if ((filter_mask >> (i - 1)) & 1U) {
+      continue;
+    }
+    if (layout.filters[i - 1] == H5Z_FILTER_DEFLATE) {
+      tmp.resize(layout.chunk_size * type_size);
+      inflate_chunk(raw, tmp);
+    } else {
+      assert(layout.filters[i - 1] == H5Z_FILTER_SHUFFLE);
+      unshuffle_chunk(raw, tmp, type_size);
+    }
+    std::swap(raw, tmp);
+  }
+
+  if (raw.size() != layout.chunk_size * type_size) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("decoded chunk has an unexpected size: expected {} bytes, found {}"),
+        layout.chunk_size * type_size, raw.size()));
+  }
+}
+
+// Chunks overlapping the [offset, offset + num) range of values of a dataset, as they are stored on
+// disk (see Dataset::fetch_chunks())
+struct RawChunks {
+  ChunkLayout layout{};
+  std::size_t type_size{};
+  std::size_t offset{};
+  std::size_t num{};
+  std::size_t first_chunk{};
+  std::vector<std::vector<std::uint8_t>> chunks{};
+  std::vector<std::uint32_t> filter_masks{};
+};
+
+// Decode chunks using up to num_threads threads and copy the values they store to dest, which
+// should be large enough to store chunks.num values of chunks.type_size bytes
+inline void decode_raw_chunks(RawChunks &chunks, void *dest, std::size_t num_threads) {
+  const auto chunk_size = chunks.layout.chunk_size;
+  const auto type_size = chunks.type_size;
+  const auto offset = chunks.offset;
+  const auto num = chunks.num;
+  const auto num_chunks = chunks.chunks.size();
+  auto *buff = static_cast<std::uint8_t *>(dest);
+
+  auto decode = [&](std::size_t i0, std::size_t i1) {
+    std::vector<std::uint8_t> tmp{};
+    for (auto i = i0; i < i1; ++i) {
+      auto &raw = chunks.chunks[i];
+      decode_chunk(chunks.layout, chunks.filter_masks[i], type_size, raw, tmp);
+
+      const auto chunk_start = (chunks.first_chunk + i) * chunk_size;
+      const auto first = (std::max)(offset, chunk_start);
+      const auto last = (std::min)(offset + num, chunk_start + chunk_size);
+      std::memcpy(buff + ((first - offset) * type_size),
+                  raw.data() + ((first - chunk_start) * type_size), (last - first) * type_size);
+    }
+  };
+
+  num_threads = (std::max)(std::size_t(1), (std::min)(num_threads, num_chunks));
+  if (num_threads == 1) {
+    decode(0, num_chunks);
+    return;
+  }
+
+  std::vector<std::future<void>> workers{};
+  workers.reserve(num_threads - 1);
+  for (std::size_t t = 1; t < num_threads; ++t) {
+    workers.emplace_back(std::async(std::launch::async, decode, (num_chunks * t) / num_threads,
+                                    (num_chunks * (t + 1)) / num_threads));
+  }
+
+  // Make sure all workers are done before propagating exceptions: they write into dest
+  std::exception_ptr except{};
+  try {
+    decode(0, num_chunks / num_threads);
+  } catch (...) {
+    except = std::current_exception();
+  }
+  for (auto &w : workers) {
+    try {
+      w.get();
+    } catch (...) {
+      if (!except) {
+        except = std::current_exception();
+      }
+    }
+  }
+  if (except) {
+    std::rethrow_exception(except);
+  }
+}
+
+// Index of h5type within NumericVariant, or NUMERIC_VARIANT_NPOS when values of type h5type cannot
+// be stored in a NumericVariant
+template <std::size_t i = 0>
+[[nodiscard]] inline std::size_t detect_numeric_variant_index(const HighFive::DataType &h5type) {
+  if constexpr (i == std::variant_size_v<NumericVariant>) {
+    return NUMERIC_VARIANT_NPOS;
+  } else {
+    using T = std::variant_alternative_t<i, NumericVariant>;
+    if (h5type == HighFive::create_datatype<T>()) {
+      return i;
+    }
+    return detect_numeric_variant_index<i + 1>(h5type);
+  }
+}
+
+// Read the chunks of a 1D dataset straight from the file backing it, bypassing libhdf5.
+// The location of chunks is resolved when the reader is initialized, so readers should only be
+// used to read datasets that are not modified while the reader is alive.
+// Reads are thread-safe: each call reads chunks using pread() and decodes them into buffers local
+// to the call
+class DirectChunkReader {
+  struct ChunkInfo {
+    std::uint64_t addr{};
+    std::size_t nbytes{};
+    std::uint32_t filter_mask{};
+  };
+
+  static constexpr auto npos = NUMERIC_VARIANT_NPOS;
+
+  int _fd{-1};
+  std::string _path{};
+  std::size_t _size{};
+  ChunkLayout _layout{};
+  // Index of the type used to store values on disk within NumericVariant
+  std::size_t _type_idx{npos};
+  std::vector<ChunkInfo> _chunks{};
+
+ public:
+  DirectChunkReader() = default;
+  DirectChunkReader(const DirectChunkReader &other) = delete;
+  DirectChunkReader(DirectChunkReader &&other) = delete;
+  ~DirectChunkReader() noexcept;
+
+  DirectChunkReader &operator=(const DirectChunkReader &other) = delete;
+  DirectChunkReader &operator=(DirectChunkReader &&other) = delete;
+
+  // Returns nullptr when the dataset cannot be read directly
+  [[nodiscard]] static std::shared_ptr<const DirectChunkReader> open(
+      const HighFive::DataSet &dset);
+
+  [[nodiscard]] constexpr std::size_t size() const noexcept { return this->_size; }
+  [[nodiscard]] constexpr std::size_t chunk_size() const noexcept {
+    return this->_layout.chunk_size;
+  }
+  // Whether values are stored on disk using type N
+  template <typename N>
+  [[nodiscard]] constexpr bool holds() const noexcept {
+    return this->_type_idx == numeric_variant_index<N>();
+  }
+
+  // Read num values starting at offset into buff. Returns the number of bytes read from disk
+  template <typename N>
+  std::size_t read(N *buff, std::size_t num, std::size_t offset) const;
+
+ private:
+  [[nodiscard]] bool init(const HighFive::DataSet &dset);
+  void pread_all(void *buff, std::size_t nbytes, std::uint64_t addr) const;
+  [[nodiscard]] bool chunk_is_filtered(const ChunkInfo &chunk) const noexcept;
+
+};
+
+inline DirectChunkReader::~DirectChunkReader() noexcept {
+#if __has_include(<unistd.h>)
+  if (this->_fd != -1) {
+    ::close(this->_fd);
+  }
+#endif
+}
+
+inline std::shared_ptr<const DirectChunkReader> DirectChunkReader::open(
+    const HighFive::DataSet &dset) {
+  auto reader = std::make_shared<DirectChunkReader>();
+  if (!reader->init(dset)) {
+    return nullptr;
+  }
+  return reader;
+}
+
+template <typename N>
+inline std::size_t DirectChunkReader::read(N *buff, std::size_t num, std::size_t offset) const {
+  static_assert(std::is_arithmetic_v<N>);
+  assert(this->holds<N>());
+  assert(offset + num <= this->_size);
+  if (num == 0) {
+    return 0;
+  }
+
+  const auto chunk_size = this->_layout.chunk_size;
+  const auto first_chunk = offset / chunk_size;
+  const auto last_chunk = (offset + num - 1) / chunk_size;
+
+  std::vector<std::uint8_t> raw{};
+  std::vector<std::uint8_t> tmp{};
+  std::size_t bytes_read = 0;
+  for (auto i = first_chunk; i <= last_chunk; ++i) {
+    const auto &chunk = this->_chunks[i];
+    const auto chunk_start = i * chunk_size;
+    const auto first = (std::max)(offset, chunk_start);
+    const auto last = (std::min)(offset + num, chunk_start + chunk_size);
+
+    if (!this->chunk_is_filtered(chunk)) {
+      // Chunks stored as is: only read the values that were requested
+      const auto nbytes = (last - first) * sizeof(N);
+      this->pread_all(buff + (first - offset), nbytes,
+                      chunk.addr + ((first - chunk_start) * sizeof(N)));
+      bytes_read += nbytes;
+      continue;
+    }
+
+    raw.resize(chunk.nbytes);
+    this->pread_all(raw.data(), chunk.nbytes, chunk.addr);
+    bytes_read += chunk.nbytes;
+    decode_chunk(this->_layout, chunk.filter_mask, sizeof(N), raw, tmp);
+    std::memcpy(buff + (first - offset), raw.data() + ((first - chunk_start) * sizeof(N)),
+                (last - first) * sizeof(N));
+  }
+
+  return bytes_read;
+}
+
+inline bool DirectChunkReader::init([[maybe_unused]] const HighFive::DataSet &dset) {
+#if __has_include(<unistd.h>)
+  [[maybe_unused]] const HighFive::SilenceHDF5 silencer{};  // NOLINT
+  const auto dset_id = dset.getId();
+
+  // Only files stored on disk using the default driver have a layout we know how to read.
+  // Addresses returned by libhdf5 are relative to the end of the user block
+  const auto file_id = H5Iget_file_id(dset_id);
+  if (file_id < 0) {
+    return false;
+  }
+  const auto fapl = H5Fget_access_plist(file_id);
+  const auto fcpl = H5Fget_create_plist(file_id);
+  hsize_t userblock_size{};
+  const auto supported_file = fapl >= 0 && fcpl >= 0 && H5Pget_driver(fapl) == H5FD_SEC2 &&
+                              H5Pget_userblock(fcpl, &userblock_size) >= 0 &&
+                              userblock_size == 0;
+  if (fapl >= 0) {
+    H5Pclose(fapl);
+  }
+  if (fcpl >= 0) {
+    H5Pclose(fcpl);
+  }
+  H5Fclose(file_id);
+
+  if (!supported_file || !read_chunk_layout(dset_id, this->_layout)) {
+    return false;
+  }
+
+  this->_type_idx = detect_numeric_variant_index(dset.getDataType());
+  if (this->_type_idx == npos) {
+    return false;
+  }
+
+  this->_size = dset.getElementCount();
+  const auto chunk_size = this->_layout.chunk_size;
+  const auto num_chunks = (this->_size + chunk_size - 1) / chunk_size;
+  this->_chunks.resize(num_chunks);
+  for (std::size_t i = 0; i < num_chunks; ++i) {
+    auto chunk_offset = conditional_static_cast<hsize_t>(i * chunk_size);
+    unsigned filter_mask{};
+    haddr_t addr{};
+    hsize_t nbytes{};
+    if (H5Dget_chunk_info_by_coord(dset_id, &chunk_offset, &filter_mask, &addr, &nbytes) < 0 ||
+        addr == HADDR_UNDEF || nbytes == 0) {
+      return false;
+    }
+    this->_chunks[i] = ChunkInfo{conditional_static_cast<std::uint64_t>(addr),
+                                 conditional_static_cast<std::size_t>(nbytes), filter_mask};
+  }
+
+  this->_path = dset.getFileName();
+  this->_fd = ::open(this->_path.c_str(), O_RDONLY);  // NOLINT(*-vararg)
+  return this->_fd != -1;
+#else
+  return false;
+#endif
+}
+
+inline void DirectChunkReader::pread_all([[maybe_unused]] void *buff,
+                                         [[maybe_unused]] std::size_t nbytes,
+                                         [[maybe_unused]] std::uint64_t addr) const {
+#if __has_include(<unistd.h>)
+  auto *ptr = static_cast<std::uint8_t *>(buff);
+  while (nbytes != 0) {
+    const auto n = ::pread(this->_fd, ptr, nbytes, conditional_static_cast<off_t>(addr));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      const auto reason =
+          n == 0 ? std::string{"unexpected end of file"}
+                 : std::error_code(errno, std::generic_category()).message();
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("failed to read {} bytes at offset {} from file \"{}\": {}"),
+                      nbytes, addr, this->_path, reason));
+    }
+    ptr += n;
+    nbytes -= static_cast<std::size_t>(n);
+    addr += static_cast<std::uint64_t>(n);
+  }
+#else
+  // init() never succeeds on platforms without pread()
+  assert(false);
+#endif
+}
+
+inline bool DirectChunkReader::chunk_is_filtered(const ChunkInfo &chunk) const noexcept {
+  // Bits of filter_mask are set for filters that were skipped when the chunk was written
+  const auto num_filters = this->_layout.filters.size();
+  const auto all_skipped = num_filters >= 32 ? ~std::uint32_t(0)
+                                             : (std::uint32_t(1) << num_filters) - 1;
+  return (chunk.filter_mask & all_skipped) != all_skipped;
+}
+
+}  // namespace internal
+
+inline bool Dataset::enable_direct_reads() {
+  auto reader = internal::DirectChunkReader::open(this->_dataset);
+  if (!reader) {
+    return false;
+  }
+  this->_direct_reader = std::move(reader);
+  return true;
+}
+
+inline bool Dataset::direct_reads_enabled() const noexcept { return !!this->_direct_reader; }
+
+inline void Dataset::set_decompression_threads(std::size_t num_threads) noexcept {
+  this->_decompression_threads = (std::max)(std::size_t(1), num_threads);
+}
+
+inline std::size_t Dataset::decompression_threads() const noexcept {
+  return this->_decompression_threads;
+}
+
+template <typename N>
+inline bool Dataset::reads_bypass_hdf5() const noexcept {
+  return this->_direct_reader && this->converts_natively<N>();
+}
+
+template <typename N>
+inline bool Dataset::read_chunks_parallel(std::vector<N> &buff, std::size_t num,
+                                          std::size_t offset) const {
+  static_assert(std::is_arithmetic_v<N>);
+  assert(buff.size() == num);
+  if (num == 0 || !this->holds_native_type<N>()) {
+    return false;
+  }
+
+  // Fetching raw chunks goes through libhdf5 and is done serially: only decoding is parallelized
+  internal::RawChunks chunks{};
+  if (!this->fetch_chunks<N>(chunks, num, offset)) {
+    return false;
+  }
+  internal::decode_raw_chunks(chunks, buff.data(), this->_decompression_threads);
+  return true;
+}
+
+template <typename N>
+inline bool Dataset::fetch_chunks(internal::RawChunks &chunks, std::size_t num,
+                                  std::size_t offset) const {
+  static_assert(std::is_arithmetic_v<N>);
+  if (!this->converts_natively<N>()) {
+    return false;
+  }
+
+  [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
+  if (offset + num > this->size()) {
+    this->throw_out_of_range_excp(offset, num);
+  }
+
+  const auto t0 = internal::IOCounters::now();
+  const auto dset_id = this->_dataset.getId();
+  chunks.layout = internal::ChunkLayout{};
+  if (!internal::read_chunk_layout(dset_id, chunks.layout)) {
+    return false;
+  }
+
+  const auto chunk_size = chunks.layout.chunk_size;
+  chunks.type_size = this->get_h5type().getSize();
+  chunks.offset = offset;
+  chunks.num = num;
+  chunks.first_chunk = offset / chunk_size;
+  const auto num_chunks = num == 0 ? 0 : ((offset + num - 1) / chunk_size) - chunks.first_chunk + 1;
+  chunks.chunks.resize(num_chunks);
+  chunks.filter_masks.resize(num_chunks);
+
+  for (std::size_t i = 0; i < num_chunks; ++i) {
+    auto chunk_offset = conditional_static_cast<hsize_t>((chunks.first_chunk + i) * chunk_size);
+    hsize_t chunk_nbytes{};
+    if (H5Dget_chunk_storage_size(dset_id, &chunk_offset, &chunk_nbytes) < 0 ||
+        chunk_nbytes == 0) {
+      // Chunk has not been allocated yet
+      return false;
+    }
+
+    auto &raw = chunks.chunks[i];
+    raw.resize(conditional_static_cast<std::size_t>(chunk_nbytes));
+    if (H5Dread_chunk(dset_id, H5P_DEFAULT, &chunk_offset, &chunks.filter_masks[i],
+                      raw.data()) < 0) {
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("failed to read chunk at offset {} from dataset {}"),
+                      chunk_offset, this->uri()));
+    }
+  }
+
+  this->record_read(offset, num, chunks.type_size, t0);
+  return true;
+}
+
+template <typename N>
+inline void Dataset::decode_chunks(internal::RawChunks &chunks, std::vector<N> &buff,
+                                   std::size_t num_threads) const {
+  static_assert(std::is_arithmetic_v<N>);
+  if (this->holds_native_type<N>()) {
+    buff.resize(chunks.num);
+    internal::decode_raw_chunks(chunks, buff.data(), num_threads);
+    return;
+  }
+  this->decode_and_convert(chunks, buff, num_threads);
+}
+
+template <typename N, std::size_t i>
+inline void Dataset::decode_and_convert(internal::RawChunks &chunks, std::vector<N> &buff,
+                                        std::size_t num_threads) const {
+  using VariantT = internal::NumericVariant;
+  if constexpr (i < std::variant_size_v<VariantT>) {
+    using T = std::variant_alternative_t<i, VariantT>;
+    if (this->_native_type_idx != i) {
+      this->decode_and_convert<N, i + 1>(chunks, buff, num_threads);
+      return;
+    }
+
+    if constexpr (internal::is_native_conversion_v<T, N>) {
+      assert(chunks.type_size == sizeof(T));
+      thread_local std::vector<T> native_buff{};
+      native_buff.resize(chunks.num);
+      internal::decode_raw_chunks(chunks, native_buff.data(), num_threads);
+      internal::convert_numeric(native_buff, buff);
+      if (native_buff.capacity() > internal::MAX_RETAINED_CONVERSION_BUFFER_SIZE) {
+        native_buff = std::vector<T>{};
+      }
+      return;
+    }
+  }
+  // fetch_chunks() does not fetch chunks storing values that cannot be converted to N
+  throw std::logic_error("Dataset::decode_chunks(): values cannot be converted without HDF5");
+}
+
+}  // namespace coolerpp
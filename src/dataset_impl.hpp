@@ -4,6 +4,10 @@
 
 #pragma once
 
+#include <H5Fpublic.h>
+#include <H5Ppublic.h>
+#include <H5Zpublic.h>
+#include <H5public.h>
 #include <fmt/format.h>
 
 #include <algorithm>
@@ -13,16 +17,27 @@
 #include <highfive/H5Exception.hpp>
 #include <highfive/H5Selection.hpp>
 #include <numeric>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <vector>
 
+#include "coolerpp/chunk_cache.hpp"
 #include "coolerpp/common.hpp"
+#include "coolerpp/remote.hpp"
 
 namespace coolerpp {
 
 namespace internal {
 
+[[nodiscard]] inline bool hdf5_library_is_threadsafe() noexcept {
+  static const bool threadsafe = []() {
+    hbool_t flag{};
+    return H5is_library_threadsafe(&flag) >= 0 && flag;
+  }();
+  return threadsafe;
+}
+
 // https://www.geeksforgeeks.org/nearest-prime-less-given-number-n/
 // https://practice.geeksforgeeks.org/user-profile.php?user=Shashank%20Mishra
 template <typename I>
@@ -48,15 +63,98 @@ template <typename I>
   return 0;
 }
 
+// Filter ids registered with the HDF Group: https://github.com/HDFGroup/hdf5_plugins
+inline constexpr H5Z_filter_t H5Z_FILTER_LZ4 = 32004;
+inline constexpr H5Z_filter_t H5Z_FILTER_BITSHUFFLE = 32008;
+inline constexpr H5Z_filter_t H5Z_FILTER_ZSTD = 32015;
+
+// Bitshuffle compression modes
+inline constexpr unsigned BSHUF_H5_COMPRESS_LZ4 = 2;
+inline constexpr unsigned BSHUF_H5_COMPRESS_ZSTD = 3;
+
+// Dataset creation property adding a filter with the given id and parameters to the pipeline
+class FilterProperty {
+  H5Z_filter_t _id{};
+  std::vector<unsigned> _cd_values{};
+
+ public:
+  FilterProperty(H5Z_filter_t id, std::vector<unsigned> cd_values)
+      : _id(id), _cd_values(std::move(cd_values)) {
+    if (H5Zfilter_avail(_id) <= 0) {
+      throw std::runtime_error(fmt::format(
+          FMT_STRING("HDF5 filter {} is not available: make sure the HDF5 filter plugins are "
+                     "installed and that HDF5_PLUGIN_PATH points to the folder where they are "
+                     "installed"),
+          _id));
+    }
+  }
+
+  void apply(hid_t hid) const {
+    if (H5Pset_filter(hid, this->_id, H5Z_FLAG_MANDATORY, this->_cd_values.size(),
+                      this->_cd_values.data()) < 0) {
+      throw std::runtime_error(fmt::format(
+          FMT_STRING("failed to add HDF5 filter {} to the filter pipeline"), this->_id));
+    }
+  }
+};
+
 }  // namespace internal
 
 inline HighFive::DataSetCreateProps Dataset::init_create_props(std::uint_fast8_t compression_lvl,
                                                                std::size_t chunk_size) {
   assert(chunk_size != 0);
+  return Dataset::init_create_props(DatasetFilters{ShuffleFilter::BYTE, Compressor::DEFLATE,
+                                                   compression_lvl,
+                                                   chunk_size / sizeof(std::int32_t)});
+}
+
+inline HighFive::DataSetCreateProps Dataset::init_create_props(const DatasetFilters &filters) {
+  if (filters.chunk_size == 0) {
+    throw std::logic_error("chunk_size cannot be zero.");
+  }
+
   HighFive::DataSetCreateProps props{};
-  props.add(HighFive::Shuffle());
-  props.add(HighFive::Deflate(conditional_static_cast<std::uint32_t>(compression_lvl)));
-  props.add(HighFive::Chunking(chunk_size / sizeof(std::int32_t)));
+  if (filters.shuffle == ShuffleFilter::BIT) {
+    // Block size is left to the filter (0), while the element size is filled in by the filter
+    // itself based on the dataset type
+    switch (filters.compressor) {
+      case Compressor::ZSTD:
+        props.add(internal::FilterProperty(
+            internal::H5Z_FILTER_BITSHUFFLE,
+            {0, internal::BSHUF_H5_COMPRESS_ZSTD, filters.compression_lvl}));
+        break;
+      case Compressor::LZ4:
+        props.add(internal::FilterProperty(internal::H5Z_FILTER_BITSHUFFLE,
+                                           {0, internal::BSHUF_H5_COMPRESS_LZ4}));
+        break;
+      case Compressor::NONE:
+      case Compressor::DEFLATE:
+        props.add(internal::FilterProperty(internal::H5Z_FILTER_BITSHUFFLE, {}));
+        break;
+    }
+    if (filters.compressor == Compressor::DEFLATE) {
+      props.add(HighFive::Deflate(filters.compression_lvl));
+    }
+  } else {
+    if (filters.shuffle == ShuffleFilter::BYTE) {
+      props.add(HighFive::Shuffle());
+    }
+    switch (filters.compressor) {
+      case Compressor::NONE:
+        break;
+      case Compressor::DEFLATE:
+        props.add(HighFive::Deflate(filters.compression_lvl));
+        break;
+      case Compressor::ZSTD:
+        props.add(internal::FilterProperty(internal::H5Z_FILTER_ZSTD, {filters.compression_lvl}));
+        break;
+      case Compressor::LZ4:
+        props.add(internal::FilterProperty(internal::H5Z_FILTER_LZ4, {}));
+        break;
+    }
+  }
+
+  props.add(HighFive::Chunking(filters.chunk_size));
   return props;
 }
 
@@ -67,7 +165,13 @@ inline HighFive::DataSetAccessProps Dataset::init_access_props(std::size_t chunk
   assert(cache_size != 0);
 
   const auto num_chunks = (std::max)(std::size_t(1), cache_size / chunk_size);
-  const auto num_slots = internal::nearest_prime(100 * num_chunks);
+  return Dataset::init_access_props(cache_size, w0, internal::nearest_prime(100 * num_chunks));
+}
+
+inline HighFive::DataSetAccessProps Dataset::init_access_props(std::size_t cache_size, double w0,
+                                                               std::size_t num_slots) {
+  assert(num_slots != 0);
+  assert(w0 >= 0.0 && w0 <= 1.0);
 
   HighFive::DataSetAccessProps props{};
   props.add(HighFive::Caching(num_slots, cache_size, w0));
@@ -84,7 +188,19 @@ inline HighFive::DataSetAccessProps Dataset::default_access_props() {
 }
 
 inline Dataset::Dataset(RootGroup root_group, HighFive::DataSet dset)
-    : _root_group(std::move(root_group)), _dataset(std::move(dset)) {}
+    : _root_group(std::move(root_group)),
+      _dataset(std::move(dset)),
+      _chunk_cache_key(init_chunk_cache_key(_root_group, _dataset)),
+      _native_type_idx(internal::detect_numeric_variant_index(this->get_h5type())) {
+  // Querying the chunk cache size requires a round-trip through the access property list of the
+  // dataset: skip it when there is no budget to account for
+  if (auto &budget = MemoryBudget::instance(); budget.enabled()) {
+    this->_memory_reservation = budget.reserve(this->chunk_cache_size());
+  }
+  if constexpr (STATS_ENABLED) {
+    this->_io_counters = std::make_shared<internal::IOCounters>(this->chunk_size());
+  }
+}
 
 inline Dataset::Dataset(RootGroup root_group, std::string_view path_to_dataset,
                         const HighFive::DataSetAccessProps &aprops)
@@ -106,6 +222,35 @@ inline Dataset::Dataset(RootGroup root_group, std::string_view path_to_dataset,
     : Dataset(root_group, create_fixed_str_dataset(root_group, path_to_dataset, longest_str.size(),
                                                    max_dim, aprops, cprops)) {}
 
+inline bool Dataset::chunk_cache_enabled() const { return !this->chunk_cache_key().empty(); }
+
+inline const std::string &Dataset::chunk_cache_key() const noexcept {
+  return this->_chunk_cache_key;
+}
+
+inline internal::IOCounters *Dataset::io_counters() const noexcept {
+  return this->_io_counters.get();
+}
+
+inline std::string Dataset::init_chunk_cache_key(const RootGroup &root_group,
+                                                 const HighFive::DataSet &dset) {
+  const auto f = root_group().getFile();
+  unsigned intent{};
+  if (H5Fget_intent(f.getId(), &intent) < 0 || intent != H5F_ACC_RDONLY) {
+    return "";
+  }
+
+  const auto file_name = f.getName();
+  if (is_remote_path(file_name)) {
+    hsize_t file_size{};
+    if (H5Fget_filesize(f.getId(), &file_size) < 0) {
+      return "";
+    }
+    return ChunkCache::make_remote_dataset_key(file_name, file_size, dset.getPath());
+  }
+  return ChunkCache::make_dataset_key(file_name, dset.getPath());
+}
+
 inline void Dataset::resize(std::size_t new_size) {
   if (new_size > this->_dataset.getElementCount()) {
     this->_dataset.resize({new_size});
@@ -160,8 +305,10 @@ inline void Dataset::throw_out_of_range_excp(std::size_t offset, std::size_t n)
 }
 
 template <typename T, std::size_t CHUNK_SIZE>
-inline auto Dataset::make_iterator_at_offset(std::size_t offset) const -> iterator<T, CHUNK_SIZE> {
-  return iterator<T, CHUNK_SIZE>(*this, offset);
+inline auto Dataset::make_iterator_at_offset(std::size_t offset, bool prefetch,
+                                             std::size_t initial_block_size) const
+    -> iterator<T, CHUNK_SIZE> {
+  return iterator<T, CHUNK_SIZE>(*this, offset, true, prefetch, initial_block_size);
 }
 
 inline HighFive::Selection Dataset::select(std::size_t i) {
@@ -12,19 +12,51 @@
 #include <highfive/H5Exception.hpp>
 #include <highfive/H5File.hpp>
 #include <highfive/H5Selection.hpp>
+#include <future>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "coolerpp/chunk_cache.hpp"
 #include "coolerpp/common.hpp"
+#include "coolerpp/internal/buffer_pool.hpp"
+#include "coolerpp/internal/query_pool.hpp"
 #include "coolerpp/internal/type_pretty_printer.hpp"
+#include "coolerpp/stats.hpp"
+#include "coolerpp/trace.hpp"
 
 namespace coolerpp {
 
+namespace internal {
+
+// Threads reading blocks ahead of Dataset::iterator. The pool is shared by all iterators, so that
+// the number of threads does not grow with the number of datasets being traversed, and threads
+// keep their thread-local buffers across blocks
+inline QueryPool &prefetch_pool() {
+  static QueryPool pool{DEFAULT_PREFETCH_THREADS};
+  return pool;
+}
+
+}  // namespace internal
+
+template <typename T, std::size_t CHUNK_SIZE>
+inline Dataset::iterator<T, CHUNK_SIZE>::PrefetchedBlock::~PrefetchedBlock() noexcept {
+  if (this->buff.valid()) {
+    this->buff.wait();
+  }
+}
+
 template <typename T, std::size_t CHUNK_SIZE>
 inline Dataset::iterator<T, CHUNK_SIZE>::iterator(const Dataset &dset, std::size_t h5_offset,
-                                                  bool init)
-    : _dset(&dset), _h5_chunk_start(h5_offset), _h5_offset(h5_offset) {
+                                                  bool init, bool prefetch,
+                                                  std::size_t initial_block_size)
+    : _dset(&dset),
+      _h5_chunk_start(h5_offset),
+      _h5_offset(h5_offset),
+      _prefetch(prefetch &&
+                (dset.reads_bypass_hdf5<T>() || internal::hdf5_library_is_threadsafe())),
+      _block_size(initial_block_size == 0 ? CHUNK_SIZE
+                                          : (std::min)(initial_block_size, CHUNK_SIZE)) {
   if (init) {
     this->read_chunk_at_offset(this->_h5_chunk_start);
   }
@@ -125,7 +157,7 @@ inline auto Dataset::iterator<T, CHUNK_SIZE>::operator+(std::size_t i) const ->
   assert(new_offset <= this->_dset->size());
 
   if (!this->_buff || this->_h5_chunk_start + this->_buff->size() < new_offset) {
-    return iterator(*this->_dset, new_offset);
+    return iterator(*this->_dset, new_offset, true, this->_prefetch, this->_block_size);
   }
 
   auto it = *this;
@@ -143,7 +175,8 @@ inline auto Dataset::iterator<T, CHUNK_SIZE>::operator--(int) -> iterator {
   auto it = *this;
   std::ignore = --(*this);
   if (this->_h5_offset < this->_h5_chunk_start) {
-    this->read_chunk_at_offset(this->_h5_offset - (std::min)(CHUNK_SIZE - 1, this->_h5_offset));
+    this->read_chunk_at_offset(this->_h5_offset -
+                               (std::min)(this->_block_size - 1, this->_h5_offset));
   }
   return it;
 }
@@ -165,7 +198,7 @@ inline auto Dataset::iterator<T, CHUNK_SIZE>::operator-(std::size_t i) const ->
   }
 
   assert(this->_dset);
-  return iterator(*this->_dset, new_offset);
+  return iterator(*this->_dset, new_offset, true, this->_prefetch, this->_block_size);
 }
 
 template <typename T, std::size_t CHUNK_SIZE>
@@ -185,6 +218,11 @@ constexpr std::size_t Dataset::iterator<T, CHUNK_SIZE>::underlying_buff_capacity
   return CHUNK_SIZE;
 }
 
+template <typename T, std::size_t CHUNK_SIZE>
+constexpr std::size_t Dataset::iterator<T, CHUNK_SIZE>::block_size() const noexcept {
+  return this->_block_size;
+}
+
 template <typename T, std::size_t CHUNK_SIZE>
 constexpr std::size_t Dataset::iterator<T, CHUNK_SIZE>::lower_bound() const noexcept {
   return this->_h5_chunk_start;
@@ -195,7 +233,7 @@ constexpr std::size_t Dataset::iterator<T, CHUNK_SIZE>::upper_bound() const noex
   if (this->_buff) {
     return this->_h5_chunk_start + this->_buff->size();
   }
-  return this->_h5_chunk_start + CHUNK_SIZE;
+  return this->_h5_chunk_start + this->_block_size;
 }
 
 template <typename T, std::size_t CHUNK_SIZE>
@@ -234,31 +272,145 @@ constexpr std::size_t Dataset::iterator<T, CHUNK_SIZE>::underlying_buff_num_avai
   return this->upper_bound() - this->_h5_offset;
 }
 
+template <typename T, std::size_t CHUNK_SIZE>
+inline auto Dataset::iterator<T, CHUNK_SIZE>::underlying_buff() const
+    -> std::shared_ptr<const std::vector<T>> {
+  std::ignore = **this;
+  assert(this->underlying_buff_status() == OVERLAPPING);
+  return this->_buff;
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+constexpr std::size_t Dataset::iterator<T, CHUNK_SIZE>::underlying_buff_offset() const noexcept {
+  assert(this->_h5_offset >= this->_h5_chunk_start);
+  return this->_h5_offset - this->_h5_chunk_start;
+}
+
 template <typename T, std::size_t CHUNK_SIZE>
 constexpr const Dataset &Dataset::iterator<T, CHUNK_SIZE>::dataset() const noexcept {
   return *this->_dset;
 }
 
+template <typename T, std::size_t CHUNK_SIZE>
+constexpr bool Dataset::iterator<T, CHUNK_SIZE>::prefetch_enabled() const noexcept {
+  return this->_prefetch;
+}
+
 template <typename T, std::size_t CHUNK_SIZE>
 inline void Dataset::iterator<T, CHUNK_SIZE>::read_chunk_at_offset(std::size_t new_offset) const {
   assert(this->_dset);
 
   if (new_offset == this->_dset->size()) {
     this->_buff = nullptr;
+    this->_next_block = nullptr;
     this->_h5_chunk_start = this->_dset->size();
     return;
   }
 
-  if (!this->_buff || this->_buff.use_count() > 1) {
-    //  This should be fine, as copying Dataset::iterator is not thread-safe anyway
-    this->_buff = std::make_shared<std::vector<T>>(CHUNK_SIZE);
+  const internal::TraceScope trace_scope{"coolerpp::Dataset::iterator::read_chunk_at_offset"};
+  if constexpr (STATS_ENABLED) {
+    if (auto *counters = this->_dset->io_counters(); counters) {
+      counters->add_block_read();
+    }
   }
 
-  const auto buff_size = (std::min)(CHUNK_SIZE, this->_dset->size() - new_offset);
-  this->_buff->resize(buff_size);
-  this->_dset->read(*this->_buff, buff_size, new_offset);
+  // Only prefetch when the dataset is being traversed sequentially, as reading chunks ahead of time
+  // is wasteful when e.g. performing binary searches
+  const auto sequential_access =
+      !!this->_buff && new_offset == this->_h5_chunk_start + this->_buff->size();
+  if (sequential_access && this->_block_size < CHUNK_SIZE) {
+    // Grow blocks geometrically when reading sequentially, so that long scans quickly reach the
+    // maximum block size while short queries only read what they need
+    this->_block_size = (std::min)(2 * this->_block_size, CHUNK_SIZE);
+  }
+
+  if (this->_next_block && this->_next_block->offset == new_offset) {
+    this->_buff = this->_next_block->buff.get();
+    this->_next_block = nullptr;
+  } else {
+    this->_next_block = nullptr;
+    this->_buff = read_block(*this->_dset, new_offset, this->_block_size, std::move(this->_buff));
+  }
 
   this->_h5_chunk_start = new_offset;
+
+  if (this->_prefetch && sequential_access) {
+    this->prefetch_chunk_at_offset(new_offset + this->_buff->size());
+  }
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+inline void Dataset::iterator<T, CHUNK_SIZE>::prefetch_chunk_at_offset(std::size_t offset) const {
+  assert(this->_dset);
+  assert(this->_prefetch);
+
+  const auto dset_size = this->_dset->size();
+  if (offset >= dset_size) {
+    return;
+  }
+
+  // The buffer is taken from the pool of the thread consuming the blocks, so that it becomes
+  // available to this thread again once the iterator is done with it
+  const auto buff_size = (std::min)(this->_block_size, dset_size - offset);
+  auto buff = internal::BufferPool<T>::local().acquire(buff_size);
+  const auto *dset = this->_dset;
+  auto block = std::make_shared<PrefetchedBlock>();
+  block->offset = offset;
+  block->buff = internal::prefetch_pool()
+                    .submit([dset, offset, buff_size, buff = std::move(buff)]() mutable {
+                      if (auto cached_block = find_cached_block(*dset, offset, buff_size);
+                          cached_block) {
+                        return cached_block;
+                      }
+                      return read_uncached_block(*dset, offset, buff_size, std::move(buff));
+                    })
+                    .share();
+  this->_next_block = std::move(block);
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+inline auto Dataset::iterator<T, CHUNK_SIZE>::read_block(const Dataset &dset, std::size_t offset,
+                                                         std::size_t block_size,
+                                                         std::shared_ptr<std::vector<T>> buff)
+    -> std::shared_ptr<std::vector<T>> {
+  assert(block_size != 0 && block_size <= CHUNK_SIZE);
+  const auto buff_size = (std::min)(block_size, dset.size() - offset);
+  if (auto block = find_cached_block(dset, offset, buff_size); block) {
+    return block;
+  }
+
+  // Shared buffers (e.g. after copying an iterator) are replaced with a free buffer from the pool.
+  // This should be fine, as copying Dataset::iterator is not thread-safe anyway
+  buff = internal::BufferPool<T>::local().acquire(buff_size, std::move(buff));
+  return read_uncached_block(dset, offset, buff_size, std::move(buff));
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+inline auto Dataset::iterator<T, CHUNK_SIZE>::find_cached_block(const Dataset &dset,
+                                                                std::size_t offset,
+                                                                std::size_t buff_size)
+    -> std::shared_ptr<std::vector<T>> {
+  auto &cache = ChunkCache::instance();
+  if (!cache.enabled() || !dset.chunk_cache_enabled()) {
+    return nullptr;
+  }
+  // Cached blocks are never modified: iterators only reuse buffers that are not shared
+  return std::const_pointer_cast<std::vector<T>>(
+      cache.find<T>(dset.chunk_cache_key(), offset, buff_size));
+}
+
+template <typename T, std::size_t CHUNK_SIZE>
+inline auto Dataset::iterator<T, CHUNK_SIZE>::read_uncached_block(
+    const Dataset &dset, std::size_t offset, std::size_t buff_size,
+    std::shared_ptr<std::vector<T>> buff) -> std::shared_ptr<std::vector<T>> {
+  assert(buff);
+  buff->resize(buff_size);
+  dset.read(*buff, buff_size, offset);
+
+  if (auto &cache = ChunkCache::instance(); cache.enabled() && dset.chunk_cache_enabled()) {
+    cache.insert<T>(dset.chunk_cache_key(), offset, buff);
+  }
+  return buff;
 }
 
 template <typename T, std::size_t CHUNK_SIZE>
@@ -4,52 +4,170 @@
 
 #pragma once
 
+#include <H5Dpublic.h>
+
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <highfive/H5DataType.hpp>
 #include <highfive/H5Utility.hpp>
 #include <string>
 #include <string_view>
+#include <type_traits>
+#include <variant>
 #include <vector>
 
 #include "coolerpp/attribute.hpp"
 #include "coolerpp/common.hpp"
+#include "coolerpp/internal/numeric_utils.hpp"
+#include "coolerpp/internal/numeric_variant.hpp"
+#include "coolerpp/stats.hpp"
 
 namespace coolerpp {
 
 template <typename N, typename>
 inline std::size_t Dataset::read(std::vector<N> &buff, std::size_t num, std::size_t offset) const {
+  if (this->_direct_reader) {
+    // Keep clear of libhdf5 (including HighFive::SilenceHDF5) unless values need to be converted
+    // to a type that differs from the one used to store them on disk
+    const auto &reader = *this->_direct_reader;
+    if (offset + num > reader.size()) {
+      this->throw_out_of_range_excp(offset, num);
+    }
+    if (reader.holds<N>()) {
+      const auto t0 = internal::IOCounters::now();
+      buff.resize(num);
+      [[maybe_unused]] const auto bytes_read = reader.read(buff.data(), num, offset);
+      if constexpr (STATS_ENABLED) {
+        if (this->_io_counters && num != 0) {
+          const auto num_chunks =
+              ((offset + num - 1) / reader.chunk_size()) - (offset / reader.chunk_size()) + 1;
+          this->_io_counters->add_read(num_chunks, bytes_read, num * sizeof(N), t0);
+        }
+      }
+      return offset + num;
+    }
+    if (this->read_and_convert(buff, num, offset)) {
+      return offset + num;
+    }
+  }
+
   [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
   if (offset + num > this->size()) {
     this->throw_out_of_range_excp(offset, num);
   }
 
-  auto h5type = this->get_h5type();
+  if (!this->holds_native_type<N>() && this->read_and_convert(buff, num, offset)) {
+    return offset + num;
+  }
+
+  const auto t0 = internal::IOCounters::now();
   buff.resize(num);
-  this->select(offset, num).read(buff.data(), HighFive::create_datatype<N>());
+  if (this->_decompression_threads <= 1 || !this->read_chunks_parallel(buff, num, offset)) {
+    this->select(offset, num).read(buff.data(), HighFive::create_datatype<N>());
+  }
 
+  this->record_read(offset, num, sizeof(N), t0);
   return offset + num;
 }
 
 inline std::size_t Dataset::read(std::vector<std::string> &buff, std::size_t num,
                                  std::size_t offset) const {
+  std::vector<std::string_view> views{};
+  std::string arena{};
+  this->read(views, arena, num, offset);
+
+  buff.resize(num);
+  std::copy(views.begin(), views.end(), buff.begin());
+  return offset + num;
+}
+
+inline std::size_t Dataset::read(std::vector<std::string_view> &buff, std::string &arena,
+                                 std::size_t num, std::size_t offset) const {
+  [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
   if (offset + num > this->size()) {
     this->throw_out_of_range_excp(offset, num);
   }
 
+  const auto t0 = internal::IOCounters::now();
   buff.resize(num);
-  const auto str_length = this->_dataset.getDataType().getSize();
-  std::string strbuff(this->size() * str_length, '\0');
-  this->_dataset.read(strbuff.data(), this->_dataset.getDataType());
+  const auto h5type = this->get_h5type();
+  if (h5type.isVariableStr()) {
+    std::vector<std::string> strings{};
+    if (num != 0) {
+      this->select(offset, num).read(strings);
+    }
+    arena.clear();
+    for (const auto &s : strings) {
+      arena.append(s);
+    }
+    this->record_read(offset, num, arena.size() / (std::max)(num, std::size_t(1)), t0);
+
+    std::size_t i0 = 0;
+    for (std::size_t i = 0; i < strings.size(); ++i) {
+      buff[i] = std::string_view{arena}.substr(i0, strings[i].size());
+      i0 += strings[i].size();
+    }
+    return offset + num;
+  }
+
+  const auto str_length = h5type.getSize();
+  arena.resize(num * str_length);
+  if (num != 0) {
+    this->select(offset, num).read(arena.data(), h5type);
+  }
+  this->record_read(offset, num, str_length, t0);
+
+  // Fixed-length strings are null-padded
+  for (std::size_t i = 0; i < num; ++i) {
+    const auto str = std::string_view{arena}.substr(i * str_length, str_length);
+    buff[i] = str.substr(0, (std::min)(str.find('\0'), str.size()));
+  }
+
+  return offset + num;
+}
 
-  for (std::size_t i = 0; i < buff.size(); ++i) {
-    const auto i0 = (offset + i) * str_length;
-    const auto i1 = (std::min)(strbuff.find('\0', i0), i0 + str_length);
+template <typename N>
+inline constexpr bool Dataset::holds_native_type() const noexcept {
+  return this->_native_type_idx == internal::numeric_variant_index<N>();
+}
 
-    buff[i] = strbuff.substr(i0, i1 - i0);
+template <typename N, std::size_t i>
+inline bool Dataset::converts_natively() const noexcept {
+  using VariantT = internal::NumericVariant;
+  if constexpr (i < std::variant_size_v<VariantT>) {
+    using T = std::variant_alternative_t<i, VariantT>;
+    if (this->_native_type_idx != i) {
+      return this->converts_natively<N, i + 1>();
+    }
+    return std::is_same_v<T, N> || internal::is_native_conversion_v<T, N>;
+  } else {
+    return false;
   }
+}
+
+template <typename N, std::size_t i>
+inline bool Dataset::read_and_convert([[maybe_unused]] std::vector<N> &buff,
+                                      [[maybe_unused]] std::size_t num,
+                                      [[maybe_unused]] std::size_t offset) const {
+  using VariantT = internal::NumericVariant;
+  if constexpr (i < std::variant_size_v<VariantT>) {
+    using T = std::variant_alternative_t<i, VariantT>;
+    if (this->_native_type_idx != i) {
+      return this->read_and_convert<N, i + 1>(buff, num, offset);
+    }
 
-  return offset + buff.size();
+    if constexpr (internal::is_native_conversion_v<T, N>) {
+      thread_local std::vector<T> native_buff{};
+      this->read(native_buff, num, offset);
+      internal::convert_numeric(native_buff, buff);
+      if (native_buff.capacity() > internal::MAX_RETAINED_CONVERSION_BUFFER_SIZE) {
+        native_buff = std::vector<T>{};
+      }
+      return true;
+    }
+  }
+  return false;
 }
 
 template <std::size_t i>
@@ -123,7 +241,9 @@ inline std::size_t Dataset::read(N &buff, std::size_t offset) const {
     this->throw_out_of_range_excp(offset);
   }
 
+  const auto t0 = internal::IOCounters::now();
   this->select(offset, 1).read(&buff, HighFive::create_datatype<N>());
+  this->record_read(offset, 1, sizeof(N), t0);
   return offset + 1;
 }
 
@@ -133,10 +253,12 @@ inline std::size_t Dataset::read(std::string &buff, std::size_t offset) const {
     this->throw_out_of_range_excp(offset);
   }
 
+  const auto t0 = internal::IOCounters::now();
   auto h5type = this->get_h5type();
   const auto str_length = h5type.getSize();
   buff.resize(str_length);
   this->select(offset, 1).read(buff.data(), h5type);
+  this->record_read(offset, 1, str_length, t0);
 
   const auto i1 = (std::min)(buff.find('\0'), buff.size());
   buff.resize(i1);
@@ -227,4 +349,36 @@ inline auto Dataset::read_attribute(std::string_view key, bool missing_ok) const
   return Attribute::read(this->_dataset, key, missing_ok);
 }
 
+inline void Dataset::record_read(
+    [[maybe_unused]] std::size_t offset, [[maybe_unused]] std::size_t num,
+    [[maybe_unused]] std::size_t type_size,
+    [[maybe_unused]] internal::IOCounters::time_point t0) const noexcept {
+  if constexpr (STATS_ENABLED) {
+    if (!this->_io_counters) {
+      return;
+    }
+    const auto chunk_size = this->_io_counters->chunk_size();
+    const auto bytes_decompressed = num * type_size;
+    if (chunk_size == 0 || num == 0) {
+      // Values of contiguous datasets are read as they are stored
+      this->_io_counters->add_read(0, bytes_decompressed, bytes_decompressed, t0);
+      return;
+    }
+
+    [[maybe_unused]] const HighFive::SilenceHDF5 silencer{};  // NOLINT
+    const auto first_chunk = offset / chunk_size;
+    const auto last_chunk = (offset + num - 1) / chunk_size;
+    std::size_t bytes_read = 0;
+    for (auto i = first_chunk; i <= last_chunk; ++i) {
+      auto chunk_offset = conditional_static_cast<hsize_t>(i * chunk_size);
+      hsize_t chunk_nbytes{};
+      if (H5Dget_chunk_storage_size(this->_dataset.getId(), &chunk_offset, &chunk_nbytes) >= 0) {
+        bytes_read += conditional_static_cast<std::size_t>(chunk_nbytes);
+      }
+    }
+    this->_io_counters->add_read(last_chunk - first_chunk + 1, bytes_read, bytes_decompressed,
+                                 t0);
+  }
+}
+
 }  // namespace coolerpp
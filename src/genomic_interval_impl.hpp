@@ -7,12 +7,16 @@
 #include <fmt/format.h>
 
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <charconv>
 #include <cstdint>
 #include <limits>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <system_error>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -95,102 +99,320 @@ inline const Chromosome &GenomicInterval::chrom() const noexcept { return this->
 constexpr std::uint32_t GenomicInterval::start() const noexcept { return this->_start; }
 constexpr std::uint32_t GenomicInterval::end() const noexcept { return this->_end; }
 
-inline GenomicInterval GenomicInterval::parse_ucsc(const ChromosomeSet &chroms, std::string query) {
+namespace internal {
+// Parse a genomic position. When allow_thousands_sep is true, positions like 1,000,000 are also
+// accepted
+[[nodiscard]] inline bool parse_genomic_position(std::string_view tok, std::uint32_t &pos,
+                                                 bool allow_thousands_sep) noexcept {
+  if (tok.empty()) {
+    return false;
+  }
+
+  if (!allow_thousands_sep || tok.find(',') == std::string_view::npos) {
+    const auto *last = tok.data() + tok.size();  // NOLINT
+    const auto [ptr, ec] = std::from_chars(tok.data(), last, pos);
+    return ec == std::errc{} && ptr == last;
+  }
+
+  if (tok.front() == ',' || tok.back() == ',') {
+    return false;
+  }
+
+  std::uint64_t n = 0;
+  for (const auto c : tok) {
+    if (c == ',') {
+      continue;
+    }
+    if (c < '0' || c > '9') {
+      return false;
+    }
+    n = (n * 10) + static_cast<std::uint64_t>(c - '0');
+    if (n > (std::numeric_limits<std::uint32_t>::max)()) {
+      return false;
+    }
+  }
+  pos = static_cast<std::uint32_t>(n);
+  return true;
+}
+}  // namespace internal
+
+inline GenomicInterval GenomicInterval::parse_ucsc(const ChromosomeSet &chroms,
+                                                   std::string_view query) {
+  GenomicInterval gi{};
+  if (const auto status = GenomicInterval::try_parse_ucsc(chroms, query, gi);
+      status != ParseStatus::OK) {
+    QueryTokens tokens{};
+    std::ignore = GenomicInterval::tokenize_ucsc(query, tokens);
+    GenomicInterval::throw_parse_error(status, chroms, query, tokens);
+  }
+  return gi;
+}
+
+inline GenomicInterval GenomicInterval::parse_bed(const ChromosomeSet &chroms,
+                                                  std::string_view query, char sep) {
+  GenomicInterval gi{};
+  if (const auto status = GenomicInterval::try_parse_bed(chroms, query, gi, sep);
+      status != ParseStatus::OK) {
+    QueryTokens tokens{};
+    std::ignore = GenomicInterval::tokenize_bed(query, sep, tokens);
+    GenomicInterval::throw_parse_error(status, chroms, query, tokens);
+  }
+  return gi;
+}
+
+inline ParseStatus GenomicInterval::try_parse_ucsc(const ChromosomeSet &chroms,
+                                                   std::string_view query,
+                                                   GenomicInterval &gi) noexcept {
   if (query.empty()) {
-    throw std::runtime_error("query is empty");
+    return ParseStatus::EMPTY_QUERY;
   }
 
   if (const auto match = chroms.find(query); match != chroms.end()) {
-    return GenomicInterval{*match};
+    gi = GenomicInterval{*match};
+    return ParseStatus::OK;
   }
 
-  const auto p1 = query.find_last_of(':');
-  const auto p2 = query.find_last_of('-');
+  QueryTokens tokens{};
+  if (const auto status = GenomicInterval::tokenize_ucsc(query, tokens);
+      status != ParseStatus::OK) {
+    return status;
+  }
+  return GenomicInterval::parse_tokens(chroms, tokens, gi);
+}
+
+inline ParseStatus GenomicInterval::try_parse_bed(const ChromosomeSet &chroms,
+                                                  std::string_view query, GenomicInterval &gi,
+                                                  char sep) noexcept {
+  QueryTokens tokens{};
+  if (const auto status = GenomicInterval::tokenize_bed(query, sep, tokens);
+      status != ParseStatus::OK) {
+    return status;
+  }
+  return GenomicInterval::parse_tokens(chroms, tokens, gi);
+}
+
+inline ParseStatus GenomicInterval::try_parse_bedpe(
+    const ChromosomeSet &chroms, std::string_view buffer,
+    std::vector<std::pair<GenomicInterval, GenomicInterval>> &queries, std::size_t &line_number,
+    char sep) {
+  for (std::size_t i = 0; !buffer.empty(); ++i) {
+    const auto pos = buffer.find('\n');
+    auto record = buffer.substr(0, pos);
+    buffer.remove_prefix(pos == std::string_view::npos ? buffer.size() : pos + 1);
+
+    if (!record.empty() && record.back() == '\r') {
+      record.remove_suffix(1);
+    }
+    if (record.empty() || record.front() == '#') {
+      continue;
+    }
+
+    QueryTokens tokens1{};
+    QueryTokens tokens2{};
+    GenomicInterval gi1{};
+    GenomicInterval gi2{};
+    auto status = GenomicInterval::tokenize_bedpe(record, sep, tokens1, tokens2);
+    if (status == ParseStatus::OK) {
+      status = GenomicInterval::parse_tokens(chroms, tokens1, gi1);
+    }
+    if (status == ParseStatus::OK) {
+      status = GenomicInterval::parse_tokens(chroms, tokens2, gi2);
+    }
+    if (status != ParseStatus::OK) {
+      line_number = i;
+      return status;
+    }
+    queries.emplace_back(gi1, gi2);
+  }
+  return ParseStatus::OK;
+}
+
+inline auto GenomicInterval::parse_bedpe(const ChromosomeSet &chroms, std::string_view buffer,
+                                         char sep)
+    -> std::vector<std::pair<GenomicInterval, GenomicInterval>> {
+  std::vector<std::pair<GenomicInterval, GenomicInterval>> queries{};
+  std::size_t line_number{};
+  if (GenomicInterval::try_parse_bedpe(chroms, buffer, queries, line_number, sep) ==
+      ParseStatus::OK) {
+    return queries;
+  }
 
-  if (p1 == std::string::npos && p2 == std::string::npos) {
-    throw std::runtime_error(
-        fmt::format(FMT_STRING("invalid chromosome \"{0}\" in query \"{0}\""), query));
+  // Find the offending record and re-parse it to generate a meaningful error message
+  for (std::size_t i = 0; i < line_number; ++i) {
+    buffer.remove_prefix(buffer.find('\n') + 1);
+  }
+  auto record = buffer.substr(0, buffer.find('\n'));
+  if (!record.empty() && record.back() == '\r') {
+    record.remove_suffix(1);
   }
 
-  if (p1 == std::string::npos || p2 == std::string::npos || p1 > p2) {
-    throw std::runtime_error(fmt::format(FMT_STRING("query \"{}\" is malformed"), query));
+  try {
+    QueryTokens tokens1{};
+    QueryTokens tokens2{};
+    GenomicInterval gi{};
+    auto status = GenomicInterval::tokenize_bedpe(record, sep, tokens1, tokens2);
+    if (status != ParseStatus::OK) {
+      GenomicInterval::throw_parse_error(status, chroms, record, tokens1);
+    }
+    status = GenomicInterval::parse_tokens(chroms, tokens1, gi);
+    if (status != ParseStatus::OK) {
+      GenomicInterval::throw_parse_error(status, chroms, record, tokens1);
+    }
+    status = GenomicInterval::parse_tokens(chroms, tokens2, gi);
+    assert(status != ParseStatus::OK);
+    GenomicInterval::throw_parse_error(status, chroms, record, tokens2);
+  } catch (const std::exception &e) {
+    throw std::runtime_error(fmt::format(FMT_STRING("failed to parse BEDPE record at line {}: {}"),
+                                         line_number + 1, e.what()));
   }
+  unreachable_code();
+}
+
+inline ParseStatus GenomicInterval::tokenize_ucsc(std::string_view query,
+                                                  QueryTokens &tokens) noexcept {
+  const auto p1 = query.find_last_of(':');
+  const auto p2 = query.find_last_of('-');
 
-  if (query.find(',', p1) != std::string::npos) {
-    query.erase(std::remove(query.begin() + std::ptrdiff_t(p1), query.end(), ','));
+  if (p1 == std::string_view::npos && p2 == std::string_view::npos) {
+    tokens.chrom_name = query;
+    return ParseStatus::INVALID_CHROMOSOME;
   }
 
-  query[p1] = '\t';
-  query[p2] = '\t';
+  if (p1 == std::string_view::npos || p2 == std::string_view::npos || p1 > p2) {
+    return ParseStatus::MALFORMED_QUERY;
+  }
 
-  return GenomicInterval::parse_bed(chroms, query);
+  tokens.chrom_name = query.substr(0, p1);
+  tokens.start_pos = query.substr(p1 + 1, p2 - (p1 + 1));
+  tokens.end_pos = query.substr(p2 + 1);
+  tokens.allow_thousands_sep = true;
+  return ParseStatus::OK;
 }
 
-inline GenomicInterval GenomicInterval::parse_bed(const ChromosomeSet &chroms,
-                                                  std::string_view query, char sep) {
+inline ParseStatus GenomicInterval::tokenize_bed(std::string_view query, char sep,
+                                                 QueryTokens &tokens) noexcept {
   if (query.empty()) {
-    throw std::runtime_error("query is empty");
+    return ParseStatus::EMPTY_QUERY;
   }
 
   const auto p1 = query.find(sep);
+  if (p1 == std::string_view::npos) {
+    return ParseStatus::MALFORMED_QUERY;
+  }
   const auto p2 = query.find(sep, p1 + 1);
+  if (p2 == std::string_view::npos) {
+    return ParseStatus::MALFORMED_QUERY;
+  }
 
-  if (p1 == std::string_view::npos || p2 == std::string_view::npos || p1 > p2) {
-    throw std::runtime_error(fmt::format(FMT_STRING("query \"{}\" is malformed"), query));
+  tokens.chrom_name = query.substr(0, p1);
+  tokens.start_pos = query.substr(p1 + 1, p2 - (p1 + 1));
+  tokens.end_pos = query.substr(p2 + 1);
+  tokens.allow_thousands_sep = false;
+  return ParseStatus::OK;
+}
+
+inline ParseStatus GenomicInterval::tokenize_bedpe(std::string_view record, char sep,
+                                                   QueryTokens &tokens1,
+                                                   QueryTokens &tokens2) noexcept {
+  std::array<std::string_view, 6> fields{};
+  for (std::size_t i = 0; i < fields.size(); ++i) {
+    if (i != 0 && record.empty()) {
+      return ParseStatus::MALFORMED_QUERY;
+    }
+    const auto pos = record.find(sep);
+    fields[i] = record.substr(0, pos);
+    record.remove_prefix(pos == std::string_view::npos ? record.size() : pos + 1);
   }
 
-  const auto chrom_name = query.substr(0, p1);
-  const auto start_pos_str = query.substr(p1 + 1, p2 - (p1 + 1));
-  const auto end_pos_str = query.substr(p2 + 1);
+  tokens1 = QueryTokens{fields[0], fields[1], fields[2], false};
+  tokens2 = QueryTokens{fields[3], fields[4], fields[5], false};
+  return ParseStatus::OK;
+}
 
-  const auto match = chroms.find(chrom_name);
+inline ParseStatus GenomicInterval::parse_tokens(const ChromosomeSet &chroms,
+                                                 const QueryTokens &tokens,
+                                                 GenomicInterval &gi) noexcept {
+  const auto match = chroms.find(tokens.chrom_name);
   if (match == chroms.end()) {
-    throw std::runtime_error(
-        fmt::format(FMT_STRING("invalid chromosome \"{}\" in query \"{}\""), chrom_name, query));
+    return ParseStatus::INVALID_CHROMOSOME;
   }
 
-  if (start_pos_str.empty()) {
-    throw std::runtime_error(
-        fmt::format(FMT_STRING("query \"{}\" is malformed: missing start position"), query));
+  if (tokens.start_pos.empty()) {
+    return ParseStatus::MISSING_START_POSITION;
   }
-
-  if (end_pos_str.empty()) {
-    throw std::runtime_error(
-        fmt::format(FMT_STRING("query \"{}\" is malformed: missing end position"), query));
+  if (tokens.end_pos.empty()) {
+    return ParseStatus::MISSING_END_POSITION;
   }
 
-  GenomicInterval gi{*match};
-
-  try {
-    internal::parse_numeric_or_throw(start_pos_str, gi._start);
-  } catch (const std::exception &e) {
-    throw std::runtime_error(
-        fmt::format(FMT_STRING("invalid start position \"{}\" in query \"{}\": {}"), start_pos_str,
-                    query, e.what()));
+  std::uint32_t start_pos{};
+  std::uint32_t end_pos{};
+  if (!internal::parse_genomic_position(tokens.start_pos, start_pos,
+                                        tokens.allow_thousands_sep)) {
+    return ParseStatus::INVALID_START_POSITION;
   }
-  try {
-    internal::parse_numeric_or_throw(end_pos_str, gi._end);
-  } catch (const std::exception &e) {
-    throw std::runtime_error(
-        fmt::format(FMT_STRING("invalid end position \"{}\" in query \"{}\": {}"), end_pos_str,
-                    query, e.what()));
+  if (!internal::parse_genomic_position(tokens.end_pos, end_pos, tokens.allow_thousands_sep)) {
+    return ParseStatus::INVALID_END_POSITION;
   }
 
-  if (gi._end > gi.chrom().size()) {
-    throw std::runtime_error(
-        fmt::format(FMT_STRING("invalid end position \"{0}\" in query \"{1}\": end position is "
-                               "greater than the chromosome size ({0} > {2})"),
-                    gi._end, query, gi.chrom().size()));
+  if (end_pos > match->size()) {
+    return ParseStatus::END_POSITION_OUT_OF_BOUNDS;
   }
-
-  if (gi._start >= gi._end) {
-    throw std::runtime_error(
-        fmt::format(FMT_STRING("invalid query \"{}\": query end position should be "
-                               "greater than the start position ({} >= {})"),
-                    query, gi._start, gi._end));
+  if (start_pos >= end_pos) {
+    return ParseStatus::EMPTY_INTERVAL;
   }
 
-  return gi;
+  gi = GenomicInterval{*match, start_pos, end_pos};
+  return ParseStatus::OK;
+}
+
+inline void GenomicInterval::throw_parse_error(ParseStatus status, const ChromosomeSet &chroms,
+                                               std::string_view query,
+                                               const QueryTokens &tokens) {
+  std::uint32_t start_pos{};
+  std::uint32_t end_pos{};
+  std::ignore =
+      internal::parse_genomic_position(tokens.start_pos, start_pos, tokens.allow_thousands_sep);
+  std::ignore =
+      internal::parse_genomic_position(tokens.end_pos, end_pos, tokens.allow_thousands_sep);
+
+  switch (status) {
+    case ParseStatus::OK:
+      break;
+    case ParseStatus::EMPTY_QUERY:
+      throw std::runtime_error("query is empty");
+    case ParseStatus::MALFORMED_QUERY:
+      throw std::runtime_error(fmt::format(FMT_STRING("query \"{}\" is malformed"), query));
+    case ParseStatus::INVALID_CHROMOSOME:
+      throw std::runtime_error(fmt::format(FMT_STRING("invalid chromosome \"{}\" in query \"{}\""),
+                                           tokens.chrom_name, query));
+    case ParseStatus::MISSING_START_POSITION:
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("query \"{}\" is malformed: missing start position"), query));
+    case ParseStatus::MISSING_END_POSITION:
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("query \"{}\" is malformed: missing end position"), query));
+    case ParseStatus::INVALID_START_POSITION:
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("invalid start position \"{}\" in query \"{}\": position should "
+                                 "be an integer between 0 and {}"),
+                      tokens.start_pos, query, (std::numeric_limits<std::uint32_t>::max)()));
+    case ParseStatus::INVALID_END_POSITION:
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("invalid end position \"{}\" in query \"{}\": position should "
+                                 "be an integer between 0 and {}"),
+                      tokens.end_pos, query, (std::numeric_limits<std::uint32_t>::max)()));
+    case ParseStatus::END_POSITION_OUT_OF_BOUNDS:
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("invalid end position \"{0}\" in query \"{1}\": end position is "
+                                 "greater than the chromosome size ({0} > {2})"),
+                      end_pos, query, chroms.at(tokens.chrom_name).size()));
+    case ParseStatus::EMPTY_INTERVAL:
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("invalid query \"{}\": query end position should be "
+                                 "greater than the start position ({} >= {})"),
+                      query, start_pos, end_pos));
+  }
+  unreachable_code();
 }
 
 }  // namespace coolerpp
@@ -0,0 +1,490 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/format.h>
+
+#include <highfive/H5DataSet.hpp>
+#include <highfive/H5File.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/attribute.hpp"
+#include "coolerpp/balancing.hpp"
+#include "coolerpp/coolerpp.hpp"
+#include "coolerpp/uri.hpp"
+
+namespace coolerpp {
+
+inline ICE::ICE(const File& clr, Type type) : ICE(clr, type, Params{}) {}
+
+inline ICE::ICE(const File& clr, Type type, const Params& params)
+    : _type(type),
+      _params(params),
+      _num_threads(params.num_threads == 0 ? (std::max)(1U, std::thread::hardware_concurrency())
+                                           : params.num_threads),
+      _biases(clr.bins().size(), 1.0) {
+  const auto& prefix_sum = clr.bins().num_bin_prefix_sum();
+  this->_bin_chrom_ids.reserve(clr.bins().size());
+  for (std::size_t i = 1; i < prefix_sum.size(); ++i) {
+    this->_bin_chrom_ids.insert(this->_bin_chrom_ids.end(), prefix_sum[i] - prefix_sum[i - 1],
+                                static_cast<std::uint32_t>(i - 1));
+  }
+
+  if (type == Type::cis) {
+    this->_region_offsets = prefix_sum;
+  } else {
+    this->_region_offsets = {0, conditional_static_cast<std::uint64_t>(clr.bins().size())};
+  }
+  this->_scale.resize(this->_region_offsets.size() - 1,
+                      std::numeric_limits<double>::quiet_NaN());
+  this->_variance.resize(this->_region_offsets.size() - 1, 0.0);
+
+  try {
+    this->filter_bins(clr);
+    if (params.in_memory) {
+      this->build_matrix(clr);
+    }
+    this->balance(clr);
+  } catch (const std::exception& e) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("failed to balance cooler \"{}\": {}"), clr.uri(), e.what()));
+  }
+}
+
+inline auto ICE::type() const noexcept -> Type { return this->_type; }
+
+inline auto ICE::params() const noexcept -> const Params& { return this->_params; }
+
+inline Weights ICE::get_weights() const {
+  return Weights{this->_biases, Weights::Type::MULTIPLICATIVE};
+}
+
+inline const std::vector<double>& ICE::biases() const noexcept { return this->_biases; }
+
+inline const std::vector<double>& ICE::scale() const noexcept { return this->_scale; }
+
+inline const std::vector<double>& ICE::variance() const noexcept { return this->_variance; }
+
+inline bool ICE::converged() const noexcept {
+  return std::all_of(this->_variance.begin(), this->_variance.end(),
+                     [&](const auto var) { return var < this->_params.tol; });
+}
+
+inline std::size_t ICE::num_iterations() const noexcept { return this->_num_iters; }
+
+inline void ICE::write_weights(File& clr, std::string_view name, bool overwrite_if_exists) const {
+  clr.write_weights(name, this->_biases.begin(), this->_biases.end(), overwrite_if_exists, false);
+  auto dset = clr.group("bins")().getDataSet(std::string{name});
+  this->write_attributes(dset, overwrite_if_exists);
+}
+
+inline void ICE::write_weights(std::string_view uri, std::string_view name,
+                               bool overwrite_if_exists) const {
+  File::write_weights(uri, name, this->_biases.begin(), this->_biases.end(), overwrite_if_exists,
+                      false);
+
+  const auto [file_path, root_path] = parse_cooler_uri(uri);
+  HighFive::File fp(file_path, HighFive::File::ReadWrite);
+  auto dset = fp.getGroup(root_path).getGroup("bins").getDataSet(std::string{name});
+  this->write_attributes(dset, overwrite_if_exists);
+}
+
+inline void ICE::write_attributes(HighFive::DataSet& dset, bool overwrite_if_exists) const {
+  const auto& p = this->_params;
+  const auto overwrite = overwrite_if_exists;
+  const auto max_var = *std::max_element(this->_variance.begin(), this->_variance.end());
+
+  Attribute::write(dset, "cis_only", std::uint8_t(this->_type == Type::cis), overwrite);
+  Attribute::write(dset, "trans_only", std::uint8_t(this->_type == Type::trans), overwrite);
+  Attribute::write(dset, "converged", std::uint8_t(this->converged()), overwrite);
+  Attribute::write(dset, "tol", p.tol, overwrite);
+  Attribute::write(dset, "ignore_diags", conditional_static_cast<std::int64_t>(p.ignore_diags),
+                   overwrite);
+  Attribute::write(dset, "min_nnz", conditional_static_cast<std::int64_t>(p.min_nnz), overwrite);
+  Attribute::write(dset, "min_count", conditional_static_cast<std::int64_t>(p.min_count),
+                   overwrite);
+  Attribute::write(dset, "mad_max", p.mad_max, overwrite);
+  Attribute::write(dset, "var", max_var, overwrite);
+
+  // Like cooler, write one scale factor per chromosome when balancing cis interactions
+  if (this->_type == Type::cis) {
+    Attribute::write(dset, "scale", this->_scale, overwrite);
+  } else {
+    Attribute::write(dset, "scale", this->_scale.front(), overwrite);
+  }
+}
+
+inline bool ICE::is_masked(std::uint64_t bin1_id, std::uint64_t bin2_id) const noexcept {
+  assert(bin1_id <= bin2_id);
+  if (bin2_id - bin1_id < this->_params.ignore_diags) {
+    return true;
+  }
+
+  const auto cis = this->_bin_chrom_ids[bin1_id] == this->_bin_chrom_ids[bin2_id];
+  switch (this->_type) {
+    case Type::cis:
+      return !cis;
+    case Type::trans:
+      return cis;
+    case Type::gw:
+      return false;
+  }
+  return false;
+}
+
+inline void ICE::filter_bins(const File& clr) {
+  const auto num_bins = this->_biases.size();
+  const auto& p = this->_params;
+
+  // MAD-max filtering is always computed on cis interactions
+  const auto compute_cis_margs = p.mad_max > 0 && this->_type != Type::trans;
+
+  std::vector<std::vector<double>> nnz(this->_num_threads, std::vector<double>(num_bins, 0));
+  std::vector<std::vector<double>> margs(this->_num_threads, std::vector<double>(num_bins, 0));
+  std::vector<std::vector<double>> cis_margs(
+      compute_cis_margs ? this->_num_threads : 0, std::vector<double>(num_bins, 0));
+
+  this->scan_pixel_table(clr, [&](std::size_t tid, std::uint64_t bin1_id, std::uint64_t bin2_id,
+                                  double count) {
+    if (!this->is_masked(bin1_id, bin2_id)) {
+      ++nnz[tid][bin1_id];
+      ++nnz[tid][bin2_id];
+      margs[tid][bin1_id] += count;
+      margs[tid][bin2_id] += count;
+    }
+    if (compute_cis_margs && bin2_id - bin1_id >= p.ignore_diags &&
+        this->_bin_chrom_ids[bin1_id] == this->_bin_chrom_ids[bin2_id]) {
+      cis_margs[tid][bin1_id] += count;
+      cis_margs[tid][bin2_id] += count;
+    }
+  });
+
+  for (std::size_t tid = 1; tid < this->_num_threads; ++tid) {
+    for (std::size_t i = 0; i < num_bins; ++i) {
+      nnz.front()[i] += nnz[tid][i];
+      margs.front()[i] += margs[tid][i];
+      if (compute_cis_margs) {
+        cis_margs.front()[i] += cis_margs[tid][i];
+      }
+    }
+  }
+
+  for (std::size_t i = 0; i < num_bins; ++i) {
+    if (nnz.front()[i] < conditional_static_cast<double>(p.min_nnz) ||
+        margs.front()[i] < conditional_static_cast<double>(p.min_count)) {
+      this->_biases[i] = 0;
+    }
+  }
+
+  if (!compute_cis_margs) {
+    return;
+  }
+
+  // Normalize marginals by the median marginal of each chromosome, then mask bins whose marginals
+  // fall more than mad_max median absolute deviations below the median (in log space)
+  auto& cis_marg = cis_margs.front();
+  const auto& prefix_sum = clr.bins().num_bin_prefix_sum();
+  for (std::size_t i = 1; i < prefix_sum.size(); ++i) {
+    const auto first = cis_marg.begin() + std::ptrdiff_t(prefix_sum[i - 1]);
+    const auto last = cis_marg.begin() + std::ptrdiff_t(prefix_sum[i]);
+
+    std::vector<double> nz_margs{};
+    std::copy_if(first, last, std::back_inserter(nz_margs), [](const auto n) { return n > 0; });
+    if (!nz_margs.empty()) {
+      const auto med = ICE::median(std::move(nz_margs));
+      std::transform(first, last, first, [&](const auto n) { return n / med; });
+    }
+  }
+
+  std::vector<double> log_margs{};
+  for (const auto n : cis_marg) {
+    if (n > 0) {
+      log_margs.push_back(std::log(n));
+    }
+  }
+  if (log_margs.empty()) {
+    return;
+  }
+
+  const auto med = ICE::median(log_margs);
+  std::transform(log_margs.begin(), log_margs.end(), log_margs.begin(),
+                 [&](const auto n) { return std::abs(n - med); });
+  const auto mad = ICE::median(std::move(log_margs));
+  const auto cutoff = std::exp(med - (p.mad_max * mad));
+
+  for (std::size_t i = 0; i < num_bins; ++i) {
+    if (cis_marg[i] < cutoff) {
+      this->_biases[i] = 0;
+    }
+  }
+}
+
+inline void ICE::build_matrix(const File& clr) {
+  const auto num_bins = this->_biases.size();
+  if (num_bins > (std::numeric_limits<std::uint32_t>::max)()) {
+    // Too many bins to use a compact layout: fall back to streaming pixels from the file
+    return;
+  }
+
+  auto& m = this->_matrix;
+  m.row_offsets.assign(num_bins + 1, 0);
+
+  const auto& bin1_dset = clr.dataset("pixels/bin1_id");
+  const auto& bin2_dset = clr.dataset("pixels/bin2_id");
+  const auto& count_dset = clr.dataset("pixels/count");
+  const auto chunk_size = (std::max)(std::size_t(1), this->_params.chunk_size);
+
+  std::vector<std::uint64_t> bin1_buff{};
+  std::vector<std::uint64_t> bin2_buff{};
+  std::vector<double> count_buff{};
+
+  // Pixels are sorted by bin1_id: rows are filled in order
+  const auto nnz = bin1_dset.size();
+  for (std::size_t offset = 0; offset < nnz; offset += chunk_size) {
+    const auto num = (std::min)(chunk_size, nnz - offset);
+    bin1_dset.read(bin1_buff, num, offset);
+    bin2_dset.read(bin2_buff, num, offset);
+    count_dset.read(count_buff, num, offset);
+
+    for (std::size_t i = 0; i < num; ++i) {
+      const auto bin1_id = bin1_buff[i];
+      const auto bin2_id = bin2_buff[i];
+      if (this->is_masked(bin1_id, bin2_id) || this->_biases[bin1_id] == 0 ||
+          this->_biases[bin2_id] == 0) {
+        continue;
+      }
+      ++m.row_offsets[bin1_id + 1];
+      m.bin2_ids.push_back(static_cast<std::uint32_t>(bin2_id));
+      m.counts.push_back(count_buff[i]);
+    }
+  }
+
+  for (std::size_t i = 1; i < m.row_offsets.size(); ++i) {
+    m.row_offsets[i] += m.row_offsets[i - 1];
+  }
+  m.bin2_ids.shrink_to_fit();
+  m.counts.shrink_to_fit();
+}
+
+inline void ICE::balance(const File& clr) {
+  const auto num_bins = this->_biases.size();
+  const auto num_regions = this->_region_offsets.size() - 1;
+  const auto& p = this->_params;
+
+  std::vector<std::vector<double>> margs(this->_num_threads, std::vector<double>(num_bins, 0));
+  std::vector<bool> done(num_regions, false);
+
+  for (this->_num_iters = 0; this->_num_iters < p.max_iters; ++this->_num_iters) {
+    if (std::all_of(done.begin(), done.end(), [](const auto d) { return d; })) {
+      break;
+    }
+
+    this->compute_marginals(clr, margs);
+    const auto& marg = margs.front();
+
+    for (std::size_t r = 0; r < num_regions; ++r) {
+      if (done[r]) {
+        continue;
+      }
+      const auto first = this->_region_offsets[r];
+      const auto last = this->_region_offsets[r + 1];
+
+      double sum = 0;
+      std::size_t nnz = 0;
+      for (auto i = first; i < last; ++i) {
+        if (marg[i] != 0) {
+          sum += marg[i];
+          ++nnz;
+        }
+      }
+
+      if (nnz == 0) {
+        std::fill(this->_biases.begin() + std::ptrdiff_t(first),
+                  this->_biases.begin() + std::ptrdiff_t(last),
+                  std::numeric_limits<double>::quiet_NaN());
+        this->_scale[r] = std::numeric_limits<double>::quiet_NaN();
+        this->_variance[r] = 0;
+        done[r] = true;
+        continue;
+      }
+
+      const auto mean = sum / conditional_static_cast<double>(nnz);
+      double var = 0;
+      for (auto i = first; i < last; ++i) {
+        if (marg[i] != 0) {
+          var += (marg[i] - mean) * (marg[i] - mean);
+        }
+        const auto n = marg[i] == 0 ? 1.0 : marg[i] / mean;
+        this->_biases[i] /= n;
+      }
+
+      this->_scale[r] = mean;
+      this->_variance[r] = var / conditional_static_cast<double>(nnz);
+      done[r] = this->_variance[r] < p.tol;
+    }
+  }
+
+  for (std::size_t r = 0; r < num_regions; ++r) {
+    const auto scale = p.rescale_marginals ? std::sqrt(this->_scale[r]) : 1.0;
+    for (auto i = this->_region_offsets[r]; i < this->_region_offsets[r + 1]; ++i) {
+      auto& b = this->_biases[i];
+      b = b == 0 ? std::numeric_limits<double>::quiet_NaN() : b / scale;
+    }
+  }
+
+  // The pixel cache is no longer needed
+  this->_matrix = CSRMatrix{};
+}
+
+inline void ICE::compute_marginals(const File& clr,
+                                   std::vector<std::vector<double>>& margs) const {
+  for (auto& marg : margs) {
+    std::fill(marg.begin(), marg.end(), 0);
+  }
+
+  this->for_each_pixel(clr, [&](std::size_t tid, std::uint64_t bin1_id, std::uint64_t bin2_id,
+                                double count) {
+    const auto n = count * this->_biases[bin1_id] * this->_biases[bin2_id];
+    margs[tid][bin1_id] += n;
+    margs[tid][bin2_id] += n;
+  });
+
+  auto& marg = margs.front();
+  for (std::size_t tid = 1; tid < margs.size(); ++tid) {
+    for (std::size_t i = 0; i < marg.size(); ++i) {
+      marg[i] += margs[tid][i];
+    }
+  }
+}
+
+template <typename PixelOp>
+inline void ICE::scan_pixel_table(const File& clr, PixelOp op) const {
+  const auto& bin1_dset = clr.dataset("pixels/bin1_id");
+  const auto& bin2_dset = clr.dataset("pixels/bin2_id");
+  const auto& count_dset = clr.dataset("pixels/count");
+  const auto chunk_size = (std::max)(std::size_t(1), this->_params.chunk_size);
+  const auto nnz = bin1_dset.size();
+
+  // Pixels do not need to be processed in order: split the pixel table into ranges of the same
+  // size. As HDF5 is not guaranteed to be thread-safe, reads are serialized using io_mtx
+  std::mutex io_mtx;
+  this->run_in_parallel(this->_num_threads, [&](std::size_t tid) {
+    std::vector<std::uint64_t> bin1_buff{};
+    std::vector<std::uint64_t> bin2_buff{};
+    std::vector<double> count_buff{};
+
+    const auto first = (nnz * tid) / this->_num_threads;
+    const auto last = (nnz * (tid + 1)) / this->_num_threads;
+    for (auto offset = first; offset < last; offset += chunk_size) {
+      const auto num = (std::min)(chunk_size, last - offset);
+      {
+        [[maybe_unused]] const std::scoped_lock lck(io_mtx);
+        bin1_dset.read(bin1_buff, num, offset);
+        bin2_dset.read(bin2_buff, num, offset);
+        count_dset.read(count_buff, num, offset);
+      }
+      for (std::size_t i = 0; i < num; ++i) {
+        op(tid, bin1_buff[i], bin2_buff[i], count_buff[i]);
+      }
+    }
+  });
+}
+
+template <typename PixelOp>
+inline void ICE::for_each_pixel(const File& clr, PixelOp op) const {
+  const auto& m = this->_matrix;
+  if (m.row_offsets.empty()) {
+    this->scan_pixel_table(clr, [&](std::size_t tid, std::uint64_t bin1_id,
+                                    std::uint64_t bin2_id, double count) {
+      if (!this->is_masked(bin1_id, bin2_id) && this->_biases[bin1_id] != 0 &&
+          this->_biases[bin2_id] != 0) {
+        op(tid, bin1_id, bin2_id, count);
+      }
+    });
+    return;
+  }
+
+  // Assign each thread a range of rows with roughly the same number of pixels
+  const auto nnz = m.row_offsets.back();
+  const auto num_rows = conditional_static_cast<std::uint64_t>(m.row_offsets.size() - 1);
+  std::vector<std::uint64_t> row_ranges{0};
+  for (std::size_t tid = 1; tid < this->_num_threads; ++tid) {
+    const auto it = std::lower_bound(m.row_offsets.begin(), m.row_offsets.end(),
+                                     (nnz * tid) / this->_num_threads);
+    const auto row =
+        conditional_static_cast<std::uint64_t>(std::distance(m.row_offsets.begin(), it));
+    row_ranges.push_back((std::max)(row_ranges.back(), (std::min)(row, num_rows)));
+  }
+  row_ranges.push_back(num_rows);
+
+  this->run_in_parallel(this->_num_threads, [&](std::size_t tid) {
+    for (auto bin1_id = row_ranges[tid]; bin1_id < row_ranges[tid + 1]; ++bin1_id) {
+      for (auto i = m.row_offsets[bin1_id]; i < m.row_offsets[bin1_id + 1]; ++i) {
+        op(tid, bin1_id, std::uint64_t(m.bin2_ids[i]), m.counts[i]);
+      }
+    }
+  });
+}
+
+template <typename WorkerOp>
+inline void ICE::run_in_parallel(std::size_t num_threads, WorkerOp op) const {
+  assert(num_threads != 0);
+  std::exception_ptr except{};
+  std::mutex except_mtx;
+
+  auto worker = [&](std::size_t tid) {
+    try {
+      op(tid);
+    } catch (...) {
+      [[maybe_unused]] const std::scoped_lock lck(except_mtx);
+      if (!except) {
+        except = std::current_exception();
+      }
+    }
+  };
+
+  std::vector<std::thread> threads{};
+  threads.reserve(num_threads - 1);
+  for (std::size_t tid = 1; tid < num_threads; ++tid) {
+    threads.emplace_back(worker, tid);
+  }
+  worker(0);
+
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  if (except) {
+    std::rethrow_exception(except);
+  }
+}
+
+// Same as numpy.median(): the median of collections with an even number of elements is the mean
+// of the two middle elements
+inline double ICE::median(std::vector<double> v) {
+  assert(!v.empty());
+  const auto mid = v.begin() + std::ptrdiff_t(v.size() / 2);
+  std::nth_element(v.begin(), mid, v.end());
+  if (v.size() % 2 == 1) {
+    return *mid;
+  }
+  return (*std::max_element(v.begin(), mid) + *mid) / 2;
+}
+
+}  // namespace coolerpp
@@ -0,0 +1,140 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "coolerpp/balancing.hpp"
+#include "coolerpp/bin_table.hpp"
+#include "coolerpp/pixel_selector.hpp"
+
+// Definitions from the Arrow C data and C stream interfaces.
+// These are ABI-stable and are meant to be copied verbatim by producers and consumers:
+// https://arrow.apache.org/docs/format/CDataInterface.html
+// https://arrow.apache.org/docs/format/CStreamInterface.html
+// NOLINTBEGIN
+extern "C" {
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  const char* format;
+  const char* name;
+  const char* metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema** children;
+  struct ArrowSchema* dictionary;
+  void (*release)(struct ArrowSchema*);
+  void* private_data;
+};
+
+struct ArrowArray {
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void** buffers;
+  struct ArrowArray** children;
+  struct ArrowArray* dictionary;
+  void (*release)(struct ArrowArray*);
+  void* private_data;
+};
+
+#endif  // ARROW_C_DATA_INTERFACE
+
+#ifndef ARROW_C_STREAM_INTERFACE
+#define ARROW_C_STREAM_INTERFACE
+
+struct ArrowArrayStream {
+  int (*get_schema)(struct ArrowArrayStream*, struct ArrowSchema* out);
+  int (*get_next)(struct ArrowArrayStream*, struct ArrowArray* out);
+  const char* (*get_last_error)(struct ArrowArrayStream*);
+  void (*release)(struct ArrowArrayStream*);
+  void* private_data;
+};
+
+#endif  // ARROW_C_STREAM_INTERFACE
+}
+// NOLINTEND
+
+namespace coolerpp::io {
+
+/// Export pixels and bins to Arrow through the C data interface, so that they can be imported
+/// without copies by pyarrow, DuckDB, Polars and any other Arrow implementation.
+/// Pixels are exported as struct arrays (i.e. record batches) with the following columns:
+/// - bin1_id, bin2_id (uint64) and count (same type as N)
+/// - chrom1, start1, end1, chrom2, start2, end2 when ArrowExportOptions::join is true.
+///   Chromosome names are dictionary-encoded (int32 indices into the list of chromosome names)
+/// - balanced (float64) when ArrowExportOptions::weights is not null
+/// The bin1_id, bin2_id and count columns point directly into the buffers of PixelBlock: no data
+/// is copied, and buffers are kept alive until the exported array is released.
+/// As mandated by the C data interface, structs are owned by the caller, which becomes responsible
+/// for calling their release callback (directly or by handing them over to an Arrow library)
+struct ArrowExportOptions {
+  bool join{false};
+  std::shared_ptr<const Weights> weights{};
+};
+
+template <typename N>
+void export_pixels(PixelBlock<N> blk, const BinTable& bins, ArrowArray* out_array,
+                   ArrowSchema* out_schema, const ArrowExportOptions& opts = {});
+template <typename N>
+void export_pixel_schema(const ArrowExportOptions& opts, ArrowSchema* out_schema);
+
+/// Export the pixels selected by sel as a stream of record batches of up to CHUNK_SIZE pixels.
+/// Pixels are read lazily, as batches are requested by the consumer
+template <typename N, std::size_t CHUNK_SIZE>
+void export_pixel_stream(PixelSelector<N, CHUNK_SIZE> sel, std::shared_ptr<const BinTable> bins,
+                         ArrowArrayStream* out_stream, ArrowExportOptions opts = {});
+
+/// Export the bin table as a record batch with columns chrom (dictionary-encoded), start and end
+void export_bins(const BinTable& bins, ArrowArray* out_array, ArrowSchema* out_schema);
+
+}  // namespace coolerpp::io
+
+namespace coolerpp::internal {
+
+struct ArrowSchemaData {
+  std::string format{};
+  std::string name{};
+  std::vector<ArrowSchema> children{};
+  std::vector<ArrowSchema*> child_ptrs{};
+  std::unique_ptr<ArrowSchema> dictionary{};
+};
+
+struct ArrowArrayData {
+  std::vector<const void*> buffers{};
+  std::vector<ArrowArray> children{};
+  std::vector<ArrowArray*> child_ptrs{};
+  std::unique_ptr<ArrowArray> dictionary{};
+  // Keeps the memory referenced by buffers alive
+  std::shared_ptr<const void> owner{};
+};
+
+template <typename N>
+[[nodiscard]] constexpr const char* arrow_format() noexcept;
+
+void release_arrow_schema(ArrowSchema* schema) noexcept;
+void release_arrow_array(ArrowArray* array) noexcept;
+
+ArrowSchemaData& init_arrow_schema(ArrowSchema* schema, std::string format, std::string name,
+                                   std::size_t num_children = 0);
+ArrowArrayData& init_arrow_array(ArrowArray* array, std::int64_t length,
+                                 std::vector<const void*> buffers,
+                                 std::shared_ptr<const void> owner, std::size_t num_children = 0);
+
+}  // namespace coolerpp::internal
+
+#include "../../arrow_impl.hpp"
@@ -6,11 +6,13 @@
 
 #include <tsl/hopscotch_map.h>
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
 #include "coolerpp/bin_table.hpp"
 #include "coolerpp/dataset.hpp"
+#include "coolerpp/internal/span.hpp"
 #include "coolerpp/pixel_selector.hpp"
 
 namespace coolerpp {
@@ -18,34 +20,62 @@ namespace coolerpp {
 class Weights {
  public:
   enum class Type { INFER, DIVISIVE, MULTIPLICATIVE, UNKNOWN };
+  // Weights loaded with FLOAT32 precision are stored as balancing factors (see factors()),
+  // halving the memory footprint of weights at the cost of single precision
+  enum class Precision { FLOAT64, FLOAT32 };
 
  private:
   std::vector<double> _weights{};
+  std::vector<float> _factors{};
   Type _type{};
 
  public:
   Weights() = default;
   explicit Weights(const BinTable &bins, const Dataset &dset, bool rescale = false);
-  Weights(const BinTable &bins, const Dataset &dset, Type type, bool rescale = false);
+  Weights(const BinTable &bins, const Dataset &dset, Type type, bool rescale = false,
+          Precision precision = Precision::FLOAT64);
   Weights(std::vector<double> weights, Type type) noexcept;
+  Weights(std::vector<double> weights, Type type, Precision precision);
   Weights(std::vector<double> weights, std::string_view name);
 
   [[nodiscard]] explicit operator bool() const noexcept;
+  // Raw weights are reconstructed from the balancing factors when precision() is FLOAT32
   [[nodiscard]] double operator[](std::size_t i) const noexcept;
 
   [[nodiscard]] double at(std::size_t i) const;
 
-  [[nodiscard]] const std::vector<double> &operator()() const noexcept;
+  // Balance n pixels stored in columnar form, writing the results to balanced_counts.
+  // Pixels overlapping bins with NaN weights are balanced to NaN
+  template <typename N>
+  void balance(const std::uint64_t *bin1_ids, const std::uint64_t *bin2_ids, const N *counts,
+               std::size_t n, double *balanced_counts) const noexcept;
+
+  // Raw weights. Throws std::logic_error when precision() is FLOAT32, as raw weights are not kept
+  // (use factors() instead)
+  [[nodiscard]] const std::vector<double> &operator()() const;
+  // Balancing factors fold the weight type into a single multiplier per bin, so that
+  // balanced_count = count * factors[bin1_id] * factors[bin2_id] regardless of type().
+  // Factors are stored contiguously, making them suitable for gather-based kernels.
+  // Empty unless precision() is FLOAT32
+  [[nodiscard]] const std::vector<float> &factors() const noexcept;
   [[nodiscard]] constexpr auto type() const noexcept -> Type;
+  [[nodiscard]] auto precision() const noexcept -> Precision;
+  [[nodiscard]] std::size_t size() const noexcept;
+  [[nodiscard]] std::size_t memory_usage() const noexcept;
 
   [[nodiscard]] static auto infer_type(std::string_view name) -> Type;
   [[nodiscard]] static auto infer_type(const Dataset &dset) -> Type;
+
+ private:
+  void rescale(const BinTable &bins, const Dataset &dset);
+  [[nodiscard]] static std::vector<float> combine(const std::vector<double> &weights, Type type);
 };
 
 template <typename N, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
 class Balancer {
  public:
   class iterator;
+  class Block;
 
  private:
   typename PixelSelector<N, CHUNK_SIZE>::iterator _first;
@@ -67,6 +97,32 @@ class Balancer {
   [[nodiscard]] auto cbegin() const -> iterator;
   [[nodiscard]] auto cend() const -> iterator;
 
+  // Visit balanced pixels in blocks of up to max_block_size pixels
+  template <typename BlockOp>
+  void for_each_block(BlockOp op, std::size_t max_block_size = CHUNK_SIZE) const;
+  [[nodiscard]] auto read_batch(std::size_t max_block_size = CHUNK_SIZE) const
+      -> std::vector<Block>;
+
+  // A block of balanced pixels in columnar form.
+  // Bin ids are views into the chunks referenced by the underlying PixelBlock, while balanced
+  // counts are owned by the block
+  class Block {
+    PixelBlock<N> _pixels{};
+    std::vector<double> _counts{};
+
+   public:
+    Block() = default;
+    Block(PixelBlock<N> pixels, const Weights &weights);
+
+    [[nodiscard]] std::size_t size() const noexcept;
+    [[nodiscard]] bool empty() const noexcept;
+
+    [[nodiscard]] auto bin1_ids() const noexcept -> internal::Span<std::uint64_t>;
+    [[nodiscard]] auto bin2_ids() const noexcept -> internal::Span<std::uint64_t>;
+    [[nodiscard]] auto counts() const noexcept -> internal::Span<double>;
+    [[nodiscard]] const PixelBlock<N> &raw_pixels() const noexcept;
+  };
+
   class iterator {
     typename PixelSelector<N, CHUNK_SIZE>::iterator _it{};
     std::shared_ptr<const Weights> _weights{};
@@ -102,6 +158,119 @@ class Balancer {
   };
 };
 
+// Compute observed/expected ratios: value = balanced_count / expected[bin2_id - bin1_id], where
+// expected[d] is the expected number of interactions for pixels on the d-th diagonal (e.g.
+// ExpectedCis::average()). Counts are used as is when weights is null.
+// Values are NaN for pixels on diagonals without a finite, non-zero expected value.
+// When log_transform is true, ratios are further transformed with log2
+class ObservedOverExpectedOp {
+  std::shared_ptr<const Weights> _weights{};
+  std::shared_ptr<const std::vector<double>> _expected{
+      std::make_shared<const std::vector<double>>()};
+  bool _log_transform{false};
+
+ public:
+  ObservedOverExpectedOp() = default;
+  ObservedOverExpectedOp(std::shared_ptr<const Weights> weights, std::vector<double> expected,
+                         bool log_transform = false);
+
+  [[nodiscard]] const Weights *weights() const noexcept;
+  [[nodiscard]] const std::vector<double> &expected() const noexcept;
+  [[nodiscard]] bool log_transform() const noexcept;
+
+  template <typename N>
+  [[nodiscard]] double operator()(std::uint64_t bin1_id, std::uint64_t bin2_id,
+                                  N count) const noexcept;
+  // Transform n pixels stored in columnar form, writing the results to out
+  template <typename N>
+  void operator()(const std::uint64_t *bin1_ids, const std::uint64_t *bin2_ids, const N *counts,
+                  std::size_t n, double *out) const noexcept;
+};
+
+// Lazily compute observed/expected ratios for the pixels returned by a PixelSelector (see
+// ObservedOverExpectedOp). Ratios are computed on the fly, one block of pixels at a time, and
+// only make sense for cis queries: expected values are looked up by diagonal
+template <typename N, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
+class ObservedOverExpected {
+ public:
+  class iterator;
+  class Block;
+
+ private:
+  typename PixelSelector<N, CHUNK_SIZE>::iterator _first;
+  typename PixelSelector<N, CHUNK_SIZE>::iterator _last;
+  std::shared_ptr<const ObservedOverExpectedOp> _op;
+
+ public:
+  ObservedOverExpected() = delete;
+  ObservedOverExpected(const PixelSelector<N, CHUNK_SIZE> &selector,
+                       std::shared_ptr<const Weights> weights, std::vector<double> expected,
+                       bool log_transform = false);
+  ObservedOverExpected(typename PixelSelector<N, CHUNK_SIZE>::iterator first,
+                       typename PixelSelector<N, CHUNK_SIZE>::iterator last,
+                       ObservedOverExpectedOp op);
+
+  [[nodiscard]] const ObservedOverExpectedOp &op() const noexcept;
+
+  [[nodiscard]] auto begin() const -> iterator;
+  [[nodiscard]] auto end() const -> iterator;
+
+  [[nodiscard]] auto cbegin() const -> iterator;
+  [[nodiscard]] auto cend() const -> iterator;
+
+  // Visit transformed pixels in blocks of up to max_block_size pixels
+  template <typename BlockOp>
+  void for_each_block(BlockOp op, std::size_t max_block_size = CHUNK_SIZE) const;
+  [[nodiscard]] auto read_batch(std::size_t max_block_size = CHUNK_SIZE) const
+      -> std::vector<Block>;
+
+  // Same as Balancer::Block
+  class Block {
+    PixelBlock<N> _pixels{};
+    std::vector<double> _counts{};
+
+   public:
+    Block() = default;
+    Block(PixelBlock<N> pixels, const ObservedOverExpectedOp &op);
+
+    [[nodiscard]] std::size_t size() const noexcept;
+    [[nodiscard]] bool empty() const noexcept;
+
+    [[nodiscard]] auto bin1_ids() const noexcept -> internal::Span<std::uint64_t>;
+    [[nodiscard]] auto bin2_ids() const noexcept -> internal::Span<std::uint64_t>;
+    [[nodiscard]] auto counts() const noexcept -> internal::Span<double>;
+    [[nodiscard]] const PixelBlock<N> &raw_pixels() const noexcept;
+  };
+
+  class iterator {
+    typename PixelSelector<N, CHUNK_SIZE>::iterator _it{};
+    std::shared_ptr<const ObservedOverExpectedOp> _op{};
+    mutable Pixel<double> _value{};
+
+   public:
+    using difference_type = std::ptrdiff_t;
+    using value_type = Pixel<double>;
+    using pointer = value_type *;
+    using const_pointer = const value_type *;
+    using reference = value_type &;
+    using const_reference = const value_type &;
+    using iterator_category = std::forward_iterator_tag;
+
+    iterator() = default;
+    iterator(typename PixelSelector<N, CHUNK_SIZE>::iterator it,
+             std::shared_ptr<const ObservedOverExpectedOp> op);
+
+    [[nodiscard]] constexpr bool operator==(const iterator &other) const noexcept;
+    [[nodiscard]] constexpr bool operator!=(const iterator &other) const noexcept;
+
+    [[nodiscard]] auto operator*() const -> const_reference;
+    [[nodiscard]] auto operator->() const -> const_pointer;
+
+    auto operator++() -> iterator &;
+    auto operator++(int) -> iterator;
+  };
+};
+
 using WeightMap = tsl::hopscotch_map<std::string, std::shared_ptr<const Weights>>;
 
 }  // namespace coolerpp
@@ -60,9 +60,31 @@ struct BinTableConcrete {
 };
 
 class BinTable {
+ public:
+  enum class Type : std::uint_fast8_t { FIXED, VARIABLE };
+
+ private:
   ChromosomeSet _chroms{};
   std::vector<std::uint64_t> _num_bins_prefix_sum{};
+  // Map buckets of 2^_chrom_lut_shift bins to the id of the chromosome containing the first bin in
+  // the bucket. Used to map bin ids to chromosomes in constant time
+  std::vector<std::uint32_t> _chrom_lut{};
+  std::uint32_t _chrom_lut_shift{};
   std::uint32_t _bin_size{std::numeric_limits<std::uint32_t>::max()};
+  Type _type{Type::FIXED};
+
+  // Start and end positions of each bin. Only used by tables with bins of variable size
+  std::vector<std::uint32_t> _bin_starts{};
+  std::vector<std::uint32_t> _bin_ends{};
+  // Two-level index used to map genomic coordinates to bins of variable size.
+  // The end position of the last bin of each block of bin_index_block_size bins is sampled, so that
+  // lookups can run a binary search over a small array that usually fits in cache, followed by a
+  // binary search over a single block of bins.
+  // Samples for the i-th chromosome are stored in the range given by
+  // _bin_end_samples_prefix_sum[i] and _bin_end_samples_prefix_sum[i + 1]
+  std::vector<std::uint32_t> _bin_end_samples{};
+  std::vector<std::size_t> _bin_end_samples_prefix_sum{};
+  static constexpr std::size_t bin_index_block_size{64};
 
  public:
   class iterator;
@@ -75,14 +97,22 @@ class BinTable {
   template <typename ChromNameIt, typename ChromSizeIt>
   BinTable(ChromNameIt first_chrom_name, ChromNameIt last_chrom_name, ChromSizeIt first_chrom_size,
            std::uint32_t bin_size);
+  // Construct a table with bins of variable size. Bins should be sorted by chromosome and position,
+  // and should cover each chromosome without gaps or overlaps
+  BinTable(ChromosomeSet chroms, std::vector<std::uint32_t> start_pos,
+           std::vector<std::uint32_t> end_pos);
 
   [[nodiscard]] std::size_t size() const noexcept;
   [[nodiscard]] bool empty() const noexcept;
   [[nodiscard]] std::size_t num_chromosomes() const;
+  // Return 0 for tables with bins of variable size
   [[nodiscard]] constexpr std::uint32_t bin_size() const noexcept;
+  [[nodiscard]] constexpr Type type() const noexcept;
   [[nodiscard]] constexpr const ChromosomeSet &chromosomes() const noexcept;
 
   [[nodiscard]] constexpr const std::vector<std::uint64_t> &num_bin_prefix_sum() const noexcept;
+  // Bytes held by the lookup tables and bin coordinates. Chromosomes are not accounted for
+  [[nodiscard]] std::size_t memory_usage() const noexcept;
 
   [[nodiscard]] constexpr auto begin() const -> iterator;
   [[nodiscard]] constexpr auto end() const -> iterator;
@@ -119,8 +149,16 @@ class BinTable {
   [[nodiscard]] std::uint64_t map_to_bin_id(const Chromosome &chrom, std::uint32_t pos) const;
   [[nodiscard]] std::uint64_t map_to_bin_id(std::string_view chrom_name, std::uint32_t pos) const;
   [[nodiscard]] std::uint64_t map_to_bin_id(std::uint32_t chrom_id, std::uint32_t pos) const;
+  // Map bin_id to the id of the chromosome it belongs to in constant time using the chromosome
+  // lookup table. bin_id should be smaller than size()
+  [[nodiscard]] std::uint32_t map_to_chrom_idx(std::uint64_t bin_id) const noexcept;
 
   [[nodiscard]] BinTableConcrete concretize() const;
+  // Write the chromosome id, start and end position of bins [first_bin_id, first_bin_id + n) to
+  // the given buffers, which should have room for at least n values. Values are computed one
+  // chromosome at a time, without constructing Bin objects
+  void fill_columns(std::uint64_t first_bin_id, std::size_t n, std::uint32_t *chrom_ids,
+                    std::uint32_t *starts, std::uint32_t *ends) const;
 
   [[nodiscard]] bool operator==(const BinTable &other) const;
   [[nodiscard]] bool operator!=(const BinTable &other) const;
@@ -128,6 +166,19 @@ class BinTable {
  private:
   [[nodiscard]] static std::vector<std::uint64_t> compute_num_bins_prefix_sum(
       const ChromosomeSet &chroms, std::uint32_t bin_size);
+  [[nodiscard]] static std::vector<std::uint64_t> compute_num_bins_prefix_sum(
+      const ChromosomeSet &chroms, const std::vector<std::uint32_t> &start_pos,
+      const std::vector<std::uint32_t> &end_pos);
+  [[nodiscard]] static std::uint32_t compute_chrom_lut_shift(
+      const std::vector<std::uint64_t> &prefix_sum);
+  [[nodiscard]] static std::vector<std::uint32_t> compute_chrom_lut(
+      const std::vector<std::uint64_t> &prefix_sum, std::uint32_t shift);
+  [[nodiscard]] static std::vector<std::size_t> compute_bin_end_samples_prefix_sum(
+      const std::vector<std::uint64_t> &prefix_sum);
+  [[nodiscard]] static std::vector<std::uint32_t> compute_bin_end_samples(
+      const std::vector<std::uint64_t> &prefix_sum, const std::vector<std::uint32_t> &end_pos);
+  [[nodiscard]] std::uint64_t map_to_bin_id_variable(std::uint32_t chrom_id,
+                                                     std::uint32_t pos) const noexcept;
 
  public:
   class iterator {
@@ -10,22 +10,32 @@
 #include <cstdint>
 #include <initializer_list>
 #include <limits>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <vector>
 
 namespace coolerpp {
 
+class ChromosomeSet;
+
 class Chromosome {
   static constexpr std::uint32_t null_id{(std::numeric_limits<std::uint32_t>::max)()};
+  friend ChromosomeSet;
 
-  std::string _name{};
+  // Names of chromosomes belonging to the same ChromosomeSet point to a buffer shared by all of
+  // them. Copies keep the buffer alive, so Chromosomes can outlive the ChromosomeSet
+  std::shared_ptr<const std::string> _name_buff{};
+  std::string_view _name{};
   std::uint32_t _id{null_id};
   std::uint32_t _size{};
 
+  Chromosome(std::uint32_t id_, std::shared_ptr<const std::string> name_buff,
+             std::string_view name_, std::uint32_t size_) noexcept;
+
  public:
   Chromosome() = default;
-  Chromosome(std::uint32_t id_, std::string name_, std::uint32_t size_) noexcept;
+  Chromosome(std::uint32_t id_, std::string name_, std::uint32_t size_);
 
   [[nodiscard]] constexpr explicit operator bool() const noexcept;
 
@@ -61,15 +71,23 @@ class Chromosome {
   friend constexpr bool operator!=(std::uint32_t a_id, const Chromosome& b) noexcept;
 };
 
+// Chromosome names are stored in a single buffer, and the map used to look up chromosomes by name
+// is built from views over the same buffer.
+// ChromosomeSets are immutable: copies share the same chromosomes, so copying a ChromosomeSet
+// (e.g. when constructing a BinTable) is cheap regardless of the number of chromosomes
 class ChromosomeSet {
   using ChromBuff = std::vector<Chromosome>;
   using ChromMap = tsl::hopscotch_map<std::string_view, std::size_t>;
 
-  ChromBuff _buff{};
-  ChromMap _map{};
+  struct Data {
+    ChromBuff buff{};
+    ChromMap map{};
+
+    std::size_t longest_chrom{Chromosome{}.id()};
+    std::size_t chrom_with_longest_name{Chromosome{}.id()};
+  };
 
-  std::size_t _longest_chrom{Chromosome{}.id()};
-  std::size_t _chrom_with_longest_name{Chromosome{}.id()};
+  std::shared_ptr<const Data> _data{};
 
  public:
   using value_type = typename ChromBuff::value_type;
@@ -135,11 +153,23 @@ class ChromosomeSet {
  private:
   void validate_chrom_id(std::uint32_t chrom_id) const;
 
+  [[nodiscard]] auto buff() const noexcept -> const ChromBuff&;
+
   template <typename ChromosomeNameIt, typename ChromosomeSizeIt>
   [[nodiscard]] static auto construct_chrom_buffer(ChromosomeNameIt first_chrom_name,
                                                    ChromosomeNameIt last_chrom_name,
                                                    ChromosomeSizeIt first_chrom_size) -> ChromBuff;
-
+  template <typename ChromosomeIt>
+  [[nodiscard]] static auto construct_chrom_buffer(ChromosomeIt first_chrom,
+                                                   ChromosomeIt last_chrom) -> ChromBuff;
+  // names should contain the concatenation of all chromosome names
+  [[nodiscard]] static auto construct_chrom_buffer(std::string names,
+                                                   const std::vector<std::size_t>& name_offsets,
+                                                   const std::vector<std::uint32_t>& ids,
+                                                   const std::vector<std::uint32_t>& sizes)
+      -> ChromBuff;
+
+  [[nodiscard]] static auto construct_data(ChromBuff chroms) -> std::shared_ptr<const Data>;
   [[nodiscard]] static auto construct_chrom_map(const ChromBuff& chroms) -> ChromMap;
 
   [[nodiscard]] static std::size_t find_longest_chromosome(const ChromBuff& chroms) noexcept;
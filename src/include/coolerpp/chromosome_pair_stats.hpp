@@ -0,0 +1,111 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <tsl/hopscotch_map.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "coolerpp/chromosome.hpp"
+
+namespace coolerpp {
+
+struct ContactStats {
+  // Sum of the interactions. Integer counts are accumulated exactly up to 2^53
+  double sum{};
+  // Number of non-zero pixels
+  std::uint64_t nnz{};
+
+  ContactStats &operator+=(const ContactStats &other) noexcept;
+  [[nodiscard]] bool operator==(const ContactStats &other) const noexcept;
+  [[nodiscard]] bool operator!=(const ContactStats &other) const noexcept;
+};
+
+// Sum of interactions and number of non-zero pixels for each pair of chromosomes.
+// Stats are collected by File while pixels are appended when
+// WriterOptions::compute_chromosome_pair_stats is set, and are stored in the stats group of the
+// Cooler when the file is finalized.
+// Pixels are upper-triangular, so (chrom1, chrom2) and (chrom2, chrom1) refer to the same pixels.
+// Only pairs of chromosomes with at least one non-zero pixel are stored
+class ChromosomePairStats {
+ public:
+  struct Record {
+    std::uint32_t chrom1_id{};
+    std::uint32_t chrom2_id{};
+    ContactStats stats{};
+  };
+
+ private:
+  std::uint32_t _num_chroms{};
+  // Pairs are identified by keys computed as chrom1_id * num_chroms + chrom2_id (chrom1_id <=
+  // chrom2_id)
+  tsl::hopscotch_map<std::uint64_t, ContactStats> _pairs{};
+  // Stats for all pixels overlapping a chromosome. Cis pixels are only counted once
+  std::vector<ContactStats> _chroms{};
+  ContactStats _cis{};
+  ContactStats _trans{};
+
+ public:
+  ChromosomePairStats() = default;
+  explicit ChromosomePairStats(std::uint32_t num_chroms);
+
+  void add(std::uint32_t chrom1_id, std::uint32_t chrom2_id, const ContactStats &stats);
+
+  // Return empty stats when there are no pixels overlapping the given chromosomes
+  [[nodiscard]] ContactStats at(std::uint32_t chrom1_id, std::uint32_t chrom2_id) const;
+  [[nodiscard]] ContactStats at(const Chromosome &chrom1, const Chromosome &chrom2) const;
+  // Stats for all pixels overlapping the given chromosome (both cis and trans)
+  [[nodiscard]] ContactStats at(std::uint32_t chrom_id) const;
+  [[nodiscard]] ContactStats at(const Chromosome &chrom) const;
+
+  [[nodiscard]] constexpr const ContactStats &cis() const noexcept;
+  [[nodiscard]] constexpr const ContactStats &trans() const noexcept;
+  [[nodiscard]] ContactStats total() const noexcept;
+
+  [[nodiscard]] constexpr std::uint32_t num_chroms() const noexcept;
+  // Number of pairs of chromosomes with at least one non-zero pixel
+  [[nodiscard]] std::size_t size() const noexcept;
+  [[nodiscard]] bool empty() const noexcept;
+
+  // Return the stats for all pairs of chromosomes with at least one non-zero pixel, sorted by
+  // chrom1_id and chrom2_id
+  [[nodiscard]] std::vector<Record> to_vector() const;
+
+  [[nodiscard]] bool operator==(const ChromosomePairStats &other) const;
+  [[nodiscard]] bool operator!=(const ChromosomePairStats &other) const;
+
+ private:
+  [[nodiscard]] std::uint64_t compute_key(std::uint32_t chrom1_id,
+                                          std::uint32_t chrom2_id) const noexcept;
+  void validate_chrom_id(std::uint32_t chrom_id) const;
+};
+
+namespace internal {
+
+// Pixels are usually appended in sorted order, so consecutive pixels tend to overlap the same pair
+// of chromosomes: stats are accumulated locally, and are merged into the ChromosomePairStats only
+// when the pair of chromosomes changes or flush() is called
+class ChromosomePairStatsAccumulator {
+  ChromosomePairStats *_stats{};
+  std::uint32_t _chrom1_id{(std::numeric_limits<std::uint32_t>::max)()};
+  std::uint32_t _chrom2_id{(std::numeric_limits<std::uint32_t>::max)()};
+  ContactStats _buff{};
+
+ public:
+  explicit ChromosomePairStatsAccumulator(ChromosomePairStats &stats) noexcept;
+
+  template <typename N>
+  void add(std::uint32_t chrom1_id, std::uint32_t chrom2_id, N count);
+  void flush();
+};
+
+}  // namespace internal
+
+}  // namespace coolerpp
+
+#include "../../chromosome_pair_stats_impl.hpp"
@@ -0,0 +1,107 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <tsl/hopscotch_map.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace coolerpp {
+
+// Process-wide LRU cache of the decompressed blocks read by Dataset::iterator.
+// Blocks are keyed by the file (canonical path, size and modification time), the dataset path,
+// the offset and size of the block and the value type. Blocks read from remote files are
+// particularly worth caching, as each block that is not cached costs one or more HTTP requests.
+// Only datasets from files opened in read-only mode are cached: libhdf5 does not allow opening
+// the same file in read-only and read-write mode at the same time, and cached blocks are
+// invalidated when a file is modified, as its size and modification time change.
+// The budget set through set_capacity() is independent of the HDF5 chunk cache used by each
+// dataset. The cache is disabled when its capacity is 0 (the default)
+class ChunkCache {
+ public:
+  struct Stats {
+    std::size_t hits{};
+    std::size_t misses{};
+    std::size_t size_bytes{};
+    std::size_t capacity_bytes{};
+    std::size_t num_blocks{};
+  };
+
+ private:
+  struct Entry {
+    std::string key{};
+    std::shared_ptr<const void> data{};
+    std::size_t size_bytes{};
+  };
+  using EntryList = std::list<Entry>;
+  using EntryMap = tsl::hopscotch_map<std::string, EntryList::iterator>;
+
+  mutable std::mutex _mtx{};
+  EntryList _lru{};  // Most recently used entries are at the front
+  EntryMap _entries{};
+  std::size_t _size_bytes{};
+  std::size_t _capacity_bytes{};
+  std::size_t _hits{};
+  std::size_t _misses{};
+
+  ChunkCache() = default;
+
+ public:
+  ChunkCache(const ChunkCache& other) = delete;
+  ChunkCache(ChunkCache&& other) = delete;
+  ~ChunkCache() = default;
+  ChunkCache& operator=(const ChunkCache& other) = delete;
+  ChunkCache& operator=(ChunkCache&& other) = delete;
+
+  [[nodiscard]] static ChunkCache& instance();
+
+  // Lowering the capacity evicts the least recently used blocks
+  void set_capacity(std::size_t capacity_bytes);
+  [[nodiscard]] std::size_t capacity() const;
+  [[nodiscard]] bool enabled() const;
+
+  // Blocks are returned as read-only buffers that may be shared with other iterators
+  template <typename T>
+  [[nodiscard]] std::shared_ptr<const std::vector<T>> find(std::string_view dset_key,
+                                                           std::size_t offset, std::size_t size);
+  // Blocks larger than the cache capacity are not cached
+  template <typename T>
+  void insert(std::string_view dset_key, std::size_t offset,
+              std::shared_ptr<const std::vector<T>> block);
+
+  // Evict the least recently used blocks until at most size_bytes are cached. Unlike
+  // set_capacity(), the capacity of the cache is left unchanged (see MemoryBudget)
+  void trim(std::size_t size_bytes);
+  void clear();
+  void reset_stats();
+  [[nodiscard]] Stats stats() const;
+
+  // Return the string identifying a dataset stored in the given file, or an empty string when the
+  // file could not be found
+  [[nodiscard]] static std::string make_dataset_key(std::string_view file_path,
+                                                    std::string_view dset_path);
+  // Remote files (see RemoteOptions) have no modification time: they are identified by their URL
+  // and size
+  [[nodiscard]] static std::string make_remote_dataset_key(std::string_view url,
+                                                           std::uint64_t file_size,
+                                                           std::string_view dset_path);
+
+ private:
+  template <typename T>
+  [[nodiscard]] static std::string make_key(std::string_view dset_key, std::size_t offset,
+                                            std::size_t size);
+  void evict(std::size_t capacity_bytes);
+};
+
+}  // namespace coolerpp
+
+#include "../../chunk_cache_impl.hpp"
@@ -53,10 +53,39 @@ inline constexpr std::size_t DEFAULT_HDF5_CACHE_SIZE =
     ((MANDATORY_DATASET_NAMES.size() - 3) * DEFAULT_HDF5_DATASET_CACHE_SIZE);
 
 inline constexpr std::size_t DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE = 32ULL << 10U;  // 32K
+inline constexpr std::size_t DEFAULT_HDF5_DATASET_ITERATOR_MIN_BUFFER_SIZE = 256;
+inline constexpr std::size_t DEFAULT_REMOTE_SIEVE_BUFFER_SIZE = 4ULL << 20U;           // 4MB
+inline constexpr std::size_t DEFAULT_IN_MEMORY_INCREMENT = 16ULL << 20U;              // 16MB
+inline constexpr std::size_t DEFAULT_SWMR_FLUSH_INTERVAL = 4'000'000;                 // pixels
+inline constexpr std::size_t DEFAULT_CHECKPOINT_INTERVAL = 50'000'000;                // pixels
+inline constexpr std::size_t DEFAULT_QUERY_THREADS = 4;
+inline constexpr std::size_t DEFAULT_PREFETCH_THREADS = 4;
+inline constexpr std::uint32_t DEFAULT_TILE_SIZE = 256;  // bins
 
 namespace internal {
 inline constexpr std::string_view SENTINEL_ATTR_NAME{"format-version"};
 inline constexpr std::uint8_t SENTINEL_ATTR_VALUE{255};
+inline constexpr std::string_view CHECKPOINT_GROUP_NAME{".checkpoint"};
+
+// Attributes written by File::write_standard_attributes(), except for the sentinel attribute
+// clang-format off
+inline constexpr std::array<std::string_view, 14> STANDARD_ATTR_NAMES{
+    "assembly",
+    "bin-size",
+    "bin-type",
+    "creation-date",
+    "format",
+    "format-url",
+    "generated-by",
+    "metadata",
+    "nbins",
+    "nchroms",
+    "nnz",
+    "storage-mode",
+    "sum",
+    "cis"
+};
+// clang-format on
 }  // namespace internal
 
 [[nodiscard]] constexpr bool ndebug_defined() noexcept {
@@ -6,6 +6,7 @@
 
 #include <fmt/chrono.h>
 
+#include <cstddef>
 #include <cstdint>
 // clang-format off
 #include "coolerpp/internal/suppress_warnings.hpp"
@@ -17,22 +18,36 @@ DISABLE_WARNING_NULL_DEREF
 #include <highfive/H5File.hpp>
 #include <highfive/H5Group.hpp>
 DISABLE_WARNING_POP
+#include <future>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
 #include "coolerpp/balancing.hpp"
 #include "coolerpp/bin_table.hpp"
 #include "coolerpp/chromosome.hpp"
+#include "coolerpp/chromosome_pair_stats.hpp"
 #include "coolerpp/dataset.hpp"
+#include "coolerpp/genomic_interval.hpp"
 #include "coolerpp/group.hpp"
 #include "coolerpp/index.hpp"
 #include "coolerpp/internal/numeric_variant.hpp"
+#include "coolerpp/internal/pixel_column_reader.hpp"
+#include "coolerpp/internal/pixel_writer.hpp"
+#include "coolerpp/internal/query_pool.hpp"
+#include "coolerpp/memory_budget.hpp"
+#include "coolerpp/memory_file.hpp"
 #include "coolerpp/pixel.hpp"
 #include "coolerpp/pixel_selector.hpp"
+#include "coolerpp/remote.hpp"
+#include "coolerpp/stats.hpp"
+#include "coolerpp/swmr.hpp"
+#include "coolerpp/trace.hpp"
 
 namespace coolerpp {
 
@@ -74,6 +89,82 @@ struct StandardAttributes {
   StandardAttributes() = default;
 };
 
+// Filters used to compress the datasets of new coolers.
+// Pixel datasets can be compressed using different filters and chunk sizes: bin1_id is monotonic
+// and bin2_id is sorted within each row, so they usually compress much better (and decode faster)
+// using e.g. bit shuffling and ZSTD than the counts
+struct CompressionPolicy {
+  DatasetFilters pixels_bin1_id{};
+  DatasetFilters pixels_bin2_id{};
+  DatasetFilters pixels_count{};
+  // Filters used by all other datasets (chroms, bins and indexes)
+  DatasetFilters other{};
+};
+
+// Periodically record how many pixels have been written to a file, so that loading can be
+// resumed with File::resume() when the process writing the file dies before closing it.
+// Checkpoints are written every interval pixels, as well as when File::checkpoint() is called.
+// Automatic checkpoints are disabled when interval is 0
+struct CheckpointOptions {
+  std::size_t interval{DEFAULT_CHECKPOINT_INTERVAL};
+};
+
+struct WriterOptions {
+  // Number of threads used to compress pixels. When threads > 1, pixels passed to
+  // File::append_pixels() are buffered and full chunks are compressed in the background and
+  // written to the file in order. Buffered pixels are flushed by File::flush() and when closing
+  // the file. Chunks can only be compressed in the background when pixel datasets use the filters
+  // built into libhdf5 (i.e. BYTE shuffling and DEFLATE): compression is otherwise left to libhdf5
+  std::size_t threads{1};
+  CompressionPolicy compression{};
+  // Accumulate the sum of interactions and the number of non-zero pixels of each bin while pixels
+  // are appended. Pixels are upper-triangular: pixels outside of the diagonal contribute to the
+  // marginals of both bins. Marginals are written to bins/marginal_sum and bins/marginal_nnz when
+  // the file is finalized, and can be read back with File::read_bin_marginal_sum() and
+  // File::read_bin_marginal_nnz()
+  bool compute_bin_marginals{false};
+  // Accumulate the sum of interactions and the number of non-zero pixels of each pair of
+  // chromosomes while pixels are appended (see ChromosomePairStats). Stats are written to the
+  // non-standard stats group when the file is finalized, and can be read back with
+  // File::read_chromosome_pair_stats()
+  bool compute_chromosome_pair_stats{false};
+  // Keep the file in memory instead of writing it to disk (see InMemoryOptions). The content of
+  // files kept in memory can be retrieved with File::close_to_buffer()
+  std::optional<InMemoryOptions> in_memory{};
+  // Write the file in SWMR mode so that it can be read with File::open_read_only_swmr() while
+  // pixels are being appended (see SWMROptions). Not compatible with in_memory and threads > 1
+  std::optional<SWMROptions> swmr{};
+  // Write checkpoints while pixels are being appended (see CheckpointOptions). Not compatible
+  // with swmr
+  std::optional<CheckpointOptions> checkpoint{};
+};
+
+// Describe how a Cooler is going to be read. Profiles are used to size the chunk cache of each
+// dataset based on how datasets are chunked in the file being opened:
+// - SEQUENTIAL: pixels are traversed once in storage order (e.g. when iterating over all pixels).
+//   Pixel datasets only cache the chunks being read, and fully read chunks are evicted first
+// - RANDOM: many small queries located anywhere in the matrix. Pixel datasets split the cache
+//   budget, as chunks are likely to be accessed multiple times in any order
+// - BAND: queries sliding along the diagonal. Pixel datasets split the cache budget, and chunks
+//   that have been partially read (e.g. spanning the edge of the band) are kept over chunks that
+//   have been read fully, as they are likely to be read by the following queries
+enum class AccessProfile : std::uint_fast8_t { SEQUENTIAL, RANDOM, BAND };
+
+struct CacheOptions {
+  AccessProfile profile{AccessProfile::RANDOM};
+  // Upper bound for the total size of the chunk caches of all datasets. Each dataset always caches
+  // at least one chunk
+  std::size_t cache_size_bytes{DEFAULT_HDF5_CACHE_SIZE};
+  // Override the chunk preemption policy and the number of hash table slots of the pixel datasets,
+  // which are otherwise derived from the access profile and chunk size
+  std::optional<double> w0{};
+  std::optional<std::size_t> num_slots{};
+  // Read pixels without going through libhdf5 (see Dataset::enable_direct_reads()), so that
+  // pixels from files opened in read-only mode can be read concurrently from multiple threads.
+  // Datasets that do not support direct reads are silently read through libhdf5
+  bool direct_pixel_reads{false};
+};
+
 template <typename InputIt>
 void init_mcool(std::string_view file_path, InputIt first_resolution, InputIt last_resolution,
                 bool force_overwrite = false);
@@ -87,33 +178,77 @@ void init_mcool(std::string_view file_path, bool force_overwrite = false);
 // void init_scool(std::string_view file_path, InputIt first_chrom, InputIt last_chrom,
 //                 bool force_overwrite = false);
 
+class MultiResFile;
+class SingleCellFile;
+
 class File {
+  friend MultiResFile;
+  friend SingleCellFile;
+
  public:
   enum class QUERY_TYPE { BED, UCSC };
 
  private:
+  // Only used by fetch_async(). The pool is declared first so that move-assigning a File joins the
+  // threads of the old pool before the datasets they read from are replaced
+  mutable std::unique_ptr<internal::QueryPool> _query_pool{};
+  std::unique_ptr<std::mutex> _query_pool_mtx{std::make_unique<std::mutex>()};
+  std::size_t _query_threads{DEFAULT_QUERY_THREADS};
   unsigned int _mode{HighFive::File::ReadOnly};
   std::unique_ptr<HighFive::File> _fp{};
   RootGroup _root_group{};
   GroupMap _groups{};
   DatasetMap _datasets{};
   mutable WeightMap _weights{};
+  mutable std::shared_ptr<const std::vector<double>> _marginal_sum{};
+  mutable std::shared_ptr<const std::vector<std::uint64_t>> _marginal_nnz{};
+  // Protects _weights, _marginal_sum and _marginal_nnz. Wrapped in a unique_ptr so that File
+  // stays movable
+  std::unique_ptr<std::mutex> _weights_mtx{std::make_unique<std::mutex>()};
   StandardAttributes _attrs{StandardAttributes::init(0)};
   internal::NumericVariant _pixel_variant{};
   std::shared_ptr<const BinTable> _bins{};
   std::shared_ptr<Index> _index{};
+  // Only used when writing pixels with WriterOptions::compute_chromosome_pair_stats=true
+  ChromosomePairStats _chrom_pair_stats{};
+  bool _compute_chrom_pair_stats{false};
+  // Only used when writing pixels with WriterOptions::compute_bin_marginals=true
+  std::vector<double> _marginal_sum_buff{};
+  std::vector<std::uint64_t> _marginal_nnz_buff{};
+  std::unique_ptr<internal::PixelWriter> _writer{};
   bool _finalize{false};
+  // When true, the chroms and bins groups are owned by a parent .scool file and are not written
+  // when the file is finalized
+  bool _shared_bin_table{false};
+  // Only used when writing files in SWMR mode (see WriterOptions::swmr)
+  bool _swmr{false};
+  std::size_t _swmr_flush_interval{};
+  std::uint64_t _swmr_flushed_nnz{};
+  // Only used when writing checkpoints (see WriterOptions::checkpoint)
+  std::size_t _checkpoint_interval{};
+  std::uint64_t _checkpointed_nnz{};
 
   // Constructors are private. Cooler files are opened using factory methods
   explicit File(std::string_view uri, unsigned mode = HighFive::File::ReadOnly,
-                std::size_t cache_size_bytes = DEFAULT_HDF5_CACHE_SIZE,
-                double w0 = DEFAULT_HDF5_CACHE_W0, bool validate = true);
+                const CacheOptions &cache_options = CacheOptions{}, bool validate = true);
+  // Open the Cooler at uri using a file handle that has already been opened (and validated).
+  // When bins is not null, the bin table is not imported from the file
+  explicit File(HighFive::File fp, std::string_view uri, unsigned mode,
+                const CacheOptions &cache_options, bool validate,
+                std::shared_ptr<const BinTable> bins = nullptr, bool swmr_read = false);
 
   template <typename PixelT>
-  explicit File(std::string_view uri, ChromosomeSet chroms, PixelT pixel,
+  explicit File(HighFive::File fp, std::string_view uri, ChromosomeSet chroms, PixelT pixel,
                 StandardAttributes attributes,
                 std::size_t cache_size_bytes = DEFAULT_HDF5_CACHE_SIZE,
-                double w0 = DEFAULT_HDF5_CACHE_W0);
+                double w0 = DEFAULT_HDF5_CACHE_W0,
+                const CompressionPolicy &compression = CompressionPolicy{});
+  // Create a Cooler under root_grp, whose chroms and bins groups already exist (e.g. because they
+  // are hard links to the tables stored at the root of a .scool file)
+  template <typename PixelT>
+  explicit File(HighFive::File fp, RootGroup root_grp, std::shared_ptr<const BinTable> bins,
+                PixelT pixel, StandardAttributes attributes, std::size_t cache_size_bytes,
+                double w0, const CompressionPolicy &compression);
 
  public:
   File() = default;
@@ -130,12 +265,51 @@ class File {
   [[nodiscard]] static File open_read_only_read_once(
       std::string_view uri, std::size_t cache_size_bytes = DEFAULT_HDF5_CACHE_SIZE,
       bool validate = true);
+  // Size the chunk cache of each dataset according to the given access profile and overrides
+  [[nodiscard]] static File open_read_only(std::string_view uri,
+                                           const CacheOptions &cache_options,
+                                           bool validate = true);
+  // Open a Cooler coming from a trusted source. utils::is_cooler() is not called, and the bin table
+  // stored in the file is not compared with the bin table computed from chromosomes and bin size:
+  // only the shape of the bin table datasets is checked, which costs a few HDF5 metadata reads.
+  // Offsets from the index are read lazily, one chromosome at a time. Call validate() to run the
+  // checks that were skipped
+  [[nodiscard]] static File open_read_only_trusted(
+      std::string_view uri, const CacheOptions &cache_options = CacheOptions{});
+  // Open the Cooler stored under group_path in the HDF5 file image stored in buff (e.g. an image
+  // returned by close_to_buffer() or received over the network). The image is copied, and the
+  // Cooler is read from memory without touching the disk
+  [[nodiscard]] static File open_read_only_from_buffer(
+      const void *buff, std::size_t size, std::string_view group_path = "/",
+      const CacheOptions &cache_options = CacheOptions{}, bool validate = true);
+  // Open a Cooler that is being written in SWMR mode (see WriterOptions::swmr). Only the rows of
+  // the matrix published by the writer when the file was opened are visible: reopen the file to
+  // see rows appended since then. Attributes such as sum and cis are placeholders until the
+  // writer closes the file
+  [[nodiscard]] static File open_read_only_swmr(std::string_view uri,
+                                                const CacheOptions &cache_options = CacheOptions{});
   template <typename PixelT = DefaultPixelT>
   [[nodiscard]] static File create_new_cooler(
       std::string_view uri, const ChromosomeSet &chroms, std::uint32_t bin_size,
       bool overwrite_if_exists = false,
       StandardAttributes attributes = StandardAttributes::init<PixelT>(0),
-      std::size_t cache_size_bytes = DEFAULT_HDF5_CACHE_SIZE * 4);
+      std::size_t cache_size_bytes = DEFAULT_HDF5_CACHE_SIZE * 4,
+      WriterOptions writer_options = WriterOptions{});
+  // Reopen a Cooler whose writer died before closing it, and resume appending pixels from the last
+  // checkpoint (see WriterOptions::checkpoint). Pixels written after the checkpoint are discarded:
+  // attributes().nnz is the number of pixels that should be skipped from the input.
+  // The index and statistics are restored from the checkpoint. Pixels are only scanned again when
+  // writer_options requests statistics that were not computed when the checkpoint was written
+  [[nodiscard]] static File resume(std::string_view uri,
+                                   std::size_t cache_size_bytes = DEFAULT_HDF5_CACHE_SIZE * 4,
+                                   WriterOptions writer_options = WriterOptions{});
+
+  // Reopen a finalized Cooler to append pixels past the last pixel written. The index, sums and
+  // statistics are restored from the file, and are updated when the file is closed. Weights
+  // stored in the file are left untouched, and should be computed again once done appending
+  [[nodiscard]] static File open_append(std::string_view uri,
+                                        std::size_t cache_size_bytes = DEFAULT_HDF5_CACHE_SIZE * 4,
+                                        WriterOptions writer_options = WriterOptions{});
 
   ~File() noexcept;
 
@@ -150,6 +324,13 @@ class File {
               bool overwrite_if_exists = false,
               StandardAttributes attributes = StandardAttributes::init<PixelT>(0));
   void close();
+  // Close the file and return a copy of the image of the HDF5 file backing it. This is mostly
+  // useful for files kept in memory (see WriterOptions::in_memory), whose content would otherwise
+  // be discarded when the file is closed
+  [[nodiscard]] std::vector<std::byte> close_to_buffer();
+  // Run the checks performed when opening a file with validate=true.
+  // Throws std::runtime_error when the file is not a valid Cooler
+  void validate() const;
 
   // template <typename PixelT, typename InputIt>
   // [[nodiscard]] static  File create_new_mcool(std::string_view file_path,
@@ -190,8 +371,39 @@ class File {
   [[nodiscard]] bool has_integral_pixels() const noexcept;
   [[nodiscard]] bool has_float_pixels() const noexcept;
 
+  // I/O and decoding statistics accumulated since the file was opened (or since the last call to
+  // reset_stats()). Counters are shared with the PixelSelectors returned by fetch() and updated
+  // concurrently by all threads reading from the file.
+  // Always returns zeros unless STATS_ENABLED is true
+  [[nodiscard]] FileStats stats() const;
+  void reset_stats() const noexcept;
+
+  // Memory held by the chunk caches, index, bin table, weights and write buffers of the file.
+  // Buffers used by PixelSelector iterators are shared by all files, and are accounted for by
+  // MemoryBudget::usage()
+  [[nodiscard]] FileMemoryUsage memory_usage() const;
+
+  // PixelIt can yield either Pixel<N> or ThinPixel<N>. Pixels are traversed once: validation,
+  // index and statistics updates are performed while copying pixels into column buffers, which
+  // are then written to the pixel datasets. When an invalid pixel is found, the pixels preceding
+  // it are appended before throwing
   template <typename PixelIt, typename = std::enable_if_t<is_iterable_v<PixelIt>>>
   void append_pixels(PixelIt first_pixel, PixelIt last_pixel, bool validate = false);
+  // Append n pixels stored in columnar form. Pixels must be sorted and should not overlap with
+  // pixels already written to the file. Bin objects are never materialized
+  template <typename N>
+  void append_pixels_columns(const std::uint64_t *bin1_ids, const std::uint64_t *bin2_ids,
+                             const N *counts, std::size_t n, bool validate = false);
+  // Append all pixels stored in src, which should share the bin table of this file. The rows of
+  // src storing pixels should all be located downstream of the last row written to this file.
+  // Pixels are copied column by column in blocks of chunk_size pixels without per-pixel
+  // bookkeeping: the index of src is rebased on the number of pixels already written, and sums and
+  // chromosome pair stats are merged from the attributes of src. Files lacking these statistics,
+  // as well as files written with WriterOptions::compute_bin_marginals, fall back to
+  // append_pixels_columns()
+  template <typename N>
+  void append_pixels_from(const File &src,
+                          std::size_t chunk_size = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE);
 
   template <typename N, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
   [[nodiscard]] typename PixelSelector<N, CHUNK_SIZE>::iterator begin() const;
@@ -203,6 +415,9 @@ class File {
   template <typename N, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
   [[nodiscard]] typename PixelSelector<N, CHUNK_SIZE>::iterator cend() const;
 
+  // Select all pixels
+  template <typename N, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
+  [[nodiscard]] PixelSelector<N, CHUNK_SIZE> fetch() const;
   template <typename N, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
   [[nodiscard]] PixelSelector<N, CHUNK_SIZE> fetch(std::string_view query,
                                                    QUERY_TYPE query_type = QUERY_TYPE::UCSC) const;
@@ -210,6 +425,20 @@ class File {
   [[nodiscard]] PixelSelector<N, CHUNK_SIZE> fetch(std::string_view chrom_name, std::uint32_t start,
                                                    std::uint32_t end) const;
 
+  // Fetch pixels overlapping query whose bins are at most max_diagonal_distance bins apart
+  template <typename N, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
+  [[nodiscard]] PixelSelector<N, CHUNK_SIZE> fetch(std::string_view query,
+                                                   std::uint64_t max_diagonal_distance,
+                                                   QUERY_TYPE query_type = QUERY_TYPE::UCSC) const;
+
+  // Fetch pixels overlapping query that pass filter (see PixelFilter)
+  template <typename N, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
+  [[nodiscard]] PixelSelector<N, CHUNK_SIZE> fetch(const PixelFilter &filter) const;
+  template <typename N, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
+  [[nodiscard]] PixelSelector<N, CHUNK_SIZE> fetch(std::string_view query,
+                                                   const PixelFilter &filter,
+                                                   QUERY_TYPE query_type = QUERY_TYPE::UCSC) const;
+
   template <typename N, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
   [[nodiscard]] PixelSelector<N, CHUNK_SIZE> fetch(std::string_view range1, std::string_view range2,
                                                    QUERY_TYPE query_type = QUERY_TYPE::UCSC) const;
@@ -219,13 +448,176 @@ class File {
                                                    std::string_view chrom2_name,
                                                    std::uint32_t start2, std::uint32_t end2) const;
 
+  // Fetch pixels overlapping the rows of range1 and the columns of range2 (see
+  // SymmetricPixelSelector). With SymmetryMode::FULL, pixels below the diagonal are generated by
+  // mirroring the upper triangle, so that e.g. fetch("chr2", "chr1", SymmetryMode::FULL) or cis
+  // queries returning the full square do not require a second query nor a sort
+  template <typename N, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
+  [[nodiscard]] SymmetricPixelSelector<N, CHUNK_SIZE> fetch(
+      std::string_view query, SymmetryMode mode, QUERY_TYPE query_type = QUERY_TYPE::UCSC) const;
+  template <typename N, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
+  [[nodiscard]] SymmetricPixelSelector<N, CHUNK_SIZE> fetch(
+      std::string_view range1, std::string_view range2, SymmetryMode mode,
+      QUERY_TYPE query_type = QUERY_TYPE::UCSC) const;
+
+  // Call visitor(sel) with a PixelSelector whose count type matches the on-disk type of
+  // pixels/count (see pixel_variant()), and return its result.
+  // visitor should be a generic callable: it is instantiated once for each type supported by
+  // internal::NumericVariant, so kernels are specialized for the actual count type and no
+  // conversion takes place while reading counts
+  template <typename Visitor>
+  decltype(auto) visit_pixels(Visitor &&visitor) const;
+  template <typename Visitor>
+  decltype(auto) visit_pixels(Visitor &&visitor, std::string_view query,
+                              QUERY_TYPE query_type = QUERY_TYPE::UCSC) const;
+  template <typename Visitor>
+  decltype(auto) visit_pixels(Visitor &&visitor, std::string_view range1, std::string_view range2,
+                              QUERY_TYPE query_type = QUERY_TYPE::UCSC) const;
+
+  // Write the dense matrix for the given query to the caller-provided buffer out.
+  // The matrix has one row for each bin overlapping range1 and one column for each bin
+  // overlapping range2, and is stored in row-major order with rows being ld values apart
+  // (ld should be >= the number of columns). Pixels are read directly from columnar blocks.
+  // When pixels are stored using the symmetric-upper storage mode, values below the diagonal
+  // are filled by mirroring the upper triangle.
+  // Counts are converted to N (e.g. use N=float to produce a single-precision matrix).
+  // The second overload balances counts using the given weights: when N is an integral type,
+  // balanced counts are truncated, NaNs are stored as 0, and values that cannot be represented by
+  // N cause an exception to be thrown
+  template <typename N>
+  void fetch_dense(std::string_view range1, std::string_view range2, N *out, std::size_t ld,
+                   QUERY_TYPE query_type = QUERY_TYPE::UCSC) const;
+  template <typename N>
+  void fetch_dense(std::string_view range1, std::string_view range2, const Weights &weights,
+                   N *out, std::size_t ld, QUERY_TYPE query_type = QUERY_TYPE::UCSC) const;
+  // Same as above, but fill out with observed/expected ratios (see ObservedOverExpectedOp).
+  // Pixels that are not stored in the file are set to 0 regardless of the expected value, unless
+  // op is log-transformed: log2(0 / expected) is -inf (or NaN where the ratio is undefined), so
+  // absent pixels are set to op(bin1_id, bin2_id, 0) instead, as 0 would mean observed == expected
+  template <typename N>
+  void fetch_dense(std::string_view range1, std::string_view range2,
+                   const ObservedOverExpectedOp &op, N *out, std::size_t ld,
+                   QUERY_TYPE query_type = QUERY_TYPE::UCSC) const;
+
+  // Answer many queries with as few passes over the pixel table as possible.
+  // Queries are sorted by their first range, and queries whose rows overlap or are adjacent are
+  // answered by scanning the rows they share only once. When the columns of such queries are
+  // far apart, queries are split into groups of overlapping columns that are scanned separately,
+  // seeking to the first column of each group within each row.
+  // op(query_id, pixel) is called for every pixel overlapping a query, where query_id is the
+  // query position in queries. Pixels overlapping multiple queries are visited once per query.
+  // Pixels are visited in ascending order for each query, but calls for different queries may be
+  // interleaved
+  template <typename N, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE,
+            typename PixelOp>
+  void fetch_many(const std::vector<std::pair<GenomicInterval, GenomicInterval>> &queries,
+                  PixelOp op) const;
+
+  // Look up the counts of many individual pixels.
+  // Returns one count for each (bin1_id, bin2_id) pair, in the same order as bin_pairs, and 0 for
+  // pixels that are not stored in the file. Pairs are sorted and grouped by row, and bin2_ids are
+  // located with a binary search within blocks of up to CHUNK_SIZE pixels read from the pixel
+  // table, so that each block is read at most once.
+  // When pixels are stored using the symmetric-upper storage mode, pairs below the diagonal are
+  // looked up in the upper triangle
+  template <typename N, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
+  [[nodiscard]] std::vector<N> lookup(
+      const std::vector<std::pair<std::uint64_t, std::uint64_t>> &bin_pairs) const;
+
+  // Non-blocking queries: pixels overlapping the query are read into columnar blocks by a pool of
+  // threads owned by the File (see set_query_threads()), so that a few threads can keep many
+  // queries in flight. Queries are parsed and validated on the calling thread, while errors
+  // occurring when reading pixels are reported through the returned future.
+  // When libhdf5 is not thread-safe, queries are answered on the calling thread and the returned
+  // future is always ready.
+  // Futures should be waited for before the File is closed or destroyed
+  template <typename N, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
+  [[nodiscard]] std::future<std::vector<PixelBlock<N>>> fetch_async(
+      std::string_view query, QUERY_TYPE query_type = QUERY_TYPE::UCSC) const;
+  template <typename N, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
+  [[nodiscard]] std::future<std::vector<PixelBlock<N>>> fetch_async(
+      std::string_view range1, std::string_view range2,
+      QUERY_TYPE query_type = QUERY_TYPE::UCSC) const;
+
+  // Tile index for viewer-style queries (e.g. HiGlass). build_tile_index() copies pixels into the
+  // tiles group of the cooler, sorted by square tiles of tile_size x tile_size bins, so that every
+  // tile can be fetched with a single contiguous read of each column.
+  // Tiles are addressed by their row (x) and column (y) in the grid of tiles covering the
+  // genome-wide matrix. When pixels are stored using the symmetric-upper storage mode, only tiles
+  // on or above the diagonal are stored, and tiles below the diagonal are served by transposing
+  // the corresponding tile above the diagonal. Likewise, the lower triangle of diagonal tiles is
+  // filled by mirroring their upper triangle, so that every tile covers a full square of the
+  // matrix. fetch_tile() throws when pixels were added after building the index: the index is
+  // removed by File::open_append() and File::resume(), and has to be built again.
+  // As with write_weights(), the cooler should not be open in read-only mode by the calling
+  // process when building the index
+  static void build_tile_index(std::string_view uri, std::uint32_t tile_size = DEFAULT_TILE_SIZE,
+                               bool overwrite_if_exists = false);
+  [[nodiscard]] bool has_tile_index() const;
+  // Return 0 when the file does not have a tile index
+  [[nodiscard]] std::uint32_t tile_size() const;
+  template <typename N>
+  [[nodiscard]] std::vector<ThinPixel<N>> fetch_tile(std::uint64_t x, std::uint64_t y) const;
+
+  // Visit all pixels using num_threads threads (0 = use all available cores).
+  // The pixel table is split into row-aligned ranges that are processed independently: op is called
+  // concurrently from multiple threads and pixels are not visited in any particular order.
+  // Pixels belonging to the same row are always processed by the same thread.
+  // Chunks are decompressed by the threads visiting them. Calls into libhdf5 are serialized, unless
+  // direct reads are enabled (see CacheOptions::direct_pixel_reads), in which case no lock is taken
+  template <typename N, typename UnaryOperation>
+  void parallel_for_each(std::size_t num_threads, UnaryOperation op,
+                         std::size_t chunk_size = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE) const;
+  // Same as parallel_for_each(), but op is called with blocks of up to chunk_size pixels stored in
+  // columnar format: op(thread_id, bin1_ids, bin2_ids, counts). thread_id is in the range
+  // [0, num_threads) and identifies the thread calling op, which makes it possible to accumulate
+  // results into per-thread buffers without synchronization
+  template <typename N, typename BlockOperation>
+  void parallel_for_each_block(
+      std::size_t num_threads, BlockOperation op,
+      std::size_t chunk_size = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE) const;
+
+  // Decompress chunks from the pixels group using up to num_threads threads
+  // (0 = use all available cores, 1 = decompress chunks inside libhdf5).
+  // Affects all reads, including those performed by PixelSelector iterators
+  void set_decompression_threads(std::size_t num_threads);
+  // Answer queries submitted through fetch_async() using num_threads threads
+  // (0 = use all available cores). Blocks until pending queries have been answered
+  void set_query_threads(std::size_t num_threads);
+  [[nodiscard]] std::size_t query_threads() const noexcept;
+
   bool has_weights(std::string_view name) const;
+  // Weights are read once per process: File objects opening the same URI share the Weights
+  // returned by read_weights(). Reading weights is thread-safe.
+  // Weights read with Weights::Precision::FLOAT32 are stored as single precision balancing
+  // factors, halving the cache footprint of balanced queries (pass Weights::Type::INFER to infer
+  // the weight type from the dataset)
   std::shared_ptr<const Weights> read_weights(std::string_view name) const;
-  std::shared_ptr<const Weights> read_weights(std::string_view name, Weights::Type type) const;
+  std::shared_ptr<const Weights> read_weights(
+      std::string_view name, Weights::Type type,
+      Weights::Precision precision = Weights::Precision::FLOAT64) const;
 
   bool purge_weights(std::string_view name = "");
 
+  // Sum of interactions and number of non-zero pixels for each pair of chromosomes (see
+  // WriterOptions::compute_chromosome_pair_stats). Stats are not part of the Cooler format: other
+  // Coolers usually lack them. When the file is being written, stats include all pixels appended
+  // so far
+  [[nodiscard]] bool has_chromosome_pair_stats() const;
+  [[nodiscard]] ChromosomePairStats read_chromosome_pair_stats() const;
+
+  // Per-bin marginals (see WriterOptions::compute_bin_marginals). Marginals are read from the file
+  // once and then shared by all the pointers returned by the same File. Reading marginals is
+  // thread-safe. When the file is being written, marginals include all pixels appended so far
+  [[nodiscard]] bool has_bin_marginals() const;
+  [[nodiscard]] std::shared_ptr<const std::vector<double>> read_bin_marginal_sum() const;
+  [[nodiscard]] std::shared_ptr<const std::vector<std::uint64_t>> read_bin_marginal_nnz() const;
+
   void flush();
+  // Flush pixels and record the number of pixels written so far, together with the sum of their
+  // interactions, the offsets of the rows written so far and the statistics computed while
+  // appending (see CheckpointOptions)
+  void checkpoint();
 
   template <typename It>
   static void write_weights(std::string_view uri, std::string_view name, It first_weight,
@@ -239,6 +631,7 @@ class File {
   [[nodiscard]] auto index() const noexcept -> const Index &;
   [[nodiscard]] auto index() noexcept -> Index &;
 
+  static void validate_cooler(const HighFive::File &f, std::string_view uri);
   [[nodiscard]] static HighFive::File open_file(std::string_view uri, unsigned int mode,
                                                 bool validate);
 
@@ -249,8 +642,8 @@ class File {
   [[nodiscard]] static auto open_root_group(const HighFive::File &f, std::string_view uri)
       -> RootGroup;
   [[nodiscard]] static auto open_groups(const RootGroup &root_grp) -> GroupMap;
-  [[nodiscard]] static auto open_datasets(const RootGroup &root_grp, std::size_t cache_size_bytes,
-                                          double w0) -> DatasetMap;
+  [[nodiscard]] static auto open_datasets(const RootGroup &root_grp,
+                                          const CacheOptions &cache_options) -> DatasetMap;
   [[nodiscard]] static auto read_standard_attributes(const RootGroup &root_grp,
                                                      bool initialize_missing = false)
       -> StandardAttributes;
@@ -258,13 +651,21 @@ class File {
   // Create/write groups, datasets and attributes
   [[nodiscard]] static auto create_root_group(HighFive::File &f, std::string_view uri,
                                               bool write_sentinel_attr = true) -> RootGroup;
-  [[nodiscard]] static auto create_groups(RootGroup &root_grp) -> GroupMap;
+  // When create_bin_table is false, the chroms and bins groups/datasets are opened instead of
+  // being created
+  [[nodiscard]] static auto create_groups(RootGroup &root_grp, bool create_bin_table = true)
+      -> GroupMap;
   template <typename PixelT>
   [[nodiscard]] static auto create_datasets(RootGroup &root_grp, const ChromosomeSet &chroms,
-                                            std::size_t cache_size_bytes, double w0) -> DatasetMap;
+                                            std::size_t cache_size_bytes, double w0,
+                                            const CompressionPolicy &compression,
+                                            bool create_bin_table = true) -> DatasetMap;
   static void write_standard_attributes(RootGroup &root_grp, const StandardAttributes &attributes,
                                         bool skip_sentinel_attr = true);
 
+  [[nodiscard]] static auto import_bins(const DatasetMap &datasets,
+                                        const StandardAttributes &attrs)
+      -> std::shared_ptr<const BinTable>;
   [[nodiscard]] static auto import_chroms(const Dataset &chrom_names, const Dataset &chrom_sizes,
                                           bool missing_ok) -> ChromosomeSet;
 
@@ -272,12 +673,20 @@ class File {
                                             const Dataset &bin_offset_dset,
                                             const ChromosomeSet &chroms,
                                             std::shared_ptr<const BinTable> bin_table,
-                                            std::uint64_t expected_nnz, bool missing_ok);
+                                            std::uint64_t expected_nnz, bool missing_ok,
+                                            bool lazy = false);
+  // Import the index of a file being written in SWMR mode, whose bin1_offset dataset only covers
+  // the rows published so far
+  [[nodiscard]] static Index import_partial_indexes(const Dataset &bin_offset_dset,
+                                                    std::shared_ptr<const BinTable> bin_table);
 
-  void validate_bins() const;
+  // When full is false, only check that the shape of the bin table matches the number of bins
+  void validate_bins(bool full = true) const;
 
-  template <typename PixelIt>
-  void validate_pixels_before_append(PixelIt first_pixel, PixelIt last_pixel) const;
+  template <typename N>
+  void validate_pixel_columns_before_append(const std::uint64_t *bin1_ids,
+                                            const std::uint64_t *bin2_ids, const N *counts,
+                                            std::size_t n) const;
 
   [[nodiscard]] static internal::NumericVariant detect_pixel_type(
       const RootGroup &root_grp, std::string_view path = "pixels/count");
@@ -292,14 +701,47 @@ class File {
   void write_bin_table();
   static void write_bin_table(Dataset &chrom_dset, Dataset &start_dset, Dataset &end_dset,
                               const BinTable &bin_table);
-  template <typename PixelIt>
-  void update_indexes(PixelIt first_pixel, PixelIt last_pixel);
+  void update_indexes(const std::uint64_t *bin1_ids, std::size_t n);
+
+  void write_chromosome_pair_stats(std::string_view grp_path = "stats");
+  void write_bin_marginals(std::string_view grp_path = "bins");
+  template <typename N>
+  void update_bin_marginals(std::uint64_t bin1_id, std::uint64_t bin2_id, N count) noexcept;
+  [[nodiscard]] ChromosomePairStats import_chromosome_pair_stats(std::string_view grp_path) const;
+  template <typename T>
+  [[nodiscard]] std::shared_ptr<const std::vector<T>> read_bin_marginals(
+      std::string_view name, std::shared_ptr<const std::vector<T>> &cache,
+      const std::vector<T> &buff) const;
 
   void write_indexes();
   static void write_indexes(Dataset &chrom_offset_dset, Dataset &bin_offset_dset, const Index &idx);
 
   void finalize();
 
+  void start_swmr_write(const SWMROptions &options);
+  // Extend dset with the offsets of the rows that have been fully written. Used to publish
+  // indexes/bin1_offset in SWMR mode and to save the index with each checkpoint
+  void write_partial_indexes(Dataset &dset);
+  void flush_swmr_if_due();
+  void end_swmr_write();
+
+  void checkpoint_if_due();
+  // Restore the index and the statistics saved by the last checkpoint. Return false when the
+  // checkpoint did not save everything required by the current writer options
+  [[nodiscard]] bool restore_checkpoint();
+  // Rebuild the index and the statistics computed while appending pixels using the pixels that
+  // have already been written to the file
+  void import_pixel_stats();
+  void remove_checkpoint();
+
+  // Delete the standard attributes of the root group (see internal::STANDARD_ATTR_NAMES).
+  // Attributes written by other tools and the sentinel attribute are left untouched
+  void remove_attributes();
+  void apply_writer_options(const WriterOptions &options);
+
+  // Return true when the chunks of all pixel datasets can be encoded by internal::PixelWriter
+  [[nodiscard]] bool pixel_chunks_can_be_encoded() const;
+
   static void write_sentinel_attr(HighFive::Group grp);
   [[nodiscard]] static bool check_sentinel_attr(const HighFive::Group &grp);
   void write_sentinel_attr();
@@ -313,19 +755,40 @@ class File {
   template <typename PixelT>
   void validate_pixel_type() const noexcept;
 
+  // get_value(bin1_id, bin2_id, count) maps raw counts to the values written to out.
+  // Pixels that are not stored in the file are set to 0, or to get_value(bin1_id, bin2_id, 0)
+  // when fill_absent_with_op is true
+  template <typename N, typename CountT, typename ValueOp>
+  void fetch_dense(std::string_view range1, std::string_view range2, ValueOp get_value, N *out,
+                   std::size_t ld, QUERY_TYPE query_type, bool fill_absent_with_op = false) const;
+  void validate_dense_weights(const Weights &weights) const;
+
   // IMPORTANT: the private fetch() methods interpret queries as open-open
   template <typename N, std::size_t CHUNK_SIZE>
   [[nodiscard]] PixelSelector<N, CHUNK_SIZE> fetch(PixelCoordinates coord) const;
   template <typename N, std::size_t CHUNK_SIZE>
   [[nodiscard]] PixelSelector<N, CHUNK_SIZE> fetch(PixelCoordinates coord1,
                                                    PixelCoordinates coord2) const;
+
+  template <typename N, std::size_t CHUNK_SIZE>
+  [[nodiscard]] std::future<std::vector<PixelBlock<N>>> fetch_async(
+      PixelSelector<N, CHUNK_SIZE> sel) const;
+  [[nodiscard]] internal::QueryPool &query_pool() const;
+
+  void build_tile_index(std::uint32_t tile_size, bool overwrite_if_exists);
+  template <typename N>
+  void write_tile_index(std::uint32_t tile_size);
+  // Tiles are derived from the pixel table, and are dropped when reopening a file to add pixels
+  void remove_tile_index();
 };
 
 }  // namespace coolerpp
 
 #include "../../coolerpp_accessors_impl.hpp"
 #include "../../coolerpp_impl.hpp"
+#include "../../coolerpp_parallel_impl.hpp"
 #include "../../coolerpp_read_impl.hpp"
 #include "../../coolerpp_standard_attr_impl.hpp"
+#include "../../coolerpp_tiles_impl.hpp"
 #include "../../coolerpp_validation_impl.hpp"
 #include "../../coolerpp_write_impl.hpp"
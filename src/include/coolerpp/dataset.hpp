@@ -7,27 +7,39 @@
 #include "coolerpp/internal/suppress_warnings.hpp"
 // clang-format on
 
+#include <algorithm>
 #include <cstdint>
 DISABLE_WARNING_PUSH
 DISABLE_WARNING_NULL_DEREF
 #include <highfive/H5DataSet.hpp>
 DISABLE_WARNING_POP
+#include <future>
 #include <limits>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
 #include "coolerpp/attribute.hpp"
+#include "coolerpp/chunk_cache.hpp"
 #include "coolerpp/common.hpp"
 #include "coolerpp/group.hpp"
 #include "coolerpp/internal/generic_variant.hpp"
+#include "coolerpp/internal/numeric_variant.hpp"
 #include "coolerpp/internal/variant_buff.hpp"
+#include "coolerpp/memory_budget.hpp"
+#include "coolerpp/stats.hpp"
+#include "coolerpp/trace.hpp"
 
 namespace coolerpp {
 
 struct RootGroup;
 
 namespace internal {
+class DirectChunkReader;
+struct RawChunks;
+
 template <typename T>
 struct is_atomic_buffer
     : public std::disjunction<std::is_same<internal::GenericVariant, std::decay_t<T>>,
@@ -36,14 +48,62 @@ struct is_atomic_buffer
 
 template <typename T>
 inline constexpr bool is_atomic_buffer_v = is_atomic_buffer<T>::value;
+
+// Initial block size for Dataset::iterators expected to read num_values values (e.g. the number
+// of pixels stored in the rows overlapping a query)
+[[nodiscard]] constexpr std::size_t adaptive_block_size(std::size_t num_values,
+                                                        std::size_t chunk_size) noexcept {
+  return (std::min)((std::max)(num_values, DEFAULT_HDF5_DATASET_ITERATOR_MIN_BUFFER_SIZE),
+                    chunk_size);
+}
+
+// Buffers used to read values before converting them to another type are released once they grow
+// past this size, so that reading a whole dataset does not pin memory to the calling thread
+inline constexpr std::size_t MAX_RETAINED_CONVERSION_BUFFER_SIZE =
+    DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE * 8;
 }  // namespace internal
 
+// Filters used to compress the chunks of new datasets.
+// BYTE shuffling and DEFLATE compression are built into libhdf5, while BIT shuffling (bitshuffle),
+// ZSTD and LZ4 are provided by the HDF5 filter plugins using the filter ids registered with the
+// HDF Group (32008, 32015 and 32004 respectively): files using these filters can be read by any
+// application linking libhdf5, as long as the plugins can be found (e.g. through
+// HDF5_PLUGIN_PATH). Reading them requires no special handling, as filters are applied by libhdf5.
+// When combining BIT shuffling with ZSTD or LZ4, compression is performed by the bitshuffle filter
+enum class ShuffleFilter : std::uint_fast8_t { NONE, BYTE, BIT };
+enum class Compressor : std::uint_fast8_t { NONE, DEFLATE, ZSTD, LZ4 };
+
+struct DatasetFilters {
+  ShuffleFilter shuffle{ShuffleFilter::BYTE};
+  Compressor compressor{Compressor::DEFLATE};
+  std::uint32_t compression_lvl{DEFAULT_COMPRESSION_LEVEL};
+  // Number of values stored in each chunk
+  std::size_t chunk_size{DEFAULT_HDF5_CHUNK_SIZE / sizeof(std::int32_t)};
+};
+
 DISABLE_WARNING_PUSH
 DISABLE_WARNING_DEPRECATED_DECLARATIONS
 class Dataset {
   RootGroup _root_group{};
   HighFive::DataSet _dataset{};
   mutable internal::VariantBuffer _buff{};
+  std::size_t _decompression_threads{1};
+  // Identifies the dataset within ChunkCache. Empty when blocks should not be cached.
+  // Computed when the Dataset is constructed, as computing the key calls into libhdf5, which is not
+  // safe from the threads prefetching blocks for Dataset::iterator
+  std::string _chunk_cache_key{};
+  // Shared by copies of the same Dataset. Always null unless STATS_ENABLED is true
+  std::shared_ptr<internal::IOCounters> _io_counters{};
+  // Accounts for the chunk cache of the dataset in MemoryBudget. Shared by copies of the same
+  // Dataset, as they share the underlying HDF5 dataset. Null when the budget was disabled while
+  // opening the dataset
+  std::shared_ptr<const internal::MemoryReservation> _memory_reservation{};
+  // Null unless enable_direct_reads() succeeded
+  std::shared_ptr<const internal::DirectChunkReader> _direct_reader{};
+  // Index of the type used to store values on disk within internal::NumericVariant, detected once
+  // when the dataset is opened. NUMERIC_VARIANT_NPOS for non-numeric datasets
+  std::size_t _native_type_idx{internal::NUMERIC_VARIANT_NPOS};
+  std::size_t _size_limit{(std::numeric_limits<std::size_t>::max)()};
 
  public:
   template <typename T, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
@@ -53,9 +113,18 @@ class Dataset {
 
   [[nodiscard]] static HighFive::DataSetCreateProps init_create_props(
       std::uint_fast8_t compression_lvl, std::size_t chunk_size);
+  // Throw when filters rely on plugins that are not available
+  [[nodiscard]] static HighFive::DataSetCreateProps init_create_props(
+      const DatasetFilters &filters);
+  // chunk_size and cache_size are expressed in bytes. The number of slots of the hash table used
+  // to look up chunks is set to the prime closest to 100 times the number of chunks fitting in the
+  // cache, unless num_slots is provided
   [[nodiscard]] static HighFive::DataSetAccessProps init_access_props(std::size_t chunk_size,
                                                                       std::size_t cache_size,
                                                                       double w0);
+  [[nodiscard]] static HighFive::DataSetAccessProps init_access_props(std::size_t cache_size,
+                                                                      double w0,
+                                                                      std::size_t num_slots);
 
   [[nodiscard]] static HighFive::DataSetCreateProps default_create_props();
   [[nodiscard]] static HighFive::DataSetAccessProps default_access_props();
@@ -87,6 +156,12 @@ class Dataset {
 
   [[nodiscard]] std::size_t size() const;
   [[nodiscard]] bool empty() const;
+  // Number of values stored in each chunk. Returns 0 when the dataset is not chunked
+  [[nodiscard]] std::size_t chunk_size() const;
+  [[nodiscard]] static std::size_t chunk_size(const HighFive::DataSet &dset);
+  [[nodiscard]] std::size_t chunk_size_bytes() const;
+  // Size of the HDF5 chunk cache of the dataset in bytes. Returns 0 when the dataset is not chunked
+  [[nodiscard]] std::size_t chunk_cache_size() const;
 
   [[nodiscard]] HighFive::DataSet get();
   [[nodiscard]] const HighFive::DataSet &get() const;
@@ -94,11 +169,23 @@ class Dataset {
   [[nodiscard]] RootGroup get_parent() const;
 
   void resize(std::size_t new_size);
-
-  // Read N values
+  // Hide the values stored past the first max_size values, so that the Dataset looks like it
+  // contains at most max_size values. Used to read a consistent snapshot of datasets that are being
+  // appended to by another process (see File::open_read_only_swmr())
+  void set_size_limit(std::size_t max_size) noexcept;
+
+  // Read N values.
+  // When N differs from the type used to store values on disk, values are read using their native
+  // type and then converted to N (integers are clamped to the range of N, like HDF5 does).
+  // Conversions from floating-point to integer (or to narrower floating-point) types are left to
+  // HDF5
   template <typename N, typename = std::enable_if_t<std::is_arithmetic_v<N>>>
   std::size_t read(std::vector<N> &buff, std::size_t num, std::size_t offset = 0) const;
   std::size_t read(std::vector<std::string> &buff, std::size_t num, std::size_t offset = 0) const;
+  // Read num strings into arena using a single HDF5 call. buff is filled with views over arena:
+  // views are invalidated when arena is modified or destroyed
+  std::size_t read(std::vector<std::string_view> &buff, std::string &arena, std::size_t num,
+                   std::size_t offset = 0) const;
   template <std::size_t i = 0>
   std::size_t read(internal::VariantBuffer &vbuff, std::size_t num, std::size_t offset = 0) const;
 
@@ -178,18 +265,74 @@ class Dataset {
 
   [[nodiscard]] bool has_attribute(std::string_view key) const;
 
+  // When prefetch is true, iterators traversing the dataset sequentially read the next chunk in
+  // the background while the current chunk is being consumed. Chunks are read by a small pool of
+  // threads shared by all iterators (see DEFAULT_PREFETCH_THREADS).
+  // Chunks can only be read in the background without going through libhdf5 (i.e. when direct
+  // reads are enabled and values stored on disk can be converted to T without libhdf5, see
+  // reads_bypass_hdf5()), or when HDF5 was built with thread-safety enabled: prefetching is
+  // silently disabled otherwise (see iterator::prefetch_enabled())
   template <typename T, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
-  [[nodiscard]] auto begin() const -> iterator<T, CHUNK_SIZE>;
+  [[nodiscard]] auto begin(bool prefetch = false) const -> iterator<T, CHUNK_SIZE>;
   template <typename T, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
   [[nodiscard]] auto end() const -> iterator<T, CHUNK_SIZE>;
 
   template <typename T, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
-  [[nodiscard]] auto cbegin() const -> iterator<T, CHUNK_SIZE>;
+  [[nodiscard]] auto cbegin(bool prefetch = false) const -> iterator<T, CHUNK_SIZE>;
   template <typename T, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
   [[nodiscard]] auto cend() const -> iterator<T, CHUNK_SIZE>;
 
+  // initial_block_size is the number of values read by the first read performed by the iterator.
+  // When smaller than CHUNK_SIZE, the block size doubles every time the iterator reads the next
+  // block sequentially, until it reaches CHUNK_SIZE. This is useful to avoid reading CHUNK_SIZE
+  // values when only a handful of values are needed (see internal::adaptive_block_size()).
+  // 0 means CHUNK_SIZE
   template <typename T, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
-  [[nodiscard]] auto make_iterator_at_offset(std::size_t offset) const -> iterator<T, CHUNK_SIZE>;
+  [[nodiscard]] auto make_iterator_at_offset(std::size_t offset, bool prefetch = false,
+                                             std::size_t initial_block_size = 0) const
+      -> iterator<T, CHUNK_SIZE>;
+
+  // When num_threads > 1, reading numeric values fetches raw chunks with H5Dread_chunk and
+  // decompresses them using up to num_threads threads. Datasets using filters other than shuffle
+  // and deflate are read through the regular path
+  void set_decompression_threads(std::size_t num_threads) noexcept;
+  [[nodiscard]] std::size_t decompression_threads() const noexcept;
+
+  // Read numeric values without calling into libhdf5, which serializes calls from all threads
+  // using a global lock. The address of each chunk is resolved once by this function: chunks are
+  // then read with pread() and decompressed by the calling thread, so that Datasets belonging to
+  // different files (and copies of the same Dataset) can be read concurrently.
+  // Direct reads should only be enabled for datasets that are not going to be modified.
+  // Returns false (leaving the Dataset unchanged) when the dataset is not stored in a regular
+  // file on disk, when it is not chunked, when it uses filters other than shuffle and deflate or
+  // when some of its chunks have not been allocated
+  bool enable_direct_reads();
+  [[nodiscard]] bool direct_reads_enabled() const noexcept;
+  // Whether read() can read values as N without calling into libhdf5, in which case reads issued
+  // by multiple threads run concurrently
+  template <typename N>
+  [[nodiscard]] bool reads_bypass_hdf5() const noexcept;
+
+  // Read numeric values in two steps, so that only the first one calls into libhdf5:
+  // fetch_chunks() reads the chunks overlapping [offset, offset + num) as they are stored on disk,
+  // while decode_chunks() decompresses them into buff and converts values to N.
+  // Threads serializing calls to fetch_chunks() through a lock can thus decompress chunks
+  // concurrently. fetch_chunks() returns false (leaving chunks in an unspecified state) when
+  // values cannot be read this way, e.g. when chunks use filters other than shuffle and deflate,
+  // or when values should be converted to N by HDF5: use read() instead
+  template <typename N>
+  [[nodiscard]] bool fetch_chunks(internal::RawChunks &chunks, std::size_t num,
+                                  std::size_t offset) const;
+  template <typename N>
+  void decode_chunks(internal::RawChunks &chunks, std::vector<N> &buff,
+                     std::size_t num_threads = 1) const;
+
+  // Whether blocks read by iterators are stored in the process-wide ChunkCache.
+  // Only datasets belonging to files opened in read-only mode are cached
+  [[nodiscard]] bool chunk_cache_enabled() const;
+
+  // Returns nullptr when statistics are not enabled (see STATS_ENABLED)
+  [[nodiscard]] internal::IOCounters *io_counters() const noexcept;
 
   [[nodiscard]] static std::pair<std::string, std::string> parse_uri(std::string_view uri);
 
@@ -209,6 +352,35 @@ class Dataset {
 
   [[nodiscard]] HighFive::DataType get_h5type() const;
 
+  // Record a read of num values of type_size bytes starting at offset, which began at t0
+  void record_read(std::size_t offset, std::size_t num, std::size_t type_size,
+                   internal::IOCounters::time_point t0) const noexcept;
+
+  // Whether values are stored on disk using type N
+  template <typename N>
+  [[nodiscard]] constexpr bool holds_native_type() const noexcept;
+  // Whether values can be read as N without relying on HDF5 to convert them, i.e. when values are
+  // stored on disk using type N, or when read_and_convert() knows how to convert them
+  template <typename N, std::size_t i = 0>
+  [[nodiscard]] bool converts_natively() const noexcept;
+  // Read values stored using one of the types from internal::NumericVariant and convert them to N.
+  // Values are read into a buffer local to the calling thread, which is reused across reads.
+  // Returns false when values should be converted by HDF5 instead
+  template <typename N, std::size_t i = 0>
+  [[nodiscard]] bool read_and_convert(std::vector<N> &buff, std::size_t num,
+                                      std::size_t offset) const;
+
+  template <typename N>
+  [[nodiscard]] bool read_chunks_parallel(std::vector<N> &buff, std::size_t num,
+                                          std::size_t offset) const;
+  template <typename N, std::size_t i = 0>
+  void decode_and_convert(internal::RawChunks &chunks, std::vector<N> &buff,
+                          std::size_t num_threads) const;
+
+  [[nodiscard]] static std::string init_chunk_cache_key(const RootGroup &root_group,
+                                                        const HighFive::DataSet &dset);
+  [[nodiscard]] const std::string &chunk_cache_key() const noexcept;
+
  public:
   template <typename T, std::size_t CHUNK_SIZE>
   class iterator {
@@ -219,7 +391,26 @@ class Dataset {
     mutable std::size_t _h5_chunk_start{};
     std::size_t _h5_offset{};
 
-    explicit iterator(const Dataset &dset, std::size_t h5_offset = 0, bool init = true);
+    // Block being read ahead of time by internal::prefetch_pool(). Shared by copies of the iterator
+    struct PrefetchedBlock {
+      std::shared_future<std::shared_ptr<std::vector<T>>> buff{};
+      std::size_t offset{};
+
+      PrefetchedBlock() = default;
+      PrefetchedBlock(const PrefetchedBlock &other) = delete;
+      PrefetchedBlock(PrefetchedBlock &&other) = delete;
+      // Wait for the read to complete, as the task reading the block refers to the Dataset
+      ~PrefetchedBlock() noexcept;
+      PrefetchedBlock &operator=(const PrefetchedBlock &other) = delete;
+      PrefetchedBlock &operator=(PrefetchedBlock &&other) = delete;
+    };
+    mutable std::shared_ptr<PrefetchedBlock> _next_block{};
+    bool _prefetch{false};
+    // Number of values read by the next call to read_chunk_at_offset(). Always <= CHUNK_SIZE
+    mutable std::size_t _block_size{CHUNK_SIZE};
+
+    explicit iterator(const Dataset &dset, std::size_t h5_offset = 0, bool init = true,
+                      bool prefetch = false, std::size_t initial_block_size = 0);
 
    public:
     using difference_type = std::ptrdiff_t;
@@ -257,6 +448,8 @@ class Dataset {
 
     [[nodiscard]] constexpr std::uint64_t h5_offset() const noexcept;
     [[nodiscard]] constexpr std::size_t underlying_buff_capacity() const noexcept;
+    // Number of values that will be read by the next block read
+    [[nodiscard]] constexpr std::size_t block_size() const noexcept;
 
     [[nodiscard]] constexpr std::size_t lower_bound() const noexcept;
     [[nodiscard]] constexpr std::size_t upper_bound() const noexcept;
@@ -265,10 +458,33 @@ class Dataset {
     [[nodiscard]] constexpr std::size_t underlying_buff_num_available_rev() const noexcept;
     [[nodiscard]] constexpr std::size_t underlying_buff_num_available_fwd() const noexcept;
 
+    // Return the chunk overlapping the current offset (reading it from file if necessary)
+    [[nodiscard]] auto underlying_buff() const -> std::shared_ptr<const std::vector<T>>;
+    [[nodiscard]] constexpr std::size_t underlying_buff_offset() const noexcept;
+
     constexpr const Dataset &dataset() const noexcept;
+    [[nodiscard]] constexpr bool prefetch_enabled() const noexcept;
 
    private:
     void read_chunk_at_offset(std::size_t new_offset) const;
+    void prefetch_chunk_at_offset(std::size_t offset) const;
+    // Read the block starting at offset, going through ChunkCache when possible.
+    // buff is reused when it is not shared with other iterators or with the cache, otherwise a
+    // free buffer is taken from internal::BufferPool
+    [[nodiscard]] static auto read_block(const Dataset &dset, std::size_t offset,
+                                         std::size_t block_size,
+                                         std::shared_ptr<std::vector<T>> buff)
+        -> std::shared_ptr<std::vector<T>>;
+    // Return nullptr when the block is not cached or ChunkCache is disabled
+    [[nodiscard]] static auto find_cached_block(const Dataset &dset, std::size_t offset,
+                                                std::size_t buff_size)
+        -> std::shared_ptr<std::vector<T>>;
+    // Read buff_size values starting at offset into buff, which should not be shared, and add the
+    // block to ChunkCache when possible
+    [[nodiscard]] static auto read_uncached_block(const Dataset &dset, std::size_t offset,
+                                                  std::size_t buff_size,
+                                                  std::shared_ptr<std::vector<T>> buff)
+        -> std::shared_ptr<std::vector<T>>;
 
     [[nodiscard]] static constexpr auto make_end_iterator(const Dataset &dset) -> iterator;
   };
@@ -280,6 +496,7 @@ using DatasetMap = tsl::hopscotch_map<std::string, Dataset>;
 }  // namespace coolerpp
 
 #include "../../dataset_accessors_impl.hpp"
+#include "../../dataset_chunk_reader_impl.hpp"
 #include "../../dataset_impl.hpp"
 #include "../../dataset_iterator_impl.hpp"
 #include "../../dataset_read_impl.hpp"
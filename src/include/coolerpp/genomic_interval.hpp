@@ -3,12 +3,31 @@
 // SPDX-License-Identifier: MIT
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include "coolerpp/chromosome.hpp"
 
 namespace coolerpp {
+
+// Status codes returned by the non-throwing GenomicInterval parsers
+enum class ParseStatus : std::uint_fast8_t {
+  OK,
+  EMPTY_QUERY,
+  MALFORMED_QUERY,
+  INVALID_CHROMOSOME,
+  MISSING_START_POSITION,
+  MISSING_END_POSITION,
+  INVALID_START_POSITION,
+  INVALID_END_POSITION,
+  END_POSITION_OUT_OF_BOUNDS,
+  EMPTY_INTERVAL
+};
+
 class GenomicInterval {
   static inline const Chromosome null_chrom{};
 
@@ -20,10 +39,33 @@ class GenomicInterval {
   constexpr GenomicInterval() = default;
   explicit GenomicInterval(const Chromosome &chrom_) noexcept;
   GenomicInterval(const Chromosome &chrom_, std::uint32_t start_, std::uint32_t end) noexcept;
-  [[nodiscard]] static GenomicInterval parse_ucsc(const ChromosomeSet &chroms, std::string query);
+  [[nodiscard]] static GenomicInterval parse_ucsc(const ChromosomeSet &chroms,
+                                                  std::string_view query);
   [[nodiscard]] static GenomicInterval parse_bed(const ChromosomeSet &chroms,
                                                  std::string_view query, char sep = '\t');
 
+  // Non-throwing versions of parse_ucsc() and parse_bed(). These do not allocate: on success gi is
+  // set to the parsed interval and ParseStatus::OK is returned, otherwise gi is left untouched
+  [[nodiscard]] static ParseStatus try_parse_ucsc(const ChromosomeSet &chroms,
+                                                  std::string_view query,
+                                                  GenomicInterval &gi) noexcept;
+  [[nodiscard]] static ParseStatus try_parse_bed(const ChromosomeSet &chroms,
+                                                 std::string_view query, GenomicInterval &gi,
+                                                 char sep = '\t') noexcept;
+
+  // Parse a buffer with one BEDPE record per line into pairs of intervals, e.g. to be passed to
+  // File::fetch_many(). Empty lines and lines starting with '#' are skipped, and fields after the
+  // sixth are ignored.
+  // try_parse_bedpe() appends pairs to queries and stops at the first invalid record: in this case
+  // line_number is set to the (0-based) line number of the offending record
+  [[nodiscard]] static ParseStatus try_parse_bedpe(
+      const ChromosomeSet &chroms, std::string_view buffer,
+      std::vector<std::pair<GenomicInterval, GenomicInterval>> &queries, std::size_t &line_number,
+      char sep = '\t');
+  [[nodiscard]] static auto parse_bedpe(const ChromosomeSet &chroms, std::string_view buffer,
+                                        char sep = '\t')
+      -> std::vector<std::pair<GenomicInterval, GenomicInterval>>;
+
   [[nodiscard]] explicit operator bool() const noexcept;
 
   [[nodiscard]] bool operator==(const GenomicInterval &other) const noexcept;
@@ -38,6 +80,27 @@ class GenomicInterval {
   [[nodiscard]] const Chromosome &chrom() const noexcept;
   [[nodiscard]] constexpr std::uint32_t start() const noexcept;
   [[nodiscard]] constexpr std::uint32_t end() const noexcept;
+
+ private:
+  struct QueryTokens {
+    std::string_view chrom_name{};
+    std::string_view start_pos{};
+    std::string_view end_pos{};
+    bool allow_thousands_sep{false};
+  };
+
+  [[nodiscard]] static ParseStatus tokenize_ucsc(std::string_view query,
+                                                 QueryTokens &tokens) noexcept;
+  [[nodiscard]] static ParseStatus tokenize_bed(std::string_view query, char sep,
+                                                QueryTokens &tokens) noexcept;
+  [[nodiscard]] static ParseStatus tokenize_bedpe(std::string_view record, char sep,
+                                                  QueryTokens &tokens1,
+                                                  QueryTokens &tokens2) noexcept;
+  [[nodiscard]] static ParseStatus parse_tokens(const ChromosomeSet &chroms,
+                                                const QueryTokens &tokens,
+                                                GenomicInterval &gi) noexcept;
+  [[noreturn]] static void throw_parse_error(ParseStatus status, const ChromosomeSet &chroms,
+                                             std::string_view query, const QueryTokens &tokens);
 };
 }  // namespace coolerpp
 
@@ -0,0 +1,113 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+#include <highfive/H5DataSet.hpp>
+#include <string_view>
+#include <vector>
+
+#include "coolerpp/balancing.hpp"
+#include "coolerpp/coolerpp.hpp"
+
+namespace coolerpp {
+
+/// Matrix balancing using iterative correction (ICE), following the same procedure used by
+/// cooler balance:
+///  1. Bins with fewer than min_nnz interactions, with marginals smaller than min_count, or whose
+///     (cis) marginals are too small according to the MAD-max filter are masked
+///  2. Biases are updated by dividing them by the normalized marginals of the balanced matrix
+///     until the variance of the marginals drops below tol
+/// When Type::cis is used, chromosomes are balanced independently.
+/// Marginals are accumulated using num_threads threads. When in_memory is true, the filtered
+/// matrix is cached in RAM using a CSR layout, so that iterations do not go through HDF5
+class ICE {
+ public:
+  enum class Type { cis, trans, gw };
+
+  struct Params {
+    double tol{1.0e-5};
+    std::size_t max_iters{200};
+    std::size_t ignore_diags{2};
+    std::size_t min_nnz{10};
+    std::size_t min_count{0};
+    double mad_max{5.0};
+    bool rescale_marginals{true};
+    bool in_memory{true};
+    std::size_t num_threads{1};
+    std::size_t chunk_size{500'000};
+  };
+
+ private:
+  struct CSRMatrix {
+    std::vector<std::uint64_t> row_offsets{};
+    std::vector<std::uint32_t> bin2_ids{};
+    std::vector<double> counts{};
+  };
+
+  Type _type{};
+  Params _params{};
+  std::size_t _num_threads{};
+
+  std::vector<std::uint32_t> _bin_chrom_ids{};
+  // [first, last) bin ranges that are balanced independently
+  std::vector<std::uint64_t> _region_offsets{};
+  CSRMatrix _matrix{};
+
+  std::vector<double> _biases{};
+  std::vector<double> _scale{};
+  std::vector<double> _variance{};
+  std::size_t _num_iters{};
+
+ public:
+  ICE() = delete;
+  explicit ICE(const File& clr, Type type = Type::gw);
+  ICE(const File& clr, Type type, const Params& params);
+
+  [[nodiscard]] auto type() const noexcept -> Type;
+  [[nodiscard]] auto params() const noexcept -> const Params&;
+
+  /// Multiplicative weights. Weights for masked bins are NaN
+  [[nodiscard]] Weights get_weights() const;
+  [[nodiscard]] const std::vector<double>& biases() const noexcept;
+  /// One value for each region that was balanced independently (i.e. one value per chromosome
+  /// when balancing cis interactions, and a single value otherwise)
+  [[nodiscard]] const std::vector<double>& scale() const noexcept;
+  [[nodiscard]] const std::vector<double>& variance() const noexcept;
+  [[nodiscard]] bool converged() const noexcept;
+  [[nodiscard]] std::size_t num_iterations() const noexcept;
+
+  /// Write weights to bins/name together with the attributes written by cooler balance
+  void write_weights(File& clr, std::string_view name = "weight",
+                     bool overwrite_if_exists = false) const;
+  void write_weights(std::string_view uri, std::string_view name = "weight",
+                     bool overwrite_if_exists = false) const;
+
+ private:
+  void write_attributes(HighFive::DataSet& dset, bool overwrite_if_exists) const;
+  [[nodiscard]] bool is_masked(std::uint64_t bin1_id, std::uint64_t bin2_id) const noexcept;
+
+  void filter_bins(const File& clr);
+  void build_matrix(const File& clr);
+  void balance(const File& clr);
+
+  // Compute the marginals of the masked matrix balanced using the current biases
+  void compute_marginals(const File& clr, std::vector<std::vector<double>>& margs) const;
+
+  // Call op(thread_id, bin1_id, bin2_id, count) for every pixel in the pixel table
+  template <typename PixelOp>
+  void scan_pixel_table(const File& clr, PixelOp op) const;
+  // Call op(thread_id, bin1_id, bin2_id, count) for every pixel that has not been masked
+  template <typename PixelOp>
+  void for_each_pixel(const File& clr, PixelOp op) const;
+  template <typename WorkerOp>
+  void run_in_parallel(std::size_t num_threads, WorkerOp op) const;
+
+  [[nodiscard]] static double median(std::vector<double> v);
+};
+
+}  // namespace coolerpp
+
+#include "../../ice_impl.hpp"
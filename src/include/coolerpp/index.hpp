@@ -4,11 +4,14 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <filesystem>
+#include <functional>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <string_view>
 #include <vector>
 
@@ -23,11 +26,29 @@ class Index {
   using ChromID = std::uint32_t;
   using OffsetVect = std::vector<std::uint64_t>;
 
+  using OffsetLoader = std::function<void(std::uint64_t first_bin_id, OffsetVect& offsets)>;
+
   std::shared_ptr<const BinTable> _bins{};
-  std::vector<OffsetVect> _idx{};
+  // Offsets are mutable so that they can be loaded on first access when using a lazy Index
+  mutable std::vector<OffsetVect> _idx{};
   std::size_t _size{};
   std::uint64_t _nnz{};
 
+  // std::atomic is not copyable: wrap it so that Index remains copyable
+  struct LoadedFlag {
+    std::atomic<bool> value{false};
+    LoadedFlag() = default;
+    LoadedFlag(const LoadedFlag& other) noexcept : value(other.value.load()) {}
+    LoadedFlag& operator=(const LoadedFlag& other) noexcept {
+      value = other.value.load();
+      return *this;
+    }
+  };
+
+  OffsetLoader _loader{};
+  mutable std::vector<LoadedFlag> _chrom_loaded{};
+  std::shared_ptr<std::mutex> _loader_mtx{};
+
   static constexpr auto offset_not_set_value = std::numeric_limits<std::uint64_t>::max();
 
   // We pretend this is a map-like structure whose keys are used as index in the _idx vector
@@ -50,6 +71,15 @@ class Index {
 
   Index() = default;
   explicit Index(std::shared_ptr<const BinTable> bins, std::uint64_t nnz = 0);
+  // Construct a lazy Index: offsets for a given chromosome are allocated and fetched using loader
+  // the first time they are accessed. loader is given the id of the first bin to read and a vector
+  // that should be filled with the offsets of consecutive bins. The offsets of the bins flanking
+  // the chromosome are read as well, so that offsets are validated as if the Index was loaded
+  // eagerly.
+  // Calls to loader are serialized using a mutex
+  Index(std::shared_ptr<const BinTable> bins, OffsetLoader loader, std::uint64_t nnz);
+
+  [[nodiscard]] bool is_lazy() const noexcept;
 
   [[nodiscard]] const ChromosomeSet& chromosomes() const noexcept;
   [[nodiscard]] const BinTable& bins() const noexcept;
@@ -63,6 +93,8 @@ class Index {
   [[nodiscard]] constexpr bool empty() const noexcept { return this->size() == 0; }
 
   [[nodiscard]] std::uint32_t bin_size() const noexcept;
+  // Bytes held by the offsets stored in the index
+  [[nodiscard]] std::size_t memory_usage() const;
 
   [[nodiscard]] auto begin() const noexcept -> const_iterator;
   [[nodiscard]] auto end() const noexcept -> const_iterator;
@@ -109,8 +141,13 @@ class Index {
 
   void validate_chrom_id(std::uint32_t chrom_id) const;
   void validate(const Chromosome& chrom) const;
+  void validate_offsets(const Chromosome& chrom, const OffsetVect& offsets) const;
+
+  void load_offsets(std::uint32_t chrom_id) const;
+  void load_all_offsets() const;
 
-  [[nodiscard]] static auto init(const ChromosomeSet& chroms, std::uint32_t bin_size) -> MapT;
+  [[nodiscard]] static auto init(const BinTable& bins) -> MapT;
+  [[nodiscard]] std::size_t compute_row_idx(std::uint32_t chrom_id, std::uint32_t pos) const;
 
  public:
   class iterator {
@@ -140,7 +177,7 @@ class Index {
 
    private:
     [[nodiscard]] std::uint32_t last_chrom_id() const noexcept;
-    [[nodiscard]] auto get_offsets() const noexcept -> const OffsetVect&;
+    [[nodiscard]] auto get_offsets() const -> const OffsetVect&;
     [[nodiscard]] static auto make_end_iterator(const Index* idx) -> iterator;
   };
 };
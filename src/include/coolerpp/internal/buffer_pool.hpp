@@ -0,0 +1,78 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "coolerpp/memory_budget.hpp"
+
+namespace coolerpp::internal {
+
+// Thread-local pool of the buffers used by Dataset::iterator to store the values it reads.
+// The pool keeps a reference to every buffer it hands out: a buffer becomes available again as
+// soon as all iterators, PixelBlocks and cache entries referencing it have released it, so that
+// re-reading a block or copying an iterator does not require allocating a new buffer.
+// Pools are thread-local, and thus require no synchronization. Buffers can still be shared with
+// and released by other threads, as availability is tracked through shared_ptr::use_count().
+// The capacity of pooled buffers is reported to MemoryBudget every time a buffer is handed out,
+// and idle buffers are released when MemoryBudget::trim() is called
+template <typename T>
+class BufferPool {
+  struct Entry {
+    std::shared_ptr<std::vector<T>> buff{};
+    // Bytes reported to MemoryBudget for this buffer
+    std::size_t size_bytes{};
+  };
+
+  std::vector<Entry> _buffers{};
+  std::size_t _max_size{DEFAULT_MAX_SIZE};
+  std::uint64_t _trim_epoch{};
+
+  BufferPool() = default;
+
+ public:
+  static constexpr std::size_t DEFAULT_MAX_SIZE = 16;
+
+  BufferPool(const BufferPool &other) = delete;
+  BufferPool(BufferPool &&other) = delete;
+  ~BufferPool() noexcept;
+  BufferPool &operator=(const BufferPool &other) = delete;
+  BufferPool &operator=(BufferPool &&other) = delete;
+
+  [[nodiscard]] static BufferPool &local();
+
+  // Return a buffer that is not referenced by anyone else, with room for at least capacity
+  // values. buff is returned as is when it is not shared; otherwise the reference to buff is
+  // dropped and a free buffer is taken from the pool. A new buffer is allocated only when all
+  // pooled buffers are in use
+  [[nodiscard]] auto acquire(std::size_t capacity, std::shared_ptr<std::vector<T>> buff = {})
+      -> std::shared_ptr<std::vector<T>>;
+
+  // Number of buffers tracked by the pool, including those that are currently in use
+  [[nodiscard]] std::size_t size() const noexcept;
+  [[nodiscard]] std::size_t max_size() const noexcept;
+  // Set the maximum number of buffers tracked by the pool. Buffers allocated once the pool is
+  // full are not pooled
+  void set_max_size(std::size_t max_size);
+  // Drop the references to all buffers, releasing the memory of those not in use
+  void clear() noexcept;
+  // Bytes held by the buffers tracked by the pool, as of the last time they were handed out
+  [[nodiscard]] std::size_t size_bytes() const noexcept;
+
+ private:
+  [[nodiscard]] static bool is_exclusive(const std::shared_ptr<std::vector<T>> &buff,
+                                         bool pooled) noexcept;
+  // Update the number of bytes reported to MemoryBudget for the given buffer
+  static void update_size(Entry &entry) noexcept;
+  // Drop idle buffers when MemoryBudget::trim() has been called since the last check
+  void release_idle_buffers_if_trimmed() noexcept;
+};
+
+}  // namespace coolerpp::internal
+
+#include "../../../buffer_pool_impl.hpp"
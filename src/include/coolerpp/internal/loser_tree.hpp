@@ -0,0 +1,52 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace coolerpp::internal {
+
+// Loser tree (tournament tree) used to run k-way merges of sorted sequences of pixels.
+// Pixels are identified by keys packing their bin ids as (bin1_id << 32) | bin2_id, so that
+// matches are decided by a single integer comparison. The largest key is reserved to mark
+// sequences that have been consumed.
+// Advancing the merge only requires replaying the path from the leaf of the sequence that produced
+// the last winner to the root of the tree, i.e. log2(k) comparisons per pixel
+class LoserTree {
+  // _keys[i] is the key of the next pixel from the i-th sequence
+  std::vector<std::uint64_t> _keys{};
+  // _tree[0] is the id of the sequence holding the smallest key, while _tree[1..k) store the
+  // losers (i.e. the largest of the two keys) of the matches played at each internal node
+  std::vector<std::size_t> _tree{};
+
+ public:
+  static constexpr auto EXHAUSTED = (std::numeric_limits<std::uint64_t>::max)();
+
+  LoserTree() = default;
+  // Build a tree from the keys of the first pixel of each sequence
+  explicit LoserTree(std::vector<std::uint64_t> keys);
+
+  // Pack bin ids into a key. Bin ids should be smaller than 2^32
+  [[nodiscard]] static constexpr std::uint64_t pack_key(std::uint64_t bin1_id,
+                                                        std::uint64_t bin2_id) noexcept;
+  [[nodiscard]] static constexpr std::uint64_t bin1_id(std::uint64_t key) noexcept;
+  [[nodiscard]] static constexpr std::uint64_t bin2_id(std::uint64_t key) noexcept;
+
+  // Return true once all sequences have been consumed
+  [[nodiscard]] bool done() const noexcept;
+  // Id of the sequence holding the smallest key and its key
+  [[nodiscard]] std::size_t top() const noexcept;
+  [[nodiscard]] std::uint64_t top_key() const noexcept;
+  // Replace the key of the sequence returned by top() (e.g. with the key of the next pixel from
+  // the same sequence, or with EXHAUSTED), and find the new winner
+  void replace_top(std::uint64_t key) noexcept;
+};
+
+}  // namespace coolerpp::internal
+
+#include "../../../loser_tree_impl.hpp"
@@ -7,7 +7,9 @@
 #include <fast_float/fast_float.h>  // for from_chars (fp)
 #include <fmt/format.h>             // for compile_string_to_view, FMT_STRING
 
+#include <algorithm>     // for transform
 #include <charconv>      // for from_chars (int)
+#include <cstdint>       // for uintmax_t
 #include <limits>        // for numeric_limits
 #include <stdexcept>     // for runtime_error, logic_error
 #include <string>        // for string
@@ -104,4 +106,51 @@ inline N parse_numeric_or_throw(std::string_view tok) {
   parse_numeric_or_throw(tok, field);
   return field;
 }
+
+// Convert integer n to N, clamping values outside the range of N to the closest representable
+// value. This matches the behavior of the integer conversions performed by HDF5
+template <typename N, typename I>
+[[nodiscard]] constexpr N saturate_cast(I n) noexcept {
+  static_assert(std::is_integral_v<N>);
+  static_assert(std::is_integral_v<I>);
+  if constexpr (std::is_signed_v<I>) {
+    if constexpr (std::is_unsigned_v<N>) {
+      if (n < 0) {
+        return N(0);
+      }
+    } else if constexpr ((std::numeric_limits<I>::min)() < (std::numeric_limits<N>::min)()) {
+      if (n < static_cast<I>((std::numeric_limits<N>::min)())) {
+        return (std::numeric_limits<N>::min)();
+      }
+    }
+  }
+  if constexpr (static_cast<std::uintmax_t>((std::numeric_limits<I>::max)()) >
+                static_cast<std::uintmax_t>((std::numeric_limits<N>::max)())) {
+    constexpr auto max_value = static_cast<std::uintmax_t>((std::numeric_limits<N>::max)());
+    if (n > 0 && static_cast<std::uintmax_t>(n) > max_value) {
+      return (std::numeric_limits<N>::max)();
+    }
+  }
+  return static_cast<N>(n);
+}
+
+// Whether values stored on disk as T are converted to N by coolerpp rather than by HDF5:
+// conversions from floating-point to integer (or to narrower floating-point) types are left to HDF5
+template <typename T, typename N>
+inline constexpr bool is_native_conversion_v =
+    !std::is_same_v<T, N> &&
+    ((std::is_integral_v<T> && std::is_arithmetic_v<N>) ||
+     (std::is_floating_point_v<T> && std::is_floating_point_v<N> && sizeof(T) <= sizeof(N)));
+
+// Convert values like HDF5 does (i.e. integers are clamped to the range of N)
+template <typename T, typename N>
+inline void convert_numeric(const std::vector<T> &src, std::vector<N> &dest) {
+  static_assert(is_native_conversion_v<T, N>);
+  dest.resize(src.size());
+  if constexpr (std::is_integral_v<T> && std::is_integral_v<N>) {
+    std::transform(src.begin(), src.end(), dest.begin(), [](T n) { return saturate_cast<N>(n); });
+  } else {
+    std::transform(src.begin(), src.end(), dest.begin(), [](T n) { return static_cast<N>(n); });
+  }
+}
 }  // namespace coolerpp::internal
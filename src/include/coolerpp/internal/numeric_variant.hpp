@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <type_traits>
 #include <variant>
 
 namespace coolerpp::internal {
@@ -26,4 +28,18 @@ using NumericVariant =
         long double>;
 // clang-format on
 
+inline constexpr auto NUMERIC_VARIANT_NPOS = static_cast<std::size_t>(-1);
+
+// Index of N within NumericVariant, or NUMERIC_VARIANT_NPOS when N is not one of its alternatives
+template <typename N, std::size_t i = 0>
+[[nodiscard]] constexpr std::size_t numeric_variant_index() noexcept {
+  if constexpr (i == std::variant_size_v<NumericVariant>) {
+    return NUMERIC_VARIANT_NPOS;
+  } else if constexpr (std::is_same_v<N, std::variant_alternative_t<i, NumericVariant>>) {
+    return i;
+  } else {
+    return numeric_variant_index<N, i + 1>();
+  }
+}
+
 }  // namespace coolerpp::internal
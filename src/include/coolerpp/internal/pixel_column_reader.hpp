@@ -0,0 +1,55 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "coolerpp/dataset.hpp"
+
+namespace coolerpp::internal {
+
+// Read blocks of pixels from the bin1_id, bin2_id and count datasets of a cooler.
+// When io_mtx is not null, readers sharing the same mutex can be used from different threads:
+// columns that can be read without calling into libhdf5 (see Dataset::reads_bypass_hdf5()) are
+// read concurrently, while the chunks of the remaining columns are fetched holding io_mtx and
+// decompressed by the calling thread once io_mtx has been released (see Dataset::fetch_chunks()).
+// Each thread should use its own reader. Datasets must outlive the reader
+template <typename N>
+class PixelColumnReader {
+  enum class Status : std::uint_fast8_t { PENDING, FETCHED, DONE };
+
+  const Dataset *_bin1_dset{};
+  const Dataset *_bin2_dset{};
+  const Dataset *_count_dset{};
+  std::mutex *_io_mtx{};
+  // Chunks fetched for each column, reused across reads
+  std::array<RawChunks, 3> _chunks{};
+
+ public:
+  PixelColumnReader() = default;
+  PixelColumnReader(const Dataset &bin1_dset, const Dataset &bin2_dset, const Dataset &count_dset,
+                    std::mutex *io_mtx = nullptr) noexcept;
+
+  void read(std::vector<std::uint64_t> &bin1_buff, std::vector<std::uint64_t> &bin2_buff,
+            std::vector<N> &count_buff, std::size_t num, std::size_t offset);
+
+ private:
+  // Called while holding io_mtx
+  template <typename T>
+  [[nodiscard]] static Status fetch(const Dataset &dset, RawChunks &chunks, std::vector<T> &buff,
+                                    std::size_t num, std::size_t offset);
+  // Called after releasing io_mtx
+  template <typename T>
+  static void complete(Status status, const Dataset &dset, RawChunks &chunks,
+                       std::vector<T> &buff, std::size_t num, std::size_t offset);
+};
+
+}  // namespace coolerpp::internal
+
+#include "../../../pixel_column_reader_impl.hpp"
@@ -0,0 +1,89 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "coolerpp/dataset.hpp"
+#include "coolerpp/internal/query_pool.hpp"
+
+namespace coolerpp::internal {
+
+// Buffer pixels appended to the bin1_id, bin2_id and count datasets, compress full chunks using a
+// fixed pool of num_threads threads and write them in order using H5Dwrite_chunk.
+// All calls into libhdf5 are performed by the thread owning the PixelWriter
+class PixelWriter {
+  struct Column {
+    Dataset dset{};
+    ChunkLayout layout{};
+    std::size_t type_size{};
+    bool floating_point{};
+    std::vector<std::uint8_t> staging{};
+    std::size_t size{};
+  };
+
+  struct PendingChunk {
+    std::size_t column{};
+    std::size_t chunk_offset{};
+    std::future<std::vector<std::uint8_t>> data{};
+  };
+
+  std::array<Column, 3> _columns{};
+  std::deque<PendingChunk> _pending{};
+  std::size_t _num_threads{};
+  std::uint64_t _last_bin1_id{};
+  // Threads encoding chunks. QueryPool is not movable, hence the unique_ptr
+  std::unique_ptr<QueryPool> _pool{};
+
+ public:
+  PixelWriter() = default;
+  PixelWriter(Dataset pixels_bin1_id, Dataset pixels_bin2_id, Dataset pixels_count,
+              std::size_t num_threads);
+
+  PixelWriter(const PixelWriter &other) = delete;
+  PixelWriter(PixelWriter &&other) = default;
+  ~PixelWriter() = default;
+
+  PixelWriter &operator=(const PixelWriter &other) = delete;
+  PixelWriter &operator=(PixelWriter &&other) = default;
+
+  // Throws std::runtime_error when N does not match the type of the count dataset
+  template <typename N>
+  void append(std::uint64_t bin1_id, std::uint64_t bin2_id, N count);
+
+  // Write all buffered pixels (including incomplete chunks) and resize datasets accordingly
+  void flush();
+
+  [[nodiscard]] std::size_t size() const noexcept;
+  [[nodiscard]] bool empty() const noexcept;
+  [[nodiscard]] std::uint64_t last_bin1_id() const noexcept;
+  [[nodiscard]] std::size_t num_threads() const noexcept;
+  // Bytes held by the staging areas and by the chunks waiting to be written. Chunks being encoded
+  // are accounted for using their size before compression
+  [[nodiscard]] std::size_t memory_usage() const noexcept;
+
+ private:
+  template <typename T>
+  void validate_type(std::size_t column) const;
+  template <typename T>
+  void append(std::size_t column, T value);
+
+  void submit_chunk(std::size_t column, bool pad);
+  void write_chunks(std::size_t max_pending);
+  void write_front_chunk();
+
+  [[nodiscard]] static std::vector<std::uint8_t> encode_chunk(const ChunkLayout &layout,
+                                                              std::size_t type_size,
+                                                              std::vector<std::uint8_t> raw);
+};
+
+}  // namespace coolerpp::internal
+
+#include "../../../pixel_writer_impl.hpp"
@@ -0,0 +1,51 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace coolerpp::internal {
+
+// Fixed-size pool of threads running queued tasks in FIFO order.
+// Used by File::fetch_async() to keep many queries in flight using a handful of threads.
+// The destructor runs all queued tasks before joining the worker threads
+class QueryPool {
+  std::vector<std::thread> _threads{};
+  std::deque<std::function<void()>> _tasks{};
+  std::mutex _mtx{};
+  std::condition_variable _cv{};
+  bool _stop{false};
+
+ public:
+  explicit QueryPool(std::size_t num_threads);
+
+  QueryPool(const QueryPool &other) = delete;
+  QueryPool(QueryPool &&other) = delete;
+  ~QueryPool() noexcept;
+
+  QueryPool &operator=(const QueryPool &other) = delete;
+  QueryPool &operator=(QueryPool &&other) = delete;
+
+  // Queue task for execution. Exceptions thrown by task are stored in the returned future
+  template <typename Task>
+  [[nodiscard]] auto submit(Task task) -> std::future<std::invoke_result_t<Task>>;
+
+  [[nodiscard]] std::size_t num_threads() const noexcept;
+
+ private:
+  void run();
+};
+
+}  // namespace coolerpp::internal
+
+#include "../../../query_pool_impl.hpp"
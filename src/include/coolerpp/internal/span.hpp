@@ -0,0 +1,46 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+
+namespace coolerpp::internal {
+
+// Minimal replacement for std::span (C++20): a non-owning view over a contiguous range of values
+template <typename T>
+class Span {
+  const T *_data{};
+  std::size_t _size{};
+
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using const_pointer = const T *;
+  using const_reference = const T &;
+  using iterator = const T *;
+  using const_iterator = const T *;
+
+  constexpr Span() = default;
+  constexpr Span(const T *data_, std::size_t size_) noexcept : _data(data_), _size(size_) {}
+
+  [[nodiscard]] constexpr const T *data() const noexcept { return this->_data; }
+  [[nodiscard]] constexpr std::size_t size() const noexcept { return this->_size; }
+  [[nodiscard]] constexpr bool empty() const noexcept { return this->_size == 0; }
+
+  [[nodiscard]] constexpr const T &operator[](std::size_t i) const noexcept {
+    assert(i < this->_size);
+    return this->_data[i];  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  }
+  [[nodiscard]] constexpr const T &front() const noexcept { return (*this)[0]; }
+  [[nodiscard]] constexpr const T &back() const noexcept { return (*this)[this->_size - 1]; }
+
+  [[nodiscard]] constexpr auto begin() const noexcept -> const_iterator { return this->_data; }
+  [[nodiscard]] constexpr auto end() const noexcept -> const_iterator {
+    return this->_data + this->_size;  // NOLINT(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  }
+};
+
+}  // namespace coolerpp::internal
@@ -0,0 +1,77 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <tsl/hopscotch_map.h>
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "coolerpp/balancing.hpp"
+
+namespace coolerpp::internal {
+
+// Process-wide cache of the weights read by File::read_weights().
+// Entries are keyed by the canonical path to the .cool file, the path to the weight dataset and
+// the weight type and precision, so that File objects opening the same URI share the same Weights.
+// The cache only holds weak references: weights are released as soon as the last File or
+// Balancer referencing them is destroyed.
+// Each entry has its own mutex, so that weights are read once even when multiple threads request
+// the same weights concurrently, while reads of different weights proceed in parallel.
+// When libhdf5 was not built with thread-safety enabled, reads of different weights are
+// serialized using a cache-wide I/O lock
+class WeightCache {
+  struct Entry {
+    std::mutex mtx{};
+    std::weak_ptr<const Weights> weights{};
+  };
+  using EntryMap = tsl::hopscotch_map<std::string, std::shared_ptr<Entry>>;
+
+  std::mutex _mtx{};
+  std::mutex _io_mtx{};
+  EntryMap _entries{};
+
+  WeightCache() = default;
+
+ public:
+  WeightCache(const WeightCache& other) = delete;
+  WeightCache(WeightCache&& other) = delete;
+  ~WeightCache() = default;
+  WeightCache& operator=(const WeightCache& other) = delete;
+  WeightCache& operator=(WeightCache&& other) = delete;
+
+  [[nodiscard]] static WeightCache& instance();
+
+  // Return the cached weights or read them by calling loader()
+  template <typename WeightLoader>
+  [[nodiscard]] std::shared_ptr<const Weights> get_or_load(std::string_view file_path,
+                                                           std::string_view dset_path,
+                                                           Weights::Type type,
+                                                           Weights::Precision precision,
+                                                           WeightLoader loader);
+  // Remove all entries referring to the given dataset. Weights that are still referenced by
+  // File or Balancer objects are not affected
+  void erase(std::string_view file_path, std::string_view dset_path);
+  void clear();
+
+  [[nodiscard]] std::size_t size();
+
+ private:
+  [[nodiscard]] static std::string make_prefix(std::string_view file_path,
+                                               std::string_view dset_path);
+  [[nodiscard]] static std::string make_key(std::string_view file_path,
+                                            std::string_view dset_path, Weights::Type type,
+                                            Weights::Precision precision);
+  // Remove entries whose weights have expired.
+  // This is required to avoid accumulating entries when reading weights from many files
+  void purge_expired_entries();
+};
+
+}  // namespace coolerpp::internal
+
+#include "../../../weight_cache_impl.hpp"
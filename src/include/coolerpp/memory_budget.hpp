@@ -0,0 +1,127 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace coolerpp {
+
+// Memory held by the components of a File (see File::memory_usage())
+struct FileMemoryUsage {
+  // Sum of the chunk cache sizes of all datasets. libhdf5 fills chunk caches as chunks are read,
+  // so this is the maximum amount of memory used by chunk caches
+  std::size_t hdf5_chunk_caches{};
+  std::size_t index{};
+  std::size_t bin_table{};
+  // Weights and bin marginals read through the file. Weights are shared by all files opening the
+  // same URI (see File::read_weights()), so they may be accounted for by multiple files
+  std::size_t weights{};
+  // Pixels buffered by the background pixel writer (see WriterOptions::threads) and buffers used to
+  // compute bin marginals (see WriterOptions::compute_bin_marginals)
+  std::size_t write_buffers{};
+
+  [[nodiscard]] std::size_t total() const noexcept;
+};
+
+namespace internal {
+
+// Amount of memory accounted for by MemoryBudget until the reservation is destroyed
+class MemoryReservation {
+  std::atomic<std::size_t> *_counter{};
+  std::size_t _size_bytes{};
+
+ public:
+  MemoryReservation(std::atomic<std::size_t> &counter, std::size_t size_bytes) noexcept;
+  MemoryReservation(const MemoryReservation &other) = delete;
+  MemoryReservation(MemoryReservation &&other) noexcept = delete;
+  ~MemoryReservation() noexcept;
+
+  MemoryReservation &operator=(const MemoryReservation &other) = delete;
+  MemoryReservation &operator=(MemoryReservation &&other) noexcept = delete;
+
+  [[nodiscard]] std::size_t size() const noexcept;
+};
+
+}  // namespace internal
+
+// Process-wide memory budget shared by the HDF5 chunk caches of all open datasets, by ChunkCache
+// and by the pools of buffers used by Dataset::iterator (see internal::BufferPool).
+// When a file is opened or created, the chunk cache size requested through CacheOptions (or
+// cache_size_bytes) is shrunk to what is left of the budget. Before shrinking chunk caches, the
+// least recently used blocks are evicted from ChunkCache and idle buffers are released by buffer
+// pools (each thread releases the idle buffers of its pools the next time it acquires a buffer).
+// The budget is soft: each dataset always caches at least one chunk, and chunk caches cannot be
+// resized once a dataset is open, so usage can exceed the limit when too many files are open.
+// Lowering the limit only affects files opened afterwards.
+// The budget is disabled when its limit is 0 (the default). Buffers and cached blocks are
+// accounted for regardless, while HDF5 chunk caches are only accounted for when the datasets
+// owning them are opened while the budget is enabled
+class MemoryBudget {
+ public:
+  struct Usage {
+    std::size_t limit_bytes{};
+    // Sum of the chunk cache sizes of all open datasets
+    std::size_t hdf5_chunk_caches{};
+    // Blocks cached by ChunkCache
+    std::size_t chunk_cache{};
+    // Buffers tracked by the buffer pools of all threads, including those currently in use
+    std::size_t buffer_pools{};
+
+    [[nodiscard]] std::size_t total() const noexcept;
+  };
+
+ private:
+  std::atomic<std::size_t> _limit_bytes{};
+  std::atomic<std::size_t> _hdf5_chunk_caches{};
+  std::atomic<std::size_t> _buffer_pools{};
+  // Incremented every time pools are asked to release their idle buffers
+  std::atomic<std::uint64_t> _trim_epoch{};
+  std::mutex _trim_mtx{};
+
+  MemoryBudget() = default;
+
+ public:
+  MemoryBudget(const MemoryBudget &other) = delete;
+  MemoryBudget(MemoryBudget &&other) = delete;
+  ~MemoryBudget() = default;
+  MemoryBudget &operator=(const MemoryBudget &other) = delete;
+  MemoryBudget &operator=(MemoryBudget &&other) = delete;
+
+  [[nodiscard]] static MemoryBudget &instance();
+
+  // Lowering the limit releases memory held by ChunkCache and buffer pools (see trim())
+  void set_limit(std::size_t limit_bytes);
+  [[nodiscard]] std::size_t limit() const noexcept;
+  [[nodiscard]] bool enabled() const noexcept;
+
+  [[nodiscard]] Usage usage() const;
+  // Bytes left before reaching the limit. Returns the largest std::size_t when the budget is
+  // disabled
+  [[nodiscard]] std::size_t available() const;
+
+  // Return how much memory can be given to chunk caches asking for requested_bytes, trimming
+  // process-wide caches first when the budget is under pressure
+  [[nodiscard]] std::size_t grant(std::size_t requested_bytes);
+  // Account for size_bytes bytes until the returned reservation is destroyed
+  [[nodiscard]] auto reserve(std::size_t size_bytes)
+      -> std::shared_ptr<const internal::MemoryReservation>;
+
+  // Evict blocks from ChunkCache until usage fits within the limit, and ask buffer pools to
+  // release their idle buffers
+  void trim();
+
+  // Used by internal::BufferPool to report the buffers it tracks
+  void add_pooled_bytes(std::size_t size_bytes) noexcept;
+  void remove_pooled_bytes(std::size_t size_bytes) noexcept;
+  [[nodiscard]] std::uint64_t trim_epoch() const noexcept;
+};
+
+}  // namespace coolerpp
+
+#include "../../memory_budget_impl.hpp"
@@ -0,0 +1,45 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <highfive/H5File.hpp>
+#include <highfive/H5PropertyList.hpp>
+#include <string_view>
+#include <vector>
+
+#include "coolerpp/common.hpp"
+
+namespace coolerpp {
+
+// Keep the HDF5 file backing a Cooler in memory using the core virtual file driver of libhdf5.
+// Files kept in memory are never read from or written to disk unless backing_store is true, in
+// which case the memory image is written to the file path of the URI when the file is closed
+struct InMemoryOptions {
+  // Size of the increments by which the memory image grows
+  std::size_t increment_bytes{DEFAULT_IN_MEMORY_INCREMENT};
+  bool backing_store{false};
+};
+
+namespace internal {
+
+[[nodiscard]] HighFive::FileAccessProps init_in_memory_file_access_props(
+    const InMemoryOptions &options);
+
+// Create a new file in memory. Existing files at path are ignored (and overwritten when
+// options.backing_store is true)
+[[nodiscard]] HighFive::File create_file_in_memory(std::string_view path,
+                                                   const InMemoryOptions &options);
+// Open the HDF5 file image stored in buff in read-only mode. The image is copied, so buff can be
+// released once the file has been opened. Each image is given a unique name
+[[nodiscard]] HighFive::File open_file_image(const void *buff, std::size_t size);
+// Return a copy of the image of the given file. The file should have been flushed
+[[nodiscard]] std::vector<std::byte> read_file_image(const HighFive::File &f);
+
+}  // namespace internal
+
+}  // namespace coolerpp
+
+#include "../../memory_file_impl.hpp"
@@ -0,0 +1,97 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "coolerpp/common.hpp"
+#include "coolerpp/coolerpp.hpp"
+#include "coolerpp/pixel.hpp"
+#include "coolerpp/pixel_selector.hpp"
+
+namespace coolerpp {
+
+// Pixel joined across multiple files: counts[i] is the count read from the i-th file
+template <typename N>
+struct MultiPixel {
+  std::uint64_t bin1_id{};
+  std::uint64_t bin2_id{};
+  std::vector<N> counts{};
+
+  [[nodiscard]] bool operator==(const MultiPixel<N> &other) const noexcept;
+  [[nodiscard]] bool operator!=(const MultiPixel<N> &other) const noexcept;
+};
+
+// Run the same query against a collection of files sharing the same bin table (e.g. replicates or
+// time points), and join the pixels overlapping the query by their coordinates.
+// Files are queried by up to num_threads threads (0 = use all available cores), and are queried
+// one at a time on the calling thread when libhdf5 is not thread-safe.
+// Pixels read from each file are joined using a loser tree (see internal::LoserTree), so that
+// advancing the join requires log2(k) integer comparisons per pixel.
+// All pixels overlapping the query are read from every file before they are joined: memory usage
+// is thus proportional to the total number of pixels overlapping the query across all files.
+// When fill_zero is true, a row is produced for every pixel stored in at least one file, and counts
+// from files not storing the pixel are set to 0. When fill_zero is false, only pixels stored in all
+// files are produced.
+// As with PixelSelector, files should outlive the selector
+template <typename N, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
+class MultiFileSelector {
+  static_assert(std::is_arithmetic_v<N>);
+
+  std::vector<PixelSelector<N, CHUNK_SIZE>> _selectors{};
+  std::vector<bool> _symmetric_upper{};
+  bool _fill_zero{true};
+  std::size_t _num_threads{1};
+
+ public:
+  MultiFileSelector() = delete;
+  MultiFileSelector(const std::vector<File> &files, std::string_view query,
+                    File::QUERY_TYPE query_type = File::QUERY_TYPE::UCSC, bool fill_zero = true,
+                    std::size_t num_threads = 1);
+  MultiFileSelector(const std::vector<File> &files, std::string_view range1,
+                    std::string_view range2,
+                    File::QUERY_TYPE query_type = File::QUERY_TYPE::UCSC, bool fill_zero = true,
+                    std::size_t num_threads = 1);
+
+  [[nodiscard]] std::size_t num_files() const noexcept;
+  [[nodiscard]] bool fill_zero() const noexcept;
+  [[nodiscard]] std::size_t num_threads() const noexcept;
+
+  [[nodiscard]] const PixelCoordinates &coord1() const noexcept;
+  [[nodiscard]] const PixelCoordinates &coord2() const noexcept;
+  // Shape of the matrices written by fetch_dense()
+  [[nodiscard]] std::uint64_t num_rows() const noexcept;
+  [[nodiscard]] std::uint64_t num_cols() const noexcept;
+
+  // Visit joined pixels in blocks of up to max_block_size pixels.
+  // op is called with three vectors storing bin1_ids, bin2_ids and counts respectively.
+  // Counts are stored in row-major order, with num_files() counts for each pixel
+  template <typename BlockOp>
+  void for_each_block(BlockOp op, std::size_t max_block_size = CHUNK_SIZE) const;
+  [[nodiscard]] std::vector<MultiPixel<N>> read_all() const;
+
+  // Write one dense matrix per file to the caller-provided buffer out.
+  // Matrices have num_rows() rows and num_cols() columns, and are stored in row-major order with
+  // rows being ld values apart (ld should be >= num_cols()). The matrix for the i-th file starts
+  // at out + (i * num_rows() * ld).
+  // For cis queries (i.e. when range1 and range2 are the same), values below the diagonal are
+  // filled by mirroring the upper triangle of files using the symmetric-upper storage mode
+  void fetch_dense(N *out, std::size_t ld) const;
+
+ private:
+  MultiFileSelector(const std::vector<File> &files, bool fill_zero, std::size_t num_threads);
+
+  // Read all pixels overlapping the query from every file. Pixels are materialized in memory, so
+  // that files can be queried in parallel
+  [[nodiscard]] std::vector<std::vector<PixelBlock<N>>> read_files() const;
+};
+
+}  // namespace coolerpp
+
+#include "../../multi_file_selector_impl.hpp"
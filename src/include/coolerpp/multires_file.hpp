@@ -0,0 +1,77 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// clang-format off
+#include "coolerpp/internal/suppress_warnings.hpp"
+// clang-format on
+DISABLE_WARNING_PUSH
+DISABLE_WARNING_NULL_DEREF
+#include <highfive/H5File.hpp>
+DISABLE_WARNING_POP
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "coolerpp/common.hpp"
+#include "coolerpp/coolerpp.hpp"
+
+namespace coolerpp {
+
+// Read-only view over the resolutions stored in a .mcool file.
+// The underlying HDF5 file is opened (and validated) only once, and all resolutions share the same
+// file handle. Resolutions are opened the first time they are requested and are then cached for
+// the lifetime of the MultiResFile, so that calling open() repeatedly is cheap.
+// Opening resolutions is not thread-safe.
+class MultiResFile {
+  std::unique_ptr<HighFive::File> _fp{};
+  std::vector<std::uint32_t> _resolutions{};
+  mutable std::vector<std::unique_ptr<const File>> _coolers{};
+  std::size_t _cache_size_bytes{DEFAULT_HDF5_CACHE_SIZE};
+  bool _validate{true};
+
+  MultiResFile(HighFive::File fp, std::size_t cache_size_bytes, bool validate);
+
+ public:
+  MultiResFile() = default;
+  MultiResFile(const MultiResFile &other) = delete;
+  MultiResFile(MultiResFile &&other) noexcept = default;
+  ~MultiResFile() = default;
+
+  MultiResFile &operator=(const MultiResFile &other) = delete;
+  MultiResFile &operator=(MultiResFile &&other) noexcept = default;
+
+  [[nodiscard]] static MultiResFile open_read_only(
+      std::string_view path, std::size_t cache_size_bytes = DEFAULT_HDF5_CACHE_SIZE,
+      bool validate = true);
+
+  [[nodiscard]] explicit operator bool() const noexcept;
+  [[nodiscard]] std::string path() const;
+
+  // Resolutions are sorted in ascending order
+  [[nodiscard]] auto resolutions() const noexcept -> const std::vector<std::uint32_t> &;
+  [[nodiscard]] bool has_resolution(std::uint32_t resolution) const noexcept;
+
+  // The returned reference remains valid until the MultiResFile is closed or destroyed
+  [[nodiscard]] const File &open(std::uint32_t resolution) const;
+
+  // Fetch a tile using the tile index of the cooler at the given zoom level (see
+  // File::fetch_tile()). Zoom levels are numbered starting from the coarsest resolution (zoom 0)
+  template <typename N>
+  [[nodiscard]] std::vector<ThinPixel<N>> fetch_tile(std::uint32_t zoom, std::uint64_t x,
+                                                     std::uint64_t y) const;
+  void close();
+
+ private:
+  [[nodiscard]] static auto read_resolutions(const HighFive::File &fp)
+      -> std::vector<std::uint32_t>;
+  [[nodiscard]] std::size_t resolution_idx(std::uint32_t resolution) const;
+};
+
+}  // namespace coolerpp
+
+#include "../../multires_file_impl.hpp"
@@ -35,6 +35,36 @@ struct PixelCoordinates {
   [[nodiscard]] bool operator>=(const PixelCoordinates &other) const noexcept;
 };
 
+// Compact representation of a pixel that only stores bin ids and the count.
+// Unlike Pixel<N>, ThinPixel<N> is trivially copyable and can be produced without looking up bins
+// in the BinTable (see PixelSelector::thin_iterator).
+// Counts narrower than bin ids are padded to their alignment: ThinPixel<std::int32_t> takes 24
+// bytes on 64-bit platforms
+template <typename N>
+struct ThinPixel {
+  static_assert(std::is_arithmetic_v<N>);
+
+  std::uint64_t bin1_id{};
+  std::uint64_t bin2_id{};
+  N count{};
+
+  [[nodiscard]] constexpr bool operator==(const ThinPixel<N> &other) const noexcept;
+  [[nodiscard]] constexpr bool operator!=(const ThinPixel<N> &other) const noexcept;
+  [[nodiscard]] constexpr bool operator<(const ThinPixel<N> &other) const noexcept;
+  [[nodiscard]] constexpr bool operator<=(const ThinPixel<N> &other) const noexcept;
+  [[nodiscard]] constexpr bool operator>(const ThinPixel<N> &other) const noexcept;
+  [[nodiscard]] constexpr bool operator>=(const ThinPixel<N> &other) const noexcept;
+};
+
+template <typename T>
+struct is_thin_pixel : std::false_type {};
+
+template <typename N>
+struct is_thin_pixel<ThinPixel<N>> : std::true_type {};
+
+template <typename T>
+inline constexpr bool is_thin_pixel_v = is_thin_pixel<std::remove_cv_t<T>>::value;
+
 template <typename N>
 struct Pixel {
   static_assert(std::is_arithmetic_v<N>);
@@ -52,6 +82,9 @@ struct Pixel {
 
   Pixel(const BinTable &bins, std::uint64_t bin1_id, std::uint64_t bin2_id, N count_ = 0);
   Pixel(const BinTable &bins, std::uint64_t bin_id, N count_ = 0);
+  Pixel(const BinTable &bins, const ThinPixel<N> &p);
+
+  [[nodiscard]] ThinPixel<N> to_thin() const noexcept;
 
   [[nodiscard]] explicit operator bool() const noexcept;
   [[nodiscard]] bool operator==(const Pixel<N> &other) const noexcept;
@@ -74,6 +107,13 @@ struct fmt::formatter<coolerpp::PixelCoordinates> {
   auto format(const coolerpp::PixelCoordinates &c, FormatContext &ctx) const -> decltype(ctx.out());
 };
 
+template <typename N>
+struct fmt::formatter<coolerpp::ThinPixel<N>> {
+  constexpr auto parse(format_parse_context &ctx) -> decltype(ctx.begin());
+  template <typename FormatContext>
+  auto format(const coolerpp::ThinPixel<N> &p, FormatContext &ctx) const -> decltype(ctx.out());
+};
+
 template <typename N>
 struct fmt::formatter<coolerpp::Pixel<N>> {
   enum Presentation { bg2, raw };
@@ -0,0 +1,88 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/format.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "coolerpp/bin_table.hpp"
+#include "coolerpp/pixel.hpp"
+
+namespace coolerpp::io {
+
+/// BG2: chrom1 start1 end1 chrom2 start2 end2 count (same as formatting pixels with {:bg2})
+/// RAW: bin1_id bin2_id count (same as formatting pixels with {:raw})
+/// BINARY: fixed-size records consisting of bin1_id and bin2_id (as std::uint64_t) followed by
+///         count (as std::int64_t for integral counts and as double otherwise), stored in native
+///         byte order
+enum class OutputFormat { BG2, RAW, BINARY };
+
+/// Write pixels to a file (or stdout) using large buffered writes.
+/// Pixels are formatted into a reusable memory buffer that is flushed once it grows larger than
+/// buffer_size. Chromosome names are formatted once and then copied into the buffer
+class PixelFileWriter {
+  struct FileCloser {
+    void operator()(std::FILE* fp) const noexcept;
+  };
+
+  std::unique_ptr<std::FILE, FileCloser> _fp{};
+  std::string _path{};
+  const BinTable* _bins{};
+  OutputFormat _format{};
+  fmt::memory_buffer _buffer{};
+  std::size_t _buffer_size{};
+
+  // Chromosome names followed by a tab, indexed by chromosome id
+  std::vector<std::string> _chrom_prefixes{};
+
+ public:
+  static constexpr std::size_t DEFAULT_BUFFER_SIZE = 4ULL << 20U;  // 4 MiB
+
+  PixelFileWriter() = delete;
+  /// When path is "-" pixels are written to stdout. bins is only used by write() overloads
+  /// taking bin ids when format is BG2
+  PixelFileWriter(std::string_view path, const BinTable& bins,
+                  OutputFormat format = OutputFormat::BG2,
+                  std::size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+  PixelFileWriter(const PixelFileWriter& other) = delete;
+  PixelFileWriter(PixelFileWriter&& other) noexcept = default;
+  /// Pending data is flushed. Call flush() explicitly to detect write errors
+  ~PixelFileWriter() noexcept;
+
+  PixelFileWriter& operator=(const PixelFileWriter& other) = delete;
+  PixelFileWriter& operator=(PixelFileWriter&& other) noexcept = default;
+
+  [[nodiscard]] auto format() const noexcept -> OutputFormat;
+
+  template <typename N>
+  void write(const Pixel<N>& pixel);
+  template <typename N>
+  void write(const ThinPixel<N>& pixel);
+  template <typename N>
+  void write(std::uint64_t bin1_id, std::uint64_t bin2_id, N count);
+  template <typename PixelIt>
+  void write(PixelIt first_pixel, PixelIt last_pixel);
+
+  void flush();
+
+ private:
+  void write_bin(const Bin& bin);
+  template <typename N>
+  void write_count(N count);
+  void write_binary(std::uint64_t bin1_id, std::uint64_t bin2_id, const void* count,
+                    std::size_t count_size);
+  void maybe_flush();
+};
+
+}  // namespace coolerpp::io
+
+#include "../../pixel_output_impl.hpp"
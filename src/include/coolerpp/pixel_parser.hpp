@@ -0,0 +1,119 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "coolerpp/bin_table.hpp"
+#include "coolerpp/chromosome.hpp"
+
+namespace coolerpp::io {
+
+/// BG2: chrom1 start1 end1 chrom2 start2 end2 count
+/// COO: bin1_id bin2_id count
+/// VALIDPAIRS: read_id chrom1 pos1 strand1 chrom2 pos2 strand2 ... (HiC-Pro, 1-based positions).
+///             Each line is counted as one interaction
+/// Fields are tab-separated. Empty lines and lines starting with '#' are ignored
+enum class PixelFormat { BG2, COO, VALIDPAIRS };
+
+[[nodiscard]] PixelFormat parse_pixel_format(std::string_view format);
+
+/// Pixels stored in columnar form, ready to be passed to File::append_pixels_columns() or
+/// utils::PixelSorter::add()
+template <typename N>
+struct PixelBatch {
+  std::vector<std::uint64_t> bin1_ids{};
+  std::vector<std::uint64_t> bin2_ids{};
+  std::vector<N> counts{};
+
+  [[nodiscard]] std::size_t size() const noexcept;
+  [[nodiscard]] bool empty() const noexcept;
+  void clear() noexcept;
+  void reserve(std::size_t capacity);
+};
+
+/// Parse interactions from a text file into bin ids.
+/// Input is read in large blocks and lines and fields are located with memchr (which is
+/// vectorized by all major libc implementations). Numbers are parsed with from_chars and only the
+/// chromosomes that changed since the previous line are looked up in the ChromosomeSet.
+/// Pixels are mapped to the upper triangle of the matrix (i.e. bin1_id <= bin2_id), but are
+/// otherwise returned in the same order as they appear in the input
+template <typename N>
+class PixelParser {
+  struct FileCloser {
+    void operator()(std::FILE* fp) const noexcept;
+  };
+
+  std::unique_ptr<std::FILE, FileCloser> _fp{};
+  std::string _path{};
+  const BinTable* _bins{};
+  PixelFormat _format{};
+
+  std::vector<char> _buffer{};
+  std::size_t _begin{};
+  std::size_t _end{};
+  bool _eof{false};
+  std::size_t _line_number{};
+
+  // Chromosomes seen on the previous line, used to skip hash table lookups
+  const Chromosome* _chrom1{};
+  const Chromosome* _chrom2{};
+
+ public:
+  static constexpr std::size_t DEFAULT_BUFFER_SIZE = 32ULL << 20U;  // 32 MiB
+
+  PixelParser() = delete;
+  /// When path is "-" interactions are read from stdin
+  PixelParser(std::string_view path, const BinTable& bins, PixelFormat format,
+              std::size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+  PixelParser(const PixelParser& other) = delete;
+  PixelParser(PixelParser&& other) noexcept = default;
+  ~PixelParser() noexcept = default;
+
+  PixelParser& operator=(const PixelParser& other) = delete;
+  PixelParser& operator=(PixelParser&& other) noexcept = default;
+
+  [[nodiscard]] auto format() const noexcept -> PixelFormat;
+  [[nodiscard]] std::size_t line_number() const noexcept;
+
+  /// Parse up to max_pixels pixels and append them to batch. Return the number of pixels that
+  /// were parsed: 0 means that the input has been exhausted
+  std::size_t read_batch(PixelBatch<N>& batch, std::size_t max_pixels);
+
+  /// Call op(const PixelBatch<N>&) for every batch of up to batch_size pixels until the input has
+  /// been exhausted.
+  /// When async is true, the next batch is parsed on a separate thread while op is being called
+  /// on the calling thread, so it is safe to write to a File from op
+  template <typename BatchOp>
+  void for_each_batch(BatchOp op, std::size_t batch_size = 1'000'000, bool async = true);
+
+ private:
+  // Return false when the input has been exhausted
+  [[nodiscard]] bool next_line(std::string_view& line);
+  [[nodiscard]] bool fill_buffer();
+
+  void parse_line(std::string_view line, PixelBatch<N>& batch);
+  void parse_bg2(std::string_view line, PixelBatch<N>& batch);
+  void parse_coo(std::string_view line, PixelBatch<N>& batch);
+  void parse_validpairs(std::string_view line, PixelBatch<N>& batch);
+
+  [[nodiscard]] const Chromosome& find_chromosome(std::string_view name,
+                                                  const Chromosome*& hint) const;
+  [[nodiscard]] std::uint64_t map_to_bin_id(const Chromosome& chrom, std::uint32_t pos) const;
+  static void push_back(PixelBatch<N>& batch, std::uint64_t bin1_id, std::uint64_t bin2_id,
+                        N count);
+
+  [[nodiscard]] static std::string_view next_field(std::string_view& line);
+};
+
+}  // namespace coolerpp::io
+
+#include "../../pixel_parser_impl.hpp"
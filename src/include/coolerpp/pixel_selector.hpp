@@ -5,24 +5,87 @@
 #pragma once
 
 #include <cstdint>
+#include <iterator>
+#include <limits>
+#include <map>
 #include <memory>
+#include <optional>
 #include <type_traits>
+#include <vector>
 
 #include "coolerpp/common.hpp"
 #include "coolerpp/dataset.hpp"
+#include "coolerpp/internal/span.hpp"
 #include "coolerpp/pixel.hpp"
+#include "coolerpp/sparse_matrix.hpp"
 
 namespace coolerpp {
 
 class BinTable;
 class Index;
 
+enum class ContactType : std::uint_fast8_t { ALL, CIS, TRANS };
+
+// Predicates evaluated by PixelSelector directly on the values read from pixels/bin1_id,
+// pixels/bin2_id and pixels/count, before pixels are materialized.
+// Iterators over trans pixels skip the cis block of each row by jumping past the last bin of the
+// chromosome of the row, while iterators over cis pixels jump to the next row as soon as they
+// reach the first trans pixel of a row
+struct PixelFilter {
+  // Only select pixels with at least min_count interactions
+  std::optional<double> min_count{};
+  ContactType contact_type{ContactType::ALL};
+
+  [[nodiscard]] constexpr bool empty() const noexcept {
+    return !this->min_count.has_value() && this->contact_type == ContactType::ALL;
+  }
+};
+
+// A block of contiguous pixels in columnar form.
+// Views returned by bin1_ids(), bin2_ids() and counts() point directly into the chunks read by
+// Dataset::iterator: no data is copied, and chunks are kept alive for as long as the block exists
+template <typename N>
+class PixelBlock {
+  static_assert(std::is_arithmetic_v<N>);
+  using BinIDT = std::uint64_t;
+
+  std::shared_ptr<const std::vector<BinIDT>> _bin1_buff{};
+  std::shared_ptr<const std::vector<BinIDT>> _bin2_buff{};
+  std::shared_ptr<const std::vector<N>> _count_buff{};
+
+  internal::Span<BinIDT> _bin1_ids{};
+  internal::Span<BinIDT> _bin2_ids{};
+  internal::Span<N> _counts{};
+
+  std::shared_ptr<const Index> _index{};
+
+ public:
+  PixelBlock() = default;
+  PixelBlock(std::shared_ptr<const Index> index,
+             std::shared_ptr<const std::vector<BinIDT>> bin1_buff, std::size_t bin1_offset,
+             std::shared_ptr<const std::vector<BinIDT>> bin2_buff, std::size_t bin2_offset,
+             std::shared_ptr<const std::vector<N>> count_buff, std::size_t count_offset,
+             std::size_t size) noexcept;
+
+  [[nodiscard]] std::size_t size() const noexcept;
+  [[nodiscard]] bool empty() const noexcept;
+
+  [[nodiscard]] auto bin1_ids() const noexcept -> internal::Span<BinIDT>;
+  [[nodiscard]] auto bin2_ids() const noexcept -> internal::Span<BinIDT>;
+  [[nodiscard]] auto counts() const noexcept -> internal::Span<N>;
+
+  // Materialize the i-th pixel
+  [[nodiscard]] Pixel<N> operator[](std::size_t i) const;
+  [[nodiscard]] Pixel<N> at(std::size_t i) const;
+};
+
 template <typename N, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
 class PixelSelector {
   static_assert(std::is_arithmetic_v<N>);
 
  public:
   class iterator;
+  class thin_iterator;
 
  private:
   PixelCoordinates _coord1{};
@@ -31,6 +94,9 @@ class PixelSelector {
   const Dataset *_pixels_bin1_id{};
   const Dataset *_pixels_bin2_id{};
   const Dataset *_pixels_count{};
+  bool _prefetch{false};
+  std::uint64_t _max_diagonal_distance{(std::numeric_limits<std::uint64_t>::max)()};
+  PixelFilter _filter{};
 
  public:
   PixelSelector() = delete;
@@ -55,12 +121,47 @@ class PixelSelector {
   [[nodiscard]] auto cbegin() const -> iterator;
   [[nodiscard]] auto cend() const -> iterator;
 
+  // Iterate over pixels as ThinPixel<N>, without looking up their bins in the BinTable
+  [[nodiscard]] auto begin_thin() const -> thin_iterator;
+  [[nodiscard]] auto end_thin() const -> thin_iterator;
+
   [[nodiscard]] const PixelCoordinates &coord1() const noexcept;
   [[nodiscard]] const PixelCoordinates &coord2() const noexcept;
 
+  // When enabled, iterators read the next chunk of pixels in the background while the current
+  // chunk is being consumed. Requires direct reads (see CacheOptions::direct_pixel_reads) or HDF5
+  // to be built with thread-safety enabled (see Dataset::begin())
+  void enable_prefetch(bool flag = true) noexcept;
+  [[nodiscard]] bool prefetch_enabled() const noexcept;
+
+  // Only select pixels whose bins are at most num_bins bins apart (i.e. pixels overlapping a band
+  // centered on the matrix diagonal). Trans pixels never overlap the band. Iterators skip the
+  // remainder of a row as soon as they move past the band, jumping to the next row through the
+  // Index without reading any of the pixels in between
+  void set_max_diagonal_distance(std::uint64_t num_bins) noexcept;
+  [[nodiscard]] std::uint64_t max_diagonal_distance() const noexcept;
+
+  // Only select pixels passing filter (see PixelFilter)
+  void set_filter(PixelFilter filter) noexcept;
+  [[nodiscard]] const PixelFilter &filter() const noexcept;
+
+  // Visit pixels overlapping the query in blocks of up to max_block_size pixels
+  template <typename BlockOp>
+  void for_each_block(BlockOp op, std::size_t max_block_size = CHUNK_SIZE) const;
+  [[nodiscard]] auto read_batch(std::size_t max_block_size = CHUNK_SIZE) const
+      -> std::vector<PixelBlock<N>>;
+
+  // Read pixels overlapping the query into a CSR matrix covering the rows of coord1 and the columns
+  // of coord2 (or the entire matrix when the selector has no coordinates).
+  // Row pointers are computed from the Index, and the pixels belonging to the selected rows are
+  // read with a single Dataset::read() call for bin2_ids and counts, without going through
+  // iterators
+  [[nodiscard]] SparseMatrixCSR<N> read_csr() const;
+
   class iterator {
     using BinIDT = std::uint64_t;
     friend PixelSelector<N, CHUNK_SIZE>;
+    friend thin_iterator;
 
     Dataset::iterator<BinIDT, CHUNK_SIZE> _bin1_id_it{};
     Dataset::iterator<BinIDT, CHUNK_SIZE> _bin2_id_it{};
@@ -73,13 +174,19 @@ class PixelSelector {
     PixelCoordinates _coord2{};
 
     std::uint64_t _h5_end_offset{};
+    std::uint64_t _max_diagonal_distance{(std::numeric_limits<std::uint64_t>::max)()};
+    PixelFilter _filter{};
 
     explicit iterator(std::shared_ptr<const Index> index, const Dataset &pixels_bin1_id,
-                      const Dataset &pixels_bin2_id, const Dataset &pixels_count);
+                      const Dataset &pixels_bin2_id, const Dataset &pixels_count,
+                      bool prefetch = false, PixelFilter filter = PixelFilter{});
 
     explicit iterator(std::shared_ptr<const Index> index, const Dataset &pixels_bin1_id,
                       const Dataset &pixels_bin2_id, const Dataset &pixels_count,
-                      PixelCoordinates coord1, PixelCoordinates coord2);
+                      PixelCoordinates coord1, PixelCoordinates coord2, bool prefetch = false,
+                      std::uint64_t max_diagonal_distance =
+                          (std::numeric_limits<std::uint64_t>::max)(),
+                      PixelFilter filter = PixelFilter{});
 
     static auto at_end(std::shared_ptr<const Index> index, const Dataset &pixels_bin1_id,
                        const Dataset &pixels_bin2_id, const Dataset &pixels_count) -> iterator;
@@ -110,11 +217,21 @@ class PixelSelector {
     auto operator++() -> iterator &;
     auto operator++(int) -> iterator;
 
+    // Return the longest run of pixels starting at the current position (up to max_size pixels)
+    // that can be served without copying, then advance the iterator past the returned block
+    [[nodiscard]] auto read_block(std::size_t max_size = CHUNK_SIZE) -> PixelBlock<N>;
+    // Same as above, but the returned block never extends past last
+    [[nodiscard]] auto read_block(const iterator &last, std::size_t max_size = CHUNK_SIZE)
+        -> PixelBlock<N>;
+
    private:
     void jump_to_row(std::uint64_t bin_id);
     void jump_to_col(std::uint64_t bin_id);
-    void jump(std::uint64_t bin1_id, std::uint64_t bin2_id);
+    [[nodiscard]] std::uint64_t seek_col(std::uint64_t first_offset, std::uint64_t last_offset,
+                                         std::uint64_t bin_id) const;
     void jump_to_next_overlap();
+    // Move to the first pixel overlapping the query that also passes the filter
+    void jump_to_next_match();
 
     [[nodiscard]] std::size_t h5_offset() const noexcept;
     void jump_at_end();
@@ -123,10 +240,146 @@ class PixelSelector {
 
     [[nodiscard]] constexpr bool overlaps_coord1() const noexcept;
     [[nodiscard]] constexpr bool overlaps_coord2() const noexcept;
+    [[nodiscard]] bool overlaps_band(std::uint64_t bin1_id, std::uint64_t bin2_id) const;
 
     [[nodiscard]] bool discard() const;
+    [[nodiscard]] bool passes_filter() const;
     constexpr bool is_at_end() const noexcept;
   };
+
+  // Same as iterator, but yielding ThinPixel<N>. Pixels are assembled directly from the values
+  // read by Dataset::iterator, so dereferencing a thin_iterator never touches the BinTable
+  class thin_iterator {
+    friend PixelSelector<N, CHUNK_SIZE>;
+
+    iterator _it{};
+    mutable ThinPixel<N> _value{};
+
+    explicit thin_iterator(iterator it) noexcept;
+
+   public:
+    using difference_type = std::ptrdiff_t;
+    using value_type = ThinPixel<N>;
+    using pointer = value_type *;
+    using const_pointer = const value_type *;
+    using reference = value_type &;
+    using const_reference = const value_type &;
+    using iterator_category = std::forward_iterator_tag;
+
+    thin_iterator() = default;
+
+    [[nodiscard]] constexpr bool operator==(const thin_iterator &other) const noexcept;
+    [[nodiscard]] constexpr bool operator!=(const thin_iterator &other) const noexcept;
+
+    [[nodiscard]] constexpr bool operator<(const thin_iterator &other) const noexcept;
+    [[nodiscard]] constexpr bool operator<=(const thin_iterator &other) const noexcept;
+
+    [[nodiscard]] constexpr bool operator>(const thin_iterator &other) const noexcept;
+    [[nodiscard]] constexpr bool operator>=(const thin_iterator &other) const noexcept;
+
+    [[nodiscard]] auto operator*() const -> const_reference;
+    [[nodiscard]] auto operator->() const -> const_pointer;
+
+    auto operator++() -> thin_iterator &;
+    auto operator++(int) -> thin_iterator;
+  };
+};
+
+// UPPER_TRIANGLE: only return the pixels stored in the file
+// FULL: also return pixels below the matrix diagonal (for coolers using the symmetric-upper
+//       storage mode)
+enum class SymmetryMode : std::uint_fast8_t { UPPER_TRIANGLE, FULL };
+
+// Selector over the pixels overlapping the rows of coord1 and the columns of coord2, returned in
+// row-major order.
+// When mirror is true, pixels below the diagonal are generated from the pixels stored in the
+// upper triangle. These are read with a single scan of the upper-triangle rows overlapping either
+// range: each pixel is emitted as is when it overlaps the query, while its transpose is parked in
+// a per-row reorder buffer until the iterator reaches its row. As rows are visited in ascending
+// order, transposed pixels are appended to their row in ascending column order: rows never need
+// to be sorted
+template <typename N, std::size_t CHUNK_SIZE = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE>
+class SymmetricPixelSelector {
+  static_assert(std::is_arithmetic_v<N>);
+
+  PixelSelector<N, CHUNK_SIZE> _sel;
+  PixelCoordinates _coord1{};
+  PixelCoordinates _coord2{};
+  std::shared_ptr<const BinTable> _bins{};
+  bool _mirror{};
+
+ public:
+  template <typename PixelT>
+  class basic_iterator;
+  using iterator = basic_iterator<Pixel<N>>;
+  using thin_iterator = basic_iterator<ThinPixel<N>>;
+
+  SymmetricPixelSelector() = delete;
+  // sel should select all the pixels stored in the upper triangle that are required to answer
+  // the query
+  SymmetricPixelSelector(PixelSelector<N, CHUNK_SIZE> sel, PixelCoordinates coord1,
+                         PixelCoordinates coord2, std::shared_ptr<const BinTable> bins,
+                         bool mirror) noexcept;
+
+  [[nodiscard]] auto begin() const -> iterator;
+  [[nodiscard]] auto end() const -> iterator;
+
+  [[nodiscard]] auto begin_thin() const -> thin_iterator;
+  [[nodiscard]] auto end_thin() const -> thin_iterator;
+
+  [[nodiscard]] const PixelCoordinates &coord1() const noexcept;
+  [[nodiscard]] const PixelCoordinates &coord2() const noexcept;
+  [[nodiscard]] bool mirror() const noexcept;
+
+  template <typename PixelT>
+  class basic_iterator {
+    friend SymmetricPixelSelector<N, CHUNK_SIZE>;
+    using SourceIt = typename PixelSelector<N, CHUNK_SIZE>::thin_iterator;
+
+    SourceIt _it{};
+    SourceIt _last{};
+    std::uint64_t _first_row{};
+    std::uint64_t _last_row{};
+    std::uint64_t _first_col{};
+    std::uint64_t _last_col{};
+    bool _mirror{};
+    std::shared_ptr<const BinTable> _bins{};
+
+    // Transposed pixels waiting for the iterator to reach their row
+    std::map<std::uint64_t, std::vector<ThinPixel<N>>> _pending{};
+    std::vector<ThinPixel<N>> _row{};
+    std::size_t _i{};
+    mutable PixelT _value{};
+
+    explicit basic_iterator(const SymmetricPixelSelector &sel);
+
+   public:
+    using difference_type = std::ptrdiff_t;
+    using value_type = PixelT;
+    using pointer = value_type *;
+    using const_pointer = const value_type *;
+    using reference = value_type &;
+    using const_reference = const value_type &;
+    using iterator_category = std::input_iterator_tag;
+
+    basic_iterator() = default;
+
+    [[nodiscard]] bool operator==(const basic_iterator &other) const noexcept;
+    [[nodiscard]] bool operator!=(const basic_iterator &other) const noexcept;
+
+    [[nodiscard]] auto operator*() const -> const_reference;
+    [[nodiscard]] auto operator->() const -> const_pointer;
+
+    auto operator++() -> basic_iterator &;
+    auto operator++(int) -> basic_iterator;
+
+   private:
+    [[nodiscard]] bool is_at_end() const noexcept;
+    [[nodiscard]] bool source_exhausted() const;
+    [[nodiscard]] constexpr bool overlaps_query(std::uint64_t bin1_id,
+                                                std::uint64_t bin2_id) const noexcept;
+    void read_next_row();
+  };
 };
 
 }  // namespace coolerpp
@@ -0,0 +1,62 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <highfive/H5File.hpp>
+#include <highfive/H5PropertyList.hpp>
+#include <string>
+#include <string_view>
+
+#include "coolerpp/common.hpp"
+
+namespace coolerpp {
+
+// Options used to open files stored in object storage (e.g. AWS S3) or served over HTTP(S).
+// Remote files are opened in read-only mode through the read-only S3 virtual file driver (ROS3) of
+// libhdf5, which fetches data using HTTP range requests: opening a Cooler and running a query only
+// downloads the metadata, the index of the chromosomes overlapping the query and the pixel chunks
+// overlapping the query.
+// Chunks are cached by the chunk cache of each dataset (see CacheOptions) and, when enabled, by the
+// process-wide ChunkCache, while Dataset::iterator and PixelSelector can read ahead the next block
+// of pixels when prefetching is enabled
+struct RemoteOptions {
+  // Requests are signed using AWS Signature Version 4 only when region, secret id and secret key
+  // are all provided. Otherwise objects are accessed anonymously
+  std::string aws_region{};
+  std::string secret_id{};
+  std::string secret_key{};
+  // Size of the buffer used by libhdf5 to coalesce small reads of contiguous datasets
+  std::size_t sieve_buffer_size{DEFAULT_REMOTE_SIEVE_BUFFER_SIZE};
+
+  // Read the AWS region and credentials from the AWS_REGION (or AWS_DEFAULT_REGION),
+  // AWS_ACCESS_KEY_ID and AWS_SECRET_ACCESS_KEY environment variables
+  [[nodiscard]] static RemoteOptions from_env();
+  [[nodiscard]] bool authenticate() const noexcept;
+};
+
+// Return true when path is an s3://, http:// or https:// URL
+[[nodiscard]] bool is_remote_path(std::string_view path) noexcept;
+// Return true when libhdf5 was built with support for the ROS3 virtual file driver
+[[nodiscard]] constexpr bool ros3_available() noexcept;
+
+namespace internal {
+
+// Translate s3://bucket/key URLs into the URL of the object served by AWS S3 over HTTPS.
+// Other URLs are returned unchanged
+[[nodiscard]] std::string to_https_url(std::string_view url, std::string_view aws_region = "");
+
+[[nodiscard]] HighFive::FileAccessProps init_remote_file_access_props(
+    const RemoteOptions &options);
+
+// Open the file at path in read-only mode. Remote files are opened through ROS3
+[[nodiscard]] HighFive::File open_file_read_only(
+    std::string_view path, const RemoteOptions &options = RemoteOptions::from_env());
+
+}  // namespace internal
+
+}  // namespace coolerpp
+
+#include "../../remote_impl.hpp"
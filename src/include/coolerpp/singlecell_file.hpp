@@ -0,0 +1,105 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// clang-format off
+#include "coolerpp/internal/suppress_warnings.hpp"
+// clang-format on
+DISABLE_WARNING_PUSH
+DISABLE_WARNING_NULL_DEREF
+#include <highfive/H5File.hpp>
+#include <highfive/H5Group.hpp>
+DISABLE_WARNING_POP
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "coolerpp/bin_table.hpp"
+#include "coolerpp/chromosome.hpp"
+#include "coolerpp/common.hpp"
+#include "coolerpp/coolerpp.hpp"
+
+namespace coolerpp {
+
+// View over the cells stored in a .scool file.
+// The underlying HDF5 file is opened (and validated) only once, and the bin table stored at the
+// root of the file is shared by all cells (see bins_ptr()). Cells are opened lazily, and opening a
+// cell only reads its pixel and index datasets.
+// Files created with create() can be used as batched writers: chromosomes and bins are written
+// once at the root of the file, and the corresponding datasets of each cell are hard links to
+// them, so that adding a cell only requires creating its pixel and index datasets.
+// Opening and creating cells is not thread-safe.
+class SingleCellFile {
+  unsigned int _mode{HighFive::File::ReadOnly};
+  std::unique_ptr<HighFive::File> _fp{};
+  std::shared_ptr<const BinTable> _bins{};
+  std::vector<std::string> _cells{};
+  std::size_t _cache_size_bytes{DEFAULT_HDF5_CACHE_SIZE};
+  bool _validate{true};
+
+  SingleCellFile(HighFive::File fp, unsigned int mode, std::shared_ptr<const BinTable> bins,
+                 std::size_t cache_size_bytes, bool validate);
+
+ public:
+  SingleCellFile() = default;
+  SingleCellFile(const SingleCellFile &other) = delete;
+  SingleCellFile(SingleCellFile &&other) noexcept = default;
+  ~SingleCellFile() = default;
+
+  SingleCellFile &operator=(const SingleCellFile &other) = delete;
+  SingleCellFile &operator=(SingleCellFile &&other) noexcept = default;
+
+  [[nodiscard]] static SingleCellFile open_read_only(
+      std::string_view path, std::size_t cache_size_bytes = DEFAULT_HDF5_CACHE_SIZE,
+      bool validate = true);
+  // Create a .scool file without cells. Cells can then be added with create_cell()
+  [[nodiscard]] static SingleCellFile create(std::string_view path, const ChromosomeSet &chroms,
+                                             std::uint32_t bin_size,
+                                             bool overwrite_if_exists = false);
+
+  [[nodiscard]] explicit operator bool() const noexcept;
+  [[nodiscard]] std::string path() const;
+
+  [[nodiscard]] std::uint32_t bin_size() const noexcept;
+  [[nodiscard]] auto chromosomes() const noexcept -> const ChromosomeSet &;
+  [[nodiscard]] auto bins() const noexcept -> const BinTable &;
+  [[nodiscard]] auto bins_ptr() const noexcept -> std::shared_ptr<const BinTable>;
+
+  // Cells are sorted by name
+  [[nodiscard]] auto cells() const noexcept -> const std::vector<std::string> &;
+  [[nodiscard]] bool has_cell(std::string_view cell) const noexcept;
+
+  // Files returned by open() share the bin table of the SingleCellFile
+  [[nodiscard]] File open(std::string_view cell) const;
+
+  // Create a new cell. Pixels should be added to the returned File, and are written to disk when
+  // the File is closed or destroyed
+  template <typename PixelT = DefaultPixelT>
+  [[nodiscard]] File create_cell(
+      std::string_view cell, StandardAttributes attributes = StandardAttributes::init<PixelT>(0),
+      std::size_t cache_size_bytes = DEFAULT_HDF5_CACHE_SIZE,
+      const CompressionPolicy &compression = CompressionPolicy{});
+  // Create a new cell and write the pixels in the given range
+  template <typename PixelIt>
+  void append_cell(std::string_view cell, PixelIt first_pixel, PixelIt last_pixel,
+                   bool validate = false);
+
+  void close();
+
+ private:
+  [[nodiscard]] static auto read_cells(const HighFive::File &fp) -> std::vector<std::string>;
+  [[nodiscard]] static auto import_bins(const HighFive::File &fp) -> std::shared_ptr<BinTable>;
+  static void write_root_attributes(HighFive::File &fp, const BinTable &bins);
+  static void write_bin_table(HighFive::File &fp, const BinTable &bins);
+  static void create_hard_link(HighFive::File &fp, std::string_view target_path,
+                               HighFive::Group &dest_grp, std::string_view link_name);
+  void write_ncells();
+};
+
+}  // namespace coolerpp
+
+#include "../../singlecell_file_impl.hpp"
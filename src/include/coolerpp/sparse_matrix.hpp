@@ -0,0 +1,68 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "coolerpp/internal/span.hpp"
+
+namespace coolerpp {
+
+// Sparse matrix in compressed sparse row (CSR) format.
+// The matrix covers the [first_row, first_row + num_rows) x [first_col, first_col + num_cols)
+// region of the interaction matrix: row pointers and column indices are relative to the first row
+// and column of the region, so the arrays can be handed over as-is to libraries expecting a
+// zero-based CSR matrix (e.g. scipy.sparse.csr_matrix or Eigen::Map<SparseMatrix>).
+// Column indices are sorted within each row
+template <typename N>
+class SparseMatrixCSR {
+  static_assert(std::is_arithmetic_v<N>);
+
+  std::uint64_t _first_row{};
+  std::uint64_t _first_col{};
+  std::uint64_t _num_rows{};
+  std::uint64_t _num_cols{};
+
+  std::vector<std::uint64_t> _row_ptrs{0};
+  std::vector<std::uint64_t> _col_ids{};
+  std::vector<N> _values{};
+
+ public:
+  SparseMatrixCSR() = default;
+  SparseMatrixCSR(std::uint64_t first_row, std::uint64_t first_col, std::uint64_t num_rows,
+                  std::uint64_t num_cols, std::vector<std::uint64_t> row_ptrs,
+                  std::vector<std::uint64_t> col_ids, std::vector<N> values);
+
+  [[nodiscard]] std::uint64_t first_row() const noexcept;
+  [[nodiscard]] std::uint64_t first_col() const noexcept;
+  [[nodiscard]] std::uint64_t num_rows() const noexcept;
+  [[nodiscard]] std::uint64_t num_cols() const noexcept;
+  [[nodiscard]] std::size_t nnz() const noexcept;
+  [[nodiscard]] bool empty() const noexcept;
+
+  // row_ptrs() has num_rows() + 1 elements: the non-zero elements of row i are stored in the
+  // [row_ptrs()[i], row_ptrs()[i + 1]) range of col_ids() and values()
+  [[nodiscard]] auto row_ptrs() const noexcept -> internal::Span<std::uint64_t>;
+  [[nodiscard]] auto col_ids() const noexcept -> internal::Span<std::uint64_t>;
+  [[nodiscard]] auto values() const noexcept -> internal::Span<N>;
+
+  // Return the value at (row, col) (relative coordinates), or 0 for elements that are not stored
+  [[nodiscard]] N operator()(std::uint64_t row, std::uint64_t col) const;
+
+  // Coolers usually store only the upper triangle of symmetric matrices: return the full matrix
+  // by mirroring the elements above the diagonal. Requires a square matrix centered on the
+  // diagonal (i.e. first_row() == first_col() and num_rows() == num_cols()) without elements below
+  // the diagonal
+  [[nodiscard]] SparseMatrixCSR expand_symmetric() const;
+
+ private:
+  void validate() const;
+};
+
+}  // namespace coolerpp
+
+#include "../../sparse_matrix_impl.hpp"
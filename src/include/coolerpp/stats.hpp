@@ -0,0 +1,104 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <tsl/hopscotch_map.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace coolerpp {
+
+// Statistics are only collected when coolerpp is compiled with COOLERPP_ENABLE_STATS defined
+// (e.g. by configuring the project with -DCOOLERPP_ENABLE_STATS=ON). Otherwise all counters are
+// compiled out, and File::stats() always returns zeros
+#ifdef COOLERPP_ENABLE_STATS
+inline constexpr bool STATS_ENABLED = true;
+#else
+inline constexpr bool STATS_ENABLED = false;
+#endif
+
+struct DatasetStats {
+  // Number of calls to Dataset::read()
+  std::uint64_t read_calls{};
+  // Number of HDF5 chunks overlapping the values read. Chunks served by the HDF5 chunk cache are
+  // also counted
+  std::uint64_t chunks_read{};
+  // Size of the chunks overlapping the values read, as stored in the file (i.e. compressed)
+  std::uint64_t bytes_read{};
+  // Size of the values read, once decompressed
+  std::uint64_t bytes_decompressed{};
+  // Number of blocks read by Dataset::iterator (see Dataset::iterator::read_chunk_at_offset())
+  std::uint64_t blocks_read{};
+  // Cumulative time spent inside Dataset::read(). Reads performed concurrently by multiple threads
+  // are all accounted for, so read_time can be larger than the wall-clock time
+  std::chrono::nanoseconds read_time{};
+
+  DatasetStats &operator+=(const DatasetStats &other) noexcept;
+};
+
+struct FileStats {
+  // Statistics for every dataset opened when opening the file, indexed by their path relative to
+  // the root of the Cooler (e.g. "pixels/count")
+  tsl::hopscotch_map<std::string, DatasetStats> datasets{};
+  // Sum of the statistics of all datasets
+  DatasetStats total{};
+  // Number of seeks performed by PixelSelector::iterator to reach the first pixel of a row or the
+  // first pixel overlapping a column within a row
+  std::uint64_t row_seeks{};
+  std::uint64_t col_seeks{};
+  // Number of Pixel<N> objects constructed by PixelSelector::iterator
+  std::uint64_t pixels_materialized{};
+};
+
+namespace internal {
+
+// Counters are updated using relaxed atomic operations, as they are only meant to be read once a
+// query completes
+class IOCounters {
+  using clock = std::chrono::steady_clock;
+
+  std::size_t _chunk_size{};  // Number of values stored in each chunk of the dataset
+  std::atomic<std::uint64_t> _read_calls{};
+  std::atomic<std::uint64_t> _chunks_read{};
+  std::atomic<std::uint64_t> _bytes_read{};
+  std::atomic<std::uint64_t> _bytes_decompressed{};
+  std::atomic<std::uint64_t> _blocks_read{};
+  std::atomic<std::int64_t> _read_time_ns{};
+  std::atomic<std::uint64_t> _row_seeks{};
+  std::atomic<std::uint64_t> _col_seeks{};
+  std::atomic<std::uint64_t> _pixels_materialized{};
+
+ public:
+  using time_point = clock::time_point;
+
+  explicit IOCounters(std::size_t chunk_size) noexcept;
+
+  // Returns a default-constructed time_point when statistics are not enabled
+  [[nodiscard]] static time_point now() noexcept;
+  [[nodiscard]] constexpr std::size_t chunk_size() const noexcept;
+
+  void add_read(std::size_t num_chunks, std::size_t bytes_read, std::size_t bytes_decompressed,
+                time_point t0) noexcept;
+  void add_block_read() noexcept;
+  void add_row_seek() noexcept;
+  void add_col_seek() noexcept;
+  void add_pixels_materialized(std::size_t num = 1) noexcept;
+
+  [[nodiscard]] DatasetStats dataset_stats() const noexcept;
+  [[nodiscard]] std::uint64_t row_seeks() const noexcept;
+  [[nodiscard]] std::uint64_t col_seeks() const noexcept;
+  [[nodiscard]] std::uint64_t pixels_materialized() const noexcept;
+
+  void reset() noexcept;
+};
+
+}  // namespace internal
+}  // namespace coolerpp
+
+#include "../../stats_impl.hpp"
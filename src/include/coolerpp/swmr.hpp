@@ -0,0 +1,39 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <highfive/H5File.hpp>
+#include <highfive/H5PropertyList.hpp>
+#include <string_view>
+
+#include "coolerpp/common.hpp"
+
+namespace coolerpp {
+
+// Write Coolers using the single-writer/multiple-readers (SWMR) mode of libhdf5, so that files
+// can be opened with File::open_read_only_swmr() while pixels are still being appended.
+// Readers see the pixels of the rows that have been completed before the last flush: the writer
+// flushes pixels and extends indexes/bin1_offset every flush_interval pixels, as well as when
+// File::flush() is called. Automatic flushes are disabled when flush_interval is 0
+struct SWMROptions {
+  std::size_t flush_interval{DEFAULT_SWMR_FLUSH_INTERVAL};
+};
+
+namespace internal {
+
+// Files written in SWMR mode must use the latest version of the HDF5 file format
+[[nodiscard]] HighFive::FileAccessProps init_swmr_file_access_props();
+
+[[nodiscard]] HighFive::File create_file_swmr(std::string_view path, unsigned mode);
+// All objects written to f should be created before calling this function
+void start_swmr_write(const HighFive::File &f);
+[[nodiscard]] HighFive::File open_file_swmr_read(std::string_view path);
+
+}  // namespace internal
+
+}  // namespace coolerpp
+
+#include "../../swmr_impl.hpp"
@@ -0,0 +1,62 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <atomic>
+
+namespace coolerpp {
+
+// Trace scopes are only emitted when coolerpp is compiled with COOLERPP_ENABLE_TRACING defined
+// (e.g. by configuring the project with -DCOOLERPP_ENABLE_TRACING=ON). Otherwise scopes are
+// compiled out, and installed callbacks are never invoked
+#ifdef COOLERPP_ENABLE_TRACING
+inline constexpr bool TRACING_ENABLED = true;
+#else
+inline constexpr bool TRACING_ENABLED = false;
+#endif
+
+// Callbacks invoked when entering and leaving one of the traced regions of coolerpp (e.g.
+// "coolerpp::File::open_datasets" or "coolerpp::Dataset::iterator::read_chunk_at_offset").
+// name always points to a string literal, so callbacks can forward it as is to e.g.
+// __itt_string_handle_create() + __itt_task_begin()/__itt_task_end(), or to Perfetto's
+// TRACE_EVENT_BEGIN()/TRACE_EVENT_END() with a dynamic string.
+// Regions can be nested, and begin()/end() are always called in pairs and from the same thread.
+// Callbacks may be invoked concurrently from multiple threads, and should not throw
+struct TraceCallbacks {
+  void (*begin)(const char *name, void *user_data){};
+  void (*end)(const char *name, void *user_data){};
+  void *user_data{};
+};
+
+// Install the callbacks used by all trace scopes and return the callbacks previously installed.
+// Pass nullptr to uninstall callbacks. The TraceCallbacks object is not copied: it must outlive
+// all traced calls started while it is installed (a static object is usually the simplest option)
+const TraceCallbacks *set_trace_callbacks(const TraceCallbacks *callbacks) noexcept;
+[[nodiscard]] const TraceCallbacks *get_trace_callbacks() noexcept;
+
+namespace internal {
+
+[[nodiscard]] std::atomic<const TraceCallbacks *> &trace_callbacks() noexcept;
+
+// RAII object marking a traced region. When tracing is disabled constructing a TraceScope is a
+// no-op
+class TraceScope {
+  const TraceCallbacks *_callbacks{};
+  const char *_name{};
+
+ public:
+  explicit TraceScope(const char *name) noexcept;
+  TraceScope(const TraceScope &other) = delete;
+  TraceScope(TraceScope &&other) noexcept = delete;
+  ~TraceScope() noexcept;
+
+  TraceScope &operator=(const TraceScope &other) = delete;
+  TraceScope &operator=(TraceScope &&other) noexcept = delete;
+};
+
+}  // namespace internal
+}  // namespace coolerpp
+
+#include "../../trace_impl.hpp"
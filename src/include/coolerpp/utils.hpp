@@ -5,64 +5,583 @@
 #pragma once
 
 #include <cstdint>
-#include <queue>
+#include <filesystem>
+#include <iosfwd>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 
+#include "coolerpp/balancing.hpp"
 #include "coolerpp/coolerpp.hpp"
+#include "coolerpp/genomic_interval.hpp"
+#include "coolerpp/internal/loser_tree.hpp"
+#include "coolerpp/singlecell_file.hpp"
 
 namespace coolerpp::utils {
 
-enum class MergeStrategy { IN_MEMORY, PQUEUE };
+/// IN_MEMORY: read all pixels in memory, sort them and write them out in a single pass
+/// PQUEUE: k-way merge of pixels streamed from the input coolers
+/// AUTO: use CONCATENATE when the input coolers store pixels for disjoint ranges of rows.
+///       Otherwise, use IN_MEMORY when the estimated memory footprint of the merge is below the
+///       given memory budget, and PQUEUE otherwise
+/// CONCATENATE: copy the pixels from each cooler in blocks, one cooler after the other.
+///              Indexes are rebased and sums and chromosome pair stats are merged from the
+///              attributes of each cooler, so pixels are not processed one at a time.
+///              Requires coolers to store pixels for disjoint ranges of rows (e.g. one cooler per
+///              chromosome)
+enum class MergeStrategy { IN_MEMORY, PQUEUE, AUTO, CONCATENATE };
+
+inline constexpr std::size_t DEFAULT_MERGE_MEMORY_BUDGET = 1ULL << 30U;  // 1 GiB
 
 /// Iterable of coolerpp::File or strings
+/// When num_threads != 1, the bin1 space is split into disjoint ranges of rows that are merged
+/// in parallel (num_threads = 0 means using all available cores).
+/// Chromosome pair stats are computed for dest_uri only when all input coolers have them
 template <typename Str>
 void merge(Str first_file, Str last_file, std::string_view dest_uri,
-           bool overwrite_if_exists = false, std::size_t chunk_size = 500'000, bool quiet = true);
+           bool overwrite_if_exists = false, std::size_t chunk_size = 500'000, bool quiet = true,
+           std::size_t num_threads = 1, MergeStrategy strategy = MergeStrategy::PQUEUE,
+           std::size_t memory_budget_bytes = DEFAULT_MERGE_MEMORY_BUDGET);
+
+/// Sum the pixels of groups of cells from the .scool file at scool_path into one pseudo-bulk
+/// cooler per cluster. cell_clusters is a list of (cell, cluster) pairs: cells that do not appear
+/// in the list are ignored, and the cooler of cluster c is written to {dest_prefix}{c}.cool.
+/// Every cell is read only once, regardless of the number of clusters it belongs to. Cells are
+/// processed by num_threads threads (0 = use all available cores): each thread sums pixels into its
+/// own per-cluster hash maps keyed by bin1_id * num_bins + bin2_id, which are reduced and sorted
+/// once all cells have been processed.
+/// Return the URIs of the coolers that were written, sorted by cluster name
+std::vector<std::string> aggregate_cells(
+    std::string_view scool_path,
+    const std::vector<std::pair<std::string, std::string>>& cell_clusters,
+    std::string_view dest_prefix, bool overwrite_if_exists = false, std::size_t num_threads = 1,
+    std::size_t chunk_size = 500'000);
+
+/// Element-wise operations supported by combine(). Given the counts c1 and c2 of the same pixel
+/// from the first and second cooler respectively:
+/// SUM: c1 + c2
+/// DIFFERENCE: c1 - c2
+/// RATIO: (c1 + pseudocount) / (c2 + pseudocount)
+/// LOG2_RATIO: log2((c1 + pseudocount) / (c2 + pseudocount))
+enum class CombineOp { SUM, DIFFERENCE, RATIO, LOG2_RATIO };
+
+struct CombineOptions {
+  /// When not empty, counts from both coolers are balanced using the weights with the given name
+  /// before being combined
+  std::string weights{};
+  double pseudocount{0.0};
+  /// When true, pixels stored in only one of the two coolers are combined using a count of 0 for
+  /// the cooler where the pixel is missing. When false, only pixels stored in both coolers are
+  /// combined
+  bool fill_zero{true};
+  bool overwrite_if_exists{false};
+  /// num_threads = 0 means using all available cores
+  std::size_t num_threads{1};
+  std::size_t chunk_size{500'000};
+};
+
+/// Combine the pixels of two coolers sharing the same bin table, and write the result to a new
+/// cooler at dest_uri.
+/// Pixels are streamed from both coolers in chunks of chunk_size pixels and merge-joined by their
+/// coordinates, so memory usage does not depend on the number of pixels. Joined pixels are combined
+/// in batches, and pixels whose result is 0 or is not finite (e.g. ratios with a zero denominator
+/// or pixels with NaN weights) are not written.
+/// Counts are stored as integers when both coolers have integer counts, op is SUM or DIFFERENCE and
+/// no weights are used, and as doubles otherwise.
+/// When num_threads != 1, the bin1 space is split into ranges of rows that are combined in
+/// parallel, as done by merge()
+void combine(std::string_view uri1, std::string_view uri2, std::string_view dest_uri,
+             CombineOp op, const CombineOptions& options = CombineOptions{});
 
+struct RepackOptions {
+  /// Filters and chunk sizes used by the datasets of the repacked cooler
+  CompressionPolicy compression{};
+  bool overwrite_if_exists{false};
+  /// num_threads = 0 means using all available cores
+  std::size_t num_threads{1};
+  /// Number of pixels copied at a time
+  std::size_t block_size{500'000};
+};
+
+/// Copy the cooler at src_uri to dest_uri using the filters and chunk sizes from options.
+/// Pixels are copied column by column in blocks of block_size pixels, without building Pixel<N>
+/// objects, and counts keep their on-disk type. Standard attributes and the datasets stored in the
+/// bins group (e.g. balancing weights), together with their attributes, are preserved, and so are
+/// bin marginals and chromosome pair stats.
+/// When num_threads != 1, chunks from src_uri are decompressed and chunks of dest_uri are
+/// compressed using a pool of num_threads threads (see File::set_decompression_threads() and
+/// WriterOptions::threads). Coolers with variable bins are not supported
+void repack(std::string_view src_uri, std::string_view dest_uri,
+            const RepackOptions& options = RepackOptions{});
+
+/// ELEMENTWISE: decode and compare every value stored in the mandatory datasets
+/// RAW_CHUNKS: compare the raw (compressed) chunks of datasets sharing the same datatype, chunk
+///             size and filters. Chunks are decoded only when their raw bytes differ. Datasets that
+///             cannot be compared this way are compared elementwise
+enum class CompareMode { ELEMENTWISE, RAW_CHUNKS };
+
+/// When num_threads != 1, chunks whose raw bytes differ are decoded and compared in parallel
+/// (num_threads = 0 means using all available cores)
 [[nodiscard]] bool equal(std::string_view uri1, std::string_view uri2,
-                         bool ignore_attributes = true);
-[[nodiscard]] bool equal(const File& clr1, const File& clr2, bool ignore_attributes = true);
+                         bool ignore_attributes = true, CompareMode mode = CompareMode::RAW_CHUNKS,
+                         std::size_t num_threads = 1);
+[[nodiscard]] bool equal(const File& clr1, const File& clr2, bool ignore_attributes = true,
+                         CompareMode mode = CompareMode::RAW_CHUNKS, std::size_t num_threads = 1);
+
+/// Compute a 64-bit fingerprint (FNV-1a) of the content of the mandatory datasets.
+/// Values are hashed after being decoded and converted to a common type, so the fingerprint does
+/// not depend on compression settings or on the integral type used to store pixel counts:
+/// coolers for which equal() returns true have the same fingerprint
+[[nodiscard]] std::uint64_t fingerprint(std::string_view uri,
+                                        std::size_t chunk_size = 1'000'000);
+[[nodiscard]] std::uint64_t fingerprint(const File& clr, std::size_t chunk_size = 1'000'000);
+
+/// Coarsen the cooler at src_uri by aggregating pixels into bins that are factor times larger.
+/// Throws std::runtime_error when the cooler has variable bins
+void coarsen(std::string_view src_uri, std::string_view dest_uri, std::uint32_t factor,
+             bool overwrite_if_exists = false, std::size_t chunk_size = 500'000);
+
+/// Generate a .mcool file from the cooler at src_uri. Resolutions should be multiples of the base
+/// resolution. Pixels from the base cooler are read only once: all resolutions (including the base
+/// resolution) are generated at the same time. Coolers with variable bins are not supported
+template <typename ResIt>
+void zoomify(std::string_view src_uri, std::string_view dest_path, ResIt first_resolution,
+             ResIt last_resolution, bool overwrite_if_exists = false,
+             std::size_t chunk_size = 500'000);
+
+inline constexpr std::uint64_t DEFAULT_DOWNSAMPLE_SEED = 2'147'483'647;
+
+/// Downsample the cooler at src_uri to exactly target_sum interactions by drawing interactions
+/// without replacement (i.e. the count of every pixel follows a multivariate hypergeometric
+/// distribution). Only coolers with integer counts can be downsampled: the counts of the output
+/// cooler have the same type as those of src_uri.
+/// The pixel table is split into row-aligned ranges of roughly chunk_size pixels, which are
+/// sampled by num_threads threads (0 = use all available cores) using generators seeded from seed
+/// and the range id: for a given seed and chunk_size, the output does not depend on num_threads
+void downsample(std::string_view src_uri, std::string_view dest_uri, std::uint64_t target_sum,
+                std::uint64_t seed = DEFAULT_DOWNSAMPLE_SEED, bool overwrite_if_exists = false,
+                std::size_t num_threads = 1, std::size_t chunk_size = 500'000);
+/// Same as downsample(), but the target sum is computed as round(fraction * sum) (0 <= fraction
+/// <= 1), where sum is the sum of the interactions stored in src_uri
+void downsample_fraction(std::string_view src_uri, std::string_view dest_uri, double fraction,
+                         std::uint64_t seed = DEFAULT_DOWNSAMPLE_SEED,
+                         bool overwrite_if_exists = false, std::size_t num_threads = 1,
+                         std::size_t chunk_size = 500'000);
+
+/// Expected interactions (i.e. the distance-decay curve P(s)) of a cis region, such as a
+/// chromosome or a chromosome arm. count_sum[d] and num_valid[d] are the sum of the interactions
+/// and the number of valid pixels found on the d-th diagonal of the region. Pixels are valid when
+/// both their bins have a finite weight (all pixels are valid when no weights are used)
+struct ExpectedCis {
+  GenomicInterval region{};
+  std::vector<double> count_sum{};
+  std::vector<std::uint64_t> num_valid{};
+
+  // Return count_sum[d] / num_valid[d] (NaN for diagonals without valid pixels)
+  [[nodiscard]] std::vector<double> average() const;
+};
+
+/// Expected interactions between two chromosomes
+struct ExpectedTrans {
+  GenomicInterval region1{};
+  GenomicInterval region2{};
+  double count_sum{};
+  std::uint64_t num_valid{};
+
+  [[nodiscard]] double average() const noexcept;
+};
+
+/// Compute the expected interactions of each region using a single pass over the pixel table.
+/// Regions default to whole chromosomes, should not overlap, and their bounds are rounded to the
+/// bins they overlap: adjacent regions whose common bound is not aligned to the bin table share
+/// the bin overlapping it, and pixels in that bin count towards both regions.
+/// Pixels are balanced when weights is not null.
+/// The pixel table is split into row-aligned ranges that are processed by num_threads threads
+/// (0 = use all available cores): each thread accumulates interactions into its own buffers,
+/// which are reduced once all pixels have been processed.
+/// Returned intervals refer to the chromosomes of clr
+[[nodiscard]] std::vector<ExpectedCis> expected_cis(
+    const File& clr, std::shared_ptr<const Weights> weights = nullptr,
+    std::vector<GenomicInterval> regions = {}, std::size_t num_threads = 1,
+    std::size_t chunk_size = 500'000);
+/// Compute the expected interactions for every pair of chromosomes chrom1 < chrom2
+[[nodiscard]] std::vector<ExpectedTrans> expected_trans(
+    const File& clr, std::shared_ptr<const Weights> weights = nullptr,
+    std::size_t num_threads = 1, std::size_t chunk_size = 500'000);
+
+/// Store expected interactions under the expected/cis/<name> or expected/trans/<name> group of
+/// the cooler at uri. As with File::write_weights(), the cooler should not be open in read-only
+/// mode by the calling process
+void write_expected(std::string_view uri, std::string_view name,
+                    const std::vector<ExpectedCis>& expected, bool overwrite_if_exists = false);
+void write_expected(std::string_view uri, std::string_view name,
+                    const std::vector<ExpectedTrans>& expected, bool overwrite_if_exists = false);
+[[nodiscard]] bool has_expected_cis(const File& clr, std::string_view name);
+[[nodiscard]] bool has_expected_trans(const File& clr, std::string_view name);
+[[nodiscard]] std::vector<ExpectedCis> read_expected_cis(const File& clr, std::string_view name);
+[[nodiscard]] std::vector<ExpectedTrans> read_expected_trans(const File& clr,
+                                                             std::string_view name);
+
+/// Aggregate of square windows of size x size bins (e.g. windows centered on loop anchors).
+/// sum and num_valid are stored in row-major order: sum[(i * size) + j] is the sum of the values
+/// found at row i and column j of every window, while num_valid[(i * size) + j] is the number of
+/// windows for which that value was valid
+struct Pileup {
+  std::uint64_t size{};
+  std::vector<double> sum{};
+  std::vector<std::uint64_t> num_valid{};
+  /// Number of windows that were aggregated
+  std::size_t num_windows{};
+
+  // Return sum[i] / num_valid[i] (NaN for cells without valid values)
+  [[nodiscard]] std::vector<double> average() const;
+};
+
+/// Aggregate the windows centered on each pair of loci (aggregate peak analysis).
+/// The window of the (locus1, locus2) pair spans flank bins on both sides of the bins overlapping
+/// the midpoints of locus1 (rows) and locus2 (columns). Windows extending past the end of a
+/// chromosome are skipped. Windows overlapping the lower triangle are filled by mirroring the
+/// upper triangle.
+/// Pixels are balanced when weights is not null: values overlapping bins with invalid weights are
+/// ignored. When expected is not null, values are divided by the expected interactions of the
+/// diagonal they belong to: values outside of the regions of expected, or for which the expected is
+/// 0 or not finite, are ignored.
+/// Windows are sorted by row, and the rows of the pixel table overlapped by at least one window are
+/// read only once, in row-aligned blocks of up to chunk_size pixels, regardless of how many windows
+/// overlap them. Blocks are processed by num_threads threads (0 = use all available cores): each
+/// thread accumulates values into its own buffers, which are reduced once all blocks have been
+/// processed
+[[nodiscard]] Pileup pileup(const File& clr,
+                            const std::vector<std::pair<GenomicInterval, GenomicInterval>>& loci,
+                            std::uint32_t flank, std::shared_ptr<const Weights> weights = nullptr,
+                            const std::vector<ExpectedCis>* expected = nullptr,
+                            std::size_t num_threads = 1, std::size_t chunk_size = 500'000);
+
+/// Sort pixels in memory by bin1_id and bin2_id, so that they can be passed to
+/// File::append_pixels(). Pixels are sorted with a LSD radix sort over keys packing bin1_id and
+/// bin2_id into a single 64-bit integer, using one scratch buffer as large as the input. Passes
+/// are split across num_threads threads (0 = use all available cores).
+/// When sum_duplicates is true, pixels with the same coordinates are replaced by a single pixel
+/// whose count is the sum of their counts.
+/// Pixel<N> objects should refer to bins with a valid id (i.e. bins coming from a BinTable)
+template <typename N>
+void sort_pixels(std::vector<ThinPixel<N>>& pixels, bool sum_duplicates = false,
+                 std::size_t num_threads = 1);
+template <typename N>
+void sort_pixels(std::vector<Pixel<N>>& pixels, bool sum_duplicates = false,
+                 std::size_t num_threads = 1);
+
+/// Write pixels that are not sorted to a cooler using an external-memory sort.
+/// Pixels are buffered in memory until the buffer is full, at which point they are sorted
+/// (summing pixels with the same coordinates) and spilled to a temporary file (a run).
+/// File::append_pixels_columns() is called only by finalize(), which performs a k-way merge of the
+/// runs. When all pixels fit in a single buffer, no temporary file is ever created
+template <typename N>
+class PixelSorter {
+  File* _dest{};
+  std::filesystem::path _tmp_dir{};
+  std::size_t _buffer_capacity{};
+  std::uint64_t _num_bins{};
+
+  // Pixels are identified by keys computed as bin1_id * num_bins + bin2_id
+  std::vector<std::uint64_t> _keys{};
+  std::vector<N> _counts{};
+  std::vector<std::filesystem::path> _runs{};
+  bool _finalized{false};
+
+ public:
+  static constexpr std::size_t DEFAULT_BUFFER_CAPACITY = 10'000'000;
+
+  PixelSorter() = delete;
+  explicit PixelSorter(File& dest,
+                       std::filesystem::path tmp_dir = std::filesystem::temp_directory_path(),
+                       std::size_t buffer_capacity = DEFAULT_BUFFER_CAPACITY);
+
+  PixelSorter(const PixelSorter& other) = delete;
+  PixelSorter(PixelSorter&& other) noexcept = default;
+  ~PixelSorter() noexcept;
+
+  PixelSorter& operator=(const PixelSorter& other) = delete;
+  PixelSorter& operator=(PixelSorter&& other) noexcept = default;
+
+  void add(std::uint64_t bin1_id, std::uint64_t bin2_id, N count);
+  void add(const Pixel<N>& pixel);
+  void add(const ThinPixel<N>& pixel);
+  template <typename PixelIt>
+  void add(PixelIt first_pixel, PixelIt last_pixel);
+
+  // Merge all pixels added so far and write them to the destination cooler.
+  // No pixels can be added after calling finalize()
+  void finalize(std::size_t chunk_size = 500'000);
+
+  [[nodiscard]] std::size_t num_runs() const noexcept;
+
+ private:
+  void sort_buffer();
+  void spill_buffer();
+  void write_buffer(std::size_t chunk_size);
+  void merge_runs(std::size_t chunk_size);
+  void remove_runs() noexcept;
+};
 
 namespace internal {
 
-/// This class is basically a wrapper around a priority queue of objects of type Node
-/// Node consist of a pixel and an index. The index represent from which iterator (i.e. file) the
-/// pixel was read. This allows us to know from which iterator we should read the next pixel (i.e.
-/// the same iterator from which the top pixel originated)
+/// K-way merge of the pixels from a collection of coolers using a loser tree (see
+/// coolerpp::internal::LoserTree). Pixels are read from each cooler in columnar chunks and are
+/// identified by keys packing their (bin1_id, bin2_id) pair, so that advancing the merge requires
+/// log2(k) integer comparisons per pixel. Pixels with the same coordinates are summed, and the
+/// merged pixels are written using File::append_pixels_columns().
+/// Coolers should have less than 2^32 bins
 template <typename N>
 class PixelMerger {
-  struct Node {
-    Pixel<N> pixel{};
+
+  // Buffered reader over the pixels of a single cooler.
+  // Datasets are referenced rather than copied, so that merging a partition from a worker thread
+  // never copies or releases HDF5 handles (see merge_parallel())
+  struct Source {
+    coolerpp::internal::PixelColumnReader<N> reader{};
+    std::vector<std::uint64_t> bin1_buff{};
+    std::vector<std::uint64_t> bin2_buff{};
+    std::vector<N> count_buff{};
+    std::size_t next_offset{};
+    std::size_t last_offset{};
     std::size_t i{};
 
-    bool operator<(const Node& other) const noexcept;
-    bool operator>(const Node& other) const noexcept;
-    bool operator==(const Node& other) const noexcept;
-    bool operator!=(const Node& other) const noexcept;
+    [[nodiscard]] bool exhausted() const noexcept;
+    // Return LoserTree::EXHAUSTED once all pixels have been read
+    [[nodiscard]] std::uint64_t key() const noexcept;
+    [[nodiscard]] N count() const noexcept;
+    void advance(std::size_t chunk_size);
+    void read_chunk(std::size_t chunk_size);
   };
 
-  std::vector<Pixel<N>> _buffer{};
-  std::priority_queue<Node, std::vector<Node>, std::greater<>> _pqueue{};
-  using PixelIt = decltype(std::declval<File>().begin<N>());
+  std::vector<Source> _sources{};
+  coolerpp::internal::LoserTree _tree{};
+  std::size_t _chunk_size{};
 
-  std::vector<PixelIt> _heads{};
-  std::vector<PixelIt> _tails{};
+  std::vector<std::uint64_t> _bin1_buff{};
+  std::vector<std::uint64_t> _bin2_buff{};
+  std::vector<N> _count_buff{};
 
  public:
+  using OffsetRange = std::pair<std::uint64_t, std::uint64_t>;
+
   PixelMerger() = delete;
-  explicit PixelMerger(const std::vector<File>& input_coolers);
+  explicit PixelMerger(const std::vector<File>& input_coolers,
+                       std::size_t chunk_size = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE);
   template <typename FileIt>
-  PixelMerger(FileIt first_file, FileIt last_file);
-  void merge(File& clr, std::size_t queue_capacity, bool quiet = true);
+  PixelMerger(FileIt first_file, FileIt last_file,
+              std::size_t chunk_size = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE);
+  // Merge only the pixels in the [first, last) offset range of each cooler.
+  // Calls into libhdf5 made while reading from the input coolers are serialized using io_mtx (see
+  // coolerpp::internal::PixelColumnReader). input_coolers must outlive the merger
+  PixelMerger(const std::vector<File>& input_coolers, const std::vector<OffsetRange>& offsets,
+              std::mutex& io_mtx,
+              std::size_t chunk_size = DEFAULT_HDF5_DATASET_ITERATOR_BUFFER_SIZE);
+
+  void merge(File& clr, std::size_t buffer_capacity, bool quiet = true);
+  // Pass merged pixels to sink in blocks of up to buffer_capacity pixels. Sink is called with
+  // three vectors storing bin1_ids, bin2_ids and counts respectively
+  template <typename Sink>
+  void merge_columns(Sink&& sink, std::size_t buffer_capacity);
+
+ private:
+  void init_tree();
+  void add_source(const File& clr, Source src);
+};
+
+/// Merge-join the pixels of two coolers and combine the counts of pixels with the same coordinates
+/// (see combine()). Pixels are read from each cooler in columnar chunks, and counts are converted to
+/// double and balanced one chunk at a time. Joined pixels are accumulated into batches of up to
+/// chunk_size pixels, which are combined by tight loops over the batch
+class PixelCombiner {
+  using OffsetRange = std::pair<std::uint64_t, std::uint64_t>;
+
+  // Buffered reader over the pixels of a single cooler
+  struct Source {
+    coolerpp::internal::PixelColumnReader<double> reader{};
+    std::shared_ptr<const Weights> weights{};
+    std::vector<std::uint64_t> bin1_buff{};
+    std::vector<std::uint64_t> bin2_buff{};
+    std::vector<double> count_buff{};
+    std::size_t next_offset{};
+    std::size_t last_offset{};
+    std::size_t i{};
+
+    [[nodiscard]] bool exhausted() const noexcept;
+    [[nodiscard]] std::uint64_t bin1_id() const noexcept;
+    [[nodiscard]] std::uint64_t bin2_id() const noexcept;
+    [[nodiscard]] double count() const noexcept;
+    void advance(std::size_t chunk_size);
+    void read_chunk(std::size_t chunk_size);
+  };
+
+  Source _src1{};
+  Source _src2{};
+  CombineOp _op{};
+  double _pseudocount{};
+  bool _fill_zero{true};
+  std::size_t _chunk_size{};
+
+  std::vector<std::uint64_t> _bin1_buff{};
+  std::vector<std::uint64_t> _bin2_buff{};
+  std::vector<double> _count1_buff{};
+  std::vector<double> _count2_buff{};
+
+ public:
+  PixelCombiner() = delete;
+  PixelCombiner(const File& clr1, const File& clr2, std::shared_ptr<const Weights> weights1,
+                std::shared_ptr<const Weights> weights2, CombineOp op,
+                const CombineOptions& options);
+  // Combine only the pixels in the [first, last) offset range of each cooler.
+  // Calls into libhdf5 made while reading from the input coolers are serialized using io_mtx (see
+  // coolerpp::internal::PixelColumnReader)
+  PixelCombiner(const File& clr1, const File& clr2, std::shared_ptr<const Weights> weights1,
+                std::shared_ptr<const Weights> weights2, CombineOp op,
+                const CombineOptions& options, const std::vector<OffsetRange>& offsets,
+                std::mutex& io_mtx);
+
+  // Pass combined pixels to sink in blocks of up to chunk_size pixels. Sink is called with three
+  // vectors storing bin1_ids, bin2_ids and counts (converted to N) respectively
+  template <typename N, typename Sink>
+  void combine_columns(Sink&& sink);
+
+ private:
+  PixelCombiner(const File& clr1, const File& clr2, std::shared_ptr<const Weights> weights1,
+                std::shared_ptr<const Weights> weights2, CombineOp op,
+                const CombineOptions& options, const std::vector<OffsetRange>& offsets,
+                std::mutex* io_mtx);
+  [[nodiscard]] static Source make_source(const File& clr, std::shared_ptr<const Weights> weights,
+                                          OffsetRange offsets, std::mutex* io_mtx);
+
+  // Fill the join buffers with up to chunk_size joined pixels. Return false once both sources have
+  // been exhausted
+  bool join_batch();
+  // Combine the counts stored in the join buffers, writing the results to _count1_buff
+  void apply_op() noexcept;
+};
+
+/// Combine the pixels of the two coolers in coolers using num_threads threads, and write the result
+/// to dest
+template <typename N>
+void combine_coolers(const std::vector<File>& coolers, File& dest,
+                     const std::shared_ptr<const Weights>& weights1,
+                     const std::shared_ptr<const Weights>& weights2, CombineOp op,
+                     const CombineOptions& options, std::size_t num_threads);
+
+template <typename N>
+void merge_parallel(const std::vector<File>& coolers, File& dest, std::size_t chunk_size,
+                    std::size_t num_threads, bool quiet);
+
+/// Process num_partitions partitions using up to num_threads threads, and append the pixels they
+/// produce to dest in partition order.
+/// process_partition(i, io_mtx, sink) should pass the pixels from the i-th partition to
+/// sink(bin1_ids, bin2_ids, counts), holding io_mtx while calling into libhdf5.
+/// Blocks are handed over to the thread writing to dest in memory: pixels from the partition that
+/// is currently being written are appended as soon as they are produced, while threads processing
+/// later partitions wait once max_buffered_pixels pixels are queued
+template <typename N, typename PartitionOp>
+void process_partitions_parallel(File& dest, std::size_t num_partitions, std::size_t num_threads,
+                                 std::size_t max_buffered_pixels, std::string_view task,
+                                 bool quiet, PartitionOp process_partition);
+
+/// Upper bound to the number of bytes required to merge coolers using MergeStrategy::IN_MEMORY
+template <typename N>
+[[nodiscard]] std::size_t estimate_in_memory_merge_footprint(const std::vector<File>& coolers);
+
+/// Sort the elements of columns (vectors of the same size) using LSD radix sort over the 8-bit
+/// digits of the keys returned by get_key(i), with keys no greater than max_key. Elements of all
+/// columns are moved together with their keys. Passes are split across up to num_threads threads
+template <typename KeyFn, typename... Ts>
+void radix_sort(KeyFn get_key, std::uint64_t max_key, std::size_t num_threads,
+                std::vector<Ts>&... columns);
+
+/// Sort keys using LSD radix sort, moving values along with their keys
+template <typename N>
+void radix_sort(std::vector<std::uint64_t>& keys, std::vector<N>& values);
+
+template <typename N>
+void merge_in_memory(const std::vector<File>& coolers, File& dest, std::size_t chunk_size);
+
+/// Return the order in which coolers should be concatenated when the ranges of rows (i.e. the
+/// [first, last] bin1_ids) storing pixels in each cooler do not overlap, and std::nullopt
+/// otherwise. Coolers without pixels are placed at the end
+[[nodiscard]] std::optional<std::vector<std::size_t>> find_disjoint_row_order(
+    const std::vector<File>& coolers);
+
+/// Append all pixels from src to dest. Pixels are copied in blocks of chunk_size pixels
+template <typename N>
+void copy_pixels(const File& src, File& dest, std::size_t chunk_size);
+
+/// Copy the datasets stored in the bins group of src (except chrom, start and end) to dest,
+/// together with their attributes. Bin marginals are skipped, as they are computed by dest while
+/// pixels are appended
+void copy_bin_datasets(const File& src, File& dest);
+
+/// Append the pixels from coolers to dest in the given order using File::append_pixels_from().
+/// Pixels are copied in blocks of chunk_size pixels without going through a k-way merge: the
+/// index of each cooler is rebased on the pixels already written to dest, and sums and
+/// chromosome pair stats are merged from the attributes of each cooler.
+/// Chunks are decompressed using num_threads threads
+template <typename N>
+void merge_concatenate(std::vector<File>& coolers, const std::vector<std::size_t>& order,
+                       File& dest, std::size_t chunk_size, std::size_t num_threads, bool quiet);
+
+template <typename N>
+void merge_coolers(std::vector<File>& coolers, File& dest, std::size_t chunk_size,
+                   bool quiet, std::size_t num_threads, MergeStrategy strategy,
+                   std::size_t memory_budget_bytes);
+
+/// Aggregate pixels from a cooler into the coarser bins of dest.
+/// Pixels are accumulated one (coarse) row at a time: memory usage is bounded by the number of
+/// bins in dest, regardless of the number of pixels being coarsened
+template <typename N>
+class PixelCoarsener {
+  File* _dest{};
+  std::uint64_t _factor{};
+
+  std::vector<N> _row{};
+  std::vector<std::uint64_t> _row_bin2_ids{};
+  std::uint64_t _bin1_id{(std::numeric_limits<std::uint64_t>::max)()};
+
+  std::vector<std::uint64_t> _bin1_buff{};
+  std::vector<std::uint64_t> _bin2_buff{};
+  std::vector<N> _count_buff{};
+  std::size_t _chunk_size{};
+
+ public:
+  PixelCoarsener() = delete;
+  PixelCoarsener(File& dest, std::uint32_t factor, std::size_t chunk_size);
+
+  // Pixels should be added in the order in which they appear in the source cooler.
+  // Bins are identified by the chromosome id and the bin id relative to the chromosome start
+  void add(std::uint32_t chrom1_id, std::uint64_t rel_bin1_id, std::uint32_t chrom2_id,
+           std::uint64_t rel_bin2_id, N count);
+  void finalize();
 
  private:
-  void replace_top_node(std::size_t i);
-  [[nodiscard]] Pixel<N> next();
+  [[nodiscard]] std::uint64_t map_bin_id(std::uint32_t chrom_id,
+                                         std::uint64_t rel_bin_id) const noexcept;
+  void flush_row();
+  void write_pixels();
 };
+
 }  // namespace internal
 }  // namespace coolerpp::utils
 
+#include "../../utils_aggregate_impl.hpp"
+#include "../../utils_coarsen_impl.hpp"
+#include "../../utils_combine_impl.hpp"
+#include "../../utils_downsample_impl.hpp"
 #include "../../utils_equal_impl.hpp"
+#include "../../utils_expected_impl.hpp"
 #include "../../utils_merge_impl.hpp"
+#include "../../utils_pileup_impl.hpp"
+#include "../../utils_pixel_sorter_impl.hpp"
+#include "../../utils_repack_impl.hpp"
+#include "../../utils_sort_impl.hpp"
@@ -8,14 +8,17 @@
 // clang-format on
 #include <fmt/format.h>
 
+#include <cstddef>
 #include <cstdint>
 DISABLE_WARNING_PUSH
 DISABLE_WARNING_NULL_DEREF
 #include <highfive/H5File.hpp>
 DISABLE_WARNING_POP
 #include <highfive/H5Group.hpp>
+#include <string>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 namespace coolerpp::utils {
 
@@ -55,6 +58,16 @@ struct ValidationStatusScool : public internal::ValidationStatusBase {
   constexpr explicit operator bool() const noexcept;
 };
 
+// Options controlling how the resolutions of .mcool files and the cells of .scool files are
+// validated
+struct ValidationOptions {
+  // Stop validating groups as soon as one invalid group is found
+  bool stop_at_first_failure{false};
+  // When != 0, only validate a random sample of up to sample_size groups
+  std::size_t sample_size{0};
+  std::uint64_t seed{2'147'483'647};
+};
+
 [[nodiscard]] ValidationStatusCooler is_cooler(std::string_view uri);
 [[nodiscard]] ValidationStatusCooler is_cooler(const HighFive::File& fp,
                                                std::string_view root_path = "/");
@@ -67,9 +80,34 @@ struct ValidationStatusScool : public internal::ValidationStatusBase {
                                                               bool validate_resolutions = true,
                                                               std::int64_t min_version = 1);
 
+[[nodiscard]] ValidationStatusMultiresCooler is_multires_file(std::string_view uri,
+                                                              const ValidationOptions& opts,
+                                                              std::int64_t min_version = 1);
+[[nodiscard]] ValidationStatusMultiresCooler is_multires_file(const HighFive::File& fp,
+                                                              const ValidationOptions& opts,
+                                                              std::int64_t min_version = 1);
+
 [[nodiscard]] ValidationStatusScool is_scool_file(std::string_view uri, bool validate_cells = true);
 [[nodiscard]] ValidationStatusScool is_scool_file(const HighFive::File& fp,
                                                   bool validate_cells = true);
+[[nodiscard]] ValidationStatusScool is_scool_file(std::string_view uri,
+                                                  const ValidationOptions& opts);
+[[nodiscard]] ValidationStatusScool is_scool_file(const HighFive::File& fp,
+                                                  const ValidationOptions& opts);
+
+namespace internal {
+// Validate the Coolers found under root_path/<name> for each name in names, and return the
+// status of the invalid ones (in the same order as names).
+// When opts is null, groups are not validated at all
+[[nodiscard]] std::vector<ValidationStatusCooler> validate_groups(
+    const HighFive::File& fp, std::string_view root_path, std::vector<std::string> names,
+    const ValidationOptions* opts);
+[[nodiscard]] ValidationStatusMultiresCooler is_multires_file(const HighFive::File& fp,
+                                                              const ValidationOptions* opts,
+                                                              std::int64_t min_version);
+[[nodiscard]] ValidationStatusScool is_scool_file(const HighFive::File& fp,
+                                                  const ValidationOptions* opts);
+}  // namespace internal
 }  // namespace coolerpp::utils
 
 namespace fmt {
@@ -5,9 +5,11 @@
 #include <fmt/format.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <stdexcept>
 #include <string_view>
@@ -21,13 +23,26 @@ namespace coolerpp {
 
 inline Index::Index(std::shared_ptr<const BinTable> bins, std::uint64_t nnz)
     : _bins(std::move(bins)),
-      _idx(Index::init(_bins->chromosomes(), _bins->bin_size())),
+      _idx(Index::init(*_bins)),
       _nnz(nnz) {
-  assert(this->bin_size() != 0);
   _size = std::accumulate(_idx.begin(), _idx.end(), std::size_t(0),
                           [&](std::size_t sum, const auto &it) { return sum + it.size(); });
 }
 
+inline Index::Index(std::shared_ptr<const BinTable> bins, OffsetLoader loader, std::uint64_t nnz)
+    : _bins(std::move(bins)),
+      // Offsets are allocated by load_offsets() when they are accessed for the first time
+      _idx(_bins->num_chromosomes()),
+      _size(_bins->size()),
+      _nnz(nnz),
+      _loader(std::move(loader)),
+      _chrom_loaded(_idx.size()),
+      _loader_mtx(std::make_shared<std::mutex>()) {
+  assert(this->_loader);
+}
+
+inline bool Index::is_lazy() const noexcept { return !!this->_loader; }
+
 inline const ChromosomeSet &Index::chromosomes() const noexcept {
   assert(this->_bins);
   return this->_bins->chromosomes();
@@ -60,6 +75,21 @@ inline std::uint32_t Index::bin_size() const noexcept {
   return this->_bins->bin_size();
 }
 
+inline std::size_t Index::memory_usage() const {
+  // Offsets of lazy indexes are loaded while holding the loader mutex
+  std::unique_lock<std::mutex> lck{};
+  if (this->_loader_mtx) {
+    lck = std::unique_lock<std::mutex>(*this->_loader_mtx);
+  }
+
+  std::size_t size = (this->_idx.capacity() * sizeof(OffsetVect)) +
+                     (this->_chrom_loaded.capacity() * sizeof(LoadedFlag));
+  for (const auto &offsets : this->_idx) {
+    size += offsets.capacity() * sizeof(std::uint64_t);
+  }
+  return size;
+}
+
 inline auto Index::begin() const noexcept -> const_iterator { return iterator{this}; }
 inline auto Index::end() const noexcept -> const_iterator {
   return iterator::make_end_iterator(this);
@@ -70,27 +100,31 @@ inline auto Index::cend() const noexcept -> const_iterator { return this->end();
 
 inline auto Index::at(std::string_view chrom_name) const -> const mapped_type & {
   const auto chrom_id = this->chromosomes().get_id(chrom_name);
+  this->load_offsets(chrom_id);
   return this->_idx.at(chrom_id);
 }
 
 inline auto Index::at(std::uint32_t chrom_id) -> mapped_type & {
   this->validate_chrom_id(chrom_id);
+  this->load_offsets(chrom_id);
   return this->_idx.at(chrom_id);
 }
 
 inline auto Index::at(std::string_view chrom_name) -> mapped_type & {
   const auto chrom_id = this->chromosomes().get_id(chrom_name);
+  this->load_offsets(chrom_id);
   return this->_idx.at(chrom_id);
 }
 
 inline auto Index::at(std::uint32_t chrom_id) const -> const mapped_type & {
   this->validate_chrom_id(chrom_id);
+  this->load_offsets(chrom_id);
   return this->_idx.at(chrom_id);
 }
 
 inline std::uint64_t Index::get_offset_by_bin_id(std::uint64_t bin_id) const {
   if (bin_id == this->size()) {
-    return this->_idx.back().back();
+    return this->at(static_cast<std::uint32_t>(this->_idx.size() - 1)).back();
   }
   const auto &coords = this->_bins->at(bin_id);
   return this->get_offset_by_pos(coords.chrom(), coords.start());
@@ -102,13 +136,11 @@ inline std::uint64_t Index::get_offset_by_pos(const Chromosome &chrom, std::uint
 
 inline std::uint64_t Index::get_offset_by_pos(std::string_view chrom_name,
                                               std::uint32_t pos) const {
-  const auto row_idx = pos / this->bin_size();
-  return this->get_offset_by_row_idx(this->chromosomes().get_id(chrom_name), row_idx);
+  return this->get_offset_by_pos(this->chromosomes().get_id(chrom_name), pos);
 }
 
 inline std::uint64_t Index::get_offset_by_pos(std::uint32_t chrom_id, std::uint32_t pos) const {
-  const auto row_idx = pos / this->bin_size();
-  return this->get_offset_by_row_idx(chrom_id, row_idx);
+  return this->get_offset_by_row_idx(chrom_id, this->compute_row_idx(chrom_id, pos));
 }
 
 inline std::uint64_t Index::get_offset_by_row_idx(std::uint32_t chrom_id,
@@ -134,14 +166,12 @@ inline void Index::set_offset_by_pos(const Chromosome &chrom, std::uint32_t pos,
 
 inline void Index::set_offset_by_pos(std::string_view chrom_name, std::uint32_t pos,
                                      std::uint64_t offset) {
-  const auto row_idx = pos / this->bin_size();
-  this->set_offset_by_row_idx(this->chromosomes().get_id(chrom_name), row_idx, offset);
+  this->set_offset_by_pos(this->chromosomes().get_id(chrom_name), pos, offset);
 }
 
 inline void Index::set_offset_by_pos(std::uint32_t chrom_id, std::uint32_t pos,
                                      std::uint64_t offset) {
-  const auto row_idx = pos / this->bin_size();
-  this->set_offset_by_row_idx(chrom_id, row_idx, offset);
+  this->set_offset_by_row_idx(chrom_id, this->compute_row_idx(chrom_id, pos), offset);
 }
 
 inline void Index::set_offset_by_row_idx(std::uint32_t chrom_id, std::size_t row_idx,
@@ -173,6 +203,7 @@ inline std::uint64_t Index::chrom_to_bin1_offset(std::uint32_t chrom_id) const {
 }
 
 inline void Index::finalize(std::uint64_t nnz) {
+  this->load_all_offsets();
   this->_nnz = nnz;
   auto fill_value = nnz;
 
@@ -190,13 +221,12 @@ inline void Index::finalize(std::uint64_t nnz) {
 }
 
 inline void Index::compute_chrom_offsets(std::vector<std::uint64_t> &buff) const noexcept {
+  // The offsets of lazy indexes may not have been loaded yet: use the number of bins of each
+  // chromosome instead of the size of the offset vectors
+  const auto &prefix_sum = this->_bins->num_bin_prefix_sum();
   buff.resize(this->num_chromosomes() + 1);
-  buff[0] = 0;
-
-  std::transform(this->_idx.begin(), this->_idx.end(), buff.begin() + 1,
-                 [offset = std::uint64_t(0)](const auto &it) mutable {
-                   return offset += conditional_static_cast<std::uint64_t>(it.size());
-                 });
+  assert(buff.size() == prefix_sum.size());
+  std::copy(prefix_sum.begin(), prefix_sum.end(), buff.begin());
 }
 
 inline void Index::validate_chrom_id(std::uint32_t chrom_id) const {
@@ -205,36 +235,55 @@ inline void Index::validate_chrom_id(std::uint32_t chrom_id) const {
   }
 }
 
-inline auto Index::init(const ChromosomeSet &chroms, std::uint32_t bin_size) -> MapT {
-  assert(!chroms.empty());
-  assert(bin_size != 0);
+inline auto Index::init(const BinTable &bins) -> MapT {
+  assert(!bins.chromosomes().empty());
 
-  MapT idx(chroms.size());
-  std::transform(chroms.begin(), chroms.end(), idx.begin(), [&](const Chromosome &chrom) {
-    const auto num_bins = (chrom.size() + bin_size - 1) / bin_size;
-    return std::vector<std::uint64_t>(num_bins, Index::offset_not_set_value);
-  });
+  const auto &prefix_sum = bins.num_bin_prefix_sum();
+  MapT idx(bins.chromosomes().size());
+  for (std::size_t i = 0; i < idx.size(); ++i) {
+    const auto num_bins = static_cast<std::size_t>(prefix_sum[i + 1] - prefix_sum[i]);
+    idx[i] = std::vector<std::uint64_t>(num_bins, Index::offset_not_set_value);
+  }
 
   return idx;
 }
 
+inline std::size_t Index::compute_row_idx(std::uint32_t chrom_id, std::uint32_t pos) const {
+  // Bins of fixed size can be mapped to rows without querying the bin table
+  if (this->bin_size() != 0) {
+    return static_cast<std::size_t>(pos / this->bin_size());
+  }
+  const auto &prefix_sum = this->_bins->num_bin_prefix_sum();
+  return static_cast<std::size_t>(this->_bins->map_to_bin_id(chrom_id, pos) -
+                                  prefix_sum[chrom_id]);
+}
+
 inline void Index::validate(const Chromosome &chrom) const {
   try {
     const auto chrom_id = chrom.id();
     const auto &offsets = this->at(chrom_id);
-    if (chrom_id == 0) {
-      if (offsets.front() != 0) {
-        throw std::runtime_error("first offset is not zero");
-      }
-    } else {
+    if (chrom_id != 0) {
       const auto &prev_offsets = this->at(chrom_id - 1);
       if (offsets.front() < prev_offsets.back()) {
         throw std::runtime_error(
             fmt::format(FMT_STRING("offsets are not in ascending order: offset for "
                                    "bin {}:{}-{} should be >= {}, found {}"),
-                        chrom.name(), 0, this->bin_size(), prev_offsets.back(), offsets.front()));
+                        chrom.name(), 0, this->_bins->at(chrom, 0).end(), prev_offsets.back(),
+                        offsets.front()));
       }
     }
+  } catch (const std::exception &e) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("{} index is corrupted or incomplete: {}"), chrom.name(), e.what()));
+  }
+  this->validate_offsets(chrom, this->_idx[chrom.id()]);
+}
+
+inline void Index::validate_offsets(const Chromosome &chrom, const OffsetVect &offsets) const {
+  try {
+    if (chrom.id() == 0 && offsets.front() != 0) {
+      throw std::runtime_error("first offset is not zero");
+    }
 
     if (const auto it = std::is_sorted_until(offsets.begin(), offsets.end()); it != offsets.end()) {
       const auto i = std::distance(offsets.begin(), it);
@@ -261,6 +310,67 @@ inline void Index::validate(const Chromosome &chrom) const {
   }
 }
 
+inline void Index::load_offsets(std::uint32_t chrom_id) const {
+  if (!this->is_lazy()) {
+    return;
+  }
+
+  assert(chrom_id < this->_idx.size());
+  // Offsets are never unloaded: once the flag is set they can be read without locking
+  auto &loaded = this->_chrom_loaded[chrom_id].value;
+  if (loaded.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  assert(this->_loader_mtx);
+  [[maybe_unused]] const std::scoped_lock lck(*this->_loader_mtx);
+  if (loaded.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  // Also read the last offset of the previous chromosome and the first offset of the next one
+  const auto &chrom = this->chromosomes().at(chrom_id);
+  const auto &prefix_sum = this->_bins->num_bin_prefix_sum();
+  const auto num_bins = static_cast<std::size_t>(prefix_sum[chrom_id + 1] - prefix_sum[chrom_id]);
+  const auto has_prev = chrom_id != 0;
+  const auto has_next = std::size_t(chrom_id) + 1 < this->_idx.size();
+  OffsetVect buff(num_bins + std::size_t(has_prev) + std::size_t(has_next));
+  this->_loader(prefix_sum[chrom_id] - std::uint64_t(has_prev), buff);
+
+  // Offsets are allocated here, so that chromosomes that are never queried take no memory
+  auto &offsets = this->_idx[chrom_id];
+  const auto first = buff.begin() + std::ptrdiff_t(has_prev);
+  offsets.assign(first, first + std::ptrdiff_t(num_bins));
+  this->validate_offsets(chrom, offsets);
+
+  try {
+    if (has_prev && !offsets.empty() && offsets.front() < buff.front()) {
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("offsets are not in ascending order: offset for "
+                                 "bin {}:{}-{} should be >= {}, found {}"),
+                      chrom.name(), 0, this->_bins->at(chrom, 0).end(), buff.front(),
+                      offsets.front()));
+    }
+    if (has_next && !offsets.empty() && offsets.back() > buff.back()) {
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("offsets are not in ascending order: offset for the last bin "
+                                 "of {} should be <= {}, found {}"),
+                      chrom.name(), buff.back(), offsets.back()));
+    }
+  } catch (const std::exception &e) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("{} index is corrupted or incomplete: {}"), chrom.name(), e.what()));
+  }
+
+  loaded.store(true, std::memory_order_release);
+}
+
+inline void Index::load_all_offsets() const {
+  for (std::uint32_t chrom_id = 0; chrom_id < this->_idx.size(); ++chrom_id) {
+    this->load_offsets(chrom_id);
+  }
+}
+
 // NOLINTNEXTLINE
 inline Index::iterator::iterator(const Index *idx) : _idx(idx), _chrom_id(0), _offset_idx(0) {
   assert(idx);
@@ -326,8 +436,9 @@ inline std::uint32_t Index::iterator::last_chrom_id() const noexcept {
   return static_cast<std::uint32_t>(this->_idx->num_chromosomes() - 1);
 }
 
-inline auto Index::iterator::get_offsets() const noexcept -> const OffsetVect & {
+inline auto Index::iterator::get_offsets() const -> const OffsetVect & {
   assert(this->_chrom_id < static_cast<std::uint32_t>(this->_idx->size()));
+  this->_idx->load_offsets(this->_chrom_id);
   return this->_idx->_idx[static_cast<std::size_t>(this->_chrom_id)];
 }
 
@@ -0,0 +1,71 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace coolerpp::internal {
+
+inline LoserTree::LoserTree(std::vector<std::uint64_t> keys) : _keys(std::move(keys)) {
+  // Leaves are stored at positions [k, 2k), internal nodes at positions [1, k)
+  const auto k = this->_keys.size();
+  this->_tree.assign((std::max)(k, std::size_t(1)), 0);
+  if (k == 0) {
+    // A tree without sequences behaves as a tree whose sequences have all been consumed
+    this->_keys.push_back(EXHAUSTED);
+    return;
+  }
+  if (k == 1) {
+    return;
+  }
+
+  std::vector<std::size_t> winners(2 * k);
+  for (std::size_t i = 0; i < k; ++i) {
+    winners[k + i] = i;
+  }
+  for (auto node = k - 1; node > 0; --node) {
+    const auto i = winners[2 * node];
+    const auto j = winners[(2 * node) + 1];
+    const auto i_wins = this->_keys[i] < this->_keys[j];
+    winners[node] = i_wins ? i : j;
+    this->_tree[node] = i_wins ? j : i;
+  }
+  this->_tree[0] = winners[1];
+}
+
+constexpr std::uint64_t LoserTree::pack_key(std::uint64_t bin1_id,
+                                            std::uint64_t bin2_id) noexcept {
+  return (bin1_id << 32U) | bin2_id;
+}
+
+constexpr std::uint64_t LoserTree::bin1_id(std::uint64_t key) noexcept { return key >> 32U; }
+
+constexpr std::uint64_t LoserTree::bin2_id(std::uint64_t key) noexcept {
+  return key & 0xFFFFFFFFULL;
+}
+
+inline bool LoserTree::done() const noexcept { return this->top_key() == EXHAUSTED; }
+
+inline std::size_t LoserTree::top() const noexcept { return this->_tree[0]; }
+
+inline std::uint64_t LoserTree::top_key() const noexcept { return this->_keys[this->_tree[0]]; }
+
+inline void LoserTree::replace_top(std::uint64_t key) noexcept {
+  auto winner = this->_tree[0];
+  this->_keys[winner] = key;
+  for (auto node = (winner + this->_keys.size()) / 2; node > 0; node /= 2) {
+    if (this->_keys[this->_tree[node]] < this->_keys[winner]) {
+      std::swap(this->_tree[node], winner);
+    }
+  }
+  this->_tree[0] = winner;
+}
+
+}  // namespace coolerpp::internal
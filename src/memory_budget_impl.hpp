@@ -0,0 +1,120 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+#include "coolerpp/chunk_cache.hpp"
+
+namespace coolerpp {
+
+inline std::size_t FileMemoryUsage::total() const noexcept {
+  return this->hdf5_chunk_caches + this->index + this->bin_table + this->weights +
+         this->write_buffers;
+}
+
+namespace internal {
+
+inline MemoryReservation::MemoryReservation(std::atomic<std::size_t> &counter,
+                                            std::size_t size_bytes) noexcept
+    : _counter(&counter), _size_bytes(size_bytes) {
+  this->_counter->fetch_add(this->_size_bytes, std::memory_order_relaxed);
+}
+
+inline MemoryReservation::~MemoryReservation() noexcept {
+  this->_counter->fetch_sub(this->_size_bytes, std::memory_order_relaxed);
+}
+
+inline std::size_t MemoryReservation::size() const noexcept { return this->_size_bytes; }
+
+}  // namespace internal
+
+inline std::size_t MemoryBudget::Usage::total() const noexcept {
+  return this->hdf5_chunk_caches + this->chunk_cache + this->buffer_pools;
+}
+
+inline MemoryBudget &MemoryBudget::instance() {
+  static MemoryBudget budget{};
+  return budget;
+}
+
+inline void MemoryBudget::set_limit(std::size_t limit_bytes) {
+  const auto old_limit = this->_limit_bytes.exchange(limit_bytes, std::memory_order_relaxed);
+  if (limit_bytes != 0 && (old_limit == 0 || limit_bytes < old_limit)) {
+    this->trim();
+  }
+}
+
+inline std::size_t MemoryBudget::limit() const noexcept {
+  return this->_limit_bytes.load(std::memory_order_relaxed);
+}
+
+inline bool MemoryBudget::enabled() const noexcept { return this->limit() != 0; }
+
+inline auto MemoryBudget::usage() const -> Usage {
+  return {this->limit(), this->_hdf5_chunk_caches.load(std::memory_order_relaxed),
+          ChunkCache::instance().stats().size_bytes,
+          this->_buffer_pools.load(std::memory_order_relaxed)};
+}
+
+inline std::size_t MemoryBudget::available() const {
+  if (!this->enabled()) {
+    return (std::numeric_limits<std::size_t>::max)();
+  }
+  const auto u = this->usage();
+  const auto used = u.total();
+  return u.limit_bytes > used ? u.limit_bytes - used : std::size_t(0);
+}
+
+inline std::size_t MemoryBudget::grant(std::size_t requested_bytes) {
+  if (!this->enabled()) {
+    return requested_bytes;
+  }
+  if (this->available() < requested_bytes) {
+    this->trim();
+  }
+  return (std::min)(requested_bytes, this->available());
+}
+
+inline auto MemoryBudget::reserve(std::size_t size_bytes)
+    -> std::shared_ptr<const internal::MemoryReservation> {
+  return std::make_shared<const internal::MemoryReservation>(this->_hdf5_chunk_caches,
+                                                             size_bytes);
+}
+
+inline void MemoryBudget::trim() {
+  const std::scoped_lock lck(this->_trim_mtx);
+  this->_trim_epoch.fetch_add(1, std::memory_order_relaxed);
+  if (!this->enabled()) {
+    return;
+  }
+
+  // Blocks cached by ChunkCache can be evicted right away, while idle pooled buffers are
+  // released lazily by the threads owning them
+  const auto limit = this->limit();
+  const auto reserved = this->_hdf5_chunk_caches.load(std::memory_order_relaxed) +
+                        this->_buffer_pools.load(std::memory_order_relaxed);
+  ChunkCache::instance().trim(limit > reserved ? limit - reserved : std::size_t(0));
+}
+
+inline void MemoryBudget::add_pooled_bytes(std::size_t size_bytes) noexcept {
+  this->_buffer_pools.fetch_add(size_bytes, std::memory_order_relaxed);
+}
+
+inline void MemoryBudget::remove_pooled_bytes(std::size_t size_bytes) noexcept {
+  this->_buffer_pools.fetch_sub(size_bytes, std::memory_order_relaxed);
+}
+
+inline std::uint64_t MemoryBudget::trim_epoch() const noexcept {
+  return this->_trim_epoch.load(std::memory_order_relaxed);
+}
+
+}  // namespace coolerpp
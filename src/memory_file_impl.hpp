@@ -0,0 +1,104 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <H5Fpublic.h>
+#include <H5Ppublic.h>
+// H5FDcore.h does not include the headers it depends on
+#include <H5FDcore.h>
+#include <fmt/format.h>
+
+#include <atomic>
+#include <cstddef>
+#include <highfive/H5File.hpp>
+#include <highfive/H5PropertyList.hpp>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace coolerpp::internal {
+
+// File access property selecting the core virtual file driver
+class CoreDriverProperty {
+  std::size_t _increment{};
+  bool _backing_store{};
+
+ public:
+  explicit CoreDriverProperty(const InMemoryOptions &options) noexcept
+      : _increment(options.increment_bytes), _backing_store(options.backing_store) {}
+
+  void apply(hid_t hid) const {
+    if (H5Pset_fapl_core(hid, this->_increment, this->_backing_store) < 0) {
+      throw std::runtime_error("failed to select the core virtual file driver");
+    }
+  }
+};
+
+// File access property setting the initial file image used by the core virtual file driver.
+// libhdf5 copies the image when the property is applied
+class FileImageProperty {
+  const void *_buff{};
+  std::size_t _size{};
+
+ public:
+  FileImageProperty(const void *buff, std::size_t size) noexcept : _buff(buff), _size(size) {}
+
+  void apply(hid_t hid) const {
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    if (H5Pset_file_image(hid, const_cast<void *>(this->_buff), this->_size) < 0) {
+      throw std::runtime_error("failed to initialize the file image");
+    }
+  }
+};
+
+inline HighFive::FileAccessProps init_in_memory_file_access_props(const InMemoryOptions &options) {
+  if (options.increment_bytes == 0) {
+    throw std::logic_error("increment_bytes cannot be zero");
+  }
+  HighFive::FileAccessProps props{};
+  props.add(CoreDriverProperty{options});
+  return props;
+}
+
+inline HighFive::File create_file_in_memory(std::string_view path,
+                                            const InMemoryOptions &options) {
+  // Truncating makes sure that the core driver does not load the content of existing files
+  return HighFive::File(std::string{path}, HighFive::File::Truncate,
+                        init_in_memory_file_access_props(options));
+}
+
+inline HighFive::File open_file_image(const void *buff, std::size_t size) {
+  if (!buff || size == 0) {
+    throw std::runtime_error("unable to open file image: image is empty");
+  }
+
+  // Files using the core driver are identified by their name, so opening two images with the same
+  // name would return the file that was opened first
+  static std::atomic<std::size_t> image_id{};
+  const auto name = fmt::format(FMT_STRING("coolerpp-file-image-{}.h5"), image_id++);
+
+  auto props = init_in_memory_file_access_props(InMemoryOptions{size, false});
+  props.add(FileImageProperty{buff, size});
+  return HighFive::File(name, HighFive::File::ReadOnly, props);
+}
+
+inline std::vector<std::byte> read_file_image(const HighFive::File &f) {
+  const auto size = H5Fget_file_image(f.getId(), nullptr, 0);
+  if (size < 0) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("failed to compute the size of the image of file \"{}\""),
+                    f.getName()));
+  }
+
+  std::vector<std::byte> buff(static_cast<std::size_t>(size));
+  if (H5Fget_file_image(f.getId(), buff.data(), buff.size()) < 0) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("failed to read the image of file \"{}\""), f.getName()));
+  }
+  return buff;
+}
+
+}  // namespace coolerpp::internal
@@ -0,0 +1,320 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/common.hpp"
+#include "coolerpp/coolerpp.hpp"
+#include "coolerpp/dataset.hpp"
+#include "coolerpp/internal/loser_tree.hpp"
+#include "coolerpp/pixel_selector.hpp"
+
+namespace coolerpp {
+
+template <typename N>
+inline bool MultiPixel<N>::operator==(const MultiPixel<N> &other) const noexcept {
+  return this->bin1_id == other.bin1_id && this->bin2_id == other.bin2_id &&
+         this->counts == other.counts;
+}
+
+template <typename N>
+inline bool MultiPixel<N>::operator!=(const MultiPixel<N> &other) const noexcept {
+  return !(*this == other);
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline MultiFileSelector<N, CHUNK_SIZE>::MultiFileSelector(const std::vector<File> &files,
+                                                           bool fill_zero,
+                                                           std::size_t num_threads)
+    : _fill_zero(fill_zero), _num_threads(num_threads) {
+  if (files.empty()) {
+    throw std::logic_error("MultiFileSelector requires at least one file");
+  }
+
+  const auto &clr1 = files.front();
+  for (std::size_t i = 1; i < files.size(); ++i) {
+    const auto &clr2 = files[i];
+    if (clr1.bins() != clr2.bins()) {
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("cooler \"{}\" and \"{}\" have different bin tables"), clr1.uri(),
+                      clr2.uri()));
+    }
+  }
+
+  // Keys store bin1_id and bin2_id in the upper and lower 32 bits respectively, and the largest
+  // key is reserved to mark files whose pixels have all been consumed
+  if (conditional_static_cast<std::uint64_t>(clr1.bins().size()) >=
+      (std::uint64_t(1) << 32U)) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("MultiFileSelector: cooler \"{}\" has too many bins ({})"), clr1.uri(),
+        clr1.bins().size()));
+  }
+
+  this->_selectors.reserve(files.size());
+  this->_symmetric_upper.reserve(files.size());
+  for (const auto &clr : files) {
+    this->_symmetric_upper.push_back(
+        clr.attributes().storage_mode.value_or("symmetric-upper") == "symmetric-upper");
+  }
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline MultiFileSelector<N, CHUNK_SIZE>::MultiFileSelector(const std::vector<File> &files,
+                                                           std::string_view query,
+                                                           File::QUERY_TYPE query_type,
+                                                           bool fill_zero,
+                                                           std::size_t num_threads)
+    : MultiFileSelector(files, fill_zero, num_threads) {
+  for (const auto &clr : files) {
+    this->_selectors.emplace_back(clr.fetch<N, CHUNK_SIZE>(query, query_type));
+  }
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline MultiFileSelector<N, CHUNK_SIZE>::MultiFileSelector(const std::vector<File> &files,
+                                                           std::string_view range1,
+                                                           std::string_view range2,
+                                                           File::QUERY_TYPE query_type,
+                                                           bool fill_zero,
+                                                           std::size_t num_threads)
+    : MultiFileSelector(files, fill_zero, num_threads) {
+  for (const auto &clr : files) {
+    this->_selectors.emplace_back(clr.fetch<N, CHUNK_SIZE>(range1, range2, query_type));
+  }
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline std::size_t MultiFileSelector<N, CHUNK_SIZE>::num_files() const noexcept {
+  return this->_selectors.size();
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline bool MultiFileSelector<N, CHUNK_SIZE>::fill_zero() const noexcept {
+  return this->_fill_zero;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline std::size_t MultiFileSelector<N, CHUNK_SIZE>::num_threads() const noexcept {
+  return this->_num_threads;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline const PixelCoordinates &MultiFileSelector<N, CHUNK_SIZE>::coord1() const noexcept {
+  assert(!this->_selectors.empty());
+  return this->_selectors.front().coord1();
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline const PixelCoordinates &MultiFileSelector<N, CHUNK_SIZE>::coord2() const noexcept {
+  assert(!this->_selectors.empty());
+  return this->_selectors.front().coord2();
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline std::uint64_t MultiFileSelector<N, CHUNK_SIZE>::num_rows() const noexcept {
+  return this->coord1().bin2.id() - this->coord1().bin1.id() + 1;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline std::uint64_t MultiFileSelector<N, CHUNK_SIZE>::num_cols() const noexcept {
+  return this->coord2().bin2.id() - this->coord2().bin1.id() + 1;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+template <typename BlockOp>
+inline void MultiFileSelector<N, CHUNK_SIZE>::for_each_block(BlockOp op,
+                                                             std::size_t max_block_size) const {
+  using internal::LoserTree;
+  max_block_size = (std::max)(std::size_t(1), max_block_size);
+
+  const auto blocks = this->read_files();
+  const auto k = blocks.size();
+
+  struct Cursor {
+    std::size_t block{};
+    std::size_t i{};
+  };
+  std::vector<Cursor> cursors(k);
+
+  auto next_key = [&](std::size_t src) {
+    auto &c = cursors[src];
+    const auto &src_blocks = blocks[src];
+    while (c.block < src_blocks.size() && c.i == src_blocks[c.block].size()) {
+      ++c.block;
+      c.i = 0;
+    }
+    return c.block == src_blocks.size()
+               ? LoserTree::EXHAUSTED
+               : LoserTree::pack_key(src_blocks[c.block].bin1_ids()[c.i],
+                                     src_blocks[c.block].bin2_ids()[c.i]);
+  };
+
+  std::vector<std::uint64_t> keys(k);
+  for (std::size_t src = 0; src < k; ++src) {
+    keys[src] = next_key(src);
+  }
+  LoserTree tree{std::move(keys)};
+
+  std::vector<std::uint64_t> bin1_buff{};
+  std::vector<std::uint64_t> bin2_buff{};
+  std::vector<N> count_buff{};
+  bin1_buff.reserve(max_block_size);
+  bin2_buff.reserve(max_block_size);
+  count_buff.reserve(max_block_size * k);
+
+  auto flush = [&]() {
+    if (!bin1_buff.empty()) {
+      op(bin1_buff, bin2_buff, count_buff);
+    }
+    bin1_buff.clear();
+    bin2_buff.clear();
+    count_buff.clear();
+  };
+
+  std::vector<N> counts(k);
+  while (!tree.done()) {
+    const auto key = tree.top_key();
+    std::fill(counts.begin(), counts.end(), N(0));
+    std::size_t num_files_with_pixel = 0;
+    do {
+      const auto src = tree.top();
+      auto &c = cursors[src];
+      counts[src] = blocks[src][c.block].counts()[c.i];
+      ++num_files_with_pixel;
+      ++c.i;
+      tree.replace_top(next_key(src));
+    } while (tree.top_key() == key);
+
+    if (!this->_fill_zero && num_files_with_pixel != k) {
+      continue;
+    }
+
+    bin1_buff.push_back(LoserTree::bin1_id(key));
+    bin2_buff.push_back(LoserTree::bin2_id(key));
+    count_buff.insert(count_buff.end(), counts.begin(), counts.end());
+    if (bin1_buff.size() == max_block_size) {
+      flush();
+    }
+  }
+
+  flush();
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline std::vector<MultiPixel<N>> MultiFileSelector<N, CHUNK_SIZE>::read_all() const {
+  const auto k = this->num_files();
+  std::vector<MultiPixel<N>> pixels{};
+  this->for_each_block([&](const auto &bin1_ids, const auto &bin2_ids, const auto &counts) {
+    for (std::size_t i = 0; i < bin1_ids.size(); ++i) {
+      const auto first = counts.begin() + std::ptrdiff_t(i * k);
+      pixels.push_back(
+          MultiPixel<N>{bin1_ids[i], bin2_ids[i], std::vector<N>(first, first + std::ptrdiff_t(k))});
+    }
+  });
+  return pixels;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline void MultiFileSelector<N, CHUNK_SIZE>::fetch_dense(N *out, std::size_t ld) const {
+  assert(out);
+  const auto row_offset = this->coord1().bin1.id();
+  const auto col_offset = this->coord2().bin1.id();
+  const auto num_rows = this->num_rows();
+  const auto num_cols = this->num_cols();
+
+  if (ld < num_cols) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("fetch_dense: ld should be >= {} (the number of columns), found {}"),
+                    num_cols, ld));
+  }
+
+  const auto cis = this->coord1() == this->coord2();
+  const auto blocks = this->read_files();
+  // NOLINTBEGIN(*-pointer-arithmetic)
+  for (std::size_t f = 0; f < blocks.size(); ++f) {
+    auto *matrix = out + (f * num_rows * ld);
+    for (std::uint64_t i = 0; i < num_rows; ++i) {
+      std::fill_n(matrix + (i * ld), num_cols, N(0));
+    }
+
+    const auto mirror = cis && this->_symmetric_upper[f];
+    for (const auto &blk : blocks[f]) {
+      const auto bin1_ids = blk.bin1_ids();
+      const auto bin2_ids = blk.bin2_ids();
+      const auto counts = blk.counts();
+      for (std::size_t i = 0; i < blk.size(); ++i) {
+        const auto bin1_id = bin1_ids[i];
+        const auto bin2_id = bin2_ids[i];
+        matrix[((bin1_id - row_offset) * ld) + (bin2_id - col_offset)] = counts[i];
+        if (mirror && bin1_id != bin2_id) {
+          matrix[((bin2_id - row_offset) * ld) + (bin1_id - col_offset)] = counts[i];
+        }
+      }
+    }
+  }
+  // NOLINTEND(*-pointer-arithmetic)
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto MultiFileSelector<N, CHUNK_SIZE>::read_files() const
+    -> std::vector<std::vector<PixelBlock<N>>> {
+  const auto k = this->_selectors.size();
+  std::vector<std::vector<PixelBlock<N>>> blocks(k);
+
+  auto num_threads =
+      this->_num_threads == 0
+          ? conditional_static_cast<std::size_t>((std::max)(1U, std::thread::hardware_concurrency()))
+          : this->_num_threads;
+  if (!internal::hdf5_library_is_threadsafe()) {
+    num_threads = 1;
+  }
+  num_threads = (std::min)(num_threads, k);
+
+  if (num_threads <= 1) {
+    for (std::size_t i = 0; i < k; ++i) {
+      blocks[i] = this->_selectors[i].read_batch();
+    }
+    return blocks;
+  }
+
+  // Files are handed out to threads through a shared counter, so that threads that are done
+  // querying a small file can move on to the next file
+  std::atomic<std::size_t> next_file{0};
+  auto worker = [&]() {
+    for (auto i = next_file++; i < k; i = next_file++) {
+      blocks[i] = this->_selectors[i].read_batch();
+    }
+  };
+
+  std::vector<std::future<void>> workers{};
+  workers.reserve(num_threads);
+  for (std::size_t i = 0; i < num_threads; ++i) {
+    workers.emplace_back(std::async(std::launch::async, worker));
+  }
+  // Wait for all threads before propagating exceptions, as threads reference local variables
+  for (auto &w : workers) {
+    w.wait();
+  }
+  for (auto &w : workers) {
+    w.get();
+  }
+
+  return blocks;
+}
+
+}  // namespace coolerpp
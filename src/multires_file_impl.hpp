@@ -0,0 +1,129 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <highfive/H5File.hpp>
+#include <highfive/H5Group.hpp>
+#include <highfive/H5Utility.hpp>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/coolerpp.hpp"
+#include "coolerpp/internal/numeric_utils.hpp"
+#include "coolerpp/remote.hpp"
+#include "coolerpp/validation.hpp"
+
+namespace coolerpp {
+
+inline MultiResFile::MultiResFile(HighFive::File fp, std::size_t cache_size_bytes, bool validate)
+    : _fp(std::make_unique<HighFive::File>(std::move(fp))),
+      _resolutions(read_resolutions(*_fp)),
+      _coolers(_resolutions.size()),
+      _cache_size_bytes(cache_size_bytes),
+      _validate(validate) {}
+
+inline MultiResFile MultiResFile::open_read_only(std::string_view path,
+                                                 std::size_t cache_size_bytes, bool validate) {
+  [[maybe_unused]] const HighFive::SilenceHDF5 silencer{};  // NOLINT
+  auto fp = internal::open_file_read_only(path);
+  if (validate) {
+    // Resolutions are validated once here instead of every time they are opened
+    const auto status = utils::is_multires_file(fp);
+    if (!status) {
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("\"{}\" does not look like a valid multi-resolution Cooler file:\n"
+                                 "Validation report:\n{}"),
+                      path, status));
+    }
+  }
+
+  return MultiResFile(std::move(fp), cache_size_bytes, validate);
+}
+
+inline MultiResFile::operator bool() const noexcept { return !!this->_fp; }
+
+inline std::string MultiResFile::path() const {
+  if (!*this) {
+    return "";
+  }
+  return this->_fp->getName();
+}
+
+inline auto MultiResFile::resolutions() const noexcept -> const std::vector<std::uint32_t> & {
+  return this->_resolutions;
+}
+
+inline bool MultiResFile::has_resolution(std::uint32_t resolution) const noexcept {
+  return std::binary_search(this->_resolutions.begin(), this->_resolutions.end(), resolution);
+}
+
+inline const File &MultiResFile::open(std::uint32_t resolution) const {
+  const auto i = this->resolution_idx(resolution);
+  auto &clr = this->_coolers[i];
+  if (!clr) {
+    assert(this->_fp);
+    const auto uri = fmt::format(FMT_STRING("{}::/resolutions/{}"), this->path(), resolution);
+    clr = std::unique_ptr<const File>(
+        new File(*this->_fp, uri, HighFive::File::ReadOnly,
+                 CacheOptions{AccessProfile::RANDOM, this->_cache_size_bytes}, this->_validate));
+  }
+  return *clr;
+}
+
+template <typename N>
+inline std::vector<ThinPixel<N>> MultiResFile::fetch_tile(std::uint32_t zoom, std::uint64_t x,
+                                                          std::uint64_t y) const {
+  if (zoom >= this->_resolutions.size()) {
+    throw std::out_of_range(
+        fmt::format(FMT_STRING("invalid zoom level {}: {} has {} zoom levels"), zoom,
+                    this->path(), this->_resolutions.size()));
+  }
+  const auto resolution = this->_resolutions[this->_resolutions.size() - 1 - zoom];
+  return this->open(resolution).fetch_tile<N>(x, y);
+}
+
+inline void MultiResFile::close() { *this = MultiResFile{}; }
+
+inline auto MultiResFile::read_resolutions(const HighFive::File &fp)
+    -> std::vector<std::uint32_t> {
+  [[maybe_unused]] const HighFive::SilenceHDF5 silencer{};  // NOLINT
+  std::vector<std::uint32_t> resolutions{};
+  try {
+    const auto names = fp.getGroup("/resolutions").listObjectNames();
+    std::transform(names.begin(), names.end(), std::back_inserter(resolutions),
+                   [](const auto &name) {
+                     return internal::parse_numeric_or_throw<std::uint32_t>(name);
+                   });
+  } catch (const std::exception &e) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("unable to read resolutions from file \"{}\": {}"), fp.getName(),
+                    e.what()));
+  }
+
+  std::sort(resolutions.begin(), resolutions.end());
+  return resolutions;
+}
+
+inline std::size_t MultiResFile::resolution_idx(std::uint32_t resolution) const {
+  const auto it =
+      std::lower_bound(this->_resolutions.begin(), this->_resolutions.end(), resolution);
+  if (it == this->_resolutions.end() || *it != resolution) {
+    throw std::out_of_range(fmt::format(FMT_STRING("file \"{}\" does not have resolution {}"),
+                                        this->path(), resolution));
+  }
+  return static_cast<std::size_t>(std::distance(this->_resolutions.begin(), it));
+}
+
+}  // namespace coolerpp
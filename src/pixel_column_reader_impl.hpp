@@ -0,0 +1,80 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace coolerpp::internal {
+
+template <typename N>
+inline PixelColumnReader<N>::PixelColumnReader(const Dataset &bin1_dset,
+                                               const Dataset &bin2_dset,
+                                               const Dataset &count_dset,
+                                               std::mutex *io_mtx) noexcept
+    : _bin1_dset(&bin1_dset), _bin2_dset(&bin2_dset), _count_dset(&count_dset), _io_mtx(io_mtx) {}
+
+template <typename N>
+inline void PixelColumnReader<N>::read(std::vector<std::uint64_t> &bin1_buff,
+                                       std::vector<std::uint64_t> &bin2_buff,
+                                       std::vector<N> &count_buff, std::size_t num,
+                                       std::size_t offset) {
+  if (!this->_io_mtx) {
+    this->_bin1_dset->read(bin1_buff, num, offset);
+    this->_bin2_dset->read(bin2_buff, num, offset);
+    this->_count_dset->read(count_buff, num, offset);
+    return;
+  }
+
+  std::array<Status, 3> status{Status::PENDING, Status::PENDING, Status::PENDING};
+  if (!this->_bin1_dset->reads_bypass_hdf5<std::uint64_t>() ||
+      !this->_bin2_dset->reads_bypass_hdf5<std::uint64_t>() ||
+      !this->_count_dset->reads_bypass_hdf5<N>()) {
+    [[maybe_unused]] const std::scoped_lock lck(*this->_io_mtx);
+    status[0] = fetch(*this->_bin1_dset, this->_chunks[0], bin1_buff, num, offset);
+    status[1] = fetch(*this->_bin2_dset, this->_chunks[1], bin2_buff, num, offset);
+    status[2] = fetch(*this->_count_dset, this->_chunks[2], count_buff, num, offset);
+  }
+
+  complete(status[0], *this->_bin1_dset, this->_chunks[0], bin1_buff, num, offset);
+  complete(status[1], *this->_bin2_dset, this->_chunks[1], bin2_buff, num, offset);
+  complete(status[2], *this->_count_dset, this->_chunks[2], count_buff, num, offset);
+}
+
+template <typename N>
+template <typename T>
+inline auto PixelColumnReader<N>::fetch(const Dataset &dset, RawChunks &chunks,
+                                        std::vector<T> &buff, std::size_t num,
+                                        std::size_t offset) -> Status {
+  if (dset.reads_bypass_hdf5<T>()) {
+    return Status::PENDING;
+  }
+  if (dset.fetch_chunks<T>(chunks, num, offset)) {
+    return Status::FETCHED;
+  }
+  dset.read(buff, num, offset);
+  return Status::DONE;
+}
+
+template <typename N>
+template <typename T>
+inline void PixelColumnReader<N>::complete(Status status, const Dataset &dset, RawChunks &chunks,
+                                           std::vector<T> &buff, std::size_t num,
+                                           std::size_t offset) {
+  switch (status) {
+    case Status::PENDING:
+      dset.read(buff, num, offset);
+      return;
+    case Status::FETCHED:
+      dset.decode_chunks(chunks, buff);
+      return;
+    case Status::DONE:
+      return;
+  }
+}
+
+}  // namespace coolerpp::internal
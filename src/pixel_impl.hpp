@@ -171,6 +171,38 @@ inline bool PixelCoordinates::operator>=(const PixelCoordinates &other) const no
   return this->bin1 >= other.bin1;
 }
 
+template <typename N>
+constexpr bool ThinPixel<N>::operator==(const ThinPixel<N> &other) const noexcept {
+  return this->bin1_id == other.bin1_id && this->bin2_id == other.bin2_id &&
+         this->count == other.count;
+}
+template <typename N>
+constexpr bool ThinPixel<N>::operator!=(const ThinPixel<N> &other) const noexcept {
+  return !(*this == other);
+}
+template <typename N>
+constexpr bool ThinPixel<N>::operator<(const ThinPixel<N> &other) const noexcept {
+  if (this->bin1_id != other.bin1_id) {
+    return this->bin1_id < other.bin1_id;
+  }
+  if (this->bin2_id != other.bin2_id) {
+    return this->bin2_id < other.bin2_id;
+  }
+  return this->count < other.count;
+}
+template <typename N>
+constexpr bool ThinPixel<N>::operator<=(const ThinPixel<N> &other) const noexcept {
+  return !(other < *this);
+}
+template <typename N>
+constexpr bool ThinPixel<N>::operator>(const ThinPixel<N> &other) const noexcept {
+  return other < *this;
+}
+template <typename N>
+constexpr bool ThinPixel<N>::operator>=(const ThinPixel<N> &other) const noexcept {
+  return !(*this < other);
+}
+
 template <typename N>
 inline Pixel<N>::Pixel(Bin bin, N count_) noexcept : Pixel(bin, std::move(bin), count_) {}
 
@@ -201,6 +233,15 @@ template <typename N>
 inline Pixel<N>::Pixel(const BinTable &bins, std::uint64_t bin1_id, std::uint64_t bin2_id, N count_)
     : Pixel(bins.at(bin1_id), bins.at(bin2_id), count_) {}
 
+template <typename N>
+inline Pixel<N>::Pixel(const BinTable &bins, const ThinPixel<N> &p)
+    : Pixel(bins, p.bin1_id, p.bin2_id, p.count) {}
+
+template <typename N>
+inline ThinPixel<N> Pixel<N>::to_thin() const noexcept {
+  return {this->coords.bin1.id(), this->coords.bin2.id(), this->count};
+}
+
 template <typename N>
 inline Pixel<N>::operator bool() const noexcept {
   return !!this->coords;
@@ -275,6 +316,23 @@ inline auto fmt::formatter<coolerpp::PixelCoordinates>::format(const coolerpp::P
   return fmt::format_to(ctx.out(), FMT_STRING("{:raw}\t{:raw}"), c.bin1, c.bin2);
 }
 
+template <typename N>
+constexpr auto fmt::formatter<coolerpp::ThinPixel<N>>::parse(format_parse_context &ctx)
+    -> decltype(ctx.begin()) {
+  if (ctx.begin() != ctx.end() && *ctx.begin() != '}') {
+    throw fmt::format_error("invalid format");
+  }
+  return ctx.begin();
+}
+
+template <typename N>
+template <typename FormatContext>
+inline auto fmt::formatter<coolerpp::ThinPixel<N>>::format(const coolerpp::ThinPixel<N> &p,
+                                                           FormatContext &ctx) const
+    -> decltype(ctx.out()) {
+  return fmt::format_to(ctx.out(), FMT_STRING("{}\t{}\t{}"), p.bin1_id, p.bin2_id, p.count);
+}
+
 template <typename N>
 constexpr auto fmt::formatter<coolerpp::Pixel<N>>::parse(format_parse_context &ctx)
     -> decltype(ctx.begin()) {
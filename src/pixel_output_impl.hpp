@@ -0,0 +1,176 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "coolerpp/bin_table.hpp"
+#include "coolerpp/chromosome.hpp"
+#include "coolerpp/common.hpp"
+#include "coolerpp/pixel.hpp"
+
+namespace coolerpp::io {
+
+inline void PixelFileWriter::FileCloser::operator()(std::FILE* fp) const noexcept {
+  if (fp && fp != stdout) {
+    std::fclose(fp);  // NOLINT(cert-err33-c)
+  }
+}
+
+inline PixelFileWriter::PixelFileWriter(std::string_view path, const BinTable& bins,
+                                        OutputFormat format, std::size_t buffer_size)
+    : _path(path == "-" ? "stdout" : std::string{path}),
+      _bins(&bins),
+      _format(format),
+      _buffer_size((std::max)(std::size_t(1), buffer_size)) {
+  // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+  this->_fp.reset(path == "-" ? stdout : std::fopen(this->_path.c_str(), "wb"));
+  if (!this->_fp) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("unable to open file {} for writing"), this->_path));
+  }
+
+  // Reserve some extra space so that the buffer does not need to grow before being flushed
+  this->_buffer.reserve(this->_buffer_size + 4096);
+  for (const Chromosome& chrom : bins.chromosomes()) {
+    if (chrom.id() >= this->_chrom_prefixes.size()) {
+      this->_chrom_prefixes.resize(chrom.id() + 1);
+    }
+    this->_chrom_prefixes[chrom.id()] = fmt::format(FMT_STRING("{}\t"), chrom.name());
+  }
+}
+
+inline PixelFileWriter::~PixelFileWriter() noexcept {
+  try {
+    if (this->_fp) {
+      this->flush();
+    }
+  } catch (...) {  // NOLINT(bugprone-empty-catch)
+  }
+}
+
+inline auto PixelFileWriter::format() const noexcept -> OutputFormat { return this->_format; }
+
+template <typename N>
+inline void PixelFileWriter::write(const Pixel<N>& pixel) {
+  static_assert(std::is_arithmetic_v<N>);
+  if (this->_format == OutputFormat::BG2) {
+    this->write_bin(pixel.coords.bin1);
+    this->write_bin(pixel.coords.bin2);
+    this->write_count(pixel.count);
+    this->maybe_flush();
+    return;
+  }
+  this->write(pixel.coords.bin1.id(), pixel.coords.bin2.id(), pixel.count);
+}
+
+template <typename N>
+inline void PixelFileWriter::write(const ThinPixel<N>& pixel) {
+  this->write(pixel.bin1_id, pixel.bin2_id, pixel.count);
+}
+
+template <typename N>
+inline void PixelFileWriter::write(std::uint64_t bin1_id, std::uint64_t bin2_id, N count) {
+  static_assert(std::is_arithmetic_v<N>);
+  switch (this->_format) {
+    case OutputFormat::BG2:
+      this->write(Pixel<N>{this->_bins->at(bin1_id), this->_bins->at(bin2_id), count});
+      return;
+    case OutputFormat::RAW: {
+      const fmt::format_int bin1_str{bin1_id};
+      const fmt::format_int bin2_str{bin2_id};
+      this->_buffer.append(bin1_str.data(), bin1_str.data() + bin1_str.size());
+      this->_buffer.push_back('\t');
+      this->_buffer.append(bin2_str.data(), bin2_str.data() + bin2_str.size());
+      this->_buffer.push_back('\t');
+      this->write_count(count);
+      break;
+    }
+    case OutputFormat::BINARY:
+      if constexpr (std::is_integral_v<N>) {
+        const auto count_ = conditional_static_cast<std::int64_t>(count);
+        this->write_binary(bin1_id, bin2_id, &count_, sizeof(count_));
+      } else {
+        const auto count_ = conditional_static_cast<double>(count);
+        this->write_binary(bin1_id, bin2_id, &count_, sizeof(count_));
+      }
+      break;
+  }
+  this->maybe_flush();
+}
+
+template <typename PixelIt>
+inline void PixelFileWriter::write(PixelIt first_pixel, PixelIt last_pixel) {
+  std::for_each(first_pixel, last_pixel, [&](const auto& pixel) { this->write(pixel); });
+}
+
+inline void PixelFileWriter::flush() {
+  if (this->_buffer.size() != 0 &&
+      std::fwrite(this->_buffer.data(), 1, this->_buffer.size(), this->_fp.get()) !=
+          this->_buffer.size()) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("an error occurred while writing pixels to {}"), this->_path));
+  }
+  this->_buffer.clear();
+  if (std::fflush(this->_fp.get()) != 0) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("an error occurred while writing pixels to {}"), this->_path));
+  }
+}
+
+inline void PixelFileWriter::write_bin(const Bin& bin) {
+  const auto& prefix = this->_chrom_prefixes[bin.chrom().id()];
+  this->_buffer.append(prefix.data(), prefix.data() + prefix.size());
+  fmt::format_to(std::back_inserter(this->_buffer), FMT_COMPILE("{}\t{}\t"), bin.start(),
+                 bin.end());
+}
+
+template <typename N>
+inline void PixelFileWriter::write_count(N count) {
+  if constexpr (std::is_integral_v<N>) {
+    const fmt::format_int count_str{count};
+    this->_buffer.append(count_str.data(), count_str.data() + count_str.size());
+    this->_buffer.push_back('\n');
+  } else {
+    fmt::format_to(std::back_inserter(this->_buffer), FMT_COMPILE("{}\n"), count);
+  }
+}
+
+inline void PixelFileWriter::write_binary(std::uint64_t bin1_id, std::uint64_t bin2_id,
+                                      const void* count, std::size_t count_size) {
+  // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+  this->_buffer.append(reinterpret_cast<const char*>(&bin1_id),
+                       reinterpret_cast<const char*>(&bin1_id) + sizeof(bin1_id));
+  this->_buffer.append(reinterpret_cast<const char*>(&bin2_id),
+                       reinterpret_cast<const char*>(&bin2_id) + sizeof(bin2_id));
+  // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+  const auto* count_ = static_cast<const char*>(count);
+  this->_buffer.append(count_, count_ + count_size);
+}
+
+inline void PixelFileWriter::maybe_flush() {
+  if (this->_buffer.size() >= this->_buffer_size) {
+    // Blocks larger than the stdio buffer are written directly, without extra copies
+    if (std::fwrite(this->_buffer.data(), 1, this->_buffer.size(), this->_fp.get()) !=
+        this->_buffer.size()) {
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("an error occurred while writing pixels to {}"), this->_path));
+    }
+    this->_buffer.clear();
+  }
+}
+
+}  // namespace coolerpp::io
@@ -0,0 +1,338 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "coolerpp/bin_table.hpp"
+#include "coolerpp/chromosome.hpp"
+#include "coolerpp/internal/numeric_utils.hpp"
+
+namespace coolerpp::io {
+
+inline PixelFormat parse_pixel_format(std::string_view format) {
+  if (format == "bg2") {
+    return PixelFormat::BG2;
+  }
+  if (format == "coo") {
+    return PixelFormat::COO;
+  }
+  if (format == "validpairs") {
+    return PixelFormat::VALIDPAIRS;
+  }
+  throw std::runtime_error(fmt::format(
+      FMT_STRING("unknown pixel format \"{}\": valid formats are bg2, coo and validpairs"),
+      format));
+}
+
+template <typename N>
+inline std::size_t PixelBatch<N>::size() const noexcept {
+  return this->bin1_ids.size();
+}
+
+template <typename N>
+inline bool PixelBatch<N>::empty() const noexcept {
+  return this->size() == 0;
+}
+
+template <typename N>
+inline void PixelBatch<N>::clear() noexcept {
+  this->bin1_ids.clear();
+  this->bin2_ids.clear();
+  this->counts.clear();
+}
+
+template <typename N>
+inline void PixelBatch<N>::reserve(std::size_t capacity) {
+  this->bin1_ids.reserve(capacity);
+  this->bin2_ids.reserve(capacity);
+  this->counts.reserve(capacity);
+}
+
+template <typename N>
+inline void PixelParser<N>::FileCloser::operator()(std::FILE* fp) const noexcept {
+  if (fp && fp != stdin) {
+    std::fclose(fp);  // NOLINT(cert-err33-c)
+  }
+}
+
+template <typename N>
+inline PixelParser<N>::PixelParser(std::string_view path, const BinTable& bins,
+                                   PixelFormat format, std::size_t buffer_size)
+    : _path(path == "-" ? "stdin" : std::string{path}),
+      _bins(&bins),
+      _format(format),
+      _buffer((std::max)(std::size_t(1), buffer_size)) {
+  static_assert(std::is_arithmetic_v<N>);
+  // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+  this->_fp.reset(path == "-" ? stdin : std::fopen(this->_path.c_str(), "rb"));
+  if (!this->_fp) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("unable to open file {} for reading"), this->_path));
+  }
+}
+
+template <typename N>
+inline auto PixelParser<N>::format() const noexcept -> PixelFormat {
+  return this->_format;
+}
+
+template <typename N>
+inline std::size_t PixelParser<N>::line_number() const noexcept {
+  return this->_line_number;
+}
+
+template <typename N>
+inline std::size_t PixelParser<N>::read_batch(PixelBatch<N>& batch, std::size_t max_pixels) {
+  const auto initial_size = batch.size();
+  std::string_view line{};
+  while (batch.size() - initial_size < max_pixels && this->next_line(line)) {
+    try {
+      this->parse_line(line, batch);
+    } catch (const std::exception& e) {
+      throw std::runtime_error(fmt::format(
+          FMT_STRING("failed to parse line {} from {} (\"{}\"): {}"), this->_line_number,
+          this->_path, line, e.what()));
+    }
+  }
+  return batch.size() - initial_size;
+}
+
+template <typename N>
+template <typename BatchOp>
+inline void PixelParser<N>::for_each_batch(BatchOp op, std::size_t batch_size, bool async) {
+  batch_size = (std::max)(std::size_t(1), batch_size);
+  auto parse_batch = [this, batch_size](PixelBatch<N> batch) {
+    batch.clear();
+    batch.reserve(batch_size);
+    this->read_batch(batch, batch_size);
+    return batch;
+  };
+
+  if (!async) {
+    PixelBatch<N> batch{};
+    while (true) {
+      batch = parse_batch(std::move(batch));
+      if (batch.empty()) {
+        return;
+      }
+      op(std::as_const(batch));
+    }
+  }
+
+  // Double buffering: the parser thread fills one batch while op consumes the other.
+  // Destroying the future blocks until the parser is done, so the parser never outlives *this
+  PixelBatch<N> spare{};
+  auto next_batch = std::async(std::launch::async, parse_batch, PixelBatch<N>{});
+  while (true) {
+    auto batch = next_batch.get();
+    if (batch.empty()) {
+      return;
+    }
+    next_batch = std::async(std::launch::async, parse_batch, std::move(spare));
+    op(std::as_const(batch));
+    spare = std::move(batch);
+  }
+}
+
+template <typename N>
+inline bool PixelParser<N>::next_line(std::string_view& line) {
+  while (true) {
+    const auto* first = this->_buffer.data() + this->_begin;
+    const auto* last = this->_buffer.data() + this->_end;
+    const auto* eol = static_cast<const char*>(std::memchr(first, '\n', std::size_t(last - first)));
+    if (!eol) {
+      if (this->fill_buffer()) {
+        continue;
+      }
+      // fill_buffer() may have moved the pending data to the front of the buffer
+      first = this->_buffer.data() + this->_begin;
+      last = this->_buffer.data() + this->_end;
+      if (first == last) {
+        return false;
+      }
+      // Last line is not terminated by a newline
+      eol = last;
+    }
+
+    line = std::string_view{first, std::size_t(eol - first)};
+    this->_begin = (std::min)(this->_end, this->_begin + line.size() + 1);
+    ++this->_line_number;
+
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+    if (!line.empty() && line.front() != '#') {
+      return true;
+    }
+  }
+}
+
+// Move the partial line at the end of the buffer to the front and read as much data as possible.
+// Return false when no data could be read
+template <typename N>
+inline bool PixelParser<N>::fill_buffer() {
+  if (this->_eof) {
+    return false;
+  }
+
+  const auto num_pending = this->_end - this->_begin;
+  if (num_pending == this->_buffer.size()) {
+    // Line does not fit in the buffer
+    this->_buffer.resize(this->_buffer.size() * 2);
+  } else if (this->_begin != 0) {
+    std::memmove(this->_buffer.data(), this->_buffer.data() + this->_begin, num_pending);
+  }
+  this->_begin = 0;
+  this->_end = num_pending;
+
+  const auto num_read = std::fread(this->_buffer.data() + this->_end, 1,
+                                   this->_buffer.size() - this->_end, this->_fp.get());
+  this->_end += num_read;
+  if (num_read < this->_buffer.size() - num_pending) {
+    if (std::ferror(this->_fp.get())) {
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("an error occurred while reading from {}"), this->_path));
+    }
+    this->_eof = std::feof(this->_fp.get()) != 0;
+  }
+  return num_read != 0;
+}
+
+template <typename N>
+inline void PixelParser<N>::parse_line(std::string_view line, PixelBatch<N>& batch) {
+  switch (this->_format) {
+    case PixelFormat::BG2:
+      this->parse_bg2(line, batch);
+      return;
+    case PixelFormat::COO:
+      this->parse_coo(line, batch);
+      return;
+    case PixelFormat::VALIDPAIRS:
+      this->parse_validpairs(line, batch);
+      return;
+  }
+  assert(false);
+}
+
+template <typename N>
+inline void PixelParser<N>::parse_bg2(std::string_view line, PixelBatch<N>& batch) {
+  const auto& chrom1 = this->find_chromosome(next_field(line), this->_chrom1);
+  const auto start1 = internal::parse_numeric_or_throw<std::uint32_t>(next_field(line));
+  std::ignore = next_field(line);
+
+  const auto& chrom2 = this->find_chromosome(next_field(line), this->_chrom2);
+  const auto start2 = internal::parse_numeric_or_throw<std::uint32_t>(next_field(line));
+  std::ignore = next_field(line);
+
+  const auto count = internal::parse_numeric_or_throw<N>(next_field(line));
+  push_back(batch, this->map_to_bin_id(chrom1, start1), this->map_to_bin_id(chrom2, start2),
+            count);
+}
+
+template <typename N>
+inline void PixelParser<N>::parse_coo(std::string_view line, PixelBatch<N>& batch) {
+  const auto bin1_id = internal::parse_numeric_or_throw<std::uint64_t>(next_field(line));
+  const auto bin2_id = internal::parse_numeric_or_throw<std::uint64_t>(next_field(line));
+  const auto count = internal::parse_numeric_or_throw<N>(next_field(line));
+
+  const auto num_bins = conditional_static_cast<std::uint64_t>(this->_bins->size());
+  if (bin1_id >= num_bins || bin2_id >= num_bins) {
+    throw std::out_of_range(fmt::format(
+        FMT_STRING("bin id {} not found: out of range"), (std::max)(bin1_id, bin2_id)));
+  }
+  push_back(batch, bin1_id, bin2_id, count);
+}
+
+template <typename N>
+inline void PixelParser<N>::parse_validpairs(std::string_view line, PixelBatch<N>& batch) {
+  std::ignore = next_field(line);  // read_id
+
+  const auto& chrom1 = this->find_chromosome(next_field(line), this->_chrom1);
+  const auto pos1 = internal::parse_numeric_or_throw<std::uint32_t>(next_field(line));
+  std::ignore = next_field(line);  // strand1
+
+  const auto& chrom2 = this->find_chromosome(next_field(line), this->_chrom2);
+  const auto pos2 = internal::parse_numeric_or_throw<std::uint32_t>(next_field(line));
+
+  if (pos1 == 0 || pos2 == 0) {
+    throw std::runtime_error("positions should be 1-based");
+  }
+  push_back(batch, this->map_to_bin_id(chrom1, pos1 - 1), this->map_to_bin_id(chrom2, pos2 - 1),
+            N(1));
+}
+
+template <typename N>
+inline const Chromosome& PixelParser<N>::find_chromosome(std::string_view name,
+                                                         const Chromosome*& hint) const {
+  // Consecutive lines usually refer to the same chromosome(s)
+  if (hint && hint->name() == name) {
+    return *hint;
+  }
+
+  const auto& chroms = this->_bins->chromosomes();
+  const auto match = chroms.find(name);
+  if (match == chroms.end()) {
+    throw std::out_of_range(fmt::format(FMT_STRING("chromosome \"{}\" not found"), name));
+  }
+  hint = &*match;
+  return *hint;
+}
+
+template <typename N>
+inline std::uint64_t PixelParser<N>::map_to_bin_id(const Chromosome& chrom,
+                                                   std::uint32_t pos) const {
+  if (pos >= chrom.size()) {
+    throw std::out_of_range(fmt::format(
+        FMT_STRING("position {} is outside of chromosome {} (size={})"), pos, chrom.name(),
+        chrom.size()));
+  }
+  if (this->_bins->bin_size() == 0) {
+    return this->_bins->map_to_bin_id(chrom, pos);
+  }
+  return this->_bins->num_bin_prefix_sum()[chrom.id()] + (pos / this->_bins->bin_size());
+}
+
+template <typename N>
+inline void PixelParser<N>::push_back(PixelBatch<N>& batch, std::uint64_t bin1_id,
+                                      std::uint64_t bin2_id, N count) {
+  if (bin1_id > bin2_id) {
+    std::swap(bin1_id, bin2_id);
+  }
+  batch.bin1_ids.push_back(bin1_id);
+  batch.bin2_ids.push_back(bin2_id);
+  batch.counts.push_back(count);
+}
+
+template <typename N>
+inline std::string_view PixelParser<N>::next_field(std::string_view& line) {
+  if (line.empty()) {
+    throw std::runtime_error("line has fewer fields than expected");
+  }
+  const auto* sep = static_cast<const char*>(std::memchr(line.data(), '\t', line.size()));
+  if (!sep) {
+    const auto field = line;
+    line = {};
+    return field;
+  }
+  const auto field = line.substr(0, std::size_t(sep - line.data()));
+  line.remove_prefix(field.size() + 1);
+  return field;
+}
+
+}  // namespace coolerpp::io
@@ -4,16 +4,129 @@
 
 #pragma once
 
+#include <fmt/format.h>
+
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 #include "coolerpp/bin_table.hpp"
 #include "coolerpp/index.hpp"
 #include "coolerpp/internal/numeric_utils.hpp"
+#include "coolerpp/stats.hpp"
+#include "coolerpp/trace.hpp"
 
 namespace coolerpp {
 
+namespace internal {
+
+// Return the first bin of the chromosome of bin_id and the first bin of the next chromosome
+[[nodiscard]] inline std::pair<std::uint64_t, std::uint64_t> chrom_bin_range(
+    const BinTable &bins, std::uint64_t bin_id) {
+  const auto &prefix_sum = bins.num_bin_prefix_sum();
+  const auto chrom_idx = bins.map_to_chrom_idx(bin_id);
+  return std::make_pair(prefix_sum[chrom_idx], prefix_sum[chrom_idx + 1]);
+}
+
+// Pixels overlap the band only when both bins belong to the same chromosome
+[[nodiscard]] inline bool overlaps_band(const BinTable &bins, std::uint64_t bin1_id,
+                                        std::uint64_t bin2_id,
+                                        std::uint64_t max_diagonal_distance) {
+  if (max_diagonal_distance == (std::numeric_limits<std::uint64_t>::max)()) {
+    return true;
+  }
+  const auto distance = bin2_id >= bin1_id ? bin2_id - bin1_id : bin1_id - bin2_id;
+  if (distance > max_diagonal_distance) {
+    return false;
+  }
+  const auto [first_bin, last_bin] = chrom_bin_range(bins, bin1_id);
+  return bin2_id >= first_bin && bin2_id < last_bin;
+}
+
+template <typename N>
+[[nodiscard]] inline bool passes_filter(const PixelFilter &filter, const BinTable &bins,
+                                        std::uint64_t bin1_id, std::uint64_t bin2_id, N count) {
+  if (filter.min_count.has_value() && conditional_static_cast<double>(count) < *filter.min_count) {
+    return false;
+  }
+  if (filter.contact_type == ContactType::ALL) {
+    return true;
+  }
+  const auto [first_bin, last_bin] = chrom_bin_range(bins, bin1_id);
+  const auto cis = bin2_id >= first_bin && bin2_id < last_bin;
+  return cis == (filter.contact_type == ContactType::CIS);
+}
+
+}  // namespace internal
+
+template <typename N>
+inline PixelBlock<N>::PixelBlock(std::shared_ptr<const Index> index,
+                                 std::shared_ptr<const std::vector<BinIDT>> bin1_buff,
+                                 std::size_t bin1_offset,
+                                 std::shared_ptr<const std::vector<BinIDT>> bin2_buff,
+                                 std::size_t bin2_offset,
+                                 std::shared_ptr<const std::vector<N>> count_buff,
+                                 std::size_t count_offset, std::size_t size) noexcept
+    : _bin1_buff(std::move(bin1_buff)),
+      _bin2_buff(std::move(bin2_buff)),
+      _count_buff(std::move(count_buff)),
+      _bin1_ids(_bin1_buff->data() + bin1_offset, size),
+      _bin2_ids(_bin2_buff->data() + bin2_offset, size),
+      _counts(_count_buff->data() + count_offset, size),
+      _index(std::move(index)) {
+  assert(bin1_offset + size <= _bin1_buff->size());
+  assert(bin2_offset + size <= _bin2_buff->size());
+  assert(count_offset + size <= _count_buff->size());
+}
+
+template <typename N>
+inline std::size_t PixelBlock<N>::size() const noexcept {
+  return this->_counts.size();
+}
+
+template <typename N>
+inline bool PixelBlock<N>::empty() const noexcept {
+  return this->size() == 0;
+}
+
+template <typename N>
+inline auto PixelBlock<N>::bin1_ids() const noexcept -> internal::Span<BinIDT> {
+  return this->_bin1_ids;
+}
+
+template <typename N>
+inline auto PixelBlock<N>::bin2_ids() const noexcept -> internal::Span<BinIDT> {
+  return this->_bin2_ids;
+}
+
+template <typename N>
+inline auto PixelBlock<N>::counts() const noexcept -> internal::Span<N> {
+  return this->_counts;
+}
+
+template <typename N>
+inline Pixel<N> PixelBlock<N>::operator[](std::size_t i) const {
+  assert(this->_index);
+  return Pixel<N>{this->_index->bins(), this->_bin1_ids[i], this->_bin2_ids[i], this->_counts[i]};
+}
+
+template <typename N>
+inline Pixel<N> PixelBlock<N>::at(std::size_t i) const {
+  if (i >= this->size()) {
+    throw std::out_of_range(fmt::format(
+        FMT_STRING("PixelBlock::at(): index {} is out of range for a block of size {}"), i,
+        this->size()));
+  }
+  return (*this)[i];
+}
+
 template <typename N, std::size_t CHUNK_SIZE>
 inline PixelSelector<N, CHUNK_SIZE>::PixelSelector(std::shared_ptr<const Index> index,
                                                    const Dataset &pixels_bin1_id,
@@ -75,14 +188,40 @@ inline auto PixelSelector<N, CHUNK_SIZE>::end() const -> iterator {
 
 template <typename N, std::size_t CHUNK_SIZE>
 inline auto PixelSelector<N, CHUNK_SIZE>::cbegin() const -> iterator {
+  const internal::TraceScope trace_scope{"coolerpp::PixelSelector::begin"};
+  if (this->_coord1 && this->_filter.contact_type != ContactType::ALL) {
+    // Queries overlapping a single pair of chromosomes are made up of cis or trans pixels only
+    const auto &chrom1 = this->_coord1.bin1.chrom();
+    const auto &chrom2 = this->_coord2.bin1.chrom();
+    if (chrom1 == this->_coord1.bin2.chrom() && chrom2 == this->_coord2.bin2.chrom() &&
+        (chrom1 == chrom2) != (this->_filter.contact_type == ContactType::CIS)) {
+      return this->cend();
+    }
+  }
+
+  const auto banded = this->_max_diagonal_distance != (std::numeric_limits<std::uint64_t>::max)();
+  if (!this->_coord1 && banded) {
+    // Banded queries require coordinates: select the entire matrix
+    assert(!this->_coord2);
+    const auto &bins = this->_index->bins();
+    if (bins.size() == 0) {
+      return this->cend();
+    }
+    const PixelCoordinates coords{bins.at(0), bins.at(bins.size() - 1)};
+    return iterator{this->_index,         *this->_pixels_bin1_id,       *this->_pixels_bin2_id,
+                    *this->_pixels_count, coords,                       coords,
+                    this->_prefetch,      this->_max_diagonal_distance, this->_filter};
+  }
+
   if (!this->_coord1) {
     assert(!this->_coord2);
-    return iterator{this->_index, *this->_pixels_bin1_id, *this->_pixels_bin2_id,
-                    *this->_pixels_count};
+    return iterator{this->_index,         *this->_pixels_bin1_id, *this->_pixels_bin2_id,
+                    *this->_pixels_count, this->_prefetch,        this->_filter};
   }
 
-  return iterator{this->_index,         *this->_pixels_bin1_id, *this->_pixels_bin2_id,
-                  *this->_pixels_count, this->_coord1,          this->_coord2};
+  return iterator{this->_index,         *this->_pixels_bin1_id,       *this->_pixels_bin2_id,
+                  *this->_pixels_count, this->_coord1,                this->_coord2,
+                  this->_prefetch,      this->_max_diagonal_distance, this->_filter};
 }
 
 template <typename N, std::size_t CHUNK_SIZE>
@@ -91,6 +230,16 @@ inline auto PixelSelector<N, CHUNK_SIZE>::cend() const -> iterator {
                           *this->_pixels_count);
 }
 
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto PixelSelector<N, CHUNK_SIZE>::begin_thin() const -> thin_iterator {
+  return thin_iterator{this->cbegin()};
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto PixelSelector<N, CHUNK_SIZE>::end_thin() const -> thin_iterator {
+  return thin_iterator{this->cend()};
+}
+
 template <typename N, std::size_t CHUNK_SIZE>
 inline const PixelCoordinates &PixelSelector<N, CHUNK_SIZE>::coord1() const noexcept {
   return this->_coord1;
@@ -101,16 +250,121 @@ inline const PixelCoordinates &PixelSelector<N, CHUNK_SIZE>::coord2() const noex
   return this->_coord2;
 }
 
+template <typename N, std::size_t CHUNK_SIZE>
+inline void PixelSelector<N, CHUNK_SIZE>::enable_prefetch(bool flag) noexcept {
+  this->_prefetch = flag;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline bool PixelSelector<N, CHUNK_SIZE>::prefetch_enabled() const noexcept {
+  return this->_prefetch;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline void PixelSelector<N, CHUNK_SIZE>::set_max_diagonal_distance(
+    std::uint64_t num_bins) noexcept {
+  this->_max_diagonal_distance = num_bins;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline std::uint64_t PixelSelector<N, CHUNK_SIZE>::max_diagonal_distance() const noexcept {
+  return this->_max_diagonal_distance;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline void PixelSelector<N, CHUNK_SIZE>::set_filter(PixelFilter filter) noexcept {
+  this->_filter = std::move(filter);
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline const PixelFilter &PixelSelector<N, CHUNK_SIZE>::filter() const noexcept {
+  return this->_filter;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+template <typename BlockOp>
+inline void PixelSelector<N, CHUNK_SIZE>::for_each_block(BlockOp op,
+                                                         std::size_t max_block_size) const {
+  auto first = this->begin();
+  auto last = this->end();
+  while (first != last) {
+    op(first.read_block(max_block_size));
+  }
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto PixelSelector<N, CHUNK_SIZE>::read_batch(std::size_t max_block_size) const
+    -> std::vector<PixelBlock<N>> {
+  std::vector<PixelBlock<N>> blocks{};
+  this->for_each_block([&](PixelBlock<N> blk) { blocks.emplace_back(std::move(blk)); },
+                       max_block_size);
+  return blocks;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline SparseMatrixCSR<N> PixelSelector<N, CHUNK_SIZE>::read_csr() const {
+  const auto num_bins = conditional_static_cast<std::uint64_t>(this->_index->bins().size());
+  const auto first_row = this->_coord1 ? this->_coord1.bin1.id() : 0;
+  const auto last_row = this->_coord1 ? this->_coord1.bin2.id() + 1 : num_bins;
+  const auto first_col = this->_coord2 ? this->_coord2.bin1.id() : 0;
+  const auto last_col = this->_coord2 ? this->_coord2.bin2.id() + 1 : num_bins;
+  const auto num_rows = conditional_static_cast<std::size_t>(last_row - first_row);
+
+  std::vector<std::uint64_t> row_offsets(num_rows + 1);
+  for (std::size_t i = 0; i < row_offsets.size(); ++i) {
+    row_offsets[i] = this->_index->get_offset_by_bin_id(first_row + i);
+  }
+
+  std::vector<std::uint64_t> col_ids{};
+  std::vector<N> values{};
+  const auto first_offset = conditional_static_cast<std::size_t>(row_offsets.front());
+  const auto num_pixels = conditional_static_cast<std::size_t>(row_offsets.back()) - first_offset;
+  if (num_pixels != 0) {
+    this->_pixels_bin2_id->read(col_ids, num_pixels, first_offset);
+    this->_pixels_count->read(values, num_pixels, first_offset);
+  }
+
+  // Drop pixels that do not overlap coord2 or the band in-place, rebasing bin2_ids on first_col
+  std::vector<std::uint64_t> row_ptrs(num_rows + 1, 0);
+  std::size_t j = 0;
+  for (std::size_t i = 0; i < num_rows; ++i) {
+    const auto bin1_id = first_row + i;
+    for (auto k = row_offsets[i] - first_offset; k < row_offsets[i + 1] - first_offset; ++k) {
+      const auto bin2_id = col_ids[k];
+      if (bin2_id >= first_col && bin2_id < last_col &&
+          internal::overlaps_band(this->_index->bins(), bin1_id, bin2_id,
+                                  this->_max_diagonal_distance) &&
+          internal::passes_filter(this->_filter, this->_index->bins(), bin1_id, bin2_id,
+                                  values[k])) {
+        col_ids[j] = bin2_id - first_col;
+        values[j++] = values[k];
+      }
+    }
+    row_ptrs[i + 1] = j;
+  }
+  col_ids.resize(j);
+  values.resize(j);
+
+  return {first_row,           first_col,          num_rows,         last_col - first_col,
+          std::move(row_ptrs), std::move(col_ids), std::move(values)};
+}
+
 template <typename N, std::size_t CHUNK_SIZE>
 inline PixelSelector<N, CHUNK_SIZE>::iterator::iterator(std::shared_ptr<const Index> index,
                                                         const Dataset &pixels_bin1_id,
                                                         const Dataset &pixels_bin2_id,
-                                                        const Dataset &pixels_count)
-    : _bin1_id_it(pixels_bin1_id.begin<BinIDT, CHUNK_SIZE>()),
-      _bin2_id_it(pixels_bin2_id.begin<BinIDT, CHUNK_SIZE>()),
-      _count_it(pixels_count.begin<N, CHUNK_SIZE>()),
+                                                        const Dataset &pixels_count,
+                                                        bool prefetch, PixelFilter filter)
+    : _bin1_id_it(pixels_bin1_id.begin<BinIDT, CHUNK_SIZE>(prefetch)),
+      _bin2_id_it(pixels_bin2_id.begin<BinIDT, CHUNK_SIZE>(prefetch)),
+      _count_it(pixels_count.begin<N, CHUNK_SIZE>(prefetch)),
       _index(std::move(index)),
-      _h5_end_offset(pixels_bin2_id.size()) {}
+      _h5_end_offset(pixels_bin2_id.size()),
+      _filter(std::move(filter)) {
+  if (!this->is_at_end() && !this->passes_filter()) {
+    this->jump_to_next_match();
+  }
+}
 
 template <typename N, std::size_t CHUNK_SIZE>
 inline PixelSelector<N, CHUNK_SIZE>::iterator::iterator(std::shared_ptr<const Index> index,
@@ -118,21 +372,34 @@ inline PixelSelector<N, CHUNK_SIZE>::iterator::iterator(std::shared_ptr<const In
                                                         const Dataset &pixels_bin2_id,
                                                         const Dataset &pixels_count,
                                                         PixelCoordinates coord1,
-                                                        PixelCoordinates coord2)
+                                                        PixelCoordinates coord2,
+                                                        bool prefetch,
+                                                        std::uint64_t max_diagonal_distance,
+                                                        PixelFilter filter)
     : _index(std::move(index)),
       _coord1(std::move(coord1)),
       _coord2(std::move(coord2)),
-      _h5_end_offset(pixels_bin2_id.size()) {
+      _h5_end_offset(pixels_bin2_id.size()),
+      _max_diagonal_distance(max_diagonal_distance),
+      _filter(std::move(filter)) {
   assert(_coord1);
   assert(_coord2);
   assert(_coord1.bin1.id() <= _coord1.bin2.id());
   assert(_coord2.bin1.id() <= _coord2.bin2.id());
 
-  // Set iterator to the first row overlapping the query (i.e. the first bin overlapping coord1)
+  // Set iterator to the first row overlapping the query (i.e. the first bin overlapping coord1).
+  // Blocks are sized based on the number of pixels stored in the rows overlapping the query, so
+  // that narrow queries do not read CHUNK_SIZE pixels
   auto offset = _index->get_offset_by_bin_id(_coord1.bin1.id());
-  _bin1_id_it = pixels_bin1_id.make_iterator_at_offset<BinIDT, CHUNK_SIZE>(offset);
-  _bin2_id_it = pixels_bin2_id.make_iterator_at_offset<BinIDT, CHUNK_SIZE>(offset);
-  _count_it = pixels_count.make_iterator_at_offset<N, CHUNK_SIZE>(offset);
+  const auto block_size = internal::adaptive_block_size(
+      conditional_static_cast<std::size_t>(_index->get_offset_by_bin_id(_coord1.bin2.id() + 1) -
+                                           offset),
+      CHUNK_SIZE);
+  _bin1_id_it =
+      pixels_bin1_id.make_iterator_at_offset<BinIDT, CHUNK_SIZE>(offset, prefetch, block_size);
+  _bin2_id_it =
+      pixels_bin2_id.make_iterator_at_offset<BinIDT, CHUNK_SIZE>(offset, prefetch, block_size);
+  _count_it = pixels_count.make_iterator_at_offset<N, CHUNK_SIZE>(offset, prefetch, block_size);
 
   // Now that last it is set, we can call jump_to_col() to seek to the first pixel actually
   // overlapping the query. Calling jump_to_next_overlap() is required to deal with rows that are
@@ -141,6 +408,9 @@ inline PixelSelector<N, CHUNK_SIZE>::iterator::iterator(std::shared_ptr<const In
   if (this->discard()) {
     this->jump_to_next_overlap();
   }
+  if (!this->is_at_end() && !this->passes_filter()) {
+    this->jump_to_next_match();
+  }
 
   if (this->is_at_end()) {
     *this = at_end(std::move(this->_index), pixels_bin1_id, pixels_bin2_id, pixels_count);
@@ -229,6 +499,9 @@ inline auto PixelSelector<N, CHUNK_SIZE>::iterator::operator++() -> iterator & {
   if (this->discard()) {
     this->jump_to_next_overlap();
   }
+  if (!this->is_at_end() && !this->passes_filter()) {
+    this->jump_to_next_match();
+  }
 
   return *this;
 }
@@ -243,6 +516,82 @@ inline auto PixelSelector<N, CHUNK_SIZE>::iterator::operator++(int) -> iterator
   return it;
 }
 
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto PixelSelector<N, CHUNK_SIZE>::iterator::read_block(std::size_t max_size)
+    -> PixelBlock<N> {
+  assert(!this->is_at_end());
+  assert(max_size != 0);
+
+  // Holding a reference to the chunks prevents Dataset::iterator from recycling them
+  auto bin1_buff = this->_bin1_id_it.underlying_buff();
+  auto bin2_buff = this->_bin2_id_it.underlying_buff();
+  auto count_buff = this->_count_it.underlying_buff();
+
+  const auto bin1_offset = this->_bin1_id_it.underlying_buff_offset();
+  const auto bin2_offset = this->_bin2_id_it.underlying_buff_offset();
+  const auto count_offset = this->_count_it.underlying_buff_offset();
+
+  // clang-format off
+  const auto max_block_size = (std::min)({
+      max_size,
+      conditional_static_cast<std::size_t>(this->_h5_end_offset - this->h5_offset()),
+      this->_bin1_id_it.underlying_buff_num_available_fwd(),
+      this->_bin2_id_it.underlying_buff_num_available_fwd(),
+      this->_count_it.underlying_buff_num_available_fwd()
+  });
+  // clang-format on
+
+  // The first pixel is guaranteed to overlap the query: extend the block for as long as pixels
+  // keep overlapping the query
+  std::size_t size = 1;
+  if (!this->_coord1 && this->_filter.empty()) {
+    size = max_block_size;
+  } else {
+    const auto *bin1_ids = bin1_buff->data() + bin1_offset;
+    const auto *bin2_ids = bin2_buff->data() + bin2_offset;
+    const auto *counts = count_buff->data() + count_offset;
+    for (; size < max_block_size; ++size) {
+      const auto bin1_id = bin1_ids[size];  // NOLINT
+      const auto bin2_id = bin2_ids[size];  // NOLINT
+      // clang-format off
+      const auto overlaps = !this->_coord1 ||
+                            (bin1_id >= this->_coord1.bin1.id() &&
+                             bin1_id <= this->_coord1.bin2.id() &&
+                             bin2_id >= this->_coord2.bin1.id() &&
+                             bin2_id <= this->_coord2.bin2.id() &&
+                             this->overlaps_band(bin1_id, bin2_id));
+      // clang-format on
+      if (!overlaps || !internal::passes_filter(this->_filter, this->_index->bins(), bin1_id,
+                                                bin2_id, counts[size])) {  // NOLINT
+        break;
+      }
+    }
+  }
+
+  PixelBlock<N> blk{this->_index,         std::move(bin1_buff),  bin1_offset,
+                    std::move(bin2_buff), bin2_offset,           std::move(count_buff),
+                    count_offset,         size};
+
+  // Move to the last pixel in the block, then let operator++ take care of seeking to the next
+  // pixel overlapping the query
+  this->_bin1_id_it += size - 1;
+  this->_bin2_id_it += size - 1;
+  this->_count_it += size - 1;
+  std::ignore = ++(*this);
+
+  return blk;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto PixelSelector<N, CHUNK_SIZE>::iterator::read_block(const iterator &last,
+                                                               std::size_t max_size)
+    -> PixelBlock<N> {
+  assert(*this < last);
+  const auto num_available = conditional_static_cast<std::size_t>(last.h5_offset()) -
+                             conditional_static_cast<std::size_t>(this->h5_offset());
+  return this->read_block((std::min)(max_size, num_available));
+}
+
 template <typename N, std::size_t CHUNK_SIZE>
 inline void PixelSelector<N, CHUNK_SIZE>::iterator::jump_to_row(std::uint64_t bin_id) {
   assert(this->_index);
@@ -252,6 +601,13 @@ inline void PixelSelector<N, CHUNK_SIZE>::iterator::jump_to_row(std::uint64_t bi
     return;
   }
 
+  const internal::TraceScope trace_scope{"coolerpp::PixelSelector::iterator::jump_to_row"};
+  if constexpr (STATS_ENABLED) {
+    if (auto *counters = this->_bin1_id_it.dataset().io_counters(); counters) {
+      counters->add_row_seek();
+    }
+  }
+
   const auto row_offset = this->_index->get_offset_by_bin_id(bin_id);
   const auto current_offset = this->h5_offset();
 
@@ -272,11 +628,17 @@ inline void PixelSelector<N, CHUNK_SIZE>::iterator::jump_to_col(std::uint64_t bi
     return;
   }
 
+  const internal::TraceScope trace_scope{"coolerpp::PixelSelector::iterator::jump_to_col"};
+  if constexpr (STATS_ENABLED) {
+    if (auto *counters = this->_bin1_id_it.dataset().io_counters(); counters) {
+      counters->add_col_seek();
+    }
+  }
+
   const auto current_row = *this->_bin1_id_it;
   const auto next_row = current_row + 1;
 
   const auto current_offset = conditional_static_cast<std::uint64_t>(this->h5_offset());
-  const auto current_row_offset = this->_index->get_offset_by_bin_id(current_row);
   const auto next_row_offset = this->_index->get_offset_by_bin_id(next_row);
 
   if (current_offset == next_row_offset) {
@@ -284,34 +646,82 @@ inline void PixelSelector<N, CHUNK_SIZE>::iterator::jump_to_col(std::uint64_t bi
   }
 
   assert(next_row_offset != 0);
-  const auto row_start_offset = (std::min)(current_offset, current_row_offset);
   const auto row_end_offset = next_row_offset - 1;
 
-  if (row_start_offset == row_end_offset) {
-    return;  // Row is empty
+  // Pixels preceding the current pixel are never visited again: search forward starting from the
+  // current position
+  if (current_offset >= row_end_offset || *this->_bin2_id_it >= bin_id) {
+    return;
   }
 
-  auto first = this->_bin2_id_it + (row_start_offset - current_offset);
-  auto last = first + (row_end_offset - row_start_offset);
-  this->_bin2_id_it = std::lower_bound(first, last, bin_id);
-
-  const auto offset = this->_bin2_id_it.h5_offset() - current_offset;
+  const auto offset = this->seek_col(current_offset, row_end_offset, bin_id) - current_offset;
 
   this->_bin1_id_it += offset;
+  this->_bin2_id_it += offset;
   this->_count_it += offset;
 
   assert(*this->_bin1_id_it == current_row);
 }
 
+// Return the offset of the first pixel in (first_offset, last_offset] whose bin2_id is not less
+// than bin_id, or last_offset when there is no such pixel. The pixel at first_offset should have
+// bin2_id < bin_id.
+// The buffer already loaded by _bin2_id_it is searched first. Chunks outside of the buffer are
+// only read when the target is not found in the buffer: the last pixel of the range is checked
+// first, then the range is searched with an exponential (galloping) search followed by a binary
+// search, so that the number of chunks visited grows with the log of the distance to the target
 template <typename N, std::size_t CHUNK_SIZE>
-inline void PixelSelector<N, CHUNK_SIZE>::iterator::jump(std::uint64_t bin1_id,
-                                                         std::uint64_t bin2_id) {
-  assert(bin1_id <= bin2_id);
+inline std::uint64_t PixelSelector<N, CHUNK_SIZE>::iterator::seek_col(std::uint64_t first_offset,
+                                                                      std::uint64_t last_offset,
+                                                                      std::uint64_t bin_id) const {
+  assert(first_offset == this->h5_offset());
+  assert(first_offset < last_offset);
+
+  auto buff = this->_bin2_id_it.underlying_buff();
+  auto buff_start = first_offset - this->_bin2_id_it.underlying_buff_offset();
+  const auto buff_end = buff_start + buff->size();
+
+  auto bin2_id_at = [&](std::uint64_t offset) {
+    if (offset < buff_start || offset >= buff_start + buff->size()) {
+      const auto it =
+          this->_bin2_id_it + conditional_static_cast<std::size_t>(offset - first_offset);
+      buff = it.underlying_buff();
+      buff_start = offset - it.underlying_buff_offset();
+    }
+    return (*buff)[conditional_static_cast<std::size_t>(offset - buff_start)];
+  };
+
+  if (last_offset >= buff_end) {
+    if (bin2_id_at(buff_end - 1) >= bin_id) {
+      last_offset = buff_end - 1;
+    } else {
+      if (bin2_id_at(last_offset) < bin_id) {
+        return last_offset;
+      }
+      first_offset = buff_end - 1;
+    }
+  }
 
-  this->jump_to_row(bin1_id);
-  if (bin2_id != bin1_id) {
-    this->jump_to_col(bin2_id);
+  // Invariant: bin2_id_at(lo) < bin_id, and hi is a valid result
+  auto lo = first_offset;
+  auto hi = last_offset;
+  for (std::uint64_t step = 1; lo + step < hi; step *= 2) {
+    if (bin2_id_at(lo + step) >= bin_id) {
+      hi = lo + step;
+      break;
+    }
+    lo += step;
   }
+
+  while (hi - lo > 1) {
+    const auto mid = lo + ((hi - lo) / 2);
+    if (bin2_id_at(mid) < bin_id) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return hi;
 }
 
 template <typename N, std::size_t CHUNK_SIZE>
@@ -329,7 +739,6 @@ inline void PixelSelector<N, CHUNK_SIZE>::iterator::jump_to_next_overlap() {
     const auto row = *this->_bin1_id_it;
     const auto col = *this->_bin2_id_it;
     const auto next_row = row + 1;
-    const auto next_col = (std::max)(next_row, this->_coord2.bin1.id());
 
     // We may have some data left to read from the current row
     if (col < this->_coord2.bin1.id()) {
@@ -347,7 +756,14 @@ inline void PixelSelector<N, CHUNK_SIZE>::iterator::jump_to_next_overlap() {
       return;
     }
 
-    this->jump(next_row, next_col);
+    // Empty rows share the offset of the next row with pixels: runs of empty rows are skipped
+    // by a single jump
+    this->jump_to_row(next_row);
+    if (this->is_at_end() || *this->_bin1_id_it > this->_coord1.bin2.id()) {
+      this->jump_at_end();
+      return;
+    }
+    this->jump_to_col(this->_coord2.bin1.id());
   } while (this->discard());
 
   if (this->is_at_end()) {
@@ -356,6 +772,40 @@ inline void PixelSelector<N, CHUNK_SIZE>::iterator::jump_to_next_overlap() {
   }
 }
 
+template <typename N, std::size_t CHUNK_SIZE>
+inline void PixelSelector<N, CHUNK_SIZE>::iterator::jump_to_next_match() {
+  while (!this->is_at_end() && !this->passes_filter()) {
+    const auto current_offset = this->h5_offset();
+    if (this->_filter.contact_type != ContactType::ALL) {
+      const auto bin1_id = *this->_bin1_id_it;
+      const auto bin2_id = *this->_bin2_id_it;
+      const auto [first_bin, last_bin] = internal::chrom_bin_range(this->_index->bins(), bin1_id);
+      const auto cis = bin2_id >= first_bin && bin2_id < last_bin;
+      if (this->_filter.contact_type == ContactType::TRANS && cis) {
+        // Skip the cis block of the current row
+        this->jump_to_col(last_bin);
+      } else if (this->_filter.contact_type == ContactType::CIS && bin2_id >= last_bin) {
+        // The remainder of the current row is made up of trans pixels
+        this->jump_to_row(bin1_id + 1);
+      }
+    }
+
+    if (this->h5_offset() == current_offset) {
+      std::ignore = ++this->_bin1_id_it;
+      std::ignore = ++this->_bin2_id_it;
+      std::ignore = ++this->_count_it;
+    }
+
+    if (this->is_at_end()) {
+      this->jump_at_end();
+      return;
+    }
+    if (this->discard()) {
+      this->jump_to_next_overlap();
+    }
+  }
+}
+
 template <typename N, std::size_t CHUNK_SIZE>
 inline std::size_t PixelSelector<N, CHUNK_SIZE>::iterator::h5_offset() const noexcept {
   assert(this->_bin1_id_it.h5_offset() == this->_bin2_id_it.h5_offset());
@@ -379,10 +829,15 @@ inline void PixelSelector<N, CHUNK_SIZE>::iterator::refresh() {
   const auto &bin1_dset = this->_bin1_id_it.dataset();
   const auto &bin2_dset = this->_bin2_id_it.dataset();
   const auto &count_dset = this->_count_it.dataset();
-
-  this->_bin1_id_it = bin1_dset.template make_iterator_at_offset<BinIDT, CHUNK_SIZE>(h5_offset);
-  this->_bin2_id_it = bin2_dset.template make_iterator_at_offset<BinIDT, CHUNK_SIZE>(h5_offset);
-  this->_count_it = count_dset.template make_iterator_at_offset<N, CHUNK_SIZE>(h5_offset);
+  const auto prefetch = this->_bin1_id_it.prefetch_enabled();
+  const auto block_size = this->_bin1_id_it.block_size();
+
+  this->_bin1_id_it = bin1_dset.template make_iterator_at_offset<BinIDT, CHUNK_SIZE>(
+      h5_offset, prefetch, block_size);
+  this->_bin2_id_it = bin2_dset.template make_iterator_at_offset<BinIDT, CHUNK_SIZE>(
+      h5_offset, prefetch, block_size);
+  this->_count_it =
+      count_dset.template make_iterator_at_offset<N, CHUNK_SIZE>(h5_offset, prefetch, block_size);
 }
 
 template <typename N, std::size_t CHUNK_SIZE>
@@ -397,6 +852,12 @@ inline void PixelSelector<N, CHUNK_SIZE>::iterator::read_pixel() const {
                                            this->_index->bins().at(*this->_bin2_id_it)};
   }
   this->_value.count = *this->_count_it;
+
+  if constexpr (STATS_ENABLED) {
+    if (auto *counters = this->_bin1_id_it.dataset().io_counters(); counters) {
+      counters->add_pixels_materialized();
+    }
+  }
 }
 
 template <typename N, std::size_t CHUNK_SIZE>
@@ -411,13 +872,30 @@ constexpr bool PixelSelector<N, CHUNK_SIZE>::iterator::overlaps_coord2() const n
                             *this->_bin2_id_it <= this->_coord2.bin2.id());
 }
 
+template <typename N, std::size_t CHUNK_SIZE>
+inline bool PixelSelector<N, CHUNK_SIZE>::iterator::overlaps_band(std::uint64_t bin1_id,
+                                                                  std::uint64_t bin2_id) const {
+  return internal::overlaps_band(this->_index->bins(), bin1_id, bin2_id,
+                                 this->_max_diagonal_distance);
+}
+
 template <typename N, std::size_t CHUNK_SIZE>
 inline bool PixelSelector<N, CHUNK_SIZE>::iterator::discard() const {
   if (this->is_at_end()) {
     return false;
   }
 
-  return !this->overlaps_coord1() || !this->overlaps_coord2();
+  return !this->overlaps_coord1() || !this->overlaps_coord2() ||
+         !this->overlaps_band(*this->_bin1_id_it, *this->_bin2_id_it);
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline bool PixelSelector<N, CHUNK_SIZE>::iterator::passes_filter() const {
+  if (this->_filter.empty()) {
+    return true;
+  }
+  return internal::passes_filter(this->_filter, this->_index->bins(), *this->_bin1_id_it,
+                                 *this->_bin2_id_it, *this->_count_it);
 }
 
 template <typename N, std::size_t CHUNK_SIZE>
@@ -428,4 +906,244 @@ constexpr bool PixelSelector<N, CHUNK_SIZE>::iterator::is_at_end() const noexcep
   return !this->overlaps_coord1() && !this->overlaps_coord2();
 }
 
+template <typename N, std::size_t CHUNK_SIZE>
+inline PixelSelector<N, CHUNK_SIZE>::thin_iterator::thin_iterator(iterator it) noexcept
+    : _it(std::move(it)) {}
+
+template <typename N, std::size_t CHUNK_SIZE>
+constexpr bool PixelSelector<N, CHUNK_SIZE>::thin_iterator::operator==(
+    const thin_iterator &other) const noexcept {
+  return this->_it == other._it;
+}
+template <typename N, std::size_t CHUNK_SIZE>
+constexpr bool PixelSelector<N, CHUNK_SIZE>::thin_iterator::operator!=(
+    const thin_iterator &other) const noexcept {
+  return !(*this == other);
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+constexpr bool PixelSelector<N, CHUNK_SIZE>::thin_iterator::operator<(
+    const thin_iterator &other) const noexcept {
+  return this->_it < other._it;
+}
+template <typename N, std::size_t CHUNK_SIZE>
+constexpr bool PixelSelector<N, CHUNK_SIZE>::thin_iterator::operator<=(
+    const thin_iterator &other) const noexcept {
+  return this->_it <= other._it;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+constexpr bool PixelSelector<N, CHUNK_SIZE>::thin_iterator::operator>(
+    const thin_iterator &other) const noexcept {
+  return this->_it > other._it;
+}
+template <typename N, std::size_t CHUNK_SIZE>
+constexpr bool PixelSelector<N, CHUNK_SIZE>::thin_iterator::operator>=(
+    const thin_iterator &other) const noexcept {
+  return this->_it >= other._it;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto PixelSelector<N, CHUNK_SIZE>::thin_iterator::operator*() const -> const_reference {
+  assert(!this->_it.is_at_end());
+  this->_value = {*this->_it._bin1_id_it, *this->_it._bin2_id_it, *this->_it._count_it};
+  return this->_value;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto PixelSelector<N, CHUNK_SIZE>::thin_iterator::operator->() const -> const_pointer {
+  return &(*(*this));
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto PixelSelector<N, CHUNK_SIZE>::thin_iterator::operator++() -> thin_iterator & {
+  std::ignore = ++this->_it;
+  return *this;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto PixelSelector<N, CHUNK_SIZE>::thin_iterator::operator++(int) -> thin_iterator {
+  return thin_iterator{this->_it++};
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline SymmetricPixelSelector<N, CHUNK_SIZE>::SymmetricPixelSelector(
+    PixelSelector<N, CHUNK_SIZE> sel, PixelCoordinates coord1, PixelCoordinates coord2,
+    std::shared_ptr<const BinTable> bins, bool mirror) noexcept
+    : _sel(std::move(sel)),
+      _coord1(std::move(coord1)),
+      _coord2(std::move(coord2)),
+      _bins(std::move(bins)),
+      _mirror(mirror) {
+  assert(_bins);
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto SymmetricPixelSelector<N, CHUNK_SIZE>::begin() const -> iterator {
+  return iterator{*this};
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto SymmetricPixelSelector<N, CHUNK_SIZE>::end() const -> iterator {
+  return {};
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto SymmetricPixelSelector<N, CHUNK_SIZE>::begin_thin() const -> thin_iterator {
+  return thin_iterator{*this};
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline auto SymmetricPixelSelector<N, CHUNK_SIZE>::end_thin() const -> thin_iterator {
+  return {};
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline const PixelCoordinates &SymmetricPixelSelector<N, CHUNK_SIZE>::coord1() const noexcept {
+  return this->_coord1;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline const PixelCoordinates &SymmetricPixelSelector<N, CHUNK_SIZE>::coord2() const noexcept {
+  return this->_coord2;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+inline bool SymmetricPixelSelector<N, CHUNK_SIZE>::mirror() const noexcept {
+  return this->_mirror;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+template <typename PixelT>
+inline SymmetricPixelSelector<N, CHUNK_SIZE>::basic_iterator<PixelT>::basic_iterator(
+    const SymmetricPixelSelector &sel)
+    : _it(sel._sel.begin_thin()),
+      _last(sel._sel.end_thin()),
+      _first_row(sel._coord1.bin1.id()),
+      _last_row(sel._coord1.bin2.id()),
+      _first_col(sel._coord2.bin1.id()),
+      _last_col(sel._coord2.bin2.id()),
+      _mirror(sel._mirror),
+      _bins(sel._bins) {
+  this->read_next_row();
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+template <typename PixelT>
+inline bool SymmetricPixelSelector<N, CHUNK_SIZE>::basic_iterator<PixelT>::operator==(
+    const basic_iterator &other) const noexcept {
+  if (this->is_at_end() || other.is_at_end()) {
+    return this->is_at_end() == other.is_at_end();
+  }
+  return this->_it == other._it && this->_i == other._i &&
+         this->_row.front().bin1_id == other._row.front().bin1_id;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+template <typename PixelT>
+inline bool SymmetricPixelSelector<N, CHUNK_SIZE>::basic_iterator<PixelT>::operator!=(
+    const basic_iterator &other) const noexcept {
+  return !(*this == other);
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+template <typename PixelT>
+inline auto SymmetricPixelSelector<N, CHUNK_SIZE>::basic_iterator<PixelT>::operator*() const
+    -> const_reference {
+  assert(!this->is_at_end());
+  if constexpr (is_thin_pixel_v<PixelT>) {
+    return this->_row[this->_i];
+  } else {
+    this->_value = Pixel<N>{*this->_bins, this->_row[this->_i]};
+    return this->_value;
+  }
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+template <typename PixelT>
+inline auto SymmetricPixelSelector<N, CHUNK_SIZE>::basic_iterator<PixelT>::operator->() const
+    -> const_pointer {
+  return &(*(*this));
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+template <typename PixelT>
+inline auto SymmetricPixelSelector<N, CHUNK_SIZE>::basic_iterator<PixelT>::operator++()
+    -> basic_iterator & {
+  assert(!this->is_at_end());
+  if (++this->_i == this->_row.size()) {
+    this->read_next_row();
+  }
+  return *this;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+template <typename PixelT>
+inline auto SymmetricPixelSelector<N, CHUNK_SIZE>::basic_iterator<PixelT>::operator++(int)
+    -> basic_iterator {
+  auto it = *this;
+  std::ignore = ++(*this);
+  return it;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+template <typename PixelT>
+inline bool SymmetricPixelSelector<N, CHUNK_SIZE>::basic_iterator<PixelT>::is_at_end()
+    const noexcept {
+  return this->_row.empty();
+}
+
+// Rows past the last row of the query can neither overlap the query nor be transposed onto it
+template <typename N, std::size_t CHUNK_SIZE>
+template <typename PixelT>
+inline bool SymmetricPixelSelector<N, CHUNK_SIZE>::basic_iterator<PixelT>::source_exhausted()
+    const {
+  return this->_it == this->_last || this->_it->bin1_id > this->_last_row;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+template <typename PixelT>
+constexpr bool SymmetricPixelSelector<N, CHUNK_SIZE>::basic_iterator<PixelT>::overlaps_query(
+    std::uint64_t bin1_id, std::uint64_t bin2_id) const noexcept {
+  return bin1_id >= this->_first_row && bin1_id <= this->_last_row &&
+         bin2_id >= this->_first_col && bin2_id <= this->_last_col;
+}
+
+template <typename N, std::size_t CHUNK_SIZE>
+template <typename PixelT>
+inline void SymmetricPixelSelector<N, CHUNK_SIZE>::basic_iterator<PixelT>::read_next_row() {
+  this->_row.clear();
+  this->_i = 0;
+
+  while (this->_row.empty()) {
+    const auto source_exhausted = this->source_exhausted();
+    if (source_exhausted && this->_pending.empty()) {
+      return;
+    }
+
+    // All pixels coming from rows upstream of row have already been read
+    auto row = source_exhausted ? (std::numeric_limits<std::uint64_t>::max)() : this->_it->bin1_id;
+    if (!this->_pending.empty()) {
+      row = (std::min)(row, this->_pending.begin()->first);
+    }
+
+    // Transposed pixels precede the pixels stored in row, as their bin2_id is < row
+    if (auto node = this->_pending.extract(row); !node.empty()) {
+      this->_row = std::move(node.mapped());
+    }
+
+    for (; !this->source_exhausted() && this->_it->bin1_id == row; ++this->_it) {
+      const auto pixel = *this->_it;
+      if (this->overlaps_query(pixel.bin1_id, pixel.bin2_id)) {
+        this->_row.push_back(pixel);
+      }
+      if (this->_mirror && pixel.bin1_id != pixel.bin2_id &&
+          this->overlaps_query(pixel.bin2_id, pixel.bin1_id)) {
+        this->_pending[pixel.bin2_id].push_back(
+            ThinPixel<N>{pixel.bin2_id, pixel.bin1_id, pixel.count});
+      }
+    }
+  }
+}
+
 }  // namespace coolerpp
@@ -0,0 +1,221 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <H5Dpublic.h>
+#include <H5Zpublic.h>
+#include <fmt/format.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <highfive/H5DataType.hpp>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/common.hpp"
+#include "coolerpp/dataset.hpp"
+#include "coolerpp/internal/query_pool.hpp"
+#include "coolerpp/internal/type_pretty_printer.hpp"
+
+namespace coolerpp::internal {
+
+inline PixelWriter::PixelWriter(Dataset pixels_bin1_id, Dataset pixels_bin2_id,
+                                Dataset pixels_count, std::size_t num_threads)
+    : _columns{Column{std::move(pixels_bin1_id)}, Column{std::move(pixels_bin2_id)},
+               Column{std::move(pixels_count)}},
+      _num_threads((std::max)(std::size_t(1), num_threads)),
+      _pool(std::make_unique<QueryPool>(_num_threads)) {
+  for (auto &col : this->_columns) {
+    if (!read_chunk_layout(col.dset.get().getId(), col.layout)) {
+      throw std::runtime_error(fmt::format(
+          FMT_STRING("unable to setup pixel writer for dataset {}: dataset is not chunked or uses "
+                     "unsupported filters"),
+          col.dset.uri()));
+    }
+    if (col.dset.size() % col.layout.chunk_size != 0) {
+      throw std::runtime_error(fmt::format(
+          FMT_STRING("unable to setup pixel writer for dataset {}: dataset size is not a multiple "
+                     "of the chunk size"),
+          col.dset.uri()));
+    }
+    const auto dtype = col.dset.get().getDataType();
+    col.type_size = dtype.getSize();
+    col.floating_point = dtype.getClass() == HighFive::DataTypeClass::Float;
+    col.size = col.dset.size();
+    col.staging.reserve(col.layout.chunk_size * col.type_size);
+  }
+
+  if (!this->empty()) {
+    this->_last_bin1_id = this->_columns.front().dset.read_last<std::uint64_t>();
+  }
+}
+
+template <typename N>
+inline void PixelWriter::append(std::uint64_t bin1_id, std::uint64_t bin2_id, N count) {
+  static_assert(std::is_arithmetic_v<N>);
+  // Values are copied into the staging areas byte by byte: check types before appending anything
+  this->validate_type<std::int64_t>(0);
+  this->validate_type<std::int64_t>(1);
+  this->validate_type<N>(2);
+  this->append(0, conditional_static_cast<std::int64_t>(bin1_id));
+  this->append(1, conditional_static_cast<std::int64_t>(bin2_id));
+  this->append(2, count);
+  this->_last_bin1_id = bin1_id;
+}
+
+inline void PixelWriter::flush() {
+  for (std::size_t i = 0; i < this->_columns.size(); ++i) {
+    if (!this->_columns[i].staging.empty()) {
+      this->submit_chunk(i, true);
+    }
+  }
+  this->write_chunks(0);
+
+  for (auto &col : this->_columns) {
+    col.dset.resize(col.size);
+  }
+}
+
+inline std::size_t PixelWriter::size() const noexcept { return this->_columns.front().size; }
+
+inline std::size_t PixelWriter::memory_usage() const noexcept {
+  std::size_t size = 0;
+  for (const auto &col : this->_columns) {
+    size += col.staging.capacity();
+  }
+  for (const auto &chunk : this->_pending) {
+    const auto &col = this->_columns[chunk.column];
+    size += col.layout.chunk_size * col.type_size;
+  }
+  return size;
+}
+
+inline bool PixelWriter::empty() const noexcept { return this->size() == 0; }
+
+inline std::uint64_t PixelWriter::last_bin1_id() const noexcept {
+  assert(!this->empty());
+  return this->_last_bin1_id;
+}
+
+inline std::size_t PixelWriter::num_threads() const noexcept { return this->_num_threads; }
+
+template <typename T>
+inline void PixelWriter::validate_type(std::size_t column) const {
+  const auto &col = this->_columns[column];
+  if (col.type_size != sizeof(T) || col.floating_point != std::is_floating_point_v<T>) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("unable to append values of type {} to dataset {}: dataset stores {} of {} "
+                   "bytes"),
+        internal::type_name<T>(), col.dset.uri(),
+        col.floating_point ? "floating-point numbers" : "integers", col.type_size));
+  }
+}
+
+template <typename T>
+inline void PixelWriter::append(std::size_t column, T value) {
+  auto &col = this->_columns[column];
+  assert(col.type_size == sizeof(T));
+
+  const auto offset = col.staging.size();
+  col.staging.resize(offset + sizeof(T));
+  std::memcpy(col.staging.data() + offset, &value, sizeof(T));
+  ++col.size;
+
+  if (col.staging.size() == col.layout.chunk_size * col.type_size) {
+    this->submit_chunk(column, false);
+  }
+}
+
+inline void PixelWriter::submit_chunk(std::size_t column, bool pad) {
+  auto &col = this->_columns[column];
+  assert(!col.staging.empty());
+
+  const auto chunk_bytes = col.layout.chunk_size * col.type_size;
+  const auto num_values = col.staging.size() / col.type_size;
+  const auto chunk_offset = col.size - num_values;
+
+  auto raw = col.staging;
+  if (pad) {
+    // The last chunk is kept in the staging area so that it can be completed (and re-written) by
+    // subsequent calls to append()
+    raw.resize(chunk_bytes, 0);
+  } else {
+    col.staging.clear();
+  }
+
+  this->_pending.push_back(PendingChunk{
+      column, chunk_offset,
+      this->_pool->submit(
+          [layout = col.layout, type_size = col.type_size, raw = std::move(raw)]() mutable {
+            return PixelWriter::encode_chunk(layout, type_size, std::move(raw));
+          })});
+
+  this->write_chunks(this->_num_threads);
+}
+
+inline void PixelWriter::write_chunks(std::size_t max_pending) {
+  using namespace std::chrono_literals;
+  while (!this->_pending.empty()) {
+    const auto ready = this->_pending.front().data.wait_for(0s) == std::future_status::ready;
+    if (!ready && this->_pending.size() <= max_pending) {
+      return;
+    }
+    this->write_front_chunk();
+  }
+}
+
+inline void PixelWriter::write_front_chunk() {
+  assert(!this->_pending.empty());
+  auto chunk = std::move(this->_pending.front());
+  this->_pending.pop_front();
+
+  auto &col = this->_columns[chunk.column];
+  const auto buff = chunk.data.get();
+
+  col.dset.resize((std::min)(col.size, chunk.chunk_offset + col.layout.chunk_size));
+
+  auto chunk_offset = conditional_static_cast<hsize_t>(chunk.chunk_offset);
+  if (H5Dwrite_chunk(col.dset.get().getId(), H5P_DEFAULT, 0, &chunk_offset, buff.size(),
+                     buff.data()) < 0) {
+    throw std::runtime_error(fmt::format(FMT_STRING("failed to write chunk at offset {} to {}"),
+                                         chunk.chunk_offset, col.dset.uri()));
+  }
+}
+
+inline std::vector<std::uint8_t> PixelWriter::encode_chunk(const ChunkLayout &layout,
+                                                           std::size_t type_size,
+                                                           std::vector<std::uint8_t> raw) {
+  std::vector<std::uint8_t> tmp{};
+  for (const auto &filter : layout.filters) {
+    if (filter == H5Z_FILTER_DEFLATE) {
+      tmp.resize(conditional_static_cast<std::size_t>(
+          compressBound(conditional_static_cast<uLong>(raw.size()))));
+      auto dest_size = conditional_static_cast<uLongf>(tmp.size());
+      const auto status =
+          compress2(tmp.data(), &dest_size, raw.data(), conditional_static_cast<uLong>(raw.size()),
+                    static_cast<int>(layout.deflate_level));
+      if (status != Z_OK) {
+        throw std::runtime_error(
+            fmt::format(FMT_STRING("failed to deflate chunk: zlib returned {}"), status));
+      }
+      tmp.resize(conditional_static_cast<std::size_t>(dest_size));
+    } else {
+      assert(filter == H5Z_FILTER_SHUFFLE);
+      shuffle_chunk(raw, tmp, type_size);
+    }
+    std::swap(raw, tmp);
+  }
+  return raw;
+}
+
+}  // namespace coolerpp::internal
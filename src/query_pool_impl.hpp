@@ -0,0 +1,70 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace coolerpp::internal {
+
+inline QueryPool::QueryPool(std::size_t num_threads) {
+  num_threads = (std::max)(std::size_t(1), num_threads);
+  this->_threads.reserve(num_threads);
+  for (std::size_t i = 0; i < num_threads; ++i) {
+    this->_threads.emplace_back([this]() { this->run(); });
+  }
+}
+
+inline QueryPool::~QueryPool() noexcept {
+  {
+    [[maybe_unused]] const std::scoped_lock lck(this->_mtx);
+    this->_stop = true;
+  }
+  this->_cv.notify_all();
+  for (auto &t : this->_threads) {
+    t.join();
+  }
+}
+
+template <typename Task>
+inline auto QueryPool::submit(Task task) -> std::future<std::invoke_result_t<Task>> {
+  using T = std::invoke_result_t<Task>;
+  // std::function requires copyable callables
+  auto ptask = std::make_shared<std::packaged_task<T()>>(std::move(task));
+  auto fut = ptask->get_future();
+  {
+    [[maybe_unused]] const std::scoped_lock lck(this->_mtx);
+    this->_tasks.emplace_back([ptask]() { (*ptask)(); });
+  }
+  this->_cv.notify_one();
+  return fut;
+}
+
+inline std::size_t QueryPool::num_threads() const noexcept { return this->_threads.size(); }
+
+inline void QueryPool::run() {
+  while (true) {
+    std::function<void()> task{};
+    {
+      std::unique_lock<std::mutex> lck(this->_mtx);
+      this->_cv.wait(lck, [this]() { return this->_stop || !this->_tasks.empty(); });
+      if (this->_tasks.empty()) {
+        return;
+      }
+      task = std::move(this->_tasks.front());
+      this->_tasks.pop_front();
+    }
+    task();
+  }
+}
+
+}  // namespace coolerpp::internal
@@ -0,0 +1,158 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <H5Ppublic.h>
+// H5FDros3.h does not include the headers it depends on
+#include <H5FDros3.h>
+#include <fmt/format.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <highfive/H5File.hpp>
+#include <highfive/H5PropertyList.hpp>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "coolerpp/common.hpp"
+
+namespace coolerpp {
+
+inline RemoteOptions RemoteOptions::from_env() {
+  auto getenv_or_empty = [](const char *name) {
+    const auto *value = std::getenv(name);  // NOLINT(concurrency-mt-unsafe)
+    return value ? std::string{value} : std::string{};
+  };
+
+  RemoteOptions options{};
+  options.aws_region = getenv_or_empty("AWS_REGION");
+  if (options.aws_region.empty()) {
+    options.aws_region = getenv_or_empty("AWS_DEFAULT_REGION");
+  }
+  options.secret_id = getenv_or_empty("AWS_ACCESS_KEY_ID");
+  options.secret_key = getenv_or_empty("AWS_SECRET_ACCESS_KEY");
+  return options;
+}
+
+inline bool RemoteOptions::authenticate() const noexcept {
+  return !this->aws_region.empty() && !this->secret_id.empty() && !this->secret_key.empty();
+}
+
+inline bool is_remote_path(std::string_view path) noexcept {
+  return starts_with(path, "s3://") || starts_with(path, "http://") ||
+         starts_with(path, "https://");
+}
+
+constexpr bool ros3_available() noexcept {
+#ifdef H5_HAVE_ROS3_VFD
+  return true;
+#else
+  return false;
+#endif
+}
+
+namespace internal {
+
+inline std::string to_https_url(std::string_view url, std::string_view aws_region) {
+  constexpr std::string_view s3_prefix{"s3://"};
+  if (!starts_with(url, s3_prefix)) {
+    return std::string{url};
+  }
+
+  const auto path = url.substr(s3_prefix.size());
+  const auto pos = path.find('/');
+  if (pos == std::string_view::npos || pos == 0 || pos + 1 == path.size()) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("invalid S3 URL \"{}\": URL should have the form s3://bucket/key"), url));
+  }
+
+  const auto bucket = path.substr(0, pos);
+  const auto key = path.substr(pos + 1);
+  if (aws_region.empty()) {
+    return fmt::format(FMT_STRING("https://{}.s3.amazonaws.com/{}"), bucket, key);
+  }
+  return fmt::format(FMT_STRING("https://{}.s3.{}.amazonaws.com/{}"), bucket, aws_region, key);
+}
+
+// File access property selecting the ROS3 virtual file driver
+class ROS3Property {
+  RemoteOptions _options{};
+
+ public:
+  explicit ROS3Property(RemoteOptions options) : _options(std::move(options)) {
+    if constexpr (!ros3_available()) {
+      throw std::runtime_error(
+          "unable to open remote file: libhdf5 was built without support for the ROS3 virtual "
+          "file driver");
+    }
+  }
+
+  void apply([[maybe_unused]] hid_t hid) const {
+#ifdef H5_HAVE_ROS3_VFD
+    auto copy_field = [](std::string_view field_name, const std::string &src, char *dest,
+                         std::size_t max_size) {
+      if (src.size() > max_size) {
+        throw std::runtime_error(
+            fmt::format(FMT_STRING("{} is too long: expected at most {} characters, found {}"),
+                        field_name, max_size, src.size()));
+      }
+      std::memcpy(dest, src.c_str(), src.size() + 1);
+    };
+
+    H5FD_ros3_fapl_t fapl{};
+    fapl.version = H5FD_CURR_ROS3_FAPL_T_VERSION;
+    fapl.authenticate = this->_options.authenticate();
+    if (fapl.authenticate) {
+      copy_field("AWS region", this->_options.aws_region, fapl.aws_region,
+                 H5FD_ROS3_MAX_REGION_LEN);
+      copy_field("AWS secret id", this->_options.secret_id, fapl.secret_id,
+                 H5FD_ROS3_MAX_SECRET_ID_LEN);
+      copy_field("AWS secret key", this->_options.secret_key, fapl.secret_key,
+                 H5FD_ROS3_MAX_SECRET_KEY_LEN);
+    }
+
+    if (H5Pset_fapl_ros3(hid, &fapl) < 0) {
+      throw std::runtime_error("failed to select the ROS3 virtual file driver");
+    }
+#endif
+  }
+};
+
+// File access property setting the size of the buffer used for data sieving
+class SieveBufferProperty {
+  std::size_t _size{};
+
+ public:
+  explicit SieveBufferProperty(std::size_t size) noexcept : _size(size) {}
+
+  void apply(hid_t hid) const {
+    if (H5Pset_sieve_buf_size(hid, this->_size) < 0) {
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("failed to set the size of the sieve buffer to {}"), this->_size));
+    }
+  }
+};
+
+inline HighFive::FileAccessProps init_remote_file_access_props(const RemoteOptions &options) {
+  HighFive::FileAccessProps props{};
+  props.add(ROS3Property{options});
+  props.add(SieveBufferProperty{options.sieve_buffer_size});
+  return props;
+}
+
+inline HighFive::File open_file_read_only(std::string_view path, const RemoteOptions &options) {
+  if (!is_remote_path(path)) {
+    return HighFive::File(std::string{path}, HighFive::File::ReadOnly);
+  }
+
+  return HighFive::File(to_https_url(path, options.aws_region), HighFive::File::ReadOnly,
+                        init_remote_file_access_props(options));
+}
+
+}  // namespace internal
+
+}  // namespace coolerpp
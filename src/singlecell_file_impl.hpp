@@ -0,0 +1,299 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <H5Lpublic.h>
+#include <H5Ppublic.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <highfive/H5File.hpp>
+#include <highfive/H5Group.hpp>
+#include <highfive/H5Utility.hpp>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/attribute.hpp"
+#include "coolerpp/bin_table.hpp"
+#include "coolerpp/common.hpp"
+#include "coolerpp/coolerpp.hpp"
+#include "coolerpp/dataset.hpp"
+#include "coolerpp/group.hpp"
+#include "coolerpp/remote.hpp"
+#include "coolerpp/validation.hpp"
+
+namespace coolerpp {
+
+inline SingleCellFile::SingleCellFile(HighFive::File fp, unsigned int mode,
+                                      std::shared_ptr<const BinTable> bins,
+                                      std::size_t cache_size_bytes, bool validate)
+    : _mode(mode),
+      _fp(std::make_unique<HighFive::File>(std::move(fp))),
+      _bins(std::move(bins)),
+      _cells(read_cells(*_fp)),
+      _cache_size_bytes(cache_size_bytes),
+      _validate(validate) {}
+
+inline SingleCellFile SingleCellFile::open_read_only(std::string_view path,
+                                                     std::size_t cache_size_bytes, bool validate) {
+  [[maybe_unused]] const HighFive::SilenceHDF5 silencer{};  // NOLINT
+  auto fp = internal::open_file_read_only(path);
+  if (validate) {
+    // Cells are validated when they are opened
+    const auto status = utils::is_scool_file(fp, false);
+    if (!status) {
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("\"{}\" does not look like a valid single-cell Cooler file:\n"
+                                 "Validation report:\n{}"),
+                      path, status));
+    }
+  }
+
+  auto bins = import_bins(fp);
+  return SingleCellFile(std::move(fp), HighFive::File::ReadOnly, std::move(bins), cache_size_bytes,
+                        validate);
+}
+
+inline SingleCellFile SingleCellFile::create(std::string_view path, const ChromosomeSet &chroms,
+                                             std::uint32_t bin_size, bool overwrite_if_exists) {
+  if (bin_size == 0) {
+    throw std::logic_error("bin_size cannot be zero.");
+  }
+  if (!overwrite_if_exists && std::filesystem::exists(path)) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("unable to create .scool file \"{}\": file already exists"), path));
+  }
+
+  [[maybe_unused]] const HighFive::SilenceHDF5 silencer{};  // NOLINT
+  const auto mode = overwrite_if_exists ? HighFive::File::Overwrite : HighFive::File::Create;
+  HighFive::File fp(std::string{path}, mode);
+  auto bins = std::make_shared<const BinTable>(chroms, bin_size);
+
+  try {
+    write_root_attributes(fp, *bins);
+    write_bin_table(fp, *bins);
+    fp.createGroup("cells");
+    fp.flush();
+  } catch (const std::exception &e) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("unable to create .scool file \"{}\": {}"), path, e.what()));
+  }
+
+  return SingleCellFile(std::move(fp), HighFive::File::ReadWrite, std::move(bins),
+                        DEFAULT_HDF5_CACHE_SIZE, true);
+}
+
+inline SingleCellFile::operator bool() const noexcept { return !!this->_fp; }
+
+inline std::string SingleCellFile::path() const {
+  if (!*this) {
+    return "";
+  }
+  return this->_fp->getName();
+}
+
+inline std::uint32_t SingleCellFile::bin_size() const noexcept {
+  if (!this->_bins) {
+    return 0;
+  }
+  return this->_bins->bin_size();
+}
+
+inline auto SingleCellFile::chromosomes() const noexcept -> const ChromosomeSet & {
+  return this->bins().chromosomes();
+}
+
+inline auto SingleCellFile::bins() const noexcept -> const BinTable & {
+  assert(this->_bins);
+  return *this->_bins;
+}
+
+inline auto SingleCellFile::bins_ptr() const noexcept -> std::shared_ptr<const BinTable> {
+  return this->_bins;
+}
+
+inline auto SingleCellFile::cells() const noexcept -> const std::vector<std::string> & {
+  return this->_cells;
+}
+
+inline bool SingleCellFile::has_cell(std::string_view cell) const noexcept {
+  return std::binary_search(this->_cells.begin(), this->_cells.end(), cell);
+}
+
+inline File SingleCellFile::open(std::string_view cell) const {
+  if (!this->has_cell(cell)) {
+    throw std::out_of_range(
+        fmt::format(FMT_STRING("file \"{}\" does not have cell \"{}\""), this->path(), cell));
+  }
+
+  assert(this->_fp);
+  const auto uri = fmt::format(FMT_STRING("{}::/cells/{}"), this->path(), cell);
+  File clr(*this->_fp, uri, HighFive::File::ReadOnly,
+           CacheOptions{AccessProfile::RANDOM, this->_cache_size_bytes}, false, this->_bins);
+  if (this->_validate) {
+    const auto status = utils::is_cooler(clr._root_group());
+    if (!status) {
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("\"{}\" does not look like a valid Cooler file:\n"
+                                 "Validation report:\n{}"),
+                      uri, status));
+    }
+    // The bin table is shared by all cells: only check that its shape is consistent with the
+    // bin table read from the root of the .scool file
+    clr.validate_bins(false);
+  }
+  return clr;
+}
+
+template <typename PixelT>
+inline File SingleCellFile::create_cell(std::string_view cell, StandardAttributes attributes,
+                                        std::size_t cache_size_bytes,
+                                        const CompressionPolicy &compression) {
+  static_assert(std::is_arithmetic_v<PixelT>);
+  if (!*this || this->_mode == HighFive::File::ReadOnly) {
+    throw std::logic_error("cannot create cells in a .scool file opened in read-only mode");
+  }
+  if (cell.empty() || cell.find('/') != std::string_view::npos) {
+    throw std::logic_error(fmt::format(FMT_STRING("invalid cell name \"{}\""), cell));
+  }
+  if (this->has_cell(cell)) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("file \"{}\" already has cell \"{}\""), this->path(), cell));
+  }
+
+  attributes.bin_size = this->bin_size();
+  try {
+    [[maybe_unused]] const HighFive::SilenceHDF5 silencer{};  // NOLINT
+    auto cell_grp = this->_fp->createGroup(fmt::format(FMT_STRING("/cells/{}"), cell));
+
+    // Chromosomes and bins are written once at the root of the file and shared by all cells
+    create_hard_link(*this->_fp, "/chroms", cell_grp, "chroms");
+    auto bins_grp = cell_grp.createGroup("bins");
+    for (const auto *name : {"chrom", "start", "end"}) {
+      create_hard_link(*this->_fp, fmt::format(FMT_STRING("/bins/{}"), name), bins_grp, name);
+    }
+
+    File clr(*this->_fp, RootGroup{cell_grp}, this->_bins, PixelT(0), std::move(attributes),
+             cache_size_bytes, DEFAULT_HDF5_CACHE_W0, compression);
+
+    this->_cells.emplace(std::upper_bound(this->_cells.begin(), this->_cells.end(), cell),
+                         std::string{cell});
+    this->write_ncells();
+    return clr;
+  } catch (const std::exception &e) {
+    throw std::runtime_error(fmt::format(FMT_STRING("Cannot create cell \"{}\" in file \"{}\": {}"),
+                                         cell, this->path(), e.what()));
+  }
+}
+
+template <typename PixelIt>
+inline void SingleCellFile::append_cell(std::string_view cell, PixelIt first_pixel,
+                                        PixelIt last_pixel, bool validate) {
+  using PixelT = remove_cvref_t<decltype(*first_pixel)>;
+  using N = remove_cvref_t<decltype(PixelT{}.count)>;
+
+  auto clr = this->create_cell<N>(cell);
+  clr.append_pixels(first_pixel, last_pixel, validate);
+}
+
+inline void SingleCellFile::close() { *this = SingleCellFile{}; }
+
+inline auto SingleCellFile::read_cells(const HighFive::File &fp) -> std::vector<std::string> {
+  [[maybe_unused]] const HighFive::SilenceHDF5 silencer{};  // NOLINT
+  try {
+    auto cells = fp.getGroup("/cells").listObjectNames();
+    std::sort(cells.begin(), cells.end());
+    return cells;
+  } catch (const std::exception &e) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("unable to read cells from file \"{}\": {}"), fp.getName(), e.what()));
+  }
+}
+
+inline auto SingleCellFile::import_bins(const HighFive::File &fp) -> std::shared_ptr<BinTable> {
+  [[maybe_unused]] const HighFive::SilenceHDF5 silencer{};  // NOLINT
+  try {
+    const RootGroup root_grp{fp.getGroup("/")};
+    const auto bin_size = Attribute::read<std::uint32_t>(root_grp(), "bin-size");
+    auto chroms = File::import_chroms(Dataset{root_grp, "chroms/name"},
+                                      Dataset{root_grp, "chroms/length"}, false);
+    return std::make_shared<BinTable>(std::move(chroms), bin_size);
+  } catch (const std::exception &e) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("unable to read the bin table from file \"{}\": {}"), fp.getName(), e.what()));
+  }
+}
+
+inline void SingleCellFile::write_root_attributes(HighFive::File &fp, const BinTable &bins) {
+  const auto attributes = StandardAttributes::init(bins.bin_size());
+
+  Attribute::write(fp, "bin-size", bins.bin_size());
+  Attribute::write(fp, "bin-type", *attributes.bin_type);            // NOLINT
+  Attribute::write(fp, "creation-date", *attributes.creation_date);  // NOLINT
+  Attribute::write(fp, "format", std::string{SCOOL_MAGIC});
+  Attribute::write(fp, "format-url", *attributes.format_url);  // NOLINT
+  Attribute::write(fp, "format-version", std::int64_t(1));
+  Attribute::write(fp, "generated-by", *attributes.generated_by);   // NOLINT
+  Attribute::write(fp, "genome-assembly", *attributes.assembly);    // NOLINT
+  Attribute::write(fp, "metadata", *attributes.metadata);           // NOLINT
+  Attribute::write(fp, "nbins", static_cast<std::int64_t>(bins.size()));
+  Attribute::write(fp, "nchroms", static_cast<std::int32_t>(bins.chromosomes().size()));
+  Attribute::write(fp, "ncells", std::uint64_t(0));
+}
+
+inline void SingleCellFile::write_bin_table(HighFive::File &fp, const BinTable &bins) {
+  RootGroup root_grp{fp.getGroup("/")};
+  fp.createGroup("chroms");
+  fp.createGroup("bins");
+
+  const auto aprop =
+      Dataset::init_access_props(DEFAULT_HDF5_CHUNK_SIZE, DEFAULT_HDF5_DATASET_CACHE_SIZE, 1.0);
+  const auto cprop = Dataset::init_create_props(CompressionPolicy{}.other);
+  const auto &chrom_with_longest_name = bins.chromosomes().chromosome_with_longest_name();
+
+  auto create_dataset = [&](std::string_view path) {
+    return Dataset{root_grp, path, std::int32_t{}, HighFive::DataSpace::UNLIMITED, aprop, cprop};
+  };
+
+  Dataset chrom_names{root_grp, "chroms/name", chrom_with_longest_name.name(),
+                      HighFive::DataSpace::UNLIMITED, aprop, cprop};
+  auto chrom_sizes = create_dataset("chroms/length");
+  File::write_chromosomes(chrom_names, chrom_sizes, bins.chromosomes().begin(),
+                          bins.chromosomes().end());
+
+  auto bin_chroms = create_dataset("bins/chrom");
+  auto bin_starts = create_dataset("bins/start");
+  auto bin_ends = create_dataset("bins/end");
+  File::write_bin_table(bin_chroms, bin_starts, bin_ends, bins);
+}
+
+inline void SingleCellFile::create_hard_link(HighFive::File &fp, std::string_view target_path,
+                                             HighFive::Group &dest_grp,
+                                             std::string_view link_name) {
+  const auto status = H5Lcreate_hard(fp.getId(), std::string{target_path}.c_str(),
+                                     dest_grp.getId(), std::string{link_name}.c_str(),
+                                     H5P_DEFAULT, H5P_DEFAULT);
+  if (status < 0) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("unable to create a hard link to \"{}\" at \"{}/{}\""),
+                    target_path, dest_grp.getPath(), link_name));
+  }
+}
+
+inline void SingleCellFile::write_ncells() {
+  assert(this->_fp);
+  Attribute::write(*this->_fp, "ncells",
+                   conditional_static_cast<std::uint64_t>(this->_cells.size()), true);
+}
+
+}  // namespace coolerpp
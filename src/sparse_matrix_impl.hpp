@@ -0,0 +1,179 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/common.hpp"
+
+namespace coolerpp {
+
+template <typename N>
+inline SparseMatrixCSR<N>::SparseMatrixCSR(std::uint64_t first_row, std::uint64_t first_col,
+                                           std::uint64_t num_rows, std::uint64_t num_cols,
+                                           std::vector<std::uint64_t> row_ptrs,
+                                           std::vector<std::uint64_t> col_ids,
+                                           std::vector<N> values)
+    : _first_row(first_row),
+      _first_col(first_col),
+      _num_rows(num_rows),
+      _num_cols(num_cols),
+      _row_ptrs(std::move(row_ptrs)),
+      _col_ids(std::move(col_ids)),
+      _values(std::move(values)) {
+  this->validate();
+}
+
+template <typename N>
+inline std::uint64_t SparseMatrixCSR<N>::first_row() const noexcept {
+  return this->_first_row;
+}
+
+template <typename N>
+inline std::uint64_t SparseMatrixCSR<N>::first_col() const noexcept {
+  return this->_first_col;
+}
+
+template <typename N>
+inline std::uint64_t SparseMatrixCSR<N>::num_rows() const noexcept {
+  return this->_num_rows;
+}
+
+template <typename N>
+inline std::uint64_t SparseMatrixCSR<N>::num_cols() const noexcept {
+  return this->_num_cols;
+}
+
+template <typename N>
+inline std::size_t SparseMatrixCSR<N>::nnz() const noexcept {
+  return this->_values.size();
+}
+
+template <typename N>
+inline bool SparseMatrixCSR<N>::empty() const noexcept {
+  return this->nnz() == 0;
+}
+
+template <typename N>
+inline auto SparseMatrixCSR<N>::row_ptrs() const noexcept -> internal::Span<std::uint64_t> {
+  return {this->_row_ptrs.data(), this->_row_ptrs.size()};
+}
+
+template <typename N>
+inline auto SparseMatrixCSR<N>::col_ids() const noexcept -> internal::Span<std::uint64_t> {
+  return {this->_col_ids.data(), this->_col_ids.size()};
+}
+
+template <typename N>
+inline auto SparseMatrixCSR<N>::values() const noexcept -> internal::Span<N> {
+  return {this->_values.data(), this->_values.size()};
+}
+
+template <typename N>
+inline N SparseMatrixCSR<N>::operator()(std::uint64_t row, std::uint64_t col) const {
+  if (row >= this->_num_rows || col >= this->_num_cols) {
+    throw std::out_of_range(fmt::format(
+        FMT_STRING("SparseMatrixCSR: element ({}, {}) is out of range for a {}x{} matrix"), row,
+        col, this->_num_rows, this->_num_cols));
+  }
+
+  const auto first = this->_col_ids.begin() + static_cast<std::ptrdiff_t>(this->_row_ptrs[row]);
+  const auto last = this->_col_ids.begin() + static_cast<std::ptrdiff_t>(this->_row_ptrs[row + 1]);
+  const auto it = std::lower_bound(first, last, col);
+  if (it == last || *it != col) {
+    return 0;
+  }
+  return this->_values[static_cast<std::size_t>(std::distance(this->_col_ids.begin(), it))];
+}
+
+template <typename N>
+inline SparseMatrixCSR<N> SparseMatrixCSR<N>::expand_symmetric() const {
+  if (this->_first_row != this->_first_col || this->_num_rows != this->_num_cols) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("SparseMatrixCSR::expand_symmetric(): matrix covering rows [{}, {}) and columns "
+                   "[{}, {}) is not centered on the diagonal"),
+        this->_first_row, this->_first_row + this->_num_rows, this->_first_col,
+        this->_first_col + this->_num_cols));
+  }
+
+  // Count the number of elements of each row of the expanded matrix
+  const auto num_rows = conditional_static_cast<std::size_t>(this->_num_rows);
+  std::vector<std::uint64_t> row_ptrs(num_rows + 1, 0);
+  for (std::size_t i = 0; i < num_rows; ++i) {
+    for (auto k = this->_row_ptrs[i]; k < this->_row_ptrs[i + 1]; ++k) {
+      const auto j = conditional_static_cast<std::size_t>(this->_col_ids[k]);
+      if (j < i) {
+        throw std::runtime_error(fmt::format(
+            FMT_STRING("SparseMatrixCSR::expand_symmetric(): found element ({}, {}) below the "
+                       "diagonal"),
+            i, j));
+      }
+      row_ptrs[i + 1]++;
+      if (j != i) {
+        row_ptrs[j + 1]++;
+      }
+    }
+  }
+  for (std::size_t i = 0; i < num_rows; ++i) {
+    row_ptrs[i + 1] += row_ptrs[i];
+  }
+
+  // Rows are visited in ascending order: by the time row i is visited, the elements of row i below
+  // the diagonal (which come from rows < i) have already been written, so columns stay sorted
+  std::vector<std::uint64_t> col_ids(row_ptrs.back());
+  std::vector<N> values(row_ptrs.back());
+  std::vector<std::uint64_t> cursors(row_ptrs.begin(), row_ptrs.end() - 1);
+  for (std::size_t i = 0; i < num_rows; ++i) {
+    for (auto k = this->_row_ptrs[i]; k < this->_row_ptrs[i + 1]; ++k) {
+      const auto j = conditional_static_cast<std::size_t>(this->_col_ids[k]);
+      const auto value = this->_values[k];
+      col_ids[cursors[i]] = j;
+      values[cursors[i]++] = value;
+      if (j != i) {
+        col_ids[cursors[j]] = i;
+        values[cursors[j]++] = value;
+      }
+    }
+  }
+
+  return {this->_first_row,   this->_first_col,  this->_num_rows, this->_num_cols,
+          std::move(row_ptrs), std::move(col_ids), std::move(values)};
+}
+
+template <typename N>
+inline void SparseMatrixCSR<N>::validate() const {
+  if (this->_row_ptrs.size() != this->_num_rows + 1) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("SparseMatrixCSR: expected {} row pointers, found {}"), this->_num_rows + 1,
+        this->_row_ptrs.size()));
+  }
+  if (this->_col_ids.size() != this->_values.size() || this->_row_ptrs.front() != 0 ||
+      this->_row_ptrs.back() != this->_values.size()) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("SparseMatrixCSR: row pointers, column indices and values are not "
+                               "consistent: found {} column indices and {} values, while row "
+                               "pointers span {} elements"),
+                    this->_col_ids.size(), this->_values.size(), this->_row_ptrs.back()));
+  }
+  if (!std::is_sorted(this->_row_ptrs.begin(), this->_row_ptrs.end())) {
+    throw std::runtime_error("SparseMatrixCSR: row pointers are not sorted");
+  }
+  const auto max_col = std::max_element(this->_col_ids.begin(), this->_col_ids.end());
+  if (max_col != this->_col_ids.end() && *max_col >= this->_num_cols) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("SparseMatrixCSR: column index {} is out of range for a matrix "
+                               "with {} columns"),
+                    *max_col, this->_num_cols));
+  }
+}
+
+}  // namespace coolerpp
@@ -0,0 +1,98 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace coolerpp {
+
+inline DatasetStats &DatasetStats::operator+=(const DatasetStats &other) noexcept {
+  this->read_calls += other.read_calls;
+  this->chunks_read += other.chunks_read;
+  this->bytes_read += other.bytes_read;
+  this->bytes_decompressed += other.bytes_decompressed;
+  this->blocks_read += other.blocks_read;
+  this->read_time += other.read_time;
+  return *this;
+}
+
+namespace internal {
+
+inline IOCounters::IOCounters(std::size_t chunk_size) noexcept : _chunk_size(chunk_size) {}
+
+inline auto IOCounters::now() noexcept -> time_point {
+  if constexpr (STATS_ENABLED) {
+    return clock::now();
+  } else {
+    return {};
+  }
+}
+
+constexpr std::size_t IOCounters::chunk_size() const noexcept { return this->_chunk_size; }
+
+inline void IOCounters::add_read(std::size_t num_chunks, std::size_t bytes_read,
+                                 std::size_t bytes_decompressed, time_point t0) noexcept {
+  const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now() - t0);
+  this->_read_calls.fetch_add(1, std::memory_order_relaxed);
+  this->_chunks_read.fetch_add(num_chunks, std::memory_order_relaxed);
+  this->_bytes_read.fetch_add(bytes_read, std::memory_order_relaxed);
+  this->_bytes_decompressed.fetch_add(bytes_decompressed, std::memory_order_relaxed);
+  this->_read_time_ns.fetch_add(elapsed.count(), std::memory_order_relaxed);
+}
+
+inline void IOCounters::add_block_read() noexcept {
+  this->_blocks_read.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void IOCounters::add_row_seek() noexcept {
+  this->_row_seeks.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void IOCounters::add_col_seek() noexcept {
+  this->_col_seeks.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void IOCounters::add_pixels_materialized(std::size_t num) noexcept {
+  this->_pixels_materialized.fetch_add(num, std::memory_order_relaxed);
+}
+
+inline DatasetStats IOCounters::dataset_stats() const noexcept {
+  return {this->_read_calls.load(std::memory_order_relaxed),
+          this->_chunks_read.load(std::memory_order_relaxed),
+          this->_bytes_read.load(std::memory_order_relaxed),
+          this->_bytes_decompressed.load(std::memory_order_relaxed),
+          this->_blocks_read.load(std::memory_order_relaxed),
+          std::chrono::nanoseconds(this->_read_time_ns.load(std::memory_order_relaxed))};
+}
+
+inline std::uint64_t IOCounters::row_seeks() const noexcept {
+  return this->_row_seeks.load(std::memory_order_relaxed);
+}
+
+inline std::uint64_t IOCounters::col_seeks() const noexcept {
+  return this->_col_seeks.load(std::memory_order_relaxed);
+}
+
+inline std::uint64_t IOCounters::pixels_materialized() const noexcept {
+  return this->_pixels_materialized.load(std::memory_order_relaxed);
+}
+
+inline void IOCounters::reset() noexcept {
+  this->_read_calls = 0;
+  this->_chunks_read = 0;
+  this->_bytes_read = 0;
+  this->_bytes_decompressed = 0;
+  this->_blocks_read = 0;
+  this->_read_time_ns = 0;
+  this->_row_seeks = 0;
+  this->_col_seeks = 0;
+  this->_pixels_materialized = 0;
+}
+
+}  // namespace internal
+}  // namespace coolerpp
@@ -0,0 +1,73 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <H5Fpublic.h>
+#include <H5Ppublic.h>
+#include <fmt/format.h>
+
+#include <highfive/H5File.hpp>
+#include <highfive/H5PropertyList.hpp>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace coolerpp::internal {
+
+// File access property restricting the range of versions of the file format used to write objects
+class LibverBoundsProperty {
+  H5F_libver_t _low{};
+  H5F_libver_t _high{};
+
+ public:
+  LibverBoundsProperty(H5F_libver_t low, H5F_libver_t high) noexcept : _low(low), _high(high) {}
+
+  void apply(hid_t hid) const {
+    if (H5Pset_libver_bounds(hid, this->_low, this->_high) < 0) {
+      throw std::runtime_error("failed to set the version bounds of the HDF5 file format");
+    }
+  }
+};
+
+// HighFive does not expose the SWMR flags: open the file using the C API and hand the file id over
+// to HighFive::File
+class SWMRFileHandle : public HighFive::File {
+ public:
+  explicit SWMRFileHandle(hid_t id) : HighFive::File(id) {}
+};
+
+// SWMR requires objects to be written using at least the file format of HDF5 v1.10. Using
+// H5F_LIBVER_V110 instead of H5F_LIBVER_LATEST as lower bound keeps files readable by v1.10
+// readers when coolerpp is built against a newer libhdf5
+inline HighFive::FileAccessProps init_swmr_file_access_props() {
+  HighFive::FileAccessProps props{};
+  props.add(LibverBoundsProperty{H5F_LIBVER_V110, H5F_LIBVER_LATEST});
+  return props;
+}
+
+inline HighFive::File create_file_swmr(std::string_view path, unsigned mode) {
+  return HighFive::File(std::string{path}, mode, init_swmr_file_access_props());
+}
+
+inline void start_swmr_write(const HighFive::File &f) {
+  if (H5Fstart_swmr_write(f.getId()) < 0) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("failed to enable SWMR write access for file \"{}\""),
+                    f.getName()));
+  }
+}
+
+inline HighFive::File open_file_swmr_read(std::string_view path) {
+  const std::string path_{path};
+  const auto props = init_swmr_file_access_props();
+  const auto id = H5Fopen(path_.c_str(), H5F_ACC_RDONLY | H5F_ACC_SWMR_READ, props.getId());
+  if (id < 0) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("unable to open file \"{}\" in SWMR read mode"), path));
+  }
+  return SWMRFileHandle{id};
+}
+
+}  // namespace coolerpp::internal
@@ -0,0 +1,47 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <atomic>
+
+namespace coolerpp {
+
+inline const TraceCallbacks *set_trace_callbacks(const TraceCallbacks *callbacks) noexcept {
+  return internal::trace_callbacks().exchange(callbacks, std::memory_order_acq_rel);
+}
+
+inline const TraceCallbacks *get_trace_callbacks() noexcept {
+  return internal::trace_callbacks().load(std::memory_order_acquire);
+}
+
+namespace internal {
+
+inline std::atomic<const TraceCallbacks *> &trace_callbacks() noexcept {
+  static std::atomic<const TraceCallbacks *> callbacks{nullptr};
+  return callbacks;
+}
+
+inline TraceScope::TraceScope([[maybe_unused]] const char *name) noexcept {
+  if constexpr (TRACING_ENABLED) {
+    // Callbacks are loaded once, so that begin() and end() are always paired even when callbacks
+    // are replaced while the region is being executed
+    this->_callbacks = get_trace_callbacks();
+    this->_name = name;
+    if (this->_callbacks && this->_callbacks->begin) {
+      this->_callbacks->begin(this->_name, this->_callbacks->user_data);
+    }
+  }
+}
+
+inline TraceScope::~TraceScope() noexcept {
+  if constexpr (TRACING_ENABLED) {
+    if (this->_callbacks && this->_callbacks->end) {
+      this->_callbacks->end(this->_name, this->_callbacks->user_data);
+    }
+  }
+}
+
+}  // namespace internal
+}  // namespace coolerpp
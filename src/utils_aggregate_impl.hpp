@@ -0,0 +1,228 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/format.h>
+#include <tsl/hopscotch_map.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/coolerpp.hpp"
+#include "coolerpp/singlecell_file.hpp"
+
+namespace coolerpp::utils {
+
+namespace internal {
+
+// Pixels are identified by keys computed as bin1_id * num_bins + bin2_id
+using PseudoBulkMap = tsl::hopscotch_map<std::uint64_t, double>;
+
+template <typename N>
+inline void write_pseudobulk_cooler(std::string_view uri, const BinTable &bins,
+                                    const std::vector<std::uint64_t> &keys,
+                                    const std::vector<double> &counts, bool overwrite_if_exists,
+                                    std::size_t chunk_size) {
+  assert(keys.size() == counts.size());
+  const auto num_bins = conditional_static_cast<std::uint64_t>(bins.size());
+  auto dest =
+      File::create_new_cooler<N>(uri, bins.chromosomes(), bins.bin_size(), overwrite_if_exists);
+
+  std::vector<std::uint64_t> bin1_buff{};
+  std::vector<std::uint64_t> bin2_buff{};
+  std::vector<N> count_buff{};
+  for (std::size_t offset = 0; offset < keys.size(); offset += chunk_size) {
+    const auto num = (std::min)(chunk_size, keys.size() - offset);
+    bin1_buff.resize(num);
+    bin2_buff.resize(num);
+    count_buff.resize(num);
+    for (std::size_t i = 0; i < num; ++i) {
+      bin1_buff[i] = keys[offset + i] / num_bins;
+      bin2_buff[i] = keys[offset + i] % num_bins;
+      count_buff[i] = conditional_static_cast<N>(counts[offset + i]);
+    }
+    dest.append_pixels_columns(bin1_buff.data(), bin2_buff.data(), count_buff.data(), num);
+  }
+}
+
+}  // namespace internal
+
+inline std::vector<std::string> aggregate_cells(
+    std::string_view scool_path,
+    const std::vector<std::pair<std::string, std::string>> &cell_clusters,
+    std::string_view dest_prefix, bool overwrite_if_exists, std::size_t num_threads,
+    std::size_t chunk_size) {
+  chunk_size = (std::max)(std::size_t(1), chunk_size);
+  if (num_threads == 0) {
+    num_threads = (std::max)(1U, std::thread::hardware_concurrency());
+  }
+
+  const auto sclr = SingleCellFile::open_read_only(scool_path);
+  const auto num_bins = conditional_static_cast<std::uint64_t>(sclr.bins().size());
+  if (num_bins > (std::uint64_t(1) << 32U)) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("unable to aggregate cells: too many bins ({})"), num_bins));
+  }
+
+  std::vector<std::string> clusters{};
+  std::transform(cell_clusters.begin(), cell_clusters.end(), std::back_inserter(clusters),
+                 [](const auto &p) { return p.second; });
+  std::sort(clusters.begin(), clusters.end());
+  clusters.erase(std::unique(clusters.begin(), clusters.end()), clusters.end());
+
+  // Group clusters by cell, so that cells belonging to multiple clusters are read only once
+  struct CellTask {
+    std::string_view cell{};
+    std::vector<std::size_t> cluster_ids{};
+  };
+  std::vector<CellTask> tasks{};
+  tsl::hopscotch_map<std::string_view, std::size_t> task_ids{};
+  for (const auto &[cell, cluster] : cell_clusters) {
+    if (!sclr.has_cell(cell)) {
+      throw std::runtime_error(fmt::format(FMT_STRING("file \"{}\" does not have cell \"{}\""),
+                                           sclr.path(), cell));
+    }
+    const auto cluster_id = static_cast<std::size_t>(std::distance(
+        clusters.begin(), std::lower_bound(clusters.begin(), clusters.end(), cluster)));
+    const auto [it, inserted] = task_ids.emplace(cell, tasks.size());
+    if (inserted) {
+      tasks.push_back(CellTask{cell, {}});
+    }
+    auto &ids = tasks[it->second].cluster_ids;
+    if (std::find(ids.begin(), ids.end(), cluster_id) == ids.end()) {
+      ids.push_back(cluster_id);
+    }
+  }
+  num_threads = (std::min)(num_threads, (std::max)(std::size_t(1), tasks.size()));
+
+  // Each thread accumulates pixels into its own maps: maps are reduced at the end
+  std::vector<std::vector<internal::PseudoBulkMap>> maps(
+      num_threads, std::vector<internal::PseudoBulkMap>(clusters.size()));
+  std::vector<std::uint8_t> float_pixels(clusters.size(), false);
+
+  // HDF5 is not guaranteed to be thread-safe: opening and reading cells is serialized using
+  // io_mtx, while pixels are accumulated concurrently
+  std::mutex io_mtx;
+  std::atomic<std::size_t> next_task{0};
+  std::atomic<bool> early_return{false};
+  std::exception_ptr except{};
+  std::mutex except_mtx;
+
+  auto worker = [&](std::size_t thread_id) {
+    std::vector<std::uint64_t> bin1_buff{};
+    std::vector<std::uint64_t> bin2_buff{};
+    std::vector<double> count_buff{};
+
+    try {
+      while (!early_return) {
+        const auto i = next_task++;
+        if (i >= tasks.size()) {
+          break;
+        }
+        const auto &task = tasks[i];
+        {
+          // Cells are usually small: read all their pixels at once
+          [[maybe_unused]] const std::scoped_lock lck(io_mtx);
+          const auto clr = sclr.open(task.cell);
+          const auto nnz = clr.dataset("pixels/bin1_id").size();
+          if (nnz != 0) {
+            clr.dataset("pixels/bin1_id").read(bin1_buff, nnz);
+            clr.dataset("pixels/bin2_id").read(bin2_buff, nnz);
+            clr.dataset("pixels/count").read(count_buff, nnz);
+          } else {
+            bin1_buff.clear();
+          }
+          if (clr.has_float_pixels()) {
+            for (const auto id : task.cluster_ids) {
+              float_pixels[id] = true;
+            }
+          }
+        }
+
+        for (const auto id : task.cluster_ids) {
+          auto &map = maps[thread_id][id];
+          for (std::size_t j = 0; j < bin1_buff.size(); ++j) {
+            map[(bin1_buff[j] * num_bins) + bin2_buff[j]] += count_buff[j];
+          }
+        }
+      }
+    } catch (...) {
+      [[maybe_unused]] const std::scoped_lock lck(except_mtx);
+      early_return = true;
+      if (!except) {
+        except = std::current_exception();
+      }
+    }
+  };
+
+  std::vector<std::thread> threads{};
+  threads.reserve(num_threads - 1);
+  for (std::size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(worker, i);
+  }
+  worker(0);
+
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  if (except) {
+    std::rethrow_exception(except);
+  }
+
+  std::vector<std::string> uris{};
+  std::vector<std::uint64_t> keys{};
+  std::vector<double> counts{};
+  for (std::size_t i = 0; i < clusters.size(); ++i) {
+    auto &map = maps.front()[i];
+    for (std::size_t j = 1; j < maps.size(); ++j) {
+      for (const auto &[key, count] : maps[j][i]) {
+        map[key] += count;
+      }
+      maps[j][i] = internal::PseudoBulkMap{};
+    }
+
+    keys.clear();
+    counts.clear();
+    keys.reserve(map.size());
+    counts.reserve(map.size());
+    for (const auto &[key, count] : map) {
+      keys.push_back(key);
+      counts.push_back(count);
+    }
+    map = internal::PseudoBulkMap{};
+    internal::radix_sort(keys, counts);
+
+    const auto &uri =
+        uris.emplace_back(fmt::format(FMT_STRING("{}{}.cool"), dest_prefix, clusters[i]));
+    try {
+      if (float_pixels[i]) {
+        internal::write_pseudobulk_cooler<double>(uri, sclr.bins(), keys, counts,
+                                                  overwrite_if_exists, chunk_size);
+      } else {
+        internal::write_pseudobulk_cooler<std::int32_t>(uri, sclr.bins(), keys, counts,
+                                                        overwrite_if_exists, chunk_size);
+      }
+    } catch (const std::exception &e) {
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("failed to write pseudo-bulk cooler for cluster \"{}\": {}"),
+                      clusters[i], e.what()));
+    }
+  }
+  return uris;
+}
+
+}  // namespace coolerpp::utils
@@ -0,0 +1,270 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "coolerpp/coolerpp.hpp"
+
+namespace coolerpp::utils {
+
+namespace internal {
+
+template <typename N>
+inline PixelCoarsener<N>::PixelCoarsener(File& dest, std::uint32_t factor, std::size_t chunk_size)
+    : _dest(&dest),
+      _factor(factor),
+      _row(dest.bins().size(), N(0)),
+      _chunk_size((std::max)(std::size_t(1), chunk_size)) {
+  assert(factor != 0);
+  this->_bin1_buff.reserve(this->_chunk_size);
+  this->_bin2_buff.reserve(this->_chunk_size);
+  this->_count_buff.reserve(this->_chunk_size);
+}
+
+template <typename N>
+inline void PixelCoarsener<N>::add(std::uint32_t chrom1_id, std::uint64_t rel_bin1_id,
+                                   std::uint32_t chrom2_id, std::uint64_t rel_bin2_id, N count) {
+  const auto bin1_id = this->map_bin_id(chrom1_id, rel_bin1_id);
+  const auto bin2_id = this->map_bin_id(chrom2_id, rel_bin2_id);
+  assert(bin1_id <= bin2_id);
+
+  // Pixels are sorted by bin1_id, and the mapping from fine to coarse bins preserves the ordering:
+  // once bin1_id changes, we will never see pixels belonging to the current row again
+  if (bin1_id != this->_bin1_id) {
+    this->flush_row();
+    this->_bin1_id = bin1_id;
+  }
+
+  auto& n = this->_row[bin2_id];
+  if (n == 0) {
+    this->_row_bin2_ids.push_back(bin2_id);
+  }
+  n += count;
+}
+
+template <typename N>
+inline void PixelCoarsener<N>::finalize() {
+  this->flush_row();
+  this->write_pixels();
+}
+
+template <typename N>
+inline std::uint64_t PixelCoarsener<N>::map_bin_id(std::uint32_t chrom_id,
+                                                   std::uint64_t rel_bin_id) const noexcept {
+  const auto& prefix_sum = this->_dest->bins().num_bin_prefix_sum();
+  assert(chrom_id < prefix_sum.size() - 1);
+  return prefix_sum[chrom_id] + (rel_bin_id / this->_factor);
+}
+
+template <typename N>
+inline void PixelCoarsener<N>::flush_row() {
+  auto& bin2_ids = this->_row_bin2_ids;
+  std::sort(bin2_ids.begin(), bin2_ids.end());
+  bin2_ids.erase(std::unique(bin2_ids.begin(), bin2_ids.end()), bin2_ids.end());
+
+  for (const auto bin2_id : bin2_ids) {
+    const auto count = this->_row[bin2_id];
+    this->_row[bin2_id] = 0;
+    if (count == 0) {
+      continue;
+    }
+
+    this->_bin1_buff.push_back(this->_bin1_id);
+    this->_bin2_buff.push_back(bin2_id);
+    this->_count_buff.push_back(count);
+    if (this->_bin1_buff.size() == this->_chunk_size) {
+      this->write_pixels();
+    }
+  }
+  bin2_ids.clear();
+}
+
+template <typename N>
+inline void PixelCoarsener<N>::write_pixels() {
+  this->_dest->append_pixels_columns(this->_bin1_buff.data(), this->_bin2_buff.data(),
+                                     this->_count_buff.data(), this->_bin1_buff.size());
+  this->_bin1_buff.clear();
+  this->_bin2_buff.clear();
+  this->_count_buff.clear();
+}
+
+// Stream the pixels from src once and feed them to all coarseners
+template <typename N>
+inline void coarsen_pixels(const File& src, std::vector<PixelCoarsener<N>>& coarseners,
+                           std::size_t chunk_size) {
+  chunk_size = (std::max)(std::size_t(1), chunk_size);
+
+  const auto& bin1_dset = src.dataset("pixels/bin1_id");
+  const auto& bin2_dset = src.dataset("pixels/bin2_id");
+  const auto& count_dset = src.dataset("pixels/count");
+  const auto& bins = src.bins();
+  const auto& prefix_sum = bins.num_bin_prefix_sum();
+  const auto num_bins = bins.size();
+
+  std::vector<std::uint64_t> bin1_buff{};
+  std::vector<std::uint64_t> bin2_buff{};
+  std::vector<N> count_buff{};
+
+  const auto nnz = bin1_dset.size();
+  for (std::size_t offset = 0; offset < nnz; offset += chunk_size) {
+    const auto num = (std::min)(chunk_size, nnz - offset);
+    bin1_dset.read(bin1_buff, num, offset);
+    bin2_dset.read(bin2_buff, num, offset);
+    count_dset.read(count_buff, num, offset);
+
+    for (std::size_t i = 0; i < num; ++i) {
+      const auto bin1_id = bin1_buff[i];
+      const auto bin2_id = bin2_buff[i];
+      if (bin1_id >= num_bins || bin2_id >= num_bins) {
+        throw std::out_of_range(
+            fmt::format(FMT_STRING("invalid bin id {}: bin maps outside of the bin table"),
+                        (std::max)(bin1_id, bin2_id)));
+      }
+      const auto chrom1_id = bins.map_to_chrom_idx(bin1_id);
+      const auto chrom2_id = bins.map_to_chrom_idx(bin2_id);
+
+      for (auto& coarsener : coarseners) {
+        coarsener.add(chrom1_id, bin1_id - prefix_sum[chrom1_id], chrom2_id,
+                      bin2_id - prefix_sum[chrom2_id], count_buff[i]);
+      }
+    }
+  }
+
+  for (auto& coarsener : coarseners) {
+    coarsener.finalize();
+  }
+}
+
+template <typename N>
+inline void coarsen_cooler(const File& src, const std::vector<std::string>& dest_uris,
+                           const std::vector<std::uint32_t>& factors, bool overwrite_if_exists,
+                           std::size_t chunk_size) {
+  assert(dest_uris.size() == factors.size());
+
+  // Coarseners keep a pointer to the File they are writing to: make sure dests is never
+  // re-allocated
+  std::vector<File> dests{};
+  dests.reserve(dest_uris.size());
+  for (std::size_t i = 0; i < dest_uris.size(); ++i) {
+    const auto bin_size = src.bin_size() * factors[i];
+    auto attrs = StandardAttributes::init<N>(bin_size);
+    attrs.assembly = src.attributes().assembly;
+    dests.emplace_back(File::create_new_cooler<N>(dest_uris[i], src.chromosomes(), bin_size,
+                                                  overwrite_if_exists, attrs));
+  }
+
+  std::vector<PixelCoarsener<N>> coarseners{};
+  coarseners.reserve(dests.size());
+  for (std::size_t i = 0; i < dests.size(); ++i) {
+    coarseners.emplace_back(dests[i], factors[i], chunk_size);
+  }
+
+  coarsen_pixels(src, coarseners, chunk_size);
+}
+
+inline void check_bins_are_fixed(const File& src) {
+  // Coolers with variable bins have a bin size of 0 and cannot be coarsened by a fixed factor
+  if (src.bins().type() == BinTable::Type::VARIABLE) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("cooler \"{}\" has variable bins: coarsening is only supported for coolers with "
+                   "fixed bins"),
+        src.uri()));
+  }
+}
+
+[[nodiscard]] inline std::uint32_t compute_coarsening_factor(std::uint32_t base_resolution,
+                                                             std::uint64_t resolution) {
+  if (base_resolution == 0) {
+    throw std::runtime_error(
+        "cannot compute the coarsening factor of a cooler with variable bins");
+  }
+  if (resolution < base_resolution || resolution % base_resolution != 0 ||
+      resolution > (std::numeric_limits<std::uint32_t>::max)()) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("resolution {} is not a multiple of the base resolution ({})"), resolution,
+        base_resolution));
+  }
+  return static_cast<std::uint32_t>(resolution / base_resolution);
+}
+
+}  // namespace internal
+
+inline void coarsen(std::string_view src_uri, std::string_view dest_uri, std::uint32_t factor,
+                    bool overwrite_if_exists, std::size_t chunk_size) {
+  if (factor == 0) {
+    throw std::logic_error("coarsening factor cannot be zero.");
+  }
+
+  const auto src = File::open_read_only_read_once(src_uri);
+  internal::check_bins_are_fixed(src);
+  const auto factor_ = internal::compute_coarsening_factor(
+      src.bin_size(), std::uint64_t(src.bin_size()) * std::uint64_t(factor));
+  try {
+    if (src.has_float_pixels()) {
+      internal::coarsen_cooler<double>(src, {std::string{dest_uri}}, {factor_},
+                                       overwrite_if_exists, chunk_size);
+    } else {
+      internal::coarsen_cooler<std::int32_t>(src, {std::string{dest_uri}}, {factor_},
+                                             overwrite_if_exists, chunk_size);
+    }
+  } catch (const std::exception& e) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("failed to coarsen cooler \"{}\": {}"), src.uri(), e.what()));
+  }
+}
+
+template <typename ResIt>
+inline void zoomify(std::string_view src_uri, std::string_view dest_path, ResIt first_resolution,
+                    ResIt last_resolution, bool overwrite_if_exists, std::size_t chunk_size) {
+  using I = remove_cvref_t<decltype(*first_resolution)>;
+  static_assert(std::is_integral_v<I>,
+                "ResIt should be an iterator over a collection of integral numbers.");
+
+  const auto src = File::open_read_only_read_once(src_uri);
+  internal::check_bins_are_fixed(src);
+
+  std::vector<std::uint32_t> resolutions{src.bin_size()};
+  std::transform(first_resolution, last_resolution, std::back_inserter(resolutions),
+                 [&](const auto res) {
+                   const auto factor = internal::compute_coarsening_factor(
+                       src.bin_size(), conditional_static_cast<std::uint64_t>(res));
+                   return src.bin_size() * factor;
+                 });
+  std::sort(resolutions.begin(), resolutions.end());
+  resolutions.erase(std::unique(resolutions.begin(), resolutions.end()), resolutions.end());
+
+  std::vector<std::string> dest_uris{};
+  std::vector<std::uint32_t> factors{};
+  for (const auto res : resolutions) {
+    dest_uris.emplace_back(fmt::format(FMT_STRING("{}::/resolutions/{}"), dest_path, res));
+    factors.push_back(res / src.bin_size());
+  }
+
+  try {
+    init_mcool(dest_path, resolutions.begin(), resolutions.end(), overwrite_if_exists);
+    if (src.has_float_pixels()) {
+      internal::coarsen_cooler<double>(src, dest_uris, factors, false, chunk_size);
+    } else {
+      internal::coarsen_cooler<std::int32_t>(src, dest_uris, factors, false, chunk_size);
+    }
+  } catch (const std::exception& e) {
+    throw std::runtime_error(fmt::format(FMT_STRING("failed to zoomify cooler \"{}\": {}"),
+                                         src.uri(), e.what()));
+  }
+}
+
+}  // namespace coolerpp::utils
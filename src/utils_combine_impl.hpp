@@ -0,0 +1,304 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/balancing.hpp"
+#include "coolerpp/coolerpp.hpp"
+
+namespace coolerpp::utils {
+
+namespace internal {
+inline bool PixelCombiner::Source::exhausted() const noexcept {
+  return this->i == this->bin1_buff.size();
+}
+
+inline std::uint64_t PixelCombiner::Source::bin1_id() const noexcept {
+  assert(!this->exhausted());
+  return this->bin1_buff[this->i];
+}
+
+inline std::uint64_t PixelCombiner::Source::bin2_id() const noexcept {
+  assert(!this->exhausted());
+  return this->bin2_buff[this->i];
+}
+
+inline double PixelCombiner::Source::count() const noexcept {
+  assert(!this->exhausted());
+  return this->count_buff[this->i];
+}
+
+inline void PixelCombiner::Source::advance(std::size_t chunk_size) {
+  assert(!this->exhausted());
+  if (++this->i == this->bin1_buff.size()) {
+    this->read_chunk(chunk_size);
+  }
+}
+
+inline void PixelCombiner::Source::read_chunk(std::size_t chunk_size) {
+  assert(this->next_offset <= this->last_offset);
+  const auto num = (std::min)(chunk_size, this->last_offset - this->next_offset);
+  this->i = 0;
+  if (num == 0) {
+    this->bin1_buff.clear();
+    return;
+  }
+
+  this->reader.read(this->bin1_buff, this->bin2_buff, this->count_buff, num, this->next_offset);
+  this->next_offset += num;
+
+  if (this->weights) {
+    this->weights->balance(this->bin1_buff.data(), this->bin2_buff.data(),
+                           this->count_buff.data(), this->count_buff.size(),
+                           this->count_buff.data());
+  }
+}
+
+inline PixelCombiner::PixelCombiner(const File& clr1, const File& clr2,
+                                    std::shared_ptr<const Weights> weights1,
+                                    std::shared_ptr<const Weights> weights2, CombineOp op,
+                                    const CombineOptions& options)
+    : PixelCombiner(clr1, clr2, std::move(weights1), std::move(weights2), op, options,
+                    {OffsetRange{0, clr1.index().nnz()}, OffsetRange{0, clr2.index().nnz()}},
+                    nullptr) {}
+
+inline PixelCombiner::PixelCombiner(const File& clr1, const File& clr2,
+                                    std::shared_ptr<const Weights> weights1,
+                                    std::shared_ptr<const Weights> weights2, CombineOp op,
+                                    const CombineOptions& options,
+                                    const std::vector<OffsetRange>& offsets, std::mutex& io_mtx)
+    : PixelCombiner(clr1, clr2, std::move(weights1), std::move(weights2), op, options, offsets,
+                    &io_mtx) {}
+
+inline PixelCombiner::PixelCombiner(const File& clr1, const File& clr2,
+                                    std::shared_ptr<const Weights> weights1,
+                                    std::shared_ptr<const Weights> weights2, CombineOp op,
+                                    const CombineOptions& options,
+                                    const std::vector<OffsetRange>& offsets, std::mutex* io_mtx)
+    : _src1(make_source(clr1, std::move(weights1), offsets.at(0), io_mtx)),
+      _src2(make_source(clr2, std::move(weights2), offsets.at(1), io_mtx)),
+      _op(op),
+      _pseudocount(options.pseudocount),
+      _fill_zero(options.fill_zero),
+      _chunk_size((std::max)(std::size_t(1), options.chunk_size)) {
+  assert(offsets.size() == 2);
+  this->_src1.read_chunk(this->_chunk_size);
+  this->_src2.read_chunk(this->_chunk_size);
+}
+
+template <typename N, typename Sink>
+inline void PixelCombiner::combine_columns(Sink&& sink) {
+  std::vector<std::uint64_t> bin1_ids{};
+  std::vector<std::uint64_t> bin2_ids{};
+  std::vector<N> counts{};
+  bin1_ids.reserve(this->_chunk_size);
+  bin2_ids.reserve(this->_chunk_size);
+  counts.reserve(this->_chunk_size);
+
+  while (this->join_batch()) {
+    this->apply_op();
+
+    bin1_ids.clear();
+    bin2_ids.clear();
+    counts.clear();
+    for (std::size_t i = 0; i < this->_count1_buff.size(); ++i) {
+      const auto value = this->_count1_buff[i];
+      if (value != 0 && std::isfinite(value)) {
+        bin1_ids.push_back(this->_bin1_buff[i]);
+        bin2_ids.push_back(this->_bin2_buff[i]);
+        counts.push_back(conditional_static_cast<N>(value));
+      }
+    }
+    if (!bin1_ids.empty()) {
+      sink(bin1_ids, bin2_ids, counts);
+    }
+  }
+}
+
+inline auto PixelCombiner::make_source(const File& clr, std::shared_ptr<const Weights> weights,
+                                       OffsetRange offsets, std::mutex* io_mtx) -> Source {
+  Source src{};
+  src.reader = coolerpp::internal::PixelColumnReader<double>{
+      clr.dataset("pixels/bin1_id"), clr.dataset("pixels/bin2_id"), clr.dataset("pixels/count"),
+      io_mtx};
+  src.weights = std::move(weights);
+  src.next_offset = conditional_static_cast<std::size_t>(offsets.first);
+  src.last_offset = conditional_static_cast<std::size_t>(offsets.second);
+  return src;
+}
+
+inline bool PixelCombiner::join_batch() {
+  this->_bin1_buff.clear();
+  this->_bin2_buff.clear();
+  this->_count1_buff.clear();
+  this->_count2_buff.clear();
+
+  auto& src1 = this->_src1;
+  auto& src2 = this->_src2;
+  while (this->_bin1_buff.size() < this->_chunk_size &&
+         (!src1.exhausted() || !src2.exhausted())) {
+    // cmp < 0: pixel only found in src1, cmp > 0: pixel only found in src2, cmp == 0: both
+    int cmp = 0;
+    if (src1.exhausted()) {
+      cmp = 1;
+    } else if (src2.exhausted()) {
+      cmp = -1;
+    } else {
+      const auto key1 = std::make_pair(src1.bin1_id(), src1.bin2_id());
+      const auto key2 = std::make_pair(src2.bin1_id(), src2.bin2_id());
+      cmp = key1 < key2 ? -1 : static_cast<int>(key2 < key1);
+    }
+
+    const auto bin1_id = cmp <= 0 ? src1.bin1_id() : src2.bin1_id();
+    const auto bin2_id = cmp <= 0 ? src1.bin2_id() : src2.bin2_id();
+    const auto count1 = cmp <= 0 ? src1.count() : 0.0;
+    const auto count2 = cmp >= 0 ? src2.count() : 0.0;
+    if (cmp <= 0) {
+      src1.advance(this->_chunk_size);
+    }
+    if (cmp >= 0) {
+      src2.advance(this->_chunk_size);
+    }
+
+    if (cmp != 0 && !this->_fill_zero) {
+      continue;
+    }
+    this->_bin1_buff.push_back(bin1_id);
+    this->_bin2_buff.push_back(bin2_id);
+    this->_count1_buff.push_back(count1);
+    this->_count2_buff.push_back(count2);
+  }
+
+  return !this->_bin1_buff.empty();
+}
+
+inline void PixelCombiner::apply_op() noexcept {
+  assert(this->_count1_buff.size() == this->_count2_buff.size());
+  const auto n = this->_count1_buff.size();
+  auto* counts1 = this->_count1_buff.data();
+  const auto* counts2 = this->_count2_buff.data();
+  const auto pseudocount = this->_pseudocount;
+
+  // Ops are applied with one branch-free loop per op, so that loops can be vectorized
+  // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  switch (this->_op) {
+    case CombineOp::SUM:
+      for (std::size_t i = 0; i < n; ++i) {
+        counts1[i] += counts2[i];
+      }
+      return;
+    case CombineOp::DIFFERENCE:
+      for (std::size_t i = 0; i < n; ++i) {
+        counts1[i] -= counts2[i];
+      }
+      return;
+    case CombineOp::RATIO:
+      for (std::size_t i = 0; i < n; ++i) {
+        counts1[i] = (counts1[i] + pseudocount) / (counts2[i] + pseudocount);
+      }
+      return;
+    case CombineOp::LOG2_RATIO:
+      for (std::size_t i = 0; i < n; ++i) {
+        counts1[i] = std::log2((counts1[i] + pseudocount) / (counts2[i] + pseudocount));
+      }
+      return;
+  }
+  // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+template <typename N>
+inline void combine_coolers(const std::vector<File>& coolers, File& dest,
+                            const std::shared_ptr<const Weights>& weights1,
+                            const std::shared_ptr<const Weights>& weights2, CombineOp op,
+                            const CombineOptions& options, std::size_t num_threads) {
+  assert(coolers.size() == 2);
+  assert(num_threads != 0);
+
+  if (num_threads == 1) {
+    PixelCombiner(coolers.front(), coolers.back(), weights1, weights2, op, options)
+        .combine_columns<N>([&](const auto& bin1_ids, const auto& bin2_ids, const auto& counts) {
+          dest.append_pixels_columns(bin1_ids.data(), bin2_ids.data(), counts.data(),
+                                     bin1_ids.size());
+        });
+    return;
+  }
+
+  const auto partitions = coolerpp::internal::partition_pixel_tables(
+      coolers, num_threads * coolerpp::internal::PARTITIONS_PER_THREAD);
+  const auto max_buffered_pixels = 2 * num_threads * options.chunk_size;
+  process_partitions_parallel<N>(
+      dest, partitions.size(), num_threads, max_buffered_pixels, "combine", true,
+      [&](std::size_t i, std::mutex& io_mtx, auto&& sink) {
+        PixelCombiner combiner(coolers.front(), coolers.back(), weights1, weights2, op, options,
+                               partitions[i], io_mtx);
+        combiner.combine_columns<N>(sink);
+      });
+}
+}  // namespace internal
+
+inline void combine(std::string_view uri1, std::string_view uri2, std::string_view dest_uri,
+                    CombineOp op, const CombineOptions& options) {
+  std::vector<File> clrs{};
+  clrs.emplace_back(File::open_read_only_read_once(std::string{uri1}));
+  clrs.emplace_back(File::open_read_only_read_once(std::string{uri2}));
+  const auto& clr1 = clrs.front();
+  const auto& clr2 = clrs.back();
+
+  if (clr1.bins() != clr2.bins()) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("cooler \"{}\" and \"{}\" have different bin tables"), clr1.uri(),
+                    clr2.uri()));
+  }
+
+  std::shared_ptr<const Weights> weights1{};
+  std::shared_ptr<const Weights> weights2{};
+  if (!options.weights.empty()) {
+    weights1 = clr1.read_weights(options.weights);
+    weights2 = clr2.read_weights(options.weights);
+  }
+
+  const auto integer_counts = !clr1.has_float_pixels() && !clr2.has_float_pixels() &&
+                              !weights1 && (op == CombineOp::SUM || op == CombineOp::DIFFERENCE);
+  const auto num_threads = options.num_threads == 0
+                               ? std::size_t((std::max)(1U, std::thread::hardware_concurrency()))
+                               : options.num_threads;
+
+  auto dest = integer_counts
+                  ? File::create_new_cooler<std::int32_t>(dest_uri, clr1.chromosomes(),
+                                                          clr1.bin_size(),
+                                                          options.overwrite_if_exists)
+                  : File::create_new_cooler<double>(dest_uri, clr1.chromosomes(), clr1.bin_size(),
+                                                    options.overwrite_if_exists);
+
+  try {
+    if (integer_counts) {
+      internal::combine_coolers<std::int32_t>(clrs, dest, weights1, weights2, op, options,
+                                              num_threads);
+    } else {
+      internal::combine_coolers<double>(clrs, dest, weights1, weights2, op, options,
+                                        num_threads);
+    }
+  } catch (const std::exception& e) {
+    throw std::runtime_error(fmt::format(FMT_STRING("failed to combine coolers {} and {}: {}"),
+                                         clr1.uri(), clr2.uri(), e.what()));
+  }
+}
+}  // namespace coolerpp::utils
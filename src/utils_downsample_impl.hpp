@@ -0,0 +1,405 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "coolerpp/coolerpp.hpp"
+
+namespace coolerpp::utils {
+
+namespace internal {
+
+// Interactions from pixels with up to this many interactions are drawn one at a time
+inline constexpr std::uint64_t DOWNSAMPLE_EXACT_DRAW_THRESHOLD = 32;
+
+// A row-aligned range of pixels, the sum of its interactions, and the number of interactions that
+// should be drawn from it
+struct DownsampleRange {
+  std::uint64_t first_offset{};
+  std::uint64_t last_offset{};
+  std::uint64_t sum{};
+  std::uint64_t target_sum{};
+};
+
+template <typename N>
+struct DownsampledPixels {
+  std::vector<std::uint64_t> bin1_ids{};
+  std::vector<std::uint64_t> bin2_ids{};
+  std::vector<N> counts{};
+};
+
+// Generators used to sample different ranges are seeded from the same seed and a different
+// stream id: stream 0 is used to split the target sum across ranges, while range i uses stream i+1
+[[nodiscard]] inline std::mt19937_64 make_downsample_rng(std::uint64_t seed,
+                                                         std::uint64_t stream_id) {
+  std::seed_seq seq{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32U),
+                    static_cast<std::uint32_t>(stream_id),
+                    static_cast<std::uint32_t>(stream_id >> 32U)};
+  return std::mt19937_64{seq};
+}
+
+// Return how many of the count interactions of a pixel should be kept, given that num_draws
+// interactions are still to be drawn from the num_interactions interactions left (including those
+// of the current pixel).
+// Interactions from pixels with few interactions are drawn one at a time (i.e. the number of
+// interactions kept follows the hypergeometric distribution), while for pixels with many
+// interactions the hypergeometric distribution is approximated by a binomial distribution.
+// In both cases, the value returned leaves enough interactions to satisfy the remaining draws:
+// this guarantees that exactly num_draws interactions are drawn once all pixels have been visited
+template <typename RNG>
+[[nodiscard]] inline std::uint64_t draw_interactions(RNG &rng, std::uint64_t count,
+                                                     std::uint64_t num_draws,
+                                                     std::uint64_t num_interactions) {
+  assert(count <= num_interactions);
+  assert(num_draws <= num_interactions);
+  if (count == 0 || num_draws == 0) {
+    return 0;
+  }
+  if (num_draws == num_interactions) {
+    return count;
+  }
+
+  const auto num_interactions_left = num_interactions - count;
+  const auto min_draws = num_draws > num_interactions_left ? num_draws - num_interactions_left : 0;
+  const auto max_draws = (std::min)(count, num_draws);
+  if (min_draws == max_draws) {
+    return min_draws;
+  }
+
+  if (count <= DOWNSAMPLE_EXACT_DRAW_THRESHOLD) {
+    std::uint64_t num_kept = 0;
+    for (std::uint64_t i = 0; i < count; ++i) {
+      // Keep each interaction with probability num_draws / num_interactions
+      const auto u = conditional_static_cast<double>(rng() >> 11U) * 0x1.0p-53;
+      if (u * conditional_static_cast<double>(num_interactions) <
+          conditional_static_cast<double>(num_draws)) {
+        ++num_kept;
+        --num_draws;
+      }
+      --num_interactions;
+    }
+    return num_kept;
+  }
+
+  std::binomial_distribution<std::uint64_t> dist(
+      count, conditional_static_cast<double>(num_draws) /
+                 conditional_static_cast<double>(num_interactions));
+  return std::clamp(dist(rng), min_draws, max_draws);
+}
+
+// Split the pixels of src into row-aligned ranges of roughly chunk_size pixels and compute the sum
+// of the interactions of each range
+template <typename N>
+[[nodiscard]] inline std::vector<DownsampleRange> init_downsample_ranges(
+    const std::vector<File> &src, std::size_t chunk_size) {
+  assert(src.size() == 1);
+  const auto &count_dset = src.front().dataset("pixels/count");
+  const auto nnz = count_dset.size();
+
+  const auto num_partitions = (std::max)(std::size_t(1), (nnz + chunk_size - 1) / chunk_size);
+  std::vector<DownsampleRange> ranges{};
+  std::vector<N> count_buff{};
+  for (const auto &offsets : coolerpp::internal::partition_pixel_tables(src, num_partitions)) {
+    auto &range = ranges.emplace_back(
+        DownsampleRange{offsets.front().first, offsets.front().second, 0, 0});
+    for (auto offset = range.first_offset; offset < range.last_offset; offset += chunk_size) {
+      const auto num = (std::min)(chunk_size, conditional_static_cast<std::size_t>(
+                                                  range.last_offset - offset));
+      count_dset.read(count_buff, num, conditional_static_cast<std::size_t>(offset));
+      for (const auto count : count_buff) {
+        if constexpr (std::is_signed_v<N>) {
+          if (count < 0) {
+            throw std::runtime_error(fmt::format(
+                FMT_STRING("found pixel with a negative count ({}): coolers with negative counts "
+                           "cannot be downsampled"),
+                count));
+          }
+        }
+        range.sum += conditional_static_cast<std::uint64_t>(count);
+      }
+    }
+  }
+  return ranges;
+}
+
+// Distribute target_sum interactions across ranges
+inline void split_downsample_target(std::vector<DownsampleRange> &ranges, std::uint64_t target_sum,
+                                    std::uint64_t seed) {
+  auto rng = make_downsample_rng(seed, 0);
+  std::uint64_t num_interactions = 0;
+  for (const auto &range : ranges) {
+    num_interactions += range.sum;
+  }
+  assert(target_sum <= num_interactions);
+
+  for (auto &range : ranges) {
+    range.target_sum = draw_interactions(rng, range.sum, target_sum, num_interactions);
+    target_sum -= range.target_sum;
+    num_interactions -= range.sum;
+  }
+  assert(target_sum == 0);
+}
+
+// Draw range.target_sum interactions from the pixels in range. Reads from src are serialized
+// using io_mtx
+template <typename N>
+inline void downsample_range(const File &src, const DownsampleRange &range, std::uint64_t seed,
+                             std::uint64_t range_id, std::size_t chunk_size, std::mutex &io_mtx,
+                             DownsampledPixels<N> &buff) {
+  const auto &bin1_dset = src.dataset("pixels/bin1_id");
+  const auto &bin2_dset = src.dataset("pixels/bin2_id");
+  const auto &count_dset = src.dataset("pixels/count");
+
+  auto rng = make_downsample_rng(seed, range_id + 1);
+  auto num_draws = range.target_sum;
+  auto num_interactions = range.sum;
+
+  buff.bin1_ids.clear();
+  buff.bin2_ids.clear();
+  buff.counts.clear();
+
+  std::vector<std::uint64_t> bin1_buff{};
+  std::vector<std::uint64_t> bin2_buff{};
+  std::vector<N> count_buff{};
+  for (auto offset = range.first_offset; offset < range.last_offset && num_draws != 0;
+       offset += chunk_size) {
+    const auto num = (std::min)(chunk_size, conditional_static_cast<std::size_t>(
+                                                range.last_offset - offset));
+    {
+      [[maybe_unused]] const std::scoped_lock lck(io_mtx);
+      bin1_dset.read(bin1_buff, num, conditional_static_cast<std::size_t>(offset));
+      bin2_dset.read(bin2_buff, num, conditional_static_cast<std::size_t>(offset));
+      count_dset.read(count_buff, num, conditional_static_cast<std::size_t>(offset));
+    }
+
+    for (std::size_t i = 0; i < num && num_draws != 0; ++i) {
+      const auto count = conditional_static_cast<std::uint64_t>(count_buff[i]);
+      const auto num_kept = draw_interactions(rng, count, num_draws, num_interactions);
+      num_draws -= num_kept;
+      num_interactions -= count;
+      if (num_kept != 0) {
+        buff.bin1_ids.push_back(bin1_buff[i]);
+        buff.bin2_ids.push_back(bin2_buff[i]);
+        buff.counts.push_back(conditional_static_cast<N>(num_kept));
+      }
+    }
+  }
+  assert(num_draws == 0);
+}
+
+template <typename N>
+inline void append_downsampled_pixels(File &dest, const DownsampledPixels<N> &buff) {
+  if (!buff.counts.empty()) {
+    dest.append_pixels_columns(buff.bin1_ids.data(), buff.bin2_ids.data(), buff.counts.data(),
+                               buff.counts.size());
+  }
+}
+
+template <typename N>
+inline void downsample_pixels(const File &src, File &dest,
+                              const std::vector<DownsampleRange> &ranges, std::uint64_t seed,
+                              std::size_t num_threads, std::size_t chunk_size) {
+  assert(num_threads != 0);
+  num_threads = (std::min)(num_threads, ranges.size());
+
+  std::mutex io_mtx;
+  if (num_threads < 2) {
+    DownsampledPixels<N> buff{};
+    for (std::size_t i = 0; i < ranges.size(); ++i) {
+      downsample_range(src, ranges[i], seed, i, chunk_size, io_mtx, buff);
+      append_downsampled_pixels(dest, buff);
+    }
+    return;
+  }
+
+  // Ranges are sampled concurrently and written to dest in order as soon as they become
+  // available. Workers wait before sampling ranges that are too far ahead of the last range
+  // written to dest: this bounds the number of sampled pixels kept in memory
+  const auto max_ranges_in_flight = 2 * num_threads;
+  std::vector<DownsampledPixels<N>> buffers(ranges.size());
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::vector<std::uint8_t> done(ranges.size(), false);
+  std::size_t num_ranges_written = 0;
+  std::atomic<std::size_t> next_range{0};
+  std::atomic<bool> early_return{false};
+  std::exception_ptr except{};
+
+  auto set_exception = [&]() {
+    {
+      [[maybe_unused]] const std::scoped_lock lck(mtx);
+      early_return = true;
+      if (!except) {
+        except = std::current_exception();
+      }
+    }
+    cv.notify_all();
+  };
+
+  auto worker = [&]() {
+    try {
+      while (!early_return) {
+        const auto i = next_range++;
+        if (i >= ranges.size()) {
+          break;
+        }
+        {
+          std::unique_lock lck(mtx);
+          cv.wait(lck, [&]() {
+            return i < num_ranges_written + max_ranges_in_flight || early_return;
+          });
+          if (early_return) {
+            break;
+          }
+        }
+        downsample_range(src, ranges[i], seed, i, chunk_size, io_mtx, buffers[i]);
+        {
+          [[maybe_unused]] const std::scoped_lock lck(mtx);
+          done[i] = true;
+        }
+        cv.notify_all();
+      }
+    } catch (...) {
+      set_exception();
+    }
+  };
+
+  std::vector<std::thread> threads{};
+  threads.reserve(num_threads);
+  for (std::size_t i = 0; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+
+  try {
+    for (std::size_t i = 0; i < ranges.size(); ++i) {
+      {
+        std::unique_lock lck(mtx);
+        cv.wait(lck, [&]() { return done[i] || early_return; });
+        if (early_return) {
+          break;
+        }
+      }
+      {
+        [[maybe_unused]] const std::scoped_lock lck(io_mtx);
+        append_downsampled_pixels(dest, buffers[i]);
+      }
+      buffers[i] = DownsampledPixels<N>{};
+      {
+        [[maybe_unused]] const std::scoped_lock lck(mtx);
+        ++num_ranges_written;
+      }
+      cv.notify_all();
+    }
+  } catch (...) {
+    set_exception();
+  }
+
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  if (except) {
+    std::rethrow_exception(except);
+  }
+}
+
+// compute_target_sum is called with the sum of the interactions of src and should return the sum
+// of the interactions of dest
+template <typename TargetSumFx>
+inline void downsample_cooler(std::string_view src_uri, std::string_view dest_uri,
+                              TargetSumFx compute_target_sum, std::uint64_t seed,
+                              bool overwrite_if_exists, std::size_t num_threads,
+                              std::size_t chunk_size) {
+  chunk_size = (std::max)(std::size_t(1), chunk_size);
+  if (num_threads == 0) {
+    num_threads = (std::max)(1U, std::thread::hardware_concurrency());
+  }
+
+  std::vector<File> src{};
+  src.emplace_back(File::open_read_only_read_once(src_uri));
+  try {
+    std::visit(
+        [&](auto count) {
+          using N = remove_cvref_t<decltype(count)>;
+          if constexpr (std::is_floating_point_v<N>) {
+            throw std::runtime_error("only coolers with integer counts can be downsampled");
+          } else {
+            auto ranges = init_downsample_ranges<N>(src, chunk_size);
+            std::uint64_t sum = 0;
+            for (const auto &range : ranges) {
+              sum += range.sum;
+            }
+
+            const auto target_sum = compute_target_sum(sum);
+            if (target_sum > sum) {
+              throw std::runtime_error(fmt::format(
+                  FMT_STRING("target sum ({}) is larger than the sum of the interactions ({})"),
+                  target_sum, sum));
+            }
+            split_downsample_target(ranges, target_sum, seed);
+
+            const auto &clr = src.front();
+            auto attrs = StandardAttributes::init<N>(clr.bin_size());
+            attrs.assembly = clr.attributes().assembly;
+            auto dest = File::create_new_cooler<N>(dest_uri, clr.chromosomes(), clr.bin_size(),
+                                                   overwrite_if_exists, attrs);
+            downsample_pixels<N>(clr, dest, ranges, seed, num_threads, chunk_size);
+          }
+        },
+        src.front().pixel_variant());
+  } catch (const std::exception &e) {
+    throw std::runtime_error(fmt::format(FMT_STRING("failed to downsample cooler \"{}\": {}"),
+                                         src.front().uri(), e.what()));
+  }
+}
+
+}  // namespace internal
+
+inline void downsample(std::string_view src_uri, std::string_view dest_uri,
+                       std::uint64_t target_sum, std::uint64_t seed, bool overwrite_if_exists,
+                       std::size_t num_threads, std::size_t chunk_size) {
+  internal::downsample_cooler(
+      src_uri, dest_uri, [&]([[maybe_unused]] std::uint64_t sum) { return target_sum; }, seed,
+      overwrite_if_exists, num_threads, chunk_size);
+}
+
+inline void downsample_fraction(std::string_view src_uri, std::string_view dest_uri,
+                                double fraction, std::uint64_t seed, bool overwrite_if_exists,
+                                std::size_t num_threads, std::size_t chunk_size) {
+  if (!(fraction >= 0.0 && fraction <= 1.0)) {
+    throw std::logic_error(
+        fmt::format(FMT_STRING("invalid downsampling fraction {}: fraction should be between 0 "
+                               "and 1"),
+                    fraction));
+  }
+  internal::downsample_cooler(
+      src_uri, dest_uri,
+      [&](std::uint64_t sum) {
+        const auto target_sum = conditional_static_cast<std::uint64_t>(
+            std::llround(fraction * conditional_static_cast<double>(sum)));
+        return (std::min)(target_sum, sum);
+      },
+      seed, overwrite_if_exists, num_threads, chunk_size);
+}
+
+}  // namespace coolerpp::utils
@@ -4,19 +4,37 @@
 
 #pragma once
 
+#include <H5Dpublic.h>
+#include <H5Ppublic.h>
+#include <fmt/format.h>
+
 #include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <highfive/H5DataType.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
 #include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "coolerpp/coolerpp.hpp"
 
 namespace coolerpp::utils {
 
-inline bool equal(std::string_view uri1, std::string_view uri2, bool ignore_attributes) {
+inline bool equal(std::string_view uri1, std::string_view uri2, bool ignore_attributes,
+                  CompareMode mode, std::size_t num_threads) {
   if (uri1 == uri2) {
     return true;
   }
   return equal(File::open_read_only_read_once(uri1), File::open_read_only_read_once(uri2),
-               ignore_attributes);
+               ignore_attributes, mode, num_threads);
 }
 
 namespace internal {
@@ -41,9 +59,231 @@ inline bool datasets_are_equal(const Dataset& d1, const Dataset& d2) {
   return std::equal(d1.begin<T>(), d1.end<T>(), d2.begin<T>());
 }
 
+template <typename T>
+inline bool dataset_ranges_are_equal(const Dataset& d1, const Dataset& d2, std::size_t offset,
+                                     std::size_t num) {
+  std::vector<T> buff1(num);
+  std::vector<T> buff2(num);
+  d1.read(buff1, num, offset);
+  d2.read(buff2, num, offset);
+  return buff1 == buff2;
+}
+
+// Raw chunk as stored in the file, before undoing filters
+struct RawChunk {
+  std::vector<std::uint8_t> data{};
+  std::uint32_t filter_mask{};
+};
+
+// Return false when the chunk has not been allocated
+[[nodiscard]] inline bool read_raw_chunk(const Dataset& dset, std::size_t offset, RawChunk& chunk) {
+  const auto dset_id = dset.get().getId();
+  auto chunk_offset = conditional_static_cast<hsize_t>(offset);
+  hsize_t chunk_nbytes{};
+  if (H5Dget_chunk_storage_size(dset_id, &chunk_offset, &chunk_nbytes) < 0 || chunk_nbytes == 0) {
+    return false;
+  }
+
+  chunk.data.resize(conditional_static_cast<std::size_t>(chunk_nbytes));
+  if (H5Dread_chunk(dset_id, H5P_DEFAULT, &chunk_offset, &chunk.filter_mask, chunk.data.data()) <
+      0) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("failed to read chunk at offset {} from dataset {}"), offset, dset.uri()));
+  }
+  return true;
+}
+
+// Compare the first num values of two decoded chunks
+template <typename T>
+[[nodiscard]] inline bool decoded_values_are_equal(const std::vector<std::uint8_t>& chunk1,
+                                                   const std::vector<std::uint8_t>& chunk2,
+                                                   std::size_t num) {
+  // Floating point values with different representations may still compare equal (e.g. -0.0 and
+  // 0.0): values are compared one by one
+  for (std::size_t i = 0; i < num; ++i) {
+    T n1{};
+    T n2{};
+    std::memcpy(&n1, chunk1.data() + (i * sizeof(T)), sizeof(T));
+    std::memcpy(&n2, chunk2.data() + (i * sizeof(T)), sizeof(T));
+    if (n1 != n2) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Compare the raw chunks of two datasets. Chunks are decoded only when their raw bytes differ.
+// Return std::nullopt when the datasets cannot be compared by looking at their chunks
+template <typename T>
+[[nodiscard]] inline std::optional<bool> raw_chunks_are_equal(const Dataset& d1, const Dataset& d2,
+                                                              std::size_t num_threads) {
+  assert(d1.size() == d2.size());
+  const auto dtype = d1.get().getDataType();
+  if (dtype != d2.get().getDataType() || dtype.getClass() == HighFive::DataTypeClass::String) {
+    return {};
+  }
+
+  coolerpp::internal::ChunkLayout layout1{};
+  coolerpp::internal::ChunkLayout layout2{};
+  if (!coolerpp::internal::read_chunk_layout(d1.get().getId(), layout1) ||
+      !coolerpp::internal::read_chunk_layout(d2.get().getId(), layout2) ||
+      layout1.chunk_size != layout2.chunk_size || layout1.filters != layout2.filters) {
+    return {};
+  }
+
+  const auto size = d1.size();
+  const auto chunk_size = layout1.chunk_size;
+  const auto type_size = dtype.getSize();
+  const auto float_values = dtype.getClass() == HighFive::DataTypeClass::Float;
+
+  auto decode_and_compare = [&](RawChunk& chunk1, RawChunk& chunk2, std::size_t num) {
+    std::vector<std::uint8_t> tmp{};
+    coolerpp::internal::decode_chunk(layout1, chunk1.filter_mask, type_size, chunk1.data, tmp);
+    coolerpp::internal::decode_chunk(layout1, chunk2.filter_mask, type_size, chunk2.data, tmp);
+    if (std::memcmp(chunk1.data.data(), chunk2.data.data(), num * type_size) == 0) {
+      return true;
+    }
+    if (!float_values) {
+      return false;
+    }
+    return type_size == sizeof(double)
+               ? decoded_values_are_equal<double>(chunk1.data, chunk2.data, num)
+               : decoded_values_are_equal<float>(chunk1.data, chunk2.data, num);
+  };
+
+  // Chunks are fetched serially (libhdf5 is not thread-safe). Chunks whose bytes differ are
+  // collected in batches that are then decoded and compared using num_threads threads
+  const auto batch_size = 4 * num_threads;
+  std::vector<std::pair<RawChunk, RawChunk>> mismatches{};
+  std::vector<std::size_t> mismatch_sizes{};
+  auto process_mismatches = [&]() {
+    std::vector<std::future<bool>> workers{};
+    const auto num_workers = (std::min)(num_threads, mismatches.size());
+    workers.reserve(num_workers);
+    for (std::size_t t = 0; t < num_workers; ++t) {
+      workers.emplace_back(std::async(std::launch::async, [&, t]() {
+        for (auto i = t; i < mismatches.size(); i += num_workers) {
+          if (!decode_and_compare(mismatches[i].first, mismatches[i].second, mismatch_sizes[i])) {
+            return false;
+          }
+        }
+        return true;
+      }));
+    }
+
+    // Make sure all workers are done before propagating exceptions: they access mismatches
+    bool all_equal = true;
+    std::exception_ptr except{};
+    for (auto& w : workers) {
+      try {
+        all_equal &= w.get();
+      } catch (...) {
+        if (!except) {
+          except = std::current_exception();
+        }
+      }
+    }
+    if (except) {
+      std::rethrow_exception(except);
+    }
+    mismatches.clear();
+    mismatch_sizes.clear();
+    return all_equal;
+  };
+
+  RawChunk chunk1{};
+  RawChunk chunk2{};
+  for (std::size_t offset = 0; offset < size; offset += chunk_size) {
+    const auto num = (std::min)(chunk_size, size - offset);
+    if (!read_raw_chunk(d1, offset, chunk1) || !read_raw_chunk(d2, offset, chunk2)) {
+      if (!dataset_ranges_are_equal<T>(d1, d2, offset, num)) {
+        return false;
+      }
+      continue;
+    }
+    if (chunk1.filter_mask == chunk2.filter_mask && chunk1.data == chunk2.data) {
+      continue;
+    }
+
+    if (num_threads == 1) {
+      if (!decode_and_compare(chunk1, chunk2, num)) {
+        return false;
+      }
+      continue;
+    }
+    mismatches.emplace_back(std::move(chunk1), std::move(chunk2));
+    mismatch_sizes.push_back(num);
+    if (mismatches.size() == batch_size && !process_mismatches()) {
+      return false;
+    }
+  }
+  return process_mismatches();
+}
+
+template <typename T = std::int64_t>
+inline bool datasets_are_equal(const Dataset& d1, const Dataset& d2, CompareMode mode,
+                               std::size_t num_threads) {
+  if (d1.size() != d2.size()) {
+    return false;
+  }
+  if (d1.empty()) {
+    return true;
+  }
+
+  if constexpr (std::is_arithmetic_v<T>) {
+    if (mode == CompareMode::RAW_CHUNKS) {
+      if (const auto res = raw_chunks_are_equal<T>(d1, d2, num_threads); res.has_value()) {
+        return *res;
+      }
+    }
+  }
+  return datasets_are_equal<T>(d1, d2);
+}
+
+// 64-bit FNV-1a
+class Fingerprint {
+  static constexpr std::uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+  static constexpr std::uint64_t FNV_PRIME = 0x100000001b3ULL;
+  std::uint64_t _hash{FNV_OFFSET_BASIS};
+
+ public:
+  void update(const void* data, std::size_t num_bytes) noexcept {
+    const auto* bytes = static_cast<const std::uint8_t*>(data);
+    for (std::size_t i = 0; i < num_bytes; ++i) {
+      this->_hash = (this->_hash ^ bytes[i]) * FNV_PRIME;
+    }
+  }
+
+  void update(std::string_view s) noexcept {
+    const auto size = conditional_static_cast<std::uint64_t>(s.size());
+    this->update(&size, sizeof(size));
+    this->update(s.data(), s.size());
+  }
+
+  template <typename T>
+  void update(const Dataset& dset, std::size_t chunk_size) {
+    const auto size = conditional_static_cast<std::uint64_t>(dset.size());
+    this->update(&size, sizeof(size));
+
+    std::vector<T> buff{};
+    for (std::size_t offset = 0; offset < dset.size(); offset += chunk_size) {
+      const auto num = (std::min)(chunk_size, dset.size() - offset);
+      dset.read(buff, num, offset);
+      if constexpr (std::is_arithmetic_v<T>) {
+        this->update(buff.data(), buff.size() * sizeof(T));
+      } else {
+        std::for_each(buff.begin(), buff.end(), [&](const auto& s) { this->update(s); });
+      }
+    }
+  }
+
+  [[nodiscard]] constexpr std::uint64_t digest() const noexcept { return this->_hash; }
+};
+
 }  // namespace internal
 
-inline bool equal(const File& clr1, const File& clr2, bool ignore_attributes) {
+inline bool equal(const File& clr1, const File& clr2, bool ignore_attributes, CompareMode mode,
+                  std::size_t num_threads) {
   if (clr1.uri() == clr2.uri()) {
     return true;
   }
@@ -52,6 +292,17 @@ inline bool equal(const File& clr1, const File& clr2, bool ignore_attributes) {
     return false;
   }
 
+  // Comparing shapes is cheap: do it before looking at the content of any dataset
+  for (const auto name : MANDATORY_DATASET_NAMES) {
+    if (clr1.dataset(name).size() != clr2.dataset(name).size()) {
+      return false;
+    }
+  }
+
+  if (num_threads == 0) {
+    num_threads = (std::max)(1U, std::thread::hardware_concurrency());
+  }
+
   const auto float_counts = clr1.has_float_pixels() || clr2.has_float_pixels();
   for (const auto name : MANDATORY_DATASET_NAMES) {
     bool difference_found;  // NOLINT
@@ -59,11 +310,12 @@ inline bool equal(const File& clr1, const File& clr2, bool ignore_attributes) {
       difference_found =
           !internal::datasets_are_equal<std::string>(clr1.dataset(name), clr2.dataset(name));
     } else if (name == "pixels/count" && float_counts) {
-      difference_found =
-          !internal::datasets_are_equal<double>(clr1.dataset(name), clr2.dataset(name));
+      difference_found = !internal::datasets_are_equal<double>(
+          clr1.dataset(name), clr2.dataset(name), mode, num_threads);
 
     } else {
-      difference_found = !internal::datasets_are_equal(clr1.dataset(name), clr2.dataset(name));
+      difference_found = !internal::datasets_are_equal(clr1.dataset(name), clr2.dataset(name),
+                                                       mode, num_threads);
     }
 
     if (difference_found) {
@@ -74,4 +326,28 @@ inline bool equal(const File& clr1, const File& clr2, bool ignore_attributes) {
   return true;
 }
 
+inline std::uint64_t fingerprint(std::string_view uri, std::size_t chunk_size) {
+  return fingerprint(File::open_read_only_read_once(uri), chunk_size);
+}
+
+inline std::uint64_t fingerprint(const File& clr, std::size_t chunk_size) {
+  chunk_size = (std::max)(std::size_t(1), chunk_size);
+
+  internal::Fingerprint hash{};
+  for (const auto name : MANDATORY_DATASET_NAMES) {
+    hash.update(name);
+    const auto& dset = clr.dataset(name);
+    if (name == "chroms/name") {
+      hash.update<std::string>(dset, chunk_size);
+    } else if (name == "pixels/count") {
+      // Always hash counts as double, as equal() compares integral and floating point counts
+      // after converting them to double
+      hash.update<double>(dset, chunk_size);
+    } else {
+      hash.update<std::int64_t>(dset, chunk_size);
+    }
+  }
+  return hash.digest();
+}
+
 }  // namespace coolerpp::utils
@@ -0,0 +1,616 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/format.h>
+#include <tsl/hopscotch_map.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <highfive/H5File.hpp>
+#include <highfive/H5Group.hpp>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/balancing.hpp"
+#include "coolerpp/coolerpp.hpp"
+#include "coolerpp/dataset.hpp"
+#include "coolerpp/genomic_interval.hpp"
+#include "coolerpp/group.hpp"
+#include "coolerpp/uri.hpp"
+
+namespace coolerpp::utils {
+
+inline std::vector<double> ExpectedCis::average() const {
+  assert(this->count_sum.size() == this->num_valid.size());
+  std::vector<double> avg(this->count_sum.size(), std::numeric_limits<double>::quiet_NaN());
+  for (std::size_t i = 0; i < avg.size(); ++i) {
+    if (this->num_valid[i] != 0) {
+      avg[i] = this->count_sum[i] / conditional_static_cast<double>(this->num_valid[i]);
+    }
+  }
+  return avg;
+}
+
+inline double ExpectedTrans::average() const noexcept {
+  if (this->num_valid == 0) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  return this->count_sum / conditional_static_cast<double>(this->num_valid);
+}
+
+namespace internal {
+
+inline constexpr std::uint32_t EXPECTED_NULL_REGION = (std::numeric_limits<std::uint32_t>::max)();
+
+// Return a mask where bins with a weight that cannot be used to balance pixels are set to false
+[[nodiscard]] inline std::vector<bool> compute_valid_bins(const BinTable &bins,
+                                                          const Weights *weights) {
+  std::vector<bool> valid(bins.size(), true);
+  if (!weights) {
+    return valid;
+  }
+  if (weights->size() != bins.size()) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("invalid weight shape, expected {} values, found {}"), bins.size(),
+                    weights->size()));
+  }
+
+  const auto divisive = weights->type() == Weights::Type::DIVISIVE;
+  for (std::size_t i = 0; i < valid.size(); ++i) {
+    const auto w = (*weights)[i];
+    valid[i] = std::isfinite(w) && (!divisive || w != 0);
+  }
+  return valid;
+}
+
+// Count the number of pixels (i, i + d) for which both bins are valid for every diagonal d of the
+// [first_bin, last_bin) region.
+// Invalid bins are grouped into runs of consecutive bins (masked bins usually come in a few long
+// runs, e.g. centromeres and unmappable regions). The number of pairs of invalid bins at distance d
+// drawn from two runs is a piecewise linear function of d: it is recorded as a second-order
+// difference and recovered with two prefix sums. This takes O(n + r^2) time, where r is the number
+// of runs of invalid bins
+[[nodiscard]] inline std::vector<std::uint64_t> count_valid_pixels_cis(
+    const std::vector<bool> &valid_bins, std::uint64_t first_bin, std::uint64_t last_bin) {
+  assert(first_bin <= last_bin);
+  const auto n = conditional_static_cast<std::size_t>(last_bin - first_bin);
+
+  // Runs of invalid bins are stored as [start, end) pairs
+  std::vector<std::pair<std::size_t, std::size_t>> invalid_runs{};
+  std::vector<std::uint64_t> invalid_prefix_sum(n + 1, 0);
+  for (std::size_t i = 0; i < n; ++i) {
+    const auto is_valid = valid_bins[conditional_static_cast<std::size_t>(first_bin) + i];
+    invalid_prefix_sum[i + 1] = invalid_prefix_sum[i] + !is_valid;
+    if (is_valid) {
+      continue;
+    }
+    if (!invalid_runs.empty() && invalid_runs.back().second == i) {
+      ++invalid_runs.back().second;
+    } else {
+      invalid_runs.emplace_back(i, i + 1);
+    }
+  }
+
+  std::vector<std::int64_t> diff2(n + 1, 0);
+  auto add = [&](std::size_t d, std::int64_t value) {
+    if (d < diff2.size()) {
+      diff2[d] += value;
+    }
+  };
+  for (std::size_t r1 = 0; r1 < invalid_runs.size(); ++r1) {
+    const auto [start1, end1] = invalid_runs[r1];
+    const auto size1 = end1 - start1;
+    // Pairs within the same run: size1 - d pairs for d in [0, size1)
+    add(0, conditional_static_cast<std::int64_t>(size1));
+    add(1, -1 - conditional_static_cast<std::int64_t>(size1));
+    add(size1 + 1, 1);
+    for (std::size_t r2 = r1 + 1; r2 < invalid_runs.size(); ++r2) {
+      const auto [start2, end2] = invalid_runs[r2];
+      const auto size2 = end2 - start2;
+      // Pairs across two runs: distances start at d0, and the number of pairs at each distance is
+      // the convolution of two boxes of width size1 and size2
+      const auto d0 = start2 - end1 + 1;
+      if (d0 >= n) {
+        break;
+      }
+      add(d0, 1);
+      add(d0 + size1, -1);
+      add(d0 + size2, -1);
+      add(d0 + size1 + size2, 1);
+    }
+  }
+
+  // Pixels for which both bins are invalid are subtracted twice below
+  std::vector<std::uint64_t> num_valid(n);
+  std::int64_t slope = 0;
+  std::int64_t num_both_invalid = 0;
+  for (std::size_t d = 0; d < n; ++d) {
+    slope += diff2[d];
+    num_both_invalid += slope;
+    const auto invalid_bin1 = invalid_prefix_sum[n - d];
+    const auto invalid_bin2 = invalid_prefix_sum[n] - invalid_prefix_sum[d];
+    num_valid[d] = (n - d) + conditional_static_cast<std::uint64_t>(num_both_invalid) -
+                   invalid_bin1 - invalid_bin2;
+  }
+  return num_valid;
+}
+
+// Map bin ids to the id of the chromosome they belong to
+[[nodiscard]] inline std::vector<std::uint32_t> map_bins_to_chroms(const BinTable &bins) {
+  std::vector<std::uint32_t> chrom_ids(bins.size());
+  const auto &prefix_sum = bins.num_bin_prefix_sum();
+  for (const Chromosome &chrom : bins.chromosomes()) {
+    const auto first = prefix_sum[chrom.id()];
+    const auto last = prefix_sum[chrom.id() + 1];
+    std::fill(chrom_ids.begin() + static_cast<std::ptrdiff_t>(first),
+              chrom_ids.begin() + static_cast<std::ptrdiff_t>(last), chrom.id());
+  }
+  return chrom_ids;
+}
+
+[[nodiscard]] inline std::size_t normalize_num_threads(std::size_t num_threads) noexcept {
+  if (num_threads == 0) {
+    return (std::max)(1U, std::thread::hardware_concurrency());
+  }
+  return num_threads;
+}
+
+// bin_regions maps each bin to the first region overlapping it, and region_bins stores the
+// [first, last] bins of each region. Regions sharing a bin (i.e. regions whose bounds fall within
+// the same bin) are adjacent, so the regions overlapping a pixel are found by walking forward from
+// the first region overlapping its first bin
+template <typename N>
+inline void compute_expected_cis(
+    const File &clr, const Weights *weights, const std::vector<std::uint32_t> &bin_regions,
+    const std::vector<std::pair<std::uint64_t, std::uint64_t>> &region_bins,
+    const std::vector<std::size_t> &region_offsets, std::size_t num_threads,
+    std::size_t chunk_size, std::vector<double> &count_sum) {
+  // Each thread accumulates interactions into its own buffer: buffers are reduced at the end
+  std::vector<std::vector<double>> sums(num_threads, std::vector<double>(count_sum.size(), 0));
+  std::vector<std::vector<double>> balanced_counts(num_threads);
+
+  clr.parallel_for_each_block<N>(
+      num_threads,
+      [&](std::size_t thread_id, const std::vector<std::uint64_t> &bin1_ids,
+          const std::vector<std::uint64_t> &bin2_ids, const std::vector<N> &counts) {
+        auto &buff = sums[thread_id];
+        auto &balanced_buff = balanced_counts[thread_id];
+        if (weights) {
+          balanced_buff.resize(counts.size());
+          weights->balance(bin1_ids.data(), bin2_ids.data(), counts.data(), counts.size(),
+                           balanced_buff.data());
+        }
+
+        for (std::size_t i = 0; i < counts.size(); ++i) {
+          const auto bin1_id = bin1_ids[i];
+          const auto bin2_id = bin2_ids[i];
+          auto region = bin_regions[bin1_id];
+          if (region == EXPECTED_NULL_REGION || bin_regions[bin2_id] == EXPECTED_NULL_REGION) {
+            continue;
+          }
+          const auto count =
+              weights ? balanced_buff[i] : conditional_static_cast<double>(counts[i]);
+          if (!std::isfinite(count)) {
+            continue;
+          }
+          assert(bin1_id <= bin2_id);
+          const auto diag = conditional_static_cast<std::size_t>(bin2_id - bin1_id);
+          for (; region < region_bins.size() && region_bins[region].first <= bin1_id; ++region) {
+            if (region_bins[region].second >= bin2_id) {
+              buff[region_offsets[region] + diag] += count;
+            }
+          }
+        }
+      },
+      chunk_size);
+
+  for (const auto &buff : sums) {
+    for (std::size_t i = 0; i < buff.size(); ++i) {
+      count_sum[i] += buff[i];
+    }
+  }
+}
+
+template <typename N>
+inline void compute_expected_trans(const File &clr, const Weights *weights,
+                                   std::size_t num_threads, std::size_t chunk_size,
+                                   std::vector<double> &count_sum) {
+  const auto num_chroms = conditional_static_cast<std::uint64_t>(clr.chromosomes().size());
+  const auto bin_chroms = map_bins_to_chroms(clr.bins());
+
+  // Pixels are sorted by bin1_id and bin2_id, so consecutive trans pixels usually map to the same
+  // pair of chromosomes: interactions are accumulated into a running sum, which is added to the
+  // per-thread map only when the pair of chromosomes changes
+  std::vector<tsl::hopscotch_map<std::uint64_t, double>> sums(num_threads);
+  std::vector<std::vector<double>> balanced_counts(num_threads);
+
+  clr.parallel_for_each_block<N>(
+      num_threads,
+      [&](std::size_t thread_id, const std::vector<std::uint64_t> &bin1_ids,
+          const std::vector<std::uint64_t> &bin2_ids, const std::vector<N> &counts) {
+        auto &map = sums[thread_id];
+        auto &balanced_buff = balanced_counts[thread_id];
+        if (weights) {
+          balanced_buff.resize(counts.size());
+          weights->balance(bin1_ids.data(), bin2_ids.data(), counts.data(), counts.size(),
+                           balanced_buff.data());
+        }
+
+        auto key = (std::numeric_limits<std::uint64_t>::max)();
+        double sum = 0;
+        for (std::size_t i = 0; i < counts.size(); ++i) {
+          const std::uint64_t chrom1_id = bin_chroms[bin1_ids[i]];
+          const std::uint64_t chrom2_id = bin_chroms[bin2_ids[i]];
+          if (chrom1_id == chrom2_id) {
+            continue;
+          }
+          const auto count =
+              weights ? balanced_buff[i] : conditional_static_cast<double>(counts[i]);
+          if (!std::isfinite(count)) {
+            continue;
+          }
+          const auto new_key = (chrom1_id * num_chroms) + chrom2_id;
+          if (new_key != key) {
+            if (sum != 0) {
+              map[key] += sum;
+            }
+            key = new_key;
+            sum = 0;
+          }
+          sum += count;
+        }
+        if (sum != 0) {
+          map[key] += sum;
+        }
+      },
+      chunk_size);
+
+  for (const auto &map : sums) {
+    for (const auto &[key, sum] : map) {
+      count_sum[key] += sum;
+    }
+  }
+}
+
+[[nodiscard]] inline RootGroup open_root_group(const File &clr) {
+  return {clr.group("pixels").group.getFile().getGroup(clr.hdf5_path())};
+}
+
+inline void create_expected_group(RootGroup &root_grp, std::string_view kind,
+                                  std::string_view name, bool overwrite_if_exists) {
+  auto grp = root_grp();
+  for (const auto &subgroup : {std::string{"expected"}, std::string{kind}}) {
+    grp = grp.exist(subgroup) ? grp.getGroup(subgroup) : grp.createGroup(subgroup);
+  }
+
+  const std::string name_{name};
+  if (grp.exist(name_)) {
+    if (!overwrite_if_exists) {
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("unable to write expected to {}/{}: group already exists"),
+                      grp.getPath(), name));
+    }
+    grp.unlink(name_);
+  }
+  grp.createGroup(name_);
+}
+
+template <typename T>
+inline void write_expected_dataset(RootGroup &root_grp, std::string_view path,
+                                   const std::vector<T> &buff) {
+  Dataset dset(root_grp, path, T{}, HighFive::DataSpace::UNLIMITED);
+  if (!buff.empty()) {
+    dset.append(buff);
+  }
+}
+
+template <typename T>
+[[nodiscard]] inline std::vector<T> read_expected_dataset(const RootGroup &root_grp,
+                                                          std::string_view path,
+                                                          std::size_t expected_size) {
+  auto buff = Dataset(root_grp, path).read_all<std::vector<T>>();
+  if (buff.size() != expected_size) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("{} is corrupted: expected {} values, found {}"), path,
+                    expected_size, buff.size()));
+  }
+  return buff;
+}
+
+[[nodiscard]] inline GenomicInterval make_expected_region(const File &clr, std::uint32_t chrom_id,
+                                                          std::uint32_t start, std::uint32_t end) {
+  const auto &chrom = clr.chromosomes().at(chrom_id);
+  if (start > end || end > chrom.size()) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("invalid expected region {}:{}-{}"), chrom.name(), start, end));
+  }
+  return {chrom, start, end};
+}
+
+}  // namespace internal
+
+inline std::vector<ExpectedCis> expected_cis(const File &clr,
+                                             std::shared_ptr<const Weights> weights,
+                                             std::vector<GenomicInterval> regions,
+                                             std::size_t num_threads, std::size_t chunk_size) {
+  const auto &bins = clr.bins();
+  const auto valid_bins = internal::compute_valid_bins(bins, weights.get());
+
+  if (regions.empty()) {
+    for (const Chromosome &chrom : clr.chromosomes()) {
+      regions.emplace_back(chrom);
+    }
+  }
+  std::sort(regions.begin(), regions.end());
+
+  std::vector<std::uint32_t> bin_regions(bins.size(), internal::EXPECTED_NULL_REGION);
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> region_bins{};
+  std::vector<std::size_t> region_offsets{0};
+  std::vector<ExpectedCis> expected{};
+  for (const auto &region : regions) {
+    if (region.start() == region.end()) {
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("unable to compute expected for empty region {}"), region));
+    }
+    if (!expected.empty() && expected.back().region.chrom() == region.chrom() &&
+        expected.back().region.end() > region.start()) {
+      throw std::runtime_error(fmt::format(
+          FMT_STRING("unable to compute expected: region {} overlaps with region {}"), region,
+          expected.back().region));
+    }
+
+    // Regions that do not overlap can still share the bin where one ends and the next one
+    // starts: bins are mapped to the first region overlapping them
+    const auto [first_bin, last_bin] = bins.map_to_bin_ids(region);
+    const auto region_id = conditional_static_cast<std::uint32_t>(expected.size());
+    for (auto bin_id = first_bin; bin_id <= last_bin; ++bin_id) {
+      auto &bin_region = bin_regions[conditional_static_cast<std::size_t>(bin_id)];
+      if (bin_region == internal::EXPECTED_NULL_REGION) {
+        bin_region = region_id;
+      }
+    }
+    region_bins.emplace_back(first_bin, last_bin);
+    region_offsets.push_back(region_offsets.back() +
+                             conditional_static_cast<std::size_t>(last_bin + 1 - first_bin));
+    expected.push_back(
+        {region, {}, internal::count_valid_pixels_cis(valid_bins, first_bin, last_bin + 1)});
+  }
+
+  std::vector<double> count_sum(region_offsets.back(), 0);
+  num_threads = internal::normalize_num_threads(num_threads);
+  if (clr.has_float_pixels()) {
+    internal::compute_expected_cis<double>(clr, weights.get(), bin_regions, region_bins,
+                                           region_offsets, num_threads, chunk_size, count_sum);
+  } else {
+    internal::compute_expected_cis<std::int64_t>(clr, weights.get(), bin_regions,
+                                                 region_bins, region_offsets, num_threads,
+                                                 chunk_size, count_sum);
+  }
+
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    expected[i].count_sum.assign(
+        count_sum.begin() + static_cast<std::ptrdiff_t>(region_offsets[i]),
+        count_sum.begin() + static_cast<std::ptrdiff_t>(region_offsets[i + 1]));
+  }
+  return expected;
+}
+
+inline std::vector<ExpectedTrans> expected_trans(const File &clr,
+                                                 std::shared_ptr<const Weights> weights,
+                                                 std::size_t num_threads, std::size_t chunk_size) {
+  const auto &chroms = clr.chromosomes();
+  const auto num_chroms = chroms.size();
+  const auto valid_bins = internal::compute_valid_bins(clr.bins(), weights.get());
+
+  std::vector<double> count_sum(num_chroms * num_chroms, 0);
+  num_threads = internal::normalize_num_threads(num_threads);
+  if (clr.has_float_pixels()) {
+    internal::compute_expected_trans<double>(clr, weights.get(), num_threads, chunk_size,
+                                             count_sum);
+  } else {
+    internal::compute_expected_trans<std::int64_t>(clr, weights.get(), num_threads, chunk_size,
+                                                   count_sum);
+  }
+
+  const auto &prefix_sum = clr.bins().num_bin_prefix_sum();
+  std::vector<std::uint64_t> num_valid_bins(num_chroms);
+  for (const Chromosome &chrom : chroms) {
+    const auto first = static_cast<std::ptrdiff_t>(prefix_sum[chrom.id()]);
+    const auto last = static_cast<std::ptrdiff_t>(prefix_sum[chrom.id() + 1]);
+    num_valid_bins[chrom.id()] = conditional_static_cast<std::uint64_t>(
+        std::count(valid_bins.begin() + first, valid_bins.begin() + last, true));
+  }
+
+  std::vector<ExpectedTrans> expected{};
+  for (const Chromosome &chrom1 : chroms) {
+    for (const Chromosome &chrom2 : chroms) {
+      if (chrom1.id() >= chrom2.id()) {
+        continue;
+      }
+      expected.push_back({GenomicInterval{chrom1}, GenomicInterval{chrom2},
+                          count_sum[(chrom1.id() * num_chroms) + chrom2.id()],
+                          num_valid_bins[chrom1.id()] * num_valid_bins[chrom2.id()]});
+    }
+  }
+  return expected;
+}
+
+inline void write_expected(std::string_view uri, std::string_view name,
+                           const std::vector<ExpectedCis> &expected, bool overwrite_if_exists) {
+  assert(!name.empty());
+  const auto [file_path, group_path] = parse_cooler_uri(uri);
+  HighFive::File f(file_path, HighFive::File::ReadWrite);
+  RootGroup root_grp{f.getGroup(group_path)};
+  internal::create_expected_group(root_grp, "cis", name, overwrite_if_exists);
+
+  // Diagonals of all regions are stored back to back: the diagonals of the i-th region are found
+  // in the [region_offset[i], region_offset[i + 1]) range
+  std::vector<std::uint32_t> chrom_ids{};
+  std::vector<std::uint32_t> starts{};
+  std::vector<std::uint32_t> ends{};
+  std::vector<std::uint64_t> offsets{0};
+  std::vector<double> count_sum{};
+  std::vector<std::uint64_t> num_valid{};
+  for (const auto &e : expected) {
+    assert(e.count_sum.size() == e.num_valid.size());
+    chrom_ids.push_back(e.region.chrom().id());
+    starts.push_back(e.region.start());
+    ends.push_back(e.region.end());
+    offsets.push_back(offsets.back() + e.count_sum.size());
+    count_sum.insert(count_sum.end(), e.count_sum.begin(), e.count_sum.end());
+    num_valid.insert(num_valid.end(), e.num_valid.begin(), e.num_valid.end());
+  }
+
+  const auto prefix = fmt::format(FMT_STRING("expected/cis/{}"), name);
+  internal::write_expected_dataset(root_grp, fmt::format(FMT_STRING("{}/chrom"), prefix),
+                                   chrom_ids);
+  internal::write_expected_dataset(root_grp, fmt::format(FMT_STRING("{}/start"), prefix), starts);
+  internal::write_expected_dataset(root_grp, fmt::format(FMT_STRING("{}/end"), prefix), ends);
+  internal::write_expected_dataset(root_grp, fmt::format(FMT_STRING("{}/region_offset"), prefix),
+                                   offsets);
+  internal::write_expected_dataset(root_grp, fmt::format(FMT_STRING("{}/count_sum"), prefix),
+                                   count_sum);
+  internal::write_expected_dataset(root_grp, fmt::format(FMT_STRING("{}/n_valid"), prefix),
+                                   num_valid);
+  f.flush();
+}
+
+inline void write_expected(std::string_view uri, std::string_view name,
+                           const std::vector<ExpectedTrans> &expected, bool overwrite_if_exists) {
+  assert(!name.empty());
+  const auto [file_path, group_path] = parse_cooler_uri(uri);
+  HighFive::File f(file_path, HighFive::File::ReadWrite);
+  RootGroup root_grp{f.getGroup(group_path)};
+  internal::create_expected_group(root_grp, "trans", name, overwrite_if_exists);
+
+  std::vector<std::uint32_t> chrom1_ids{};
+  std::vector<std::uint32_t> starts1{};
+  std::vector<std::uint32_t> ends1{};
+  std::vector<std::uint32_t> chrom2_ids{};
+  std::vector<std::uint32_t> starts2{};
+  std::vector<std::uint32_t> ends2{};
+  std::vector<double> count_sum{};
+  std::vector<std::uint64_t> num_valid{};
+  for (const auto &e : expected) {
+    chrom1_ids.push_back(e.region1.chrom().id());
+    starts1.push_back(e.region1.start());
+    ends1.push_back(e.region1.end());
+    chrom2_ids.push_back(e.region2.chrom().id());
+    starts2.push_back(e.region2.start());
+    ends2.push_back(e.region2.end());
+    count_sum.push_back(e.count_sum);
+    num_valid.push_back(e.num_valid);
+  }
+
+  const auto prefix = fmt::format(FMT_STRING("expected/trans/{}"), name);
+  internal::write_expected_dataset(root_grp, fmt::format(FMT_STRING("{}/chrom1"), prefix),
+                                   chrom1_ids);
+  internal::write_expected_dataset(root_grp, fmt::format(FMT_STRING("{}/start1"), prefix),
+                                   starts1);
+  internal::write_expected_dataset(root_grp, fmt::format(FMT_STRING("{}/end1"), prefix), ends1);
+  internal::write_expected_dataset(root_grp, fmt::format(FMT_STRING("{}/chrom2"), prefix),
+                                   chrom2_ids);
+  internal::write_expected_dataset(root_grp, fmt::format(FMT_STRING("{}/start2"), prefix),
+                                   starts2);
+  internal::write_expected_dataset(root_grp, fmt::format(FMT_STRING("{}/end2"), prefix), ends2);
+  internal::write_expected_dataset(root_grp, fmt::format(FMT_STRING("{}/count_sum"), prefix),
+                                   count_sum);
+  internal::write_expected_dataset(root_grp, fmt::format(FMT_STRING("{}/n_valid"), prefix),
+                                   num_valid);
+  f.flush();
+}
+
+inline bool has_expected_cis(const File &clr, std::string_view name) {
+  return internal::open_root_group(clr)().exist(
+      fmt::format(FMT_STRING("expected/cis/{}/n_valid"), name));
+}
+
+inline bool has_expected_trans(const File &clr, std::string_view name) {
+  return internal::open_root_group(clr)().exist(
+      fmt::format(FMT_STRING("expected/trans/{}/n_valid"), name));
+}
+
+inline std::vector<ExpectedCis> read_expected_cis(const File &clr, std::string_view name) {
+  const auto root_grp = internal::open_root_group(clr);
+  const auto prefix = fmt::format(FMT_STRING("expected/cis/{}"), name);
+  if (!root_grp().exist(prefix)) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("unable to find expected {} in {}"), prefix, clr.uri()));
+  }
+
+  const auto chrom_ids = Dataset(root_grp, fmt::format(FMT_STRING("{}/chrom"), prefix))
+                             .read_all<std::vector<std::uint32_t>>();
+  const auto num_regions = chrom_ids.size();
+  const auto starts = internal::read_expected_dataset<std::uint32_t>(
+      root_grp, fmt::format(FMT_STRING("{}/start"), prefix), num_regions);
+  const auto ends = internal::read_expected_dataset<std::uint32_t>(
+      root_grp, fmt::format(FMT_STRING("{}/end"), prefix), num_regions);
+  const auto offsets = internal::read_expected_dataset<std::uint64_t>(
+      root_grp, fmt::format(FMT_STRING("{}/region_offset"), prefix), num_regions + 1);
+  const auto count_sum = internal::read_expected_dataset<double>(
+      root_grp, fmt::format(FMT_STRING("{}/count_sum"), prefix), offsets.back());
+  const auto num_valid = internal::read_expected_dataset<std::uint64_t>(
+      root_grp, fmt::format(FMT_STRING("{}/n_valid"), prefix), offsets.back());
+
+  std::vector<ExpectedCis> expected(num_regions);
+  for (std::size_t i = 0; i < num_regions; ++i) {
+    if (offsets[i] > offsets[i + 1]) {
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("{}/region_offset is corrupted: offsets are not sorted"), prefix));
+    }
+    const auto first = static_cast<std::ptrdiff_t>(offsets[i]);
+    const auto last = static_cast<std::ptrdiff_t>(offsets[i + 1]);
+    expected[i].region = internal::make_expected_region(clr, chrom_ids[i], starts[i], ends[i]);
+    expected[i].count_sum.assign(count_sum.begin() + first, count_sum.begin() + last);
+    expected[i].num_valid.assign(num_valid.begin() + first, num_valid.begin() + last);
+  }
+  return expected;
+}
+
+inline std::vector<ExpectedTrans> read_expected_trans(const File &clr, std::string_view name) {
+  const auto root_grp = internal::open_root_group(clr);
+  const auto prefix = fmt::format(FMT_STRING("expected/trans/{}"), name);
+  if (!root_grp().exist(prefix)) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("unable to find expected {} in {}"), prefix, clr.uri()));
+  }
+
+  const auto chrom1_ids = Dataset(root_grp, fmt::format(FMT_STRING("{}/chrom1"), prefix))
+                              .read_all<std::vector<std::uint32_t>>();
+  const auto num_pairs = chrom1_ids.size();
+  auto read_u32 = [&](std::string_view dset_name) {
+    return internal::read_expected_dataset<std::uint32_t>(
+        root_grp, fmt::format(FMT_STRING("{}/{}"), prefix, dset_name), num_pairs);
+  };
+  const auto starts1 = read_u32("start1");
+  const auto ends1 = read_u32("end1");
+  const auto chrom2_ids = read_u32("chrom2");
+  const auto starts2 = read_u32("start2");
+  const auto ends2 = read_u32("end2");
+  const auto count_sum = internal::read_expected_dataset<double>(
+      root_grp, fmt::format(FMT_STRING("{}/count_sum"), prefix), num_pairs);
+  const auto num_valid = internal::read_expected_dataset<std::uint64_t>(
+      root_grp, fmt::format(FMT_STRING("{}/n_valid"), prefix), num_pairs);
+
+  std::vector<ExpectedTrans> expected(num_pairs);
+  for (std::size_t i = 0; i < num_pairs; ++i) {
+    expected[i].region1 = internal::make_expected_region(clr, chrom1_ids[i], starts1[i], ends1[i]);
+    expected[i].region2 = internal::make_expected_region(clr, chrom2_ids[i], starts2[i], ends2[i]);
+    expected[i].count_sum = count_sum[i];
+    expected[i].num_valid = num_valid[i];
+  }
+  return expected;
+}
+
+}  // namespace coolerpp::utils
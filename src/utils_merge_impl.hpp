@@ -4,9 +4,25 @@
 
 #pragma once
 
+#include <fmt/format.h>
+
 #include <algorithm>
-#include <queue>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
 #include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "coolerpp/coolerpp.hpp"
@@ -15,99 +31,157 @@ namespace coolerpp::utils {
 
 namespace internal {
 template <typename N>
-inline bool PixelMerger<N>::Node::operator<(const Node& other) const noexcept {
-  assert(!!this->pixel);
-  assert(!!other.pixel);
-  return this->pixel.coords < other.pixel.coords;
+inline bool PixelMerger<N>::Source::exhausted() const noexcept {
+  return this->i == this->bin1_buff.size();
+}
+
+template <typename N>
+inline std::uint64_t PixelMerger<N>::Source::key() const noexcept {
+  if (this->exhausted()) {
+    return coolerpp::internal::LoserTree::EXHAUSTED;
+  }
+  return coolerpp::internal::LoserTree::pack_key(this->bin1_buff[this->i],
+                                                 this->bin2_buff[this->i]);
 }
 
 template <typename N>
-inline bool PixelMerger<N>::Node::operator>(const Node& other) const noexcept {
-  assert(!!this->pixel);
-  assert(!!other.pixel);
-  return this->pixel.coords > other.pixel.coords;
+inline N PixelMerger<N>::Source::count() const noexcept {
+  assert(!this->exhausted());
+  return this->count_buff[this->i];
 }
 
 template <typename N>
-inline bool PixelMerger<N>::Node::operator==(const Node& other) const noexcept {
-  return this->pixel.coords == other.pixel.coords;
+inline void PixelMerger<N>::Source::advance(std::size_t chunk_size) {
+  assert(!this->exhausted());
+  if (++this->i == this->bin1_buff.size()) {
+    this->read_chunk(chunk_size);
+  }
 }
 
 template <typename N>
-inline bool PixelMerger<N>::Node::operator!=(const Node& other) const noexcept {
-  return !(*this == other);
+inline void PixelMerger<N>::Source::read_chunk(std::size_t chunk_size) {
+  assert(this->next_offset <= this->last_offset);
+  const auto num = (std::min)(chunk_size, this->last_offset - this->next_offset);
+  this->i = 0;
+  if (num == 0) {
+    this->bin1_buff.clear();
+    return;
+  }
+
+  this->reader.read(this->bin1_buff, this->bin2_buff, this->count_buff, num, this->next_offset);
+  this->next_offset += num;
 }
 
 template <typename N>
-inline PixelMerger<N>::PixelMerger(const std::vector<File>& input_coolers)
-    : PixelMerger<N>(input_coolers.begin(), input_coolers.end()) {}
+inline PixelMerger<N>::PixelMerger(const std::vector<File>& input_coolers, std::size_t chunk_size)
+    : PixelMerger<N>(input_coolers.begin(), input_coolers.end(), chunk_size) {}
 
 template <typename N>
 template <typename FileIt>
-inline PixelMerger<N>::PixelMerger(FileIt first_file, FileIt last_file) {
+inline PixelMerger<N>::PixelMerger(FileIt first_file, FileIt last_file, std::size_t chunk_size)
+    : _chunk_size((std::max)(std::size_t(1), chunk_size)) {
   std::for_each(first_file, last_file, [&](const auto& clr) {
-    auto first = clr.template begin<N>();
-    auto last = clr.template end<N>();
-    if (first != last) {
-      auto pixel = *first++;
-      _heads.emplace_back(std::move(first));
-      _tails.emplace_back(std::move(last));
-      _pqueue.emplace(Node{std::move(pixel), _pqueue.size()});
-    }
+    const auto& bin1_dset = clr.dataset("pixels/bin1_id");
+    Source src{coolerpp::internal::PixelColumnReader<N>{bin1_dset, clr.dataset("pixels/bin2_id"),
+                                                        clr.dataset("pixels/count")}};
+    src.last_offset = bin1_dset.size();
+    this->add_source(clr, std::move(src));
   });
+  this->init_tree();
 }
 
 template <typename N>
-inline void PixelMerger<N>::merge(File& clr, std::size_t queue_capacity, bool quiet) {
-  this->_buffer.clear();
-  this->_buffer.reserve((std::max)(queue_capacity, this->_buffer.capacity()));
+inline PixelMerger<N>::PixelMerger(const std::vector<File>& input_coolers,
+                                   const std::vector<OffsetRange>& offsets, std::mutex& io_mtx,
+                                   std::size_t chunk_size)
+    : _chunk_size((std::max)(std::size_t(1), chunk_size)) {
+  assert(input_coolers.size() == offsets.size());
+  for (std::size_t i = 0; i < input_coolers.size(); ++i) {
+    const auto& clr = input_coolers[i];
+    Source src{coolerpp::internal::PixelColumnReader<N>{
+        clr.dataset("pixels/bin1_id"), clr.dataset("pixels/bin2_id"),
+        clr.dataset("pixels/count"), &io_mtx}};
+    src.next_offset = conditional_static_cast<std::size_t>(offsets[i].first);
+    src.last_offset = conditional_static_cast<std::size_t>(offsets[i].second);
+    this->add_source(clr, std::move(src));
+  }
+  this->init_tree();
+}
 
+template <typename N>
+inline void PixelMerger<N>::merge(File& clr, std::size_t buffer_capacity, bool quiet) {
   std::size_t pixels_processed{};
-  while (true) {
-    auto pixel = this->next();
-    if (!pixel) {
-      break;
-    }
-    this->_buffer.emplace_back(std::move(pixel));
-    if (this->_buffer.size() == queue_capacity) {
-      clr.append_pixels(this->_buffer.begin(), this->_buffer.end());
-      pixels_processed += this->_buffer.size();
-      if (!quiet && pixels_processed % (std::max)(queue_capacity, std::size_t(1'000'000)) == 0) {
-        fmt::print(stderr, FMT_STRING("Procesed {}M pixels...\n"), pixels_processed / 1'000'000);
-      }
-      this->_buffer.clear();
+  this->merge_columns(
+      [&](const auto& bin1_ids, const auto& bin2_ids, const auto& counts) {
+        clr.append_pixels_columns(bin1_ids.data(), bin2_ids.data(), counts.data(),
+                                  bin1_ids.size());
+        pixels_processed += bin1_ids.size();
+        if (!quiet && pixels_processed % (std::max)(buffer_capacity, std::size_t(1'000'000)) == 0) {
+          fmt::print(stderr, FMT_STRING("Procesed {}M pixels...\n"), pixels_processed / 1'000'000);
+        }
+      },
+      buffer_capacity);
+}
+
+template <typename N>
+template <typename Sink>
+inline void PixelMerger<N>::merge_columns(Sink&& sink, std::size_t buffer_capacity) {
+  buffer_capacity = (std::max)(std::size_t(1), buffer_capacity);
+  this->_bin1_buff.reserve(buffer_capacity);
+  this->_bin2_buff.reserve(buffer_capacity);
+  this->_count_buff.reserve(buffer_capacity);
+
+  auto flush = [&]() {
+    if (!this->_bin1_buff.empty()) {
+      sink(this->_bin1_buff, this->_bin2_buff, this->_count_buff);
     }
-  }
+    this->_bin1_buff.clear();
+    this->_bin2_buff.clear();
+    this->_count_buff.clear();
+  };
 
-  if (!this->_buffer.empty()) {
-    clr.append_pixels(this->_buffer.begin(), this->_buffer.end());
+  while (!this->_tree.done()) {
+    const auto key = this->_tree.top_key();
+    N count{};
+    // Pixels with the same coordinates are guaranteed to come from different sources
+    do {
+      auto& src = this->_sources[this->_tree.top()];
+      count += src.count();
+      src.advance(this->_chunk_size);
+      this->_tree.replace_top(src.key());
+    } while (this->_tree.top_key() == key);
+
+    this->_bin1_buff.push_back(coolerpp::internal::LoserTree::bin1_id(key));
+    this->_bin2_buff.push_back(coolerpp::internal::LoserTree::bin2_id(key));
+    this->_count_buff.push_back(count);
+    if (this->_bin1_buff.size() == buffer_capacity) {
+      flush();
+    }
   }
+
+  flush();
 }
 
 template <typename N>
-inline void PixelMerger<N>::replace_top_node(std::size_t i) {
-  assert(this->_pqueue.top().i == i);
-  this->_pqueue.pop();
-  if (auto& it = this->_heads[i]; it != this->_tails[i]) {
-    this->_pqueue.emplace(Node{*it++, i});
-  }
+inline void PixelMerger<N>::init_tree() {
+  std::vector<std::uint64_t> keys(this->_sources.size());
+  std::transform(this->_sources.begin(), this->_sources.end(), keys.begin(),
+                 [](const Source& src) { return src.key(); });
+  this->_tree = coolerpp::internal::LoserTree{std::move(keys)};
 }
 
 template <typename N>
-inline Pixel<N> PixelMerger<N>::next() {
-  if (this->_pqueue.empty()) {
-    return {};
+inline void PixelMerger<N>::add_source(const File& clr, Source src) {
+  // Keys store bin1_id and bin2_id in the upper and lower 32 bits respectively
+  if (conditional_static_cast<std::uint64_t>(clr.bins().size()) >= (std::uint64_t(1) << 32U)) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("unable to merge pixels from cooler \"{}\": too many bins ({})"), clr.uri(),
+        clr.bins().size()));
   }
-
-  auto current_node = this->_pqueue.top();
-  this->replace_top_node(current_node.i);
-
-  for (auto next_node = this->_pqueue.top(); !this->_pqueue.empty() && next_node == current_node;
-       next_node = this->_pqueue.top()) {
-    current_node.pixel.count += next_node.pixel.count;
-    this->replace_top_node(next_node.i);
+  src.read_chunk(this->_chunk_size);
+  if (!src.exhausted()) {
+    this->_sources.emplace_back(std::move(src));
   }
-  return current_node.pixel;
 }
 
 [[nodiscard]] inline std::uint32_t get_bin_size_checked(const std::vector<File>& coolers) {
@@ -150,11 +224,366 @@ inline Pixel<N> PixelMerger<N>::next() {
   return false;
 }
 
+template <typename N>
+inline void merge_parallel(const std::vector<File>& coolers, File& dest, std::size_t chunk_size,
+                           std::size_t num_threads, bool quiet) {
+  assert(num_threads != 0);
+
+  const auto partitions = coolerpp::internal::partition_pixel_tables(
+      coolers, num_threads * coolerpp::internal::PARTITIONS_PER_THREAD);
+  const auto max_buffered_pixels = 2 * num_threads * chunk_size;
+  process_partitions_parallel<N>(
+      dest, partitions.size(), num_threads, max_buffered_pixels, "merge", quiet,
+      [&](std::size_t i, std::mutex& io_mtx, auto&& sink) {
+        PixelMerger<N> merger(coolers, partitions[i], io_mtx);
+        merger.merge_columns(sink, chunk_size);
+      });
+}
+
+template <typename N, typename PartitionOp>
+inline void process_partitions_parallel(File& dest, std::size_t num_partitions,
+                                        std::size_t num_threads, std::size_t max_buffered_pixels,
+                                        std::string_view task, bool quiet,
+                                        PartitionOp process_partition) {
+  assert(num_threads != 0);
+  num_threads = (std::min)(num_threads, num_partitions);
+
+  struct Block {
+    std::vector<std::uint64_t> bin1_ids{};
+    std::vector<std::uint64_t> bin2_ids{};
+    std::vector<N> counts{};
+  };
+  struct Partition {
+    std::deque<Block> blocks{};
+    bool done{false};
+  };
+
+  // HDF5 is not guaranteed to be thread-safe: calls into libhdf5 made while reading from the input
+  // coolers and writes to dest are serialized using io_mtx, while partitions (including the
+  // decompression of the chunks they read) are processed concurrently
+  std::mutex io_mtx;
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::vector<Partition> queues(num_partitions);
+  // Guarded by mtx
+  std::size_t current_partition = 0;
+  std::size_t buffered_pixels = 0;
+  std::atomic<std::size_t> next_partition{0};
+  std::atomic<bool> early_return{false};
+  std::exception_ptr except{};
+
+  auto set_exception = [&]() {
+    {
+      [[maybe_unused]] const std::scoped_lock lck(mtx);
+      early_return = true;
+      if (!except) {
+        except = std::current_exception();
+      }
+    }
+    cv.notify_all();
+  };
+
+  auto worker = [&]() {
+    try {
+      while (!early_return) {
+        const auto i = next_partition++;
+        if (i >= num_partitions) {
+          break;
+        }
+        process_partition(i, io_mtx,
+                          [&](const std::vector<std::uint64_t>& bin1_ids,
+                              const std::vector<std::uint64_t>& bin2_ids,
+                              const std::vector<N>& counts) {
+                            Block blk{bin1_ids, bin2_ids, counts};
+                            std::unique_lock lck(mtx);
+                            // The partition being written is never throttled, so that the thread
+                            // writing to dest can always make progress
+                            cv.wait(lck, [&]() {
+                              return early_return || i == current_partition ||
+                                     buffered_pixels < max_buffered_pixels;
+                            });
+                            if (early_return) {
+                              throw std::runtime_error("partition processing was interrupted");
+                            }
+                            buffered_pixels += blk.bin1_ids.size();
+                            queues[i].blocks.emplace_back(std::move(blk));
+                            lck.unlock();
+                            cv.notify_all();
+                          });
+        {
+          [[maybe_unused]] const std::scoped_lock lck(mtx);
+          queues[i].done = true;
+        }
+        cv.notify_all();
+      }
+    } catch (...) {
+      set_exception();
+    }
+  };
+
+  std::vector<std::thread> threads{};
+  threads.reserve(num_threads);
+  for (std::size_t i = 0; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+
+  // Blocks are appended in partition order as soon as they become available
+  try {
+    for (std::size_t i = 0; i < num_partitions; ++i) {
+      {
+        [[maybe_unused]] const std::scoped_lock lck(mtx);
+        current_partition = i;
+      }
+      cv.notify_all();
+
+      while (true) {
+        Block blk{};
+        {
+          std::unique_lock lck(mtx);
+          auto& queue = queues[i];
+          cv.wait(lck, [&]() { return early_return || !queue.blocks.empty() || queue.done; });
+          if (early_return || queue.blocks.empty()) {
+            break;
+          }
+          blk = std::move(queue.blocks.front());
+          queue.blocks.pop_front();
+          buffered_pixels -= blk.bin1_ids.size();
+        }
+        cv.notify_all();
+
+        [[maybe_unused]] const std::scoped_lock lck(io_mtx);
+        dest.append_pixels_columns(blk.bin1_ids.data(), blk.bin2_ids.data(), blk.counts.data(),
+                                   blk.bin1_ids.size());
+      }
+      if (early_return) {
+        break;
+      }
+      if (!quiet) {
+        fmt::print(stderr, FMT_STRING("Processed {}/{} partitions ({})...\n"), i + 1,
+                   num_partitions, task);
+      }
+    }
+  } catch (...) {
+    set_exception();
+  }
+
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  if (except) {
+    std::rethrow_exception(except);
+  }
+}
+
+template <typename N>
+inline std::size_t estimate_in_memory_merge_footprint(const std::vector<File>& coolers) {
+  if (coolers.empty()) {
+    return 0;
+  }
+
+  // Pixels are sorted using keys computed as bin1_id * num_bins + bin2_id
+  const auto num_bins = conditional_static_cast<std::uint64_t>(coolers.front().bins().size());
+  if (num_bins > (std::uint64_t(1) << 32U)) {
+    return (std::numeric_limits<std::size_t>::max)();
+  }
+
+  std::size_t nnz = 0;
+  for (const auto& clr : coolers) {
+    nnz += clr.dataset("pixels/bin1_id").size();
+  }
+
+  // Keys and values are stored twice while sorting
+  return 2 * nnz * (sizeof(std::uint64_t) + sizeof(N));
+}
+
+template <typename N>
+inline void radix_sort(std::vector<std::uint64_t>& keys, std::vector<N>& values) {
+  assert(keys.size() == values.size());
+  if (keys.size() < 2) {
+    return;
+  }
+
+  const auto max_key = *std::max_element(keys.begin(), keys.end());
+  radix_sort([&](std::size_t i) { return keys[i]; }, max_key, 1, keys, values);
+}
+
+template <typename N>
+inline void merge_in_memory(const std::vector<File>& coolers, File& dest, std::size_t chunk_size) {
+  chunk_size = (std::max)(std::size_t(1), chunk_size);
+  const auto num_bins = conditional_static_cast<std::uint64_t>(dest.bins().size());
+  if (num_bins > (std::uint64_t(1) << 32U)) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("unable to merge coolers in memory: too many bins ({})"), num_bins));
+  }
+
+  std::size_t nnz = 0;
+  for (const auto& clr : coolers) {
+    nnz += clr.dataset("pixels/bin1_id").size();
+  }
+
+  std::vector<std::uint64_t> keys{};
+  std::vector<N> values{};
+  keys.reserve(nnz);
+  values.reserve(nnz);
+
+  std::vector<std::uint64_t> bin1_buff{};
+  std::vector<std::uint64_t> bin2_buff{};
+  std::vector<N> count_buff{};
+  for (const auto& clr : coolers) {
+    const auto& bin1_dset = clr.dataset("pixels/bin1_id");
+    const auto& bin2_dset = clr.dataset("pixels/bin2_id");
+    const auto& count_dset = clr.dataset("pixels/count");
+    for (std::size_t offset = 0; offset < bin1_dset.size(); offset += chunk_size) {
+      const auto num = (std::min)(chunk_size, bin1_dset.size() - offset);
+      bin1_dset.read(bin1_buff, num, offset);
+      bin2_dset.read(bin2_buff, num, offset);
+      count_dset.read(count_buff, num, offset);
+      for (std::size_t i = 0; i < num; ++i) {
+        keys.push_back((bin1_buff[i] * num_bins) + bin2_buff[i]);
+      }
+      values.insert(values.end(), count_buff.begin(), count_buff.end());
+    }
+  }
+
+  radix_sort(keys, values);
+
+  bin1_buff.clear();
+  bin2_buff.clear();
+  count_buff.clear();
+  auto write_pixels = [&]() {
+    dest.append_pixels_columns(bin1_buff.data(), bin2_buff.data(), count_buff.data(),
+                               bin1_buff.size());
+    bin1_buff.clear();
+    bin2_buff.clear();
+    count_buff.clear();
+  };
+
+  for (std::size_t i = 0; i < keys.size();) {
+    const auto key = keys[i];
+    auto count = values[i];
+    for (++i; i < keys.size() && keys[i] == key; ++i) {
+      count += values[i];
+    }
+
+    bin1_buff.push_back(key / num_bins);
+    bin2_buff.push_back(key % num_bins);
+    count_buff.push_back(count);
+    if (bin1_buff.size() == chunk_size) {
+      write_pixels();
+    }
+  }
+  write_pixels();
+}
+
+inline std::optional<std::vector<std::size_t>> find_disjoint_row_order(
+    const std::vector<File>& coolers) {
+  // Pixels are sorted by bin1_id, so the range of rows of a cooler can be computed by reading
+  // the first and last bin1_id
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> row_ranges(coolers.size());
+  std::vector<std::size_t> order(coolers.size());
+  std::iota(order.begin(), order.end(), std::size_t(0));
+
+  std::size_t num_nonempty = 0;
+  for (std::size_t i = 0; i < coolers.size(); ++i) {
+    const auto& bin1_dset = coolers[i].dataset("pixels/bin1_id");
+    if (bin1_dset.empty()) {
+      continue;
+    }
+    row_ranges[i] = std::make_pair(bin1_dset.read<std::uint64_t>(0),
+                                   bin1_dset.read_last<std::uint64_t>());
+    std::swap(order[num_nonempty++], order[i]);
+  }
+
+  const auto last_nonempty = order.begin() + static_cast<std::ptrdiff_t>(num_nonempty);
+  std::sort(order.begin(), last_nonempty, [&](const std::size_t i1, const std::size_t i2) {
+    return row_ranges[i1] < row_ranges[i2];
+  });
+
+  for (std::size_t i = 1; i < num_nonempty; ++i) {
+    if (row_ranges[order[i - 1]].second >= row_ranges[order[i]].first) {
+      return std::nullopt;
+    }
+  }
+  return order;
+}
+
+template <typename N>
+inline void copy_pixels(const File& src, File& dest, std::size_t chunk_size) {
+  chunk_size = (std::max)(std::size_t(1), chunk_size);
+
+  std::vector<std::uint64_t> bin1_buff{};
+  std::vector<std::uint64_t> bin2_buff{};
+  std::vector<N> count_buff{};
+  const auto& bin1_dset = src.dataset("pixels/bin1_id");
+  const auto& bin2_dset = src.dataset("pixels/bin2_id");
+  const auto& count_dset = src.dataset("pixels/count");
+  for (std::size_t offset = 0; offset < bin1_dset.size(); offset += chunk_size) {
+    const auto num = (std::min)(chunk_size, bin1_dset.size() - offset);
+    bin1_dset.read(bin1_buff, num, offset);
+    bin2_dset.read(bin2_buff, num, offset);
+    count_dset.read(count_buff, num, offset);
+    dest.append_pixels_columns(bin1_buff.data(), bin2_buff.data(), count_buff.data(), num);
+  }
+}
+
+template <typename N>
+inline void merge_concatenate(std::vector<File>& coolers, const std::vector<std::size_t>& order,
+                              File& dest, std::size_t chunk_size, std::size_t num_threads,
+                              bool quiet) {
+  assert(order.size() == coolers.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    auto& clr = coolers[order[i]];
+    clr.set_decompression_threads(num_threads);
+    dest.append_pixels_from<N>(clr, chunk_size);
+    if (!quiet) {
+      fmt::print(stderr, FMT_STRING("Concatenated {}/{} coolers ({})...\n"), i + 1,
+                 order.size(), clr.uri());
+    }
+  }
+}
+
+template <typename N>
+inline void merge_coolers(std::vector<File>& coolers, File& dest, std::size_t chunk_size,
+                          bool quiet, std::size_t num_threads, MergeStrategy strategy,
+                          std::size_t memory_budget_bytes) {
+  if (strategy == MergeStrategy::AUTO || strategy == MergeStrategy::CONCATENATE) {
+    if (const auto order = find_disjoint_row_order(coolers); order.has_value()) {
+      merge_concatenate<N>(coolers, *order, dest, chunk_size, num_threads, quiet);
+      return;
+    }
+    if (strategy == MergeStrategy::CONCATENATE) {
+      throw std::runtime_error(
+          "unable to concatenate coolers: coolers store pixels for overlapping ranges of rows");
+    }
+  }
+
+  if (strategy == MergeStrategy::AUTO) {
+    strategy = estimate_in_memory_merge_footprint<N>(coolers) <= memory_budget_bytes
+                   ? MergeStrategy::IN_MEMORY
+                   : MergeStrategy::PQUEUE;
+  }
+
+  if (strategy == MergeStrategy::IN_MEMORY) {
+    merge_in_memory<N>(coolers, dest, chunk_size);
+    return;
+  }
+
+  assert(strategy == MergeStrategy::PQUEUE);
+  if (num_threads > 1) {
+    merge_parallel<N>(coolers, dest, chunk_size, num_threads, quiet);
+    return;
+  }
+  PixelMerger<N>(coolers).merge(dest, chunk_size, quiet);
+}
+
 }  // namespace internal
 
 template <typename Str>
 inline void merge(Str first_file, Str last_file, std::string_view dest_uri,
-                  bool overwrite_if_exists, std::size_t chunk_size, bool quiet) {
+                  bool overwrite_if_exists, std::size_t chunk_size, bool quiet,
+                  std::size_t num_threads, MergeStrategy strategy,
+                  std::size_t memory_budget_bytes) {
   static_assert(std::is_constructible_v<std::string, decltype(*first_file)>);
   assert(chunk_size != 0);
 
@@ -170,15 +599,30 @@ inline void merge(Str first_file, Str last_file, std::string_view dest_uri,
   const auto bin_size = internal::get_bin_size_checked(clrs);
   const auto float_pixels = internal::merging_requires_float_pixels(clrs);
 
-  auto dest =
-      float_pixels
-          ? File::create_new_cooler<double>(dest_uri, chroms, bin_size, overwrite_if_exists)
-          : File::create_new_cooler<std::int32_t>(dest_uri, chroms, bin_size, overwrite_if_exists);
+  if (num_threads == 0) {
+    num_threads = (std::max)(1U, std::thread::hardware_concurrency());
+  }
+  WriterOptions writer_options{};
+  writer_options.threads = num_threads;
+  writer_options.compute_chromosome_pair_stats =
+      std::all_of(clrs.begin(), clrs.end(),
+                  [](const auto& clr) { return clr.has_chromosome_pair_stats(); });
+  auto dest = float_pixels ? File::create_new_cooler<double>(
+                                 dest_uri, chroms, bin_size, overwrite_if_exists,
+                                 StandardAttributes::init<double>(bin_size),
+                                 DEFAULT_HDF5_CACHE_SIZE * 4, writer_options)
+                           : File::create_new_cooler<std::int32_t>(
+                                 dest_uri, chroms, bin_size, overwrite_if_exists,
+                                 StandardAttributes::init<std::int32_t>(bin_size),
+                                 DEFAULT_HDF5_CACHE_SIZE * 4, writer_options);
+
   try {
     if (float_pixels) {
-      internal::PixelMerger<double>(clrs).merge(dest, chunk_size, quiet);
+      internal::merge_coolers<double>(clrs, dest, chunk_size, quiet, num_threads, strategy,
+                                      memory_budget_bytes);
     } else {
-      internal::PixelMerger<std::int32_t>(clrs).merge(dest, chunk_size, quiet);
+      internal::merge_coolers<std::int32_t>(clrs, dest, chunk_size, quiet, num_threads, strategy,
+                                            memory_budget_bytes);
     }
   } catch (const std::exception& e) {
     throw std::runtime_error(
@@ -0,0 +1,372 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/balancing.hpp"
+#include "coolerpp/bin_table.hpp"
+#include "coolerpp/coolerpp.hpp"
+#include "coolerpp/genomic_interval.hpp"
+
+namespace coolerpp::utils {
+
+inline std::vector<double> Pileup::average() const {
+  assert(this->sum.size() == this->num_valid.size());
+  std::vector<double> avg(this->sum.size(), std::numeric_limits<double>::quiet_NaN());
+  for (std::size_t i = 0; i < avg.size(); ++i) {
+    if (this->num_valid[i] != 0) {
+      avg[i] = this->sum[i] / conditional_static_cast<double>(this->num_valid[i]);
+    }
+  }
+  return avg;
+}
+
+namespace internal {
+
+// Part of a pileup window stored in the upper triangle: pixels with bin1_id in
+// [row_start, row_start + size) and bin2_id in [col_start, col_start + size).
+// Transposed queries cover the part of a window lying below the diagonal: rows of the query are
+// columns of the window, and pixels are mirrored before being added to the window
+struct PileupQuery {
+  std::uint64_t row_start{};
+  std::uint64_t col_start{};
+  bool transposed{};
+};
+
+// Average expected interactions of the region each bin belongs to
+struct PileupExpected {
+  std::vector<std::uint32_t> bin_regions{};
+  std::vector<std::vector<double>> averages{};
+};
+
+[[nodiscard]] inline PileupExpected init_pileup_expected(const BinTable &bins,
+                                                         const std::vector<ExpectedCis> &expected) {
+  PileupExpected e{std::vector<std::uint32_t>(bins.size(), EXPECTED_NULL_REGION), {}};
+  for (const auto &region : expected) {
+    const auto [first_bin, last_bin] = bins.map_to_bin_ids(region.region);
+    const auto num_diagonals = conditional_static_cast<std::size_t>(last_bin + 1 - first_bin);
+    if (region.count_sum.size() != num_diagonals) {
+      throw std::runtime_error(
+          fmt::format(FMT_STRING("invalid expected for region {}: expected {} diagonals, found {}"),
+                      region.region, num_diagonals, region.count_sum.size()));
+    }
+
+    const auto region_id = conditional_static_cast<std::uint32_t>(e.averages.size());
+    std::fill(e.bin_regions.begin() + static_cast<std::ptrdiff_t>(first_bin),
+              e.bin_regions.begin() + static_cast<std::ptrdiff_t>(last_bin + 1), region_id);
+    e.averages.emplace_back(region.average());
+  }
+  return e;
+}
+
+// Return NaN when the pixel does not belong to any region
+[[nodiscard]] inline double lookup_pileup_expected(const PileupExpected &e, std::uint64_t bin1_id,
+                                                   std::uint64_t bin2_id) noexcept {
+  const auto region = e.bin_regions[bin1_id];
+  if (region == EXPECTED_NULL_REGION || region != e.bin_regions[bin2_id]) {
+    return std::numeric_limits<double>::quiet_NaN();
+  }
+  const auto diag = bin1_id < bin2_id ? bin2_id - bin1_id : bin1_id - bin2_id;
+  return e.averages[region][conditional_static_cast<std::size_t>(diag)];
+}
+
+// Return the first bin of the window spanning flank bins around the midpoint of locus, or
+// std::nullopt when the window extends past the end of the chromosome
+[[nodiscard]] inline std::optional<std::uint64_t> pileup_window_start(const BinTable &bins,
+                                                                      const GenomicInterval &locus,
+                                                                      std::uint32_t flank) {
+  const auto &chrom = locus.chrom();
+  const auto midpoint = locus.start() + ((locus.end() - locus.start()) / 2);
+  const auto bin_id = bins.at(chrom, (std::min)(midpoint, chrom.size() - 1)).id();
+
+  const auto &prefix_sum = bins.num_bin_prefix_sum();
+  if (bin_id < prefix_sum[chrom.id()] + flank || bin_id + flank >= prefix_sum[chrom.id() + 1]) {
+    return {};
+  }
+  return bin_id - flank;
+}
+
+// Split the rows overlapped by queries into row-aligned [first_row, last_row) blocks of up to
+// chunk_size pixels. Blocks always contain at least one row, and blocks without pixels are
+// skipped. Queries should be sorted by row_start
+[[nodiscard]] inline std::vector<std::pair<std::uint64_t, std::uint64_t>> partition_pileup_rows(
+    const std::vector<PileupQuery> &queries, std::uint64_t size,
+    const std::vector<std::uint64_t> &bin1_offsets, std::size_t chunk_size) {
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> blocks{};
+  auto num_pixels = [&](std::uint64_t row) {
+    return conditional_static_cast<std::size_t>(bin1_offsets[row + 1] - bin1_offsets[row]);
+  };
+
+  for (auto it = queries.begin(); it != queries.end();) {
+    // Rows of queries that overlap or are adjacent are merged into a single span
+    const auto span_start = it->row_start;
+    auto span_end = it->row_start + size;
+    for (++it; it != queries.end() && it->row_start <= span_end; ++it) {
+      span_end = (std::max)(span_end, it->row_start + size);
+    }
+
+    for (auto row = span_start; row < span_end;) {
+      const auto first_row = row;
+      auto block_size = num_pixels(row++);
+      while (row < span_end && block_size + num_pixels(row) <= chunk_size) {
+        block_size += num_pixels(row++);
+      }
+      if (block_size != 0) {
+        blocks.emplace_back(first_row, row);
+      }
+    }
+  }
+  return blocks;
+}
+
+// Accumulate the values of the pixels found in the [first_row, last_row) block into buff
+inline void accumulate_pileup_block(const std::vector<PileupQuery> &queries, std::uint64_t size,
+                                    const std::vector<std::uint64_t> &bin1_offsets,
+                                    std::uint64_t first_row, std::uint64_t last_row,
+                                    const std::vector<std::uint64_t> &bin2_ids,
+                                    const std::vector<double> &counts,
+                                    const PileupExpected *expected, std::vector<double> &buff) {
+  const auto first_offset = bin1_offsets[first_row];
+
+  // Queries overlapping first_row start at most size - 1 rows before first_row
+  const auto min_row_start = first_row + 1 >= size ? first_row + 1 - size : 0;
+  auto next_query = std::lower_bound(
+      queries.begin(), queries.end(), min_row_start,
+      [](const PileupQuery &q, std::uint64_t row) { return q.row_start < row; });
+
+  std::vector<const PileupQuery *> active_queries{};
+  for (auto row = first_row; row < last_row; ++row) {
+    active_queries.erase(std::remove_if(active_queries.begin(), active_queries.end(),
+                                        [&](const PileupQuery *q) {
+                                          return q->row_start + size <= row;
+                                        }),
+                         active_queries.end());
+    for (; next_query != queries.end() && next_query->row_start <= row; ++next_query) {
+      if (next_query->row_start + size > row) {
+        active_queries.push_back(&*next_query);
+      }
+    }
+
+    const auto row_first = bin2_ids.begin() +
+                           static_cast<std::ptrdiff_t>(bin1_offsets[row] - first_offset);
+    const auto row_last = bin2_ids.begin() +
+                          static_cast<std::ptrdiff_t>(bin1_offsets[row + 1] - first_offset);
+    if (row_first == row_last) {
+      continue;
+    }
+
+    for (const auto *q : active_queries) {
+      const auto col_end = q->col_start + size;
+      for (auto it = std::lower_bound(row_first, row_last, q->col_start);
+           it != row_last && *it < col_end; ++it) {
+        const auto col = *it;
+        if (q->transposed && col == row) {
+          // Pixels on the diagonal are added by the query that is not transposed
+          continue;
+        }
+
+        auto value = counts[static_cast<std::size_t>(std::distance(bin2_ids.begin(), it))];
+        if (expected) {
+          value /= lookup_pileup_expected(*expected, row, col);
+        }
+        if (!std::isfinite(value)) {
+          continue;
+        }
+
+        const auto i = q->transposed ? col - q->col_start : row - q->row_start;
+        const auto j = q->transposed ? row - q->row_start : col - q->col_start;
+        buff[conditional_static_cast<std::size_t>((i * size) + j)] += value;
+      }
+    }
+  }
+}
+
+inline void compute_pileup_sum(const File &clr, const std::vector<PileupQuery> &queries,
+                               std::uint64_t size, const Weights *weights,
+                               const PileupExpected *expected, std::size_t num_threads,
+                               std::size_t chunk_size, std::vector<double> &sum) {
+  const auto bin1_offsets =
+      clr.dataset("indexes/bin1_offset").read_all<std::vector<std::uint64_t>>();
+  const auto blocks = partition_pileup_rows(queries, size, bin1_offsets, chunk_size);
+  if (blocks.empty()) {
+    return;
+  }
+  num_threads = (std::min)(num_threads, blocks.size());
+
+  const auto &bin1_dset = clr.dataset("pixels/bin1_id");
+  const auto &bin2_dset = clr.dataset("pixels/bin2_id");
+  const auto &count_dset = clr.dataset("pixels/count");
+
+  // Each thread accumulates values into its own buffer: buffers are reduced at the end.
+  // As in File::parallel_for_each_block(), all I/O goes through a single mutex
+  std::vector<std::vector<double>> sums(num_threads, std::vector<double>(sum.size(), 0));
+  std::mutex io_mtx;
+  std::atomic<std::size_t> next_block{0};
+  std::atomic<bool> early_return{false};
+  std::exception_ptr except{};
+  std::mutex except_mtx;
+
+  auto worker = [&](std::size_t thread_id) {
+    std::vector<std::uint64_t> bin1_buff{};
+    std::vector<std::uint64_t> bin2_buff{};
+    std::vector<double> count_buff{};
+
+    try {
+      while (!early_return) {
+        const auto i = next_block++;
+        if (i >= blocks.size()) {
+          break;
+        }
+        const auto [first_row, last_row] = blocks[i];
+        const auto offset = conditional_static_cast<std::size_t>(bin1_offsets[first_row]);
+        const auto num =
+            conditional_static_cast<std::size_t>(bin1_offsets[last_row] - bin1_offsets[first_row]);
+        {
+          [[maybe_unused]] const std::scoped_lock lck(io_mtx);
+          if (weights) {
+            bin1_dset.read(bin1_buff, num, offset);
+          }
+          bin2_dset.read(bin2_buff, num, offset);
+          count_dset.read(count_buff, num, offset);
+        }
+
+        if (weights) {
+          weights->balance(bin1_buff.data(), bin2_buff.data(), count_buff.data(), num,
+                           count_buff.data());
+        }
+        accumulate_pileup_block(queries, size, bin1_offsets, first_row, last_row, bin2_buff,
+                                count_buff, expected, sums[thread_id]);
+      }
+    } catch (...) {
+      [[maybe_unused]] const std::scoped_lock lck(except_mtx);
+      early_return = true;
+      if (!except) {
+        except = std::current_exception();
+      }
+    }
+  };
+
+  std::vector<std::thread> threads{};
+  threads.reserve(num_threads - 1);
+  for (std::size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(worker, i);
+  }
+  worker(0);
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  if (except) {
+    std::rethrow_exception(except);
+  }
+
+  for (const auto &buff : sums) {
+    for (std::size_t i = 0; i < buff.size(); ++i) {
+      sum[i] += buff[i];
+    }
+  }
+}
+
+}  // namespace internal
+
+inline Pileup pileup(const File &clr,
+                     const std::vector<std::pair<GenomicInterval, GenomicInterval>> &loci,
+                     std::uint32_t flank, std::shared_ptr<const Weights> weights,
+                     const std::vector<ExpectedCis> *expected, std::size_t num_threads,
+                     std::size_t chunk_size) {
+  const auto &bins = clr.bins();
+  const auto size = (std::uint64_t(flank) * 2) + 1;
+  const auto symmetric_upper =
+      clr.attributes().storage_mode.value_or("symmetric-upper") == "symmetric-upper";
+
+  Pileup result{size, std::vector<double>(size * size, 0),
+                std::vector<std::uint64_t>(size * size, 0), 0};
+
+  // Windows are identified by their first row and column
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> windows{};
+  std::vector<internal::PileupQuery> queries{};
+  for (const auto &[locus1, locus2] : loci) {
+    const auto row_start = internal::pileup_window_start(bins, locus1, flank);
+    const auto col_start = internal::pileup_window_start(bins, locus2, flank);
+    if (!row_start || !col_start) {
+      continue;
+    }
+    windows.emplace_back(*row_start, *col_start);
+    if (!symmetric_upper || *row_start < *col_start + size) {
+      queries.push_back({*row_start, *col_start, false});
+    }
+    if (symmetric_upper && *row_start + size > *col_start + 1) {
+      queries.push_back({*col_start, *row_start, true});
+    }
+  }
+  result.num_windows = windows.size();
+
+  std::sort(queries.begin(), queries.end(),
+            [](const internal::PileupQuery &q1, const internal::PileupQuery &q2) {
+              return std::make_pair(q1.row_start, q1.col_start) <
+                     std::make_pair(q2.row_start, q2.col_start);
+            });
+
+  std::optional<internal::PileupExpected> expected_{};
+  if (expected) {
+    expected_ = internal::init_pileup_expected(bins, *expected);
+  }
+
+  chunk_size = (std::max)(std::size_t(1), chunk_size);
+  internal::compute_pileup_sum(clr, queries, size, weights.get(),
+                               expected_ ? &*expected_ : nullptr,
+                               internal::normalize_num_threads(num_threads), chunk_size,
+                               result.sum);
+
+  // Values are valid when both bins have a valid weight and, when dividing by the expected, when
+  // the expected interactions of the pixel are finite and non-zero
+  if (!weights && !expected_) {
+    std::fill(result.num_valid.begin(), result.num_valid.end(), windows.size());
+    return result;
+  }
+
+  const auto valid_bins = internal::compute_valid_bins(bins, weights.get());
+  for (const auto &[row_start, col_start] : windows) {
+    for (std::uint64_t i = 0; i < size; ++i) {
+      const auto row = row_start + i;
+      if (!valid_bins[row]) {
+        continue;
+      }
+      for (std::uint64_t j = 0; j < size; ++j) {
+        const auto col = col_start + j;
+        if (!valid_bins[col]) {
+          continue;
+        }
+        if (expected_) {
+          const auto e = internal::lookup_pileup_expected(*expected_, row, col);
+          if (!std::isfinite(e) || e == 0) {
+            continue;
+          }
+        }
+        ++result.num_valid[conditional_static_cast<std::size_t>((i * size) + j)];
+      }
+    }
+  }
+  return result;
+}
+
+}  // namespace coolerpp::utils
@@ -0,0 +1,315 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/coolerpp.hpp"
+
+namespace coolerpp::utils {
+
+namespace internal {
+
+// Runs are stored as a sequence of blocks of up to RUN_BLOCK_SIZE pixels.
+// Each block consists of the number of pixels n, followed by n keys and n counts
+inline constexpr std::size_t RUN_BLOCK_SIZE = 1ULL << 16U;
+
+template <typename N>
+inline void write_run_block(std::ofstream& fs, const std::uint64_t* keys, const N* counts,
+                            std::size_t n) {
+  const auto n_ = conditional_static_cast<std::uint64_t>(n);
+  // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+  fs.write(reinterpret_cast<const char*>(&n_), sizeof(n_));
+  fs.write(reinterpret_cast<const char*>(keys), static_cast<std::streamsize>(n * sizeof(*keys)));
+  fs.write(reinterpret_cast<const char*>(counts), static_cast<std::streamsize>(n * sizeof(N)));
+  // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+  if (!fs) {
+    throw std::runtime_error("failed to write pixels to temporary file");
+  }
+}
+
+// Buffered reader over the pixels stored in a run
+template <typename N>
+struct RunReader {
+  std::ifstream fs{};
+  std::vector<std::uint64_t> keys{};
+  std::vector<N> counts{};
+  std::size_t i{};
+
+  explicit RunReader(const std::filesystem::path& path)
+      : fs(path, std::ios::binary | std::ios::in) {
+    if (!fs) {
+      throw std::runtime_error(fmt::format(
+          FMT_STRING("failed to open temporary file {} for reading"), path.string()));
+    }
+    this->read_block();
+  }
+
+  [[nodiscard]] bool exhausted() const noexcept { return this->i == this->keys.size(); }
+
+  void advance() {
+    assert(!this->exhausted());
+    if (++this->i == this->keys.size()) {
+      this->read_block();
+    }
+  }
+
+  void read_block() {
+    this->i = 0;
+    std::uint64_t n{};
+    // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (!this->fs.read(reinterpret_cast<char*>(&n), sizeof(n))) {
+      this->keys.clear();
+      this->counts.clear();
+      return;
+    }
+    this->keys.resize(conditional_static_cast<std::size_t>(n));
+    this->counts.resize(conditional_static_cast<std::size_t>(n));
+    this->fs.read(reinterpret_cast<char*>(this->keys.data()),
+                  static_cast<std::streamsize>(this->keys.size() * sizeof(std::uint64_t)));
+    this->fs.read(reinterpret_cast<char*>(this->counts.data()),
+                  static_cast<std::streamsize>(this->counts.size() * sizeof(N)));
+    // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+    if (!this->fs) {
+      throw std::runtime_error("failed to read pixels from temporary file: file is truncated");
+    }
+  }
+};
+
+}  // namespace internal
+
+template <typename N>
+inline PixelSorter<N>::PixelSorter(File& dest, std::filesystem::path tmp_dir,
+                                   std::size_t buffer_capacity)
+    : _dest(&dest),
+      _tmp_dir(std::move(tmp_dir)),
+      _buffer_capacity((std::max)(std::size_t(1), buffer_capacity)),
+      _num_bins(conditional_static_cast<std::uint64_t>(dest.bins().size())) {
+  static_assert(std::is_arithmetic_v<N>);
+  if (this->_num_bins > (std::uint64_t(1) << 32U)) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("unable to sort pixels for cooler {}: too many bins ({})"),
+                    dest.uri(), this->_num_bins));
+  }
+  this->_keys.reserve(this->_buffer_capacity);
+  this->_counts.reserve(this->_buffer_capacity);
+}
+
+template <typename N>
+inline PixelSorter<N>::~PixelSorter() noexcept {
+  this->remove_runs();
+}
+
+template <typename N>
+inline void PixelSorter<N>::add(std::uint64_t bin1_id, std::uint64_t bin2_id, N count) {
+  if (this->_finalized) {
+    throw std::logic_error("unable to add pixels: PixelSorter has already been finalized");
+  }
+  if (bin1_id > bin2_id || bin2_id >= this->_num_bins) {
+    throw std::out_of_range(fmt::format(
+        FMT_STRING("invalid pixel {}:{}: pixel does not map to the upper triangle of a matrix "
+                   "with {} bins"),
+        bin1_id, bin2_id, this->_num_bins));
+  }
+
+  this->_keys.push_back((bin1_id * this->_num_bins) + bin2_id);
+  this->_counts.push_back(count);
+  if (this->_keys.size() == this->_buffer_capacity) {
+    this->spill_buffer();
+  }
+}
+
+template <typename N>
+inline void PixelSorter<N>::add(const Pixel<N>& pixel) {
+  this->add(pixel.coords.bin1.id(), pixel.coords.bin2.id(), pixel.count);
+}
+
+template <typename N>
+inline void PixelSorter<N>::add(const ThinPixel<N>& pixel) {
+  this->add(pixel.bin1_id, pixel.bin2_id, pixel.count);
+}
+
+template <typename N>
+template <typename PixelIt>
+inline void PixelSorter<N>::add(PixelIt first_pixel, PixelIt last_pixel) {
+  std::for_each(first_pixel, last_pixel, [&](const auto& p) { this->add(p); });
+}
+
+template <typename N>
+inline void PixelSorter<N>::finalize(std::size_t chunk_size) {
+  if (this->_finalized) {
+    return;
+  }
+  chunk_size = (std::max)(std::size_t(1), chunk_size);
+
+  try {
+    if (this->_runs.empty()) {
+      this->sort_buffer();
+      this->write_buffer(chunk_size);
+    } else {
+      this->spill_buffer();
+      this->merge_runs(chunk_size);
+    }
+  } catch (...) {
+    this->remove_runs();
+    throw;
+  }
+  this->remove_runs();
+  this->_finalized = true;
+}
+
+template <typename N>
+inline std::size_t PixelSorter<N>::num_runs() const noexcept {
+  return this->_runs.size();
+}
+
+// Sort the buffered pixels and sum counts of pixels with the same coordinates
+template <typename N>
+inline void PixelSorter<N>::sort_buffer() {
+  auto& keys = this->_keys;
+  auto& counts = this->_counts;
+  internal::radix_sort(keys, counts);
+
+  std::size_t j = 0;
+  for (std::size_t i = 0; i < keys.size(); ++j) {
+    const auto key = keys[i];
+    auto count = counts[i];
+    for (++i; i < keys.size() && keys[i] == key; ++i) {
+      count += counts[i];
+    }
+    keys[j] = key;
+    counts[j] = count;
+  }
+  keys.resize(j);
+  counts.resize(j);
+}
+
+template <typename N>
+inline void PixelSorter<N>::spill_buffer() {
+  if (this->_keys.empty()) {
+    return;
+  }
+  this->sort_buffer();
+
+  // Use a random token to avoid clashes between sorters sharing the same tmp folder
+  static thread_local std::mt19937_64 rand_eng{std::random_device{}()};
+  const auto prefix = std::filesystem::path(this->_dest->path()).filename().string();
+  auto path = this->_tmp_dir / fmt::format(FMT_STRING("{}.{:016x}.sort.{}.tmp"), prefix,
+                                           rand_eng(), this->_runs.size());
+  std::ofstream fs(path, std::ios::binary | std::ios::out | std::ios::trunc);
+  if (!fs) {
+    throw std::runtime_error(fmt::format(
+        FMT_STRING("failed to open temporary file {} for writing"), path.string()));
+  }
+  this->_runs.emplace_back(std::move(path));
+
+  for (std::size_t i = 0; i < this->_keys.size(); i += internal::RUN_BLOCK_SIZE) {
+    const auto n = (std::min)(internal::RUN_BLOCK_SIZE, this->_keys.size() - i);
+    internal::write_run_block(fs, this->_keys.data() + i, this->_counts.data() + i, n);
+  }
+  this->_keys.clear();
+  this->_counts.clear();
+}
+
+// Write the pixels from a buffer that has already been sorted
+template <typename N>
+inline void PixelSorter<N>::write_buffer(std::size_t chunk_size) {
+  std::vector<std::uint64_t> bin1_buff{};
+  std::vector<std::uint64_t> bin2_buff{};
+  for (std::size_t i = 0; i < this->_keys.size(); i += chunk_size) {
+    const auto n = (std::min)(chunk_size, this->_keys.size() - i);
+    bin1_buff.resize(n);
+    bin2_buff.resize(n);
+    for (std::size_t j = 0; j < n; ++j) {
+      bin1_buff[j] = this->_keys[i + j] / this->_num_bins;
+      bin2_buff[j] = this->_keys[i + j] % this->_num_bins;
+    }
+    this->_dest->append_pixels_columns(bin1_buff.data(), bin2_buff.data(),
+                                       this->_counts.data() + i, n);
+  }
+  this->_keys.clear();
+  this->_counts.clear();
+}
+
+template <typename N>
+inline void PixelSorter<N>::merge_runs(std::size_t chunk_size) {
+  std::vector<internal::RunReader<N>> readers{};
+  readers.reserve(this->_runs.size());
+  for (const auto& path : this->_runs) {
+    readers.emplace_back(path);
+  }
+
+  // Runs store keys as bin1_id * num_bins + bin2_id. These sort like the keys produced by
+  // LoserTree::pack_key() and are always smaller than LoserTree::EXHAUSTED
+  using coolerpp::internal::LoserTree;
+  auto next_key = [&](std::size_t i) {
+    const auto& reader = readers[i];
+    return reader.exhausted() ? LoserTree::EXHAUSTED : reader.keys[reader.i];
+  };
+
+  std::vector<std::uint64_t> keys(readers.size());
+  for (std::size_t i = 0; i < readers.size(); ++i) {
+    keys[i] = next_key(i);
+  }
+  LoserTree tree{std::move(keys)};
+
+  std::vector<std::uint64_t> bin1_buff{};
+  std::vector<std::uint64_t> bin2_buff{};
+  std::vector<N> count_buff{};
+  bin1_buff.reserve(chunk_size);
+  bin2_buff.reserve(chunk_size);
+  count_buff.reserve(chunk_size);
+  auto write_pixels = [&]() {
+    this->_dest->append_pixels_columns(bin1_buff.data(), bin2_buff.data(), count_buff.data(),
+                                       bin1_buff.size());
+    bin1_buff.clear();
+    bin2_buff.clear();
+    count_buff.clear();
+  };
+
+  while (!tree.done()) {
+    const auto key = tree.top_key();
+    N count{0};
+    // Pixels with the same coordinates are unique within a run, but not across runs
+    do {
+      const auto i = tree.top();
+      auto& reader = readers[i];
+      count += reader.counts[reader.i];
+      reader.advance();
+      tree.replace_top(next_key(i));
+    } while (tree.top_key() == key);
+
+    bin1_buff.push_back(key / this->_num_bins);
+    bin2_buff.push_back(key % this->_num_bins);
+    count_buff.push_back(count);
+    if (bin1_buff.size() == chunk_size) {
+      write_pixels();
+    }
+  }
+  write_pixels();
+}
+
+template <typename N>
+inline void PixelSorter<N>::remove_runs() noexcept {
+  for (const auto& path : this->_runs) {
+    std::error_code ec{};
+    std::filesystem::remove(path, ec);
+  }
+  this->_runs.clear();
+}
+
+}  // namespace coolerpp::utils
@@ -0,0 +1,121 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <H5Opublic.h>
+#include <H5Ppublic.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <exception>
+#include <highfive/H5DataSet.hpp>
+#include <highfive/H5DataType.hpp>
+#include <highfive/H5Group.hpp>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "coolerpp/attribute.hpp"
+#include "coolerpp/common.hpp"
+#include "coolerpp/coolerpp.hpp"
+
+namespace coolerpp::utils {
+
+namespace internal {
+inline void copy_bin_datasets(const File& src, File& dest) {
+  constexpr std::array<std::string_view, 5> skipped_dsets{"chrom", "start", "end", "marginal_sum",
+                                                          "marginal_nnz"};
+
+  const auto& src_grp = src.group("bins").group;
+  for (const auto& name : src_grp.listObjectNames()) {
+    if (std::find(skipped_dsets.begin(), skipped_dsets.end(), name) != skipped_dsets.end() ||
+        src_grp.getObjectType(name) != HighFive::ObjectType::Dataset) {
+      continue;
+    }
+
+    const auto src_dset = src_grp.getDataSet(name);
+    const auto dtype = src_dset.getDataType();
+    if (dtype.getClass() != HighFive::DataTypeClass::Float) {
+      // Datasets other than weights are copied verbatim, together with their attributes
+      auto& dest_grp = dest.group("bins").group;
+      if (H5Ocopy(src_grp.getId(), name.c_str(), dest_grp.getId(), name.c_str(), H5P_DEFAULT,
+                  H5P_DEFAULT) < 0) {
+        throw std::runtime_error(
+            fmt::format(FMT_STRING("failed to copy dataset {}/{}"), src_grp.getPath(), name));
+      }
+      continue;
+    }
+
+    // Weights are stored using their original precision
+    if (dtype.getSize() == sizeof(float)) {
+      std::vector<float> weights{};
+      src_dset.read(weights);
+      dest.write_weights(name, weights.begin(), weights.end());
+    } else {
+      std::vector<double> weights{};
+      src_dset.read(weights);
+      dest.write_weights(name, weights.begin(), weights.end());
+    }
+
+    auto dest_dset = dest.group("bins").group.getDataSet(name);
+    for (const auto& key : src_dset.listAttributeNames()) {
+      std::visit(
+          [&](const auto& value) {
+            using T = remove_cvref_t<decltype(value)>;
+            if constexpr (!std::is_same_v<T, std::monostate>) {
+              Attribute::write(dest_dset, key, value, true);
+            }
+          },
+          Attribute::read(src_dset, key));
+    }
+  }
+}
+}  // namespace internal
+
+inline void repack(std::string_view src_uri, std::string_view dest_uri,
+                   const RepackOptions& options) {
+  auto clr = File::open_read_only_read_once(std::string{src_uri});
+  if (clr.bins().type() == BinTable::Type::VARIABLE) {
+    throw std::runtime_error(
+        fmt::format(FMT_STRING("failed to repack cooler {} to {}: coolers with variable bins are "
+                               "not supported"),
+                    clr.uri(), dest_uri));
+  }
+  const auto num_threads = options.num_threads == 0
+                               ? std::size_t((std::max)(1U, std::thread::hardware_concurrency()))
+                               : options.num_threads;
+  if (num_threads > 1) {
+    clr.set_decompression_threads(num_threads);
+  }
+
+  WriterOptions writer_options{};
+  writer_options.threads = num_threads;
+  writer_options.compression = options.compression;
+  writer_options.compute_bin_marginals = clr.has_bin_marginals();
+  writer_options.compute_chromosome_pair_stats = clr.has_chromosome_pair_stats();
+
+  try {
+    std::visit(
+        [&](auto count) {
+          using N = remove_cvref_t<decltype(count)>;
+          auto dest = File::create_new_cooler<N>(
+              dest_uri, clr.chromosomes(), clr.bin_size(), options.overwrite_if_exists,
+              clr.attributes(), DEFAULT_HDF5_CACHE_SIZE * 4, writer_options);
+          internal::copy_pixels<N>(clr, dest, options.block_size);
+          internal::copy_bin_datasets(clr, dest);
+        },
+        clr.pixel_variant());
+  } catch (const std::exception& e) {
+    throw std::runtime_error(fmt::format(FMT_STRING("failed to repack cooler {} to {}: {}"),
+                                         clr.uri(), dest_uri, e.what()));
+  }
+}
+}  // namespace coolerpp::utils
@@ -0,0 +1,202 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/bin_table.hpp"
+#include "coolerpp/pixel.hpp"
+
+namespace coolerpp::utils {
+
+namespace internal {
+
+// Passes are split across threads only when every thread gets at least this many pixels
+inline constexpr std::size_t MIN_PIXELS_PER_SORT_THREAD = 1ULL << 16U;
+
+// Number of bits required to represent n
+[[nodiscard]] constexpr std::uint32_t bit_width(std::uint64_t n) noexcept {
+  std::uint32_t width = 0;
+  for (; n != 0; n >>= 1U) {
+    ++width;
+  }
+  return width;
+}
+
+template <typename PixelT>
+[[nodiscard]] inline std::pair<std::uint64_t, std::uint64_t> get_bin_ids(
+    const PixelT& pixel) noexcept {
+  if constexpr (is_thin_pixel_v<PixelT>) {
+    return std::make_pair(pixel.bin1_id, pixel.bin2_id);
+  } else {
+    return std::make_pair(pixel.coords.bin1.id(), pixel.coords.bin2.id());
+  }
+}
+
+// Call fn(i) for i in [0, num_threads) using one thread for each call
+template <typename Fx>
+inline void run_on_threads(std::size_t num_threads, Fx&& fn) {
+  if (num_threads == 1) {
+    fn(std::size_t(0));
+    return;
+  }
+  std::vector<std::thread> threads{};
+  threads.reserve(num_threads);
+  for (std::size_t i = 0; i < num_threads; ++i) {
+    threads.emplace_back([&, i]() { fn(i); });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+// Each pass counts digits and scatters elements to scratch buffers: the input is split into
+// contiguous blocks (one per thread), and each thread scatters its block starting from the offsets
+// computed from the histograms of the preceding blocks, so that passes remain stable
+template <typename KeyFn, typename... Ts>
+inline void radix_sort(KeyFn get_key, std::uint64_t max_key, std::size_t num_threads,
+                       std::vector<Ts>&... columns) {
+  static_assert(sizeof...(Ts) != 0);
+  const auto n = std::get<0>(std::tie(columns...)).size();
+  assert(((columns.size() == n) && ...));
+  if (n < 2) {
+    return;
+  }
+  num_threads = (std::max)(std::size_t(1),
+                           (std::min)(num_threads, n / MIN_PIXELS_PER_SORT_THREAD));
+
+  auto block_bounds = [&](std::size_t i) {
+    return std::make_pair(n * i / num_threads, n * (i + 1) / num_threads);
+  };
+
+  std::tuple<std::vector<Ts>...> scratch{std::vector<Ts>(n)...};
+  std::vector<std::array<std::size_t, 256>> offsets(num_threads);
+
+  for (std::uint32_t shift = 0; shift < 64 && (max_key >> shift) != 0; shift += 8) {
+    run_on_threads(num_threads, [&](std::size_t i) {
+      auto& hist = offsets[i];
+      hist.fill(0);
+      const auto [first, last] = block_bounds(i);
+      for (auto j = first; j < last; ++j) {
+        ++hist[(get_key(j) >> shift) & 0xFFU];
+      }
+    });
+
+    // Turn histograms into the offsets where each thread should start writing each digit
+    std::size_t offset = 0;
+    bool skip_pass = false;
+    for (std::size_t digit = 0; digit < 256; ++digit) {
+      const auto first_offset = offset;
+      for (auto& hist : offsets) {
+        offset += std::exchange(hist[digit], offset);
+      }
+      // All keys share the same digit: this pass would not change the order of the elements
+      if (offset - first_offset == n) {
+        skip_pass = true;
+        break;
+      }
+    }
+    if (skip_pass) {
+      continue;
+    }
+
+    run_on_threads(num_threads, [&](std::size_t i) {
+      auto& dest_offsets = offsets[i];
+      const auto [first, last] = block_bounds(i);
+      for (auto j = first; j < last; ++j) {
+        const auto k = dest_offsets[(get_key(j) >> shift) & 0xFFU]++;
+        std::apply([&](auto&... tmp) { ((tmp[k] = std::move(columns[j])), ...); }, scratch);
+      }
+    });
+    std::apply([&](auto&... tmp) { (std::swap(columns, tmp), ...); }, scratch);
+  }
+}
+
+// Sum the counts of adjacent pixels with the same coordinates
+template <typename PixelT>
+inline void sum_duplicate_pixels(std::vector<PixelT>& pixels) {
+  if (pixels.empty()) {
+    return;
+  }
+
+  std::size_t j = 0;
+  for (std::size_t i = 1; i < pixels.size(); ++i) {
+    if (get_bin_ids(pixels[i]) == get_bin_ids(pixels[j])) {
+      pixels[j].count += pixels[i].count;
+    } else if (++j != i) {
+      pixels[j] = std::move(pixels[i]);
+    }
+  }
+  pixels.erase(pixels.begin() + static_cast<std::ptrdiff_t>(j + 1), pixels.end());
+}
+
+template <typename PixelT>
+inline void sort_pixels(std::vector<PixelT>& pixels, bool sum_duplicates,
+                        std::size_t num_threads) {
+  if (num_threads == 0) {
+    num_threads = (std::max)(1U, std::thread::hardware_concurrency());
+  }
+
+  std::uint64_t max_bin1_id = 0;
+  std::uint64_t max_bin2_id = 0;
+  bool sorted = true;
+  for (std::size_t i = 0; i < pixels.size(); ++i) {
+    const auto [bin1_id, bin2_id] = get_bin_ids(pixels[i]);
+    if (bin1_id == Bin::null_id || bin2_id == Bin::null_id) {
+      throw std::runtime_error(
+          "unable to sort pixels: found a pixel overlapping bins without a bin id");
+    }
+    max_bin1_id = (std::max)(max_bin1_id, bin1_id);
+    max_bin2_id = (std::max)(max_bin2_id, bin2_id);
+    sorted = sorted && (i == 0 || get_bin_ids(pixels[i - 1]) <= std::make_pair(bin1_id, bin2_id));
+  }
+
+  // Batches are often sorted already, e.g. when they are produced by reading a cooler
+  if (!sorted) {
+    const auto bin2_width = bit_width(max_bin2_id);
+    if (bit_width(max_bin1_id) + bin2_width > 64) {
+      throw std::runtime_error(fmt::format(
+          FMT_STRING("unable to sort pixels: bin ids {} and {} cannot be packed into 64 bits"),
+          max_bin1_id, max_bin2_id));
+    }
+    // Keys pack bin1_id and bin2_id as bin1_id << bin2_width | bin2_id
+    auto get_key = [&](std::size_t i) {
+      const auto [bin1_id, bin2_id] = get_bin_ids(pixels[i]);
+      return (bin1_id << bin2_width) | bin2_id;
+    };
+    radix_sort(get_key, (max_bin1_id << bin2_width) | max_bin2_id, num_threads, pixels);
+  }
+
+  if (sum_duplicates) {
+    sum_duplicate_pixels(pixels);
+  }
+}
+
+}  // namespace internal
+
+template <typename N>
+inline void sort_pixels(std::vector<ThinPixel<N>>& pixels, bool sum_duplicates,
+                        std::size_t num_threads) {
+  internal::sort_pixels(pixels, sum_duplicates, num_threads);
+}
+
+template <typename N>
+inline void sort_pixels(std::vector<Pixel<N>>& pixels, bool sum_duplicates,
+                        std::size_t num_threads) {
+  internal::sort_pixels(pixels, sum_duplicates, num_threads);
+}
+
+}  // namespace coolerpp::utils
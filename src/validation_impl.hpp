@@ -8,15 +8,23 @@
 #include <fmt/format.h>
 #include <fmt/ranges.h>
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <highfive/H5File.hpp>
 #include <highfive/H5Utility.hpp>
+#include <iterator>
+#include <random>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #include "coolerpp/attribute.hpp"
 #include "coolerpp/common.hpp"
+#include "coolerpp/dataset.hpp"
 #include "coolerpp/internal/numeric_utils.hpp"
+#include "coolerpp/remote.hpp"
 #include "coolerpp/uri.hpp"
 
 namespace coolerpp::utils {
@@ -33,7 +41,7 @@ inline ValidationStatusCooler is_cooler(std::string_view uri) {
   [[maybe_unused]] const HighFive::SilenceHDF5 silencer{};  // NOLINT
   const auto [file_path, root_path] = parse_cooler_uri(uri);
 
-  const HighFive::File fp(file_path, HighFive::File::ReadOnly);
+  const auto fp = coolerpp::internal::open_file_read_only(file_path);
   return is_cooler(fp, root_path);
 }
 
@@ -43,18 +51,36 @@ inline ValidationStatusMultiresCooler is_multires_file(std::string_view uri,
   [[maybe_unused]] const HighFive::SilenceHDF5 silencer{};  // NOLINT
   const auto file_path = parse_cooler_uri(uri).file_path;
 
-  const HighFive::File fp(file_path, HighFive::File::ReadOnly);
+  const auto fp = coolerpp::internal::open_file_read_only(file_path);
   return is_multires_file(fp, validate_resolutions, min_version);
 }
 
+inline ValidationStatusMultiresCooler is_multires_file(std::string_view uri,
+                                                       const ValidationOptions &opts,
+                                                       std::int64_t min_version) {
+  [[maybe_unused]] const HighFive::SilenceHDF5 silencer{};  // NOLINT
+  const auto file_path = parse_cooler_uri(uri).file_path;
+
+  const auto fp = coolerpp::internal::open_file_read_only(file_path);
+  return is_multires_file(fp, opts, min_version);
+}
+
 inline ValidationStatusScool is_scool_file(std::string_view uri, bool validate_cells) {
   [[maybe_unused]] const HighFive::SilenceHDF5 silencer{};  // NOLINT
   const auto file_path = parse_cooler_uri(uri).file_path;
 
-  const HighFive::File fp(file_path, HighFive::File::ReadOnly);
+  const auto fp = coolerpp::internal::open_file_read_only(file_path);
   return is_scool_file(fp, validate_cells);
 }
 
+inline ValidationStatusScool is_scool_file(std::string_view uri, const ValidationOptions &opts) {
+  [[maybe_unused]] const HighFive::SilenceHDF5 silencer{};  // NOLINT
+  const auto file_path = parse_cooler_uri(uri).file_path;
+
+  const auto fp = coolerpp::internal::open_file_read_only(file_path);
+  return is_scool_file(fp, opts);
+}
+
 inline ValidationStatusCooler is_cooler(const HighFive::File &fp, std::string_view root_path) {
   return is_cooler(fp.getGroup(std::string{root_path}));
 }
@@ -87,10 +113,10 @@ inline ValidationStatusCooler is_cooler(const HighFive::Group &root_group) {
     status.missing_or_invalid_format_attr |= version == 0 || version > 3;
   }
 
-  // Check file has a bin-type that we support (currently only "fixed" is supported)
+  // Check file has a bin-type that we support ("fixed" or "variable")
   if (Attribute::exists(root_group, "bin-type")) {
     const auto bin_type = Attribute::read<std::string>(root_group, "bin-type");
-    status.missing_or_invalid_bin_type_attr = bin_type != "fixed";
+    status.missing_or_invalid_bin_type_attr = bin_type != "fixed" && bin_type != "variable";
   }
 
   // Check file has the mandatory groups
@@ -120,6 +146,68 @@ inline ValidationStatusCooler is_cooler(const HighFive::Group &root_group) {
 inline ValidationStatusMultiresCooler is_multires_file(const HighFive::File &fp,
                                                        bool validate_resolutions,
                                                        std::int64_t min_version) {
+  if (validate_resolutions) {
+    return is_multires_file(fp, ValidationOptions{}, min_version);
+  }
+  return internal::is_multires_file(fp, nullptr, min_version);
+}
+
+inline ValidationStatusMultiresCooler is_multires_file(const HighFive::File &fp,
+                                                       const ValidationOptions &opts,
+                                                       std::int64_t min_version) {
+  return internal::is_multires_file(fp, &opts, min_version);
+}
+
+inline ValidationStatusScool is_scool_file(const HighFive::File &fp, bool validate_cells) {
+  if (validate_cells) {
+    return is_scool_file(fp, ValidationOptions{});
+  }
+  return internal::is_scool_file(fp, nullptr);
+}
+
+inline ValidationStatusScool is_scool_file(const HighFive::File &fp,
+                                           const ValidationOptions &opts) {
+  return internal::is_scool_file(fp, &opts);
+}
+
+namespace internal {
+
+inline std::vector<ValidationStatusCooler> validate_groups(const HighFive::File &fp,
+                                                           std::string_view root_path,
+                                                           std::vector<std::string> names,
+                                                           const ValidationOptions *opts) {
+  if (!opts || names.empty()) {
+    return {};
+  }
+
+  if (opts->sample_size != 0 && opts->sample_size < names.size()) {
+    std::vector<std::string> sample{};
+    sample.reserve(opts->sample_size);
+    std::mt19937_64 rand_eng{opts->seed};
+    // std::sample preserves the relative order of the selected names
+    std::sample(std::make_move_iterator(names.begin()), std::make_move_iterator(names.end()),
+                std::back_inserter(sample), opts->sample_size, rand_eng);
+    names = std::move(sample);
+  }
+
+  // Groups are validated sequentially: validation only reads metadata, and libhdf5 serializes
+  // API calls (even when built with thread-safety enabled), so threads cannot speed it up
+  std::vector<ValidationStatusCooler> invalid_groups{};
+  for (const auto &name : names) {
+    auto status = is_cooler(fp, fmt::format(FMT_STRING("{}/{}"), root_path, name));
+    if (!status) {
+      invalid_groups.emplace_back(std::move(status));
+      if (opts->stop_at_first_failure) {
+        break;
+      }
+    }
+  }
+  return invalid_groups;
+}
+
+inline ValidationStatusMultiresCooler is_multires_file(const HighFive::File &fp,
+                                                       const ValidationOptions *opts,
+                                                       std::int64_t min_version) {
   [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
   ValidationStatusMultiresCooler status{};
   status.uri = fp.getName();
@@ -143,12 +231,12 @@ inline ValidationStatusMultiresCooler is_multires_file(const HighFive::File &fp,
     status.missing_or_invalid_format_attr |= version == 0 || version > 3;
   }
 
-  // Check file has a bin-type that we support (currently only "fixed" is supported)
+  // Check file has a bin-type that we support ("fixed" or "variable")
   // NOTE: .mcool files are not required to advertise the bin type they are using at the root level
   status.missing_or_invalid_bin_type_attr = false;
   if (Attribute::exists(fp, "bin-type")) {
     const auto bin_type = Attribute::read<std::string>(fp, "bin-type");
-    status.missing_or_invalid_bin_type_attr = bin_type != "fixed";
+    status.missing_or_invalid_bin_type_attr = bin_type != "fixed" && bin_type != "variable";
   }
 
   // Try to read resolutions from the Cooler's root
@@ -181,15 +269,9 @@ inline ValidationStatusMultiresCooler is_multires_file(const HighFive::File &fp,
     status.missing_groups.emplace_back("resolutions");
   }
 
-  if (validate_resolutions) {
-    for (const auto &resolution : resolutions) {
-      const auto suffix = fmt::format(FMT_STRING("resolutions/{}"), resolution);
-
-      if (auto status_ = is_cooler(fp, suffix); !status_) {
-        status.file_was_properly_closed &= status_.file_was_properly_closed;
-        status.invalid_resolutions.emplace_back(std::move(status_));
-      }
-    }
+  status.invalid_resolutions = validate_groups(fp, "resolutions", resolutions, opts);
+  for (const auto &status_ : status.invalid_resolutions) {
+    status.file_was_properly_closed &= status_.file_was_properly_closed;
   }
 
   // clang-format off
@@ -204,7 +286,8 @@ inline ValidationStatusMultiresCooler is_multires_file(const HighFive::File &fp,
   return status;
 }
 
-inline ValidationStatusScool is_scool_file(const HighFive::File &fp, bool validate_cells) {
+inline ValidationStatusScool is_scool_file(const HighFive::File &fp,
+                                           const ValidationOptions *opts) {
   [[maybe_unused]] HighFive::SilenceHDF5 silencer{};  // NOLINT
   ValidationStatusScool status{};
   status.uri = fp.getName();
@@ -227,12 +310,12 @@ inline ValidationStatusScool is_scool_file(const HighFive::File &fp, bool valida
     status.missing_or_invalid_format_attr |= version == 0 || version > 3;
   }
 
-  // Check file has a bin-type that we support (currently only "fixed" is supported)
+  // Check file has a bin-type that we support ("fixed" or "variable")
   // NOTE: .scool files are not required to advertise the bin type they are using at the root level
   status.missing_or_invalid_bin_type_attr = false;
   if (Attribute::exists(fp, "bin-type")) {
     const auto bin_type = Attribute::read<std::string>(fp, "bin-type");
-    status.missing_or_invalid_bin_type_attr = bin_type != "fixed";
+    status.missing_or_invalid_bin_type_attr = bin_type != "fixed" && bin_type != "variable";
   }
 
   constexpr std::array<std::string_view, 3> scool_root_groups{"chroms", "bins", "cells"};
@@ -265,14 +348,9 @@ inline ValidationStatusScool is_scool_file(const HighFive::File &fp, bool valida
         expected_num_cells != conditional_static_cast<std::uint64_t>(cells.size());
   }
 
-  if (validate_cells) {
-    for (const auto &cell : cells) {
-      const auto suffix = fmt::format(FMT_STRING("cells/{}"), cell);
-      if (auto status_ = is_cooler(fp, suffix); !status_) {
-        status.file_was_properly_closed &= status_.file_was_properly_closed;
-        status.invalid_cells.emplace_back(std::move(status_));
-      }
-    }
+  status.invalid_cells = validate_groups(fp, "cells", cells, opts);
+  for (const auto &status_ : status.invalid_cells) {
+    status.file_was_properly_closed &= status_.file_was_properly_closed;
   }
 
   // clang-format off
@@ -288,6 +366,8 @@ inline ValidationStatusScool is_scool_file(const HighFive::File &fp, bool valida
   return status;
 }
 
+}  // namespace internal
+
 inline std::vector<std::uint32_t> list_resolutions(std::string_view uri, bool sorted) {
   [[maybe_unused]] const HighFive::SilenceHDF5 silencer{};  // NOLINT
   try {
@@ -295,7 +375,7 @@ inline std::vector<std::uint32_t> list_resolutions(std::string_view uri, bool so
       throw std::runtime_error("not a valid .mcool file");
     }
 
-    const HighFive::File fp(std::string{uri}, HighFive::File::ReadOnly);
+    const auto fp = coolerpp::internal::open_file_read_only(uri);
     auto root_grp = fp.getGroup("/resolutions");
 
     const auto resolutions_ = root_grp.listObjectNames();
@@ -0,0 +1,115 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <fmt/format.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include "coolerpp/balancing.hpp"
+#include "coolerpp/dataset.hpp"
+
+namespace coolerpp::internal {
+
+inline WeightCache& WeightCache::instance() {
+  static WeightCache cache{};
+  return cache;
+}
+
+template <typename WeightLoader>
+inline std::shared_ptr<const Weights> WeightCache::get_or_load(std::string_view file_path,
+                                                               std::string_view dset_path,
+                                                               Weights::Type type,
+                                                               Weights::Precision precision,
+                                                               WeightLoader loader) {
+  const auto key = make_key(file_path, dset_path, type, precision);
+
+  // The global lock is only held while looking up the entry: weights are read while holding the
+  // lock specific to the entry
+  std::shared_ptr<Entry> entry{};
+  {
+    const std::scoped_lock lck(this->_mtx);
+    auto it = this->_entries.find(key);
+    if (it == this->_entries.end()) {
+      this->purge_expired_entries();
+      it = this->_entries.emplace(key, std::make_shared<Entry>()).first;
+    }
+    entry = it->second;
+  }
+
+  const std::scoped_lock lck(entry->mtx);
+  if (auto weights = entry->weights.lock(); weights) {
+    return weights;
+  }
+
+  std::unique_lock<std::mutex> io_lck(this->_io_mtx, std::defer_lock);
+  if (!hdf5_library_is_threadsafe()) {
+    io_lck.lock();
+  }
+  std::shared_ptr<const Weights> weights = loader();
+  entry->weights = weights;
+  return weights;
+}
+
+inline void WeightCache::erase(std::string_view file_path, std::string_view dset_path) {
+  const auto prefix = make_prefix(file_path, dset_path);
+  const std::scoped_lock lck(this->_mtx);
+  for (auto it = this->_entries.begin(); it != this->_entries.end();) {
+    if (it->first.compare(0, prefix.size(), prefix) == 0) {
+      it = this->_entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+inline void WeightCache::clear() {
+  const std::scoped_lock lck(this->_mtx);
+  this->_entries.clear();
+}
+
+inline std::size_t WeightCache::size() {
+  const std::scoped_lock lck(this->_mtx);
+  this->purge_expired_entries();
+  return this->_entries.size();
+}
+
+inline std::string WeightCache::make_prefix(std::string_view file_path,
+                                            std::string_view dset_path) {
+  std::error_code ec{};
+  auto path = std::filesystem::weakly_canonical(std::filesystem::path{file_path}, ec);
+  if (ec) {
+    path = std::filesystem::path{file_path};
+  }
+  // NUL cannot appear in file or dataset paths, so keys are never ambiguous
+  return fmt::format(FMT_STRING("{}{}{}{}"), path.string(), '\0', dset_path, '\0');
+}
+
+inline std::string WeightCache::make_key(std::string_view file_path, std::string_view dset_path,
+                                         Weights::Type type, Weights::Precision precision) {
+  return fmt::format(FMT_STRING("{}{}:{}"), make_prefix(file_path, dset_path),
+                     static_cast<int>(type), static_cast<int>(precision));
+}
+
+inline void WeightCache::purge_expired_entries() {
+  for (auto it = this->_entries.begin(); it != this->_entries.end();) {
+    // Entries for weights that are currently being read have not been populated yet: the shared
+    // entry is also referenced by the thread that is reading the weights
+    if (it->second->weights.expired() && it->second.use_count() == 1) {
+      it = this->_entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace coolerpp::internal
@@ -0,0 +1,202 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include "coolerpp/arrow.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "coolerpp/coolerpp.hpp"
+
+namespace coolerpp::test {
+inline const std::filesystem::path datadir{"test/data"};  // NOLINT(cert-err58-cpp)
+}  // namespace coolerpp::test
+
+namespace coolerpp::test::arrow {
+
+template <typename T>
+[[nodiscard]] static T get_value(const ArrowArray& array, std::int64_t i) {
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  return static_cast<const T*>(array.buffers[1])[array.offset + i];
+}
+
+[[nodiscard]] static std::string_view get_dictionary_value(const ArrowArray& array,
+                                                           std::int64_t i) {
+  const auto idx = get_value<std::int32_t>(array, i);
+  const auto& dict = *array.dictionary;
+  // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  const auto* offsets = static_cast<const std::int32_t*>(dict.buffers[1]);
+  const auto* data = static_cast<const char*>(dict.buffers[2]);
+  return {data + offsets[idx], static_cast<std::size_t>(offsets[idx + 1] - offsets[idx])};
+  // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+}
+
+[[nodiscard]] static std::vector<std::string> get_column_names(const ArrowSchema& schema) {
+  std::vector<std::string> names{};
+  for (std::int64_t i = 0; i < schema.n_children; ++i) {
+    names.emplace_back(schema.children[i]->name);  // NOLINT
+  }
+  return names;
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Arrow: export pixels", "[arrow][short]") {
+  using T = std::int32_t;
+  const auto path = datadir / "cooler_test_file.cool";
+  const auto f = File::open_read_only(path.string());
+  const auto sel = f.fetch<T>("1:0-5000000");
+  const std::vector<Pixel<T>> expected(sel.begin(), sel.end());
+  REQUIRE(!expected.empty());
+
+  SECTION("columns") {
+    std::size_t j = 0;
+    for (auto blk : sel.read_batch()) {
+      const auto* bin1_ids = blk.bin1_ids().data();
+
+      ArrowArray array{};
+      ArrowSchema schema{};
+      io::export_pixels(std::move(blk), f.bins(), &array, &schema);
+
+      CHECK(std::string_view{schema.format} == "+s");
+      CHECK(get_column_names(schema) == std::vector<std::string>{"bin1_id", "bin2_id", "count"});
+      CHECK(std::string_view{schema.children[2]->format} == "i");  // NOLINT
+
+      REQUIRE(array.n_children == 3);
+      // Buffers are not copied
+      CHECK(array.children[0]->buffers[1] == bin1_ids);  // NOLINT
+
+      for (std::int64_t i = 0; i < array.length; ++i, ++j) {
+        // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        REQUIRE(j < expected.size());
+        const auto& p = expected[j];
+        CHECK(get_value<std::uint64_t>(*array.children[0], i) == p.coords.bin1.id());
+        CHECK(get_value<std::uint64_t>(*array.children[1], i) == p.coords.bin2.id());
+        CHECK(get_value<T>(*array.children[2], i) == p.count);
+        // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+      }
+
+      array.release(&array);
+      schema.release(&schema);
+      CHECK(!array.release);
+      CHECK(!schema.release);
+    }
+    CHECK(j == expected.size());
+  }
+
+  SECTION("joined and balanced") {
+    io::ArrowExportOptions opts{};
+    opts.join = true;
+    opts.weights = f.read_weights("weight");
+    const auto& weights = *opts.weights;
+
+    std::size_t j = 0;
+    for (auto blk : sel.read_batch()) {
+      ArrowArray array{};
+      ArrowSchema schema{};
+      io::export_pixels(std::move(blk), f.bins(), &array, &schema, opts);
+
+      CHECK(get_column_names(schema) ==
+            std::vector<std::string>{"bin1_id", "bin2_id", "count", "chrom1", "start1", "end1",
+                                     "chrom2", "start2", "end2", "balanced"});
+      REQUIRE(array.n_children == 10);
+
+      for (std::int64_t i = 0; i < array.length; ++i, ++j) {
+        // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        REQUIRE(j < expected.size());
+        const auto& p = expected[j];
+        CHECK(get_dictionary_value(*array.children[3], i) == p.coords.bin1.chrom().name());
+        CHECK(get_value<std::uint32_t>(*array.children[4], i) == p.coords.bin1.start());
+        CHECK(get_value<std::uint32_t>(*array.children[5], i) == p.coords.bin1.end());
+        CHECK(get_dictionary_value(*array.children[6], i) == p.coords.bin2.chrom().name());
+        CHECK(get_value<std::uint32_t>(*array.children[7], i) == p.coords.bin2.start());
+        CHECK(get_value<std::uint32_t>(*array.children[8], i) == p.coords.bin2.end());
+
+        double balanced{};
+        const auto bin1_id = p.coords.bin1.id();
+        const auto bin2_id = p.coords.bin2.id();
+        weights.balance(&bin1_id, &bin2_id, &p.count, 1, &balanced);
+        const auto found = get_value<double>(*array.children[9], i);
+        // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        if (std::isnan(balanced)) {
+          CHECK(std::isnan(found));
+        } else {
+          CHECK(found == balanced);
+        }
+      }
+
+      array.release(&array);
+      schema.release(&schema);
+    }
+    CHECK(j == expected.size());
+  }
+
+  SECTION("stream") {
+    ArrowArrayStream stream{};
+    io::export_pixel_stream(f.fetch<T, 64>("1:0-5000000"), f.bins_ptr(), &stream);
+
+    ArrowSchema schema{};
+    REQUIRE(stream.get_schema(&stream, &schema) == 0);
+    CHECK(get_column_names(schema) == std::vector<std::string>{"bin1_id", "bin2_id", "count"});
+    schema.release(&schema);
+
+    std::vector<ThinPixel<T>> pixels{};
+    while (true) {
+      ArrowArray batch{};
+      REQUIRE(stream.get_next(&stream, &batch) == 0);
+      if (!batch.release) {
+        break;
+      }
+      CHECK(batch.length <= 64);
+      for (std::int64_t i = 0; i < batch.length; ++i) {
+        // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        pixels.emplace_back(ThinPixel<T>{get_value<std::uint64_t>(*batch.children[0], i),
+                                         get_value<std::uint64_t>(*batch.children[1], i),
+                                         get_value<T>(*batch.children[2], i)});
+        // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+      }
+      batch.release(&batch);
+    }
+    CHECK(stream.get_last_error(&stream) == nullptr);
+    stream.release(&stream);
+
+    REQUIRE(pixels.size() == expected.size());
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+      CHECK(pixels[i] == expected[i].to_thin());
+    }
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Arrow: export bins", "[arrow][short]") {
+  const auto path = datadir / "cooler_test_file.cool";
+  const auto f = File::open_read_only(path.string());
+  const auto& bins = f.bins();
+
+  ArrowArray array{};
+  ArrowSchema schema{};
+  io::export_bins(bins, &array, &schema);
+
+  CHECK(get_column_names(schema) == std::vector<std::string>{"chrom", "start", "end"});
+  REQUIRE(array.length == static_cast<std::int64_t>(bins.size()));
+
+  std::int64_t i = 0;
+  for (const auto& bin : bins) {
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    CHECK(get_dictionary_value(*array.children[0], i) == bin.chrom().name());
+    CHECK(get_value<std::uint32_t>(*array.children[1], i) == bin.start());
+    CHECK(get_value<std::uint32_t>(*array.children[2], i) == bin.end());
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    ++i;
+  }
+
+  array.release(&array);
+  schema.release(&schema);
+}
+
+}  // namespace coolerpp::test::arrow
@@ -7,7 +7,12 @@
 #include <array>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
 #include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
 #include "coolerpp/coolerpp.hpp"
@@ -28,6 +33,20 @@ static void balancer_test_helper(const Balancer<N1>& sel,
   for (std::size_t i = 0; i < expected_counts.size(); ++i) {
     CHECK_THAT(pixels[i].count, Catch::Matchers::WithinAbs(expected_counts[i], abs_tol));
   }
+
+  // Use small blocks to make sure queries span multiple blocks
+  std::size_t i = 0;
+  sel.for_each_block(
+      [&](const auto& blk) {
+        REQUIRE(i + blk.size() <= pixels.size());
+        for (std::size_t j = 0; j < blk.size(); ++j, ++i) {
+          CHECK(blk.bin1_ids()[j] == pixels[i].coords.bin1.id());
+          CHECK(blk.bin2_ids()[j] == pixels[i].coords.bin2.id());
+          CHECK(blk.counts()[j] == pixels[i].count);
+        }
+      },
+      2);
+  CHECK(i == pixels.size());
 }
 
 // NOLINTNEXTLINE(readability-function-cognitive-complexity)
@@ -60,6 +79,54 @@ TEST_CASE("Coolerpp: Balancer", "[cooler][short]") {
       clr.read_weights("weight");
       CHECK(clr.purge_weights() == true);
     }
+
+    SECTION("shared") {
+      auto clr2 = File::open_read_only(path.string());
+      const auto w1 = clr.read_weights("weight");
+      const auto w2 = clr2.read_weights("weight");
+      CHECK(w1 == w2);
+      CHECK(clr.read_weights("weight", Weights::Type::DIVISIVE) != w1);
+    }
+
+    SECTION("concurrent reads") {
+      constexpr std::size_t num_threads = 8;
+      std::vector<std::shared_ptr<const Weights>> weights(num_threads);
+      std::vector<std::thread> threads{};
+      for (std::size_t i = 0; i < num_threads; ++i) {
+        threads.emplace_back([&, i]() { weights[i] = clr.read_weights("VC"); });
+      }
+      for (auto& t : threads) {
+        t.join();
+      }
+
+      for (const auto& w : weights) {
+        REQUIRE(!!w);
+        CHECK(w == weights.front());
+      }
+    }
+
+    SECTION("float32") {
+      const auto w64 = clr.read_weights("SCALE");
+      const auto w32 = clr.read_weights("SCALE", Weights::Type::INFER, Weights::Precision::FLOAT32);
+      CHECK(w32 != w64);
+      CHECK(w32 == clr.read_weights("SCALE", Weights::Type::INFER, Weights::Precision::FLOAT32));
+      CHECK(w32->type() == Weights::Type::DIVISIVE);
+      CHECK(w32->precision() == Weights::Precision::FLOAT32);
+      CHECK((*w32)().empty());
+      REQUIRE(w32->size() == w64->size());
+      REQUIRE(w32->factors().size() == w64->size());
+      CHECK(w32->memory_usage() < w64->memory_usage());
+      for (std::size_t i = 0; i < w64->size(); ++i) {
+        const auto w = (*w64)[i];
+        if (std::isnan(w)) {
+          CHECK(std::isnan(w32->factors()[i]));
+          CHECK(std::isnan((*w32)[i]));
+        } else {
+          CHECK_THAT(w32->factors()[i], Catch::Matchers::WithinRel(1.0 / w, 1.0e-6));
+          CHECK_THAT((*w32)[i], Catch::Matchers::WithinRel(w, 1.0e-6));
+        }
+      }
+    }
   }
 
   SECTION("Balancer") {
@@ -77,6 +144,71 @@ TEST_CASE("Coolerpp: Balancer", "[cooler][short]") {
       CHECK_THAT(sel.begin()->count, Catch::Matchers::WithinAbs(3.345797, 1.0e-6));
     }
 
+    SECTION("balance columns") {
+      const std::vector<std::uint64_t> bin1_ids{0, 0, 1};
+      const std::vector<std::uint64_t> bin2_ids{0, 2, 2};
+      const std::vector<std::int32_t> counts{1, 2, 3};
+      std::vector<double> balanced_counts(counts.size());
+
+      const Weights w1({0.5, 2.0, std::numeric_limits<double>::quiet_NaN()},
+                       Weights::Type::MULTIPLICATIVE);
+      w1.balance(bin1_ids.data(), bin2_ids.data(), counts.data(), counts.size(),
+                 balanced_counts.data());
+      CHECK(balanced_counts[0] == 0.25);
+      CHECK(std::isnan(balanced_counts[1]));
+      CHECK(std::isnan(balanced_counts[2]));
+
+      const Weights w2({0.5, 2.0, 4.0}, Weights::Type::DIVISIVE);
+      w2.balance(bin1_ids.data(), bin2_ids.data(), counts.data(), counts.size(),
+                 balanced_counts.data());
+      CHECK(balanced_counts[0] == 4.0);
+      CHECK(balanced_counts[1] == 1.0);
+      CHECK(balanced_counts[2] == 0.375);
+
+      // Balancing factors fold the weight type into a single multiplier
+      const Weights w3({0.5, 2.0, 4.0}, Weights::Type::DIVISIVE, Weights::Precision::FLOAT32);
+      CHECK(w3.factors() == std::vector<float>{2.0F, 0.5F, 0.25F});
+      CHECK_THROWS_AS(w3(), std::logic_error);
+      w3.balance(bin1_ids.data(), bin2_ids.data(), counts.data(), counts.size(),
+                 balanced_counts.data());
+      CHECK(balanced_counts[0] == 4.0);
+      CHECK(balanced_counts[1] == 1.0);
+      CHECK(balanced_counts[2] == 0.375);
+    }
+
+    SECTION("float32") {
+      for (const auto* name : {"weight", "GW_SCALE"}) {
+        const auto sel = clr.fetch<std::int32_t>("chr1");
+        const auto sel64 = Balancer(sel, clr.read_weights(name));
+        const auto sel32 = Balancer(
+            sel, clr.read_weights(name, Weights::Type::INFER, Weights::Precision::FLOAT32));
+        const std::vector<Pixel<double>> pixels64{sel64.begin(), sel64.end()};
+        const std::vector<Pixel<double>> pixels32{sel32.begin(), sel32.end()};
+
+        REQUIRE(pixels32.size() == pixels64.size());
+        for (std::size_t i = 0; i < pixels64.size(); ++i) {
+          CHECK(pixels32[i].coords == pixels64[i].coords);
+          if (std::isnan(pixels64[i].count)) {
+            CHECK(std::isnan(pixels32[i].count));
+          } else {
+            CHECK_THAT(pixels32[i].count, Catch::Matchers::WithinRel(pixels64[i].count, 1.0e-6));
+          }
+        }
+      }
+    }
+
+    SECTION("read batch") {
+      const auto sel = Balancer(clr.fetch<std::int32_t>("chr1"), clr.read_weights("weight"));
+      const std::vector<Pixel<double>> pixels{sel.begin(), sel.end()};
+      const auto blocks = sel.read_batch(1'000);
+
+      std::size_t nnz = 0;
+      for (const auto& blk : blocks) {
+        nnz += blk.size();
+      }
+      CHECK(nnz == pixels.size());
+    }
+
     SECTION("cis") {
       SECTION("ICE") {
         const auto sel = Balancer(clr.fetch<std::int32_t>("chr1", 5'000'000, 10'000'000),
@@ -111,5 +243,124 @@ TEST_CASE("Coolerpp: Balancer", "[cooler][short]") {
       }
     }
   }
+
+  SECTION("ObservedOverExpected") {
+    const auto weights = clr.read_weights("weight");
+    // Synthetic expected: decays with the distance from the diagonal, and is undefined for the
+    // second diagonal
+    std::vector<double> expected(clr.chromosomes().at("chr1").size() / clr.bin_size() + 1);
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+      expected[i] = 1.0 / static_cast<double>(i + 1);
+    }
+    expected[1] = std::numeric_limits<double>::quiet_NaN();
+
+    auto compare = [](double found, double expected_value) {
+      if (std::isnan(expected_value)) {
+        CHECK(std::isnan(found));
+      } else {
+        CHECK_THAT(found, Catch::Matchers::WithinRel(expected_value, 1.0e-9));
+      }
+    };
+
+    SECTION("columns") {
+      const std::vector<std::uint64_t> bin1_ids{0, 0, 1, 2};
+      const std::vector<std::uint64_t> bin2_ids{0, 1, 3, 9};
+      const std::vector<std::int32_t> counts{4, 2, 3, 1};
+      std::vector<double> ratios(counts.size());
+
+      const ObservedOverExpectedOp op(nullptr, {2.0, 0.0, 0.5});
+      op(bin1_ids.data(), bin2_ids.data(), counts.data(), counts.size(), ratios.data());
+      CHECK(ratios[0] == 2.0);
+      CHECK(std::isnan(ratios[1]));  // expected is 0
+      CHECK(ratios[2] == 6.0);
+      CHECK(std::isnan(ratios[3]));  // diagonal without expected
+
+      const ObservedOverExpectedOp log_op(nullptr, {2.0, 0.0, 0.5}, true);
+      CHECK(log_op(std::uint64_t{0}, std::uint64_t{0}, 4) == 1.0);
+      CHECK(log_op(std::uint64_t{1}, std::uint64_t{3}, 1) == 1.0);
+    }
+
+    SECTION("streaming") {
+      const auto sel = clr.fetch<std::int32_t>("chr1");
+      const Balancer balanced(sel, weights);
+      const ObservedOverExpected oe(sel, weights, expected);
+      const ObservedOverExpected log_oe(sel, weights, expected, true);
+
+      const std::vector<Pixel<double>> balanced_pixels{balanced.begin(), balanced.end()};
+      const std::vector<Pixel<double>> pixels{oe.begin(), oe.end()};
+      const std::vector<Pixel<double>> log_pixels{log_oe.begin(), log_oe.end()};
+      REQUIRE(!pixels.empty());
+      REQUIRE(pixels.size() == balanced_pixels.size());
+      REQUIRE(log_pixels.size() == balanced_pixels.size());
+
+      for (std::size_t i = 0; i < pixels.size(); ++i) {
+        const auto& p = balanced_pixels[i];
+        const auto diag = p.coords.bin2.id() - p.coords.bin1.id();
+        CHECK(pixels[i].coords == p.coords);
+        compare(pixels[i].count, p.count / expected[diag]);
+        compare(log_pixels[i].count, std::log2(p.count / expected[diag]));
+      }
+
+      std::size_t i = 0;
+      oe.for_each_block(
+          [&](const auto& blk) {
+            REQUIRE(i + blk.size() <= pixels.size());
+            for (std::size_t j = 0; j < blk.size(); ++j, ++i) {
+              CHECK(blk.bin1_ids()[j] == pixels[i].coords.bin1.id());
+              CHECK(blk.bin2_ids()[j] == pixels[i].coords.bin2.id());
+              compare(blk.counts()[j], pixels[i].count);
+            }
+          },
+          7);
+      CHECK(i == pixels.size());
+    }
+
+    SECTION("fetch dense") {
+      const auto query = "chr1:0-25000000";
+      const auto sel = clr.fetch<std::int32_t>(query);
+      const auto num_bins = clr.bins().at(clr.chromosomes().at("chr1"), 24'999'999).id() + 1;
+
+      std::vector<double> matrix(num_bins * num_bins);
+      clr.fetch_dense(query, query, ObservedOverExpectedOp{weights, expected}, matrix.data(),
+                      num_bins);
+
+      const ObservedOverExpected oe(sel, weights, expected);
+      std::size_t nnz = 0;
+      for (const auto& p : oe) {
+        const auto i1 = p.coords.bin1.id();
+        const auto i2 = p.coords.bin2.id();
+        compare(matrix[(i1 * num_bins) + i2], p.count);
+        compare(matrix[(i2 * num_bins) + i1], p.count);
+        ++nnz;
+      }
+      CHECK(nnz != 0);
+
+      // In log space 0 means observed == expected: pixels that are not stored are set to log2(0)
+      const ObservedOverExpectedOp log_op{weights, expected, true};
+      std::vector<double> log_matrix(num_bins * num_bins);
+      clr.fetch_dense(query, query, log_op, log_matrix.data(), num_bins);
+      std::vector<bool> stored(num_bins * num_bins, false);
+      const ObservedOverExpected log_oe(sel, weights, expected, true);
+      for (const auto& p : log_oe) {
+        const auto i1 = p.coords.bin1.id();
+        const auto i2 = p.coords.bin2.id();
+        compare(log_matrix[(i1 * num_bins) + i2], p.count);
+        compare(log_matrix[(i2 * num_bins) + i1], p.count);
+        stored[(i1 * num_bins) + i2] = true;
+        stored[(i2 * num_bins) + i1] = true;
+      }
+      std::size_t num_absent = 0;
+      for (std::uint64_t i1 = 0; i1 < num_bins; ++i1) {
+        for (std::uint64_t i2 = 0; i2 < num_bins; ++i2) {
+          if (!stored[(i1 * num_bins) + i2]) {
+            const auto value = log_matrix[(i1 * num_bins) + i2];
+            CHECK((std::isnan(value) || value == -std::numeric_limits<double>::infinity()));
+            ++num_absent;
+          }
+        }
+      }
+      CHECK(num_absent != 0);
+    }
+  }
 }
 }  // namespace coolerpp::test::coolerpp
@@ -4,6 +4,8 @@
 
 #include "coolerpp/bin_table.hpp"
 
+#include <fmt/format.h>
+
 #include <array>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_string.hpp>
@@ -11,6 +13,7 @@
 #include <cstdint>
 #include <stdexcept>
 #include <utility>
+#include <vector>
 
 namespace coolerpp::test::bin_table {
 
@@ -103,6 +106,30 @@ TEST_CASE("Bin", "[bin][short]") {
   }
 }
 
+// Compare BinTable::fill_columns() with the bins returned by BinTable::iterator for every range
+// of bin ids
+static void check_fill_columns(const BinTable& table) {
+  const std::vector<Bin> bins(table.begin(), table.end());
+  std::vector<std::uint32_t> chrom_ids(bins.size());
+  std::vector<std::uint32_t> starts(bins.size());
+  std::vector<std::uint32_t> ends(bins.size());
+
+  for (std::size_t first = 0; first < bins.size(); ++first) {
+    for (std::size_t n = 1; first + n <= bins.size(); ++n) {
+      table.fill_columns(first, n, chrom_ids.data(), starts.data(), ends.data());
+      for (std::size_t i = 0; i < n; ++i) {
+        const auto& bin = bins[first + i];
+        CHECK(chrom_ids[i] == bin.chrom().id());
+        CHECK(starts[i] == bin.start());
+        CHECK(ends[i] == bin.end());
+      }
+    }
+  }
+
+  CHECK_THROWS_AS(table.fill_columns(1, bins.size(), chrom_ids.data(), starts.data(), ends.data()),
+                  std::out_of_range);
+}
+
 // NOLINTNEXTLINE(readability-function-cognitive-complexity)
 TEST_CASE("BinTable", "[bin-table][short]") {
   constexpr std::uint32_t bin_size = 5000;
@@ -114,6 +141,8 @@ TEST_CASE("BinTable", "[bin-table][short]") {
       bin_size);
   // clang-format on
 
+  SECTION("fill columns") { check_fill_columns(table); }
+
   SECTION("stats") {
     CHECK(BinTable{}.empty());
     CHECK(table.size() == 11 + 6 + 2);
@@ -133,6 +162,28 @@ TEST_CASE("BinTable", "[bin-table][short]") {
     CHECK_THROWS_AS(table.at(table.size()), std::out_of_range);
   }
 
+  SECTION("at (many chromosomes)") {
+    // Mix of large and tiny chromosomes, so that some LUT buckets span multiple chromosomes
+    std::vector<Chromosome> chroms{};
+    for (std::uint32_t i = 0; i < 100; ++i) {
+      const auto size = i % 3 == 0 ? 1 + (i * 7919) % 100'000 : 1 + i;
+      chroms.emplace_back(i, fmt::format(FMT_STRING("chr{}"), i), size);
+    }
+    const BinTable table_(chroms.begin(), chroms.end(), 10);
+
+    std::uint64_t bin_id = 0;
+    for (const auto& chrom : table_.chromosomes()) {
+      for (std::uint32_t start = 0; start < chrom.size(); start += 10) {
+        CHECK(table_.map_to_chrom_idx(bin_id) == chrom.id());
+        const auto bin = table_.at(bin_id++);
+        REQUIRE(bin.chrom() == chrom);
+        CHECK(bin.start() == start);
+      }
+    }
+    CHECK(bin_id == table_.size());
+    CHECK_THROWS_AS(table_.at(bin_id), std::out_of_range);
+  }
+
   SECTION("coord to bin id") {
     const auto& chr2 = table.chromosomes().at("chr2");
 
@@ -268,4 +319,144 @@ TEST_CASE("BinTable", "[bin-table][short]") {
     }
   }
 }
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("BinTable (variable bins)", "[bin-table][short]") {
+  const ChromosomeSet chroms{Chromosome{0, "chr1", 1000}, Chromosome{1, "chr2", 500}};
+  // clang-format off
+  const BinTable table(chroms,
+                       {0, 10, 300, 750, 0, 1, 499},
+                       {10, 300, 750, 1000, 1, 499, 500});
+  // clang-format on
+
+  const auto& chr1 = table.chromosomes().at("chr1");
+  const auto& chr2 = table.chromosomes().at("chr2");
+
+  SECTION("fill columns") { check_fill_columns(table); }
+
+  SECTION("stats") {
+    CHECK(table.type() == BinTable::Type::VARIABLE);
+    CHECK(BinTable(chroms, 10).type() == BinTable::Type::FIXED);
+    CHECK(table.size() == 7);
+    CHECK(table.num_chromosomes() == 2);
+    CHECK(table.bin_size() == 0);
+    CHECK(table.num_bin_prefix_sum() == std::vector<std::uint64_t>{0, 4, 7});
+  }
+
+  SECTION("at") {
+    CHECK(table.at(0) == Bin{chr1, 0, 10});
+    CHECK(table.at(3) == Bin{chr1, 750, 1000});
+    CHECK(table.at(4) == Bin{chr2, 0, 1});
+    CHECK(table.at(6).start() == 499);
+    CHECK(table.at(chr1, 299) == Bin{chr1, 10, 300});
+    CHECK(table.at("chr2", 250).id() == 5);
+
+    CHECK_THROWS_AS(table.at(table.size()), std::out_of_range);
+  }
+
+  SECTION("coord to bin id") {
+    CHECK(table.map_to_bin_id(chr1, 0) == 0);
+    CHECK(table.map_to_bin_id(chr1, 9) == 0);
+    CHECK(table.map_to_bin_id(chr1, 10) == 1);
+    CHECK(table.map_to_bin_id(chr1, 999) == 3);
+    CHECK(table.map_to_bin_id(chr1, 1000) == 3);
+    CHECK(table.map_to_bin_id("chr2", 0) == 4);
+    CHECK(table.map_to_bin_id(1, 499) == 6);
+
+    CHECK_THROWS_AS(table.map_to_bin_id("chr1", 1001), std::out_of_range);
+  }
+
+  SECTION("coord to bin id (many bins)") {
+    // Bins of pseudo-random size, so that chromosomes span several blocks of the bin index
+    const ChromosomeSet chroms_{Chromosome{0, "chr1", 100'000}, Chromosome{1, "chr2", 777},
+                                Chromosome{2, "chr3", 54'321}};
+    std::vector<std::uint32_t> starts{};
+    std::vector<std::uint32_t> ends{};
+    std::uint32_t seed = 1;
+    for (const auto& chrom : chroms_) {
+      for (std::uint32_t pos = 0; pos < chrom.size();) {
+        seed = (seed * 1'103'515'245U) + 12'345U;
+        const auto end = (std::min)(pos + 1 + ((seed >> 16U) % 500), chrom.size());
+        starts.push_back(pos);
+        ends.push_back(end);
+        pos = end;
+      }
+    }
+    const BinTable table_(chroms_, starts, ends);
+    REQUIRE(table_.size() == starts.size());
+
+    std::uint64_t bin_id = 0;
+    for (const auto& chrom : table_.chromosomes()) {
+      for (std::uint32_t pos = 0; pos < chrom.size(); ++pos) {
+        if (pos == ends[bin_id]) {
+          ++bin_id;
+        }
+        REQUIRE(table_.map_to_bin_id(chrom, pos) == bin_id);
+      }
+      ++bin_id;
+    }
+    CHECK(bin_id == table_.size());
+  }
+
+  SECTION("subset") {
+    const BinTable expected{{chr1}, {0, 10, 300, 750}, {10, 300, 750, 1000}};
+
+    CHECK(table.subset("chr1") == expected);
+    CHECK(table.subset(chr1) == expected);
+    CHECK(table.subset("chr2") != expected);
+    CHECK(table.subset("chr1") != BinTable{{chr1}, 10});
+  }
+
+  SECTION("find overlap") {
+    auto its = table.find_overlap({chr1, 5, 11});
+    CHECK(std::distance(its.first, its.second) == 2);
+
+    its = table.find_overlap({chr1, 300, 750});
+    CHECK(std::distance(its.first, its.second) == 1);
+
+    its = table.find_overlap({chr2, 0, chr2.size()});
+    REQUIRE(std::distance(its.first, its.second) == 3);
+    CHECK(*its.first == Bin{chr2, 0, 1});
+  }
+
+  SECTION("iterators") {
+    // clang-format off
+    const std::array<Bin, 7> expected{
+       Bin{chr1, 0, 10},
+       Bin{chr1, 10, 300},
+       Bin{chr1, 300, 750},
+       Bin{chr1, 750, 1000},
+       Bin{chr2, 0, 1},
+       Bin{chr2, 1, 499},
+       Bin{chr2, 499, 500}
+    };
+    // clang-format on
+
+    auto first_bin = table.begin();
+    // NOLINTNEXTLINE
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+      CHECK(*first_bin++ == expected[i]);
+    }
+    CHECK(first_bin == table.end());
+    CHECK(*(table.end() - 3) == expected[4]);
+  }
+
+  SECTION("invalid bins") {
+    // gap
+    CHECK_THROWS_WITH(BinTable(chroms, {0, 20, 0}, {10, 1000, 500}),
+                      Catch::Matchers::ContainsSubstring("invalid bin #1"));
+    // bin extending past the end of the chromosome
+    CHECK_THROWS_WITH(BinTable(chroms, {0, 0}, {1001, 500}),
+                      Catch::Matchers::ContainsSubstring("invalid bin #0"));
+    // missing bins
+    CHECK_THROWS_WITH(BinTable(chroms, {0, 0}, {1000, 499}),
+                      Catch::Matchers::ContainsSubstring("bins do not cover chromosome chr2"));
+    // too many bins
+    CHECK_THROWS_WITH(BinTable(chroms, {0, 0, 500}, {1000, 500, 600}),
+                      Catch::Matchers::ContainsSubstring("1 bin(s) past the end"));
+    CHECK_THROWS_WITH(BinTable(chroms, {0}, {1000, 500}),
+                      Catch::Matchers::ContainsSubstring("different sizes"));
+  }
+}
+
 }  // namespace coolerpp::test::bin_table
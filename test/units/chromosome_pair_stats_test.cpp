@@ -0,0 +1,100 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include "coolerpp/chromosome_pair_stats.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include "coolerpp/chromosome.hpp"
+
+namespace coolerpp::test::chromosome_pair_stats {
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("ChromosomePairStats", "[chromosome][short]") {
+  const ChromosomeSet chroms{Chromosome{0, "chr1", 1000}, Chromosome{1, "chr2", 500},
+                             Chromosome{2, "chr3", 250}};
+
+  ChromosomePairStats stats(static_cast<std::uint32_t>(chroms.size()));
+  stats.add(0, 0, ContactStats{10, 3});
+  stats.add(0, 1, ContactStats{5, 2});
+  stats.add(1, 1, ContactStats{7, 1});
+  stats.add(0, 0, ContactStats{1, 1});
+  stats.add(2, 2, ContactStats{});
+
+  SECTION("accessors") {
+    CHECK(stats.num_chroms() == 3);
+    CHECK(stats.size() == 3);
+    CHECK(!stats.empty());
+    CHECK(ChromosomePairStats{}.empty());
+  }
+
+  SECTION("pairs") {
+    CHECK(stats.at(0, 0) == ContactStats{11, 4});
+    CHECK(stats.at(0, 1) == ContactStats{5, 2});
+    CHECK(stats.at(1, 0) == ContactStats{5, 2});
+    CHECK(stats.at(chroms.at("chr2"), chroms.at("chr2")) == ContactStats{7, 1});
+    CHECK(stats.at(0, 2) == ContactStats{});
+    CHECK(stats.at(2, 2) == ContactStats{});
+  }
+
+  SECTION("chromosomes") {
+    CHECK(stats.at(0) == ContactStats{16, 6});
+    CHECK(stats.at(chroms.at("chr2")) == ContactStats{12, 3});
+    CHECK(stats.at(2) == ContactStats{});
+  }
+
+  SECTION("totals") {
+    CHECK(stats.cis() == ContactStats{18, 5});
+    CHECK(stats.trans() == ContactStats{5, 2});
+    CHECK(stats.total() == ContactStats{23, 7});
+  }
+
+  SECTION("to_vector") {
+    const auto records = stats.to_vector();
+    REQUIRE(records.size() == 3);
+    CHECK(records[0].chrom1_id == 0);
+    CHECK(records[0].chrom2_id == 0);
+    CHECK(records[1].chrom1_id == 0);
+    CHECK(records[1].chrom2_id == 1);
+    CHECK(records[2].chrom1_id == 1);
+    CHECK(records[2].chrom2_id == 1);
+
+    ChromosomePairStats stats2(3);
+    for (const auto &r : records) {
+      stats2.add(r.chrom1_id, r.chrom2_id, r.stats);
+    }
+    CHECK(stats == stats2);
+    stats2.add(2, 2, ContactStats{1, 1});
+    CHECK(stats != stats2);
+  }
+
+  SECTION("accumulator") {
+    ChromosomePairStats stats2(3);
+    internal::ChromosomePairStatsAccumulator accumulator{stats2};
+    for (const auto &[chrom1_id, chrom2_id, count] :
+         std::vector<std::tuple<std::uint32_t, std::uint32_t, std::int32_t>>{
+             {0, 0, 5}, {0, 0, 5}, {0, 1, 5}, {1, 1, 7}, {0, 0, 1}}) {
+      accumulator.add(chrom1_id, chrom2_id, count);
+    }
+    CHECK(stats2.at(0, 0) == ContactStats{10, 2});
+    accumulator.flush();
+    CHECK(stats2.at(0, 0) == ContactStats{11, 3});
+    CHECK(stats2.at(0, 1) == ContactStats{5, 1});
+    CHECK(stats2.at(1, 1) == ContactStats{7, 1});
+  }
+
+  SECTION("invalid chromosome") {
+    CHECK_THROWS_WITH(stats.at(3), Catch::Matchers::ContainsSubstring("invalid chromosome id 3"));
+    CHECK_THROWS_WITH(stats.at(0, 3),
+                      Catch::Matchers::ContainsSubstring("invalid chromosome id 3"));
+    CHECK_THROWS_WITH(stats.add(3, 0, ContactStats{1, 1}),
+                      Catch::Matchers::ContainsSubstring("invalid chromosome id 3"));
+  }
+}
+
+}  // namespace coolerpp::test::chromosome_pair_stats
@@ -158,5 +158,22 @@ TEST_CASE("ChromosomeSet", "[chromosome][short]") {
     CHECK(chroms2.chromosome_with_longest_name().name() == "chr123");
     CHECK(chroms2.longest_chromosome().name() == "chr1");
   }
+
+  SECTION("copies share chromosomes") {
+    const ChromosomeSet chroms1(expected.begin(), expected.end());
+    Chromosome chrom{};
+    {
+      const auto chroms2 = chroms1;  // NOLINT(performance-unnecessary-copy-initialization)
+      CHECK(chroms1 == chroms2);
+      CHECK(&chroms1.at("chr2") == &chroms2.at("chr2"));
+      chrom = chroms2.at("chr3");
+    }
+    // Chromosomes remain valid after the ChromosomeSet they belong to is destroyed
+    CHECK(chrom == expected[2]);
+
+    // Chromosomes from the same set share the buffer with chromosome names
+    const ChromosomeSet chroms3{chroms1.at(0)};
+    CHECK(chroms3.begin()->name().data() == chroms1.at(0).name().data());
+  }
 }
 }  // namespace coolerpp::test::chromosome
@@ -4,13 +4,23 @@
 
 #include "coolerpp/dataset.hpp"
 
+#include <algorithm>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_string.hpp>
+#include <cstdint>
 #include <filesystem>
+#include <future>
+#include <numeric>
 #include <random>
 #include <set>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
 
+#include "coolerpp/chunk_cache.hpp"
 #include "coolerpp/group.hpp"
+#include "coolerpp/internal/buffer_pool.hpp"
 #include "coolerpp/test/self_deleting_folder.hpp"
 
 namespace coolerpp::test {
@@ -37,6 +47,19 @@ TEST_CASE("Dataset: read", "[dataset][short]") {
       }
     }
 
+    SECTION("string_view") {
+      constexpr std::array<std::string_view, 3> expected{"2", "3", "4"};
+      std::vector<std::string_view> buff{};
+      std::string arena{};
+
+      Dataset{grp, "chroms/name"}.read(buff, arena, expected.size(), 1);
+      REQUIRE(buff.size() == 3);
+
+      for (std::size_t i = 0; i < expected.size(); ++i) {
+        CHECK(buff[i] == expected[i]);
+      }
+    }
+
     SECTION("atomic") {
       const Dataset dset{grp, "chroms/name"};
       std::string buff;
@@ -69,6 +92,30 @@ TEST_CASE("Dataset: read", "[dataset][short]") {
       CHECK(std::accumulate(buff.begin(), buff.end(), 0) == sum_expected);
     }
 
+    SECTION("vector<T> with conversion") {
+      std::vector<double> buff1{};
+      std::ignore = Dataset{grp, "bins/start"}.read(buff1, expected.size());
+      std::vector<std::uint64_t> buff2{};
+      std::ignore = Dataset{grp, "bins/start"}.read(buff2, expected.size());
+
+      REQUIRE(buff1.size() == expected.size());
+      REQUIRE(buff2.size() == expected.size());
+      for (std::size_t i = 0; i < expected.size(); ++i) {
+        CHECK(buff1[i] == static_cast<double>(expected[i]));
+        CHECK(buff2[i] == static_cast<std::uint64_t>(expected[i]));
+      }
+
+      std::vector<double> counts{};
+      Dataset{grp, "pixels/count"}.read_all(counts);
+      CHECK(counts.size() == nnz_expected);
+      CHECK(std::accumulate(counts.begin(), counts.end(), 0.0) == sum_expected);
+
+      // Values that do not fit in the buffer type are clamped
+      std::vector<std::uint16_t> buff3{};
+      Dataset{grp, "chroms/length"}.read_all(buff3);
+      CHECK(std::all_of(buff3.begin(), buff3.end(), [](auto n) { return n == 65'535; }));
+    }
+
     SECTION("variant buff") {
       internal::VariantBuffer vbuff{std::size_t(0), 0.0};
       std::ignore = Dataset{grp, "bins/start"}.read(vbuff, expected.size());
@@ -222,6 +269,361 @@ TEST_CASE("Dataset: accessors", "[dataset][short]") {
   CHECK(dset.hdf5_path() == "/chroms/name");
 }
 
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Dataset: parallel decompression", "[dataset][short]") {
+  const auto path = datadir / "cooler_test_file.cool";
+
+  const RootGroup grp{HighFive::File(path.string()).getGroup("/")};
+  Dataset dset(grp, "/pixels/bin2_id");
+
+  std::vector<std::uint64_t> expected;
+  dset.read_all(expected);
+  REQUIRE(expected.size() == 107'041);
+
+  dset.set_decompression_threads(4);
+  CHECK(dset.decompression_threads() == 4);
+
+  SECTION("read all") {
+    std::vector<std::uint64_t> buff;
+    dset.read_all(buff);
+    CHECK(buff == expected);
+  }
+
+  SECTION("read with offset") {
+    std::vector<std::uint64_t> buff;
+    constexpr std::size_t offset = 12'345;
+    constexpr std::size_t num = 54'321;
+    dset.read(buff, num, offset);
+    REQUIRE(buff.size() == num);
+    CHECK(std::equal(buff.begin(), buff.end(), expected.begin() + offset));
+  }
+
+  SECTION("iteration") {
+    auto it = dset.begin<std::uint64_t>();
+    for (const auto& n : expected) {
+      CHECK(*it++ == n);
+    }
+    CHECK(it == dset.end<std::uint64_t>());
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Dataset: fetch and decode chunks", "[dataset][short]") {
+  const auto path = datadir / "cooler_test_file.cool";
+
+  const RootGroup grp{HighFive::File(path.string()).getGroup("/")};
+  const Dataset dset(grp, "/pixels/bin2_id");
+
+  std::vector<std::int64_t> expected;
+  dset.read_all(expected);
+  REQUIRE(expected.size() == 107'041);
+
+  constexpr std::size_t offset = 12'345;
+  constexpr std::size_t num = 54'321;
+  internal::RawChunks chunks{};
+
+  SECTION("native type") {
+    REQUIRE(dset.fetch_chunks<std::int64_t>(chunks, num, offset));
+    std::vector<std::int64_t> buff;
+    dset.decode_chunks(chunks, buff, 4);
+    REQUIRE(buff.size() == num);
+    CHECK(std::equal(buff.begin(), buff.end(), expected.begin() + offset));
+  }
+
+  SECTION("with conversion") {
+    REQUIRE(dset.fetch_chunks<double>(chunks, num, offset));
+    std::vector<double> buff;
+    dset.decode_chunks(chunks, buff);
+    REQUIRE(buff.size() == num);
+    for (std::size_t i = 0; i < num; ++i) {
+      CHECK(buff[i] == static_cast<double>(expected[offset + i]));
+    }
+  }
+
+  SECTION("empty range") {
+    REQUIRE(dset.fetch_chunks<std::int64_t>(chunks, 0, offset));
+    std::vector<std::int64_t> buff{1, 2, 3};
+    dset.decode_chunks(chunks, buff);
+    CHECK(buff.empty());
+  }
+
+  SECTION("out of bound access") {
+    CHECK_THROWS(dset.fetch_chunks<std::int64_t>(chunks, 10, expected.size()));
+  }
+
+  SECTION("bypassing libhdf5") {
+    CHECK_FALSE(dset.reads_bypass_hdf5<std::int64_t>());
+    auto dset2 = dset;
+    if (dset2.enable_direct_reads()) {
+      CHECK(dset2.reads_bypass_hdf5<std::int64_t>());
+      CHECK(dset2.reads_bypass_hdf5<double>());
+    }
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Dataset: direct reads", "[dataset][short]") {
+  const auto path = datadir / "cooler_test_file.cool";
+
+  const RootGroup grp{HighFive::File(path.string()).getGroup("/")};
+  const Dataset expected_dset(grp, "/pixels/count");
+  Dataset dset(grp, "/pixels/count");
+
+  std::vector<std::int32_t> expected;
+  expected_dset.read_all(expected);
+  REQUIRE(expected.size() == 107'041);
+
+  CHECK(!dset.direct_reads_enabled());
+  REQUIRE(dset.enable_direct_reads());
+  CHECK(dset.direct_reads_enabled());
+  CHECK(dset.size() == expected.size());
+
+  SECTION("read all") {
+    std::vector<std::int32_t> buff;
+    dset.read_all(buff);
+    CHECK(buff == expected);
+  }
+
+  SECTION("read with offset") {
+    std::vector<std::int32_t> buff;
+    constexpr std::size_t offset = 12'345;
+    constexpr std::size_t num = 54'321;
+    dset.read(buff, num, offset);
+    REQUIRE(buff.size() == num);
+    CHECK(std::equal(buff.begin(), buff.end(), expected.begin() + offset));
+  }
+
+  SECTION("read with conversion") {
+    std::vector<double> buff;
+    dset.read(buff, 1000, 100);
+    REQUIRE(buff.size() == 1000);
+    CHECK(std::equal(buff.begin(), buff.end(), expected.begin() + 100,
+                     [](double n1, std::int32_t n2) { return n1 == static_cast<double>(n2); }));
+  }
+
+  SECTION("prefetch") {
+    // Chunks stored using the requested type are prefetched without going through libhdf5
+    auto it = dset.begin<std::int32_t, 1000>(true);
+    CHECK(it.prefetch_enabled());
+    CHECK(dset.begin<double, 1000>(true).prefetch_enabled() ==
+          internal::hdf5_library_is_threadsafe());
+    CHECK_FALSE(dset.begin<std::int32_t, 1000>().prefetch_enabled());
+
+    const auto last = dset.end<std::int32_t, 1000>();
+    for (const auto& n : expected) {
+      REQUIRE(it != last);
+      CHECK(*it++ == n);
+    }
+    CHECK(it == last);
+  }
+
+  SECTION("concurrent reads") {
+    constexpr std::size_t num_threads = 4;
+    std::vector<std::future<bool>> workers{};
+    for (std::size_t i = 0; i < num_threads; ++i) {
+      workers.emplace_back(std::async(std::launch::async, [&, i]() {
+        const auto first = (expected.size() * i) / num_threads;
+        const auto last = (expected.size() * (i + 1)) / num_threads;
+        return std::equal(dset.begin<std::int32_t>() + first, dset.begin<std::int32_t>() + last,
+                          expected.begin() + std::ptrdiff_t(first));
+      }));
+    }
+    for (auto& w : workers) {
+      CHECK(w.get());
+    }
+  }
+
+  SECTION("out of bound access") {
+    std::vector<std::int32_t> buff;
+    CHECK_THROWS(dset.read(buff, 10, expected.size()));
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Dataset: chunk cache", "[dataset][short]") {
+  const auto path = datadir / "cooler_test_file.cool";
+  auto& cache = ChunkCache::instance();
+  constexpr std::size_t chunk_size = 1000;
+  constexpr std::size_t chunk_size_bytes = chunk_size * sizeof(std::uint64_t);
+
+  const RootGroup grp{HighFive::File(path.string()).getGroup("/")};
+  const Dataset dset(grp, "/pixels/bin2_id");
+  REQUIRE(dset.chunk_cache_enabled());
+
+  std::vector<std::uint64_t> expected;
+  dset.read_all(expected);
+
+  auto check_iterator = [&](auto it) {
+    for (const auto& n : expected) {
+      CHECK(*it++ == n);
+    }
+    CHECK(it == dset.end<std::uint64_t, chunk_size>());
+  };
+
+  SECTION("disabled") {
+    cache.set_capacity(0);
+    cache.reset_stats();
+    check_iterator(dset.begin<std::uint64_t, chunk_size>());
+    const auto stats = cache.stats();
+    CHECK(stats.hits == 0);
+    CHECK(stats.misses == 0);
+    CHECK(stats.num_blocks == 0);
+  }
+
+  SECTION("enabled") {
+    const auto num_chunks = (expected.size() + chunk_size - 1) / chunk_size;
+    cache.set_capacity(num_chunks * chunk_size_bytes);
+    cache.clear();
+    cache.reset_stats();
+
+    check_iterator(dset.begin<std::uint64_t, chunk_size>());
+    auto stats = cache.stats();
+    CHECK(stats.hits == 0);
+    CHECK(stats.misses == num_chunks);
+    CHECK(stats.num_blocks == num_chunks);
+    CHECK(stats.size_bytes == expected.size() * sizeof(std::uint64_t));
+
+    // Blocks are shared by iterators traversing other Dataset instances
+    const RootGroup grp2{HighFive::File(path.string()).getGroup("/")};
+    const Dataset dset2(grp2, "/pixels/bin2_id");
+    auto it = dset2.begin<std::uint64_t, chunk_size>();
+    for (const auto& n : expected) {
+      CHECK(*it++ == n);
+    }
+    stats = cache.stats();
+    CHECK(stats.hits == num_chunks);
+    CHECK(stats.misses == num_chunks);
+
+    // Least recently used blocks are evicted first
+    cache.set_capacity(2 * chunk_size_bytes);
+    stats = cache.stats();
+    CHECK(stats.num_blocks == 2);
+    CHECK(stats.size_bytes <= 2 * chunk_size_bytes);
+    cache.reset_stats();
+    std::ignore = *dset.make_iterator_at_offset<std::uint64_t, chunk_size>(0);
+    CHECK(cache.stats().misses == 1);
+
+    cache.clear();
+    CHECK(cache.stats().num_blocks == 0);
+    cache.set_capacity(0);
+  }
+
+  SECTION("read-write files are not cached") {
+    const auto path2 = testdir() / "dataset_chunk_cache.h5";
+    const RootGroup grp2{HighFive::File(path2.string(), HighFive::File::Truncate).getGroup("/")};
+    const Dataset dset2(grp2, "int", std::uint64_t{});
+    CHECK_FALSE(dset2.chunk_cache_enabled());
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Dataset: buffer pool", "[dataset][short]") {
+  auto& pool = internal::BufferPool<std::uint64_t>::local();
+  pool.clear();
+
+  SECTION("acquire") {
+    auto buff1 = pool.acquire(10);
+    CHECK(buff1->capacity() >= 10);
+    CHECK(pool.size() == 1);
+
+    // Buffers that are not shared are returned as is
+    const auto* ptr = buff1.get();
+    buff1 = pool.acquire(20, std::move(buff1));
+    CHECK(buff1.get() == ptr);
+    CHECK(buff1->capacity() >= 20);
+
+    // Shared buffers are replaced
+    auto buff2 = buff1;
+    buff2 = pool.acquire(10, std::move(buff2));
+    CHECK(buff2 != buff1);
+    CHECK(pool.size() == 2);
+
+    // Released buffers are reused
+    const auto* ptr2 = buff2.get();
+    buff2.reset();
+    CHECK(pool.acquire(10).get() == ptr2);
+    CHECK(pool.size() == 2);
+
+    pool.set_max_size(1);
+    CHECK(pool.size() == 1);
+    auto buff3 = pool.acquire(10);
+    auto buff4 = pool.acquire(10);
+    CHECK(buff3 != buff4);
+    CHECK(pool.size() == 1);
+    pool.set_max_size(internal::BufferPool<std::uint64_t>::DEFAULT_MAX_SIZE);
+  }
+
+  SECTION("iterator copies") {
+    const auto path = datadir / "cooler_test_file.cool";
+    constexpr std::size_t chunk_size = 1000;
+    ChunkCache::instance().set_capacity(0);
+
+    const RootGroup grp{HighFive::File(path.string()).getGroup("/")};
+    const Dataset dset(grp, "/pixels/bin2_id");
+    std::vector<std::uint64_t> expected;
+    dset.read_all(expected);
+    REQUIRE(expected.size() > 10 * chunk_size);
+
+    const auto it = dset.begin<std::uint64_t, chunk_size>();
+    CHECK(pool.size() == 1);
+    for (std::size_t i = 1; i < 10; ++i) {
+      auto it2 = it;
+      it2 += i * chunk_size;
+      CHECK(*it2 == expected[i * chunk_size]);
+      // Copies read new blocks into the same pooled buffer
+      CHECK(pool.size() == 2);
+    }
+    CHECK(*it == expected.front());
+  }
+
+  pool.clear();
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Dataset: adaptive block size", "[dataset][short]") {
+  const auto path = datadir / "cooler_test_file.cool";
+  constexpr std::size_t chunk_size = 1000;
+  ChunkCache::instance().set_capacity(0);
+
+  const RootGroup grp{HighFive::File(path.string()).getGroup("/")};
+  const Dataset dset(grp, "/pixels/bin2_id");
+  std::vector<std::uint64_t> expected;
+  dset.read_all(expected);
+
+  SECTION("forward") {
+    auto it = dset.make_iterator_at_offset<std::uint64_t, chunk_size>(0, false, 10);
+    CHECK(it.block_size() == 10);
+    CHECK(it.underlying_buff()->size() == 10);
+
+    for (const auto& n : expected) {
+      CHECK(*it++ == n);
+    }
+    CHECK(it == dset.end<std::uint64_t, chunk_size>());
+    // Blocks grow geometrically up to CHUNK_SIZE
+    CHECK(it.block_size() == chunk_size);
+  }
+
+  SECTION("backward") {
+    auto it = dset.make_iterator_at_offset<std::uint64_t, chunk_size>(2500, false, 10);
+    for (std::size_t i = 2500; i != 0; --i) {
+      CHECK(*(--it) == expected[i - 1]);
+    }
+  }
+
+  SECTION("block size is capped") {
+    const auto it = dset.make_iterator_at_offset<std::uint64_t, chunk_size>(0, false, 5000);
+    CHECK(it.block_size() == chunk_size);
+    CHECK(dset.make_iterator_at_offset<std::uint64_t, chunk_size>(0).block_size() == chunk_size);
+  }
+
+  SECTION("helper") {
+    CHECK(internal::adaptive_block_size(0, chunk_size) ==
+          DEFAULT_HDF5_DATASET_ITERATOR_MIN_BUFFER_SIZE);
+    CHECK(internal::adaptive_block_size(500, chunk_size) == 500);
+    CHECK(internal::adaptive_block_size(5000, chunk_size) == chunk_size);
+  }
+}
+
 // NOLINTNEXTLINE(readability-function-cognitive-complexity)
 TEST_CASE("Dataset: linear iteration", "[dataset][long]") {
   const auto path = datadir / "cooler_test_file.cool";
@@ -245,6 +647,18 @@ TEST_CASE("Dataset: linear iteration", "[dataset][long]") {
     CHECK(it == last_pixel);
   }
 
+  SECTION("forward with prefetching") {
+    auto it = dset.begin<std::uint32_t, 1000>(true);
+    auto last_pixel = dset.end<std::uint32_t, 1000>();
+    REQUIRE(std::distance(it, last_pixel) == 107'041);
+
+    for (const auto& expected : pixel_buff) {
+      REQUIRE(it != last_pixel);
+      CHECK(*it++ == expected);
+    }
+    CHECK(it == last_pixel);
+  }
+
   SECTION("backward") {
     auto it = dset.end<std::uint32_t>();
     auto first_pixel = dset.begin<std::uint32_t>();
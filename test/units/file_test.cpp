@@ -2,13 +2,26 @@
 //
 // SPDX-License-Identifier: MIT
 
+#include <H5Dpublic.h>
+#include <H5Ppublic.h>
+#include <H5Zpublic.h>
 #include <fmt/format.h>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_string.hpp>
 #include <filesystem>
+#include <iterator>
+#include <limits>
+#include <mutex>
 #include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include "coolerpp/coolerpp.hpp"
 #include "coolerpp/test/self_deleting_folder.hpp"
@@ -65,6 +78,24 @@ TEST_CASE("Coolerpp: format checking", "[cooler][short]") {
     CHECK(utils::is_cooler(path.string() + suffix));
   }
 
+  SECTION("validation options") {
+    const auto mcool = (datadir / "multires_cooler_test_file.mcool").string();
+    const auto scool = (datadir / "single_cell_cooler_test_file.scool").string();
+
+    utils::ValidationOptions opts{};
+    CHECK(utils::is_multires_file(mcool, opts));
+    CHECK(utils::is_scool_file(scool, opts));
+
+    opts.stop_at_first_failure = true;
+    opts.sample_size = 2;
+    CHECK(utils::is_multires_file(mcool, opts));
+    const auto status = utils::is_scool_file(scool, opts);
+    CHECK(status);
+    CHECK(status.invalid_cells.empty());
+
+    CHECK(!utils::is_scool_file(mcool, opts));
+  }
+
   SECTION("test with empty .h5 file") {
     const auto path = datadir / "empty_test_file.h5";
     CHECK(!utils::is_cooler(path.string()));
@@ -263,6 +294,25 @@ TEST_CASE("Coolerpp: file ctors", "[cooler][short]") {
       CHECK(std::distance(f.begin<std::int32_t>(), f.end<std::int32_t>()) == 107041);
     }
   }
+
+  SECTION("open trusted .cool") {
+    const auto path = datadir / "cooler_test_file.cool";
+    const auto f = File::open_read_only_trusted(path.string());
+
+    CHECK(f.bins().size() == 26'398);
+    CHECK_NOTHROW(f.validate());
+    CHECK(std::distance(f.begin<std::int32_t>(), f.end<std::int32_t>()) == 107041);
+
+    const auto sel1 = f.fetch<std::int32_t>("1:5000000-6500000");
+    const auto sel2 = File::open_read_only(path.string()).fetch<std::int32_t>("1:5000000-6500000");
+    CHECK(std::equal(sel1.begin(), sel1.end(), sel2.begin(), sel2.end()));
+  }
+
+  SECTION("open trusted corrupted .cool") {
+    const auto path = datadir / "invalid_coolers/corrupted_bins.cool";
+    CHECK_THROWS_WITH(File::open_read_only_trusted(path.string()),
+                      Catch::Matchers::ContainsSubstring("Datasets have inconsistent sizes"));
+  }
 }
 
 // NOLINTNEXTLINE(readability-function-cognitive-complexity)
@@ -445,6 +495,34 @@ TEST_CASE("Coolerpp: read/write bin table", "[cooler][short]") {
   CHECK(end_it == f.dataset("bins/end").end<std::uint32_t>());
 }
 
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Coolerpp: validate bin table", "[cooler][short]") {
+  const auto path = (testdir() / "test_validate_bin_table.cool").string();
+
+  const ChromosomeSet chroms{Chromosome{0, "chr1", 50001}, Chromosome{1, "chr2", 25017},
+                             Chromosome{2, "chr3", 10000}};
+  constexpr std::uint32_t bin_size = 5000;
+
+  { auto f = File::create_new_cooler(path, chroms, bin_size, true); }
+  CHECK_NOTHROW(File::open_read_only(path));
+
+  {
+    // Corrupt the end of the second bin of chr2
+    HighFive::File h5f(path, HighFive::File::ReadWrite);
+    auto dset = h5f.getDataSet("/bins/end");
+    std::vector<std::int32_t> ends{};
+    dset.read(ends);
+    REQUIRE(ends.size() == 19);
+    ++ends[12];
+    dset.write(ends);
+  }
+
+  CHECK_THROWS_WITH(File::open_read_only(path),
+                    Catch::Matchers::ContainsSubstring("GenomicInterval #12") &&
+                        Catch::Matchers::ContainsSubstring("chr2:5000-10001"));
+  CHECK_NOTHROW(File::open_read_only_trusted(path));
+}
+
 // NOLINTNEXTLINE(readability-function-cognitive-complexity)
 TEST_CASE("Coolerpp: read/write pixels", "[cooler][long]") {
   auto path1 = datadir / "cooler_test_file.cool";
@@ -531,6 +609,1061 @@ TEST_CASE("Coolerpp: read/write pixels", "[cooler][long]") {
   }
 }
 
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Coolerpp: write pixels in columnar form", "[cooler][short]") {
+  auto path1 = datadir / "cooler_test_file.cool";
+  auto path2 = testdir() / "cooler_test_write_pixel_columns.cool";
+
+  using T = std::int32_t;
+  auto f1 = File::open_read_only(path1.string());
+  const auto bin1_ids = f1.dataset("pixels/bin1_id").read_all<std::vector<std::uint64_t>>();
+  const auto bin2_ids = f1.dataset("pixels/bin2_id").read_all<std::vector<std::uint64_t>>();
+  const auto counts = f1.dataset("pixels/count").read_all<std::vector<T>>();
+  REQUIRE(bin1_ids.size() == 107041);
+
+  {
+    auto f2 = File::create_new_cooler<T>(path2.string(), f1.chromosomes(), f1.bin_size(), true);
+    constexpr std::size_t offset = 25'000;
+    f2.append_pixels_columns(bin1_ids.data(), bin2_ids.data(), counts.data(), offset, true);
+    f2.append_pixels_columns(bin1_ids.data() + offset, bin2_ids.data() + offset,
+                             counts.data() + offset, bin1_ids.size() - offset, true);
+
+    SECTION("invalid pixels") {
+      CHECK_THROWS_WITH(f2.append_pixels_columns(bin1_ids.data(), bin2_ids.data(),
+                                                 counts.data(), 1, true),
+                        Catch::Matchers::ContainsSubstring("upstream"));
+    }
+  }
+
+  auto f2 = File::open_read_only(path2.string());
+  const std::vector<Pixel<T>> expected(f1.begin<T>(), f1.end<T>());
+  const std::vector<Pixel<T>> pixels(f2.begin<T>(), f2.end<T>());
+  REQUIRE(pixels.size() == expected.size());
+  for (std::size_t i = 0; i < pixels.size(); ++i) {
+    CHECK(pixels[i] == expected[i]);
+  }
+
+  CHECK(f1.dataset("indexes/bin1_offset").read_all<std::vector<std::uint64_t>>() ==
+        f2.dataset("indexes/bin1_offset").read_all<std::vector<std::uint64_t>>());
+  CHECK(f1.attributes().nnz == f2.attributes().nnz);
+  CHECK(f1.attributes().sum == f2.attributes().sum);
+  CHECK(f2.attributes().cis == StandardAttributes::SumVar(std::int64_t(329276)));
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Coolerpp: append invalid pixels", "[cooler][short]") {
+  const ChromosomeSet chroms{Chromosome{0, "chr1", 10000}, Chromosome{1, "chr2", 5000}};
+  const auto path = testdir() / "cooler_test_append_invalid_pixels.cool";
+
+  using T = std::int32_t;
+  // clang-format off
+  const std::vector<ThinPixel<T>> pixels{
+      {0, 0, 1}, {0, 1, 2}, {1, 12, 3},
+      {1, 5, 4},  // unsorted
+      {2, 3, 5}};
+  // clang-format on
+
+  SECTION("pixels preceding the invalid pixel are written") {
+    {
+      auto f = File::create_new_cooler<T>(path.string(), chroms, 1000, true);
+      CHECK_THROWS_WITH(f.append_pixels(pixels.begin(), pixels.end(), true),
+                        Catch::Matchers::ContainsSubstring("not sorted"));
+      CHECK(f.attributes().nnz == 3);
+      CHECK(f.attributes().sum == StandardAttributes::SumVar(std::int64_t(6)));
+      CHECK(f.attributes().cis == StandardAttributes::SumVar(std::int64_t(3)));
+    }
+    const auto f = File::open_read_only(path.string());
+    const auto sel = f.fetch<T>();
+    const std::vector<ThinPixel<T>> written(sel.begin_thin(), sel.end_thin());
+    CHECK(written == std::vector<ThinPixel<T>>(pixels.begin(), pixels.begin() + 3));
+  }
+
+  SECTION("pixels with no interactions") {
+    auto f = File::create_new_cooler<T>(path.string(), chroms, 1000, true);
+    const std::vector<Pixel<T>> invalid{Pixel<T>{f.bins(), 0, 1, 1}, Pixel<T>{f.bins(), 0, 2, 0}};
+    CHECK_THROWS_WITH(f.append_pixels(invalid.begin(), invalid.end()),
+                      Catch::Matchers::ContainsSubstring("0 interactions"));
+    CHECK(f.attributes().nnz == 1);
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Coolerpp: files kept in memory", "[cooler][short]") {
+  auto path1 = datadir / "cooler_test_file.cool";
+  auto path2 = testdir() / "cooler_test_in_memory.cool";
+
+  using T = std::int32_t;
+  auto f1 = File::open_read_only(path1.string());
+  const std::vector<Pixel<T>> expected(f1.begin<T>(), f1.end<T>());
+
+  WriterOptions options{};
+  options.in_memory = InMemoryOptions{};
+
+  SECTION("round-trip through a memory buffer") {
+    std::filesystem::remove(path2);
+    auto f2 = File::create_new_cooler<T>(path2.string(), f1.chromosomes(), f1.bin_size(), false,
+                                         StandardAttributes::init<T>(f1.bin_size()),
+                                         DEFAULT_HDF5_CACHE_SIZE, options);
+    f2.append_pixels(expected.begin(), expected.end());
+    const auto buff = f2.close_to_buffer();
+    CHECK(!std::filesystem::exists(path2));
+    REQUIRE(!buff.empty());
+
+    const auto f3 = File::open_read_only_from_buffer(buff.data(), buff.size());
+    CHECK(f3.chromosomes() == f1.chromosomes());
+    CHECK(f3.attributes().nnz == f1.attributes().nnz);
+    CHECK(f3.attributes().sum == f1.attributes().sum);
+    const std::vector<Pixel<T>> pixels(f3.begin<T>(), f3.end<T>());
+    REQUIRE(pixels.size() == expected.size());
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+      CHECK(pixels[i] == expected[i]);
+    }
+  }
+
+  SECTION("backing store") {
+    options.in_memory->backing_store = true;
+    {
+      auto f2 = File::create_new_cooler<T>(path2.string(), f1.chromosomes(), f1.bin_size(), true,
+                                           StandardAttributes::init<T>(f1.bin_size()),
+                                           DEFAULT_HDF5_CACHE_SIZE, options);
+      f2.append_pixels(expected.begin(), expected.end());
+    }
+    REQUIRE(std::filesystem::exists(path2));
+    auto f2 = File::open_read_only(path2.string());
+    CHECK(f2.attributes().nnz == f1.attributes().nnz);
+    CHECK(std::distance(f2.begin<T>(), f2.end<T>()) == std::distance(f1.begin<T>(), f1.end<T>()));
+  }
+
+  SECTION("invalid buffers") {
+    const std::vector<std::byte> buff(1024, std::byte{0});
+    CHECK_THROWS(File::open_read_only_from_buffer(buff.data(), buff.size()));
+  }
+
+  SECTION("nested coolers") {
+    CHECK_THROWS_WITH(File::create_new_cooler<T>(
+                          fmt::format(FMT_STRING("{}::/resolutions/10"), path2.string()),
+                          f1.chromosomes(), f1.bin_size(), true,
+                          StandardAttributes::init<T>(f1.bin_size()), DEFAULT_HDF5_CACHE_SIZE,
+                          options),
+                      Catch::Matchers::ContainsSubstring("kept in memory is not supported"));
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Coolerpp: SWMR", "[cooler][short]") {
+  auto path1 = datadir / "cooler_test_file.cool";
+  auto path2 = testdir() / "cooler_test_swmr.cool";
+
+  using T = std::int32_t;
+  auto f1 = File::open_read_only(path1.string());
+  const std::vector<Pixel<T>> expected(f1.begin<T>(), f1.end<T>());
+  REQUIRE(expected.size() > 1);
+
+  WriterOptions options{};
+  options.swmr = SWMROptions{0};
+
+  SECTION("read while writing") {
+    auto f2 = File::create_new_cooler<T>(path2.string(), f1.chromosomes(), f1.bin_size(), true,
+                                         StandardAttributes::init<T>(f1.bin_size()),
+                                         DEFAULT_HDF5_CACHE_SIZE, options);
+    {
+      const auto f3 = File::open_read_only_swmr(path2.string());
+      CHECK(f3.bins() == f1.bins());
+      CHECK(f3.attributes().nnz == 0);
+      CHECK(std::distance(f3.begin<T>(), f3.end<T>()) == 0);
+    }
+
+    const auto mid = expected.begin() + std::ptrdiff_t(expected.size() / 2);
+    f2.append_pixels(expected.begin(), mid);
+    f2.flush();
+
+    // Only rows preceding the row of the last pixel written are visible
+    const auto last_row = (mid - 1)->coords.bin1.id();
+    const auto expected_nnz = std::distance(
+        expected.begin(), std::find_if(expected.begin(), mid, [&](const Pixel<T> &p) {
+          return p.coords.bin1.id() == last_row;
+        }));
+    {
+      const auto f3 = File::open_read_only_swmr(path2.string());
+      CHECK(f3.attributes().nnz == expected_nnz);
+      const std::vector<Pixel<T>> pixels(f3.begin<T>(), f3.end<T>());
+      REQUIRE(pixels.size() == static_cast<std::size_t>(expected_nnz));
+      for (std::size_t i = 0; i < pixels.size(); ++i) {
+        CHECK(pixels[i] == expected[i]);
+      }
+    }
+
+    f2.append_pixels(mid, expected.end());
+    f2.close();
+
+    const auto f3 = File::open_read_only(path2.string());
+    CHECK(f3.attributes().nnz == f1.attributes().nnz);
+    CHECK(f3.attributes().sum == f1.attributes().sum);
+    const std::vector<Pixel<T>> pixels(f3.begin<T>(), f3.end<T>());
+    REQUIRE(pixels.size() == expected.size());
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+      CHECK(pixels[i] == expected[i]);
+    }
+  }
+
+  SECTION("invalid options") {
+    options.threads = 2;
+    CHECK_THROWS_WITH(File::create_new_cooler<T>(path2.string(), f1.chromosomes(), f1.bin_size(),
+                                                 true, StandardAttributes::init<T>(f1.bin_size()),
+                                                 DEFAULT_HDF5_CACHE_SIZE, options),
+                      Catch::Matchers::ContainsSubstring("SWMR mode does not support"));
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Coolerpp: resume from checkpoint", "[cooler][short]") {
+  auto path1 = datadir / "cooler_test_file.cool";
+  auto path2 = testdir() / "cooler_test_checkpoint.cool";
+  auto path3 = testdir() / "cooler_test_checkpoint_crashed.cool";
+
+  using T = std::int32_t;
+  auto f1 = File::open_read_only(path1.string());
+  const std::vector<Pixel<T>> expected(f1.begin<T>(), f1.end<T>());
+  REQUIRE(expected.size() > 2);
+
+  WriterOptions options{};
+  options.checkpoint = CheckpointOptions{0};
+  options.compute_chromosome_pair_stats = true;
+  options.compute_bin_marginals = true;
+
+  SECTION("resume from checkpoint") {
+    const auto mid1 = expected.begin() + std::ptrdiff_t(expected.size() / 3);
+    const auto mid2 = expected.begin() + std::ptrdiff_t(2 * expected.size() / 3);
+    {
+      auto f2 = File::create_new_cooler<T>(path2.string(), f1.chromosomes(), f1.bin_size(), true,
+                                           StandardAttributes::init<T>(f1.bin_size()),
+                                           DEFAULT_HDF5_CACHE_SIZE, options);
+      f2.append_pixels(expected.begin(), mid1);
+      f2.checkpoint();
+      f2.append_pixels(mid1, mid2);
+      f2.flush();
+      // Simulate a crash by taking a snapshot of the file before it is closed
+      std::filesystem::copy_file(path2, path3, std::filesystem::copy_options::overwrite_existing);
+    }
+
+    auto f3 = File::resume(path3.string(), DEFAULT_HDF5_CACHE_SIZE, options);
+    CHECK(f3.attributes().nnz == std::distance(expected.begin(), mid1));
+    f3.append_pixels(mid1, expected.end(), true);
+    f3.close();
+
+    const auto f4 = File::open_read_only(path3.string());
+    CHECK(f4.attributes().nnz == f1.attributes().nnz);
+    CHECK(f4.attributes().sum == f1.attributes().sum);
+    CHECK(f4.attributes().cis == f1.attributes().cis);
+    CHECK(!HighFive::File(path3.string(), HighFive::File::ReadOnly)
+               .exist(std::string{internal::CHECKPOINT_GROUP_NAME}));
+    {
+      // Reference cooler holding every pixel
+      auto f5 = File::create_new_cooler<T>(path2.string(), f1.chromosomes(), f1.bin_size(), true,
+                                           StandardAttributes::init<T>(f1.bin_size()),
+                                           DEFAULT_HDF5_CACHE_SIZE, options);
+      f5.append_pixels(expected.begin(), expected.end());
+    }
+    const auto reference = File::open_read_only(path2.string());
+    CHECK(f4.read_chromosome_pair_stats() == reference.read_chromosome_pair_stats());
+    CHECK(*f4.read_bin_marginal_sum() == *reference.read_bin_marginal_sum());
+    CHECK(*f4.read_bin_marginal_nnz() == *reference.read_bin_marginal_nnz());
+    // The index is restored from the checkpoint instead of being rebuilt from the pixels
+    const auto &chrom = f1.chromosomes().at(0);
+    const auto sel1 = f4.fetch<T>(chrom.name());
+    const auto sel2 = reference.fetch<T>(chrom.name());
+    CHECK(std::vector<Pixel<T>>(sel1.begin(), sel1.end()) ==
+          std::vector<Pixel<T>>(sel2.begin(), sel2.end()));
+    const std::vector<Pixel<T>> pixels(f4.begin<T>(), f4.end<T>());
+    REQUIRE(pixels.size() == expected.size());
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+      CHECK(pixels[i] == expected[i]);
+    }
+  }
+
+  SECTION("files without checkpoints") {
+    File::create_new_cooler<T>(path2.string(), f1.chromosomes(), f1.bin_size(), true,
+                               StandardAttributes::init<T>(f1.bin_size()))
+        .append_pixels(expected.begin(), expected.end());
+    CHECK_THROWS_WITH(File::resume(path2.string()),
+                      Catch::Matchers::ContainsSubstring("there is nothing to resume"));
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Coolerpp: append to existing files", "[cooler][short]") {
+  auto path1 = datadir / "cooler_test_file.cool";
+  auto path2 = testdir() / "cooler_test_append.cool";
+
+  using T = std::int32_t;
+  auto f1 = File::open_read_only(path1.string());
+  const std::vector<Pixel<T>> expected(f1.begin<T>(), f1.end<T>());
+  REQUIRE(expected.size() > 1);
+  const auto mid = expected.begin() + std::ptrdiff_t(expected.size() / 2);
+
+  WriterOptions options{};
+  options.compute_bin_marginals = true;
+  options.compute_chromosome_pair_stats = true;
+  {
+    auto f2 = File::create_new_cooler<T>(path2.string(), f1.chromosomes(), f1.bin_size(), true,
+                                         StandardAttributes::init<T>(f1.bin_size()),
+                                         DEFAULT_HDF5_CACHE_SIZE, options);
+    f2.append_pixels(expected.begin(), mid);
+  }
+
+  SECTION("append pixels") {
+    {
+      auto f2 = File::open_append(path2.string(), DEFAULT_HDF5_CACHE_SIZE, options);
+      CHECK(f2.attributes().nnz == std::distance(expected.begin(), mid));
+      f2.append_pixels(mid, expected.end(), true);
+    }
+
+    const auto f2 = File::open_read_only(path2.string());
+    CHECK(f2.attributes().nnz == f1.attributes().nnz);
+    CHECK(f2.attributes().sum == f1.attributes().sum);
+    CHECK(f2.attributes().cis == f1.attributes().cis);
+    const std::vector<Pixel<T>> pixels(f2.begin<T>(), f2.end<T>());
+    REQUIRE(pixels.size() == expected.size());
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+      CHECK(pixels[i] == expected[i]);
+    }
+
+    // Stats should match those of a file written in one go
+    const auto path3 = testdir() / "cooler_test_append_expected.cool";
+    {
+      auto f3 = File::create_new_cooler<T>(path3.string(), f1.chromosomes(), f1.bin_size(), true,
+                                           StandardAttributes::init<T>(f1.bin_size()),
+                                           DEFAULT_HDF5_CACHE_SIZE, options);
+      f3.append_pixels(expected.begin(), expected.end());
+    }
+    const auto f3 = File::open_read_only(path3.string());
+    CHECK(f2.read_chromosome_pair_stats() == f3.read_chromosome_pair_stats());
+    CHECK(*f2.read_bin_marginal_sum() == *f3.read_bin_marginal_sum());
+    CHECK(*f2.read_bin_marginal_nnz() == *f3.read_bin_marginal_nnz());
+
+    for (const auto &chrom : f1.chromosomes()) {
+      const auto sel1 = f1.fetch<T>(chrom.name());
+      const auto sel2 = f2.fetch<T>(chrom.name());
+      CHECK(std::distance(sel1.begin(), sel1.end()) == std::distance(sel2.begin(), sel2.end()));
+    }
+  }
+
+  SECTION("pixels preceding the last pixel written") {
+    auto f2 = File::open_append(path2.string());
+    CHECK_THROWS(f2.append_pixels(expected.begin(), mid, true));
+  }
+
+  SECTION("marginals are updated without compute_bin_marginals") {
+    File::open_append(path2.string()).append_pixels(mid, expected.end(), true);
+
+    const auto path3 = testdir() / "cooler_test_append_marginals.cool";
+    File::create_new_cooler<T>(path3.string(), f1.chromosomes(), f1.bin_size(), true,
+                               StandardAttributes::init<T>(f1.bin_size()),
+                               DEFAULT_HDF5_CACHE_SIZE, options)
+        .append_pixels(expected.begin(), expected.end());
+
+    const auto f2 = File::open_read_only(path2.string());
+    const auto f3 = File::open_read_only(path3.string());
+    CHECK(*f2.read_bin_marginal_sum() == *f3.read_bin_marginal_sum());
+    CHECK(*f2.read_bin_marginal_nnz() == *f3.read_bin_marginal_nnz());
+  }
+
+  SECTION("non-standard attributes are preserved") {
+    {
+      HighFive::File fp(path2.string(), HighFive::File::ReadWrite);
+      Attribute::write(fp, "custom-attr", std::string{"value"});
+    }
+    File::open_append(path2.string()).append_pixels(mid, expected.end(), true);
+
+    const HighFive::File fp(path2.string(), HighFive::File::ReadOnly);
+    CHECK(Attribute::read<std::string>(fp, "custom-attr") == "value");
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Coolerpp: chromosome pair stats", "[cooler][short]") {
+  auto path1 = datadir / "cooler_test_file.cool";
+  auto path2 = testdir() / "cooler_test_chromosome_pair_stats.cool";
+
+  using T = std::int32_t;
+  const auto f1 = File::open_read_only(path1.string());
+  const std::vector<Pixel<T>> pixels(f1.begin<T>(), f1.end<T>());
+  REQUIRE(pixels.size() == 107041);
+
+  ChromosomePairStats expected(static_cast<std::uint32_t>(f1.chromosomes().size()));
+  for (const auto &p : pixels) {
+    expected.add(p.coords.bin1.chrom().id(), p.coords.bin2.chrom().id(),
+                 ContactStats{double(p.count), 1});
+  }
+
+  CHECK(!f1.has_chromosome_pair_stats());
+  CHECK_THROWS_WITH(f1.read_chromosome_pair_stats(),
+                    Catch::Matchers::ContainsSubstring("has no stats group"));
+
+  // Stats are opt-in
+  File::create_new_cooler<T>(path2.string(), f1.chromosomes(), f1.bin_size(), true)
+      .append_pixels(pixels.begin(), pixels.end());
+  CHECK(!File::open_read_only(path2.string()).has_chromosome_pair_stats());
+  CHECK(!HighFive::File(path2.string(), HighFive::File::ReadOnly).exist("stats"));
+
+  WriterOptions options{};
+  options.compute_chromosome_pair_stats = true;
+  {
+    auto f2 = File::create_new_cooler<T>(path2.string(), f1.chromosomes(), f1.bin_size(), true,
+                                         StandardAttributes::init<T>(f1.bin_size()),
+                                         DEFAULT_HDF5_CACHE_SIZE, options);
+    const auto offset = static_cast<std::ptrdiff_t>(pixels.size() / 2);
+    f2.append_pixels(pixels.begin(), pixels.begin() + offset);
+
+    const auto bin1_ids = f1.dataset("pixels/bin1_id").read_all<std::vector<std::uint64_t>>();
+    const auto bin2_ids = f1.dataset("pixels/bin2_id").read_all<std::vector<std::uint64_t>>();
+    const auto counts = f1.dataset("pixels/count").read_all<std::vector<T>>();
+    const auto i = static_cast<std::size_t>(offset);
+    f2.append_pixels_columns(bin1_ids.data() + i, bin2_ids.data() + i, counts.data() + i,
+                             bin1_ids.size() - i);
+
+    CHECK(f2.has_chromosome_pair_stats());
+    CHECK(f2.read_chromosome_pair_stats() == expected);
+  }
+
+  const auto f2 = File::open_read_only(path2.string());
+  REQUIRE(f2.has_chromosome_pair_stats());
+  const auto stats = f2.read_chromosome_pair_stats();
+  CHECK(stats == expected);
+
+  const auto &chr1 = f2.chromosomes().at(0);
+  const auto &chr2 = f2.chromosomes().at(1);
+  CHECK(stats.at(chr1, chr2) == expected.at(chr1, chr2));
+  CHECK(stats.at(chr1) == expected.at(chr1));
+  CHECK(StandardAttributes::SumVar(std::int64_t(stats.total().sum)) == f2.attributes().sum);
+  CHECK(StandardAttributes::SumVar(std::int64_t(stats.cis().sum)) == f2.attributes().cis);
+  CHECK(stats.total().nnz == static_cast<std::uint64_t>(*f2.attributes().nnz));
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Coolerpp: bin marginals", "[cooler][short]") {
+  auto path1 = datadir / "cooler_test_file.cool";
+  auto path2 = testdir() / "cooler_test_bin_marginals.cool";
+
+  using T = std::int32_t;
+  const auto f1 = File::open_read_only(path1.string());
+  const std::vector<Pixel<T>> pixels(f1.begin<T>(), f1.end<T>());
+
+  std::vector<double> expected_sum(f1.bins().size(), 0);
+  std::vector<std::uint64_t> expected_nnz(f1.bins().size(), 0);
+  for (const auto &p : pixels) {
+    const auto bin1_id = p.coords.bin1.id();
+    const auto bin2_id = p.coords.bin2.id();
+    expected_sum[bin1_id] += p.count;
+    ++expected_nnz[bin1_id];
+    if (bin1_id != bin2_id) {
+      expected_sum[bin2_id] += p.count;
+      ++expected_nnz[bin2_id];
+    }
+  }
+
+  CHECK(!f1.has_bin_marginals());
+  CHECK_THROWS_WITH(f1.read_bin_marginal_sum(),
+                    Catch::Matchers::ContainsSubstring("has no marginal datasets"));
+
+  SECTION("disabled") {
+    auto f2 = File::create_new_cooler<T>(path2.string(), f1.chromosomes(), f1.bin_size(), true);
+    f2.append_pixels(pixels.begin(), pixels.end());
+    CHECK(!f2.has_bin_marginals());
+    CHECK_THROWS_WITH(f2.read_bin_marginal_nnz(),
+                      Catch::Matchers::ContainsSubstring("compute_bin_marginals=true"));
+  }
+
+  SECTION("enabled") {
+    WriterOptions options{};
+    options.compute_bin_marginals = true;
+    {
+      auto f2 = File::create_new_cooler<T>(path2.string(), f1.chromosomes(), f1.bin_size(), true,
+                                           StandardAttributes::init<T>(0),
+                                           DEFAULT_HDF5_CACHE_SIZE * 4, options);
+      const auto offset = static_cast<std::ptrdiff_t>(pixels.size() / 2);
+      f2.append_pixels(pixels.begin(), pixels.begin() + offset);
+
+      const auto bin1_ids = f1.dataset("pixels/bin1_id").read_all<std::vector<std::uint64_t>>();
+      const auto bin2_ids = f1.dataset("pixels/bin2_id").read_all<std::vector<std::uint64_t>>();
+      const auto counts = f1.dataset("pixels/count").read_all<std::vector<T>>();
+      const auto i = static_cast<std::size_t>(offset);
+      f2.append_pixels_columns(bin1_ids.data() + i, bin2_ids.data() + i, counts.data() + i,
+                               bin1_ids.size() - i);
+
+      REQUIRE(f2.has_bin_marginals());
+      CHECK(*f2.read_bin_marginal_sum() == expected_sum);
+      CHECK(*f2.read_bin_marginal_nnz() == expected_nnz);
+    }
+
+    const auto f2 = File::open_read_only(path2.string());
+    REQUIRE(f2.has_bin_marginals());
+    const auto sum = f2.read_bin_marginal_sum();
+    const auto nnz = f2.read_bin_marginal_nnz();
+    CHECK(*sum == expected_sum);
+    CHECK(*nnz == expected_nnz);
+    CHECK(f2.read_bin_marginal_sum() == sum);
+    CHECK(f2.read_bin_marginal_nnz() == nnz);
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Coolerpp: compression policy", "[cooler][short]") {
+  auto path1 = datadir / "cooler_test_file.cool";
+  auto path2 = testdir() / "cooler_test_compression_policy.cool";
+
+  using T = std::int32_t;
+  auto f1 = File::open_read_only(path1.string());
+  const std::vector<Pixel<T>> expected(f1.begin<T>(), f1.end<T>());
+
+  auto write_pixels = [&](const CompressionPolicy& policy, std::size_t threads = 1) {
+    const WriterOptions options{threads, policy};
+    auto f2 = File::create_new_cooler<T>(path2.string(), f1.chromosomes(), f1.bin_size(), true,
+                                         StandardAttributes::init<T>(f1.bin_size()),
+                                         DEFAULT_HDF5_CACHE_SIZE * 4, options);
+    f2.append_pixels(expected.begin(), expected.end());
+  };
+
+  auto read_layout = [](const File& f, std::string_view name) {
+    internal::ChunkLayout layout{};
+    CHECK(internal::read_chunk_layout(f.dataset(name).get().getId(), layout));
+    return layout;
+  };
+
+  SECTION("builtin filters") {
+    CompressionPolicy policy{};
+    policy.pixels_bin1_id = {ShuffleFilter::NONE, Compressor::DEFLATE, 1, 1'000};
+    policy.pixels_bin2_id = {ShuffleFilter::BYTE, Compressor::DEFLATE, 9, 2'000};
+    policy.pixels_count = {ShuffleFilter::NONE, Compressor::NONE, 0, 4'000};
+
+    for (const std::size_t threads : {std::size_t(1), std::size_t(4)}) {
+      write_pixels(policy, threads);
+      const auto f2 = File::open_read_only(path2.string());
+      CHECK(std::vector<Pixel<T>>(f2.begin<T>(), f2.end<T>()) == expected);
+
+      const auto bin1_layout = read_layout(f2, "pixels/bin1_id");
+      CHECK(bin1_layout.chunk_size == 1'000);
+      CHECK(bin1_layout.filters == std::vector<H5Z_filter_t>{H5Z_FILTER_DEFLATE});
+      CHECK(bin1_layout.deflate_level == 1);
+
+      const auto bin2_layout = read_layout(f2, "pixels/bin2_id");
+      CHECK(bin2_layout.chunk_size == 2'000);
+      CHECK(bin2_layout.filters ==
+            std::vector<H5Z_filter_t>{H5Z_FILTER_SHUFFLE, H5Z_FILTER_DEFLATE});
+      CHECK(bin2_layout.deflate_level == 9);
+
+      const auto count_layout = read_layout(f2, "pixels/count");
+      CHECK(count_layout.chunk_size == 4'000);
+      CHECK(count_layout.filters.empty());
+
+      // Other datasets use the default filters
+      const auto bins_layout = read_layout(f2, "bins/start");
+      CHECK(bins_layout.chunk_size == DEFAULT_HDF5_CHUNK_SIZE / sizeof(std::int32_t));
+      CHECK(bins_layout.filters ==
+            std::vector<H5Z_filter_t>{H5Z_FILTER_SHUFFLE, H5Z_FILTER_DEFLATE});
+      CHECK(bins_layout.deflate_level == DEFAULT_COMPRESSION_LEVEL);
+    }
+  }
+
+  SECTION("plugin filters") {
+    CompressionPolicy policy{};
+    policy.pixels_bin1_id = {ShuffleFilter::BIT, Compressor::ZSTD, 3};
+    policy.pixels_bin2_id = {ShuffleFilter::BYTE, Compressor::ZSTD, 3};
+
+    if (H5Zfilter_avail(internal::H5Z_FILTER_BITSHUFFLE) <= 0 ||
+        H5Zfilter_avail(internal::H5Z_FILTER_ZSTD) <= 0) {
+      CHECK_THROWS_WITH(write_pixels(policy),
+                        Catch::Matchers::ContainsSubstring("HDF5_PLUGIN_PATH"));
+      return;
+    }
+
+    // Chunks cannot be encoded by the background writer: compression is left to libhdf5
+    for (const std::size_t threads : {std::size_t(1), std::size_t(4)}) {
+      write_pixels(policy, threads);
+      const auto f2 = File::open_read_only(path2.string());
+      CHECK(std::vector<Pixel<T>>(f2.begin<T>(), f2.end<T>()) == expected);
+    }
+  }
+
+  SECTION("invalid chunk size") {
+    CompressionPolicy policy{};
+    policy.pixels_count.chunk_size = 0;
+    CHECK_THROWS(write_pixels(policy));
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Coolerpp: chunk cache access profiles", "[cooler][short]") {
+  const auto path = datadir / "cooler_test_file.cool";
+
+  struct ChunkCacheProps {
+    std::size_t num_slots{};
+    std::size_t size_bytes{};
+    double w0{};
+  };
+
+  auto read_cache_props = [](const File& f, std::string_view name) {
+    const auto dapl = H5Dget_access_plist(f.dataset(name).get().getId());
+    REQUIRE(dapl >= 0);
+    ChunkCacheProps props{};
+    CHECK(H5Pget_chunk_cache(dapl, &props.num_slots, &props.size_bytes, &props.w0) >= 0);
+    H5Pclose(dapl);
+    return props;
+  };
+
+  auto is_prime = [](std::size_t n) {
+    if (n < 2) {
+      return false;
+    }
+    for (std::size_t i = 2; i * i <= n; ++i) {
+      if (n % i == 0) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  constexpr std::array<std::string_view, 3> pixel_datasets{"pixels/bin1_id", "pixels/bin2_id",
+                                                           "pixels/count"};
+
+  SECTION("sequential") {
+    const auto f = File::open_read_only(path.string(), CacheOptions{AccessProfile::SEQUENTIAL});
+    for (const auto name : pixel_datasets) {
+      const auto chunk_size = f.dataset(name).chunk_size_bytes();
+      REQUIRE(chunk_size != 0);
+      const auto props = read_cache_props(f, name);
+      CHECK(props.size_bytes >= chunk_size);
+      CHECK(props.size_bytes <= 2 * chunk_size);
+      CHECK(props.size_bytes % chunk_size == 0);
+      CHECK(is_prime(props.num_slots));
+      CHECK(props.w0 == 1.0);
+    }
+  }
+
+  SECTION("random") {
+    const std::size_t cache_size = 8ULL << 20U;
+    const auto f =
+        File::open_read_only(path.string(), CacheOptions{AccessProfile::RANDOM, cache_size});
+    std::size_t tot_size = 0;
+    for (const auto name : MANDATORY_DATASET_NAMES) {
+      tot_size += read_cache_props(f, name).size_bytes;
+    }
+    CHECK(tot_size <= cache_size);
+
+    for (const auto name : pixel_datasets) {
+      const auto& dset = f.dataset(name);
+      const auto chunk_size = dset.chunk_size_bytes();
+      const auto props = read_cache_props(f, name);
+      CHECK(props.size_bytes % chunk_size == 0);
+      // The cache should never be larger than the dataset itself
+      const auto dset_size = dset.size() * dset.get().getDataType().getSize();
+      CHECK(props.size_bytes <= dset_size + chunk_size);
+      CHECK(is_prime(props.num_slots));
+      CHECK(props.num_slots >= 100 * (props.size_bytes / chunk_size));
+      CHECK(props.w0 == DEFAULT_HDF5_CACHE_W0);
+    }
+
+    // Datasets other than pixels cache a single chunk
+    const auto props = read_cache_props(f, "indexes/bin1_offset");
+    CHECK(props.size_bytes == f.dataset("indexes/bin1_offset").chunk_size_bytes());
+  }
+
+  SECTION("tiny budget") {
+    const auto f = File::open_read_only(path.string(), CacheOptions{AccessProfile::BAND, 1});
+    for (const auto name : pixel_datasets) {
+      CHECK(read_cache_props(f, name).size_bytes == f.dataset(name).chunk_size_bytes());
+    }
+  }
+
+  SECTION("overrides") {
+    CacheOptions options{AccessProfile::BAND};
+    options.w0 = 0.25;
+    options.num_slots = 101;
+    const auto f = File::open_read_only(path.string(), options);
+    for (const auto name : pixel_datasets) {
+      const auto props = read_cache_props(f, name);
+      CHECK(props.num_slots == 101);
+      CHECK(props.w0 == 0.25);
+    }
+
+    options.w0 = 1.5;
+    CHECK_THROWS_AS(File::open_read_only(path.string(), options), std::logic_error);
+    options.w0.reset();
+    options.num_slots = 0;
+    CHECK_THROWS_AS(File::open_read_only(path.string(), options), std::logic_error);
+  }
+
+  SECTION("reading pixels") {
+    using T = std::int32_t;
+    const auto f1 = File::open_read_only(path.string());
+    const std::vector<Pixel<T>> expected(f1.begin<T>(), f1.end<T>());
+    for (const auto profile :
+         {AccessProfile::SEQUENTIAL, AccessProfile::RANDOM, AccessProfile::BAND}) {
+      const auto f2 = File::open_read_only(path.string(), CacheOptions{profile});
+      const std::vector<Pixel<T>> pixels(f2.begin<T>(), f2.end<T>());
+      CHECK(pixels == expected);
+    }
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Coolerpp: I/O stats", "[cooler][short]") {
+  using T = std::int32_t;
+  const auto path = datadir / "cooler_test_file.cool";
+  const auto f = File::open_read_only(path.string());
+  // Discard reads performed while opening the file
+  f.reset_stats();
+
+  const auto sel = f.fetch<T>("1:0-10,000,000");
+  const std::vector<Pixel<T>> pixels(sel.begin(), sel.end());
+  REQUIRE(!pixels.empty());
+
+  const auto stats = f.stats();
+  if constexpr (STATS_ENABLED) {
+    CHECK(stats.datasets.size() == MANDATORY_DATASET_NAMES.size());
+    CHECK(stats.pixels_materialized >= pixels.size());
+    CHECK(stats.row_seeks != 0);
+
+    const auto& count_stats = stats.datasets.at("pixels/count");
+    CHECK(count_stats.read_calls != 0);
+    CHECK(count_stats.blocks_read != 0);
+    CHECK(count_stats.chunks_read != 0);
+    CHECK(count_stats.bytes_read != 0);
+    CHECK(count_stats.bytes_decompressed >= pixels.size() * sizeof(T));
+    CHECK(count_stats.read_time.count() > 0);
+    CHECK(stats.total.read_calls >= count_stats.read_calls);
+    CHECK(stats.datasets.at("chroms/name").read_calls == 0);
+
+    f.reset_stats();
+    CHECK(f.stats().total.read_calls == 0);
+    CHECK(f.stats().pixels_materialized == 0);
+  } else {
+    CHECK(stats.datasets.empty());
+    CHECK(stats.total.read_calls == 0);
+    CHECK(stats.pixels_materialized == 0);
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Coolerpp: trace scopes", "[cooler][short]") {
+  using T = std::int32_t;
+  struct TraceLog {
+    std::mutex mtx{};
+    std::vector<std::pair<bool, std::string>> events{};
+  };
+
+  TraceLog log{};
+  const TraceCallbacks callbacks{
+      [](const char* name, void* user_data) {
+        auto& l = *static_cast<TraceLog*>(user_data);
+        const std::scoped_lock lck(l.mtx);
+        l.events.emplace_back(true, name);
+      },
+      [](const char* name, void* user_data) {
+        auto& l = *static_cast<TraceLog*>(user_data);
+        const std::scoped_lock lck(l.mtx);
+        l.events.emplace_back(false, name);
+      },
+      &log};
+
+  const auto path = datadir / "cooler_test_file.cool";
+  const auto* prev_callbacks = set_trace_callbacks(&callbacks);
+  {
+    const auto f = File::open_read_only(path.string());
+    const auto sel = f.fetch<T>("1:0-10,000,000");
+    REQUIRE(std::distance(sel.begin(), sel.end()) != 0);
+  }
+  CHECK(set_trace_callbacks(prev_callbacks) == &callbacks);
+
+  auto count_events = [&](std::string_view name) {
+    return std::count_if(log.events.begin(), log.events.end(),
+                         [&](const auto& e) { return e.first && e.second == name; });
+  };
+
+  if constexpr (TRACING_ENABLED) {
+    CHECK(count_events("coolerpp::File::open_datasets") == 1);
+    CHECK(count_events("coolerpp::File::import_chroms") != 0);
+    CHECK(count_events("coolerpp::File::import_indexes") == 1);
+    CHECK(count_events("coolerpp::File::fetch") == 1);
+    CHECK(count_events("coolerpp::PixelSelector::begin") == 1);
+    CHECK(count_events("coolerpp::PixelSelector::iterator::jump_to_row") != 0);
+    CHECK(count_events("coolerpp::Dataset::iterator::read_chunk_at_offset") != 0);
+
+    // Scopes are properly nested
+    std::vector<std::string> stack{};
+    for (const auto& [begin, name] : log.events) {
+      if (begin) {
+        stack.push_back(name);
+      } else {
+        REQUIRE(!stack.empty());
+        CHECK(stack.back() == name);
+        stack.pop_back();
+      }
+    }
+    CHECK(stack.empty());
+  } else {
+    CHECK(log.events.empty());
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Coolerpp: memory usage", "[cooler][short]") {
+  using T = std::int32_t;
+  // The budget is process-wide: restore its limit even when a check fails
+  struct LimitGuard {
+    MemoryBudget& budget;
+    std::size_t limit;
+    ~LimitGuard() noexcept { budget.set_limit(limit); }
+  };
+
+  auto& budget = MemoryBudget::instance();
+  const LimitGuard limit_guard{budget, budget.limit()};
+  budget.set_limit(0);
+  const auto path = datadir / "cooler_test_file.cool";
+
+  SECTION("accounting") {
+    // Chunk caches are only accounted for while the budget is enabled
+    budget.set_limit((std::numeric_limits<std::size_t>::max)());
+    const auto reserved = budget.usage().hdf5_chunk_caches;
+    {
+      const auto f = File::open_read_only(path.string());
+      const auto usage = f.memory_usage();
+      CHECK(usage.hdf5_chunk_caches != 0);
+      CHECK(usage.index != 0);
+      CHECK(usage.bin_table != 0);
+      CHECK(usage.weights == 0);
+      CHECK(usage.write_buffers == 0);
+      CHECK(budget.usage().hdf5_chunk_caches >= reserved + usage.hdf5_chunk_caches);
+
+      const auto weights = f.read_weights("weight");
+      CHECK(f.memory_usage().weights >= (*weights)().size() * sizeof(double));
+    }
+    // Chunk caches are released together with their datasets
+    CHECK(budget.usage().hdf5_chunk_caches == reserved);
+  }
+
+  SECTION("chunk caches are shrunk under pressure") {
+    const auto path1 = testdir() / "memory_usage_test1.cool";
+    const auto path2 = testdir() / "memory_usage_test2.cool";
+    const ChromosomeSet chroms{Chromosome{0, "chr1", 10000}, Chromosome{1, "chr2", 5000}};
+    constexpr std::size_t headroom = 32ULL << 20U;
+
+    const auto f1 = File::create_new_cooler<T>(path1.string(), chroms, 100, true);
+    CHECK(f1.memory_usage().hdf5_chunk_caches > headroom);
+
+    budget.set_limit(budget.usage().total() + headroom);
+    const auto f2 = File::create_new_cooler<T>(path2.string(), chroms, 100, true);
+    CHECK(f2.memory_usage().hdf5_chunk_caches <= headroom);
+  }
+
+  SECTION("trim") {
+    struct CapacityGuard {
+      ChunkCache& cache;
+      std::size_t capacity;
+      ~CapacityGuard() noexcept { cache.set_capacity(capacity); }
+    };
+
+    auto& cache = ChunkCache::instance();
+    const CapacityGuard capacity_guard{cache, cache.capacity()};
+    constexpr std::size_t capacity = 64ULL << 20U;
+    cache.set_capacity(capacity);
+    {
+      const auto f = File::open_read_only(path.string());
+      const auto sel = f.fetch<T>();
+      REQUIRE(std::distance(sel.begin(), sel.end()) != 0);
+    }
+    REQUIRE(cache.stats().size_bytes != 0);
+
+    // Blocks cached by ChunkCache are evicted first, while its capacity is left untouched
+    const auto usage = budget.usage();
+    budget.set_limit(usage.hdf5_chunk_caches + usage.buffer_pools + 1);
+    CHECK(cache.stats().size_bytes == 0);
+    CHECK(cache.capacity() == capacity);
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Coolerpp: write pixels with background compression", "[cooler][long]") {
+  auto path1 = datadir / "cooler_test_file.cool";
+  auto path2 = testdir() / "cooler_test_write_pixels_background_compression.cool";
+
+  using T = std::int32_t;
+  auto f1 = File::open_read_only(path1.string());
+  const std::vector<Pixel<T>> expected(f1.begin<T>(), f1.end<T>());
+  REQUIRE(expected.size() == 107041);
+
+  {
+    auto f2 = File::create_new_cooler<T>(path2.string(), f1.chromosomes(), f1.bin_size(), true,
+                                         StandardAttributes::init<T>(f1.bin_size()),
+                                         DEFAULT_HDF5_CACHE_SIZE * 4, WriterOptions{4});
+
+    const auto mid = expected.begin() + 50'000;
+    f2.append_pixels(expected.begin(), expected.begin() + 10'000);
+    // Validation forces buffered pixels to be flushed to disk
+    f2.append_pixels(expected.begin() + 10'000, mid, true);
+    f2.flush();
+    f2.append_pixels(mid, expected.end());
+  }
+
+  auto f2 = File::open_read_only(path2.string());
+  CHECK(f2.dataset("pixels/bin1_id").size() == expected.size());
+  CHECK(f2.dataset("pixels/count").size() == expected.size());
+
+  const std::vector<Pixel<T>> pixels(f2.begin<T>(), f2.end<T>());
+  REQUIRE(pixels.size() == expected.size());
+  for (std::size_t i = 0; i < pixels.size(); ++i) {
+    CHECK(pixels[i] == expected[i]);
+  }
+
+  CHECK(f1.attributes().nnz == f2.attributes().nnz);
+  CHECK(f1.attributes().sum == f2.attributes().sum);
+  CHECK(f2.attributes().cis == StandardAttributes::SumVar(std::int64_t(329276)));
+}
+
+TEST_CASE("Coolerpp: background compression with mismatching pixel type", "[cooler][short]") {
+  const auto path = testdir() / "cooler_test_background_compression_pixel_type.cool";
+  const ChromosomeSet chroms{Chromosome{0, "chr1", 1000}};
+  constexpr std::uint32_t bin_size = 100;
+
+  auto f = File::create_new_cooler<std::int32_t>(path.string(), chroms, bin_size, true,
+                                                 StandardAttributes::init<std::int32_t>(bin_size),
+                                                 DEFAULT_HDF5_CACHE_SIZE, WriterOptions{4});
+  const std::vector<Pixel<double>> pixels{Pixel<double>{f.bins().at(0), f.bins().at(1), 1.5}};
+  CHECK_THROWS(f.append_pixels(pixels.begin(), pixels.end()));
+  CHECK(f.dataset("pixels/bin1_id").size() == 0);
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Coolerpp: parallel_for_each", "[cooler][short]") {
+  const auto path = datadir / "cooler_test_file.cool";
+  const auto f = File::open_read_only(path.string());
+
+  using T = std::int32_t;
+  constexpr std::size_t expected_nnz = 107041;
+  constexpr std::int64_t expected_sum = 395465;
+
+  for (const std::size_t num_threads : {1, 2, 8}) {
+    std::atomic<std::size_t> nnz{0};
+    std::atomic<std::int64_t> sum{0};
+    std::atomic<bool> pixels_are_valid{true};
+
+    f.parallel_for_each<T>(
+        num_threads,
+        [&](const Pixel<T>& p) {
+          ++nnz;
+          sum += p.count;
+          if (p.coords.bin1 > p.coords.bin2) {
+            pixels_are_valid = false;
+          }
+        },
+        1000);
+
+    CHECK(nnz == expected_nnz);
+    CHECK(sum == expected_sum);
+    CHECK(pixels_are_valid);
+  }
+
+  SECTION("exceptions are propagated") {
+    CHECK_THROWS_WITH(f.parallel_for_each<T>(
+                          4, [](const Pixel<T>&) { throw std::runtime_error("foo"); }),
+                      Catch::Matchers::Equals("foo"));
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Coolerpp: tile index", "[cooler][short]") {
+  using T = std::int32_t;
+  const auto path1 = datadir / "cooler_test_file.cool";
+  const auto path2 = testdir() / "cooler_test_tile_index.cool";
+
+  std::filesystem::remove(path2);
+  std::filesystem::copy(path1, path2);
+  REQUIRE_FALSE(File::open_read_only(path2.string()).has_tile_index());
+
+  constexpr std::uint32_t tile_size = 64;
+  File::build_tile_index(path2.string(), tile_size);
+  CHECK_THROWS(File::build_tile_index(path2.string(), tile_size));
+
+  const auto clr = File::open_read_only(path2.string());
+  REQUIRE(clr.has_tile_index());
+  CHECK(clr.tile_size() == tile_size);
+
+  const auto sel = clr.fetch<T>();
+  const std::vector<ThinPixel<T>> pixels(sel.begin_thin(), sel.end_thin());
+  const auto num_tiles = (clr.bins().size() + tile_size - 1) / tile_size;
+
+  // Tiles below the diagonal are obtained by transposing the tile above the diagonal, while the
+  // lower triangle of diagonal tiles is obtained by mirroring their upper triangle
+  auto expected_tile = [&](std::uint64_t x, std::uint64_t y) {
+    std::vector<ThinPixel<T>> expected{};
+    for (const auto& p : pixels) {
+      if (p.bin1_id / tile_size == x && p.bin2_id / tile_size == y) {
+        expected.push_back(p);
+      }
+      if (x >= y && p.bin1_id != p.bin2_id && p.bin2_id / tile_size == x &&
+          p.bin1_id / tile_size == y) {
+        expected.push_back(ThinPixel<T>{p.bin2_id, p.bin1_id, p.count});
+      }
+    }
+    std::sort(expected.begin(), expected.end());
+    return expected;
+  };
+
+  std::size_t num_pixels = 0;
+  for (std::uint64_t x = 0; x < num_tiles; x += 3) {
+    for (std::uint64_t y = x; y < num_tiles; y += 5) {
+      const auto tile = clr.fetch_tile<T>(x, y);
+      num_pixels += tile.size();
+      CHECK(tile == expected_tile(x, y));
+    }
+  }
+  CHECK(num_pixels != 0);
+
+  SECTION("tiles below the diagonal") {
+    for (const auto& [x, y] : {std::make_pair(std::uint64_t(3), std::uint64_t(0)),
+                               std::make_pair(num_tiles - 1, std::uint64_t(1)),
+                               std::make_pair(std::uint64_t(2), std::uint64_t(2))}) {
+      CHECK(clr.fetch_tile<T>(x, y) == expected_tile(x, y));
+    }
+  }
+
+  SECTION("diagonal tiles") {
+    const auto tile = clr.fetch_tile<T>(1, 1);
+    REQUIRE(!tile.empty());
+    for (const auto& p : tile) {
+      CHECK(std::find(tile.begin(), tile.end(), ThinPixel<T>{p.bin2_id, p.bin1_id, p.count}) !=
+            tile.end());
+    }
+  }
+
+  SECTION("invalid tiles") {
+    CHECK_THROWS(clr.fetch_tile<T>(num_tiles, 0));
+    CHECK_THROWS(clr.fetch_tile<T>(0, num_tiles));
+  }
+
+  SECTION("stale tiles") {
+    const auto path3 = testdir() / "cooler_test_tile_index_stale.cool";
+    const std::vector<Pixel<T>> all_pixels(clr.begin<T>(), clr.end<T>());
+    const auto mid = all_pixels.begin() + std::ptrdiff_t(all_pixels.size() / 2);
+    File::create_new_cooler<T>(path3.string(), clr.chromosomes(), clr.bin_size(), true)
+        .append_pixels(all_pixels.begin(), mid);
+    File::build_tile_index(path3.string(), tile_size);
+
+    // Tiles that no longer match the pixel table are rejected
+    {
+      HighFive::File fp(path3.string(), HighFive::File::ReadWrite);
+      auto dset = fp.getDataSet("tiles/offset");
+      Attribute::write(dset, "nnz", std::uint64_t(0), true);
+    }
+    CHECK_THROWS_WITH(File::open_read_only(path3.string()).fetch_tile<T>(0, 0),
+                      Catch::Matchers::ContainsSubstring("out of date"));
+
+    // The index is dropped when appending pixels
+    File::open_append(path3.string()).append_pixels(mid, all_pixels.end(), true);
+    CHECK_FALSE(File::open_read_only(path3.string()).has_tile_index());
+  }
+}
+
 // NOLINTNEXTLINE(readability-function-cognitive-complexity)
 TEST_CASE("Coolerpp: write weights", "[cooler][short]") {
   auto path1 = datadir / "cooler_test_file.cool";
@@ -568,6 +1701,14 @@ TEST_CASE("Coolerpp: write weights", "[cooler][short]") {
     File::write_weights(path2.string(), "weight", weights.begin(), weights.end());
 
     File::write_weights(path2.string(), "weight", weights.begin(), weights.end(), true);
+    const auto w1 = File::open_read_only(path2.string()).read_weights("weight");
+    CHECK((*w1)[0] == 1.23);
+
+    const std::vector<double> weights2(num_bins, 4.56);
+    File::write_weights(path2.string(), "weight", weights2.begin(), weights2.end(), true);
+    // Cached weights are discarded once the underlying dataset is overwritten
+    CHECK((*w1)[0] == 1.23);
+    CHECK((*File::open_read_only(path2.string()).read_weights("weight"))[0] == 4.56);
 
     CHECK_THROWS(
         File::write_weights(path2.string(), "weight", weights.begin(), weights.end(), false));
@@ -0,0 +1,94 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include "coolerpp/genomic_interval.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+#include <cstddef>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace coolerpp::test::genomic_interval {
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("GenomicInterval: parsers", "[genomic_interval][short]") {
+  const ChromosomeSet chroms{Chromosome{0, "chr1", 1000}, Chromosome{1, "chr2", 500}};
+  const auto& chr1 = chroms.at("chr1");
+  const auto& chr2 = chroms.at("chr2");
+
+  SECTION("UCSC") {
+    CHECK(GenomicInterval::parse_ucsc(chroms, "chr1") == GenomicInterval{chr1});
+    CHECK(GenomicInterval::parse_ucsc(chroms, "chr1:5-10") == GenomicInterval{chr1, 5, 10});
+    CHECK(GenomicInterval::parse_ucsc(chroms, "chr2:1,0-2,00") == GenomicInterval{chr2, 10, 200});
+  }
+
+  SECTION("BED") {
+    CHECK(GenomicInterval::parse_bed(chroms, "chr1\t5\t10") == GenomicInterval{chr1, 5, 10});
+    CHECK(GenomicInterval::parse_bed(chroms, "chr2 0 500", ' ') == GenomicInterval{chr2, 0, 500});
+    CHECK_THROWS_WITH(GenomicInterval::parse_bed(chroms, "chr2\t1,0\t200"),
+                      Catch::Matchers::ContainsSubstring("invalid start position"));
+  }
+
+  SECTION("non-throwing") {
+    const GenomicInterval expected{chr2, 10, 20};
+    GenomicInterval gi{expected};
+
+    CHECK(GenomicInterval::try_parse_ucsc(chroms, "chr1:0-10", gi) == ParseStatus::OK);
+    CHECK(gi == GenomicInterval{chr1, 0, 10});
+    CHECK(GenomicInterval::try_parse_bed(chroms, "chr2\t10\t20", gi) == ParseStatus::OK);
+    CHECK(gi == expected);
+
+    CHECK(GenomicInterval::try_parse_ucsc(chroms, "", gi) == ParseStatus::EMPTY_QUERY);
+    CHECK(GenomicInterval::try_parse_ucsc(chroms, "chr3", gi) == ParseStatus::INVALID_CHROMOSOME);
+    CHECK(GenomicInterval::try_parse_ucsc(chroms, "chr1:0:1", gi) ==
+          ParseStatus::MALFORMED_QUERY);
+    CHECK(GenomicInterval::try_parse_ucsc(chroms, "chr1:-1", gi) ==
+          ParseStatus::MISSING_START_POSITION);
+    CHECK(GenomicInterval::try_parse_ucsc(chroms, "chr1:0-", gi) ==
+          ParseStatus::MISSING_END_POSITION);
+    CHECK(GenomicInterval::try_parse_ucsc(chroms, "chr1:a-1", gi) ==
+          ParseStatus::INVALID_START_POSITION);
+    CHECK(GenomicInterval::try_parse_ucsc(chroms, "chr1:0-4294967296", gi) ==
+          ParseStatus::INVALID_END_POSITION);
+    CHECK(GenomicInterval::try_parse_ucsc(chroms, "chr1:0-1001", gi) ==
+          ParseStatus::END_POSITION_OUT_OF_BOUNDS);
+    CHECK(GenomicInterval::try_parse_bed(chroms, "chr1\t10\t5", gi) == ParseStatus::EMPTY_INTERVAL);
+
+    // gi is not modified when parsing fails
+    CHECK(gi == expected);
+  }
+
+  SECTION("BEDPE") {
+    constexpr std::string_view buffer{
+        "# comment\n"
+        "chr1\t0\t10\tchr2\t5\t20\tname\r\n"
+        "\n"
+        "chr2\t100\t200\tchr2\t300\t400"};
+
+    const auto queries = GenomicInterval::parse_bedpe(chroms, buffer);
+    REQUIRE(queries.size() == 2);
+    CHECK(queries[0].first == GenomicInterval{chr1, 0, 10});
+    CHECK(queries[0].second == GenomicInterval{chr2, 5, 20});
+    CHECK(queries[1].first == GenomicInterval{chr2, 100, 200});
+    CHECK(queries[1].second == GenomicInterval{chr2, 300, 400});
+
+    constexpr std::string_view invalid_buffer{
+        "chr1\t0\t10\tchr2\t5\t20\n"
+        "chr1\t0\t10\tchr2\t5\n"};
+    std::vector<std::pair<GenomicInterval, GenomicInterval>> queries2{};
+    std::size_t line_number{};
+    CHECK(GenomicInterval::try_parse_bedpe(chroms, invalid_buffer, queries2, line_number) ==
+          ParseStatus::MALFORMED_QUERY);
+    CHECK(queries2.size() == 1);
+    CHECK(line_number == 1);
+
+    CHECK_THROWS_WITH(GenomicInterval::parse_bedpe(chroms, invalid_buffer),
+                      Catch::Matchers::ContainsSubstring("at line 2") &&
+                          Catch::Matchers::ContainsSubstring("malformed"));
+  }
+}
+
+}  // namespace coolerpp::test::genomic_interval
@@ -0,0 +1,98 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include "coolerpp/ice.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+#include "coolerpp/coolerpp.hpp"
+#include "coolerpp/dataset.hpp"
+#include "coolerpp/test/self_deleting_folder.hpp"
+
+namespace coolerpp::test {
+inline const SelfDeletingFolder testdir{true};            // NOLINT(cert-err58-cpp)
+inline const std::filesystem::path datadir{"test/data"};  // NOLINT(cert-err58-cpp)
+}  // namespace coolerpp::test
+
+namespace coolerpp::test::ice {
+
+static void compare_weights(const std::vector<double>& weights,
+                            const std::vector<double>& expected) {
+  REQUIRE(weights.size() == expected.size());
+  for (std::size_t i = 0; i < weights.size(); ++i) {
+    if (std::isnan(expected[i])) {
+      CHECK(std::isnan(weights[i]));
+    } else {
+      CHECK_THAT(weights[i], Catch::Matchers::WithinRel(expected[i], 1.0e-6));
+    }
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("ICE", "[balancing][short]") {
+  // Weights were computed with cooler balance --cis-only
+  const auto path = datadir / "ENCFF993FGR.2500000.cool";
+  const auto clr = File::open_read_only(path.string());
+  const auto expected = (*clr.read_weights("weight"))();
+
+  SECTION("cis") {
+    const ICE ice(clr, ICE::Type::cis);
+    CHECK(ice.converged());
+    CHECK(ice.scale().size() == clr.chromosomes().size());
+    compare_weights(ice.biases(), expected);
+  }
+
+  SECTION("cis (streaming, multi-threaded)") {
+    ICE::Params params{};
+    params.in_memory = false;
+    params.num_threads = 4;
+    const ICE ice(clr, ICE::Type::cis, params);
+    CHECK(ice.converged());
+    compare_weights(ice.biases(), expected);
+  }
+
+  SECTION("cis (in-memory, multi-threaded)") {
+    ICE::Params params{};
+    params.num_threads = 4;
+    const ICE ice(clr, ICE::Type::cis, params);
+    CHECK(ice.converged());
+    compare_weights(ice.biases(), expected);
+  }
+
+  SECTION("gw and trans") {
+    for (const auto type : {ICE::Type::gw, ICE::Type::trans}) {
+      const ICE ice(clr, type);
+      CHECK(ice.converged());
+      CHECK(ice.scale().size() == 1);
+      CHECK(ice.get_weights().type() == Weights::Type::MULTIPLICATIVE);
+    }
+  }
+
+  SECTION("write weights") {
+    const auto path1 = testdir() / "ice_write_weights.cool";
+    std::filesystem::remove(path1);
+    std::filesystem::copy(path, path1);
+
+    const ICE ice(clr, ICE::Type::cis);
+    ice.write_weights(path1.string(), "ICE");
+    CHECK_THROWS(ice.write_weights(path1.string(), "ICE"));
+    ice.write_weights(path1.string(), "ICE", true);
+
+    const auto clr1 = File::open_read_only(path1.string());
+    const auto& grp = clr1.group("bins");
+    const Dataset dset{grp.root_group, grp().getDataSet("ICE")};
+    CHECK(dset.read_attribute<bool>("cis_only"));
+    CHECK(dset.read_attribute<bool>("converged"));
+    CHECK_FALSE(dset.read_attribute<bool>("divisive_weights"));
+
+    compare_weights((*clr1.read_weights("ICE"))(), expected);
+  }
+}
+
+}  // namespace coolerpp::test::ice
@@ -4,9 +4,12 @@
 
 #include "coolerpp/index.hpp"
 
+#include <algorithm>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_string.hpp>
+#include <cstddef>
 #include <filesystem>
+#include <vector>
 
 #include "coolerpp/bin_table.hpp"
 #include "coolerpp/chromosome.hpp"
@@ -94,6 +97,34 @@ TEST_CASE("Index: offset setters and getters", "[index][short]") {
   }
 }
 
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Index: offset setters and getters (variable bins)", "[index][short]") {
+  const auto bins = std::make_shared<const BinTable>(
+      ChromosomeSet{Chromosome{0, "chr1", 100}, Chromosome{1, "chr2", 50}},
+      std::vector<std::uint32_t>{0, 5, 50, 0, 10}, std::vector<std::uint32_t>{5, 50, 100, 10, 50});
+
+  constexpr auto fill_value = std::numeric_limits<std::uint64_t>::max();
+
+  Index idx(bins);
+  CHECK(idx.bin_size() == 0);
+  CHECK(idx.size() == 5);
+  CHECK(idx.size("chr1") == 3);
+  CHECK(idx.size("chr2") == 2);
+
+  idx.set_offset_by_pos("chr1", 22, 1);
+  idx.set_offset_by_pos(1, 49, 2);
+  idx.set_offset_by_bin_id(3, 3);
+
+  CHECK(idx.get_offset_by_pos("chr1", 4) == fill_value);
+  CHECK(idx.get_offset_by_pos("chr1", 5) == 1);
+  CHECK(idx.get_offset_by_pos(0, 49) == 1);
+  CHECK(idx.get_offset_by_pos(0, 50) == fill_value);
+  CHECK(idx.get_offset_by_row_idx(0, 1) == 1);
+  CHECK(idx.get_offset_by_pos("chr2", 0) == 3);
+  CHECK(idx.get_offset_by_row_idx(1, 1) == 2);
+  CHECK(idx.get_offset_by_bin_id(4) == 2);
+}
+
 // NOLINTNEXTLINE(readability-function-cognitive-complexity)
 TEST_CASE("Index: iterator", "[index][short]") {
   constexpr std::uint32_t bin_size = 1000;
@@ -166,6 +197,78 @@ TEST_CASE("Index: validation", "[index][short]") {
   }
 }
 
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Index: lazy loading", "[index][short]") {
+  constexpr std::uint32_t bin_size = 1000;
+  const auto bins = std::make_shared<const BinTable>(
+      ChromosomeSet{Chromosome{0, "chr1", 10001}, Chromosome{1, "chr2", 5000}}, bin_size);
+
+  // Assume there are 10 pixels per row
+  std::vector<std::uint64_t> offsets(bins->size());
+  for (std::size_t i = 0; i < offsets.size(); ++i) {
+    offsets[i] = conditional_static_cast<std::uint64_t>(i * 10);
+  }
+
+  std::vector<std::uint64_t> requests{};
+  auto loader = [&](std::uint64_t first_bin_id, std::vector<std::uint64_t>& buff) {
+    requests.push_back(first_bin_id);
+    const auto first = offsets.begin() + std::ptrdiff_t(first_bin_id);
+    std::copy(first, first + std::ptrdiff_t(buff.size()), buff.begin());
+  };
+
+  SECTION("valid index") {
+    const Index idx(bins, loader, 160);
+    CHECK(idx.is_lazy());
+    CHECK(requests.empty());
+    CHECK(idx.size() == bins->size());
+    // Offsets are only allocated once they are loaded
+    const auto initial_memory_usage = idx.memory_usage();
+    CHECK(initial_memory_usage < bins->size() * sizeof(std::uint64_t));
+    CHECK(idx.compute_chrom_offsets() == bins->num_bin_prefix_sum());
+    CHECK(requests.empty());
+
+    CHECK(idx.get_offset_by_pos("chr2", 1500) == 120);
+    REQUIRE(requests.size() == 1);
+    // The last offset of chr1 is read together with the offsets of chr2
+    CHECK(requests.front() == 10);
+    CHECK(idx.memory_usage() >= initial_memory_usage + (5 * sizeof(std::uint64_t)));
+
+    CHECK(idx.get_offset_by_row_idx(1, 4) == 150);
+    CHECK(requests.size() == 1);
+
+    std::size_t i = 0;
+    std::for_each(idx.begin(), idx.end(), [&](const auto offset) {
+      if (i < offsets.size()) {
+        CHECK(offset == offsets[i++]);
+      }
+    });
+    CHECK(requests.size() == 2);
+    CHECK_NOTHROW(idx.validate());
+  }
+
+  SECTION("offsets are not sorted") {
+    offsets[13] = 0;
+    const Index idx(bins, loader, 160);
+    CHECK_NOTHROW(idx.get_offset_by_row_idx(0, 0));
+    CHECK_THROWS_WITH(idx.get_offset_by_row_idx(1, 0),
+                      Catch::Matchers::ContainsSubstring("offsets are not in ascending order"));
+  }
+
+  SECTION("offsets are not sorted across chromosomes") {
+    offsets[11] = 5;
+    const Index idx(bins, loader, 160);
+    CHECK_THROWS_WITH(idx.get_offset_by_row_idx(1, 0),
+                      Catch::Matchers::ContainsSubstring("offsets are not in ascending order"));
+  }
+
+  SECTION("offset is greater than nnz") {
+    offsets[15] = 1000;
+    const Index idx(bins, loader, 160);
+    CHECK_THROWS_WITH(idx.get_offset_by_row_idx(1, 0),
+                      Catch::Matchers::ContainsSubstring("offset is greater than nnz"));
+  }
+}
+
 // NOLINTNEXTLINE(readability-function-cognitive-complexity)
 TEST_CASE("Index: compute chromosome offsets", "[index][short]") {
   constexpr std::uint32_t bin_size = 1000;
@@ -0,0 +1,165 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include "coolerpp/multi_file_selector.hpp"
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/coolerpp.hpp"
+#include "coolerpp/test/self_deleting_folder.hpp"
+
+namespace coolerpp::test {
+inline const SelfDeletingFolder testdir{true};  // NOLINT(cert-err58-cpp)
+}  // namespace coolerpp::test
+
+namespace coolerpp::test::multi_file_selector {
+
+using T = std::uint32_t;
+using CountFx = std::function<T(std::uint64_t, std::uint64_t)>;
+
+// Write the pixels from the upper triangle for which count(bin1_id, bin2_id) != 0
+static void generate_test_file(const std::filesystem::path& path, const ChromosomeSet& chroms,
+                               std::uint32_t bin_size, const CountFx& count) {
+  auto f = File::create_new_cooler<T>(path.string(), chroms, bin_size, true);
+  const auto num_bins = f.bins().size();
+
+  std::vector<Pixel<T>> pixels{};
+  for (std::uint64_t bin1_id = 0; bin1_id < num_bins; ++bin1_id) {
+    for (std::uint64_t bin2_id = bin1_id; bin2_id < num_bins; ++bin2_id) {
+      if (const auto n = count(bin1_id, bin2_id); n != 0) {
+        pixels.emplace_back(Pixel<T>{f.bins(), bin1_id, bin2_id, n});
+      }
+    }
+  }
+  f.append_pixels(pixels.begin(), pixels.end());
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("MultiFileSelector", "[pixel_selector][short]") {
+  const ChromosomeSet chroms{Chromosome{0, "chr1", 1000}, Chromosome{1, "chr2", 100}};
+  constexpr std::uint32_t bin_size = 10;
+
+  // Files store different subsets of pixels
+  const std::vector<CountFx> count_fxs{
+      [](std::uint64_t bin1_id, std::uint64_t bin2_id) {
+        return (bin1_id + bin2_id) % 2 == 0 ? static_cast<T>(bin1_id + bin2_id + 1) : T(0);
+      },
+      [](std::uint64_t, std::uint64_t bin2_id) {
+        return bin2_id % 3 == 0 ? static_cast<T>(bin2_id + 1) : T(0);
+      },
+      [](std::uint64_t, std::uint64_t) { return T(1); }};
+
+  std::vector<File> files{};
+  for (std::size_t i = 0; i < count_fxs.size(); ++i) {
+    const auto path = testdir() / ("multi_file_selector" + std::to_string(i) + ".cool");
+    generate_test_file(path, chroms, bin_size, count_fxs[i]);
+    files.emplace_back(File::open_read_only(path.string()));
+  }
+
+  auto expected_pixels = [&](const MultiFileSelector<T>& sel) {
+    std::vector<MultiPixel<T>> pixels{};
+    for (auto bin1_id = sel.coord1().bin1.id(); bin1_id <= sel.coord1().bin2.id(); ++bin1_id) {
+      for (auto bin2_id = (std::max)(bin1_id, sel.coord2().bin1.id());
+           bin2_id <= sel.coord2().bin2.id(); ++bin2_id) {
+        MultiPixel<T> p{bin1_id, bin2_id, {}};
+        for (const auto& count : count_fxs) {
+          p.counts.push_back(count(bin1_id, bin2_id));
+        }
+        const auto nnz = std::count_if(p.counts.begin(), p.counts.end(),
+                                       [](const auto n) { return n != 0; });
+        if (sel.fill_zero() ? nnz != 0 : nnz == std::ptrdiff_t(p.counts.size())) {
+          pixels.emplace_back(std::move(p));
+        }
+      }
+    }
+    return pixels;
+  };
+
+  SECTION("cis") {
+    for (const auto num_threads : {std::size_t(1), std::size_t(2), std::size_t(0)}) {
+      for (const auto fill_zero : {true, false}) {
+        const MultiFileSelector<T> sel(files, "chr1:100-500", File::QUERY_TYPE::UCSC, fill_zero,
+                                       num_threads);
+        CHECK(sel.num_files() == files.size());
+        const auto pixels = sel.read_all();
+        CHECK(!pixels.empty());
+        CHECK(pixels == expected_pixels(sel));
+      }
+    }
+  }
+
+  SECTION("trans") {
+    for (const auto fill_zero : {true, false}) {
+      const MultiFileSelector<T> sel(files, "chr1:0-1000", "chr2:0-100", File::QUERY_TYPE::UCSC,
+                                     fill_zero, 2);
+      CHECK(sel.read_all() == expected_pixels(sel));
+    }
+  }
+
+  SECTION("small blocks") {
+    const MultiFileSelector<T> sel(files, "chr1");
+    const auto expected = sel.read_all();
+
+    std::vector<MultiPixel<T>> pixels{};
+    sel.for_each_block(
+        [&](const auto& bin1_ids, const auto& bin2_ids, const auto& counts) {
+          CHECK(bin1_ids.size() <= 7);
+          REQUIRE(bin2_ids.size() == bin1_ids.size());
+          REQUIRE(counts.size() == bin1_ids.size() * files.size());
+          for (std::size_t i = 0; i < bin1_ids.size(); ++i) {
+            const auto first = counts.begin() + std::ptrdiff_t(i * files.size());
+            pixels.emplace_back(MultiPixel<T>{
+                bin1_ids[i], bin2_ids[i],
+                std::vector<T>(first, first + std::ptrdiff_t(files.size()))});
+          }
+        },
+        7);
+    CHECK(pixels == expected);
+  }
+
+  SECTION("dense") {
+    const MultiFileSelector<T> sel(files, "chr1:100-500");
+    const auto num_rows = sel.num_rows();
+    const auto num_cols = sel.num_cols();
+    REQUIRE(num_rows == 40);
+    REQUIRE(num_cols == 40);
+
+    const auto ld = num_cols + 1;
+    std::vector<T> matrices(files.size() * num_rows * ld, (std::numeric_limits<T>::max)());
+    sel.fetch_dense(matrices.data(), ld);
+
+    const auto offset = sel.coord1().bin1.id();
+    for (std::size_t f = 0; f < files.size(); ++f) {
+      for (std::uint64_t i = 0; i < num_rows; ++i) {
+        for (std::uint64_t j = 0; j < num_cols; ++j) {
+          const auto bin1_id = (std::min)(i, j) + offset;
+          const auto bin2_id = (std::max)(i, j) + offset;
+          CHECK(matrices[(f * num_rows * ld) + (i * ld) + j] == count_fxs[f](bin1_id, bin2_id));
+        }
+      }
+    }
+
+    CHECK_THROWS(sel.fetch_dense(matrices.data(), num_cols - 1));
+  }
+
+  SECTION("invalid files") {
+    CHECK_THROWS(MultiFileSelector<T>(std::vector<File>{}, "chr1"));
+
+    const auto path = testdir() / "multi_file_selector_invalid.cool";
+    generate_test_file(path, chroms, bin_size * 2, count_fxs.back());
+    files.emplace_back(File::open_read_only(path.string()));
+    CHECK_THROWS(MultiFileSelector<T>(files, "chr1"));
+  }
+}
+
+}  // namespace coolerpp::test::multi_file_selector
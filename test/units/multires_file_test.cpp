@@ -0,0 +1,65 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include "coolerpp/multires_file.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace coolerpp::test {
+inline const std::filesystem::path datadir{"test/data"};  // NOLINT(cert-err58-cpp)
+}  // namespace coolerpp::test
+
+namespace coolerpp::test::multires_file {
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("MultiResFile: open", "[cooler][short]") {
+  const auto path = datadir / "multires_cooler_test_file.mcool";
+
+  SECTION("valid .mcool") {
+    const auto mclr = MultiResFile::open_read_only(path.string());
+    CHECK(mclr.path() == path);
+
+    const std::vector<std::uint32_t> expected{100000,  200000,  400000, 800000,
+                                              1600000, 3200000, 6400000};
+    CHECK(mclr.resolutions() == expected);
+    CHECK(mclr.has_resolution(400000));
+    CHECK(!mclr.has_resolution(5000));
+  }
+
+  SECTION("invalid .mcool") {
+    CHECK_THROWS_WITH(MultiResFile::open_read_only((datadir / "cooler_test_file.cool").string()),
+                      Catch::Matchers::ContainsSubstring(
+                          "does not look like a valid multi-resolution Cooler file"));
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("MultiResFile: open resolutions", "[cooler][short]") {
+  const auto path = datadir / "multires_cooler_test_file.mcool";
+  const auto mclr = MultiResFile::open_read_only(path.string());
+
+  for (const auto res : mclr.resolutions()) {
+    const auto &clr = mclr.open(res);
+    const auto expected =
+        File::open_read_only(path.string() + "::/resolutions/" + std::to_string(res));
+
+    CHECK(clr.bin_size() == res);
+    CHECK(clr.uri() == expected.uri());
+    CHECK(clr.chromosomes() == expected.chromosomes());
+    CHECK(clr.attributes().nnz == expected.attributes().nnz);
+
+    // Re-opening a resolution returns the cached File
+    CHECK(&mclr.open(res) == &clr);
+  }
+
+  CHECK_THROWS_WITH(mclr.open(5000),
+                    Catch::Matchers::ContainsSubstring("does not have resolution 5000"));
+}
+
+}  // namespace coolerpp::test::multires_file
@@ -0,0 +1,117 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include "coolerpp/pixel_output.hpp"
+
+#include <fmt/format.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "coolerpp/coolerpp.hpp"
+#include "coolerpp/pixel_parser.hpp"
+#include "coolerpp/test/self_deleting_folder.hpp"
+
+namespace coolerpp::test {
+inline const SelfDeletingFolder testdir{true};            // NOLINT(cert-err58-cpp)
+inline const std::filesystem::path datadir{"test/data"};  // NOLINT(cert-err58-cpp)
+}  // namespace coolerpp::test
+
+namespace coolerpp::test::pixel_output {
+
+[[nodiscard]] static std::string read_file(const std::filesystem::path& path) {
+  std::ifstream f(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()};
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("PixelFileWriter", "[pixel_output][short]") {
+  const auto path = datadir / "cooler_test_file.cool";
+  const auto clr = File::open_read_only(path.string());
+  const std::vector<Pixel<std::int32_t>> pixels(clr.begin<std::int32_t>(),
+                                                clr.end<std::int32_t>());
+  REQUIRE(!pixels.empty());
+
+  SECTION("bg2") {
+    const auto dest = testdir() / "pixel_output_test.bg2";
+    std::string expected{};
+    for (const auto& p : pixels) {
+      expected += fmt::format(FMT_STRING("{:bg2}\n"), p);
+    }
+
+    // Use a small buffer to make sure data is flushed multiple times
+    for (const std::size_t buffer_size :
+         {std::size_t(1), std::size_t(1'000), io::PixelFileWriter::DEFAULT_BUFFER_SIZE}) {
+      {
+        io::PixelFileWriter writer(dest.string(), clr.bins(), io::OutputFormat::BG2, buffer_size);
+        writer.write(pixels.begin(), pixels.end());
+      }
+      CHECK(read_file(dest) == expected);
+    }
+
+    // Pixels written by PixelFileWriter can be read back by PixelParser
+    io::PixelParser<std::int32_t> parser(dest.string(), clr.bins(), io::PixelFormat::BG2);
+    io::PixelBatch<std::int32_t> batch{};
+    CHECK(parser.read_batch(batch, pixels.size() + 1) == pixels.size());
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+      CHECK(batch.bin1_ids[i] == pixels[i].coords.bin1.id());
+      CHECK(batch.bin2_ids[i] == pixels[i].coords.bin2.id());
+      CHECK(batch.counts[i] == pixels[i].count);
+    }
+  }
+
+  SECTION("raw") {
+    const auto dest = testdir() / "pixel_output_test.txt";
+    std::string expected{};
+    for (const auto& p : pixels) {
+      expected += fmt::format(FMT_STRING("{:raw}\n"), p);
+    }
+
+    {
+      io::PixelFileWriter writer(dest.string(), clr.bins(), io::OutputFormat::RAW);
+      for (const auto& p : pixels) {
+        writer.write(p.coords.bin1.id(), p.coords.bin2.id(), p.count);
+      }
+      writer.flush();
+    }
+    CHECK(read_file(dest) == expected);
+  }
+
+  SECTION("binary") {
+    const auto dest = testdir() / "pixel_output_test.bin";
+    {
+      io::PixelFileWriter writer(dest.string(), clr.bins(), io::OutputFormat::BINARY);
+      writer.write(pixels.begin(), pixels.end());
+      writer.write(0, 1, 1.5);
+    }
+
+    constexpr std::size_t record_size = (2 * sizeof(std::uint64_t)) + sizeof(std::int64_t);
+    const auto data = read_file(dest);
+    REQUIRE(data.size() == (pixels.size() + 1) * record_size);
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+      std::uint64_t bin1_id{};
+      std::uint64_t bin2_id{};
+      std::int64_t count{};
+      const auto* record = data.data() + (i * record_size);
+      std::memcpy(&bin1_id, record, sizeof(bin1_id));
+      std::memcpy(&bin2_id, record + sizeof(bin1_id), sizeof(bin2_id));
+      std::memcpy(&count, record + (2 * sizeof(bin1_id)), sizeof(count));
+      CHECK(bin1_id == pixels[i].coords.bin1.id());
+      CHECK(bin2_id == pixels[i].coords.bin2.id());
+      CHECK(count == pixels[i].count);
+    }
+
+    double count{};
+    std::memcpy(&count, data.data() + data.size() - sizeof(count), sizeof(count));
+    CHECK(count == 1.5);
+  }
+}
+
+}  // namespace coolerpp::test::pixel_output
@@ -0,0 +1,155 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include "coolerpp/pixel_parser.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+#include "coolerpp/coolerpp.hpp"
+#include "coolerpp/test/self_deleting_folder.hpp"
+#include "coolerpp/utils.hpp"
+
+namespace coolerpp::test {
+inline const SelfDeletingFolder testdir{true};            // NOLINT(cert-err58-cpp)
+inline const std::filesystem::path datadir{"test/data"};  // NOLINT(cert-err58-cpp)
+}  // namespace coolerpp::test
+
+namespace coolerpp::test::pixel_parser {
+
+static void write_file(const std::filesystem::path& path, std::string_view content) {
+  std::ofstream f(path, std::ios::binary | std::ios::trunc);
+  f << content;
+}
+
+template <typename N>
+[[nodiscard]] static io::PixelBatch<N> parse_file(const std::filesystem::path& path,
+                                                  const BinTable& bins, io::PixelFormat format,
+                                                  std::size_t buffer_size, bool async = false) {
+  io::PixelParser<N> parser(path.string(), bins, format, buffer_size);
+  io::PixelBatch<N> pixels{};
+  parser.for_each_batch(
+      [&](const io::PixelBatch<N>& batch) {
+        CHECK(batch.size() <= 2);
+        pixels.bin1_ids.insert(pixels.bin1_ids.end(), batch.bin1_ids.begin(),
+                               batch.bin1_ids.end());
+        pixels.bin2_ids.insert(pixels.bin2_ids.end(), batch.bin2_ids.begin(),
+                               batch.bin2_ids.end());
+        pixels.counts.insert(pixels.counts.end(), batch.counts.begin(), batch.counts.end());
+      },
+      2, async);
+  return pixels;
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("PixelParser", "[pixel_parser][short]") {
+  const BinTable bins({Chromosome{0, "chr1", 1000}, Chromosome{1, "chr2", 500}}, 100);
+  const std::vector<std::uint64_t> expected_bin1_ids{0, 0, 10};
+  const std::vector<std::uint64_t> expected_bin2_ids{2, 14, 11};
+
+  SECTION("bg2") {
+    const auto path = testdir() / "pixel_parser_test.bg2";
+    write_file(path,
+               "# comment\n"
+               "chr1\t0\t100\tchr1\t200\t300\t5\n"
+               "\n"
+               "chr2\t400\t500\tchr1\t0\t100\t3\r\n"
+               "chr2\t0\t100\tchr2\t100\t200\t7");
+
+    // Small buffers force lines to span multiple reads and the buffer to grow
+    for (const std::size_t buffer_size : {1, 7, 4096}) {
+      for (const auto async : {false, true}) {
+        const auto pixels =
+            parse_file<std::int32_t>(path, bins, io::PixelFormat::BG2, buffer_size, async);
+        CHECK(pixels.bin1_ids == expected_bin1_ids);
+        CHECK(pixels.bin2_ids == expected_bin2_ids);
+        CHECK(pixels.counts == std::vector<std::int32_t>{5, 3, 7});
+      }
+    }
+  }
+
+  SECTION("coo") {
+    const auto path = testdir() / "pixel_parser_test.coo";
+    write_file(path, "0\t2\t1.5\n14\t0\t3\n10\t11\t7\n");
+
+    const auto pixels = parse_file<double>(path, bins, io::PixelFormat::COO, 4096);
+    CHECK(pixels.bin1_ids == expected_bin1_ids);
+    CHECK(pixels.bin2_ids == expected_bin2_ids);
+    CHECK(pixels.counts == std::vector<double>{1.5, 3, 7});
+  }
+
+  SECTION("validpairs") {
+    const auto path = testdir() / "pixel_parser_test.validpairs";
+    write_file(path,
+               "r1\tchr1\t1\t+\tchr1\t201\t-\t100\n"
+               "r2\tchr2\t500\t+\tchr1\t100\t-\t100\n"
+               "r3\tchr2\t1\t-\tchr2\t101\t+\t100\n");
+
+    const auto pixels = parse_file<std::int32_t>(path, bins, io::PixelFormat::VALIDPAIRS, 4096);
+    CHECK(pixels.bin1_ids == expected_bin1_ids);
+    CHECK(pixels.bin2_ids == expected_bin2_ids);
+    CHECK(pixels.counts == std::vector<std::int32_t>{1, 1, 1});
+  }
+
+  SECTION("invalid input") {
+    const auto path = testdir() / "pixel_parser_test_invalid.bg2";
+    io::PixelBatch<std::int32_t> batch{};
+
+    write_file(path, "chr1\t0\t100\tchr1\t200\t300\t5\nchr3\t0\t100\tchr1\t200\t300\t5\n");
+    io::PixelParser<std::int32_t> parser1(path.string(), bins, io::PixelFormat::BG2);
+    CHECK_THROWS_WITH(parser1.read_batch(batch, 10),
+                      Catch::Matchers::ContainsSubstring("line 2") &&
+                          Catch::Matchers::ContainsSubstring("chromosome \"chr3\" not found"));
+    CHECK(batch.size() == 1);
+
+    write_file(path, "chr1\t0\t100\tchr1\t200\t300\n");
+    io::PixelParser<std::int32_t> parser2(path.string(), bins, io::PixelFormat::BG2);
+    CHECK_THROWS_WITH(parser2.read_batch(batch, 10),
+                      Catch::Matchers::ContainsSubstring("fewer fields than expected"));
+
+    write_file(path, "chr1\t0\t100\tchr1\t2000\t2100\t1\n");
+    io::PixelParser<std::int32_t> parser3(path.string(), bins, io::PixelFormat::BG2);
+    CHECK_THROWS(parser3.read_batch(batch, 10));
+
+    CHECK_THROWS(io::parse_pixel_format("bed"));
+    CHECK_THROWS(io::PixelParser<std::int32_t>((testdir() / "missing.bg2").string(), bins,
+                                               io::PixelFormat::BG2));
+  }
+
+  SECTION("load pixels") {
+    const auto src = datadir / "cooler_test_file.cool";
+    const auto path = testdir() / "pixel_parser_test_dump.bg2";
+    const auto dest = testdir() / "pixel_parser_test.cool";
+
+    const auto clr1 = File::open_read_only(src.string());
+    {
+      std::ofstream f(path);
+      std::for_each(clr1.begin<std::int32_t>(), clr1.end<std::int32_t>(),
+                    [&](const auto& p) { f << fmt::format(FMT_STRING("{}\n"), p); });
+    }
+
+    {
+      auto clr2 = File::create_new_cooler<std::int32_t>(dest.string(), clr1.chromosomes(),
+                                                        clr1.bin_size(), true);
+      io::PixelParser<std::int32_t> parser(path.string(), clr2.bins(), io::PixelFormat::BG2);
+      parser.for_each_batch(
+          [&](const io::PixelBatch<std::int32_t>& batch) {
+            clr2.append_pixels_columns(batch.bin1_ids.data(), batch.bin2_ids.data(),
+                                       batch.counts.data(), batch.size());
+          },
+          1'000);
+    }
+    CHECK(utils::equal(src.string(), dest.string()));
+  }
+}
+
+}  // namespace coolerpp::test::pixel_parser
@@ -4,11 +4,24 @@
 
 #include "coolerpp/pixel_selector.hpp"
 
+#include <fmt/format.h>
+
 #include <algorithm>
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
 #include <catch2/matchers/catch_matchers_string.hpp>
+#include <cmath>
 #include <filesystem>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <numeric>
 #include <random>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "coolerpp/coolerpp.hpp"
 #include "coolerpp/test/self_deleting_folder.hpp"
@@ -267,4 +280,749 @@ TEST_CASE("Pixel selector: 2D queries", "[pixel_selector][short]") {
   }
 }
 
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Pixel selector: seek across chunks", "[pixel_selector][short]") {
+  using T = std::uint32_t;
+  const auto path = datadir / "cooler_test_file.cool";
+  auto f = File::open_read_only(path.string());
+  const std::vector<Pixel<T>> all_pixels(f.begin<T>(), f.end<T>());
+
+  // Small chunks force seeks to cross chunk boundaries
+  constexpr std::size_t chunk_size = 16;
+  for (const auto& [range1, range2] :
+       {std::make_pair("1:5000000-5500000", "1:5000000-6500000"),
+        std::make_pair("1:0-50000000", "1:40000000-45000000"),
+        std::make_pair("1:48000000-50000000", "4:30000000-35000000"),
+        std::make_pair("2:10000000-60000000", "3:0-1000000")}) {
+    const auto sel = f.fetch<T, chunk_size>(range1, range2);
+    const std::vector<Pixel<T>> pixels(sel.begin(), sel.end());
+
+    const auto coords1 = GenomicInterval::parse_ucsc(f.chromosomes(), range1);
+    const auto coords2 = GenomicInterval::parse_ucsc(f.chromosomes(), range2);
+    auto overlaps = [](const Bin& bin, const GenomicInterval& gi) {
+      return bin.chrom() == gi.chrom() && bin.start() < gi.end() && bin.end() > gi.start();
+    };
+    std::vector<Pixel<T>> expected{};
+    std::copy_if(all_pixels.begin(), all_pixels.end(), std::back_inserter(expected),
+                 [&](const Pixel<T>& p) {
+                   return overlaps(p.coords.bin1, coords1) && overlaps(p.coords.bin2, coords2);
+                 });
+    CHECK(pixels == expected);
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Pixel selector: symmetric queries", "[pixel_selector][short]") {
+  using T = std::uint32_t;
+  const auto path = datadir / "cooler_test_file.cool";
+  auto f = File::open_read_only(path.string());
+
+  // Mirror all pixels, then select those overlapping the query
+  const auto sel = f.fetch<T>();
+  std::vector<ThinPixel<T>> all_pixels(sel.begin_thin(), sel.end_thin());
+  const auto num_pixels = all_pixels.size();
+  for (std::size_t i = 0; i < num_pixels; ++i) {
+    const auto p = all_pixels[i];
+    if (p.bin1_id != p.bin2_id) {
+      all_pixels.emplace_back(ThinPixel<T>{p.bin2_id, p.bin1_id, p.count});
+    }
+  }
+  std::sort(all_pixels.begin(), all_pixels.end());
+
+  auto expected_pixels = [&](std::string_view range1, std::string_view range2) {
+    const auto rows = f.bins().at(GenomicInterval::parse_ucsc(f.chromosomes(), range1));
+    const auto cols = f.bins().at(GenomicInterval::parse_ucsc(f.chromosomes(), range2));
+    std::vector<ThinPixel<T>> expected{};
+    std::copy_if(all_pixels.begin(), all_pixels.end(), std::back_inserter(expected),
+                 [&](const ThinPixel<T>& p) {
+                   return p.bin1_id >= rows.first.id() && p.bin1_id <= rows.second.id() &&
+                          p.bin2_id >= cols.first.id() && p.bin2_id <= cols.second.id();
+                 });
+    return expected;
+  };
+
+  SECTION("full") {
+    for (const auto& [range1, range2] :
+         {std::make_pair("1:0-10000000", "1:0-10000000"),
+          std::make_pair("1:5000000-15000000", "1:0-10000000"),
+          std::make_pair("1:0-10000000", "1:5000000-15000000"),
+          std::make_pair("1:20000000-30000000", "1:0-10000000"),
+          std::make_pair("2:0-5000000", "1:0-5000000"),
+          std::make_pair("1:0-5000000", "2:0-5000000")}) {
+      const auto sel1 = f.fetch<T>(range1, range2, SymmetryMode::FULL);
+      const std::vector<ThinPixel<T>> pixels(sel1.begin_thin(), sel1.end_thin());
+      CHECK(pixels == expected_pixels(range1, range2));
+    }
+  }
+
+  SECTION("materialized pixels") {
+    const auto sel1 = f.fetch<T>("1:0-5000000", SymmetryMode::FULL);
+    const auto expected = expected_pixels("1:0-5000000", "1:0-5000000");
+    const std::vector<Pixel<T>> pixels(sel1.begin(), sel1.end());
+    REQUIRE(pixels.size() == expected.size());
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+      CHECK(pixels[i] == Pixel<T>{f.bins(), expected[i]});
+    }
+  }
+
+  SECTION("upper triangle") {
+    const auto sel1 =
+        f.fetch<T>("1:5000000-15000000", "1:0-10000000", SymmetryMode::UPPER_TRIANGLE);
+    const auto sel2 = f.fetch<T>("1:5000000-15000000", "1:0-10000000");
+    CHECK(std::vector<ThinPixel<T>>(sel1.begin_thin(), sel1.end_thin()) ==
+          std::vector<ThinPixel<T>>(sel2.begin_thin(), sel2.end_thin()));
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Pixel selector: async queries", "[pixel_selector][short]") {
+  using T = std::uint32_t;
+  const auto path = datadir / "cooler_test_file.cool";
+  auto f = File::open_read_only(path.string());
+  f.set_query_threads(2);
+  CHECK(f.query_threads() == 2);
+
+  const std::vector<std::pair<std::string, std::string>> queries{
+      {"1", "1"},
+      {"1:5000000-15000000", "1:0-10000000"},
+      {"1:0-5000000", "2:0-5000000"},
+      {"2", "2"},
+      {"3:0-1", "3:0-1"}};
+
+  std::vector<std::future<std::vector<PixelBlock<T>>>> futures{};
+  for (const auto& [range1, range2] : queries) {
+    futures.emplace_back(f.fetch_async<T>(range1, range2));
+  }
+
+  for (std::size_t i = 0; i < queries.size(); ++i) {
+    const auto sel = f.fetch<T>(queries[i].first, queries[i].second);
+    const std::vector<Pixel<T>> expected(sel.begin(), sel.end());
+
+    std::vector<Pixel<T>> pixels{};
+    for (const auto& blk : futures[i].get()) {
+      for (std::size_t j = 0; j < blk.size(); ++j) {
+        pixels.emplace_back(blk[j]);
+      }
+    }
+    CHECK(pixels == expected);
+  }
+
+  SECTION("invalid query") { CHECK_THROWS(f.fetch_async<T>("chr123")); }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Pixel selector: columnar blocks", "[pixel_selector][short]") {
+  using T = std::uint32_t;
+  const auto path = datadir / "cooler_test_file.cool";
+  auto f = File::open_read_only(path.string());
+
+  auto check_blocks = [](const auto& selector, std::size_t max_block_size) {
+    const std::vector<Pixel<T>> expected(selector.begin(), selector.end());
+    std::vector<Pixel<T>> pixels{};
+
+    selector.for_each_block(
+        [&](const PixelBlock<T>& blk) {
+          REQUIRE(!blk.empty());
+          CHECK(blk.size() <= max_block_size);
+          CHECK(blk.bin1_ids().size() == blk.size());
+          CHECK(blk.bin2_ids().size() == blk.size());
+          CHECK(blk.counts().size() == blk.size());
+          for (std::size_t i = 0; i < blk.size(); ++i) {
+            pixels.emplace_back(blk[i]);
+          }
+        },
+        max_block_size);
+
+    REQUIRE(pixels.size() == expected.size());
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+      CHECK(pixels[i] == expected[i]);
+    }
+  };
+
+  SECTION("whole file") {
+    auto first = f.begin<T>();
+    const auto last = f.end<T>();
+    auto expected = f.begin<T>();
+
+    std::ptrdiff_t nnz = 0;
+    while (first != last) {
+      const auto blk = first.read_block(1024);
+      REQUIRE(!blk.empty());
+      for (std::size_t i = 0; i < blk.size(); ++i, ++expected) {
+        CHECK(blk[i] == *expected);
+      }
+      nnz += static_cast<std::ptrdiff_t>(blk.size());
+    }
+    CHECK(expected == last);
+    CHECK(nnz == std::distance(f.begin<T>(), f.end<T>()));
+  }
+
+  SECTION("cis") { check_blocks(f.fetch<T>("1:5000000-5500000", "1:5000000-6500000"), 3); }
+
+  SECTION("trans") { check_blocks(f.fetch<T>("1:48000000-50000000", "4:30000000-35000000"), 2); }
+
+  SECTION("read_batch") {
+    const auto blocks = f.fetch<T>("1").read_batch();
+    const auto num_pixels = std::accumulate(
+        blocks.begin(), blocks.end(), std::size_t(0),
+        [](std::size_t accumulator, const PixelBlock<T>& blk) { return accumulator + blk.size(); });
+    const auto sel = f.fetch<T>("1");
+    CHECK(num_pixels == static_cast<std::size_t>(std::distance(sel.begin(), sel.end())));
+  }
+
+  SECTION("out of range") {
+    const auto blocks = f.fetch<T>("1:5000000-5500000").read_batch();
+    REQUIRE(!blocks.empty());
+    CHECK_THROWS_AS(blocks.front().at(blocks.front().size()), std::out_of_range);
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Pixel selector: thin pixels", "[pixel_selector][short]") {
+  using T = std::uint32_t;
+  const auto path = datadir / "cooler_test_file.cool";
+  auto f = File::open_read_only(path.string());
+
+  auto check_thin_pixels = [](const auto& selector) {
+    const std::vector<Pixel<T>> expected(selector.begin(), selector.end());
+    const std::vector<ThinPixel<T>> pixels(selector.begin_thin(), selector.end_thin());
+
+    REQUIRE(pixels.size() == expected.size());
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+      CHECK(pixels[i] == expected[i].to_thin());
+    }
+  };
+
+  SECTION("whole file") { check_thin_pixels(f.fetch<T>()); }
+  SECTION("cis") { check_thin_pixels(f.fetch<T>("1:5000000-5500000", "1:5000000-6500000")); }
+  SECTION("trans") { check_thin_pixels(f.fetch<T>("1:48000000-50000000", "4:30000000-35000000")); }
+  SECTION("banded") { check_thin_pixels(f.fetch<T>("1", std::uint64_t(10))); }
+  SECTION("empty") {
+    const auto sel = f.fetch<T>("1:0-100000", "1:0-100000");
+    CHECK(std::distance(sel.begin(), sel.end()) == std::distance(sel.begin_thin(), sel.end_thin()));
+  }
+
+  SECTION("append_pixels") {
+    const auto path2 = testdir() / "pixel_selector_thin_pixels.cool";
+    const auto sel = f.fetch<T>("1");
+    const std::vector<ThinPixel<T>> pixels(sel.begin_thin(), sel.end_thin());
+    {
+      auto clr = File::create_new_cooler<T>(path2.string(), f.chromosomes(), f.bin_size(), true);
+      clr.append_pixels(pixels.begin(), pixels.end(), true);
+    }
+    const auto clr = File::open_read_only(path2.string());
+    const auto sel2 = clr.fetch<T>();
+    const std::vector<ThinPixel<T>> written(sel2.begin_thin(), sel2.end_thin());
+    CHECK(written == pixels);
+    CHECK(clr.attributes().nnz == static_cast<std::int64_t>(pixels.size()));
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Pixel selector: visit_pixels", "[pixel_selector][short]") {
+  using T = std::int32_t;
+  const auto path = datadir / "cooler_test_file.cool";
+  const auto f = File::open_read_only(path.string());
+
+  auto collect = [](const auto& sel) {
+    using N = decltype(sel.begin()->count);
+    CHECK(std::is_same_v<N, T>);
+    std::vector<ThinPixel<T>> pixels{};
+    for (auto it = sel.begin_thin(); it != sel.end_thin(); ++it) {
+      pixels.push_back(ThinPixel<T>{it->bin1_id, it->bin2_id, static_cast<T>(it->count)});
+    }
+    return pixels;
+  };
+
+  auto to_thin = [](const auto& sel) {
+    return std::vector<ThinPixel<T>>(sel.begin_thin(), sel.end_thin());
+  };
+
+  SECTION("whole file") { CHECK(f.visit_pixels(collect) == to_thin(f.fetch<T>())); }
+  SECTION("cis") {
+    CHECK(f.visit_pixels(collect, "1:5000000-5500000") ==
+          to_thin(f.fetch<T>("1:5000000-5500000")));
+  }
+  SECTION("trans") {
+    constexpr std::string_view range1{"1:48000000-50000000"};
+    constexpr std::string_view range2{"4:30000000-35000000"};
+    CHECK(f.visit_pixels(collect, range1, range2) == to_thin(f.fetch<T>(range1, range2)));
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Pixel selector: fetch_many", "[pixel_selector][short]") {
+  using T = std::uint32_t;
+  const auto path = datadir / "cooler_test_file.cool";
+  const auto f = File::open_read_only(path.string());
+
+  // Queries overlap, are adjacent, are duplicated, are trans and are not sorted.
+  // Queries for rows 1:10000000-11500000 overlap distant columns, and are split by columns
+  const std::vector<std::pair<std::string, std::string>> ranges{
+      {"1:5000000-6000000", "1:5000000-8000000"},
+      {"1:48000000-50000000", "4:30000000-35000000"},
+      {"1:5500000-7000000", "1:6000000-6500000"},
+      {"1:7000000-7500000", "1:7000000-9000000"},
+      {"1:5000000-6000000", "1:5000000-8000000"},
+      {"2:0-1000000", "2:0-1000000"},
+      {"1:20000000-21000000", "1:20000000-21000000"},
+      {"1:10000000-11000000", "1:10000000-11000000"},
+      {"1:10500000-11500000", "1:100000000-101000000"},
+      {"1:10000000-10500000", "1:100500000-102000000"}};
+
+  std::vector<std::pair<GenomicInterval, GenomicInterval>> queries{};
+  for (const auto& [range1, range2] : ranges) {
+    queries.emplace_back(GenomicInterval::parse_ucsc(f.chromosomes(), range1),
+                         GenomicInterval::parse_ucsc(f.chromosomes(), range2));
+  }
+
+  std::vector<std::vector<Pixel<T>>> pixels(queries.size());
+  f.fetch_many<T>(queries,
+                  [&](std::size_t query_id, const Pixel<T>& p) { pixels[query_id].push_back(p); });
+
+  for (std::size_t i = 0; i < ranges.size(); ++i) {
+    const auto sel = f.fetch<T>(ranges[i].first, ranges[i].second);
+    const std::vector<Pixel<T>> expected(sel.begin(), sel.end());
+    REQUIRE(pixels[i].size() == expected.size());
+    for (std::size_t j = 0; j < expected.size(); ++j) {
+      CHECK(pixels[i][j] == expected[j]);
+    }
+  }
+  CHECK(!pixels.front().empty());
+  CHECK(pixels.front() == pixels[4]);
+
+  SECTION("no queries") {
+    f.fetch_many<T>({}, [](std::size_t, const Pixel<T>&) { FAIL(); });
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Pixel selector: lookup", "[pixel_selector][short]") {
+  using T = std::uint32_t;
+  const auto path = datadir / "cooler_test_file.cool";
+  const auto f = File::open_read_only(path.string());
+
+  const auto sel = f.fetch<T>("1:5000000-8000000");
+  const std::vector<ThinPixel<T>> pixels(sel.begin_thin(), sel.end_thin());
+  REQUIRE(pixels.size() > 10);
+
+  // Mix stored pixels, pixels that are not stored, pixels below the diagonal and duplicates, and
+  // use small blocks so that rows span multiple blocks
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> bin_pairs{};
+  std::vector<T> expected{};
+  for (const auto& p : pixels) {
+    bin_pairs.emplace_back(p.bin1_id, p.bin2_id);
+    expected.push_back(p.count);
+    bin_pairs.emplace_back(p.bin2_id, p.bin1_id);
+    expected.push_back(p.count);
+  }
+  // Pixels from the last row of the matrix
+  const auto last_bin = f.bins().at(f.bins().size() - 1);
+  const auto last_sel = f.fetch<T>(fmt::format(FMT_STRING("{}:{}-{}"), last_bin.chrom().name(),
+                                               last_bin.start(), last_bin.end()));
+  bin_pairs.emplace_back(last_bin.id(), last_bin.id());
+  expected.push_back(last_sel.begin() == last_sel.end() ? 0 : last_sel.begin()->count);
+
+  std::mt19937_64 rand_eng{12345};
+  std::vector<std::size_t> order(bin_pairs.size());
+  std::iota(order.begin(), order.end(), std::size_t(0));
+  std::shuffle(order.begin(), order.end(), rand_eng);
+  std::vector<std::pair<std::uint64_t, std::uint64_t>> shuffled_pairs{};
+  std::vector<T> shuffled_expected{};
+  for (const auto i : order) {
+    shuffled_pairs.push_back(bin_pairs[i]);
+    shuffled_expected.push_back(expected[i]);
+  }
+
+  SECTION("stored pixels") {
+    CHECK(f.lookup<T>(shuffled_pairs) == shuffled_expected);
+    CHECK(f.lookup<T, 3>(shuffled_pairs) == shuffled_expected);
+  }
+
+  SECTION("missing pixels") {
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> missing{};
+    for (std::size_t i = 1; i < pixels.size(); ++i) {
+      const auto& p1 = pixels[i - 1];
+      const auto& p2 = pixels[i];
+      if (p1.bin1_id == p2.bin1_id && p1.bin2_id + 1 < p2.bin2_id) {
+        missing.emplace_back(p1.bin1_id, p1.bin2_id + 1);
+      }
+    }
+    REQUIRE(!missing.empty());
+    CHECK(f.lookup<T, 2>(missing) == std::vector<T>(missing.size(), 0));
+  }
+
+  SECTION("empty") { CHECK(f.lookup<T>({}).empty()); }
+
+  SECTION("out of range") {
+    CHECK_THROWS_AS(f.lookup<T>({{0, f.bins().size()}}), std::out_of_range);
+  }
+
+  SECTION("last row") {
+    const auto path2 = testdir() / "pixel_selector_lookup.cool";
+    const ChromosomeSet chroms{Chromosome{0, "chr1", 100}, Chromosome{1, "chr2", 50}};
+    const auto expected_nnz = generate_test_data<T>(path2, chroms, 10);
+
+    const auto f2 = File::open_read_only(path2.string());
+    const auto last_bin_id = f2.bins().size() - 1;
+    // generate_test_data() numbers pixels from 1, so the last pixel has count equal to nnz
+    const std::vector<std::pair<std::uint64_t, std::uint64_t>> last_pixels{
+        {last_bin_id, last_bin_id}, {last_bin_id - 1, last_bin_id}};
+    CHECK(f2.lookup<T>(last_pixels) ==
+          std::vector<T>{static_cast<T>(expected_nnz), static_cast<T>(expected_nnz - 1)});
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Pixel selector: fetch_dense", "[pixel_selector][short]") {
+  using T = std::int32_t;
+  const auto path = datadir / "cooler_test_file.cool";
+  const auto f = File::open_read_only(path.string());
+
+  auto first_bin_id = [&](std::string_view range) {
+    return f.bins().at(GenomicInterval::parse_ucsc(f.chromosomes(), std::string{range})).first.id();
+  };
+  auto num_bins = [&](std::string_view range) {
+    const auto [first_bin, last_bin] =
+        f.bins().at(GenomicInterval::parse_ucsc(f.chromosomes(), std::string{range}));
+    return static_cast<std::size_t>(last_bin.id() - first_bin.id() + 1);
+  };
+
+  // Build the expected matrix from the upper-triangle pixels returned by fetch()
+  auto make_expected = [&](std::string_view range1, std::string_view range2, bool balance) {
+    const auto row_offset = first_bin_id(range1);
+    const auto col_offset = first_bin_id(range2);
+    const auto num_rows = num_bins(range1);
+    const auto num_cols = num_bins(range2);
+    std::vector<double> matrix(num_rows * num_cols, 0);
+
+    auto fill = [&](const auto& first, const auto& last, bool transpose) {
+      std::for_each(first, last, [&](const auto& p) {
+        auto i = p.coords.bin1.id();
+        auto j = p.coords.bin2.id();
+        if (transpose) {
+          std::swap(i, j);
+        }
+        matrix[((i - row_offset) * num_cols) + (j - col_offset)] = static_cast<double>(p.count);
+      });
+    };
+
+    for (const auto transpose : {false, true}) {
+      const auto sel = transpose ? f.fetch<T>(range2, range1) : f.fetch<T>(range1, range2);
+      if (balance) {
+        const Balancer<T> balanced(sel, f.read_weights("weight"));
+        fill(balanced.begin(), balanced.end(), transpose);
+      } else {
+        fill(sel.begin(), sel.end(), transpose);
+      }
+    }
+    return matrix;
+  };
+
+  auto check_matrix = [](const auto& matrix, const std::vector<double>& expected,
+                         std::size_t num_cols, std::size_t ld) {
+    REQUIRE(ld >= num_cols);
+    REQUIRE(matrix.size() / ld == expected.size() / num_cols);
+    for (std::size_t i = 0; i < expected.size() / num_cols; ++i) {
+      for (std::size_t j = 0; j < num_cols; ++j) {
+        const auto found = static_cast<double>(matrix[(i * ld) + j]);
+        const auto expected_value = expected[(i * num_cols) + j];
+        if (std::isnan(expected_value)) {
+          CHECK(std::isnan(found));
+        } else {
+          CHECK_THAT(found, Catch::Matchers::WithinRel(expected_value, 1.0e-6));
+        }
+      }
+    }
+  };
+
+  const std::vector<std::pair<std::string_view, std::string_view>> queries{
+      {"1:5000000-6000000", "1:5000000-6000000"},      // cis, symmetric
+      {"1:5000000-6000000", "1:5500000-7000000"},      // cis, overlapping
+      {"1:5500000-7000000", "1:5000000-6000000"},      // cis, lower triangle
+      {"1:48000000-50000000", "4:30000000-35000000"},  // trans
+      {"4:30000000-35000000", "1:48000000-50000000"}   // trans, lower triangle
+  };
+
+  SECTION("raw counts") {
+    for (const auto& [range1, range2] : queries) {
+      const auto num_cols = num_bins(range2);
+      const auto ld = num_cols + 3;
+      std::vector<T> matrix(num_bins(range1) * ld, -1);
+      f.fetch_dense(range1, range2, matrix.data(), ld);
+      check_matrix(matrix, make_expected(range1, range2, false), num_cols, ld);
+      // Padding is not touched
+      CHECK(matrix.back() == -1);
+    }
+  }
+
+  SECTION("float32") {
+    const auto [range1, range2] = queries.front();
+    std::vector<float> matrix(num_bins(range1) * num_bins(range2));
+    f.fetch_dense(range1, range2, matrix.data(), num_bins(range2));
+    check_matrix(matrix, make_expected(range1, range2, false), num_bins(range2), num_bins(range2));
+  }
+
+  SECTION("balanced") {
+    const auto weights = f.read_weights("weight");
+    for (const auto& [range1, range2] : queries) {
+      const auto num_cols = num_bins(range2);
+      std::vector<double> matrix(num_bins(range1) * num_cols);
+      f.fetch_dense(range1, range2, *weights, matrix.data(), num_cols);
+      check_matrix(matrix, make_expected(range1, range2, true), num_cols, num_cols);
+    }
+  }
+
+  SECTION("balanced integer counts") {
+    // NaNs are stored as 0 and balanced counts are truncated
+    const auto weights = f.read_weights("weight");
+    const auto [range1, range2] = queries.front();
+    const auto num_cols = num_bins(range2);
+    std::vector<T> matrix(num_bins(range1) * num_cols);
+    f.fetch_dense(range1, range2, *weights, matrix.data(), num_cols);
+    const auto expected = make_expected(range1, range2, true);
+    REQUIRE(matrix.size() == expected.size());
+    for (std::size_t i = 0; i < matrix.size(); ++i) {
+      if (std::isnan(expected[i])) {
+        CHECK(matrix[i] == 0);
+      } else {
+        CHECK(std::abs(static_cast<double>(matrix[i]) - expected[i]) < 1.0);
+      }
+    }
+
+    // Balanced counts that overflow the output type
+    const Weights large_weights(std::vector<double>(f.bins().size(), 1.0e3),
+                                Weights::Type::MULTIPLICATIVE);
+    std::vector<std::uint8_t> matrix2(num_bins(range1) * num_cols);
+    CHECK_THROWS_WITH(
+        f.fetch_dense(range1, range2, large_weights, matrix2.data(), num_cols),
+        Catch::Matchers::ContainsSubstring("cannot be represented as"));
+  }
+
+  SECTION("invalid ld") {
+    std::vector<T> matrix(num_bins("1:0-1000000") * num_bins("1:0-1000000"));
+    CHECK_THROWS(f.fetch_dense("1:0-1000000", "1:0-1000000", matrix.data(), 1));
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Pixel selector: banded queries", "[pixel_selector][short]") {
+  using T = std::int32_t;
+  const auto path = datadir / "cooler_test_file.cool";
+  const auto f = File::open_read_only(path.string());
+
+  auto select_band = [](const auto& sel, std::uint64_t max_distance) {
+    std::vector<Pixel<T>> pixels{};
+    std::copy_if(sel.begin(), sel.end(), std::back_inserter(pixels), [&](const Pixel<T>& p) {
+      return p.coords.bin2.id() - p.coords.bin1.id() <= max_distance;
+    });
+    return pixels;
+  };
+
+  auto read_blocks = [](const auto& sel) {
+    std::vector<Pixel<T>> pixels{};
+    sel.for_each_block([&](const PixelBlock<T>& blk) {
+      for (std::size_t i = 0; i < blk.size(); ++i) {
+        pixels.emplace_back(blk[i]);
+      }
+    });
+    return pixels;
+  };
+
+  for (const std::uint64_t max_distance : {0, 1, 10, 100}) {
+    SECTION(fmt::format(FMT_STRING("cis (max distance = {})"), max_distance)) {
+      const auto sel = f.fetch<T>("1", max_distance);
+      CHECK(sel.max_diagonal_distance() == max_distance);
+      const auto expected = select_band(f.fetch<T>("1"), max_distance);
+      REQUIRE(!expected.empty());
+      CHECK(std::vector<Pixel<T>>(sel.begin(), sel.end()) == expected);
+      CHECK(read_blocks(sel) == expected);
+    }
+
+    SECTION(fmt::format(FMT_STRING("partial query (max distance = {})"), max_distance)) {
+      const auto sel = f.fetch<T>("1:5000000-10000000", max_distance);
+      const auto expected = select_band(f.fetch<T>("1:5000000-10000000"), max_distance);
+      CHECK(std::vector<Pixel<T>>(sel.begin(), sel.end()) == expected);
+    }
+  }
+
+  SECTION("trans pixels") {
+    // The distance between bins of adjacent chromosomes can be smaller than max_distance
+    constexpr std::uint64_t max_distance = 100;
+    auto sel = f.fetch<T>();
+    sel.set_max_diagonal_distance(max_distance);
+    std::vector<Pixel<T>> expected{};
+    const auto all = f.fetch<T>();
+    std::copy_if(all.begin(), all.end(), std::back_inserter(expected), [&](const Pixel<T>& p) {
+      return p.coords.bin1.chrom() == p.coords.bin2.chrom() &&
+             p.coords.bin2.id() - p.coords.bin1.id() <= max_distance;
+    });
+    REQUIRE(!expected.empty());
+    const std::vector<Pixel<T>> pixels(sel.begin(), sel.end());
+    CHECK(pixels == expected);
+    CHECK(read_blocks(sel) == expected);
+  }
+
+  SECTION("unbounded") {
+    const auto sel = f.fetch<T>("1", (std::numeric_limits<std::uint64_t>::max)());
+    const auto expected = f.fetch<T>("1");
+    CHECK(std::vector<Pixel<T>>(sel.begin(), sel.end()) ==
+          std::vector<Pixel<T>>(expected.begin(), expected.end()));
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Pixel selector: filters", "[pixel_selector][short]") {
+  using T = std::int32_t;
+  const auto path = datadir / "cooler_test_file.cool";
+  const auto f = File::open_read_only(path.string());
+
+  auto apply_filter = [](const auto& sel, const PixelFilter& filter) {
+    std::vector<Pixel<T>> pixels{};
+    std::copy_if(sel.begin(), sel.end(), std::back_inserter(pixels), [&](const Pixel<T>& p) {
+      const auto cis = p.coords.bin1.chrom() == p.coords.bin2.chrom();
+      return (!filter.min_count || p.count >= *filter.min_count) &&
+             (filter.contact_type == ContactType::ALL ||
+              cis == (filter.contact_type == ContactType::CIS));
+    });
+    return pixels;
+  };
+
+  auto read_blocks = [](const auto& sel) {
+    std::vector<Pixel<T>> pixels{};
+    sel.for_each_block([&](const PixelBlock<T>& blk) {
+      for (std::size_t i = 0; i < blk.size(); ++i) {
+        pixels.emplace_back(blk[i]);
+      }
+    });
+    return pixels;
+  };
+
+  for (const auto contact_type : {ContactType::ALL, ContactType::CIS, ContactType::TRANS}) {
+    for (const std::optional<double> min_count : {std::optional<double>{}, std::optional{5.0}}) {
+      const PixelFilter filter{min_count, contact_type};
+      SECTION(fmt::format(FMT_STRING("entire matrix (contact type = {}; min count = {})"),
+                          static_cast<int>(contact_type), min_count.value_or(0))) {
+        const auto sel = f.fetch<T>(filter);
+        const auto expected = apply_filter(f.fetch<T>(), filter);
+        REQUIRE(!expected.empty());
+        CHECK(std::vector<Pixel<T>>(sel.begin(), sel.end()) == expected);
+        CHECK(read_blocks(sel) == expected);
+      }
+
+      SECTION(fmt::format(FMT_STRING("cis query (contact type = {}; min count = {})"),
+                          static_cast<int>(contact_type), min_count.value_or(0))) {
+        const auto sel = f.fetch<T>("1:5000000-10000000", filter);
+        const auto expected = apply_filter(f.fetch<T>("1:5000000-10000000"), filter);
+        CHECK(std::vector<Pixel<T>>(sel.begin(), sel.end()) == expected);
+        CHECK(read_blocks(sel) == expected);
+      }
+
+      SECTION(fmt::format(FMT_STRING("trans query (contact type = {}; min count = {})"),
+                          static_cast<int>(contact_type), min_count.value_or(0))) {
+        auto sel = f.fetch<T>("1", "4");
+        sel.set_filter(filter);
+        const auto expected = apply_filter(f.fetch<T>("1", "4"), filter);
+        CHECK(std::vector<Pixel<T>>(sel.begin(), sel.end()) == expected);
+      }
+    }
+  }
+
+  SECTION("CSR matrices") {
+    auto sel = f.fetch<T>("1", "4");
+    const auto expected = sel.read_csr();
+    sel.set_filter(PixelFilter{5.0});
+    const auto filtered = sel.read_csr();
+    CHECK(filtered.nnz() < expected.nnz());
+    CHECK(filtered.nnz() == apply_filter(f.fetch<T>("1", "4"), PixelFilter{5.0}).size());
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Pixel selector: CSR matrices", "[pixel_selector][short]") {
+  using T = std::int32_t;
+  const auto path = datadir / "cooler_test_file.cool";
+  const auto f = File::open_read_only(path.string());
+
+  // Convert a CSR matrix back to pixels
+  auto to_pixels = [&](const SparseMatrixCSR<T>& m) {
+    std::vector<Pixel<T>> pixels{};
+    const auto row_ptrs = m.row_ptrs();
+    for (std::uint64_t i = 0; i < m.num_rows(); ++i) {
+      for (auto k = row_ptrs[i]; k < row_ptrs[i + 1]; ++k) {
+        pixels.emplace_back(Pixel<T>{f.bins(), m.first_row() + i, m.first_col() + m.col_ids()[k],
+                                     m.values()[k]});
+      }
+    }
+    return pixels;
+  };
+
+  SECTION("entire matrix") {
+    const auto m = f.fetch<T>().read_csr();
+    CHECK(m.first_row() == 0);
+    CHECK(m.first_col() == 0);
+    CHECK(m.num_rows() == f.bins().size());
+    CHECK(m.num_cols() == f.bins().size());
+    CHECK(m.nnz() == f.dataset("pixels/count").size());
+    CHECK(m.row_ptrs().size() == m.num_rows() + 1);
+    CHECK(to_pixels(m) == std::vector<Pixel<T>>(f.begin<T>(), f.end<T>()));
+  }
+
+  SECTION("queries") {
+    for (const auto* query : {"1", "1:5000000-10000000", "2:0-2000000"}) {
+      const auto sel = f.fetch<T>(query);
+      const auto m = sel.read_csr();
+      CHECK(m.first_row() == sel.coord1().bin1.id());
+      CHECK(m.num_rows() == sel.coord1().bin2.id() - sel.coord1().bin1.id() + 1);
+      CHECK(to_pixels(m) == std::vector<Pixel<T>>(sel.begin(), sel.end()));
+    }
+
+    const auto sel = f.fetch<T>("1:0-10000000", "1:5000000-20000000");
+    const auto m = sel.read_csr();
+    CHECK(m.first_col() == sel.coord2().bin1.id());
+    CHECK(to_pixels(m) == std::vector<Pixel<T>>(sel.begin(), sel.end()));
+
+    const auto sel_trans = f.fetch<T>("1", "2");
+    CHECK(to_pixels(sel_trans.read_csr()) ==
+          std::vector<Pixel<T>>(sel_trans.begin(), sel_trans.end()));
+  }
+
+  SECTION("banded query") {
+    const auto sel = f.fetch<T>("1", 10);
+    CHECK(to_pixels(sel.read_csr()) == std::vector<Pixel<T>>(sel.begin(), sel.end()));
+  }
+
+  SECTION("element access") {
+    const auto sel = f.fetch<T>("1:0-10000000");
+    const auto m = sel.read_csr();
+    for (const auto& p : sel) {
+      CHECK(m(p.coords.bin1.id() - m.first_row(), p.coords.bin2.id() - m.first_col()) == p.count);
+    }
+    CHECK_THROWS(m(m.num_rows(), 0));
+  }
+
+  SECTION("symmetric expansion") {
+    const auto sel = f.fetch<T>("1:0-10000000");
+    const auto m = sel.read_csr().expand_symmetric();
+
+    std::size_t nnz = 0;
+    for (const auto& p : sel) {
+      const auto i = p.coords.bin1.id() - m.first_row();
+      const auto j = p.coords.bin2.id() - m.first_col();
+      CHECK(m(i, j) == p.count);
+      CHECK(m(j, i) == p.count);
+      nnz += i == j ? 1 : 2;
+    }
+    CHECK(m.nnz() == nnz);
+
+    const auto row_ptrs = m.row_ptrs();
+    const auto* col_ids = m.col_ids().data();
+    for (std::uint64_t i = 0; i < m.num_rows(); ++i) {
+      CHECK(std::is_sorted(col_ids + row_ptrs[i], col_ids + row_ptrs[i + 1]));
+    }
+
+    CHECK_THROWS(f.fetch<T>("1", "2").read_csr().expand_symmetric());
+  }
+}
+
 }  // namespace coolerpp::test::pixel_selector
@@ -4,8 +4,13 @@
 
 #include "coolerpp/pixel.hpp"
 
+#include <fmt/format.h>
+
 #include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <type_traits>
 
+#include "coolerpp/bin_table.hpp"
 #include "coolerpp/chromosome.hpp"
 
 namespace coolerpp {
@@ -117,4 +122,44 @@ TEST_CASE("Pixel", "[pixel][short]") {
   }
 }
 
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("ThinPixel", "[pixel][short]") {
+  static_assert(std::is_trivially_copyable_v<ThinPixel<std::int32_t>>);
+  static_assert(sizeof(ThinPixel<std::int32_t>) < sizeof(Pixel<std::int32_t>));
+  static_assert(sizeof(ThinPixel<std::int32_t>) ==
+                (2 * sizeof(std::uint64_t)) + alignof(std::uint64_t));
+  static_assert(is_thin_pixel_v<const ThinPixel<double>>);
+  static_assert(!is_thin_pixel_v<Pixel<double>>);
+
+  constexpr ThinPixel<std::int32_t> p1{0, 1, 10};
+  constexpr ThinPixel<std::int32_t> p2{0, 2, 5};
+  constexpr ThinPixel<std::int32_t> p3{1, 1, 1};
+
+  SECTION("(dis)equality") {
+    CHECK(p1 == p1);
+    CHECK(p1 != p2);
+    CHECK(p1 != ThinPixel<std::int32_t>{0, 1, 11});
+  }
+
+  SECTION("ordering") {
+    CHECK(p1 < p2);
+    CHECK(p2 < p3);
+    CHECK(p1 <= p1);
+    CHECK(p3 > p1);
+    CHECK(p3 >= p2);
+    CHECK(ThinPixel<std::int32_t>{0, 1, 9} < p1);
+  }
+
+  SECTION("conversion") {
+    const BinTable bins{ChromosomeSet{Chromosome{0, "chr1", 100}, Chromosome{1, "chr2", 50}}, 10};
+    const Pixel<std::int32_t> p{bins, ThinPixel<std::int32_t>{3, 12, 7}};
+    CHECK(p.coords.bin1 == bins.at(3));
+    CHECK(p.coords.bin2 == bins.at(12));
+    CHECK(p.count == 7);
+    CHECK(p.to_thin() == ThinPixel<std::int32_t>{3, 12, 7});
+  }
+
+  SECTION("fmt") { CHECK(fmt::format(FMT_STRING("{}"), p2) == "0\t2\t5"); }
+}
+
 }  // namespace coolerpp
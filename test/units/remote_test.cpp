@@ -0,0 +1,73 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include "coolerpp/remote.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+#include <string>
+
+#include "coolerpp/chromosome.hpp"
+#include "coolerpp/coolerpp.hpp"
+
+namespace coolerpp::test::remote {
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Remote: URLs", "[remote][short]") {
+  SECTION("is_remote_path") {
+    CHECK(is_remote_path("s3://bucket/test.cool"));
+    CHECK(is_remote_path("http://localhost:8080/test.cool"));
+    CHECK(is_remote_path("https://example.com/test.mcool"));
+    CHECK(!is_remote_path("test/data/test.cool"));
+    CHECK(!is_remote_path("/tmp/s3://test.cool"));
+    CHECK(!is_remote_path(""));
+  }
+
+  SECTION("to_https_url") {
+    CHECK(internal::to_https_url("s3://bucket/dir/test.cool") ==
+          "https://bucket.s3.amazonaws.com/dir/test.cool");
+    CHECK(internal::to_https_url("s3://bucket/test.cool", "eu-north-1") ==
+          "https://bucket.s3.eu-north-1.amazonaws.com/test.cool");
+    CHECK(internal::to_https_url("https://example.com/test.cool", "eu-north-1") ==
+          "https://example.com/test.cool");
+
+    CHECK_THROWS_WITH(internal::to_https_url("s3://bucket"),
+                      Catch::Matchers::ContainsSubstring("invalid S3 URL"));
+    CHECK_THROWS_WITH(internal::to_https_url("s3://bucket/"),
+                      Catch::Matchers::ContainsSubstring("invalid S3 URL"));
+    CHECK_THROWS_WITH(internal::to_https_url("s3:///test.cool"),
+                      Catch::Matchers::ContainsSubstring("invalid S3 URL"));
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Remote: options", "[remote][short]") {
+  RemoteOptions options{};
+  CHECK(!options.authenticate());
+
+  options.aws_region = "eu-north-1";
+  options.secret_id = "id";
+  CHECK(!options.authenticate());
+  options.secret_key = "key";
+  CHECK(options.authenticate());
+
+  if constexpr (ros3_available()) {
+    CHECK_NOTHROW(internal::init_remote_file_access_props(options));
+    options.aws_region = std::string(64, 'x');
+    CHECK_THROWS_WITH(internal::init_remote_file_access_props(options),
+                      Catch::Matchers::ContainsSubstring("AWS region is too long"));
+  } else {
+    CHECK_THROWS_WITH(internal::init_remote_file_access_props(options),
+                      Catch::Matchers::ContainsSubstring("without support for the ROS3"));
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("Remote: remote files are read-only", "[remote][short]") {
+  const ChromosomeSet chroms{Chromosome{0, "chr1", 1000}};
+  CHECK_THROWS_WITH(File::create_new_cooler("s3://bucket/test.cool", chroms, 10),
+                    Catch::Matchers::ContainsSubstring("can only be opened in read-only mode"));
+}
+
+}  // namespace coolerpp::test::remote
@@ -0,0 +1,113 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include "coolerpp/singlecell_file.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "coolerpp/test/self_deleting_folder.hpp"
+#include "coolerpp/validation.hpp"
+
+namespace coolerpp::test {
+inline const SelfDeletingFolder testdir{true};            // NOLINT(cert-err58-cpp)
+inline const std::filesystem::path datadir{"test/data"};  // NOLINT(cert-err58-cpp)
+}  // namespace coolerpp::test
+
+namespace coolerpp::test::singlecell_file {
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("SingleCellFile: open", "[cooler][short]") {
+  const auto path = datadir / "single_cell_cooler_test_file.scool";
+
+  SECTION("valid .scool") {
+    const auto sclr = SingleCellFile::open_read_only(path.string());
+    CHECK(sclr.path() == path);
+    CHECK(sclr.bin_size() == 100'000);
+    CHECK(sclr.cells().size() == 5);
+    CHECK(sclr.has_cell("GSM2687248_41669_ACAGTG-R1-DpnII.100000.cool"));
+    CHECK(!sclr.has_cell("GSM2687248"));
+    CHECK(static_cast<std::int64_t>(sclr.bins().size()) ==
+          *sclr.open(sclr.cells().front()).attributes().nbins);
+  }
+
+  SECTION("invalid .scool") {
+    CHECK_THROWS_WITH(
+        SingleCellFile::open_read_only((datadir / "cooler_test_file.cool").string()),
+        Catch::Matchers::ContainsSubstring("does not look like a valid single-cell Cooler file"));
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("SingleCellFile: open cells", "[cooler][short]") {
+  using N = std::int32_t;
+  const auto path = datadir / "single_cell_cooler_test_file.scool";
+  const auto sclr = SingleCellFile::open_read_only(path.string());
+
+  for (const auto &cell : sclr.cells()) {
+    const auto clr = sclr.open(cell);
+    const auto expected = File::open_read_only(path.string() + "::/cells/" + cell);
+
+    // All cells share the same bin table
+    CHECK(clr.bins_ptr() == sclr.bins_ptr());
+    CHECK(clr.uri() == expected.uri());
+    CHECK(clr.chromosomes() == expected.chromosomes());
+    CHECK(clr.attributes().nnz == expected.attributes().nnz);
+
+    const auto sel1 = clr.fetch<N>();
+    const auto sel2 = expected.fetch<N>();
+    const std::vector<ThinPixel<N>> pixels1(sel1.begin_thin(), sel1.end_thin());
+    const std::vector<ThinPixel<N>> pixels2(sel2.begin_thin(), sel2.end_thin());
+    CHECK(pixels1 == pixels2);
+  }
+
+  CHECK_THROWS_WITH(sclr.open("GSM2687248"),
+                    Catch::Matchers::ContainsSubstring("does not have cell \"GSM2687248\""));
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("SingleCellFile: create", "[cooler][short]") {
+  using N = std::int32_t;
+  const auto path = (testdir() / "test_create.scool").string();
+  const ChromosomeSet chroms{Chromosome{0, "chr1", 10000}, Chromosome{1, "chr2", 5000}};
+  constexpr std::uint32_t bin_size = 1000;
+
+  const std::vector<std::string> cell_ids{"cell2", "cell1", "cell3"};
+  {
+    auto sclr = SingleCellFile::create(path, chroms, bin_size, true);
+    for (std::size_t i = 0; i < cell_ids.size(); ++i) {
+      const auto n = static_cast<N>(i + 1);
+      const std::vector<ThinPixel<N>> pixels{{0, 0, n}, {0, 5, n}, {3, 12, n}, {11, 14, n}};
+      sclr.append_cell(cell_ids[i], pixels.begin(), pixels.end(), true);
+    }
+
+    CHECK_THROWS_WITH(sclr.create_cell<N>("cell1"),
+                      Catch::Matchers::ContainsSubstring("already has cell \"cell1\""));
+    CHECK_THROWS_WITH(sclr.create_cell<N>("cells/cell4"),
+                      Catch::Matchers::ContainsSubstring("invalid cell name"));
+  }
+
+  CHECK(utils::is_scool_file(path));
+
+  const auto sclr = SingleCellFile::open_read_only(path);
+  const std::vector<std::string> expected_cells{"cell1", "cell2", "cell3"};
+  CHECK(sclr.cells() == expected_cells);
+  CHECK(sclr.bins() == BinTable(chroms, bin_size));
+
+  for (std::size_t i = 0; i < cell_ids.size(); ++i) {
+    const auto clr = sclr.open(cell_ids[i]);
+    const auto sel = clr.fetch<N>();
+    const std::vector<ThinPixel<N>> pixels(sel.begin_thin(), sel.end_thin());
+    REQUIRE(pixels.size() == 4);
+    CHECK(pixels.front().count == static_cast<N>(i + 1));
+    CHECK(pixels.back().bin1_id == 11);
+    CHECK(pixels.back().bin2_id == 14);
+  }
+}
+
+}  // namespace coolerpp::test::singlecell_file
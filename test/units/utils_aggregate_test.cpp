@@ -0,0 +1,70 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include <fmt/format.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/singlecell_file.hpp"
+#include "coolerpp/test/self_deleting_folder.hpp"
+#include "coolerpp/utils.hpp"
+
+namespace coolerpp::test {
+inline const SelfDeletingFolder testdir{true};            // NOLINT(cert-err58-cpp)
+inline const std::filesystem::path datadir{"test/data"};  // NOLINT(cert-err58-cpp)
+}  // namespace coolerpp::test
+
+namespace coolerpp::test::aggregate {
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("utils: aggregate cells", "[aggregate][utils][short]") {
+  const auto path = datadir / "single_cell_cooler_test_file.scool";
+  const auto cells = SingleCellFile::open_read_only(path.string()).cells();
+  REQUIRE(cells.size() == 5);
+
+  auto cell_uri = [&](const auto &cell) { return path.string() + "::/cells/" + cell; };
+
+  // Cell 2 belongs to both clusters
+  const std::vector<std::pair<std::string, std::string>> cell_clusters{
+      {cells[0], "A"}, {cells[1], "A"}, {cells[2], "A"},
+      {cells[2], "B"}, {cells[3], "B"}, {cells[4], "B"}};
+  const std::vector<std::string> uris_a{cell_uri(cells[0]), cell_uri(cells[1]),
+                                        cell_uri(cells[2])};
+  const std::vector<std::string> uris_b{cell_uri(cells[2]), cell_uri(cells[3]),
+                                        cell_uri(cells[4])};
+
+  SECTION("pseudo-bulk") {
+    const auto expected_a = testdir() / "aggregate_cells_expected_A.cool";
+    const auto expected_b = testdir() / "aggregate_cells_expected_B.cool";
+    utils::merge(uris_a.begin(), uris_a.end(), expected_a.string(), true);
+    utils::merge(uris_b.begin(), uris_b.end(), expected_b.string(), true);
+
+    for (const std::size_t num_threads : {1, 3}) {
+      const auto prefix =
+          (testdir() / fmt::format(FMT_STRING("aggregate_cells_{}_"), num_threads)).string();
+      const auto uris =
+          utils::aggregate_cells(path.string(), cell_clusters, prefix, true, num_threads);
+      REQUIRE(uris.size() == 2);
+      CHECK(uris[0] == prefix + "A.cool");
+      CHECK(uris[1] == prefix + "B.cool");
+
+      CHECK(utils::equal(uris[0], expected_a.string()));
+      CHECK(utils::equal(uris[1], expected_b.string()));
+    }
+  }
+
+  SECTION("unknown cell") {
+    const std::vector<std::pair<std::string, std::string>> invalid{{"GSM2687248", "A"}};
+    CHECK_THROWS_WITH(
+        utils::aggregate_cells(path.string(), invalid, (testdir() / "invalid_").string(), true),
+        Catch::Matchers::ContainsSubstring("does not have cell \"GSM2687248\""));
+  }
+}
+
+}  // namespace coolerpp::test::aggregate
@@ -0,0 +1,75 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include <fmt/format.h>
+
+#include <array>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+#include "coolerpp/test/self_deleting_folder.hpp"
+#include "coolerpp/utils.hpp"
+
+namespace coolerpp::test {
+inline const SelfDeletingFolder testdir{true};            // NOLINT(cert-err58-cpp)
+inline const std::filesystem::path datadir{"test/data"};  // NOLINT(cert-err58-cpp)
+}  // namespace coolerpp::test
+
+namespace coolerpp::test::index {
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("utils: coarsen", "[coarsen][utils][short]") {
+  const auto mclr = datadir / "multires_cooler_test_file.mcool";
+  const auto src = fmt::format(FMT_STRING("{}::/resolutions/100000"), mclr.string());
+
+  SECTION("coarsen") {
+    const auto dest = testdir() / "cooler_coarsen_test.cool";
+    const auto expected = fmt::format(FMT_STRING("{}::/resolutions/400000"), mclr.string());
+
+    utils::coarsen(src, dest.string(), 4, true);
+    CHECK(utils::equal(dest.string(), expected));
+
+    const auto clr1 = File::open_read_only(src);
+    const auto clr2 = File::open_read_only(dest.string());
+    CHECK(clr2.bin_size() == 400000);
+    CHECK(clr1.attributes().sum == clr2.attributes().sum);
+    CHECK(clr1.attributes().cis == clr2.attributes().cis);
+  }
+
+  SECTION("invalid factor") {
+    const auto dest = testdir() / "cooler_coarsen_test_invalid.cool";
+    CHECK_THROWS_AS(utils::coarsen(src, dest.string(), 0, true), std::logic_error);
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("utils: zoomify", "[coarsen][utils][short]") {
+  const auto mclr = datadir / "multires_cooler_test_file.mcool";
+  const auto src = fmt::format(FMT_STRING("{}::/resolutions/100000"), mclr.string());
+  const auto dest = testdir() / "cooler_zoomify_test.mcool";
+
+  SECTION("zoomify") {
+    constexpr std::array<std::uint32_t, 3> resolutions{200000, 400000, 800000};
+    utils::zoomify(src, dest.string(), resolutions.begin(), resolutions.end(), true);
+
+    CHECK(utils::is_multires_file(dest.string()));
+    for (const auto res : {100000U, 200000U, 400000U, 800000U}) {
+      const auto uri1 = fmt::format(FMT_STRING("{}::/resolutions/{}"), dest.string(), res);
+      const auto uri2 = fmt::format(FMT_STRING("{}::/resolutions/{}"), mclr.string(), res);
+      CHECK(utils::equal(uri1, uri2));
+    }
+  }
+
+  SECTION("invalid resolutions") {
+    constexpr std::array<std::uint32_t, 1> resolutions{250000};
+    CHECK_THROWS_WITH(
+        utils::zoomify(src, dest.string(), resolutions.begin(), resolutions.end(), true),
+        Catch::Matchers::ContainsSubstring("is not a multiple of the base resolution"));
+  }
+}
+}  // namespace coolerpp::test::index
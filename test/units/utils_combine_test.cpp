@@ -0,0 +1,143 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "coolerpp/balancing.hpp"
+#include "coolerpp/test/self_deleting_folder.hpp"
+#include "coolerpp/utils.hpp"
+
+namespace coolerpp::test {
+inline const SelfDeletingFolder testdir{true};            // NOLINT(cert-err58-cpp)
+inline const std::filesystem::path datadir{"test/data"};  // NOLINT(cert-err58-cpp)
+}  // namespace coolerpp::test
+
+namespace coolerpp::test::index {
+
+template <typename N>
+static std::vector<ThinPixel<N>> read_pixels(const std::string& uri) {
+  const auto clr = File::open_read_only(uri);
+  const auto sel = clr.fetch<N>();
+  return {sel.begin_thin(), sel.end_thin()};
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("utils: combine", "[combine][utils][short]") {
+  using N = std::int32_t;
+  const auto src = (datadir / "cooler_test_file.cool").string();
+  const auto subset = (testdir() / "cooler_combine_test_subset.cool").string();
+  const auto dest = (testdir() / "cooler_combine_test.cool").string();
+
+  // The second cooler only stores pixels with an odd bin2_id
+  const auto pixels = read_pixels<N>(src);
+  {
+    const auto clr = File::open_read_only(src);
+    std::vector<std::uint64_t> bin1_ids{};
+    std::vector<std::uint64_t> bin2_ids{};
+    std::vector<N> counts{};
+    for (const auto& p : pixels) {
+      if (p.bin2_id % 2 == 1) {
+        bin1_ids.push_back(p.bin1_id);
+        bin2_ids.push_back(p.bin2_id);
+        counts.push_back(p.count);
+      }
+    }
+    auto f = File::create_new_cooler<N>(subset, clr.chromosomes(), clr.bin_size(), true);
+    f.append_pixels_columns(bin1_ids.data(), bin2_ids.data(), counts.data(), bin1_ids.size());
+  }
+
+  utils::CombineOptions opts{};
+  opts.overwrite_if_exists = true;
+  // Use small chunks so that pixels are joined across multiple chunks
+  opts.chunk_size = 1'000;
+
+  SECTION("sum") {
+    std::vector<ThinPixel<N>> expected{pixels};
+    for (auto& p : expected) {
+      p.count *= p.bin2_id % 2 == 1 ? 2 : 1;
+    }
+
+    for (const auto num_threads : {std::size_t(1), std::size_t(3)}) {
+      opts.num_threads = num_threads;
+      utils::combine(src, subset, dest, utils::CombineOp::SUM, opts);
+      CHECK(!File::open_read_only(dest).has_float_pixels());
+      CHECK(read_pixels<N>(dest) == expected);
+    }
+  }
+
+  SECTION("difference") {
+    std::vector<ThinPixel<N>> expected{};
+    for (const auto& p : pixels) {
+      if (p.bin2_id % 2 == 0) {
+        expected.push_back(p);
+      }
+    }
+    REQUIRE(!expected.empty());
+
+    utils::combine(src, subset, dest, utils::CombineOp::DIFFERENCE, opts);
+    CHECK(read_pixels<N>(dest) == expected);
+
+    // Pixels found in both coolers have the same counts
+    opts.fill_zero = false;
+    utils::combine(src, subset, dest, utils::CombineOp::DIFFERENCE, opts);
+    CHECK(read_pixels<N>(dest).empty());
+  }
+
+  SECTION("ratio with pseudocount") {
+    opts.pseudocount = 1.0;
+    opts.num_threads = 2;
+    utils::combine(src, subset, dest, utils::CombineOp::LOG2_RATIO, opts);
+    CHECK(File::open_read_only(dest).has_float_pixels());
+
+    std::vector<ThinPixel<double>> expected{};
+    for (const auto& p : pixels) {
+      if (p.bin2_id % 2 == 0) {
+        // log2((count + 1) / (0 + 1))
+        expected.push_back(
+            ThinPixel<double>{p.bin1_id, p.bin2_id, std::log2(static_cast<double>(p.count) + 1)});
+      }
+    }
+
+    const auto found = read_pixels<double>(dest);
+    REQUIRE(found.size() == expected.size());
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+      CHECK(found[i].bin1_id == expected[i].bin1_id);
+      CHECK(found[i].bin2_id == expected[i].bin2_id);
+      CHECK_THAT(found[i].count, Catch::Matchers::WithinRel(expected[i].count, 1.0e-9));
+    }
+  }
+
+  SECTION("balanced ratio") {
+    const auto path = (datadir / "ENCFF993FGR.2500000.cool").string();
+    opts.weights = "weight";
+    utils::combine(path, path, dest, utils::CombineOp::RATIO, opts);
+
+    const auto clr = File::open_read_only(path);
+    const Balancer balanced(clr.fetch<N>(), clr.read_weights("weight"));
+    std::size_t expected_nnz = 0;
+    for (const auto& p : balanced) {
+      expected_nnz += static_cast<std::size_t>(p.count != 0 && std::isfinite(p.count));
+    }
+
+    const auto found = read_pixels<double>(dest);
+    CHECK(found.size() == expected_nnz);
+    for (const auto& p : found) {
+      CHECK_THAT(p.count, Catch::Matchers::WithinRel(1.0, 1.0e-9));
+    }
+  }
+
+  SECTION("different bin tables") {
+    const auto path = (datadir / "ENCFF993FGR.2500000.cool").string();
+    CHECK_THROWS(utils::combine(src, path, dest, utils::CombineOp::SUM, opts));
+  }
+}
+
+}  // namespace coolerpp::test::index
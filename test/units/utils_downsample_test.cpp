@@ -0,0 +1,129 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <variant>
+#include <vector>
+
+#include "coolerpp/test/self_deleting_folder.hpp"
+#include "coolerpp/utils.hpp"
+
+namespace coolerpp::test {
+inline const SelfDeletingFolder testdir{true};            // NOLINT(cert-err58-cpp)
+inline const std::filesystem::path datadir{"test/data"};  // NOLINT(cert-err58-cpp)
+}  // namespace coolerpp::test
+
+namespace coolerpp::test::index {
+
+// Every pixel from clr2 should be found in clr1 with a count that is at least as large
+[[nodiscard]] static bool is_downsampled(const File& clr1, const File& clr2) {
+  auto first1 = clr1.begin<std::int32_t>();
+  auto last1 = clr1.end<std::int32_t>();
+  for (auto first2 = clr2.begin<std::int32_t>(); first2 != clr2.end<std::int32_t>(); ++first2) {
+    while (first1 != last1 && first1->coords != first2->coords) {
+      ++first1;
+    }
+    if (first1 == last1 || first2->count <= 0 || first2->count > first1->count) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("utils: downsample", "[downsample][utils][short]") {
+  const auto src = datadir / "cooler_test_file.cool";
+  const auto clr = File::open_read_only(src.string());
+  const auto sum = std::get<std::int64_t>(*clr.attributes().sum);
+  REQUIRE(sum > 0);
+
+  SECTION("target sum") {
+    const auto dest = testdir() / "cooler_downsample_test1.cool";
+    const auto target_sum = static_cast<std::uint64_t>(sum / 4);
+    utils::downsample(src.string(), dest.string(), target_sum, 42, true);
+
+    const auto clr2 = File::open_read_only(dest.string());
+    CHECK(clr2.bin_size() == clr.bin_size());
+    CHECK(clr2.chromosomes() == clr.chromosomes());
+    CHECK(clr2.attributes().sum == StandardAttributes::SumVar{std::int64_t(target_sum)});
+    CHECK(clr2.attributes().nnz < clr.attributes().nnz);
+    CHECK(is_downsampled(clr, clr2));
+  }
+
+  SECTION("reproducibility") {
+    const auto dest1 = testdir() / "cooler_downsample_test2.cool";
+    const auto dest2 = testdir() / "cooler_downsample_test3.cool";
+    const auto dest3 = testdir() / "cooler_downsample_test4.cool";
+    const auto target_sum = static_cast<std::uint64_t>(sum / 2);
+    constexpr std::size_t chunk_size = 10'000;
+
+    utils::downsample(src.string(), dest1.string(), target_sum, 42, true, 1, chunk_size);
+    utils::downsample(src.string(), dest2.string(), target_sum, 42, true, 4, chunk_size);
+    utils::downsample(src.string(), dest3.string(), target_sum, 43, true, 4, chunk_size);
+
+    CHECK(utils::equal(dest1.string(), dest2.string()));
+    CHECK_FALSE(utils::equal(dest1.string(), dest3.string()));
+
+    const auto clr2 = File::open_read_only(dest2.string());
+    CHECK(clr2.attributes().sum == StandardAttributes::SumVar{std::int64_t(target_sum)});
+    CHECK(is_downsampled(clr, clr2));
+  }
+
+  SECTION("fraction") {
+    const auto dest1 = testdir() / "cooler_downsample_test5.cool";
+    const auto dest2 = testdir() / "cooler_downsample_test6.cool";
+    const auto dest3 = testdir() / "cooler_downsample_test7.cool";
+
+    utils::downsample_fraction(src.string(), dest1.string(), 0.1, 42, true);
+    const auto clr1 = File::open_read_only(dest1.string());
+    const auto expected_sum = std::int64_t(std::llround(0.1 * static_cast<double>(sum)));
+    CHECK(clr1.attributes().sum == StandardAttributes::SumVar{expected_sum});
+
+    utils::downsample_fraction(src.string(), dest2.string(), 1.0, 42, true);
+    CHECK(utils::equal(src.string(), dest2.string()));
+
+    utils::downsample_fraction(src.string(), dest3.string(), 0.0, 42, true);
+    const auto clr3 = File::open_read_only(dest3.string());
+    CHECK(clr3.attributes().nnz == 0);
+  }
+
+  SECTION("unsigned counts") {
+    const auto src2 = testdir() / "cooler_downsample_test9.cool";
+    const auto dest = testdir() / "cooler_downsample_test10.cool";
+    {
+      const auto sel = clr.fetch<std::uint32_t>();
+      const std::vector<ThinPixel<std::uint32_t>> pixels(sel.begin_thin(), sel.end_thin());
+      auto clr2 = File::create_new_cooler<std::uint32_t>(src2.string(), clr.chromosomes(),
+                                                         clr.bin_size(), true);
+      clr2.append_pixels(pixels.begin(), pixels.end());
+    }
+
+    const auto target_sum = static_cast<std::uint64_t>(sum / 4);
+    utils::downsample(src2.string(), dest.string(), target_sum, 42, true);
+
+    const auto clr2 = File::open_read_only(dest.string());
+    CHECK(std::holds_alternative<std::uint32_t>(clr2.pixel_variant()));
+    CHECK(clr2.attributes().sum == StandardAttributes::SumVar{std::int64_t(target_sum)});
+    CHECK(is_downsampled(clr, clr2));
+  }
+
+  SECTION("invalid target") {
+    const auto dest = testdir() / "cooler_downsample_test8.cool";
+    CHECK_THROWS_WITH(
+        utils::downsample(src.string(), dest.string(), static_cast<std::uint64_t>(sum) + 1, 42,
+                          true),
+        Catch::Matchers::ContainsSubstring("is larger than the sum of the interactions"));
+    CHECK_THROWS_AS(utils::downsample_fraction(src.string(), dest.string(), 1.5, 42, true),
+                    std::logic_error);
+    CHECK_THROWS_AS(utils::downsample_fraction(src.string(), dest.string(), -0.1, 42, true),
+                    std::logic_error);
+  }
+}
+
+}  // namespace coolerpp::test::index
@@ -4,7 +4,10 @@
 
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_string.hpp>
+#include <cstdint>
 #include <filesystem>
+#include <highfive/H5File.hpp>
+#include <vector>
 
 #include "coolerpp/test/self_deleting_folder.hpp"
 #include "coolerpp/utils.hpp"
@@ -32,5 +35,50 @@ TEST_CASE("utils: equal", "[equal][utils][short]") {
   }
 
   SECTION("not equal") { CHECK_FALSE(utils::equal(path1.string(), path2.string())); }
+
+  SECTION("compare modes") {
+    // Coarsening by a factor of 1 yields the same interactions, stored using different chunks
+    const auto path4 = testdir() / "cooler_equal_test_recompressed.cool";
+    utils::coarsen(path1.string(), path4.string(), 1, true);
+
+    for (const auto mode : {utils::CompareMode::ELEMENTWISE, utils::CompareMode::RAW_CHUNKS}) {
+      for (const std::size_t num_threads : {1, 4}) {
+        CHECK(utils::equal(path1.string(), path3.string(), true, mode, num_threads));
+        CHECK(utils::equal(path1.string(), path4.string(), true, mode, num_threads));
+        CHECK_FALSE(utils::equal(path1.string(), path2.string(), true, mode, num_threads));
+      }
+    }
+  }
+
+  SECTION("single difference") {
+    {
+      HighFive::File f(path3.string(), HighFive::File::ReadWrite);
+      auto dset = f.getDataSet("pixels/count");
+      const auto i = dset.getElementCount() - 1;
+      std::vector<std::int32_t> buff(1);
+      dset.select({i}, {1}).read(buff);
+      buff.front() += 1;
+      dset.select({i}, {1}).write(buff);
+    }
+
+    for (const auto mode : {utils::CompareMode::ELEMENTWISE, utils::CompareMode::RAW_CHUNKS}) {
+      for (const std::size_t num_threads : {1, 4}) {
+        CHECK_FALSE(utils::equal(path1.string(), path3.string(), true, mode, num_threads));
+      }
+    }
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("utils: fingerprint", "[equal][utils][short]") {
+  const auto path1 = datadir / "cooler_test_file.cool";
+  const auto path2 = datadir / "multires_cooler_test_file.mcool::/resolutions/6400000";
+  const auto path3 = testdir() / "cooler_fingerprint_test.cool";
+  utils::coarsen(path1.string(), path3.string(), 1, true);
+
+  const auto fp1 = utils::fingerprint(path1.string());
+  CHECK(fp1 == utils::fingerprint(path1.string(), 1'000));
+  CHECK(fp1 == utils::fingerprint(path3.string()));
+  CHECK(fp1 != utils::fingerprint(path2.string()));
 }
 }  // namespace coolerpp::test::index
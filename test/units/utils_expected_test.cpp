@@ -0,0 +1,262 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include "coolerpp/test/self_deleting_folder.hpp"
+#include "coolerpp/utils.hpp"
+
+namespace coolerpp::test {
+inline const SelfDeletingFolder testdir{true};            // NOLINT(cert-err58-cpp)
+inline const std::filesystem::path datadir{"test/data"};  // NOLINT(cert-err58-cpp)
+}  // namespace coolerpp::test
+
+namespace coolerpp::test::expected {
+
+using Catch::Matchers::WithinRel;
+
+// Compute the expected interactions for region by scanning all pixels
+[[nodiscard]] static utils::ExpectedCis naive_expected_cis(const File& clr,
+                                                           const GenomicInterval& region,
+                                                           const Weights* weights) {
+  const auto [first_bin, last_bin] = clr.bins().map_to_bin_ids(region);
+  const auto num_bins = last_bin - first_bin + 1;
+  auto is_valid = [&](std::uint64_t bin_id) {
+    return !weights || std::isfinite((*weights)[bin_id]);
+  };
+
+  utils::ExpectedCis expected{region, std::vector<double>(num_bins, 0),
+                              std::vector<std::uint64_t>(num_bins, 0)};
+  for (std::uint64_t bin1_id = first_bin; bin1_id <= last_bin; ++bin1_id) {
+    for (auto bin2_id = bin1_id; bin2_id <= last_bin; ++bin2_id) {
+      expected.num_valid[bin2_id - bin1_id] += is_valid(bin1_id) && is_valid(bin2_id);
+    }
+  }
+
+  std::for_each(clr.begin<std::int32_t>(), clr.end<std::int32_t>(), [&](const auto& p) {
+    const auto bin1_id = p.coords.bin1.id();
+    const auto bin2_id = p.coords.bin2.id();
+    if (bin1_id < first_bin || bin2_id > last_bin) {
+      return;
+    }
+    const auto count = weights ? p.count * (*weights)[bin1_id] * (*weights)[bin2_id]
+                               : static_cast<double>(p.count);
+    if (std::isfinite(count)) {
+      expected.count_sum[bin2_id - bin1_id] += count;
+    }
+  });
+  return expected;
+}
+
+static void compare_expected(const utils::ExpectedCis& e1, const utils::ExpectedCis& e2) {
+  CHECK(e1.region == e2.region);
+  REQUIRE(e1.count_sum.size() == e2.count_sum.size());
+  REQUIRE(e1.num_valid.size() == e2.num_valid.size());
+  for (std::size_t i = 0; i < e1.count_sum.size(); ++i) {
+    CHECK_THAT(e1.count_sum[i], WithinRel(e2.count_sum[i], 1.0e-9));
+    CHECK(e1.num_valid[i] == e2.num_valid[i]);
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("utils: expected cis", "[expected][utils][short]") {
+  const auto path = datadir / "cooler_test_file.cool";
+  const auto clr = File::open_read_only(path.string());
+  const auto weights = clr.read_weights("weight");
+  const auto& chroms = clr.chromosomes();
+
+  const std::vector<GenomicInterval> regions{{chroms.at("1"), 0, 10'000'000},
+                                             {chroms.at("2"), 5'000'000, 15'000'000}};
+
+  SECTION("raw") {
+    const auto expected = utils::expected_cis(clr, nullptr, regions);
+    REQUIRE(expected.size() == regions.size());
+    for (std::size_t i = 0; i < regions.size(); ++i) {
+      compare_expected(expected[i], naive_expected_cis(clr, regions[i], nullptr));
+    }
+  }
+
+  SECTION("balanced") {
+    const auto expected = utils::expected_cis(clr, weights, regions);
+    REQUIRE(expected.size() == regions.size());
+    for (std::size_t i = 0; i < regions.size(); ++i) {
+      compare_expected(expected[i], naive_expected_cis(clr, regions[i], weights.get()));
+    }
+  }
+
+  SECTION("chromosomes") {
+    const auto expected = utils::expected_cis(clr, weights);
+    REQUIRE(expected.size() == chroms.size());
+
+    double cis_sum = 0;
+    std::for_each(clr.begin<std::int32_t>(), clr.end<std::int32_t>(), [&](const auto& p) {
+      const auto bin1_id = p.coords.bin1.id();
+      const auto bin2_id = p.coords.bin2.id();
+      const auto count = p.count * (*weights)[bin1_id] * (*weights)[bin2_id];
+      if (p.coords.bin1.chrom() == p.coords.bin2.chrom() && std::isfinite(count)) {
+        cis_sum += count;
+      }
+    });
+
+    double sum = 0;
+    for (const auto& e : expected) {
+      CHECK(e.count_sum.size() == clr.bins().subset(e.region.chrom()).size());
+      sum += std::accumulate(e.count_sum.begin(), e.count_sum.end(), 0.0);
+    }
+    CHECK_THAT(sum, WithinRel(cis_sum, 1.0e-9));
+  }
+
+  SECTION("multi-threaded") {
+    const auto expected1 = utils::expected_cis(clr, weights);
+    for (const std::size_t num_threads : {2, 4}) {
+      // Use small chunks to make sure threads process multiple blocks
+      const auto expected2 = utils::expected_cis(clr, weights, {}, num_threads, 1'000);
+      REQUIRE(expected1.size() == expected2.size());
+      for (std::size_t i = 0; i < expected1.size(); ++i) {
+        compare_expected(expected1[i], expected2[i]);
+      }
+    }
+  }
+
+  SECTION("average") {
+    const auto expected = utils::expected_cis(clr, weights, regions);
+    const auto avg = expected.front().average();
+    for (std::size_t i = 0; i < avg.size(); ++i) {
+      const auto& e = expected.front();
+      if (e.num_valid[i] == 0) {
+        CHECK(std::isnan(avg[i]));
+      } else {
+        CHECK_THAT(avg[i], WithinRel(e.count_sum[i] / static_cast<double>(e.num_valid[i])));
+      }
+    }
+  }
+
+  SECTION("regions sharing a bin") {
+    const std::vector<GenomicInterval> adjacent{{chroms.at("1"), 0, 5'550'000},
+                                                {chroms.at("1"), 5'550'000, 5'560'000},
+                                                {chroms.at("1"), 5'560'000, 12'000'000}};
+    const auto expected = utils::expected_cis(clr, weights, adjacent);
+    REQUIRE(expected.size() == adjacent.size());
+    for (std::size_t i = 0; i < adjacent.size(); ++i) {
+      compare_expected(expected[i], naive_expected_cis(clr, adjacent[i], weights.get()));
+    }
+  }
+
+  SECTION("invalid regions") {
+    const std::vector<GenomicInterval> overlapping{{chroms.at("1"), 0, 10'000'000},
+                                                   {chroms.at("1"), 5'000'000, 15'000'000}};
+    CHECK_THROWS(utils::expected_cis(clr, nullptr, overlapping));
+
+    const std::vector<GenomicInterval> empty{{chroms.at("1"), 100, 100}};
+    CHECK_THROWS(utils::expected_cis(clr, nullptr, empty));
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("utils: expected trans", "[expected][utils][short]") {
+  const auto path = datadir / "cooler_test_file.cool";
+  const auto clr = File::open_read_only(path.string());
+  const auto weights = clr.read_weights("weight");
+  const auto& chroms = clr.chromosomes();
+
+  const auto expected = utils::expected_trans(clr, weights, 4, 1'000);
+  REQUIRE(expected.size() == (chroms.size() * (chroms.size() - 1)) / 2);
+
+  const auto& e = expected.front();
+  CHECK(e.region1.chrom() == chroms.at("1"));
+  CHECK(e.region2.chrom() == chroms.at("2"));
+
+  double count_sum = 0;
+  std::for_each(clr.begin<std::int32_t>(), clr.end<std::int32_t>(), [&](const auto& p) {
+    const auto count = p.count * (*weights)[p.coords.bin1.id()] * (*weights)[p.coords.bin2.id()];
+    if (p.coords.bin1.chrom() == e.region1.chrom() && p.coords.bin2.chrom() == e.region2.chrom() &&
+        std::isfinite(count)) {
+      count_sum += count;
+    }
+  });
+  CHECK_THAT(e.count_sum, WithinRel(count_sum, 1.0e-9));
+
+  auto count_valid_bins = [&](const Chromosome& chrom) {
+    const auto [first_bin, last_bin] = clr.bins().map_to_bin_ids(GenomicInterval{chrom});
+    std::uint64_t num_valid = 0;
+    for (auto i = first_bin; i <= last_bin; ++i) {
+      num_valid += std::isfinite((*weights)[i]);
+    }
+    return num_valid;
+  };
+  CHECK(e.num_valid == count_valid_bins(e.region1.chrom()) * count_valid_bins(e.region2.chrom()));
+  CHECK_THAT(e.average(), WithinRel(count_sum / static_cast<double>(e.num_valid)));
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("utils: expected io", "[expected][utils][short]") {
+  const auto src = datadir / "cooler_test_file.cool";
+  const auto path = testdir() / "cooler_expected_test.cool";
+  std::filesystem::copy_file(src, path, std::filesystem::copy_options::overwrite_existing);
+
+  const auto chroms = File::open_read_only(path.string()).chromosomes();
+  std::vector<utils::ExpectedCis> cis{};
+  std::vector<utils::ExpectedTrans> trans{};
+  {
+    const auto clr = File::open_read_only(path.string());
+    const auto weights = clr.read_weights("weight");
+    CHECK_FALSE(utils::has_expected_cis(clr, "weight"));
+    CHECK_FALSE(utils::has_expected_trans(clr, "weight"));
+    CHECK_THROWS(utils::read_expected_cis(clr, "weight"));
+    CHECK_THROWS(utils::read_expected_trans(clr, "weight"));
+
+    // Regions refer to the chromosomes of clr, which needs to be closed before the cooler can be
+    // opened in read-write mode
+    auto remap = [&](const GenomicInterval& gi) {
+      return GenomicInterval{chroms.at(gi.chrom().id()), gi.start(), gi.end()};
+    };
+    cis = utils::expected_cis(clr, weights);
+    for (auto& e : cis) {
+      e.region = remap(e.region);
+    }
+    trans = utils::expected_trans(clr, weights);
+    for (auto& e : trans) {
+      e.region1 = remap(e.region1);
+      e.region2 = remap(e.region2);
+    }
+  }
+
+  utils::write_expected(path.string(), "weight", cis);
+  utils::write_expected(path.string(), "weight", trans);
+  CHECK_THROWS(utils::write_expected(path.string(), "weight", cis));
+  utils::write_expected(path.string(), "weight", cis, true);
+
+  const auto clr = File::open_read_only(path.string());
+  CHECK(utils::has_expected_cis(clr, "weight"));
+  CHECK(utils::has_expected_trans(clr, "weight"));
+
+  SECTION("cis") {
+    const auto cis_ = utils::read_expected_cis(clr, "weight");
+    REQUIRE(cis.size() == cis_.size());
+    for (std::size_t i = 0; i < cis.size(); ++i) {
+      compare_expected(cis[i], cis_[i]);
+    }
+  }
+
+  SECTION("trans") {
+    const auto trans_ = utils::read_expected_trans(clr, "weight");
+    REQUIRE(trans.size() == trans_.size());
+    for (std::size_t i = 0; i < trans.size(); ++i) {
+      CHECK(trans[i].region1 == trans_[i].region1);
+      CHECK(trans[i].region2 == trans_[i].region2);
+      CHECK(trans[i].count_sum == trans_[i].count_sum);
+      CHECK(trans[i].num_valid == trans_[i].num_valid);
+    }
+  }
+}
+
+}  // namespace coolerpp::test::expected
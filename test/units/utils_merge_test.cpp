@@ -4,7 +4,10 @@
 
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_string.hpp>
+#include <cstdint>
 #include <filesystem>
+#include <string>
+#include <vector>
 
 #include "coolerpp/test/self_deleting_folder.hpp"
 #include "coolerpp/utils.hpp"
@@ -45,6 +48,123 @@ TEST_CASE("utils: merge", "[merge][utils][short]") {
     }
   }
 
+  SECTION("merge (parallel)") {
+    const auto dest1 = testdir() / "cooler_merge_test_parallel.cool";
+    utils::merge(sources.begin(), sources.end(), dest1.string(), true, 1'000, true, 4,
+                 utils::MergeStrategy::PQUEUE);
+
+    const auto clr1 = File::open_read_only_read_once(src.string());
+    const auto clr2 = File::open_read_only_read_once(dest1.string());
+
+    auto first1 = clr1.begin<std::int32_t>();
+    auto last1 = clr1.end<std::int32_t>();
+
+    auto first2 = clr2.begin<std::int32_t>();
+    auto last2 = clr2.end<std::int32_t>();
+
+    REQUIRE(std::distance(first1, last1) == std::distance(first2, last2));
+    while (first1 != last1) {
+      CHECK(first1->coords == first2->coords);
+      CHECK(2 * first1->count == first2->count);
+      ++first1;
+      ++first2;
+    }
+    CHECK(clr2.attributes().nnz == clr1.attributes().nnz);
+  }
+
+  SECTION("merge (in memory)") {
+    const auto dest1 = testdir() / "cooler_merge_test_in_memory.cool";
+    utils::merge(sources.begin(), sources.end(), dest1.string(), true, 1'000, true, 1,
+                 utils::MergeStrategy::IN_MEMORY);
+
+    const auto clr1 = File::open_read_only_read_once(src.string());
+    const auto clr2 = File::open_read_only_read_once(dest1.string());
+
+    auto first1 = clr1.begin<std::int32_t>();
+    auto last1 = clr1.end<std::int32_t>();
+
+    auto first2 = clr2.begin<std::int32_t>();
+    auto last2 = clr2.end<std::int32_t>();
+
+    REQUIRE(std::distance(first1, last1) == std::distance(first2, last2));
+    while (first1 != last1) {
+      CHECK(first1->coords == first2->coords);
+      CHECK(2 * first1->count == first2->count);
+      ++first1;
+      ++first2;
+    }
+    CHECK(clr2.attributes().nnz == clr1.attributes().nnz);
+  }
+
+  SECTION("merge (concatenate)") {
+    using N = std::int32_t;
+    const auto clr1 = File::open_read_only_read_once(src.string());
+    const auto sel = clr1.fetch<N>();
+    const std::vector<ThinPixel<N>> pixels(sel.begin_thin(), sel.end_thin());
+
+    // Split pixels into one cooler per chromosome (plus one cooler without pixels).
+    // Coolers are listed in reverse order, so that they have to be sorted before concatenation
+    // Chromosome pair stats are written to the merged cooler only when all chunks have them
+    std::vector<std::string> chunks{};
+    const auto& bins = clr1.bins();
+    WriterOptions options{};
+    options.compute_chromosome_pair_stats = true;
+    for (std::uint32_t chrom_id = 0; chrom_id <= clr1.chromosomes().size(); ++chrom_id) {
+      const auto path = testdir() / fmt::format(FMT_STRING("cooler_merge_test_chunk{}.cool"),
+                                                chrom_id);
+      auto f = File::create_new_cooler<N>(path.string(), clr1.chromosomes(), clr1.bin_size(),
+                                          true, StandardAttributes::init<N>(clr1.bin_size()),
+                                          DEFAULT_HDF5_CACHE_SIZE, options);
+      std::vector<std::uint64_t> bin1_ids{};
+      std::vector<std::uint64_t> bin2_ids{};
+      std::vector<N> counts{};
+      for (const auto& p : pixels) {
+        if (chrom_id < clr1.chromosomes().size() && bins.at(p.bin1_id).chrom().id() == chrom_id) {
+          bin1_ids.push_back(p.bin1_id);
+          bin2_ids.push_back(p.bin2_id);
+          counts.push_back(p.count);
+        }
+      }
+      f.append_pixels_columns(bin1_ids.data(), bin2_ids.data(), counts.data(), bin1_ids.size());
+      chunks.insert(chunks.begin(), path.string());
+    }
+
+    // Reference file computing sums and stats one pixel at a time
+    const auto ref_path = testdir() / "cooler_merge_test_concatenate_ref.cool";
+    utils::merge(chunks.begin(), chunks.end(), ref_path.string(), true, 1'000, true, 1,
+                 utils::MergeStrategy::PQUEUE);
+    const auto ref = File::open_read_only_read_once(ref_path.string());
+    REQUIRE(ref.has_chromosome_pair_stats());
+
+    for (const auto strategy : {utils::MergeStrategy::AUTO, utils::MergeStrategy::CONCATENATE}) {
+      for (const std::size_t num_threads : {1, 2}) {
+        const auto dest1 = testdir() / "cooler_merge_test_concatenate.cool";
+        utils::merge(chunks.begin(), chunks.end(), dest1.string(), true, 1'000, true, num_threads,
+                     strategy);
+
+        const auto clr2 = File::open_read_only_read_once(dest1.string());
+        const auto sel2 = clr2.fetch<N>();
+        CHECK(std::vector<ThinPixel<N>>(sel2.begin_thin(), sel2.end_thin()) == pixels);
+        CHECK(clr2.attributes().nnz == clr1.attributes().nnz);
+        CHECK(clr2.attributes().sum == clr1.attributes().sum);
+        CHECK(clr2.attributes().cis == ref.attributes().cis);
+        CHECK(clr2.read_chromosome_pair_stats() == ref.read_chromosome_pair_stats());
+
+        // Queries go through the rebased index
+        for (const auto& chrom : clr2.chromosomes()) {
+          const auto sel3 = clr2.fetch<N>(chrom.name());
+          const auto sel4 = ref.fetch<N>(chrom.name());
+          CHECK(std::vector<ThinPixel<N>>(sel3.begin_thin(), sel3.end_thin()) ==
+                std::vector<ThinPixel<N>>(sel4.begin_thin(), sel4.end_thin()));
+        }
+      }
+    }
+
+    CHECK_THROWS_WITH(utils::merge(sources.begin(), sources.end(), dest.string(), true, 1'000,
+                                   true, 1, utils::MergeStrategy::CONCATENATE),
+                      Catch::Matchers::ContainsSubstring("overlapping ranges of rows"));
+  }
+
   SECTION("merge - different resolutions") {
     const auto mclr = datadir / "multires_cooler_test_file.mcool";
     const auto dest1 = testdir() / "cooler_merge_test2.cool";
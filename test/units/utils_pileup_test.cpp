@@ -0,0 +1,203 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "coolerpp/test/self_deleting_folder.hpp"
+#include "coolerpp/utils.hpp"
+
+namespace coolerpp::test {
+inline const SelfDeletingFolder testdir{true};            // NOLINT(cert-err58-cpp)
+inline const std::filesystem::path datadir{"test/data"};  // NOLINT(cert-err58-cpp)
+}  // namespace coolerpp::test
+
+namespace coolerpp::test::pileup {
+
+using Catch::Matchers::WithinAbs;
+using Catch::Matchers::WithinRel;
+using Loci = std::vector<std::pair<GenomicInterval, GenomicInterval>>;
+
+// Compute the pileup by looking up every pixel of every window
+[[nodiscard]] static utils::Pileup naive_pileup(const File& clr, const Loci& loci,
+                                                std::uint32_t flank, const Weights* weights,
+                                                const std::vector<utils::ExpectedCis>* expected) {
+  const auto& bins = clr.bins();
+  const std::uint64_t size = (2 * flank) + 1;
+  utils::Pileup result{size, std::vector<double>(size * size, 0),
+                       std::vector<std::uint64_t>(size * size, 0), 0};
+
+  auto window_start = [&](const GenomicInterval& locus) -> std::optional<std::uint64_t> {
+    const auto midpoint = (locus.start() + locus.end()) / 2;
+    const auto bin = bins.at(locus.chrom(), midpoint);
+    const auto [first_bin, last_bin] = bins.map_to_bin_ids(GenomicInterval{locus.chrom()});
+    if (bin.id() < first_bin + flank || bin.id() + flank > last_bin) {
+      return {};
+    }
+    return bin.id() - flank;
+  };
+
+  std::vector<std::vector<double>> averages{};
+  if (expected) {
+    for (const auto& e : *expected) {
+      averages.emplace_back(e.average());
+    }
+  }
+  auto get_expected = [&](std::uint64_t bin1_id, std::uint64_t bin2_id) {
+    const auto bin1 = bins.at(bin1_id);
+    const auto bin2 = bins.at(bin2_id);
+    if (bin1.chrom() != bin2.chrom()) {
+      return std::numeric_limits<double>::quiet_NaN();
+    }
+    for (std::size_t i = 0; i < expected->size(); ++i) {
+      if ((*expected)[i].region.chrom() == bin1.chrom()) {
+        const auto diag = bin1_id < bin2_id ? bin2_id - bin1_id : bin1_id - bin2_id;
+        return averages[i][diag];
+      }
+    }
+    return std::numeric_limits<double>::quiet_NaN();
+  };
+
+  for (const auto& [locus1, locus2] : loci) {
+    const auto row_start = window_start(locus1);
+    const auto col_start = window_start(locus2);
+    if (!row_start || !col_start) {
+      continue;
+    }
+    ++result.num_windows;
+
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> bin_pairs{};
+    for (std::uint64_t i = 0; i < size; ++i) {
+      for (std::uint64_t j = 0; j < size; ++j) {
+        bin_pairs.emplace_back(*row_start + i, *col_start + j);
+      }
+    }
+    const auto counts = clr.lookup<double>(bin_pairs);
+
+    for (std::size_t k = 0; k < bin_pairs.size(); ++k) {
+      const auto [bin1_id, bin2_id] = bin_pairs[k];
+      auto value = counts[k];
+      if (weights) {
+        value *= (*weights)[bin1_id] * (*weights)[bin2_id];
+      }
+      if (expected) {
+        value /= get_expected(bin1_id, bin2_id);
+      }
+      if (std::isfinite(value)) {
+        result.sum[k] += value;
+        ++result.num_valid[k];
+      }
+    }
+  }
+  return result;
+}
+
+static void compare_pileups(const utils::Pileup& p1, const utils::Pileup& p2) {
+  CHECK(p1.size == p2.size);
+  CHECK(p1.num_windows == p2.num_windows);
+  REQUIRE(p1.sum.size() == p2.sum.size());
+  REQUIRE(p1.num_valid.size() == p2.num_valid.size());
+  for (std::size_t i = 0; i < p1.sum.size(); ++i) {
+    CHECK_THAT(p1.sum[i], WithinRel(p2.sum[i], 1.0e-9) || WithinAbs(p2.sum[i], 1.0e-9));
+    CHECK(p1.num_valid[i] == p2.num_valid[i]);
+  }
+}
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("utils: pileup", "[pileup][utils][short]") {
+  const auto path = datadir / "cooler_test_file.cool";
+  const auto clr = File::open_read_only(path.string());
+  const auto weights = clr.read_weights("weight");
+  const auto& chroms = clr.chromosomes();
+  const auto bin_size = clr.bin_size();
+  constexpr std::uint32_t flank = 5;
+
+  // Windows above, across and below the diagonal, trans windows and windows extending past the end
+  // of chromosomes
+  Loci loci{};
+  const auto& chr1 = chroms.at("1");
+  const auto& chr2 = chroms.at("2");
+  const auto num_bins = chr1.size() / bin_size;
+  for (std::uint32_t i = 0; i < 50; ++i) {
+    const auto bin1 = (20 + (13 * i)) % num_bins;
+    const auto bin2 = (bin1 + ((i % 7) * 4)) % num_bins;
+    const GenomicInterval locus1{chr1, bin1 * bin_size, (bin1 * bin_size) + 1};
+    const GenomicInterval locus2{chr1, bin2 * bin_size, (bin2 * bin_size) + 1};
+    loci.emplace_back(locus1, locus2);
+    if (i % 3 == 0) {
+      loci.emplace_back(locus2, locus1);
+    }
+    if (i % 5 == 0) {
+      loci.emplace_back(locus1, GenomicInterval{chr2, bin2 * bin_size, (bin2 * bin_size) + 1});
+      loci.emplace_back(GenomicInterval{chr2, bin2 * bin_size, (bin2 * bin_size) + 1}, locus1);
+    }
+  }
+  loci.emplace_back(GenomicInterval{chr1, 0, 1},
+                    GenomicInterval{chr1, 100 * bin_size, (100 * bin_size) + 1});
+  loci.emplace_back(GenomicInterval{chr1, 0, chr1.size()}, GenomicInterval{chr1, 0, chr1.size()});
+
+  SECTION("raw") {
+    const auto result = utils::pileup(clr, loci, flank);
+    CHECK(result.size == (2 * flank) + 1);
+    CHECK(result.num_windows < loci.size());
+    compare_pileups(result, naive_pileup(clr, loci, flank, nullptr, nullptr));
+  }
+
+  SECTION("balanced") {
+    const auto expected = naive_pileup(clr, loci, flank, weights.get(), nullptr);
+    for (const std::size_t num_threads : {1, 3}) {
+      // Use small chunks to make sure threads process multiple blocks
+      compare_pileups(utils::pileup(clr, loci, flank, weights, nullptr, num_threads, 1'000),
+                      expected);
+    }
+  }
+
+  SECTION("observed/expected") {
+    const auto expected_cis = utils::expected_cis(clr, weights);
+    const auto result = utils::pileup(clr, loci, flank, weights, &expected_cis, 2);
+    compare_pileups(result, naive_pileup(clr, loci, flank, weights.get(), &expected_cis));
+
+    // Trans windows are ignored
+    const Loci trans_loci{{GenomicInterval{chr1, 50 * bin_size, (50 * bin_size) + 1},
+                           GenomicInterval{chr2, 50 * bin_size, (50 * bin_size) + 1}}};
+    const auto trans = utils::pileup(clr, trans_loci, flank, weights, &expected_cis);
+    CHECK(trans.num_windows == 1);
+    for (const auto n : trans.num_valid) {
+      CHECK(n == 0);
+    }
+  }
+
+  SECTION("average") {
+    const auto result = utils::pileup(clr, loci, flank, weights);
+    const auto avg = result.average();
+    REQUIRE(avg.size() == result.sum.size());
+    for (std::size_t i = 0; i < avg.size(); ++i) {
+      if (result.num_valid[i] == 0) {
+        CHECK(std::isnan(avg[i]));
+      } else {
+        CHECK_THAT(avg[i],
+                   WithinRel(result.sum[i] / static_cast<double>(result.num_valid[i]), 1.0e-9));
+      }
+    }
+  }
+
+  SECTION("no windows") {
+    const auto result = utils::pileup(clr, {}, flank);
+    CHECK(result.num_windows == 0);
+    for (const auto n : result.num_valid) {
+      CHECK(n == 0);
+    }
+  }
+}
+
+}  // namespace coolerpp::test::pileup
@@ -0,0 +1,98 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "coolerpp/test/self_deleting_folder.hpp"
+#include "coolerpp/utils.hpp"
+
+namespace coolerpp::test {
+inline const SelfDeletingFolder testdir{true};            // NOLINT(cert-err58-cpp)
+inline const std::filesystem::path datadir{"test/data"};  // NOLINT(cert-err58-cpp)
+}  // namespace coolerpp::test
+
+namespace coolerpp::test::index {
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("utils: pixel sorter", "[sort][utils][short]") {
+  const auto src = datadir / "cooler_test_file.cool";
+  const auto clr1 = File::open_read_only(src.string());
+
+  std::vector<Pixel<std::int32_t>> pixels(clr1.begin<std::int32_t>(), clr1.end<std::int32_t>());
+  std::mt19937_64 rand_eng{123};  // NOLINT(cert-msc32-c,cert-msc51-cpp)
+  std::shuffle(pixels.begin(), pixels.end(), rand_eng);
+
+  SECTION("external sort") {
+    const auto dest = testdir() / "cooler_pixel_sorter_test1.cool";
+    {
+      auto clr2 = File::create_new_cooler<std::int32_t>(dest.string(), clr1.chromosomes(),
+                                                        clr1.bin_size(), true);
+      utils::PixelSorter<std::int32_t> sorter(clr2, testdir(), 10'000);
+      sorter.add(pixels.begin(), pixels.end());
+      CHECK(sorter.num_runs() == pixels.size() / 10'000);
+      sorter.finalize();
+      CHECK(sorter.num_runs() == 0);
+    }
+    CHECK(utils::equal(src.string(), dest.string()));
+  }
+
+  SECTION("in memory sort") {
+    const auto dest = testdir() / "cooler_pixel_sorter_test2.cool";
+    {
+      auto clr2 = File::create_new_cooler<std::int32_t>(dest.string(), clr1.chromosomes(),
+                                                        clr1.bin_size(), true);
+      utils::PixelSorter<std::int32_t> sorter(clr2, testdir());
+      sorter.add(pixels.begin(), pixels.end());
+      CHECK(sorter.num_runs() == 0);
+      sorter.finalize();
+    }
+    CHECK(utils::equal(src.string(), dest.string()));
+  }
+
+  SECTION("duplicate pixels") {
+    const auto dest = testdir() / "cooler_pixel_sorter_test3.cool";
+    {
+      auto clr2 = File::create_new_cooler<std::int32_t>(dest.string(), clr1.chromosomes(),
+                                                        clr1.bin_size(), true);
+      utils::PixelSorter<std::int32_t> sorter(clr2, testdir(), 25'000);
+      sorter.add(pixels.begin(), pixels.end());
+      sorter.add(pixels.rbegin(), pixels.rend());
+      sorter.finalize();
+    }
+
+    const auto clr2 = File::open_read_only(dest.string());
+    auto first1 = clr1.begin<std::int32_t>();
+    auto last1 = clr1.end<std::int32_t>();
+    auto first2 = clr2.begin<std::int32_t>();
+    auto last2 = clr2.end<std::int32_t>();
+
+    REQUIRE(std::distance(first1, last1) == std::distance(first2, last2));
+    while (first1 != last1) {
+      CHECK(first1->coords == first2->coords);
+      CHECK(2 * first1->count == first2->count);
+      ++first1;
+      ++first2;
+    }
+  }
+
+  SECTION("invalid pixels") {
+    const auto dest = testdir() / "cooler_pixel_sorter_test4.cool";
+    auto clr2 = File::create_new_cooler<std::int32_t>(dest.string(), clr1.chromosomes(),
+                                                      clr1.bin_size(), true);
+    utils::PixelSorter<std::int32_t> sorter(clr2, testdir());
+    CHECK_THROWS_AS(sorter.add(10, 5, 1), std::out_of_range);
+    CHECK_THROWS_AS(sorter.add(0, clr2.bins().size(), 1), std::out_of_range);
+
+    sorter.finalize();
+    CHECK_THROWS_AS(sorter.add(0, 0, 1), std::logic_error);
+  }
+}
+
+}  // namespace coolerpp::test::index
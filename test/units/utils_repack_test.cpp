@@ -0,0 +1,87 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include <H5Zpublic.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+#include "coolerpp/coolerpp.hpp"
+#include "coolerpp/test/self_deleting_folder.hpp"
+#include "coolerpp/utils.hpp"
+
+namespace coolerpp::test {
+inline const SelfDeletingFolder testdir{true};            // NOLINT(cert-err58-cpp)
+inline const std::filesystem::path datadir{"test/data"};  // NOLINT(cert-err58-cpp)
+}  // namespace coolerpp::test
+
+namespace coolerpp::test::utils_repack {
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("utils: repack", "[repack][utils][short]") {
+  const auto src = (datadir / "ENCFF993FGR.2500000.cool").string();
+  const auto dest = (testdir() / "cooler_repack_test.cool").string();
+
+  auto read_layout = [](const File& f, std::string_view name) {
+    internal::ChunkLayout layout{};
+    CHECK(internal::read_chunk_layout(f.dataset(name).get().getId(), layout));
+    return layout;
+  };
+
+  SECTION("repack") {
+    utils::RepackOptions options{};
+    options.overwrite_if_exists = true;
+    options.block_size = 1'000;
+    options.compression.pixels_bin1_id = {ShuffleFilter::NONE, Compressor::DEFLATE, 1, 1'000};
+    options.compression.pixels_count = {ShuffleFilter::NONE, Compressor::NONE, 0, 4'000};
+
+    for (const std::size_t num_threads : {std::size_t(1), std::size_t(4)}) {
+      options.num_threads = num_threads;
+      utils::repack(src, dest, options);
+
+      const auto clr1 = File::open_read_only(src);
+      const auto clr2 = File::open_read_only(dest);
+      CHECK(utils::equal(clr1, clr2, true, utils::CompareMode::ELEMENTWISE));
+      CHECK(clr2.pixel_variant().index() == clr1.pixel_variant().index());
+      CHECK(clr2.attributes().assembly == clr1.attributes().assembly);
+      CHECK(clr2.attributes().sum == clr1.attributes().sum);
+
+      const auto bin1_layout = read_layout(clr2, "pixels/bin1_id");
+      CHECK(bin1_layout.chunk_size == 1'000);
+      CHECK(bin1_layout.filters == std::vector<H5Z_filter_t>{H5Z_FILTER_DEFLATE});
+      CHECK(bin1_layout.deflate_level == 1);
+
+      const auto count_layout = read_layout(clr2, "pixels/count");
+      CHECK(count_layout.chunk_size == 4'000);
+      CHECK(count_layout.filters.empty());
+
+      // Weights are preserved
+      REQUIRE(clr2.has_weights("weight"));
+      const auto& weights1 = (*clr1.read_weights("weight"))();
+      const auto& weights2 = (*clr2.read_weights("weight"))();
+      REQUIRE(weights1.size() == weights2.size());
+      for (std::size_t i = 0; i < weights1.size(); ++i) {
+        if (std::isnan(weights1[i])) {
+          CHECK(std::isnan(weights2[i]));
+        } else {
+          CHECK(weights1[i] == weights2[i]);
+        }
+      }
+      CHECK(clr2.read_weights("weight")->type() == clr1.read_weights("weight")->type());
+      CHECK(clr2.group("bins").group.getDataSet("weight").getDataType() ==
+            clr1.group("bins").group.getDataSet("weight").getDataType());
+    }
+  }
+
+  SECTION("dest exists") {
+    const auto path = (datadir / "cooler_test_file.cool").string();
+    CHECK_THROWS(utils::repack(src, path));
+  }
+}
+
+}  // namespace coolerpp::test::utils_repack
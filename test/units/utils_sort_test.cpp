@@ -0,0 +1,77 @@
+// Copyright (C) 2023 Roberto Rossini <roberros@uio.no>
+//
+// SPDX-License-Identifier: MIT
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "coolerpp/test/self_deleting_folder.hpp"
+#include "coolerpp/utils.hpp"
+
+namespace coolerpp::test {
+inline const SelfDeletingFolder testdir{true};            // NOLINT(cert-err58-cpp)
+inline const std::filesystem::path datadir{"test/data"};  // NOLINT(cert-err58-cpp)
+}  // namespace coolerpp::test
+
+namespace coolerpp::test::index {
+
+// NOLINTNEXTLINE(readability-function-cognitive-complexity)
+TEST_CASE("utils: sort pixels", "[sort][utils][short]") {
+  const auto src = datadir / "cooler_test_file.cool";
+  const auto clr1 = File::open_read_only(src.string());
+  const auto sel = clr1.fetch<std::int32_t>();
+  const std::vector<ThinPixel<std::int32_t>> expected(sel.begin_thin(), sel.end_thin());
+
+  std::mt19937_64 rand_eng{123};  // NOLINT(cert-msc32-c,cert-msc51-cpp)
+  auto pixels = expected;
+  std::shuffle(pixels.begin(), pixels.end(), rand_eng);
+
+  SECTION("thin pixels") {
+    utils::sort_pixels(pixels);
+    CHECK(pixels == expected);
+  }
+
+  SECTION("multiple threads") {
+    utils::sort_pixels(pixels, false, 4);
+    CHECK(pixels == expected);
+  }
+
+  SECTION("sum duplicates") {
+    pixels.insert(pixels.end(), expected.rbegin(), expected.rend());
+    utils::sort_pixels(pixels, true, 2);
+    REQUIRE(pixels.size() == expected.size());
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+      CHECK(pixels[i].bin1_id == expected[i].bin1_id);
+      CHECK(pixels[i].bin2_id == expected[i].bin2_id);
+      CHECK(pixels[i].count == 2 * expected[i].count);
+    }
+  }
+
+  SECTION("append sorted pixels") {
+    std::vector<Pixel<std::int32_t>> full_pixels(clr1.begin<std::int32_t>(),
+                                                 clr1.end<std::int32_t>());
+    std::shuffle(full_pixels.begin(), full_pixels.end(), rand_eng);
+    utils::sort_pixels(full_pixels);
+
+    const auto dest = testdir() / "cooler_sort_pixels_test.cool";
+    {
+      auto clr2 = File::create_new_cooler<std::int32_t>(dest.string(), clr1.chromosomes(),
+                                                        clr1.bin_size(), true);
+      clr2.append_pixels(full_pixels.begin(), full_pixels.end(), true);
+    }
+    CHECK(utils::equal(src.string(), dest.string()));
+  }
+
+  SECTION("pixels without bin ids") {
+    const auto& chrom = clr1.chromosomes().at(std::uint32_t{0});
+    std::vector<Pixel<std::int32_t>> invalid{Pixel<std::int32_t>{chrom, 0, 100'000, 1}};
+    CHECK_THROWS_AS(utils::sort_pixels(invalid), std::runtime_error);
+  }
+}
+
+}  // namespace coolerpp::test::index